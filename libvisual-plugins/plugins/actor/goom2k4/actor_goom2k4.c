@@ -205,10 +205,10 @@ int lv_goom_render (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 	else
 		buf = goom_update (priv->goominfo, pcmdata, 0, 0, NULL, NULL);
 
-	visual_mem_copy_pitch (vidbuf, buf, video->pitch,
-			video->width * video->bpp,
-			video->width * video->bpp,
-			video->height);
+	for (i = 0; i < video->height; i++) {
+		visual_mem_copy (vidbuf + i * video->pitch, (uint8_t *) buf + i * video->width * video->bpp,
+				video->width * video->bpp);
+	}
 
 	return 0;
 }
@@ -9,12 +9,6 @@
 
 #include <libvisual/libvisual.h>
 
-//#define CONV_MOTIF_W 32
-//#define CONV_MOTIF_WMASK 0x1f
-
-#define CONV_MOTIF_W 128
-#define CONV_MOTIF_WMASK 0x7f
-
 typedef char Motif[CONV_MOTIF_W][CONV_MOTIF_W];
 
 #include "motif_goom1.h"
@@ -112,13 +106,69 @@ static void convolve_free(VisualFX *_this) {
   free (_this->fx_data);
 }
 
+/* a whole screen is split in bands of about that many pixels */
+#define CONVOLVE_BAND_PIXELS (32 * 1024)
+
+/* the plain C version, the SIMD ones are bit exact with it */
+void convolve_rows_c(ConvolveRows *rows, int start, int end)
+{
+  int i = start;
+
+  while (i < end) {
+    int y = i / rows->width;
+    int x = i - y * rows->width;
+    int last = (y + 1) * rows->width;
+    unsigned int xtex, ytex;
+
+    if (last > end)
+      last = end;
+
+    xtex = rows->xtex + (unsigned int)y * rows->s + (unsigned int)x * rows->c;
+    ytex = rows->ytex + (unsigned int)y * rows->c - (unsigned int)x * rows->s;
+
+    for (; i < last; i++) {
+      int iff2;
+      unsigned int f0,f1,f2,f3;
+
+      iff2 = rows->ifftab[rows->motif[((ytex >> 16) & CONV_MOTIF_WMASK) * CONV_MOTIF_W + ((xtex >> 16) & CONV_MOTIF_WMASK)]];
+
+#define sat(a) ((a)>0xFF?0xFF:(a))
+      f0 = rows->src[i].val;
+      f1 = ((f0 >> R_OFFSET) & 0xFF) * iff2 >> 8;
+      f2 = ((f0 >> G_OFFSET) & 0xFF) * iff2 >> 8;
+      f3 = ((f0 >> B_OFFSET) & 0xFF) * iff2 >> 8;
+      rows->dest[i].val = (sat(f1) << R_OFFSET) | (sat(f2) << G_OFFSET) | (sat(f3) << B_OFFSET);
+
+      xtex += rows->c;
+      ytex -= rows->s;
+    }
+  }
+}
+
+static void convolve_band(void *priv, int start, int end)
+{
+  ConvolveRows *rows = (ConvolveRows*)priv;
+
+  rows->func(rows, start * rows->width, end * rows->width);
+}
+
+/*
+ * Runs a convolve row kernel over the whole screen, split in bands of rows.
+ * Every pixel only reads src, so the bands are independant.
+ */
+void convolve_filter_rows(ConvolveRows *rows, int height)
+{
+  int grain = CONVOLVE_BAND_PIXELS / rows->width;
+
+  visual_jobs_parallel_for(0, height, grain > 0 ? grain : 1, convolve_band, rows);
+}
+
 static void create_output_with_brightness(VisualFX *_this, Pixel *src, Pixel *dest,
                                          PluginInfo *info, int iff)
 {
   ConvData *data = (ConvData*)_this->fx_data;
-  
-  int x,y;
-  int i = 0;//info->screen.height * info->screen.width - 1;
+  ConvolveRows rows;
+  int i;
 
   const int c = data->h_cos [data->theta];
   const int s = data->h_sin [data->theta];
@@ -129,136 +179,29 @@ static void create_output_with_brightness(VisualFX *_this, Pixel *src, Pixel *de
   const int xj = -(info->screen.height/2) * s;
   const int yj = -(info->screen.height/2) * c;
 
-  int xprime = xj;
-  int yprime = yj;
-
-  int ifftab[16];
   if (data->inverse_motif) {
-    int i;
     for (i=0;i<16;++i)
-      ifftab[i] = (double)iff * (1.0 + data->visibility * (15.0 - i) / 15.0);
+      rows.ifftab[i] = (double)iff * (1.0 + data->visibility * (15.0 - i) / 15.0);
   }
   else {
-    int i;
     for (i=0;i<16;++i)
-      ifftab[i] = (double)iff / (1.0 + data->visibility * (15.0 - i) / 15.0);
+      rows.ifftab[i] = (double)iff / (1.0 + data->visibility * (15.0 - i) / 15.0);
   }
 
-  if (visual_cpu_get_mmx ()) {
-#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
-	  for (y=info->screen.height;y--;) {
-		  int xtex,ytex;
-
-		  xtex = xprime + xi + CONV_MOTIF_W * 0x10000 / 2;
-		  xprime += s;
-
-		  ytex = yprime + yi + CONV_MOTIF_W * 0x10000 / 2;
-		  yprime += c;
-
-		  __asm__ __volatile__
-			  ("\n\t pxor  %%mm7,  %%mm7"  /* mm7 = 0   */
-			   "\n\t movd %[xtex],  %%mm2"
-			   "\n\t movd %[ytex],  %%mm3"
-			   "\n\t punpckldq %%mm3, %%mm2" /* mm2 = [ ytex | xtex ] */
-			   "\n\t movd %[c],     %%mm4"
-			   "\n\t movd %[s],     %%mm6"
-			   "\n\t pxor  %%mm5,   %%mm5"
-			   "\n\t psubd %%mm6,   %%mm5"
-			   "\n\t punpckldq %%mm5, %%mm4" /* mm4 = [ -s | c ]      */
-			   "\n\t movd %[motif], %%mm6"   /* mm6 = motif           */
-
-			   ::[xtex]"g"(xtex) ,[ytex]"g"(ytex)
-			   , [c]"g"(c), [s]"g"(s)
-			   , [motif] "g"(&data->conv_motif[0][0]));
-
-		  for (x=info->screen.width;x--;)
-		  {
-			  __asm__ __volatile__
-				  (
-				   "\n\t movd  %[src], %%mm0"  /* mm0 = src */
-				   "\n\t paddd %%mm4, %%mm2"   /* [ ytex | xtex ] += [ -s | s ] */
-				   "\n\t movd  %%esi, %%mm5"   /* save esi into mm5 */
-				   "\n\t movq  %%mm2, %%mm3"
-				   "\n\t psrld  $16,  %%mm3"   /* mm3 = [ (ytex>>16) | (xtex>>16) ] */
-				   "\n\t movd  %%mm3, %%eax"   /* eax = xtex' */
-
-				   "\n\t psrlq $25,   %%mm3"
-				   "\n\t movd  %%mm3, %%ecx"   /* ecx = ytex' << 7 */
-
-				   "\n\t andl  $127, %%eax"
-				   "\n\t andl  $16256, %%ecx"
-
-				   "\n\t addl  %%ecx, %%eax"
-				   "\n\t movd  %%mm6, %%esi"   /* esi = motif */
-				   "\n\t xorl  %%ecx, %%ecx"
-				   "\n\t movb  (%%eax,%%esi), %%cl"
-
-				   "\n\t movl  %[ifftab], %%eax"
-				   "\n\t movd  %%mm5, %%esi"    /* restore esi from mm5 */
-				   "\n\t movd  (%%eax,%%ecx,4), %%mm1" /* mm1 = [0|0|0|iff2] */
-
-				   "\n\t punpcklwd %%mm1, %%mm1"
-				   "\n\t punpcklbw %%mm7, %%mm0"
-				   "\n\t punpckldq %%mm1, %%mm1"
-				   "\n\t psrlw     $1,    %%mm0"
-				   "\n\t psrlw     $2,    %%mm1"
-				   "\n\t pmullw    %%mm1, %%mm0"
-				   "\n\t psrlw     $5,    %%mm0"
-				   "\n\t packuswb  %%mm7, %%mm0"
-				   "\n\t movd      %%mm0, %[dest]"
-				   : [dest] "=g" (dest[i].val)
-				   : [src]   "g"  (src[i].val)
-				   , [ifftab]"g"(&ifftab[0])
-				   : "eax","ecx");
-
-			  i++;
-		  }
-	  }
-
-	  __asm__ __volatile__ ("\n\t emms");
-#endif
-  } else {
-	  for (y=info->screen.height;y--;) {
-		  int xtex,ytex;
-
-		  xtex = xprime + xi + CONV_MOTIF_W * 0x10000 / 2;
-		  xprime += s;
-
-		  ytex = yprime + yi + CONV_MOTIF_W * 0x10000 / 2;
-		  yprime += c;
-
-
-		  for (x=info->screen.width;x--;) {
-
-			  int iff2;
-			  unsigned int f0,f1,f2,f3;
-
-			  xtex += c;
-			  ytex -= s;
-
-			  iff2 = ifftab[data->conv_motif[(ytex >>16) & CONV_MOTIF_WMASK][(xtex >> 16) & CONV_MOTIF_WMASK]];
+  rows.src = src;
+  rows.dest = dest;
+  rows.width = info->screen.width;
+  rows.c = c;
+  rows.s = s;
 
-#define sat(a) ((a)>0xFF?0xFF:(a))
-			  f0 = src[i].val;
-			  f1 = ((f0 >> R_OFFSET) & 0xFF) * iff2 >> 8;
-			  f2 = ((f0 >> G_OFFSET) & 0xFF) * iff2 >> 8;
-			  f3 = ((f0 >> B_OFFSET) & 0xFF) * iff2 >> 8;
-			  dest[i].val = (sat(f1) << R_OFFSET) | (sat(f2) << G_OFFSET) | (sat(f3) << B_OFFSET);
-			  /*
-			     f0 = (src[i].cop[0] * iff2) >> 8;
-			     f1 = (src[i].cop[1] * iff2) >> 8;
-			     f2 = (src[i].cop[2] * iff2) >> 8;
-			     f3 = (src[i].cop[3] * iff2) >> 8;
-
-			     dest[i].cop[0] = (f0 & 0xffffff00) ? 0xff : (unsigned char)f0;
-			     dest[i].cop[1] = (f1 & 0xffffff00) ? 0xff : (unsigned char)f1;
-			     dest[i].cop[2] = (f2 & 0xffffff00) ? 0xff : (unsigned char)f2;
-			     dest[i].cop[3] = (f3 & 0xffffff00) ? 0xff : (unsigned char)f3;
-			     */
-			  i++;
-		  }
-	  }
-  }
+  /* the texture moves by (c, -s) before the first pixel of a row */
+  rows.xtex = (unsigned int)xj + xi + CONV_MOTIF_W * 0x10000 / 2 + c;
+  rows.ytex = (unsigned int)yj + yi + CONV_MOTIF_W * 0x10000 / 2 - s;
+
+  rows.motif = (const unsigned char*)&data->conv_motif[0][0];
+  rows.func = info->methods.convolve_rows;
+
+  convolve_filter_rows(&rows, info->screen.height);
 
   compute_tables(_this, info);
 }
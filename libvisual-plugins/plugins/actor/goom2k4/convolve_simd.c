@@ -0,0 +1,412 @@
+/* convolve_simd.c
+ * SSE4.1, AVX2 and NEON versions of the convolve fx brightness.
+ *
+ * They compute the same thing than convolve_rows_c, in batchs of pixels of a row:
+ *  - the texture coordinates and the motif texel of every pixel are computed in
+ *    vectors, then the texels are read one by one, the motif is 16 KB,
+ *  - the 16 entries brightness table is split in 4 planes of bytes, so the
+ *    brightness of 16 texels is looked up with 4 byte shuffles, no gather,
+ *  - every channel is multiplied by its 32 bits brightness, shifted and
+ *    clamped to 0xff with an unsigned min, which is exactly the C code.
+ * The alpha channel of the destination is cleared, like in convolve_rows_c.
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdint.h>
+
+/* convolve_fx.c includes goom_graphic.h before goom_config.h, the channel
+ * offsets have to be the ones it sees */
+#include "goom_graphic.h"
+#include "goom_fx.h"
+#include "convolve_simd.h"
+
+#ifdef GOOM_NEON
+#include <arm_neon.h>
+#endif
+
+/* pixels whose motif texels are read before they are lit */
+#define CONVOLVE_SIMD_BATCH 32
+
+/* the motif texel and brightness of every pixel of a batch */
+typedef struct {
+    uint32_t pos[CONVOLVE_SIMD_BATCH];
+    uint8_t motif[CONVOLVE_SIMD_BATCH];
+    uint32_t iff[CONVOLVE_SIMD_BATCH];
+} ConvolveLanes;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+/* constants of a convolve, repeated for every lane of the widest vector */
+typedef struct {
+    int32_t xtex[8];        /* texture coordinates of the next vector */
+    int32_t ytex[8];
+    int32_t xstep[8];       /* from a vector to the next */
+    int32_t ystep[8];
+    int32_t xmask[8];
+    int32_t ymask[8];
+    int32_t byte[8];
+    int32_t order[8];       /* dwords of a batch of texels, for the in lane unpacks of AVX2 */
+    uint8_t planes[4][32];  /* byte n of every brightness, twice */
+} ConvolveParams;
+
+static void convolve_params_init (ConvolveParams *params, ConvolveRows *rows)
+{
+    static const int32_t order[8] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        params->xmask[i] = CONV_MOTIF_WMASK;
+        params->ymask[i] = CONV_MOTIF_WMASK * CONV_MOTIF_W;
+        params->byte[i] = 0xff;
+        params->order[i] = order[i];
+    }
+
+    for (i = 0; i < 32; i++) {
+        uint32_t iff = rows->ifftab[i & 15];
+
+        params->planes[0][i] = iff;
+        params->planes[1][i] = iff >> 8;
+        params->planes[2][i] = iff >> 16;
+        params->planes[3][i] = iff >> 24;
+    }
+}
+
+/* texture coordinates from the pixel i on, for vectors of n lanes */
+static void convolve_params_row (ConvolveParams *params, ConvolveRows *rows, int i, int n)
+{
+    int y = i / rows->width;
+    uint32_t x = i - y * rows->width;
+    uint32_t xtex = rows->xtex + (uint32_t) y * rows->s + x * rows->c;
+    uint32_t ytex = rows->ytex + (uint32_t) y * rows->c - x * rows->s;
+    int k;
+
+    for (k = 0; k < 8; k++) {
+        params->xtex[k] = xtex + (uint32_t) k * rows->c;
+        params->ytex[k] = ytex - (uint32_t) k * rows->s;
+        params->xstep[k] = (uint32_t) n * rows->c;
+        params->ystep[k] = (uint32_t) n * rows->s;
+    }
+}
+
+/* motif texels of a vector of pixels, then on to the next vector */
+#define CONVOLVE_INDEX_SSE2(o) \
+                 "\n\t movdqa %%xmm0, %%xmm2" \
+                 "\n\t psrld $16, %%xmm2" \
+                 "\n\t pand %%xmm6, %%xmm2" \
+                 "\n\t movdqa %%xmm1, %%xmm3" \
+                 "\n\t psrld $9, %%xmm3" \
+                 "\n\t pand %%xmm7, %%xmm3" \
+                 "\n\t por %%xmm3, %%xmm2" \
+                 "\n\t movdqu %%xmm2, " #o "(%[l])" \
+                 "\n\t paddd %%xmm4, %%xmm0" \
+                 "\n\t psubd %%xmm5, %%xmm1"
+
+/* the channel at offset o of the pixels in xmm0, lit by xmm1, in x */
+#define CONVOLVE_CHANNEL_SSE41(o, x) \
+                 "\n\t movdqa %%xmm0, %%" x \
+                 "\n\t psrld " o ", %%" x \
+                 "\n\t pand %%xmm7, %%" x \
+                 "\n\t pmulld %%xmm1, %%" x \
+                 "\n\t psrld $8, %%" x \
+                 "\n\t pminud %%xmm7, %%" x \
+                 "\n\t pslld " o ", %%" x
+
+void convolve_rows_sse41 (ConvolveRows *rows, int start, int end)
+{
+    ConvolveLanes lanes;
+    ConvolveParams params;
+    int i, j, last;
+
+    convolve_params_init (&params, rows);
+
+    for (i = start; i < end; i = last) {
+        last = (i / rows->width + 1) * rows->width;
+        if (last > end)
+            last = end;
+
+        convolve_params_row (&params, rows, i, 4);
+
+        for (; i + 16 <= last; i += 16) {
+            __asm __volatile
+                ("\n\t movdqu (%[p]), %%xmm0"
+                 "\n\t movdqu 32(%[p]), %%xmm1"
+                 "\n\t movdqu 64(%[p]), %%xmm4"
+                 "\n\t movdqu 96(%[p]), %%xmm5"
+                 "\n\t movdqu 128(%[p]), %%xmm6"
+                 "\n\t movdqu 160(%[p]), %%xmm7"
+                 CONVOLVE_INDEX_SSE2(0)
+                 CONVOLVE_INDEX_SSE2(16)
+                 CONVOLVE_INDEX_SSE2(32)
+                 CONVOLVE_INDEX_SSE2(48)
+                 "\n\t movdqu %%xmm0, (%[p])"
+                 "\n\t movdqu %%xmm1, 32(%[p])"
+                 :: [p] "r" (&params), [l] "r" (lanes.pos)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+
+            for (j = 0; j < 16; j++)
+                lanes.motif[j] = rows->motif[lanes.pos[j]];
+
+            __asm __volatile
+                ("\n\t movdqu (%[m]), %%xmm0"
+                 "\n\t movdqu 256(%[p]), %%xmm1"
+                 "\n\t movdqu 288(%[p]), %%xmm2"
+                 "\n\t movdqu 320(%[p]), %%xmm3"
+                 "\n\t movdqu 352(%[p]), %%xmm4"
+                 "\n\t pshufb %%xmm0, %%xmm1"
+                 "\n\t pshufb %%xmm0, %%xmm2"
+                 "\n\t pshufb %%xmm0, %%xmm3"
+                 "\n\t pshufb %%xmm0, %%xmm4"
+                 "\n\t movdqa %%xmm1, %%xmm5"
+                 "\n\t punpcklbw %%xmm2, %%xmm1"
+                 "\n\t punpckhbw %%xmm2, %%xmm5"
+                 "\n\t movdqa %%xmm3, %%xmm6"
+                 "\n\t punpcklbw %%xmm4, %%xmm3"
+                 "\n\t punpckhbw %%xmm4, %%xmm6"
+                 "\n\t movdqa %%xmm1, %%xmm0"
+                 "\n\t punpcklwd %%xmm3, %%xmm0"
+                 "\n\t punpckhwd %%xmm3, %%xmm1"
+                 "\n\t movdqa %%xmm5, %%xmm2"
+                 "\n\t punpcklwd %%xmm6, %%xmm2"
+                 "\n\t punpckhwd %%xmm6, %%xmm5"
+                 "\n\t movdqu %%xmm0, (%[f])"
+                 "\n\t movdqu %%xmm1, 16(%[f])"
+                 "\n\t movdqu %%xmm2, 32(%[f])"
+                 "\n\t movdqu %%xmm5, 48(%[f])"
+                 :: [p] "r" (&params), [m] "r" (lanes.motif), [f] "r" (lanes.iff)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6");
+
+            for (j = 0; j < 16; j += 4) {
+                __asm __volatile
+                    ("\n\t movdqu (%[s]), %%xmm0"
+                     "\n\t movdqu (%[f]), %%xmm1"
+                     "\n\t movdqu 192(%[p]), %%xmm7"
+                     CONVOLVE_CHANNEL_SSE41("%[ro]", "xmm2")
+                     CONVOLVE_CHANNEL_SSE41("%[go]", "xmm3")
+                     "\n\t por %%xmm3, %%xmm2"
+                     CONVOLVE_CHANNEL_SSE41("%[bo]", "xmm3")
+                     "\n\t por %%xmm3, %%xmm2"
+                     "\n\t movdqu %%xmm2, (%[d])"
+                     :: [s] "r" (rows->src + i + j), [d] "r" (rows->dest + i + j),
+                        [f] "r" (&lanes.iff[j]), [p] "r" (&params),
+                        [ro] "i" (R_OFFSET), [go] "i" (G_OFFSET), [bo] "i" (B_OFFSET)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+            }
+        }
+
+        convolve_rows_c (rows, i, last);
+    }
+}
+
+#define CONVOLVE_INDEX_AVX2(o) \
+                 "\n\t vpsrld $16, %%ymm0, %%ymm2" \
+                 "\n\t vpand %%ymm6, %%ymm2, %%ymm2" \
+                 "\n\t vpsrld $9, %%ymm1, %%ymm3" \
+                 "\n\t vpand %%ymm7, %%ymm3, %%ymm3" \
+                 "\n\t vpor %%ymm3, %%ymm2, %%ymm2" \
+                 "\n\t vmovdqu %%ymm2, " #o "(%[l])" \
+                 "\n\t vpaddd %%ymm4, %%ymm0, %%ymm0" \
+                 "\n\t vpsubd %%ymm5, %%ymm1, %%ymm1"
+
+#define CONVOLVE_CHANNEL_AVX2(o, x) \
+                 "\n\t vpsrld " o ", %%ymm0, %%" x \
+                 "\n\t vpand %%ymm7, %%" x ", %%" x \
+                 "\n\t vpmulld %%ymm1, %%" x ", %%" x \
+                 "\n\t vpsrld $8, %%" x ", %%" x \
+                 "\n\t vpminud %%ymm7, %%" x ", %%" x \
+                 "\n\t vpslld " o ", %%" x ", %%" x
+
+void convolve_rows_avx2 (ConvolveRows *rows, int start, int end)
+{
+    ConvolveLanes lanes;
+    ConvolveParams params;
+    int i, j, last;
+
+    convolve_params_init (&params, rows);
+
+    for (i = start; i < end; i = last) {
+        last = (i / rows->width + 1) * rows->width;
+        if (last > end)
+            last = end;
+
+        convolve_params_row (&params, rows, i, 8);
+
+        for (; i + 32 <= last; i += 32) {
+            __asm __volatile
+                ("\n\t vmovdqu (%[p]), %%ymm0"
+                 "\n\t vmovdqu 32(%[p]), %%ymm1"
+                 "\n\t vmovdqu 64(%[p]), %%ymm4"
+                 "\n\t vmovdqu 96(%[p]), %%ymm5"
+                 "\n\t vmovdqu 128(%[p]), %%ymm6"
+                 "\n\t vmovdqu 160(%[p]), %%ymm7"
+                 CONVOLVE_INDEX_AVX2(0)
+                 CONVOLVE_INDEX_AVX2(32)
+                 CONVOLVE_INDEX_AVX2(64)
+                 CONVOLVE_INDEX_AVX2(96)
+                 "\n\t vmovdqu %%ymm0, (%[p])"
+                 "\n\t vmovdqu %%ymm1, 32(%[p])"
+                 :: [p] "r" (&params), [l] "r" (lanes.pos)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+
+            for (j = 0; j < 32; j++)
+                lanes.motif[j] = rows->motif[lanes.pos[j]];
+
+            /* the texels are ordered so that the in lane unpacks give 8 pixels in a row */
+            __asm __volatile
+                ("\n\t vmovdqu 224(%[p]), %%ymm7"
+                 "\n\t vpermd (%[m]), %%ymm7, %%ymm0"
+                 "\n\t vmovdqu 256(%[p]), %%ymm1"
+                 "\n\t vmovdqu 288(%[p]), %%ymm2"
+                 "\n\t vmovdqu 320(%[p]), %%ymm3"
+                 "\n\t vmovdqu 352(%[p]), %%ymm4"
+                 "\n\t vpshufb %%ymm0, %%ymm1, %%ymm1"
+                 "\n\t vpshufb %%ymm0, %%ymm2, %%ymm2"
+                 "\n\t vpshufb %%ymm0, %%ymm3, %%ymm3"
+                 "\n\t vpshufb %%ymm0, %%ymm4, %%ymm4"
+                 "\n\t vpunpcklbw %%ymm2, %%ymm1, %%ymm5"
+                 "\n\t vpunpckhbw %%ymm2, %%ymm1, %%ymm1"
+                 "\n\t vpunpcklbw %%ymm4, %%ymm3, %%ymm6"
+                 "\n\t vpunpckhbw %%ymm4, %%ymm3, %%ymm3"
+                 "\n\t vpunpcklwd %%ymm6, %%ymm5, %%ymm0"
+                 "\n\t vpunpckhwd %%ymm6, %%ymm5, %%ymm2"
+                 "\n\t vpunpcklwd %%ymm3, %%ymm1, %%ymm4"
+                 "\n\t vpunpckhwd %%ymm3, %%ymm1, %%ymm5"
+                 "\n\t vmovdqu %%ymm0, (%[f])"
+                 "\n\t vmovdqu %%ymm2, 32(%[f])"
+                 "\n\t vmovdqu %%ymm4, 64(%[f])"
+                 "\n\t vmovdqu %%ymm5, 96(%[f])"
+                 :: [p] "r" (&params), [m] "r" (lanes.motif), [f] "r" (lanes.iff)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+
+            for (j = 0; j < 32; j += 8) {
+                __asm __volatile
+                    ("\n\t vmovdqu (%[s]), %%ymm0"
+                     "\n\t vmovdqu (%[f]), %%ymm1"
+                     "\n\t vmovdqu 192(%[p]), %%ymm7"
+                     CONVOLVE_CHANNEL_AVX2("%[ro]", "ymm2")
+                     CONVOLVE_CHANNEL_AVX2("%[go]", "ymm3")
+                     "\n\t vpor %%ymm3, %%ymm2, %%ymm2"
+                     CONVOLVE_CHANNEL_AVX2("%[bo]", "ymm3")
+                     "\n\t vpor %%ymm3, %%ymm2, %%ymm2"
+                     "\n\t vmovdqu %%ymm2, (%[d])"
+                     :: [s] "r" (rows->src + i + j), [d] "r" (rows->dest + i + j),
+                        [f] "r" (&lanes.iff[j]), [p] "r" (&params),
+                        [ro] "i" (R_OFFSET), [go] "i" (G_OFFSET), [bo] "i" (B_OFFSET)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+            }
+        }
+
+        __asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+        convolve_rows_c (rows, i, last);
+    }
+}
+
+#elif defined(GOOM_NEON)
+
+static const uint32_t convolve_lane_numbers[4] = { 0, 1, 2, 3 };
+
+static inline uint8x16_t convolve_lookup_neon (uint8x16_t table, uint8x16_t index)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8 (table, index);
+#else
+    uint8x8x2_t t;
+
+    t.val[0] = vget_low_u8 (table);
+    t.val[1] = vget_high_u8 (table);
+
+    return vcombine_u8 (vtbl2_u8 (t, vget_low_u8 (index)), vtbl2_u8 (t, vget_high_u8 (index)));
+#endif
+}
+
+/* the channel at offset of the pixels, lit by iff */
+static inline uint32x4_t convolve_channel_neon (uint32x4_t src, uint32x4_t iff, int offset)
+{
+    uint32x4_t byte = vdupq_n_u32 (0xff);
+    uint32x4_t ch = vandq_u32 (vshlq_u32 (src, vdupq_n_s32 (-offset)), byte);
+
+    ch = vminq_u32 (vshrq_n_u32 (vmulq_u32 (ch, iff), 8), byte);
+
+    return vshlq_u32 (ch, vdupq_n_s32 (offset));
+}
+
+void convolve_rows_neon (ConvolveRows *rows, int start, int end)
+{
+    ConvolveLanes lanes;
+    uint8_t bytes[4][16];
+    uint8x16_t planes[4];
+    uint32x4_t xmask = vdupq_n_u32 (CONV_MOTIF_WMASK);
+    uint32x4_t ymask = vdupq_n_u32 (CONV_MOTIF_WMASK * CONV_MOTIF_W);
+    uint32x4_t numbers = vld1q_u32 (convolve_lane_numbers);
+    uint32x4_t xstep = vdupq_n_u32 ((uint32_t) rows->c * 4);
+    uint32x4_t ystep = vdupq_n_u32 ((uint32_t) rows->s * 4);
+    int i, j, last;
+
+    for (j = 0; j < 16; j++) {
+        uint32_t iff = rows->ifftab[j];
+
+        bytes[0][j] = iff;
+        bytes[1][j] = iff >> 8;
+        bytes[2][j] = iff >> 16;
+        bytes[3][j] = iff >> 24;
+    }
+
+    for (j = 0; j < 4; j++)
+        planes[j] = vld1q_u8 (bytes[j]);
+
+    for (i = start; i < end; i = last) {
+        int y = i / rows->width;
+        uint32_t x = i - y * rows->width;
+        uint32x4_t xtex, ytex;
+
+        last = (y + 1) * rows->width;
+        if (last > end)
+            last = end;
+
+        xtex = vdupq_n_u32 (rows->xtex + (uint32_t) y * rows->s + x * rows->c);
+        ytex = vdupq_n_u32 (rows->ytex + (uint32_t) y * rows->c - x * rows->s);
+        xtex = vmlaq_n_u32 (xtex, numbers, rows->c);
+        ytex = vmlsq_n_u32 (ytex, numbers, rows->s);
+
+        for (; i + 16 <= last; i += 16) {
+            uint8x16x4_t iff;
+            uint8x16_t motif;
+
+            for (j = 0; j < 16; j += 4) {
+                vst1q_u32 (&lanes.pos[j], vorrq_u32 (vandq_u32 (vshrq_n_u32 (xtex, 16), xmask),
+                                                     vandq_u32 (vshrq_n_u32 (ytex, 9), ymask)));
+
+                xtex = vaddq_u32 (xtex, xstep);
+                ytex = vsubq_u32 (ytex, ystep);
+            }
+
+            for (j = 0; j < 16; j++)
+                lanes.motif[j] = rows->motif[lanes.pos[j]];
+
+            motif = vld1q_u8 (lanes.motif);
+
+            for (j = 0; j < 4; j++)
+                iff.val[j] = convolve_lookup_neon (planes[j], motif);
+
+            /* interleaves the planes back into 32 bits brightnesses */
+            vst4q_u8 ((uint8_t *) lanes.iff, iff);
+
+            for (j = 0; j < 16; j += 4) {
+                uint32x4_t src = vld1q_u32 ((const uint32_t *) (rows->src + i + j));
+                uint32x4_t f = vld1q_u32 (&lanes.iff[j]);
+                uint32x4_t res;
+
+                res = vorrq_u32 (convolve_channel_neon (src, f, R_OFFSET),
+                                 convolve_channel_neon (src, f, G_OFFSET));
+                res = vorrq_u32 (res, convolve_channel_neon (src, f, B_OFFSET));
+
+                vst1q_u32 ((uint32_t *) (rows->dest + i + j), res);
+            }
+        }
+
+        convolve_rows_c (rows, i, last);
+    }
+}
+
+#endif
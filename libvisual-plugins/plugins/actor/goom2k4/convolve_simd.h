@@ -0,0 +1,14 @@
+#ifndef _CONVOLVE_SIMD_H
+#define _CONVOLVE_SIMD_H
+
+#include "goom_graphic.h"
+#include "goom_typedefs.h"
+
+/* SSE4.1 and AVX2 versions, safe on x86 and x86-64, bit exact with convolve_rows_c */
+void convolve_rows_sse41 (ConvolveRows *rows, int start, int end);
+void convolve_rows_avx2 (ConvolveRows *rows, int start, int end);
+
+/* NEON version, for arm and arm64 with GOOM_NEON, bit exact with convolve_rows_c */
+void convolve_rows_neon (ConvolveRows *rows, int start, int end);
+
+#endif
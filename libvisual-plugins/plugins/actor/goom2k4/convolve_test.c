@@ -0,0 +1,231 @@
+/* convolve_test.c
+ * Equivalence test of the convolve fx brightness.
+ *
+ * Lights random screens through random motifs and brightness tables, at every
+ * angle of the convolve rotation and at screen sizes that leave every kind of
+ * row tail, then at random texture steps. Every screen is done by
+ * convolve_rows_c, the golden frame, and by each accelerated convolve the cpu
+ * has, split in bands on the VisJobs workers, then over a random range of
+ * pixels. The accelerated versions must be bit exact.
+ *
+ * usage: convolve_test [rounds [workers]]
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "goom_fx.h"
+#include "convolve_simd.h"
+
+#define NB_THETA 512
+
+typedef struct {
+    const char *name;
+    ConvolveRowsFunc func;
+    int enabled;
+    int failures;
+} ConvolveTestImpl;
+
+static ConvolveTestImpl impls[] = {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+    { "sse4.1", convolve_rows_sse41, 0, 0 },
+    { "avx2", convolve_rows_avx2, 0, 0 },
+#elif defined(GOOM_NEON)
+    { "neon", convolve_rows_neon, 0, 0 },
+#endif
+    { NULL, NULL, 0, 0 }
+};
+
+static const int sizes[][2] = {
+    { 1, 1 }, { 3, 2 }, { 15, 7 }, { 16, 16 }, { 17, 5 }, { 31, 3 }, { 33, 9 },
+    { 64, 3 }, { 100, 75 }, { 320, 240 }, { 641, 11 },
+    /* bands of 32 rows, the last one shorter */
+    { 1000, 131 }
+};
+
+static int screens = 0;
+static unsigned char motif[CONV_MOTIF_W * CONV_MOTIF_W];
+
+static guint32 convolve_test_random (void)
+{
+    return ((guint32) rand () << 16) ^ (guint32) rand ();
+}
+
+/* a brightness table like the ones of convolve_fx, sometimes a random one */
+static void convolve_test_ifftab (ConvolveRows *rows)
+{
+    int iff = rand () % 1600;
+    double visibility = (rand () % 1000) / 200.0;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        if (screens % 7 == 6)
+            rows->ifftab[i] = convolve_test_random ();
+        else if (screens % 2)
+            rows->ifftab[i] = (double) iff * (1.0 + visibility * (15.0 - i) / 15.0);
+        else
+            rows->ifftab[i] = (double) iff / (1.0 + visibility * (15.0 - i) / 15.0);
+    }
+}
+
+/* the rotation of convolve_fx at an angle */
+static void convolve_test_angle (ConvolveRows *rows, int width, int height, int theta)
+{
+    double screen_coef = 2.0 * 300.0 / (double) height;
+    double radian = 2 * theta * M_PI / NB_THETA;
+    double h = (0.2 + cos (radian) / 15.0 * sin (radian * 2.0 + 12.123)) * screen_coef;
+    int c = 0x10000 * (-h * cos (radian) * cos (radian));
+    int s = 0x10000 * (h * sin (radian + 1.57) * sin (radian));
+
+    rows->c = c;
+    rows->s = s;
+    rows->xtex = (unsigned int) (-(height / 2) * s) - (width / 2) * c + CONV_MOTIF_W * 0x10000 / 2 + c;
+    rows->ytex = (unsigned int) (-(height / 2) * c) + (width / 2) * s + CONV_MOTIF_W * 0x10000 / 2 - s;
+}
+
+/* the pixels of a range must be the golden ones, the others must be untouched */
+static int convolve_test_range (Pixel *dest, Pixel *golden, int start, int end, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++) {
+        if (i >= start && i < end ? dest[i].val != golden[i].val : dest[i].val != 0xa5a5a5a5)
+            return 0;
+    }
+
+    return 1;
+}
+
+static void convolve_test_screen (ConvolveRows *rows, int height, Pixel *golden)
+{
+    int size = rows->width * height;
+    ConvolveTestImpl *impl;
+    int start, end;
+
+    convolve_test_ifftab (rows);
+
+    rows->dest = golden;
+    convolve_rows_c (rows, 0, size);
+
+    start = rand () % size;
+    end = start + rand () % (size - start + 1);
+
+    rows->dest = (Pixel *) rows->src + size;
+
+    for (impl = impls; impl->name != NULL; impl++) {
+        int same;
+
+        if (!impl->enabled)
+            continue;
+
+        /* the whole screen in bands, then a range that starts and ends anywhere */
+        memset (rows->dest, 0xa5, size * sizeof (Pixel));
+        rows->func = impl->func;
+        convolve_filter_rows (rows, height);
+        same = convolve_test_range (rows->dest, golden, 0, size, size);
+
+        memset (rows->dest, 0xa5, size * sizeof (Pixel));
+        impl->func (rows, start, end);
+        same = same && convolve_test_range (rows->dest, golden, start, end, size);
+
+        if (!same && impl->failures++ == 0)
+            fprintf (stderr, "convolve_test: %s differs from c on screen %d, %dx%d, step (%d, %d)\n",
+                     impl->name, screens, rows->width, height, rows->c, rows->s);
+    }
+
+    screens++;
+}
+
+int main (int argc, char **argv)
+{
+    ConvolveRows rows;
+    Pixel *pixels, *golden;
+    int rounds = 8;
+    int max_size = 0;
+    int round, size, theta, i;
+    int failed = 0;
+    ConvolveTestImpl *impl;
+
+    visual_init (&argc, &argv);
+
+    if (argc > 1)
+        rounds = atoi (argv[1]);
+
+    if (argc > 2 && visual_jobs_set_worker_count (atoi (argv[2])) != VISUAL_OK) {
+        fprintf (stderr, "convolve_test: can't use %s workers\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    for (impl = impls; impl->name != NULL; impl++) {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+        if (impl->func == convolve_rows_sse41)
+            impl->enabled = visual_cpu_get_ssse3 () && visual_cpu_get_sse41 ();
+        else if (impl->func == convolve_rows_avx2)
+            impl->enabled = visual_cpu_get_avx2 ();
+#elif defined(GOOM_NEON)
+        impl->enabled = visual_cpu_get_neon ();
+#endif
+    }
+
+    for (size = 0; size < (int) (sizeof (sizes) / sizeof (sizes[0])); size++) {
+        if (sizes[size][0] * sizes[size][1] > max_size)
+            max_size = sizes[size][0] * sizes[size][1];
+    }
+
+    /* the source, then the screen of the accelerated version */
+    pixels = malloc (max_size * 2 * sizeof (Pixel));
+    golden = malloc (max_size * sizeof (Pixel));
+
+    srand (1234);
+
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < CONV_MOTIF_W * CONV_MOTIF_W; i++)
+            motif[i] = rand () % 16;
+
+        for (size = 0; size < (int) (sizeof (sizes) / sizeof (sizes[0])); size++) {
+            int width = sizes[size][0];
+            int height = sizes[size][1];
+
+            for (i = 0; i < width * height; i++)
+                pixels[i].val = convolve_test_random ();
+
+            rows.src = pixels;
+            rows.width = width;
+            rows.motif = motif;
+
+            for (theta = round; theta < NB_THETA; theta += 8) {
+                convolve_test_angle (&rows, width, height, theta);
+                convolve_test_screen (&rows, height, golden);
+            }
+
+            for (i = 0; i < 16; i++) {
+                rows.c = convolve_test_random ();
+                rows.s = convolve_test_random ();
+                rows.xtex = convolve_test_random ();
+                rows.ytex = convolve_test_random ();
+                convolve_test_screen (&rows, height, golden);
+            }
+        }
+    }
+
+    for (impl = impls; impl->name != NULL; impl++) {
+        if (!impl->enabled) {
+            printf ("convolve_test: %s skipped\n", impl->name);
+            continue;
+        }
+
+        printf ("convolve_test: %s %d of %d screens differ\n", impl->name, impl->failures, screens);
+
+        if (impl->failures > 0)
+            failed = 1;
+    }
+
+    free (golden);
+    free (pixels);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
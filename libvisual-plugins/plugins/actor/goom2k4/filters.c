@@ -85,12 +85,12 @@ static inline void getPixelRGB_ (Pixel *buffer, Uint x, Color * c)
 /* faire : a / sqrtperte <=> a >> PERTEDEC */
 #define PERTEDEC 4
 
-/* pure c version of the zoom filter */
-static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned int prevY, signed int *brutS, signed int *brutD, int buffratio, int precalCoef[BUFFPOINTNB][BUFFPOINTNB]);
+/* below this many pixels a band costs more to hand out than it saves */
+#define ZOOM_BAND_PIXELS (32 * 1024)
 
 /* simple wrapper to give it the same proto than the others */
 void zoom_filter_c (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]) {
-    c_zoom(src, dest, sizeX, sizeY, brutS, brutD, buffratio, precalCoef);
+    zoom_filter_rows(sizeX, sizeY, src, dest, brutS, brutD, buffratio, precalCoef, zoom_rows_c);
 }
 
 static void generatePrecalCoef (int precalCoef[BUFFPOINTNB][BUFFPOINTNB]);
@@ -99,6 +99,7 @@ static void generatePrecalCoef (int precalCoef[BUFFPOINTNB][BUFFPOINTNB]);
 typedef struct _ZOOM_FILTER_FX_WRAPPER_DATA {
     
     PluginParam enabled_bp;
+    PluginParam interlaced_bp;
     PluginParameters params;
     
     unsigned int *coeffs, *freecoeffs;
@@ -107,6 +108,8 @@ typedef struct _ZOOM_FILTER_FX_WRAPPER_DATA {
     signed int *brutD, *freebrutD; /* dest */
     signed int *brutT, *freebrutT; /* temp (en cours de generation) */
     
+    float *zoomColumns; /* X and vertical deviation of every column of brutT */
+    
     guint32 zoom_width;
     
     unsigned int prevX, prevY;
@@ -140,96 +143,130 @@ typedef struct _ZOOM_FILTER_FX_WRAPPER_DATA {
 
 
 
-static inline v2g zoomVector(ZoomFilterFXWrapperData *data, float X, float Y)
+/* the noise of the zoom vectors, every band has its own generator */
+static inline float zoomNoise(unsigned int *seed)
 {
-    v2g vecteur;
-    float vx, vy;
-    float sq_dist = X*X + Y*Y;
-    
-    /*    sx = (X < 0.0f) ? -1.0f : 1.0f;
-    sy = (Y < 0.0f) ? -1.0f : 1.0f;
-    */  
-    float coefVitesse = (1.0f+ data->general_speed) / 50.0f;
-    
-    // Effects
+    *seed = *seed * 1664525 + 1013904223;
+    return ((float)(*seed >> 8) / 16777216.0f - 0.5f) / 50.0f;
+}
+
+
+/* pure c version of the zoom vectors, for the columns [start, end) of a row */
+void zoom_vectors_c (ZoomVectors *v, int start, int end)
+{
+    int x;
     
-    /* Centralized FX */
+    for (x = start; x < end; x++)
+    {
+        float X = ZOOM_COLUMN_X(v->columns, x);
+        float sq_dist = X*X + v->Y*v->Y;
+        float coefVitesse, vx, vy;
+        
+        /* Centralized FX */
+        coefVitesse = v->speed + ((sq_dist - v->sub) / v->div) * v->mul;
+        coefVitesse += ZOOM_PIXEL_WAVE(v->pixels, x);
+        coefVitesse *= v->scale;
+        
+        if (coefVitesse < -2.01f)
+            coefVitesse = -2.01f;
+        if (coefVitesse > 2.01f)
+            coefVitesse = 2.01f;
+        
+        /* Noise, then Hypercos and the planes */
+        vx = coefVitesse * X + ZOOM_PIXEL_NOISEX(v->pixels, x) + v->addX;
+        vy = coefVitesse * v->Y + ZOOM_PIXEL_NOISEY(v->pixels, x) + ZOOM_COLUMN_ADDY(v->columns, x);
+        
+        /* Finish and avoid null displacement */
+        if (fabsf(vx) < v->min) vx = (vx < 0.0f) ? -v->min : v->min;
+        if (fabsf(vy) < v->min) vy = (vy < 0.0f) ? -v->min : v->min;
+        
+        v->brut[x*2] = (int)((X-vx)*v->inv_ratio) + v->middleX;
+        v->brut[x*2+1] = (int)((v->Y-vy)*v->inv_ratio) + v->middleY;
+    }
+}
+
+
+typedef struct {
+    ZoomFilterFXWrapperData *data;
+    ZoomVectorsFunc func;
+    float ratio;
+    unsigned int seed;
+} ZoomStripe;
+
+/*
+ * Makes the rows [start, end) of the transform buffer (brutT)
+ *
+ * Every row only depends on its Y, so the rows of a stripe are made in bands.
+ */
+static void makeZoomBufferBand(void *priv, int start, int end)
+{
+    ZoomStripe *stripe = (ZoomStripe*)priv;
+    ZoomFilterFXWrapperData *data = stripe->data;
+    ZoomVectors v;
+    // Wave and noise of every pixel of the row
+    float *pixels = (float *) calloc (ZOOM_COLUMNS_SIZE(data->prevX) * 3, sizeof(float));
+    unsigned int seed = stripe->seed + start * 2654435761U;
+    Uint x;
+    int y;
+    
+    v.columns = data->zoomColumns;
+    v.pixels = pixels;
+    v.speed = (1.0f + data->general_speed) / 50.0f;
+    v.sub = 0.0f;
+    v.div = 1.0f;
+    v.mul = 0.0f;
+    v.min = stripe->ratio/BUFFPOINTNBF;
+    v.inv_ratio = BUFFPOINTNBF/stripe->ratio;
+    v.middleX = (int)(data->middleX*BUFFPOINTNB);
+    v.middleY = (int)(data->middleY*BUFFPOINTNB);
     
     switch (data->theMode) {
         case CRYSTAL_BALL_MODE:
-            coefVitesse -= (sq_dist-0.3f)/15.0f;
+            v.sub = 0.3f;
+            v.div = 15.0f;
+            v.mul = -1.0f;
             break;
         case AMULETTE_MODE:
-            coefVitesse += sq_dist * 3.5f;
-            break;
-        case WAVE_MODE:
-            coefVitesse += sin(sq_dist*20.0f) / 100.0f;
+            v.mul = 3.5f;
             break;
         case SCRUNCH_MODE:
-            coefVitesse += sq_dist / 10.0f;
-            break;
-            //case HYPERCOS1_MODE:
-            break;
-            //case HYPERCOS2_MODE:
-            break;
-            //case YONLY_MODE:
-            break;
-        case SPEEDWAY_MODE:
-            coefVitesse *= 4.0f * Y;
+            v.div = 10.0f;
+            v.mul = 1.0f;
             break;
         default:
             break;
     }
     
-    if (coefVitesse < -2.01f)
-        coefVitesse = -2.01f;
-    if (coefVitesse > 2.01f)
-        coefVitesse = 2.01f;
-    
-    vx = coefVitesse * X;
-    vy = coefVitesse * Y;
-    
-    /* Amulette 2 */
-    // vx = X * tan(dist);
-    // vy = Y * tan(dist);
-    
-    /* Rotate */
-    //vx = (X+Y)*0.1;
-    //vy = (Y-X)*0.1;
-    
-    
-    // Effects adds-on
-    
-    /* Noise */
-    if (data->noisify)
-    {
-        vx += (((float)random()) / ((float)RAND_MAX) - 0.5f) / 50.0f;
-        vy += (((float)random()) / ((float)RAND_MAX) - 0.5f) / 50.0f;
-    }
-    
-    /* Hypercos */
-    if (data->hypercosEffect)
-    {
-        vx += sin(Y*10.0f)/120.0f;
-        vy += sin(X*10.0f)/120.0f;
+    for (y = start; y < end; y++) {
+        float Y = ((float)(y - data->middleY)) * stripe->ratio;
+        
+        v.Y = Y;
+        v.scale = (data->theMode == SPEEDWAY_MODE) ? 4.0f * Y : 1.0f;
+        v.addX = 0.0f;
+        if (data->hypercosEffect) v.addX += sin(Y*10.0f)/120.0f;
+        if (data->hPlaneEffect) v.addX += Y * 0.0025f * data->hPlaneEffect;
+        v.brut = data->brutT + y * data->prevX * 2;
+        
+        if (data->theMode == WAVE_MODE) {
+            for (x = 0; x < data->prevX; x++) {
+                float X = ZOOM_COLUMN_X(data->zoomColumns, x);
+                ZOOM_PIXEL_WAVE(pixels, x) = sin((X*X + Y*Y)*20.0f) / 100.0f;
+            }
+        }
+        
+        if (data->noisify) {
+            for (x = 0; x < data->prevX; x++) {
+                ZOOM_PIXEL_NOISEX(pixels, x) = zoomNoise(&seed);
+                ZOOM_PIXEL_NOISEY(pixels, x) = zoomNoise(&seed);
+            }
+        }
+        
+        stripe->func (&v, 0, data->prevX);
     }
     
-    /* H Plane */
-    if (data->hPlaneEffect) vx += Y * 0.0025f * data->hPlaneEffect;
-    
-    /* V Plane */
-    if (data->vPlaneEffect) vy += X * 0.0025f * data->vPlaneEffect;
-    
-    /* TODO : Water Mode */
-    //    if (data->waveEffect)
-
-    vecteur.x = vx;
-    vecteur.y = vy;
-    
-    return vecteur;
+    free (pixels);
 }
 
-
 /*
  * Makes a stripe of a transform buffer (brutT)
  *
@@ -237,44 +274,44 @@ static inline v2g zoomVector(ZoomFilterFXWrapperData *data, float X, float Y)
  * Translation (-data->middleX, -data->middleY)
  * Homothetie (Center : 0,0   Coeff : 2/data->prevX)
  */
-static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_INCR)
+static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, ZoomVectorsFunc func, int INTERLACE_INCR)
 {
+    ZoomStripe stripe;
     // Position of the pixel to compute in pixmap coordinates
-    Uint x, y;
+    Uint x;
     // Where (verticaly) to stop generating the buffer stripe
-    int maxEnd = (data->interlace_start + INTERLACE_INCR);
+    int maxEnd;
     // Ratio from pixmap to normalized coordinates
     float ratio = 2.0f/((float)data->prevX);
-    // Ratio from normalized to virtual pixmap coordinates
-    float inv_ratio = BUFFPOINTNBF/ratio;
-    float min = ratio/BUFFPOINTNBF;
-    // Y position of the pixel to compute in normalized coordinates
-    float Y = ((float)(data->interlace_start - data->middleY)) * ratio;
+    // X position of the pixel to compute in normalized coordinates
+    float X = - ((float)data->middleX) * ratio;
+    int grain = ZOOM_BAND_PIXELS / data->prevX;
     
     maxEnd = data->prevY;
     if (maxEnd > (data->interlace_start + INTERLACE_INCR))
         maxEnd = (data->interlace_start + INTERLACE_INCR);
     
-    for (y = data->interlace_start; (y < data->prevY) && ((signed int)y<maxEnd); y++) {
-        Uint premul_y_prevX = y * data->prevX * 2;
-        float X = - ((float)data->middleX) * ratio;
-        for (x = 0; x < data->prevX; x++)
-        {
-            v2g vector = zoomVector (data, X, Y);
-            
-            /* Finish and avoid null displacement */
-            if (fabs(vector.x) < min) vector.x = (vector.x < 0.0f) ? -min : min;
-            if (fabs(vector.y) < min) vector.y = (vector.y < 0.0f) ? -min : min;
-            
-            data->brutT[premul_y_prevX] = ((int)((X-vector.x)*inv_ratio)+((int)(data->middleX*BUFFPOINTNB)));
-            data->brutT[premul_y_prevX+1] = ((int)((Y-vector.y)*inv_ratio)+((int)(data->middleY*BUFFPOINTNB)));
-            premul_y_prevX += 2;
-            X += ratio;
-        }
-        Y += ratio;
+    /* the columns only change with the middle and the effects */
+    for (x = 0; x < data->prevX; x++) {
+        float addY = 0.0f;
+        
+        if (data->hypercosEffect) addY += sin(X*10.0f)/120.0f;
+        if (data->vPlaneEffect) addY += X * 0.0025f * data->vPlaneEffect;
+        
+        ZOOM_COLUMN_X(data->zoomColumns, x) = X;
+        ZOOM_COLUMN_ADDY(data->zoomColumns, x) = addY;
+        X += ratio;
     }
+    
+    stripe.data = data;
+    stripe.func = func;
+    stripe.ratio = ratio;
+    stripe.seed = data->noisify ? random() : 0;
+    
+    visual_jobs_parallel_for (data->interlace_start, maxEnd, grain > 0 ? grain : 1, makeZoomBufferBand, &stripe);
+    
     data->interlace_start += INTERLACE_INCR;
-    if (y >= data->prevY-1) data->interlace_start = -1;
+    if (maxEnd >= (signed int)data->prevY-1) data->interlace_start = -1;
 }
 
 
@@ -402,20 +439,56 @@ static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_I
 
 
 
-static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned int prevY, signed int *brutS, signed int *brutD,
-                    int buffratio, int precalCoef[16][16])
+static void zoom_filter_band (void *priv, int start, int end)
+{
+    ZoomRows *rows = (ZoomRows *) priv;
+    
+    rows->func (rows, start * rows->prevX, end * rows->prevX);
+}
+
+/*
+ * Runs a zoom filter row kernel over the whole screen, split in bands of rows.
+ * Every pixel only reads src and the transform buffers, so the bands are independant.
+ */
+void zoom_filter_rows (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio,
+                       int precalCoef[16][16], ZoomRowsFunc func)
+{
+    ZoomRows rows;
+    int grain = ZOOM_BAND_PIXELS / sizeX;
+    
+    src[0].val = src[sizeX-1].val = src[sizeX*sizeY-1].val = src[sizeX*sizeY-sizeX].val = 0;
+    
+    rows.src = src;
+    rows.dest = dest;
+    rows.brutS = brutS;
+    rows.brutD = brutD;
+    rows.prevX = sizeX;
+    rows.prevY = sizeY;
+    rows.buffratio = buffratio;
+    rows.precalCoef = precalCoef;
+    rows.func = func;
+    
+    visual_jobs_parallel_for (0, sizeY, grain > 0 ? grain : 1, zoom_filter_band, &rows);
+}
+
+/* pure c version of the zoom filter, for the pixels [start, end) */
+void zoom_rows_c (ZoomRows *rows, int start, int end)
 {
     int     myPos, myPos2;
     Color   couleur;
     
-    unsigned int ax = (prevX - 1) << PERTEDEC, ay = (prevY - 1) << PERTEDEC;
+    Pixel  *expix1 = rows->src;
+    Pixel  *expix2 = rows->dest;
+    signed int *brutS = rows->brutS;
+    signed int *brutD = rows->brutD;
+    int     buffratio = rows->buffratio;
+    unsigned int prevX = rows->prevX;
     
-    int     bufsize = prevX * prevY * 2;
-    int     bufwidth = prevX;
+    unsigned int ax = (prevX - 1) << PERTEDEC, ay = (rows->prevY - 1) << PERTEDEC;
     
-    expix1[0].val=expix1[prevX-1].val=expix1[prevX*prevY-1].val=expix1[prevX*prevY-prevX].val=0;
+    int     bufwidth = prevX;
     
-    for (myPos = 0; myPos < bufsize; myPos += 2) {
+    for (myPos = start * 2; myPos < end * 2; myPos += 2) {
         Color   col1, col2, col3, col4;
         int     c1, c2, c3, c4, px, py;
         int     pos;
@@ -434,7 +507,7 @@ static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned i
         } else {
             pos = ((px >> PERTEDEC) + prevX * (py >> PERTEDEC));
             /* coef en modulo 15 */
-            coeffs = precalCoef[px & PERTEMASK][py & PERTEMASK];
+            coeffs = rows->precalCoef[px & PERTEMASK][py & PERTEMASK];
         }
         getPixelRGB_ (expix1, pos, &col1);
         getPixelRGB_ (expix1, pos + 1, &col2);
@@ -543,6 +616,9 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
         if (data->brutT) free (data->freebrutT);
         data->brutT = 0;
         
+        if (data->zoomColumns) free (data->zoomColumns);
+        data->zoomColumns = 0;
+        
         data->middleX = resx / 2;
         data->middleY = resy / 2;
         data->mustInitBuffers = 1;
@@ -582,13 +658,15 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
         data->freebrutT = (signed int *) calloc (resx * resy * 2 + 128, sizeof(unsigned int));
         data->brutT = (gint32 *) ((1 + ((uintptr_t) (data->freebrutT)) / 128) * 128);
         
+        data->zoomColumns = (float *) calloc (ZOOM_COLUMNS_SIZE(resx) * 2, sizeof(float));
+        
         data->buffratio = 0;
         
         data->firedec = (int *) malloc (data->prevY * sizeof (int));
         generateTheWaterFXHorizontalDirectionBuffer(goomInfo, data);
         
         data->interlace_start = 0;
-        makeZoomBufferStripe(data,resy);
+        makeZoomBufferStripe(data,goomInfo->methods.zoom_vectors,resy);
         
         /* Copy the data from temp to dest and source */
         visual_mem_copy(data->brutS,data->brutT,resx * resy * 2 * sizeof(int));
@@ -625,8 +703,9 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
     
     if (data->interlace_start>=0)
     {
-        /* creation de la nouvelle destination */
-        makeZoomBufferStripe(data,resy/16);
+        /* creation de la nouvelle destination, d'un coup ou en 16 bandes */
+        makeZoomBufferStripe(data,goomInfo->methods.zoom_vectors,
+                             BVAL(data->interlaced_bp) ? resy/16 : resy);
     }
     
     if (switchIncr != 0) {
@@ -698,6 +777,7 @@ static void zoomFilterVisualFXWrapper_init (struct _VISUAL_FX *_this, PluginInfo
     data->freebrutD = 0;
     data->brutT = 0;
     data->freebrutT = 0;
+    data->zoomColumns = 0;
     data->prevX = 0;
     data->prevY = 0;
     
@@ -721,8 +801,12 @@ static void zoomFilterVisualFXWrapper_init (struct _VISUAL_FX *_this, PluginInfo
     
     data->enabled_bp = secure_b_param("Enabled", 1);
     
-    data->params = plugin_parameters ("Zoom Filter", 1);
+    /* without workers a whole transform buffer in one frame is a spike, spread it over 16 */
+    data->interlaced_bp = secure_b_param("Interlaced", visual_jobs_get_worker_count () == 0);
+    
+    data->params = plugin_parameters ("Zoom Filter", 2);
     data->params.params[0] = &data->enabled_bp;
+    data->params.params[1] = &data->interlaced_bp;
     
     _this->params = &data->params;
     _this->fx_data = (void*)data;
@@ -733,6 +817,9 @@ static void zoomFilterVisualFXWrapper_init (struct _VISUAL_FX *_this, PluginInfo
 
 static void zoomFilterVisualFXWrapper_free (struct _VISUAL_FX *_this)
 {
+    ZoomFilterFXWrapperData *data = (ZoomFilterFXWrapperData*)_this->fx_data;
+    
+    if (data->zoomColumns) free (data->zoomColumns);
     free(_this->fx_data);
 }
 
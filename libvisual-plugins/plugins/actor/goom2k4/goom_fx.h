@@ -1,12 +1,96 @@
 #ifndef _GOOM_FX_H
 #define _GOOM_FX_H
 
+#include <libvisual/libvisual.h>
+
 #include "goom_visual_fx.h"
 #include "goom_plugin_info.h"
 
+/* The NEON kernels have not been run on an ARM cpu yet, only read back from
+ * the disassembly. They are left out unless GOOM_ENABLE_NEON is defined, which
+ * the ENABLE_GOOM2K4_NEON build option does, until zoom_test passes there. */
+#if defined(GOOM_ENABLE_NEON) && defined(VISUAL_ARCH_ARM) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define GOOM_NEON
+#endif
+
 VisualFX convolve_create ();
 VisualFX flying_star_create (void);
 
+typedef struct _ZOOM_ROWS ZoomRows;
+
+/* computes the pixels [start, end) of a zoom, start and end being pixel indices */
+typedef void (*ZoomRowsFunc) (ZoomRows *rows, int start, int end);
+
+/* arguments of a zoom filter, shared between the bands */
+struct _ZOOM_ROWS {
+    Pixel *src;
+    Pixel *dest;
+    int *brutS;
+    int *brutD;
+    int prevX;
+    int prevY;
+    int buffratio;
+    int (*precalCoef)[16];
+    ZoomRowsFunc func;
+};
+
+/* the columns of a row of zoom vectors are laid out in groups of 4, to be loaded in vectors */
+#define ZOOM_COLUMNS_SIZE(width) (((width) + 3) & ~3)
+#define ZOOM_COLUMN_X(columns, x) ((columns)[((x) & ~3) * 2 + ((x) & 3)])
+#define ZOOM_COLUMN_ADDY(columns, x) ((columns)[((x) & ~3) * 2 + 4 + ((x) & 3)])
+#define ZOOM_PIXEL_WAVE(pixels, x) ((pixels)[((x) & ~3) * 3 + ((x) & 3)])
+#define ZOOM_PIXEL_NOISEX(pixels, x) ((pixels)[((x) & ~3) * 3 + 4 + ((x) & 3)])
+#define ZOOM_PIXEL_NOISEY(pixels, x) ((pixels)[((x) & ~3) * 3 + 8 + ((x) & 3)])
+
+/* computes the columns [start, end) of a row of the zoom transform buffer */
+typedef void (*ZoomVectorsFunc) (ZoomVectors *vectors, int start, int end);
+
+/* a row of zoom vectors, in normalized coordinates, the mode adds
+ * ((X*X + Y*Y - sub) / div) * mul and the wave to the speed, then scales it */
+struct _ZOOM_VECTORS {
+    const float *columns;   /* X and vertical deviation of every column */
+    const float *pixels;    /* wave and noise of every pixel */
+    int *brut;
+    float Y;
+    float addX;             /* horizontal deviation of the row */
+    float speed;
+    float sub, div, mul;
+    float scale;
+    float min;              /* smallest displacement */
+    float inv_ratio;        /* from normalized to virtual pixmap coordinates */
+    int middleX, middleY;   /* in virtual pixmap coordinates */
+};
+
+void zoom_vectors_c(ZoomVectors *v, int start, int end);
+
 void zoom_filter_c(int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
 
+/* splits a zoom in bands of rows that are run by func on the VisJobs workers */
+void zoom_filter_rows(int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio,
+                      int precalCoef[16][16], ZoomRowsFunc func);
+void zoom_rows_c(ZoomRows *rows, int start, int end);
+
+#define CONV_MOTIF_W 128
+#define CONV_MOTIF_WMASK 0x7f
+
+/* computes the pixels [start, end) of a convolve, start and end being pixel indices */
+typedef void (*ConvolveRowsFunc) (ConvolveRows *rows, int start, int end);
+
+/* the rotated motif of the convolve fx, every pixel is multiplied by the
+ * brightness of the motif texel under it, texture coordinates are in 16.16 */
+struct _CONVOLVE_ROWS {
+    const Pixel *src;
+    Pixel *dest;
+    int width;
+    int c, s;                   /* texture step along a row is (c, -s), from a row to the next (s, c) */
+    unsigned int xtex, ytex;    /* texture coordinates of the first pixel */
+    const unsigned char *motif; /* CONV_MOTIF_W rows of CONV_MOTIF_W brightness indices, from 0 to 15 */
+    int ifftab[16];             /* brightness of every index, 256 keeps the pixel as it is */
+    ConvolveRowsFunc func;
+};
+
+/* splits a convolve in bands of rows that are run by rows->func on the VisJobs workers */
+void convolve_filter_rows(ConvolveRows *rows, int height);
+void convolve_rows_c(ConvolveRows *rows, int start, int end);
+
 #endif
@@ -159,6 +159,8 @@ struct _PLUGIN_INFO {
 	struct {
 		void (*draw_line) (Pixel *data, int x1, int y1, int x2, int y2, int col, int screenx, int screeny);
 		void (*zoom_filter) (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+		void (*zoom_vectors) (ZoomVectors *vectors, int start, int end);
+		void (*convolve_rows) (ConvolveRows *rows, int start, int end);
 	} methods;
 	
 	GoomRandom *gRandom;
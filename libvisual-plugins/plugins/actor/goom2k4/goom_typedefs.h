@@ -6,6 +6,8 @@ typedef struct _SOUND_INFO SoundInfo;
 typedef struct _GMLINE GMLine;
 typedef struct _GMUNITPOINTER GMUnitPointer;
 typedef struct _ZOOM_FILTER_DATA ZoomFilterData;
+typedef struct _ZOOM_VECTORS ZoomVectors;
+typedef struct _CONVOLVE_ROWS ConvolveRows;
 typedef struct _VISUAL_FX VisualFX;
 
 #endif
@@ -8,6 +8,12 @@
 
 /*#define TRACE_SCRIPT*/
 
+/* with gcc and clang, the interpreter jumps from instruction to instruction
+ * through computed gotos instead of going back to a switch. */
+#ifdef __GNUC__
+#define THREADED_CODE
+#endif
+
  /* {{{ definition of the instructions number */
 #define INSTR_SETI_VAR_INTEGER     1
 #define INSTR_SETI_VAR_VAR         2
@@ -452,6 +458,7 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
   FastInstruction *instr = _this->instr;
   int stack[0x10000];
   int stack_pointer = 0;
+  int i;
 
   stack[stack_pointer++] = -1;
 
@@ -488,202 +495,277 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
   ((float*)((char*)pSRC_VAR  + gsl->gsl_struct[SRC_STRUCT_ID]->fBlock[i].data))[j]
 #define DEST_STRUCT_SIZE      gsl->gsl_struct[DEST_STRUCT_ID]->size
 
+#ifdef THREADED_CODE
+#define INSTR(id) L_##id
+#ifdef TRACE_SCRIPT
+#define DISPATCH \
+  do { printf("execute "); gsl_instr_display(instr[ip].proto); printf("\n"); goto *instr[ip].code; } while (0)
+#else
+#define DISPATCH goto *instr[ip].code
+#endif
+#else
+#define INSTR(id) case id
+#define DISPATCH break
+#endif
+
+#ifdef THREADED_CODE
+  /* the code of every instruction jumps straight to the code of the next one */
+  if (!_this->threaded) {
+    static const void *const code[] = {
+      [INSTR_SETI_VAR_INTEGER] = &&L_INSTR_SETI_VAR_INTEGER,
+      [INSTR_SETI_VAR_VAR] = &&L_INSTR_SETI_VAR_VAR,
+      [INSTR_SETF_VAR_FLOAT] = &&L_INSTR_SETF_VAR_FLOAT,
+      [INSTR_SETF_VAR_VAR] = &&L_INSTR_SETF_VAR_VAR,
+      [INSTR_SETP_VAR_VAR] = &&L_INSTR_SETP_VAR_VAR,
+      [INSTR_SETP_VAR_PTR] = &&L_INSTR_SETP_VAR_PTR,
+      [INSTR_JUMP] = &&L_INSTR_JUMP,
+      [INSTR_JZERO] = &&L_INSTR_JZERO,
+      [INSTR_NOP] = &&L_INSTR_NOP,
+      [INSTR_ISEQUALP_VAR_VAR] = &&L_INSTR_ISEQUALP_VAR_VAR,
+      [INSTR_ISEQUALP_VAR_PTR] = &&L_INSTR_ISEQUALP_VAR_PTR,
+      [INSTR_ISEQUALI_VAR_VAR] = &&L_INSTR_ISEQUALI_VAR_VAR,
+      [INSTR_ISEQUALI_VAR_INTEGER] = &&L_INSTR_ISEQUALI_VAR_INTEGER,
+      [INSTR_ISEQUALF_VAR_VAR] = &&L_INSTR_ISEQUALF_VAR_VAR,
+      [INSTR_ISEQUALF_VAR_FLOAT] = &&L_INSTR_ISEQUALF_VAR_FLOAT,
+      [INSTR_ISLOWERI_VAR_VAR] = &&L_INSTR_ISLOWERI_VAR_VAR,
+      [INSTR_ISLOWERI_VAR_INTEGER] = &&L_INSTR_ISLOWERI_VAR_INTEGER,
+      [INSTR_ISLOWERF_VAR_VAR] = &&L_INSTR_ISLOWERF_VAR_VAR,
+      [INSTR_ISLOWERF_VAR_FLOAT] = &&L_INSTR_ISLOWERF_VAR_FLOAT,
+      [INSTR_ADDI_VAR_VAR] = &&L_INSTR_ADDI_VAR_VAR,
+      [INSTR_ADDI_VAR_INTEGER] = &&L_INSTR_ADDI_VAR_INTEGER,
+      [INSTR_ADDF_VAR_VAR] = &&L_INSTR_ADDF_VAR_VAR,
+      [INSTR_ADDF_VAR_FLOAT] = &&L_INSTR_ADDF_VAR_FLOAT,
+      [INSTR_MULI_VAR_VAR] = &&L_INSTR_MULI_VAR_VAR,
+      [INSTR_MULI_VAR_INTEGER] = &&L_INSTR_MULI_VAR_INTEGER,
+      [INSTR_MULF_VAR_FLOAT] = &&L_INSTR_MULF_VAR_FLOAT,
+      [INSTR_MULF_VAR_VAR] = &&L_INSTR_MULF_VAR_VAR,
+      [INSTR_DIVI_VAR_VAR] = &&L_INSTR_DIVI_VAR_VAR,
+      [INSTR_DIVI_VAR_INTEGER] = &&L_INSTR_DIVI_VAR_INTEGER,
+      [INSTR_DIVF_VAR_FLOAT] = &&L_INSTR_DIVF_VAR_FLOAT,
+      [INSTR_DIVF_VAR_VAR] = &&L_INSTR_DIVF_VAR_VAR,
+      [INSTR_SUBI_VAR_VAR] = &&L_INSTR_SUBI_VAR_VAR,
+      [INSTR_SUBI_VAR_INTEGER] = &&L_INSTR_SUBI_VAR_INTEGER,
+      [INSTR_SUBF_VAR_FLOAT] = &&L_INSTR_SUBF_VAR_FLOAT,
+      [INSTR_SUBF_VAR_VAR] = &&L_INSTR_SUBF_VAR_VAR,
+      [INSTR_CALL] = &&L_INSTR_CALL,
+      [INSTR_RET] = &&L_INSTR_RET,
+      [INSTR_EXT_CALL] = &&L_INSTR_EXT_CALL,
+      [INSTR_NOT_VAR] = &&L_INSTR_NOT_VAR,
+      [INSTR_JNZERO] = &&L_INSTR_JNZERO,
+      [INSTR_SETS_VAR_VAR] = &&L_INSTR_SETS_VAR_VAR,
+      [INSTR_ISEQUALS_VAR_VAR] = &&L_INSTR_ISEQUALS_VAR_VAR,
+      [INSTR_ADDS_VAR_VAR] = &&L_INSTR_ADDS_VAR_VAR,
+      [INSTR_SUBS_VAR_VAR] = &&L_INSTR_SUBS_VAR_VAR,
+      [INSTR_MULS_VAR_VAR] = &&L_INSTR_MULS_VAR_VAR,
+      [INSTR_DIVS_VAR_VAR] = &&L_INSTR_DIVS_VAR_VAR,
+    };
+    for (i = 0; i < _this->number; ++i) {
+      int id = instr[i].id;
+      if ((id >= 0) && (id < (int)(sizeof(code) / sizeof(code[0]))) && (code[id] != NULL))
+        instr[i].code = code[id];
+      else
+        instr[i].code = &&unknown_instr;
+    }
+    _this->threaded = 1;
+  }
+  DISPATCH;
+#else
   while (1)
   {
-    int i;
 #ifdef TRACE_SCRIPT 
     printf("execute "); gsl_instr_display(instr[ip].proto); printf("\n");
 #endif
     switch (instr[ip].id) {
+#endif
 
       /* SET.I */
-      case INSTR_SETI_VAR_INTEGER:
+      INSTR(INSTR_SETI_VAR_INTEGER):
         DEST_VAR_INT = VALUE_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SETI_VAR_VAR:
+      INSTR(INSTR_SETI_VAR_VAR):
         DEST_VAR_INT = SRC_VAR_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* SET.F */
-      case INSTR_SETF_VAR_FLOAT:
+      INSTR(INSTR_SETF_VAR_FLOAT):
         DEST_VAR_FLOAT = VALUE_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SETF_VAR_VAR:
+      INSTR(INSTR_SETF_VAR_VAR):
         DEST_VAR_FLOAT = SRC_VAR_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* SET.P */
-      case INSTR_SETP_VAR_VAR:
+      INSTR(INSTR_SETP_VAR_VAR):
         DEST_VAR_PTR = SRC_VAR_PTR;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SETP_VAR_PTR:
+      INSTR(INSTR_SETP_VAR_PTR):
         DEST_VAR_PTR = VALUE_PTR;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* JUMP */
-      case INSTR_JUMP:
-        ip += JUMP_OFFSET; break;
+      INSTR(INSTR_JUMP):
+        ip += JUMP_OFFSET; DISPATCH;
 
         /* JZERO */
-      case INSTR_JZERO:
-        ip += (flag ? 1 : JUMP_OFFSET); break;
+      INSTR(INSTR_JZERO):
+        ip += (flag ? 1 : JUMP_OFFSET); DISPATCH;
 
-      case INSTR_NOP:
-        ++ip; break;
+      INSTR(INSTR_NOP):
+        ++ip; DISPATCH;
 
         /* ISEQUAL.P */
-      case INSTR_ISEQUALP_VAR_VAR:
+      INSTR(INSTR_ISEQUALP_VAR_VAR):
         flag = (DEST_VAR_PTR == SRC_VAR_PTR);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISEQUALP_VAR_PTR:
+      INSTR(INSTR_ISEQUALP_VAR_PTR):
         flag = (DEST_VAR_PTR == VALUE_PTR);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ISEQUAL.I */
-      case INSTR_ISEQUALI_VAR_VAR:
+      INSTR(INSTR_ISEQUALI_VAR_VAR):
         flag = (DEST_VAR_INT == SRC_VAR_INT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISEQUALI_VAR_INTEGER:
+      INSTR(INSTR_ISEQUALI_VAR_INTEGER):
         flag = (DEST_VAR_INT == VALUE_INT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ISEQUAL.F */
-      case INSTR_ISEQUALF_VAR_VAR:
+      INSTR(INSTR_ISEQUALF_VAR_VAR):
         flag = (DEST_VAR_FLOAT == SRC_VAR_FLOAT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISEQUALF_VAR_FLOAT:
+      INSTR(INSTR_ISEQUALF_VAR_FLOAT):
         flag = (DEST_VAR_FLOAT ==  VALUE_FLOAT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ISLOWER.I */
-      case INSTR_ISLOWERI_VAR_VAR:
+      INSTR(INSTR_ISLOWERI_VAR_VAR):
         flag = (DEST_VAR_INT < SRC_VAR_INT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISLOWERI_VAR_INTEGER:
+      INSTR(INSTR_ISLOWERI_VAR_INTEGER):
         flag = (DEST_VAR_INT <  VALUE_INT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ISLOWER.F */
-      case INSTR_ISLOWERF_VAR_VAR:
+      INSTR(INSTR_ISLOWERF_VAR_VAR):
         flag = (DEST_VAR_FLOAT < SRC_VAR_FLOAT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISLOWERF_VAR_FLOAT:
+      INSTR(INSTR_ISLOWERF_VAR_FLOAT):
         flag = (DEST_VAR_FLOAT <  VALUE_FLOAT);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ADD.I */
-      case INSTR_ADDI_VAR_VAR:
+      INSTR(INSTR_ADDI_VAR_VAR):
         DEST_VAR_INT += SRC_VAR_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ADDI_VAR_INTEGER:
+      INSTR(INSTR_ADDI_VAR_INTEGER):
         DEST_VAR_INT += VALUE_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* ADD.F */
-      case INSTR_ADDF_VAR_VAR:
+      INSTR(INSTR_ADDF_VAR_VAR):
         DEST_VAR_FLOAT += SRC_VAR_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ADDF_VAR_FLOAT:
+      INSTR(INSTR_ADDF_VAR_FLOAT):
         DEST_VAR_FLOAT += VALUE_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* MUL.I */
-      case INSTR_MULI_VAR_VAR:
+      INSTR(INSTR_MULI_VAR_VAR):
         DEST_VAR_INT *= SRC_VAR_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_MULI_VAR_INTEGER:
+      INSTR(INSTR_MULI_VAR_INTEGER):
         DEST_VAR_INT *= VALUE_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* MUL.F */
-      case INSTR_MULF_VAR_FLOAT:
+      INSTR(INSTR_MULF_VAR_FLOAT):
         DEST_VAR_FLOAT *= VALUE_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_MULF_VAR_VAR:
+      INSTR(INSTR_MULF_VAR_VAR):
         DEST_VAR_FLOAT *= SRC_VAR_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* DIV.I */
-      case INSTR_DIVI_VAR_VAR:
+      INSTR(INSTR_DIVI_VAR_VAR):
         DEST_VAR_INT /= SRC_VAR_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_DIVI_VAR_INTEGER:
+      INSTR(INSTR_DIVI_VAR_INTEGER):
         DEST_VAR_INT /= VALUE_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* DIV.F */
-      case INSTR_DIVF_VAR_FLOAT:
+      INSTR(INSTR_DIVF_VAR_FLOAT):
         DEST_VAR_FLOAT /= VALUE_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_DIVF_VAR_VAR:
+      INSTR(INSTR_DIVF_VAR_VAR):
         DEST_VAR_FLOAT /= SRC_VAR_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* SUB.I */
-      case INSTR_SUBI_VAR_VAR:
+      INSTR(INSTR_SUBI_VAR_VAR):
         DEST_VAR_INT -= SRC_VAR_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SUBI_VAR_INTEGER:
+      INSTR(INSTR_SUBI_VAR_INTEGER):
         DEST_VAR_INT -= VALUE_INT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* SUB.F */
-      case INSTR_SUBF_VAR_FLOAT:
+      INSTR(INSTR_SUBF_VAR_FLOAT):
         DEST_VAR_FLOAT -= VALUE_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SUBF_VAR_VAR:
+      INSTR(INSTR_SUBF_VAR_VAR):
         DEST_VAR_FLOAT -= SRC_VAR_FLOAT;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* CALL */
-      case INSTR_CALL:
+      INSTR(INSTR_CALL):
         stack[stack_pointer++] = ip + 1;
-        ip += JUMP_OFFSET; break;
+        ip += JUMP_OFFSET; DISPATCH;
 
         /* RET */
-      case INSTR_RET:
+      INSTR(INSTR_RET):
         ip = stack[--stack_pointer];
         if (ip<0) return;
-        break;
+        DISPATCH;
 
         /* EXT_CALL */
-      case INSTR_EXT_CALL:
+      INSTR(INSTR_EXT_CALL):
         instr[ip].data.udest.external_function->function(gsl, gsl->vars, instr[ip].data.udest.external_function->vars);
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* NOT */
-      case INSTR_NOT_VAR:
+      INSTR(INSTR_NOT_VAR):
         flag = !flag;
-        ++ip; break;
+        ++ip; DISPATCH;
 
         /* JNZERO */
-      case INSTR_JNZERO:
-        ip += (flag ? JUMP_OFFSET : 1); break;
+      INSTR(INSTR_JNZERO):
+        ip += (flag ? JUMP_OFFSET : 1); DISPATCH;
 
-      case INSTR_SETS_VAR_VAR:
+      INSTR(INSTR_SETS_VAR_VAR):
         memcpy(pDEST_VAR, pSRC_VAR, DEST_STRUCT_SIZE);
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_ISEQUALS_VAR_VAR:
-        break;
+      INSTR(INSTR_ISEQUALS_VAR_VAR):
+        DISPATCH;
 
-      case INSTR_ADDS_VAR_VAR:
+      INSTR(INSTR_ADDS_VAR_VAR):
         /* process integers */
         i=0;
         while (DEST_STRUCT_IBLOCK(i).size > 0) {
@@ -702,9 +784,9 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
           }
           ++i;
         }
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_SUBS_VAR_VAR:
+      INSTR(INSTR_SUBS_VAR_VAR):
         /* process integers */
         i=0;
         while (DEST_STRUCT_IBLOCK(i).size > 0) {
@@ -723,9 +805,9 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
           }
           ++i;
         }
-        ++ip; break;
+        ++ip; DISPATCH;
 
-      case INSTR_MULS_VAR_VAR:
+      INSTR(INSTR_MULS_VAR_VAR):
         /* process integers */
         i=0;
         while (DEST_STRUCT_IBLOCK(i).size > 0) {
@@ -744,9 +826,9 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
           }
           ++i;
         }
-        ++ip; break;
+        ++ip; DISPATCH;
         
-      case INSTR_DIVS_VAR_VAR:
+      INSTR(INSTR_DIVS_VAR_VAR):
         /* process integers */
         i=0;
         while (DEST_STRUCT_IBLOCK(i).size > 0) {
@@ -765,14 +847,20 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
           }
           ++i;
         }
-        ++ip; break;
+        ++ip; DISPATCH;
 
+#ifdef THREADED_CODE
+      unknown_instr:
+#else
       default:
+#endif
         printf("NOT IMPLEMENTED : %d\n", instr[ip].id);
         ++ip;
         exit(1);
+#ifndef THREADED_CODE
     }
   }
+#endif
 } /* }}} */
 
 int gsl_malloc(GoomSL *_this, int size)
@@ -924,6 +1012,423 @@ static int powerOfTwo(int i)
   return 0;
 }
 
+/* {{{ optimization of the fast instruction flow */
+#define OPT_SET  0
+#define OPT_ADD  1
+#define OPT_SUB  2
+#define OPT_MUL  3
+#define OPT_DIV  4
+#define OPT_TEST 5
+
+typedef struct _OptInstruction {
+  int id;      /* with a variable as source */
+  int imm_id;  /* with a constant as source */
+  int op;
+  int type;
+} OptInstruction;
+
+static const OptInstruction opt_instructions[] = {
+  { INSTR_SETI_VAR_VAR,     INSTR_SETI_VAR_INTEGER,     OPT_SET,  INSTR_INT   },
+  { INSTR_SETF_VAR_VAR,     INSTR_SETF_VAR_FLOAT,       OPT_SET,  INSTR_FLOAT },
+  { INSTR_SETP_VAR_VAR,     INSTR_SETP_VAR_PTR,         OPT_SET,  INSTR_PTR   },
+  { INSTR_ADDI_VAR_VAR,     INSTR_ADDI_VAR_INTEGER,     OPT_ADD,  INSTR_INT   },
+  { INSTR_ADDF_VAR_VAR,     INSTR_ADDF_VAR_FLOAT,       OPT_ADD,  INSTR_FLOAT },
+  { INSTR_SUBI_VAR_VAR,     INSTR_SUBI_VAR_INTEGER,     OPT_SUB,  INSTR_INT   },
+  { INSTR_SUBF_VAR_VAR,     INSTR_SUBF_VAR_FLOAT,       OPT_SUB,  INSTR_FLOAT },
+  { INSTR_MULI_VAR_VAR,     INSTR_MULI_VAR_INTEGER,     OPT_MUL,  INSTR_INT   },
+  { INSTR_MULF_VAR_VAR,     INSTR_MULF_VAR_FLOAT,       OPT_MUL,  INSTR_FLOAT },
+  { INSTR_DIVI_VAR_VAR,     INSTR_DIVI_VAR_INTEGER,     OPT_DIV,  INSTR_INT   },
+  { INSTR_DIVF_VAR_VAR,     INSTR_DIVF_VAR_FLOAT,       OPT_DIV,  INSTR_FLOAT },
+  { INSTR_ISEQUALI_VAR_VAR, INSTR_ISEQUALI_VAR_INTEGER, OPT_TEST, INSTR_INT   },
+  { INSTR_ISEQUALF_VAR_VAR, INSTR_ISEQUALF_VAR_FLOAT,   OPT_TEST, INSTR_FLOAT },
+  { INSTR_ISEQUALP_VAR_VAR, INSTR_ISEQUALP_VAR_PTR,     OPT_TEST, INSTR_PTR   },
+  { INSTR_ISLOWERI_VAR_VAR, INSTR_ISLOWERI_VAR_INTEGER, OPT_TEST, INSTR_INT   },
+  { INSTR_ISLOWERF_VAR_VAR, INSTR_ISLOWERF_VAR_FLOAT,   OPT_TEST, INSTR_FLOAT },
+  { 0, 0, 0, 0 }
+};
+
+static const OptInstruction *opt_instruction(int id)
+{
+  const OptInstruction *opt;
+  for (opt = opt_instructions; opt->id != 0; ++opt)
+    if ((opt->id == id) || (opt->imm_id == id))
+      return opt;
+  return NULL;
+}
+
+/* the temporaries of the expressions, named like in goomsl_yacc.y */
+static int opt_is_temporary(FastInstruction *instr)
+{
+  const char *name = instr->proto->params[1];
+  return (!strncmp(name, "_i_tmp", 6))
+      || (!strncmp(name, "_f_tmp", 6))
+      || (!strncmp(name, "_p_tmp", 6));
+}
+
+static int opt_reads(FastInstruction *instr, void *var)
+{
+  const OptInstruction *opt = opt_instruction(instr->id);
+  if (opt == NULL)
+    return 0;
+  if ((instr->id == opt->id) && (instr->data.usrc.var == var))
+    return 1;
+  return (opt->op != OPT_SET) && (instr->data.udest.var == var);
+}
+
+static int opt_writes(FastInstruction *instr, void *var)
+{
+  const OptInstruction *opt = opt_instruction(instr->id);
+  return (opt != NULL) && (opt->op != OPT_TEST) && (instr->data.udest.var == var);
+}
+
+static int opt_ends_block(FastInstruction *instr)
+{
+  switch (instr->id) {
+    case INSTR_JUMP: case INSTR_JZERO: case INSTR_JNZERO:
+    case INSTR_CALL: case INSTR_RET: case INSTR_EXT_CALL:
+      return 1;
+  }
+  return 0;
+}
+
+/* dest op= value, returns 0 for what would not give the same result at run time */
+static int opt_fold(int op, int type, InstructionData *dest, InstructionData value)
+{
+  if (type == INSTR_INT) {
+    unsigned int a = dest->usrc.value_int, b = value.usrc.value_int;
+    switch (op) {
+      case OPT_ADD: dest->usrc.value_int = a + b; return 1;
+      case OPT_SUB: dest->usrc.value_int = a - b; return 1;
+      case OPT_MUL: dest->usrc.value_int = a * b; return 1;
+      case OPT_DIV:
+        if ((value.usrc.value_int == 0) || (value.usrc.value_int == -1))
+          return 0;
+        dest->usrc.value_int /= value.usrc.value_int;
+        return 1;
+    }
+  }
+  else if (type == INSTR_FLOAT) {
+    switch (op) {
+      case OPT_ADD: dest->usrc.value_float += value.usrc.value_float; return 1;
+      case OPT_SUB: dest->usrc.value_float -= value.usrc.value_float; return 1;
+      case OPT_MUL: dest->usrc.value_float *= value.usrc.value_float; return 1;
+      case OPT_DIV: dest->usrc.value_float /= value.usrc.value_float; return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Folds the constants and removes the dead stores to the temporaries.
+ *
+ * Every expression computes its result in temporaries before the result is
+ * used, so "x = 2.0 * 3.0" gives "tmp = 2.0, tmp *= 3.0, x = tmp", which
+ * becomes "x = 6.0". The values of the constants are only followed inside the
+ * blocks, from a jump target to a jump or a call. The stores to a temporary
+ * are removed when nothing reads them, only for the temporaries that never
+ * keep a value from one block to the next.
+ */
+static void gsl_optimize_fast_iflow(FastInstructionFlow *fastiflow)
+{ /* {{{ */
+  FastInstruction *instr = fastiflow->instr;
+  int number = fastiflow->number;
+  char *block_start = (char*)calloc(number + 1, 1);
+  InstructionData *constant;
+  char *is_constant, *removed;
+  int *block, *new_index;
+  void **temps = NULL;
+  char *local = NULL;
+  int *last_block = NULL;
+  int nbTemps = 0;
+  int ip, j, t, nbBlocks;
+
+  /* blocks */
+  block_start[0] = 1;
+  for (ip = 0; ip < number; ++ip) {
+    if (opt_ends_block(&instr[ip]))
+      block_start[ip + 1] = 1;
+    if ((instr[ip].id == INSTR_JUMP) || (instr[ip].id == INSTR_JZERO) ||
+        (instr[ip].id == INSTR_JNZERO) || (instr[ip].id == INSTR_CALL)) {
+      int target = ip + instr[ip].data.udest.jump_offset;
+      if ((target < 0) || (target > number)) {
+        free(block_start);
+        return;
+      }
+      block_start[target] = 1;
+    }
+  }
+  block = (int*)malloc(sizeof(int) * (number + 1));
+  nbBlocks = 0;
+  for (ip = 0; ip < number; ++ip) {
+    if (block_start[ip])
+      nbBlocks++;
+    block[ip] = nbBlocks;
+  }
+
+  /* temporaries, the ones whose first use in every block is a set are local */
+  for (ip = 0; ip < number; ++ip) {
+    if (opt_writes(&instr[ip], instr[ip].data.udest.var) && opt_is_temporary(&instr[ip])) {
+      for (t = 0; t < nbTemps; ++t)
+        if (temps[t] == instr[ip].data.udest.var) break;
+      if (t == nbTemps) {
+        temps = (void**)realloc(temps, sizeof(void*) * (nbTemps + 1));
+        temps[nbTemps++] = instr[ip].data.udest.var;
+      }
+    }
+  }
+  constant    = (InstructionData*)malloc(sizeof(InstructionData) * (nbTemps + 1));
+  is_constant = (char*)calloc(nbTemps + 1, 1);
+  removed     = (char*)calloc(number + 1, 1);
+  new_index   = (int*)malloc(sizeof(int) * (number + 1));
+  local = (char*)malloc(nbTemps + 1);
+  last_block = (int*)malloc(sizeof(int) * (nbTemps + 1));
+  for (t = 0; t < nbTemps; ++t) {
+    local[t] = 1;
+    last_block[t] = 0;
+  }
+  for (ip = 0; ip < number; ++ip) {
+    for (t = 0; t < nbTemps; ++t) {
+      int reads = opt_reads(&instr[ip], temps[t]);
+      if (!reads && !opt_writes(&instr[ip], temps[t]))
+        continue;
+      if ((last_block[t] != block[ip]) && reads)
+        local[t] = 0;
+      last_block[t] = block[ip];
+    }
+  }
+
+  /* constant folding, is_constant[t] when temps[t] is known */
+  for (ip = 0; ip < number; ++ip) {
+    const OptInstruction *opt = opt_instruction(instr[ip].id);
+
+    if (block_start[ip])
+      memset(is_constant, 0, nbTemps);
+    if (opt == NULL)
+      continue;
+
+    /* a known source becomes a constant */
+    if (instr[ip].id == opt->id) {
+      for (t = 0; t < nbTemps; ++t)
+        if (is_constant[t] && (temps[t] == instr[ip].data.usrc.var)) {
+          instr[ip].id = opt->imm_id;
+          instr[ip].data.usrc = constant[t].usrc;
+          break;
+        }
+    }
+
+    if (opt->op == OPT_TEST)
+      continue;
+
+    for (t = 0; t < nbTemps; ++t)
+      if (temps[t] == instr[ip].data.udest.var)
+        break;
+    if (t == nbTemps)
+      continue;
+
+    if (instr[ip].id != opt->imm_id) {
+      is_constant[t] = 0;
+    }
+    else if (opt->op == OPT_SET) {
+      constant[t].usrc = instr[ip].data.usrc;
+      is_constant[t] = 1;
+    }
+    else if (is_constant[t] && opt_fold(opt->op, opt->type, &constant[t], instr[ip].data)) {
+      instr[ip].id = (opt->type == INSTR_INT) ? INSTR_SETI_VAR_INTEGER : INSTR_SETF_VAR_FLOAT;
+      instr[ip].data.usrc = constant[t].usrc;
+    }
+    else {
+      is_constant[t] = 0;
+    }
+  }
+
+  /* dead stores */
+  for (ip = 0; ip < number; ++ip) {
+    const OptInstruction *opt = opt_instruction(instr[ip].id);
+    if ((opt == NULL) || (opt->op != OPT_SET) || opt_reads(&instr[ip], instr[ip].data.udest.var))
+      continue;
+    for (t = 0; t < nbTemps; ++t)
+      if (temps[t] == instr[ip].data.udest.var)
+        break;
+    if ((t == nbTemps) || !local[t])
+      continue;
+
+    removed[ip] = 1;
+    for (j = ip + 1; (j < number) && !block_start[j]; ++j) {
+      if (opt_reads(&instr[j], temps[t])) {
+        removed[ip] = 0;
+        break;
+      }
+      if (opt_writes(&instr[j], temps[t]))
+        break;
+    }
+  }
+
+  /* removes the dead stores, a jump to one of them goes to the next instruction */
+  new_index[0] = 0;
+  for (ip = 0; ip < number; ++ip)
+    new_index[ip + 1] = new_index[ip] + !removed[ip];
+  for (ip = 0; ip < number; ++ip) {
+    if (removed[ip])
+      continue;
+    switch (instr[ip].id) {
+      case INSTR_JUMP: case INSTR_JZERO: case INSTR_JNZERO: case INSTR_CALL:
+        instr[ip].data.udest.jump_offset =
+          new_index[ip + instr[ip].data.udest.jump_offset] - new_index[ip];
+        break;
+    }
+    instr[new_index[ip]] = instr[ip];
+  }
+  fastiflow->number = new_index[number];
+
+  free(last_block);
+  free(local);
+  free(temps);
+  free(new_index);
+  free(block);
+  free(removed);
+  free(is_constant);
+  free(constant);
+  free(block_start);
+} /* }}} */
+/* }}} */
+
+#ifdef USE_JITC
+/* {{{ native code */
+static void jitc_struct_op(JitcEnv *jitc, int op, GSL_Struct *s, char *dest, char *src)
+{
+  int i, j;
+  for (i = 0; s->iBlock[i].size > 0; ++i)
+    for (j = s->iBlock[i].size - 1; j >= 0; --j)
+      jitc_int_op(jitc, op, (int*)(dest + s->iBlock[i].data) + j, (int*)(src + s->iBlock[i].data) + j);
+  for (i = 0; s->fBlock[i].size > 0; ++i)
+    for (j = s->fBlock[i].size - 1; j >= 0; --j)
+      jitc_float_op(jitc, op, (float*)(dest + s->fBlock[i].data) + j, (float*)(src + s->fBlock[i].data) + j);
+}
+
+/**
+ * Compiles the fast instruction flow to native code. The label of an
+ * instruction is its index in the flow. Leaves jitc_func to NULL when the flow
+ * uses something the jitc does not handle, gsl_execute then interprets it.
+ */
+static void gsl_create_jitc_func(GoomSL *gsl, FastInstructionFlow *fastiflow)
+{ /* {{{ */
+  FastInstruction *instr = fastiflow->instr;
+  int number = fastiflow->number;
+  char *is_target;
+  JitcEnv *jitc;
+  int ip;
+
+  if (gsl->jitc == NULL)
+    gsl->jitc = jitc_env_new(number * 16);
+  jitc = gsl->jitc;
+  gsl->jitc_func = NULL;
+
+  /* the labels forget the registers, only put them where needed */
+  is_target = (char*)calloc(number + 1, 1);
+  is_target[0] = 1;
+  for (ip = 0; ip < number; ++ip) {
+    switch (instr[ip].id) {
+      case INSTR_JUMP: case INSTR_JZERO: case INSTR_JNZERO: case INSTR_CALL:
+        if ((ip + JUMP_OFFSET < 0) || (ip + JUMP_OFFSET >= number)) {
+          free(is_target);
+          return;
+        }
+        is_target[ip + JUMP_OFFSET] = 1;
+        break;
+    }
+  }
+
+  jitc_prepare_func(jitc);
+
+  for (ip = 0; (ip < number) && !jitc->error; ++ip) {
+    if (is_target[ip])
+      jitc_label(jitc, ip);
+
+    switch (instr[ip].id) {
+      /* the float and ptr values share their bits with the int one */
+      case INSTR_SETI_VAR_INTEGER:
+      case INSTR_SETF_VAR_FLOAT:
+      case INSTR_SETP_VAR_PTR:
+        jitc_set(jitc, pDEST_VAR, VALUE_INT); break;
+      case INSTR_SETI_VAR_VAR:
+      case INSTR_SETF_VAR_VAR:
+      case INSTR_SETP_VAR_VAR:
+        jitc_copy(jitc, pDEST_VAR, pSRC_VAR, sizeof(int)); break;
+      case INSTR_SETS_VAR_VAR:
+        jitc_copy(jitc, pDEST_VAR, pSRC_VAR, DEST_STRUCT_SIZE); break;
+
+      case INSTR_JUMP:   jitc_jump(jitc, ip + JUMP_OFFSET); break;
+      case INSTR_JZERO:  jitc_jump_zero(jitc, ip + JUMP_OFFSET); break;
+      case INSTR_JNZERO: jitc_jump_not_zero(jitc, ip + JUMP_OFFSET); break;
+      case INSTR_CALL:   jitc_call(jitc, ip + JUMP_OFFSET); break;
+      case INSTR_RET:    jitc_ret(jitc); break;
+      case INSTR_NOP:    break;
+      case INSTR_EXT_CALL:
+        jitc_call_c(jitc, (JitcCFunc*)&instr[ip].data.udest.external_function->function,
+                    gsl, (void**)&gsl->vars, (void**)&instr[ip].data.udest.external_function->vars);
+        break;
+
+      case INSTR_ISEQUALP_VAR_VAR:
+      case INSTR_ISEQUALI_VAR_VAR:
+        jitc_int_test(jitc, JITC_TEST_EQUAL, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ISEQUALP_VAR_PTR:
+      case INSTR_ISEQUALI_VAR_INTEGER:
+        jitc_int_test_imm(jitc, JITC_TEST_EQUAL, pDEST_VAR, VALUE_INT); break;
+      case INSTR_ISEQUALF_VAR_VAR:
+        jitc_float_test(jitc, JITC_TEST_EQUAL, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ISEQUALF_VAR_FLOAT:
+        jitc_float_test_imm(jitc, JITC_TEST_EQUAL, pDEST_VAR, VALUE_FLOAT); break;
+      case INSTR_ISLOWERI_VAR_VAR:
+        jitc_int_test(jitc, JITC_TEST_LOWER, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ISLOWERI_VAR_INTEGER:
+        jitc_int_test_imm(jitc, JITC_TEST_LOWER, pDEST_VAR, VALUE_INT); break;
+      case INSTR_ISLOWERF_VAR_VAR:
+        jitc_float_test(jitc, JITC_TEST_LOWER, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ISLOWERF_VAR_FLOAT:
+        jitc_float_test_imm(jitc, JITC_TEST_LOWER, pDEST_VAR, VALUE_FLOAT); break;
+      case INSTR_NOT_VAR:
+        jitc_not(jitc); break;
+
+      case INSTR_ADDI_VAR_VAR: jitc_int_op(jitc, JITC_OP_ADD, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_SUBI_VAR_VAR: jitc_int_op(jitc, JITC_OP_SUB, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_MULI_VAR_VAR: jitc_int_op(jitc, JITC_OP_MUL, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_DIVI_VAR_VAR: jitc_int_op(jitc, JITC_OP_DIV, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ADDI_VAR_INTEGER: jitc_int_op_imm(jitc, JITC_OP_ADD, pDEST_VAR, VALUE_INT); break;
+      case INSTR_SUBI_VAR_INTEGER: jitc_int_op_imm(jitc, JITC_OP_SUB, pDEST_VAR, VALUE_INT); break;
+      case INSTR_MULI_VAR_INTEGER: jitc_int_op_imm(jitc, JITC_OP_MUL, pDEST_VAR, VALUE_INT); break;
+      case INSTR_DIVI_VAR_INTEGER: jitc_int_op_imm(jitc, JITC_OP_DIV, pDEST_VAR, VALUE_INT); break;
+
+      case INSTR_ADDF_VAR_VAR: jitc_float_op(jitc, JITC_OP_ADD, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_SUBF_VAR_VAR: jitc_float_op(jitc, JITC_OP_SUB, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_MULF_VAR_VAR: jitc_float_op(jitc, JITC_OP_MUL, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_DIVF_VAR_VAR: jitc_float_op(jitc, JITC_OP_DIV, pDEST_VAR, pSRC_VAR); break;
+      case INSTR_ADDF_VAR_FLOAT: jitc_float_op_imm(jitc, JITC_OP_ADD, pDEST_VAR, VALUE_FLOAT); break;
+      case INSTR_SUBF_VAR_FLOAT: jitc_float_op_imm(jitc, JITC_OP_SUB, pDEST_VAR, VALUE_FLOAT); break;
+      case INSTR_MULF_VAR_FLOAT: jitc_float_op_imm(jitc, JITC_OP_MUL, pDEST_VAR, VALUE_FLOAT); break;
+      case INSTR_DIVF_VAR_FLOAT: jitc_float_op_imm(jitc, JITC_OP_DIV, pDEST_VAR, VALUE_FLOAT); break;
+
+      case INSTR_ADDS_VAR_VAR:
+        jitc_struct_op(jitc, JITC_OP_ADD, gsl->gsl_struct[DEST_STRUCT_ID], pDEST_VAR, pSRC_VAR); break;
+      case INSTR_SUBS_VAR_VAR:
+        jitc_struct_op(jitc, JITC_OP_SUB, gsl->gsl_struct[DEST_STRUCT_ID], pDEST_VAR, pSRC_VAR); break;
+      case INSTR_MULS_VAR_VAR:
+        jitc_struct_op(jitc, JITC_OP_MUL, gsl->gsl_struct[DEST_STRUCT_ID], pDEST_VAR, pSRC_VAR); break;
+      case INSTR_DIVS_VAR_VAR:
+        jitc_struct_op(jitc, JITC_OP_DIV, gsl->gsl_struct[DEST_STRUCT_ID], pDEST_VAR, pSRC_VAR); break;
+
+      default:
+        /* ISEQUAL.S is not implemented by the interpreter either */
+        jitc->error = 1;
+    }
+  }
+  free(is_target);
+
+  if (!jitc->error)
+    gsl->jitc_func = jitc_validate_func(jitc);
+} /* }}} */
+/* }}} */
+#endif
+
 /* Cree un flow d'instruction optimise */
 static void gsl_create_fast_iflow(void)
 { /* {{{ */
@@ -1274,17 +1779,23 @@ static void gsl_create_fast_iflow(void)
   /* fastiflow->instr = (FastInstruction*)(((int)fastiflow->mallocedInstr) + 16 - (((int)fastiflow->mallocedInstr)%16)); */
   fastiflow->instr = (FastInstruction*)fastiflow->mallocedInstr;
   fastiflow->number = number;
+  fastiflow->threaded = 0;
   for(i=0;i<number;++i) {
     fastiflow->instr[i].id    = iflow->instr[i]->id;
     fastiflow->instr[i].data  = iflow->instr[i]->data;
     fastiflow->instr[i].proto = iflow->instr[i];
   }
+  if (currentGoomSL->optimize)
+    gsl_optimize_fast_iflow(fastiflow);
   currentGoomSL->fastiflow = fastiflow;
+#ifdef USE_JITC
+  gsl_create_jitc_func(currentGoomSL, fastiflow);
+#endif
 #endif
 } /* }}} */
 
 void yy_scan_string(const char *str);
-void yyparse(void);
+int yyparse(void);
 
 GoomHash *gsl_globals(GoomSL *_this)
 {
@@ -1372,6 +1883,12 @@ void gsl_execute(GoomSL *scanner)
 #if USE_JITC_X86
     scanner->jitc_func();
 #else
+#ifdef USE_JITC
+    if (scanner->use_jitc && (scanner->jitc_func != NULL)) {
+      scanner->jitc_func();
+      return;
+    }
+#endif
     iflow_execute(scanner->fastiflow, scanner);
 #endif
   }
@@ -1395,11 +1912,16 @@ GoomSL *gsl_new(void)
   reset_scanner(gss);
 
   gss->compilationOK = 0;
+  gss->optimize = 1;
   gss->nbPtr=0;
   gss->ptrArraySize=256;
   gss->ptrArray = (void**)malloc(gss->ptrArraySize * sizeof(void*));
-#ifdef USE_JITC_X86
+#if defined(USE_JITC_X86)
+  gss->jitc = NULL;
+#elif defined(USE_JITC)
   gss->jitc = NULL;
+  gss->jitc_func = NULL;
+  gss->use_jitc = 1;
 #endif
   return gss;
 } /* }}} */
@@ -1419,8 +1941,33 @@ int gsl_is_compiled(GoomSL *gss)
   return gss->compilationOK;
 } /* }}} */
 
+/* Chooses between native code and the interpreter, returns if the compiled
+ * script runs as native code. */
+int gsl_use_jitc(GoomSL *gss, int use)
+{ /* {{{ */
+#if defined(USE_JITC_X86)
+  return 1;
+#elif defined(USE_JITC)
+  gss->use_jitc = use;
+  return use && (gss->jitc_func != NULL);
+#else
+  return 0;
+#endif
+} /* }}} */
+
+/* Chooses if the scripts compiled next get their constants folded and their
+ * dead stores removed, they do by default. */
+void gsl_optimize(GoomSL *gss, int optimize)
+{ /* {{{ */
+  gss->optimize = optimize;
+} /* }}} */
+
 void gsl_free(GoomSL *gss)
 { /* {{{ */
+#if defined(USE_JITC) && !defined(USE_JITC_X86)
+  if (gss->jitc != NULL)
+    jitc_env_delete(gss->jitc);
+#endif
   iflow_free(gss->iflow);
   free(gss->vars);
   free(gss->functions);
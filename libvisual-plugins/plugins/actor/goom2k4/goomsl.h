@@ -16,6 +16,8 @@ void   gsl_compile (GoomSL *scanner, const char *script);
 void   gsl_execute (GoomSL *scanner);
 int    gsl_is_compiled  (GoomSL *gss);
 void   gsl_bind_function(GoomSL *gss, const char *fname, GoomSL_ExternalFunction func);
+int    gsl_use_jitc     (GoomSL *gss, int use);
+void   gsl_optimize     (GoomSL *gss, int optimize);
 
 int    gsl_malloc  (GoomSL *_this, int size);
 void  *gsl_get_ptr (GoomSL *_this, int id);
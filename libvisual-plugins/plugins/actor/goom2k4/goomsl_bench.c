@@ -0,0 +1,184 @@
+/* goomsl_bench.c
+ * Equivalence test and benchmark of the GoomSL optimizer and jitc.
+ *
+ * Compiles a script three times. The baseline is neither optimized nor native
+ * code, the two other copies are optimized, one runs with the interpreter and
+ * the other as native code when there is a jitc. All are fed the same made up
+ * sound every frame, and the globals of the copies must be the ones of the
+ * baseline after every frame. Then every copy is timed.
+ *
+ * usage: goomsl_bench [script.goom [frames]], goomsl_bench.goom by default
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "goomsl.h"
+
+static GoomSL *baseline;
+static int differences;
+
+static void zero_global (GoomHash *caller, const char *key, HashValue *value)
+{
+    if (strncmp (key, "__type_of_", 10) != 0)
+        *(int *) value->ptr = 0;
+}
+
+/* the temporaries are numbered from one compilation to the next */
+static int is_temporary (const char *key)
+{
+    return strncmp (key, "_i_tmp", 6) == 0
+        || strncmp (key, "_f_tmp", 6) == 0
+        || strncmp (key, "_p_tmp", 6) == 0;
+}
+
+static void compare_global (GoomHash *caller, const char *key, HashValue *value)
+{
+    HashValue *other_value;
+
+    if (strncmp (key, "__type_of_", 10) == 0 || is_temporary (key))
+        return;
+
+    other_value = goom_hash_get (gsl_globals (baseline), key);
+    if (other_value == NULL || *(int *) value->ptr != *(int *) other_value->ptr) {
+        if (differences++ < 10)
+            fprintf (stderr, "goomsl_bench: %s differs\n", key);
+    }
+}
+
+typedef struct {
+    GoomSL *gsl;
+    float  *goom_detection;
+    float  *sound_speed;
+    float  *speedvar;
+} BenchScript;
+
+static float unused;
+
+static float *get_float (GoomSL *gsl, const char *name)
+{
+    HashValue *var = goom_hash_get (gsl_globals (gsl), name);
+
+    return var != NULL ? (float *) var->ptr : &unused;
+}
+
+/* a sound with some goom and some silence */
+static void feed (BenchScript *script, int frame)
+{
+    *script->goom_detection = (frame % 7) / 6.0f;
+    *script->sound_speed = (frame % 5) / 4.0f;
+    *script->speedvar = (frame % 3) / 2.0f;
+}
+
+static void compile (BenchScript *script, const char *source, int optimize, int native)
+{
+    script->gsl = gsl_new ();
+
+    gsl_optimize (script->gsl, optimize);
+    gsl_compile (script->gsl, source);
+    gsl_use_jitc (script->gsl, native);
+    goom_hash_for_each (gsl_globals (script->gsl), zero_global);
+
+    script->goom_detection = get_float (script->gsl, "Sound.Goom_Detection");
+    script->sound_speed = get_float (script->gsl, "Sound.Sound_Speed");
+    script->speedvar = get_float (script->gsl, "speedvar");
+}
+
+/* runs a copy and a fresh baseline side by side, returns if they agree */
+static int check (BenchScript *script, const char *source, int frames, const char *name)
+{
+    BenchScript reference;
+    int same = TRUE;
+    int i;
+
+    compile (&reference, source, FALSE, FALSE);
+    baseline = reference.gsl;
+
+    for (i = 0; i < frames && same; i++) {
+        feed (script, i);
+        feed (&reference, i);
+        gsl_execute (script->gsl);
+        gsl_execute (reference.gsl);
+
+        differences = 0;
+        goom_hash_for_each (gsl_globals (script->gsl), compare_global);
+        if (differences > 0) {
+            fprintf (stderr, "goomsl_bench: %d globals of the %s copy differ at frame %d\n",
+                     differences, name, i);
+            same = FALSE;
+        }
+    }
+
+    gsl_free (reference.gsl);
+
+    return same;
+}
+
+static int run (BenchScript *script, int frames)
+{
+    VisTimer timer;
+    int i;
+
+    visual_timer_init (&timer);
+    visual_timer_start (&timer);
+
+    for (i = 0; i < frames; i++) {
+        feed (script, i);
+        gsl_execute (script->gsl);
+    }
+
+    return visual_timer_elapsed_usecs (&timer);
+}
+
+int main (int argc, char **argv)
+{
+    const char *file = argc > 1 ? argv[1] : "goomsl_bench.goom";
+    int frames = argc > 2 ? atoi (argv[2]) : 100000;
+    BenchScript reference, interpreted, native;
+    char *source;
+    int has_native;
+    int failed = 0;
+
+    visual_init (&argc, &argv);
+
+    source = gsl_init_buffer (file);
+    compile (&reference, source, FALSE, FALSE);
+    compile (&interpreted, source, TRUE, FALSE);
+    compile (&native, source, TRUE, TRUE);
+
+    if (!gsl_is_compiled (reference.gsl)) {
+        fprintf (stderr, "goomsl_bench: can't compile %s\n", file);
+        return EXIT_FAILURE;
+    }
+
+    has_native = gsl_use_jitc (native.gsl, TRUE);
+    if (!has_native)
+        printf ("goomsl_bench: %s does not run as native code here\n", file);
+
+    failed = !check (&interpreted, source, frames, "interpreted");
+    if (!failed && has_native)
+        failed = !check (&native, source, frames, "native");
+
+    if (!failed) {
+        int reference_usecs = run (&reference, frames);
+        int interpreted_usecs = run (&interpreted, frames);
+
+        printf ("goomsl_bench: %d frames, baseline %d us, interpreted %d us", frames,
+                reference_usecs, interpreted_usecs);
+
+        if (has_native)
+            printf (", native %d us", run (&native, frames));
+
+        printf ("\n");
+    }
+
+    gsl_free (reference.gsl);
+    gsl_free (interpreted.gsl);
+    gsl_free (native.gsl);
+    free (source);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
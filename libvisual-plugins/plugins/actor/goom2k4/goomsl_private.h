@@ -7,6 +7,8 @@
 
 #ifdef USE_JITC_X86
 #include "jitc_x86.h"
+#else
+#include "jitc.h"
 #endif
 
 #include "goomsl_heap.h"
@@ -130,12 +132,14 @@ typedef struct _FAST_INSTRUCTION { /* {{{ */
   int id;
   InstructionData data;
   Instruction *proto;
+  const void *code; /* where the threaded interpreter runs it */
 } FastInstruction;
 /* }}} */
 typedef struct _FastInstructionFlow { /* {{{ */
   int number;
   FastInstruction *instr;
   void *mallocedInstr;
+  int threaded; /* the code of the instructions is known */
 } FastInstructionFlow;
 /* }}} */
 typedef struct _ExternalFunctionStruct { /* {{{ */
@@ -187,9 +191,14 @@ struct _GoomSL { /* {{{ */
     void **ptrArray;
     
     int compilationOK;
+    int optimize; /* of the scripts compiled next */
 #ifdef USE_JITC_X86
     JitcX86Env *jitc;
     JitcFunc    jitc_func;
+#elif defined(USE_JITC)
+    JitcEnv  *jitc;
+    JitcFunc  jitc_func; /* NULL when the flow could not be compiled */
+    int       use_jitc;
 #endif
 }; /* }}} */
 
@@ -0,0 +1,152 @@
+/* goomsl_test.c
+ * Test of the optimization of the GoomSL instruction flows.
+ *
+ * Compiles small scripts with and without the optimization. The constants of
+ * the expressions must be folded into fewer instructions, the stores that can
+ * still be read must be kept, through a struct copy, by the host or by an
+ * external function, and both flows must end with the expected globals.
+ *
+ * usage: goomsl_test
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "goomsl.h"
+#include "goomsl_private.h"
+
+typedef struct {
+    const char *name;
+    int is_int;
+    float value;
+} GslTestGlobal;
+
+/* every script has constants to fold, its optimized flow must be shorter */
+typedef struct {
+    const char *name;
+    const char *script;
+    GslTestGlobal globals[4];
+} GslTest;
+
+static const GslTest tests[] = {
+    { "folding",
+      "float f\n"
+      "int i\n"
+      "int d\n"
+      "f = 1.5 * 2.0 / 4.0 - 0.25\n"
+      "i = 2 * 3 + 4\n"
+      "d = 7 / -1\n",
+      { { "f", FALSE, 0.5f }, { "i", TRUE, 10 }, { "d", TRUE, -7 } } },
+
+    /* a constant is only followed inside a block */
+    { "blocks",
+      "int x\n"
+      "int k\n"
+      "x = 2 * 3\n"
+      "(x > 5) ? k = x * 2 + 1\n"
+      "while k > 10 do k -= 2 + 1\n",
+      { { "x", TRUE, 6 }, { "k", TRUE, 10 } } },
+
+    /* out is never read by the script, q only reads p.a through the copy
+     * of the struct, and the argument of probe is read by the host */
+    { "kept stores",
+      "external <probe: float v>\n"
+      "struct <Pair: float a, float b>\n"
+      "Pair p\n"
+      "Pair q\n"
+      "float out\n"
+      "out = 2.0 * 4.0\n"
+      "p.a = 1.0 + 2.0\n"
+      "q = p\n"
+      "[probe: v = 3.0 * 5.0]\n",
+      { { "out", FALSE, 8.0f }, { "q.a", FALSE, 3.0f }, { "probed", FALSE, 15.0f } } }
+};
+
+static float probed;
+
+static void probe (GoomSL *gsl, GoomHash *global, GoomHash *local)
+{
+    probed = GSL_LOCAL_FLOAT (gsl, local, "v");
+}
+
+static float get_value (GoomSL *gsl, const GslTestGlobal *global)
+{
+    HashValue *var;
+
+    if (strcmp (global->name, "probed") == 0)
+        return probed;
+
+    var = goom_hash_get (gsl_globals (gsl), global->name);
+    if (var == NULL)
+        return NAN;
+
+    return global->is_int ? *(int *) var->ptr : *(float *) var->ptr;
+}
+
+/* compiles and runs a script, returns the number of fast instructions */
+static int gsl_test_run (const GslTest *test, int optimize, int *failures)
+{
+    GoomSL *gsl = gsl_new ();
+    const GslTestGlobal *global;
+    int number;
+
+    gsl_optimize (gsl, optimize);
+    gsl_compile (gsl, test->script);
+
+    if (!gsl_is_compiled (gsl)) {
+        fprintf (stderr, "goomsl_test: can't compile %s\n", test->name);
+        (*failures)++;
+        gsl_free (gsl);
+        return 0;
+    }
+
+    if (strstr (test->script, "<probe:") != NULL)
+        gsl_bind_function (gsl, "probe", probe);
+    gsl_use_jitc (gsl, FALSE);
+
+    probed = 0;
+    gsl_execute (gsl);
+
+    for (global = test->globals; global->name != NULL; global++) {
+        float value = get_value (gsl, global);
+
+        if (value != global->value) {
+            fprintf (stderr, "goomsl_test: %s %s is %g instead of %g%s\n", test->name, global->name,
+                     value, global->value, optimize ? "" : " without the optimization");
+            (*failures)++;
+        }
+    }
+
+    number = gsl->fastiflow->number;
+    gsl_free (gsl);
+
+    return number;
+}
+
+int main (int argc, char **argv)
+{
+    int failures = 0;
+    int i;
+
+    visual_init (&argc, &argv);
+
+    for (i = 0; i < (int) (sizeof (tests) / sizeof (tests[0])); i++) {
+        int baseline = gsl_test_run (&tests[i], FALSE, &failures);
+        int optimized = gsl_test_run (&tests[i], TRUE, &failures);
+
+        printf ("goomsl_test: %s %d instructions, %d optimized\n", tests[i].name, baseline, optimized);
+
+        if (optimized >= baseline) {
+            fprintf (stderr, "goomsl_test: %s is not folded\n", tests[i].name);
+            failures++;
+        }
+    }
+
+    printf ("goomsl_test: %d failures\n", failures);
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -17,6 +17,9 @@
     void yyerror(char *);
     extern GoomSL *currentGoomSL;
 
+    /* after the grammar, it needs the token values */
+    void gsl_declare_global_variable(int type, char *name);
+
     static NodeType *nodeNew(const char *str, int type, int line_number);
     static NodeType *nodeClone(NodeType *node);
     static void nodeFreeInternals(NodeType *node);
@@ -1180,20 +1183,6 @@
     } /* }}} */
 
 
-    void gsl_declare_global_variable(int type, char *name) {
-      switch(type){
-        case -1: break;
-        case FLOAT_TK:gsl_float_decl_global(name);break;
-        case INT_TK:  gsl_int_decl_global(name);break;
-        case PTR_TK:  gsl_ptr_decl_global(name);break;
-        default:
-        {
-          int id = type - 1000;
-          gsl_struct_decl_global_from_id(name,id);
-        }
-      }
-    }
-
 %}
 
 %union {
@@ -1396,6 +1385,21 @@ opt_nl: '\n' | ;
 %%
 
 
+void gsl_declare_global_variable(int type, char *name)
+{ /* {{{ */
+    switch(type){
+      case -1: break;
+      case FLOAT_TK:gsl_float_decl_global(name);break;
+      case INT_TK:  gsl_int_decl_global(name);break;
+      case PTR_TK:  gsl_ptr_decl_global(name);break;
+      default:
+      {
+        int id = type - 1000;
+        gsl_struct_decl_global_from_id(name,id);
+      }
+    }
+} /* }}} */
+
 void yyerror(char *str)
 { /* {{{ */
     fprintf(stderr, "ERROR: Line %d, %s\n", currentGoomSL->num_lines, str);
@@ -0,0 +1,146 @@
+#include "jitc.h"
+
+#ifdef USE_JITC
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+JitcEnv *jitc_env_new(int memory_size)
+{
+  JitcEnv *jitc = (JitcEnv*)calloc(1, sizeof(JitcEnv));
+
+  jitc->size   = memory_size > 64 ? memory_size : 64;
+  jitc->memory = (unsigned char*)malloc(jitc->size);
+
+  jitc->refsSize = 64;
+  jitc->refs     = (JitcLabelRef*)malloc(sizeof(JitcLabelRef) * jitc->refsSize);
+
+  return jitc;
+}
+
+void jitc_env_delete(JitcEnv *jitc)
+{
+  if (jitc->func != NULL)
+    munmap(jitc->func, jitc->func_size);
+
+  free(jitc->labels);
+  free(jitc->refs);
+  free(jitc->memory);
+  free(jitc);
+}
+
+void jitc_add_uchar(JitcEnv *jitc, unsigned char c)
+{
+  if (jitc->used == jitc->size) {
+    jitc->size  *= 2;
+    jitc->memory = (unsigned char*)realloc(jitc->memory, jitc->size);
+  }
+  jitc->memory[jitc->used++] = c;
+}
+
+void jitc_add_uint(JitcEnv *jitc, unsigned int i)
+{
+  jitc_add_uchar(jitc, i & 0xff);
+  jitc_add_uchar(jitc, (i >> 8) & 0xff);
+  jitc_add_uchar(jitc, (i >> 16) & 0xff);
+  jitc_add_uchar(jitc, (i >> 24) & 0xff);
+}
+
+/* the address registers are unknown after a label or a call */
+void jitc_forget_addr(JitcEnv *jitc)
+{
+  jitc->addr[0] = NULL;
+  jitc->addr[1] = NULL;
+}
+
+static void jitc_grow_labels(JitcEnv *jitc, int label)
+{
+  if (label >= jitc->nbLabels) {
+    int size = (label + 1) * 2;
+    jitc->labels = (int*)realloc(jitc->labels, sizeof(int) * size);
+    while (jitc->nbLabels < size)
+      jitc->labels[jitc->nbLabels++] = -1;
+  }
+}
+
+void jitc_label(JitcEnv *jitc, int label)
+{
+  jitc_grow_labels(jitc, label);
+  jitc->labels[label] = jitc->used;
+  jitc_forget_addr(jitc);
+}
+
+/* the reference is at the current address */
+void jitc_add_ref(JitcEnv *jitc, int label, int kind)
+{
+  if (jitc->nbRefs == jitc->refsSize) {
+    jitc->refsSize *= 2;
+    jitc->refs = (JitcLabelRef*)realloc(jitc->refs, sizeof(JitcLabelRef) * jitc->refsSize);
+  }
+  jitc->refs[jitc->nbRefs].label   = label;
+  jitc->refs[jitc->nbRefs].address = jitc->used;
+  jitc->refs[jitc->nbRefs].kind    = kind;
+  jitc->nbRefs++;
+}
+
+void jitc_prepare_func(JitcEnv *jitc)
+{
+  jitc->used   = 0;
+  jitc->nbRefs = 0;
+  jitc->error  = 0;
+  if (jitc->nbLabels > 0)
+    memset(jitc->labels, 0xff, sizeof(int) * jitc->nbLabels);
+  jitc_forget_addr(jitc);
+
+  /* saves the state, calls label 0 and restores the state */
+  jitc_backend_prologue(jitc);
+}
+
+/**
+ * Resolves the labels and copies the code in executable memory.
+ * Returns NULL if the code could not be compiled.
+ */
+JitcFunc jitc_validate_func(JitcEnv *jitc)
+{
+  int i;
+
+  for (i = 0; i < jitc->nbRefs; ++i) {
+    JitcLabelRef *ref = &jitc->refs[i];
+    int address = (ref->label < jitc->nbLabels) ? jitc->labels[ref->label] : -1;
+
+    if ((address < 0) || !jitc_backend_patch(jitc, ref, address)) {
+      fprintf(stderr, "JITC: can't reach label %d\n", ref->label);
+      jitc->error = 1;
+    }
+  }
+
+  if (jitc->error)
+    return NULL;
+
+  if (jitc->func != NULL)
+    munmap(jitc->func, jitc->func_size);
+
+  jitc->func_size = jitc->used;
+  jitc->func = (unsigned char*)mmap(NULL, jitc->func_size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jitc->func == MAP_FAILED) {
+    jitc->func = NULL;
+    return NULL;
+  }
+
+  memcpy(jitc->func, jitc->memory, jitc->used);
+
+  if (mprotect(jitc->func, jitc->func_size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(jitc->func, jitc->func_size);
+    jitc->func = NULL;
+    return NULL;
+  }
+
+  __builtin___clear_cache((char*)jitc->func, (char*)jitc->func + jitc->func_size);
+
+  return (JitcFunc)jitc->func;
+}
+
+#endif /* USE_JITC */
@@ -0,0 +1,110 @@
+#ifndef _JITC_H
+#define _JITC_H
+
+/**
+ * Just in time compilation of the GoomSL instruction flows on x86-64 and
+ * AArch64.
+ *
+ * The code is generated from operations on 32 bits variables at fixed
+ * addresses, the way the instruction flow works, plus a flag set by the tests
+ * and read by the conditional jumps. The labels are integers, label 0 is where
+ * the function starts. jitc_x86_64.c and jitc_arm64.c are the two backends.
+ *
+ * The AArch64 backend has only been read back from the disassembly, it is left
+ * out unless GOOMSL_ENABLE_JITC_ARM64 is defined, until goomsl_bench passes on
+ * an AArch64 cpu.
+ */
+
+#include <libvisual/libvisual.h>
+
+#if defined(VISUAL_ARCH_X86_64) && !defined(VISUAL_OS_WIN32)
+#define JITC_X86_64
+#elif defined(GOOMSL_ENABLE_JITC_ARM64) && defined(VISUAL_ARCH_ARM) && defined(__aarch64__)
+#define JITC_ARM64
+#endif
+
+#if defined(JITC_X86_64) || defined(JITC_ARM64)
+#define USE_JITC
+#endif
+
+/* operations */
+#define JITC_OP_ADD 0
+#define JITC_OP_SUB 1
+#define JITC_OP_MUL 2
+#define JITC_OP_DIV 3
+
+/* tests */
+#define JITC_TEST_EQUAL 0
+#define JITC_TEST_LOWER 1
+
+/* kinds of label references, for the backends */
+#define JITC_REF_JUMP 0
+#define JITC_REF_COND 1
+#define JITC_REF_CALL 2
+
+typedef void (*JitcFunc)(void);
+typedef void (*JitcCFunc)(void *arg0, void *arg1, void *arg2);
+
+typedef struct _JITC_LABEL_REF {
+  int label;
+  int address;
+  int kind;
+} JitcLabelRef;
+
+typedef struct _JITC_ENV {
+  unsigned char *memory;     /* the code being generated */
+  unsigned int   used;
+  unsigned int   size;
+
+  unsigned char *func;       /* the executable copy of the code */
+  unsigned int   func_size;
+
+  int           *labels;     /* address of every label, -1 while unknown */
+  int            nbLabels;
+  JitcLabelRef  *refs;       /* where the labels are used */
+  int            nbRefs;
+  int            refsSize;
+
+  const void    *addr[2];    /* addresses held by the address registers */
+  int            error;      /* something could not be compiled */
+} JitcEnv;
+
+/* public methods */
+JitcEnv *jitc_env_new(int memory_size);
+void     jitc_env_delete(JitcEnv *jitc);
+void     jitc_prepare_func(JitcEnv *jitc);
+JitcFunc jitc_validate_func(JitcEnv *jitc);
+
+void jitc_label        (JitcEnv *jitc, int label);
+void jitc_jump         (JitcEnv *jitc, int label);
+void jitc_jump_zero    (JitcEnv *jitc, int label);
+void jitc_jump_not_zero(JitcEnv *jitc, int label);
+void jitc_call         (JitcEnv *jitc, int label);
+void jitc_ret          (JitcEnv *jitc);
+
+/* calls (*func)(arg0, *arg1, *arg2), func, arg1 and arg2 are read at run time */
+void jitc_call_c(JitcEnv *jitc, JitcCFunc *func, void *arg0, void **arg1, void **arg2);
+
+void jitc_set           (JitcEnv *jitc, void *dest, int value);
+void jitc_copy          (JitcEnv *jitc, void *dest, const void *src, int size);
+void jitc_int_op        (JitcEnv *jitc, int op, int *dest, const int *src);
+void jitc_int_op_imm    (JitcEnv *jitc, int op, int *dest, int value);
+void jitc_float_op      (JitcEnv *jitc, int op, float *dest, const float *src);
+void jitc_float_op_imm  (JitcEnv *jitc, int op, float *dest, float value);
+void jitc_int_test      (JitcEnv *jitc, int test, const int *a, const int *b);
+void jitc_int_test_imm  (JitcEnv *jitc, int test, const int *a, int value);
+void jitc_float_test    (JitcEnv *jitc, int test, const float *a, const float *b);
+void jitc_float_test_imm(JitcEnv *jitc, int test, const float *a, float value);
+void jitc_not           (JitcEnv *jitc);
+
+/* private methods, shared by the backends */
+void jitc_add_uchar(JitcEnv *jitc, unsigned char c);
+void jitc_add_uint (JitcEnv *jitc, unsigned int i);
+void jitc_add_ref  (JitcEnv *jitc, int label, int kind);
+void jitc_forget_addr(JitcEnv *jitc);
+
+/* implemented by the backends */
+void jitc_backend_prologue(JitcEnv *jitc);
+int  jitc_backend_patch(JitcEnv *jitc, JitcLabelRef *ref, int address);
+
+#endif
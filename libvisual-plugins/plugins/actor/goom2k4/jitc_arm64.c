@@ -0,0 +1,350 @@
+#include "jitc.h"
+
+#ifdef JITC_ARM64
+
+/**
+ * AArch64 backend of the GoomSL jitc.
+ *
+ * x9 and x10 hold the addresses of the variables, w11-12 and s0-1 their
+ * values and w19 the flag. The GoomSL calls push the link register, so the
+ * functions of a script can call each other.
+ */
+
+#define X0  0
+#define X1  1
+#define X2  2
+#define X9  9
+#define X10 10
+#define W11 11
+#define W12 12
+#define X16 16
+#define W19 19
+#define X30 30
+
+/* condition codes */
+#define COND_EQ 0x0
+#define COND_MI 0x4
+#define COND_LT 0xb
+
+#define JITC_ADDR_REG(i) ((i) == 0 ? X9 : X10)
+
+/* movz / movk */
+static void jitc_load_imm(JitcEnv *jitc, int reg, unsigned long long value, int sf)
+{
+  int hw, first = 1;
+  int nbhw = sf ? 4 : 2;
+
+  for (hw = 0; hw < nbhw; ++hw) {
+    unsigned int imm16 = (value >> (hw * 16)) & 0xffff;
+    if ((imm16 != 0) || (hw == 0)) {
+      unsigned int op = first ? 0x52800000 : 0x72800000;
+      if (sf) op |= 0x80000000;
+      jitc_add_uint(jitc, op | (hw << 21) | (imm16 << 5) | reg);
+      first = 0;
+    }
+  }
+}
+
+static void jitc_load_ptr(JitcEnv *jitc, int reg, const void *ptr)
+{
+  jitc_load_imm(jitc, reg, (unsigned long long)(size_t)ptr, 1);
+}
+
+/**
+ * Returns the register holding the address ptr, loads it in the address
+ * register other than keep when none does.
+ */
+static int jitc_addr(JitcEnv *jitc, const void *ptr, int keep)
+{
+  int i;
+  for (i = 0; i < 2; ++i)
+    if (jitc->addr[i] == ptr)
+      return JITC_ADDR_REG(i);
+
+  i = (keep == X9) ? 1 : 0;
+  jitc->addr[i] = ptr;
+  jitc_load_ptr(jitc, JITC_ADDR_REG(i), ptr);
+  return JITC_ADDR_REG(i);
+}
+
+/* ldr / str with an unsigned offset, in units of the access size */
+#define LDR_W 0xb9400000
+#define STR_W 0xb9000000
+#define LDR_X 0xf9400000
+#define STR_X 0xf9000000
+#define LDR_S 0xbd400000
+#define STR_S 0xbd000000
+#define LDRB  0x39400000
+#define STRB  0x39000000
+
+static void jitc_ldst(JitcEnv *jitc, unsigned int op, int rt, int rn, int offset)
+{
+  jitc_add_uint(jitc, op | (offset << 10) | (rn << 5) | rt);
+}
+
+/* str x30, [sp, #-16]! */
+static void jitc_push_lr(JitcEnv *jitc)
+{
+  jitc_add_uint(jitc, 0xf81f0ffe);
+}
+
+/* ldr x30, [sp], #16 */
+static void jitc_pop_lr(JitcEnv *jitc)
+{
+  jitc_add_uint(jitc, 0xf84107fe);
+}
+
+/* cset w19, cond */
+static void jitc_set_flag(JitcEnv *jitc, int cond)
+{
+  jitc_add_uint(jitc, 0x1a9f07e0 | ((cond ^ 1) << 12) | W19);
+}
+
+void jitc_backend_prologue(JitcEnv *jitc)
+{
+  jitc_add_uint(jitc, 0xa9be7bfd); /* stp x29, x30, [sp, #-32]! */
+  jitc_add_uint(jitc, 0x910003fd); /* mov x29, sp */
+  jitc_add_uint(jitc, 0xa90153f3); /* stp x19, x20, [sp, #16] */
+  jitc_add_uint(jitc, 0x2a1f03f3); /* mov w19, wzr */
+  jitc_add_ref(jitc, 0, JITC_REF_CALL);
+  jitc_add_uint(jitc, 0x94000000); /* bl 0 */
+  jitc_add_uint(jitc, 0xa94153f3); /* ldp x19, x20, [sp, #16] */
+  jitc_add_uint(jitc, 0xa8c27bfd); /* ldp x29, x30, [sp], #32 */
+  jitc_add_uint(jitc, 0xd65f03c0); /* ret */
+  jitc_forget_addr(jitc);
+}
+
+int jitc_backend_patch(JitcEnv *jitc, JitcLabelRef *ref, int address)
+{
+  unsigned char *p = jitc->memory + ref->address;
+  unsigned int instr = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+  int offset = (address - ref->address) / 4;
+
+  if (ref->kind == JITC_REF_COND) {
+    /* cbz / cbnz, imm19 */
+    if ((offset < -(1 << 18)) || (offset >= (1 << 18)))
+      return 0;
+    instr |= (offset & 0x7ffff) << 5;
+  }
+  else {
+    /* b / bl, imm26 */
+    if ((offset < -(1 << 25)) || (offset >= (1 << 25)))
+      return 0;
+    instr |= offset & 0x3ffffff;
+  }
+
+  p[0] = instr & 0xff;
+  p[1] = (instr >> 8) & 0xff;
+  p[2] = (instr >> 16) & 0xff;
+  p[3] = (instr >> 24) & 0xff;
+  return 1;
+}
+
+void jitc_jump(JitcEnv *jitc, int label)
+{
+  jitc_add_ref(jitc, label, JITC_REF_JUMP);
+  jitc_add_uint(jitc, 0x14000000); /* b */
+}
+
+void jitc_jump_zero(JitcEnv *jitc, int label)
+{
+  jitc_add_ref(jitc, label, JITC_REF_COND);
+  jitc_add_uint(jitc, 0x34000000 | W19); /* cbz w19 */
+}
+
+void jitc_jump_not_zero(JitcEnv *jitc, int label)
+{
+  jitc_add_ref(jitc, label, JITC_REF_COND);
+  jitc_add_uint(jitc, 0x35000000 | W19); /* cbnz w19 */
+}
+
+void jitc_call(JitcEnv *jitc, int label)
+{
+  jitc_push_lr(jitc);
+  jitc_add_ref(jitc, label, JITC_REF_CALL);
+  jitc_add_uint(jitc, 0x94000000); /* bl */
+  jitc_pop_lr(jitc);
+  jitc_forget_addr(jitc);
+}
+
+void jitc_ret(JitcEnv *jitc)
+{
+  jitc_add_uint(jitc, 0xd65f03c0);
+}
+
+void jitc_call_c(JitcEnv *jitc, JitcCFunc *func, void *arg0, void **arg1, void **arg2)
+{
+  jitc_push_lr(jitc);
+  jitc_load_ptr(jitc, X0, arg0);
+  jitc_load_ptr(jitc, X16, arg1);
+  jitc_ldst(jitc, LDR_X, X1, X16, 0);
+  jitc_load_ptr(jitc, X16, arg2);
+  jitc_ldst(jitc, LDR_X, X2, X16, 0);
+  jitc_load_ptr(jitc, X16, func);
+  jitc_ldst(jitc, LDR_X, X16, X16, 0);
+  jitc_add_uint(jitc, 0xd63f0000 | (X16 << 5)); /* blr x16 */
+  jitc_pop_lr(jitc);
+  jitc_forget_addr(jitc);
+}
+
+void jitc_set(JitcEnv *jitc, void *dest, int value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  jitc_load_imm(jitc, W11, (unsigned int)value, 0);
+  jitc_ldst(jitc, STR_W, W11, d, 0);
+}
+
+void jitc_copy(JitcEnv *jitc, void *dest, const void *src, int size)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+  int offset = 0;
+
+  /* the scaled offsets reach 32k, far more than the structs */
+  if (size > 4095) {
+    jitc->error = 1;
+    return;
+  }
+
+  while (offset < size) {
+    if (((offset & 7) == 0) && (size - offset >= 8)) {
+      jitc_ldst(jitc, LDR_X, W11, s, offset / 8);
+      jitc_ldst(jitc, STR_X, W11, d, offset / 8);
+      offset += 8;
+    }
+    else if (((offset & 3) == 0) && (size - offset >= 4)) {
+      jitc_ldst(jitc, LDR_W, W11, s, offset / 4);
+      jitc_ldst(jitc, STR_W, W11, d, offset / 4);
+      offset += 4;
+    }
+    else {
+      jitc_ldst(jitc, LDRB, W11, s, offset);
+      jitc_ldst(jitc, STRB, W11, d, offset);
+      offset += 1;
+    }
+  }
+}
+
+/* add / sub / mul / sdiv w11, w11, w12 */
+static void jitc_int_op_reg(JitcEnv *jitc, int op)
+{
+  static const unsigned int ops[] = { 0x0b000000, 0x4b000000, 0x1b007c00, 0x1ac00c00 };
+  jitc_add_uint(jitc, ops[op] | (W12 << 16) | (W11 << 5) | W11);
+}
+
+void jitc_int_op(JitcEnv *jitc, int op, int *dest, const int *src)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+
+  jitc_ldst(jitc, LDR_W, W11, d, 0);
+  jitc_ldst(jitc, LDR_W, W12, s, 0);
+  jitc_int_op_reg(jitc, op);
+  jitc_ldst(jitc, STR_W, W11, d, 0);
+}
+
+void jitc_int_op_imm(JitcEnv *jitc, int op, int *dest, int value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+
+  jitc_ldst(jitc, LDR_W, W11, d, 0);
+  jitc_load_imm(jitc, W12, (unsigned int)value, 0);
+  jitc_int_op_reg(jitc, op);
+  jitc_ldst(jitc, STR_W, W11, d, 0);
+}
+
+/* fadd / fsub / fmul / fdiv s0, s0, s1 */
+static void jitc_float_op_reg(JitcEnv *jitc, int op)
+{
+  static const unsigned int ops[] = { 0x1e202800, 0x1e203800, 0x1e200800, 0x1e201800 };
+  jitc_add_uint(jitc, ops[op] | (1 << 16) | (0 << 5) | 0);
+}
+
+/* fmov s1, w12 */
+static void jitc_load_s1(JitcEnv *jitc, float value)
+{
+  union { float f; unsigned int i; } v;
+  v.f = value;
+  jitc_load_imm(jitc, W12, v.i, 0);
+  jitc_add_uint(jitc, 0x1e270000 | (W12 << 5) | 1);
+}
+
+void jitc_float_op(JitcEnv *jitc, int op, float *dest, const float *src)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+
+  jitc_ldst(jitc, LDR_S, 0, d, 0);
+  jitc_ldst(jitc, LDR_S, 1, s, 0);
+  jitc_float_op_reg(jitc, op);
+  jitc_ldst(jitc, STR_S, 0, d, 0);
+}
+
+void jitc_float_op_imm(JitcEnv *jitc, int op, float *dest, float value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+
+  jitc_ldst(jitc, LDR_S, 0, d, 0);
+  jitc_load_s1(jitc, value);
+  jitc_float_op_reg(jitc, op);
+  jitc_ldst(jitc, STR_S, 0, d, 0);
+}
+
+/* cmp w11, w12 */
+static void jitc_int_test_reg(JitcEnv *jitc, int test)
+{
+  jitc_add_uint(jitc, 0x6b00001f | (W12 << 16) | (W11 << 5));
+  jitc_set_flag(jitc, test == JITC_TEST_EQUAL ? COND_EQ : COND_LT);
+}
+
+void jitc_int_test(JitcEnv *jitc, int test, const int *a, const int *b)
+{
+  int ra = jitc_addr(jitc, a, -1);
+  int rb = jitc_addr(jitc, b, ra);
+
+  jitc_ldst(jitc, LDR_W, W11, ra, 0);
+  jitc_ldst(jitc, LDR_W, W12, rb, 0);
+  jitc_int_test_reg(jitc, test);
+}
+
+void jitc_int_test_imm(JitcEnv *jitc, int test, const int *a, int value)
+{
+  int ra = jitc_addr(jitc, a, -1);
+
+  jitc_ldst(jitc, LDR_W, W11, ra, 0);
+  jitc_load_imm(jitc, W12, (unsigned int)value, 0);
+  jitc_int_test_reg(jitc, test);
+}
+
+/* fcmp s0, s1, mi and eq are false when unordered */
+static void jitc_float_test_reg(JitcEnv *jitc, int test)
+{
+  jitc_add_uint(jitc, 0x1e202000 | (1 << 16) | (0 << 5));
+  jitc_set_flag(jitc, test == JITC_TEST_EQUAL ? COND_EQ : COND_MI);
+}
+
+void jitc_float_test(JitcEnv *jitc, int test, const float *a, const float *b)
+{
+  int ra = jitc_addr(jitc, a, -1);
+  int rb = jitc_addr(jitc, b, ra);
+
+  jitc_ldst(jitc, LDR_S, 0, ra, 0);
+  jitc_ldst(jitc, LDR_S, 1, rb, 0);
+  jitc_float_test_reg(jitc, test);
+}
+
+void jitc_float_test_imm(JitcEnv *jitc, int test, const float *a, float value)
+{
+  int ra = jitc_addr(jitc, a, -1);
+
+  jitc_ldst(jitc, LDR_S, 0, ra, 0);
+  jitc_load_s1(jitc, value);
+  jitc_float_test_reg(jitc, test);
+}
+
+void jitc_not(JitcEnv *jitc)
+{
+  jitc_add_uint(jitc, 0x52000000 | (W19 << 5) | W19); /* eor w19, w19, #1 */
+}
+
+#endif /* JITC_ARM64 */
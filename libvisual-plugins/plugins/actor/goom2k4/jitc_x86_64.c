@@ -0,0 +1,352 @@
+#include "jitc.h"
+
+#ifdef JITC_X86_64
+
+/**
+ * x86-64 backend of the GoomSL jitc, for the System V calling convention.
+ *
+ * rcx and rsi hold the addresses of the variables, eax and xmm0-1 their
+ * values, ebx the flag and r12 the stack pointer around the calls to C.
+ */
+
+/* {{{ Registres Generaux */
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+/* }}} */
+
+#define JITC_ADDR_REG(i) ((i) == 0 ? RCX : RSI)
+
+#define JITC_MODRM(jitc,mod,reg,rm) jitc_add_uchar(jitc, ((mod) << 6) | ((reg) << 3) | (rm))
+
+static void jitc_add_ptr(JitcEnv *jitc, const void *ptr)
+{
+  unsigned long long p = (unsigned long long)(size_t)ptr;
+  jitc_add_uint(jitc, (unsigned int)p);
+  jitc_add_uint(jitc, (unsigned int)(p >> 32));
+}
+
+/* mov reg, imm64 */
+static void jitc_load_ptr(JitcEnv *jitc, int reg, const void *ptr)
+{
+  jitc_add_uchar(jitc, 0x48);
+  jitc_add_uchar(jitc, 0xb8 + reg);
+  jitc_add_ptr(jitc, ptr);
+}
+
+/**
+ * Returns the register holding the address ptr, loads it in the address
+ * register other than the one of keep when none does.
+ */
+static int jitc_addr(JitcEnv *jitc, const void *ptr, int keep)
+{
+  int i;
+  for (i = 0; i < 2; ++i)
+    if (jitc->addr[i] == ptr)
+      return JITC_ADDR_REG(i);
+
+  i = (keep == RCX) ? 1 : 0;
+  jitc->addr[i] = ptr;
+  jitc_load_ptr(jitc, JITC_ADDR_REG(i), ptr);
+  return JITC_ADDR_REG(i);
+}
+
+/* op reg, [addr] */
+static void jitc_op_mem(JitcEnv *jitc, int op, int reg, int addr)
+{
+  jitc_add_uchar(jitc, op);
+  JITC_MODRM(jitc, 0x00, reg, addr);
+}
+
+/* sse op xmm, [addr] */
+static void jitc_sse_mem(JitcEnv *jitc, int op, int xmm, int addr)
+{
+  jitc_add_uchar(jitc, 0xf3);
+  jitc_add_uchar(jitc, 0x0f);
+  jitc_op_mem(jitc, op, xmm, addr);
+}
+
+/* setcc bl, movzx ebx, bl */
+static void jitc_set_flag(JitcEnv *jitc, int setcc)
+{
+  jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, setcc); jitc_add_uchar(jitc, 0xc3);
+  jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0xb6); jitc_add_uchar(jitc, 0xdb);
+}
+
+void jitc_backend_prologue(JitcEnv *jitc)
+{
+  jitc_add_uchar(jitc, 0x53);                           /* push rbx */
+  jitc_add_uchar(jitc, 0x41); jitc_add_uchar(jitc, 0x54); /* push r12 */
+  jitc_add_uchar(jitc, 0x31); jitc_add_uchar(jitc, 0xdb); /* xor ebx, ebx */
+  jitc_call(jitc, 0);
+  jitc_add_uchar(jitc, 0x41); jitc_add_uchar(jitc, 0x5c); /* pop r12 */
+  jitc_add_uchar(jitc, 0x5b);                           /* pop rbx */
+  jitc_add_uchar(jitc, 0xc3);                           /* ret */
+}
+
+int jitc_backend_patch(JitcEnv *jitc, JitcLabelRef *ref, int address)
+{
+  /* all the references are rel32 at the end of the instruction */
+  unsigned int offset = address - (ref->address + 4);
+  jitc->memory[ref->address]     = offset & 0xff;
+  jitc->memory[ref->address + 1] = (offset >> 8) & 0xff;
+  jitc->memory[ref->address + 2] = (offset >> 16) & 0xff;
+  jitc->memory[ref->address + 3] = (offset >> 24) & 0xff;
+  return 1;
+}
+
+void jitc_jump(JitcEnv *jitc, int label)
+{
+  jitc_add_uchar(jitc, 0xe9);
+  jitc_add_ref(jitc, label, JITC_REF_JUMP);
+  jitc_add_uint(jitc, 0);
+}
+
+static void jitc_jump_cond(JitcEnv *jitc, int cond, int label)
+{
+  jitc_add_uchar(jitc, 0x85); jitc_add_uchar(jitc, 0xdb); /* test ebx, ebx */
+  jitc_add_uchar(jitc, 0x0f);
+  jitc_add_uchar(jitc, cond);
+  jitc_add_ref(jitc, label, JITC_REF_COND);
+  jitc_add_uint(jitc, 0);
+}
+
+void jitc_jump_zero(JitcEnv *jitc, int label)
+{
+  jitc_jump_cond(jitc, 0x84, label); /* je */
+}
+
+void jitc_jump_not_zero(JitcEnv *jitc, int label)
+{
+  jitc_jump_cond(jitc, 0x85, label); /* jne */
+}
+
+void jitc_call(JitcEnv *jitc, int label)
+{
+  jitc_add_uchar(jitc, 0xe8);
+  jitc_add_ref(jitc, label, JITC_REF_CALL);
+  jitc_add_uint(jitc, 0);
+  jitc_forget_addr(jitc);
+}
+
+void jitc_ret(JitcEnv *jitc)
+{
+  jitc_add_uchar(jitc, 0xc3);
+}
+
+void jitc_call_c(JitcEnv *jitc, JitcCFunc *func, void *arg0, void **arg1, void **arg2)
+{
+  /* mov rdi, arg0 */
+  jitc_load_ptr(jitc, RDI, arg0);
+  /* mov rax, arg1; mov rsi, [rax] */
+  jitc_load_ptr(jitc, RAX, arg1);
+  jitc_add_uchar(jitc, 0x48); jitc_op_mem(jitc, 0x8b, RSI, RAX);
+  /* mov rax, arg2; mov rdx, [rax] */
+  jitc_load_ptr(jitc, RAX, arg2);
+  jitc_add_uchar(jitc, 0x48); jitc_op_mem(jitc, 0x8b, RDX, RAX);
+  /* mov rax, func; mov rax, [rax] */
+  jitc_load_ptr(jitc, RAX, func);
+  jitc_add_uchar(jitc, 0x48); jitc_op_mem(jitc, 0x8b, RAX, RAX);
+
+  /* the GoomSL calls leave the stack unaligned */
+  jitc_add_uchar(jitc, 0x49); jitc_add_uchar(jitc, 0x89); jitc_add_uchar(jitc, 0xe4); /* mov r12, rsp */
+  jitc_add_uchar(jitc, 0x48); jitc_add_uchar(jitc, 0x83); jitc_add_uchar(jitc, 0xe4);
+  jitc_add_uchar(jitc, 0xf0);                                                      /* and rsp, -16 */
+  jitc_add_uchar(jitc, 0xff); jitc_add_uchar(jitc, 0xd0);                          /* call rax */
+  jitc_add_uchar(jitc, 0x4c); jitc_add_uchar(jitc, 0x89); jitc_add_uchar(jitc, 0xe4); /* mov rsp, r12 */
+
+  jitc_forget_addr(jitc);
+}
+
+void jitc_set(JitcEnv *jitc, void *dest, int value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  jitc_op_mem(jitc, 0xc7, 0, d); /* mov dword [d], imm32 */
+  jitc_add_uint(jitc, value);
+}
+
+void jitc_copy(JitcEnv *jitc, void *dest, const void *src, int size)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+  int offset = 0;
+
+  while (offset < size) {
+    if (size - offset >= 8) {
+      /* mov rax, [s + offset]; mov [d + offset], rax */
+      jitc_add_uchar(jitc, 0x48); jitc_add_uchar(jitc, 0x8b); JITC_MODRM(jitc, 0x02, RAX, s);
+      jitc_add_uint(jitc, offset);
+      jitc_add_uchar(jitc, 0x48); jitc_add_uchar(jitc, 0x89); JITC_MODRM(jitc, 0x02, RAX, d);
+      jitc_add_uint(jitc, offset);
+      offset += 8;
+    }
+    else if (size - offset >= 4) {
+      jitc_add_uchar(jitc, 0x8b); JITC_MODRM(jitc, 0x02, RAX, s);
+      jitc_add_uint(jitc, offset);
+      jitc_add_uchar(jitc, 0x89); JITC_MODRM(jitc, 0x02, RAX, d);
+      jitc_add_uint(jitc, offset);
+      offset += 4;
+    }
+    else {
+      /* movzx eax, byte [s + offset]; mov [d + offset], al */
+      jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0xb6); JITC_MODRM(jitc, 0x02, RAX, s);
+      jitc_add_uint(jitc, offset);
+      jitc_add_uchar(jitc, 0x88); JITC_MODRM(jitc, 0x02, RAX, d);
+      jitc_add_uint(jitc, offset);
+      offset += 1;
+    }
+  }
+}
+
+void jitc_int_op(JitcEnv *jitc, int op, int *dest, const int *src)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+
+  switch (op) {
+    case JITC_OP_ADD:
+      jitc_op_mem(jitc, 0x8b, RAX, s); /* mov eax, [s] */
+      jitc_op_mem(jitc, 0x01, RAX, d); /* add [d], eax */
+      return;
+    case JITC_OP_SUB:
+      jitc_op_mem(jitc, 0x8b, RAX, s); /* mov eax, [s] */
+      jitc_op_mem(jitc, 0x29, RAX, d); /* sub [d], eax */
+      return;
+    case JITC_OP_MUL:
+      jitc_op_mem(jitc, 0x8b, RAX, s); /* mov eax, [s] */
+      jitc_add_uchar(jitc, 0x0f); jitc_op_mem(jitc, 0xaf, RAX, d); /* imul eax, [d] */
+      break;
+    case JITC_OP_DIV:
+      jitc_op_mem(jitc, 0x8b, RAX, d); /* mov eax, [d] */
+      jitc_add_uchar(jitc, 0x99);      /* cdq */
+      jitc_op_mem(jitc, 0xf7, 7, s);   /* idiv dword [s] */
+      break;
+  }
+  jitc_op_mem(jitc, 0x89, RAX, d); /* mov [d], eax */
+}
+
+void jitc_int_op_imm(JitcEnv *jitc, int op, int *dest, int value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+
+  switch (op) {
+    case JITC_OP_ADD:
+      jitc_op_mem(jitc, 0x81, 0, d); /* add dword [d], imm32 */
+      jitc_add_uint(jitc, value);
+      return;
+    case JITC_OP_SUB:
+      jitc_op_mem(jitc, 0x81, 5, d); /* sub dword [d], imm32 */
+      jitc_add_uint(jitc, value);
+      return;
+    case JITC_OP_MUL:
+      jitc_op_mem(jitc, 0x69, RAX, d); /* imul eax, [d], imm32 */
+      jitc_add_uint(jitc, value);
+      break;
+    case JITC_OP_DIV:
+      jitc_op_mem(jitc, 0x8b, RAX, d);                        /* mov eax, [d] */
+      jitc_add_uchar(jitc, 0xb8 + RDI); jitc_add_uint(jitc, value); /* mov edi, imm32 */
+      jitc_add_uchar(jitc, 0x99);                             /* cdq */
+      jitc_add_uchar(jitc, 0xf7); JITC_MODRM(jitc, 0x03, 7, RDI); /* idiv edi */
+      break;
+  }
+  jitc_op_mem(jitc, 0x89, RAX, d); /* mov [d], eax */
+}
+
+static const unsigned char jitc_sse_ops[] = { 0x58, 0x5c, 0x59, 0x5e }; /* add sub mul div */
+
+void jitc_float_op(JitcEnv *jitc, int op, float *dest, const float *src)
+{
+  int d = jitc_addr(jitc, dest, -1);
+  int s = jitc_addr(jitc, src, d);
+
+  jitc_sse_mem(jitc, 0x10, 0, d);               /* movss xmm0, [d] */
+  jitc_sse_mem(jitc, jitc_sse_ops[op], 0, s);   /* opss xmm0, [s] */
+  jitc_sse_mem(jitc, 0x11, 0, d);               /* movss [d], xmm0 */
+}
+
+/* mov eax, imm32; movd xmm1, eax */
+static void jitc_load_xmm1(JitcEnv *jitc, float value)
+{
+  union { float f; unsigned int i; } v;
+  v.f = value;
+  jitc_add_uchar(jitc, 0xb8 + RAX); jitc_add_uint(jitc, v.i);
+  jitc_add_uchar(jitc, 0x66); jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0x6e); jitc_add_uchar(jitc, 0xc8);
+}
+
+void jitc_float_op_imm(JitcEnv *jitc, int op, float *dest, float value)
+{
+  int d = jitc_addr(jitc, dest, -1);
+
+  jitc_load_xmm1(jitc, value);
+  jitc_sse_mem(jitc, 0x10, 0, d);                        /* movss xmm0, [d] */
+  jitc_add_uchar(jitc, 0xf3); jitc_add_uchar(jitc, 0x0f);
+  jitc_add_uchar(jitc, jitc_sse_ops[op]); jitc_add_uchar(jitc, 0xc1); /* opss xmm0, xmm1 */
+  jitc_sse_mem(jitc, 0x11, 0, d);                        /* movss [d], xmm0 */
+}
+
+void jitc_int_test(JitcEnv *jitc, int test, const int *a, const int *b)
+{
+  int ra = jitc_addr(jitc, a, -1);
+  int rb = jitc_addr(jitc, b, ra);
+
+  jitc_op_mem(jitc, 0x8b, RAX, ra); /* mov eax, [a] */
+  jitc_op_mem(jitc, 0x3b, RAX, rb); /* cmp eax, [b] */
+  jitc_set_flag(jitc, test == JITC_TEST_EQUAL ? 0x94 : 0x9c); /* sete / setl */
+}
+
+void jitc_int_test_imm(JitcEnv *jitc, int test, const int *a, int value)
+{
+  int ra = jitc_addr(jitc, a, -1);
+
+  jitc_op_mem(jitc, 0x81, 7, ra); /* cmp dword [a], imm32 */
+  jitc_add_uint(jitc, value);
+  jitc_set_flag(jitc, test == JITC_TEST_EQUAL ? 0x94 : 0x9c); /* sete / setl */
+}
+
+/* compares xmm0 and xmm1 like C does, false when unordered */
+static void jitc_float_test_xmm(JitcEnv *jitc, int test)
+{
+  if (test == JITC_TEST_EQUAL) {
+    jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0x2e); jitc_add_uchar(jitc, 0xc1); /* ucomiss xmm0, xmm1 */
+    jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0x94); jitc_add_uchar(jitc, 0xc3); /* sete bl */
+    jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0x9b); jitc_add_uchar(jitc, 0xc0); /* setnp al */
+    jitc_add_uchar(jitc, 0x20); jitc_add_uchar(jitc, 0xc3);                          /* and bl, al */
+    jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0xb6); jitc_add_uchar(jitc, 0xdb); /* movzx ebx, bl */
+  }
+  else {
+    /* a < b is b > a */
+    jitc_add_uchar(jitc, 0x0f); jitc_add_uchar(jitc, 0x2e); jitc_add_uchar(jitc, 0xc8); /* ucomiss xmm1, xmm0 */
+    jitc_set_flag(jitc, 0x97); /* seta */
+  }
+}
+
+void jitc_float_test(JitcEnv *jitc, int test, const float *a, const float *b)
+{
+  int ra = jitc_addr(jitc, a, -1);
+  int rb = jitc_addr(jitc, b, ra);
+
+  jitc_sse_mem(jitc, 0x10, 0, ra); /* movss xmm0, [a] */
+  jitc_sse_mem(jitc, 0x10, 1, rb); /* movss xmm1, [b] */
+  jitc_float_test_xmm(jitc, test);
+}
+
+void jitc_float_test_imm(JitcEnv *jitc, int test, const float *a, float value)
+{
+  int ra = jitc_addr(jitc, a, -1);
+
+  jitc_load_xmm1(jitc, value);
+  jitc_sse_mem(jitc, 0x10, 0, ra); /* movss xmm0, [a] */
+  jitc_float_test_xmm(jitc, test);
+}
+
+void jitc_not(JitcEnv *jitc)
+{
+  jitc_add_uchar(jitc, 0x83); jitc_add_uchar(jitc, 0xf3); jitc_add_uchar(jitc, 0x01); /* xor ebx, 1 */
+}
+
+#endif /* JITC_X86_64 */
@@ -1,3 +1,5 @@
+#include <libvisual/libvisual.h>
+
 #include "goom_plugin_info.h"
 #include "goom_fx.h"
 #include "cpu_info.h"
@@ -19,6 +21,9 @@
 #include "mmx.h"
 #endif /* CPU_X86 */
 
+#include "zoom_simd.h"
+#include "convolve_simd.h"
+
 
 
 static void setOptimizedMethods(PluginInfo *p) {
@@ -28,6 +33,8 @@ static void setOptimizedMethods(PluginInfo *p) {
     /* set default methods */
     p->methods.draw_line = draw_line;
     p->methods.zoom_filter = zoom_filter_c;
+    p->methods.zoom_vectors = zoom_vectors_c;
+    p->methods.convolve_rows = convolve_rows_c;
 /*    p->methods.create_output_with_brightness = create_output_with_brightness;*/
 
 #ifdef CPU_X86
@@ -50,6 +57,32 @@ static void setOptimizedMethods(PluginInfo *p) {
             printf ("Too bad ! No SIMD optimization available for your CPU.\n");
 #endif
 #endif /* CPU_X86 */
+
+	/* The SSE2, AVX2 and NEON zooms are bit exact with the C one, and run in bands
+	 * on the VisJobs workers, like the SSE2 and NEON zoom vectors and the SSE4.1,
+	 * AVX2 and NEON convolves. Arranged from slow to fast, so the slower version
+	 * gets overloaded every time */
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+	if (visual_cpu_get_sse2 ()) {
+		p->methods.zoom_filter = zoom_filter_sse2;
+		p->methods.zoom_vectors = zoom_vectors_sse2;
+	}
+
+	/* the SSE4.1 convolve looks its brightnesses up with the SSSE3 pshufb */
+	if (visual_cpu_get_ssse3 () && visual_cpu_get_sse41 ())
+		p->methods.convolve_rows = convolve_rows_sse41;
+
+	if (visual_cpu_get_avx2 ()) {
+		p->methods.zoom_filter = zoom_filter_avx2;
+		p->methods.convolve_rows = convolve_rows_avx2;
+	}
+#elif defined(GOOM_NEON)
+	if (visual_cpu_get_neon ()) {
+		p->methods.zoom_filter = zoom_filter_neon;
+		p->methods.zoom_vectors = zoom_vectors_neon;
+		p->methods.convolve_rows = convolve_rows_neon;
+	}
+#endif
 	
 #ifdef CPU_POWERPC
 
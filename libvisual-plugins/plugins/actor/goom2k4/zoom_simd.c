@@ -0,0 +1,640 @@
+/* zoom_simd.c
+ * SSE2, AVX2 and NEON versions of the zoom filter, SSE2 and NEON versions of
+ * the zoom vectors.
+ *
+ * They compute the same thing than zoom_rows_c, in batchs of pixels:
+ *  - the positions and the coefficients of a batch are computed in vectors,
+ *  - then the 4 source pixels of every destination pixel are blended in vectors.
+ * The sums of the 4 taps never go above 0xffff, so the blend is done on 16 bits
+ * words and the "if (sum > 5) sum -= 5" is an unsigned saturated substraction.
+ * The alpha channel of the destination is left as it is, like in zoom_rows_c.
+ *
+ * The zoom vectors do the float operations of zoom_vectors_c in the same order,
+ * 4 columns at a time.
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdint.h>
+
+#include "goom_config.h"
+#include "goom_graphic.h"
+#include "goom_fx.h"
+#include "zoom_simd.h"
+
+#ifdef GOOM_NEON
+#include <arm_neon.h>
+#endif
+
+/* pixels whose positions and coefficients are computed before they are blended */
+#define ZOOM_SIMD_BATCH 64
+
+/* the source pixel, coefficients and range mask of every pixel of a batch */
+typedef struct {
+    int32_t pos[ZOOM_SIMD_BATCH];
+    int32_t coef[ZOOM_SIMD_BATCH];
+    int32_t mask[ZOOM_SIMD_BATCH];
+} ZoomLanes;
+
+/* constants of a zoom, repeated for every lane of the widest vector */
+typedef struct {
+    int32_t ratio[8];
+    int32_t ax[8];      /* biased, the range is checked with unsigned compares */
+    int32_t ay[8];
+    int32_t bias[8];
+    int32_t width[8];
+    int32_t fifteen[8];
+} ZoomParams;
+
+/* constants of a row of zoom vectors, repeated for every lane */
+typedef struct {
+    float Y[4];
+    float addX[4];
+    float speed[4];
+    float sub[4];
+    float div[4];
+    float mul[4];
+    float scale[4];
+    float low[4];
+    float high[4];
+    float min[4];
+    float inv_ratio[4];
+    int32_t abs[4];
+    int32_t middleX[4];
+    int32_t middleY[4];
+} ZoomVectorParams;
+
+/* shift that turns a 32 bits lane of ones into the mask of the alpha byte of a Pixel */
+#ifdef COLOR_BGRA
+#define ZOOM_ALPHA_SHIFT "sll"
+#else
+#define ZOOM_ALPHA_SHIFT "srl"
+#endif
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+static void zoom_params_init (ZoomParams *params, ZoomRows *rows)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        params->ratio[i] = rows->buffratio;
+        params->ax[i] = (int32_t) ((((uint32_t) rows->prevX - 1) << 4) ^ 0x80000000);
+        params->ay[i] = (int32_t) ((((uint32_t) rows->prevY - 1) << 4) ^ 0x80000000);
+        params->bias[i] = INT32_MIN;
+        params->width[i] = rows->prevX;
+        params->fifteen[i] = 15;
+    }
+}
+
+static void zoom_rows_sse2 (ZoomRows *rows, int start, int end)
+{
+    ZoomLanes lanes;
+    ZoomParams params;
+    int *coefs = &rows->precalCoef[0][0];
+    intptr_t pitch = rows->prevX * sizeof (Pixel);
+    int i, j, n;
+
+    /* the source row is multiplied with pmaddwd, on 16 bits words */
+    if (rows->prevX > 32767 || rows->prevY > 32767) {
+        zoom_rows_c (rows, start, end);
+        return;
+    }
+
+    zoom_params_init (&params, rows);
+
+    for (i = start; i + 4 <= end; i += n) {
+        n = end - i < ZOOM_SIMD_BATCH ? (end - i) & ~3 : ZOOM_SIMD_BATCH;
+
+        for (j = 0; j < n; j += 4) {
+            __asm __volatile
+                ("\n\t movdqu (%[s]), %%xmm0"
+                 "\n\t movdqu 16(%[s]), %%xmm1"
+                 "\n\t movdqu (%[d]), %%xmm2"
+                 "\n\t movdqu 16(%[d]), %%xmm3"
+                 "\n\t movdqu (%[p]), %%xmm6"
+                 "\n\t psubd %%xmm0, %%xmm2"
+                 "\n\t psubd %%xmm1, %%xmm3"
+                 "\n\t movdqa %%xmm2, %%xmm4"
+                 "\n\t movdqa %%xmm3, %%xmm5"
+                 "\n\t psrlq $32, %%xmm4"
+                 "\n\t psrlq $32, %%xmm5"
+                 "\n\t pmuludq %%xmm6, %%xmm2"
+                 "\n\t pmuludq %%xmm6, %%xmm3"
+                 "\n\t pmuludq %%xmm6, %%xmm4"
+                 "\n\t pmuludq %%xmm6, %%xmm5"
+                 "\n\t pshufd $0x08, %%xmm2, %%xmm2"
+                 "\n\t pshufd $0x08, %%xmm3, %%xmm3"
+                 "\n\t pshufd $0x08, %%xmm4, %%xmm4"
+                 "\n\t pshufd $0x08, %%xmm5, %%xmm5"
+                 "\n\t punpckldq %%xmm4, %%xmm2"
+                 "\n\t punpckldq %%xmm5, %%xmm3"
+                 "\n\t psrad $16, %%xmm2"
+                 "\n\t psrad $16, %%xmm3"
+                 "\n\t paddd %%xmm2, %%xmm0"
+                 "\n\t paddd %%xmm3, %%xmm1"
+                 "\n\t movaps %%xmm0, %%xmm2"
+                 "\n\t shufps $0x88, %%xmm1, %%xmm0"
+                 "\n\t shufps $0xdd, %%xmm1, %%xmm2"
+                 "\n\t movdqu 96(%[p]), %%xmm6"
+                 "\n\t movdqa %%xmm0, %%xmm3"
+                 "\n\t movdqa %%xmm2, %%xmm4"
+                 "\n\t pxor %%xmm6, %%xmm3"
+                 "\n\t pxor %%xmm6, %%xmm4"
+                 "\n\t movdqu 32(%[p]), %%xmm5"
+                 "\n\t movdqu 64(%[p]), %%xmm6"
+                 "\n\t pcmpgtd %%xmm3, %%xmm5"
+                 "\n\t pcmpgtd %%xmm4, %%xmm6"
+                 "\n\t pand %%xmm6, %%xmm5"
+                 "\n\t movdqu 160(%[p]), %%xmm6"
+                 "\n\t movdqa %%xmm0, %%xmm3"
+                 "\n\t movdqa %%xmm2, %%xmm4"
+                 "\n\t pand %%xmm6, %%xmm3"
+                 "\n\t pand %%xmm6, %%xmm4"
+                 "\n\t pslld $4, %%xmm3"
+                 "\n\t por %%xmm4, %%xmm3"
+                 "\n\t movdqu 128(%[p]), %%xmm6"
+                 "\n\t psrad $4, %%xmm0"
+                 "\n\t psrad $4, %%xmm2"
+                 "\n\t pmaddwd %%xmm6, %%xmm2"
+                 "\n\t paddd %%xmm2, %%xmm0"
+                 "\n\t pand %%xmm5, %%xmm0"
+                 "\n\t movdqu %%xmm0, (%[l])"
+                 "\n\t movdqu %%xmm3, %c[oc](%[l])"
+                 "\n\t movdqu %%xmm5, %c[om](%[l])"
+                 :: [s] "r" (rows->brutS + (i + j) * 2), [d] "r" (rows->brutD + (i + j) * 2),
+                    [p] "r" (&params), [l] "r" (&lanes.pos[j]),
+                    [oc] "i" (ZOOM_SIMD_BATCH * 4), [om] "i" (ZOOM_SIMD_BATCH * 8)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6");
+        }
+
+        for (j = 0; j < n; j++)
+            lanes.coef[j] = coefs[lanes.coef[j]] & lanes.mask[j];
+
+        for (j = 0; j < n; j += 2) {
+            __asm __volatile
+                ("\n\t movq (%[a]), %%xmm0"
+                 "\n\t movq (%[a],%[w]), %%xmm1"
+                 "\n\t movq (%[b]), %%xmm2"
+                 "\n\t movq (%[b],%[w]), %%xmm3"
+                 "\n\t movq (%[c]), %%xmm4"
+                 "\n\t pxor %%xmm7, %%xmm7"
+                 "\n\t punpcklbw %%xmm7, %%xmm0"
+                 "\n\t punpcklbw %%xmm7, %%xmm1"
+                 "\n\t punpcklbw %%xmm7, %%xmm2"
+                 "\n\t punpcklbw %%xmm7, %%xmm3"
+                 "\n\t punpcklbw %%xmm4, %%xmm4"
+                 "\n\t movdqa %%xmm4, %%xmm5"
+                 "\n\t punpcklwd %%xmm4, %%xmm4"
+                 "\n\t punpckhwd %%xmm5, %%xmm5"
+                 "\n\t movdqa %%xmm4, %%xmm6"
+                 "\n\t punpcklbw %%xmm7, %%xmm4"
+                 "\n\t punpckhbw %%xmm7, %%xmm6"
+                 "\n\t pmullw %%xmm4, %%xmm0"
+                 "\n\t pmullw %%xmm6, %%xmm1"
+                 "\n\t paddw %%xmm1, %%xmm0"
+                 "\n\t movdqa %%xmm5, %%xmm6"
+                 "\n\t punpcklbw %%xmm7, %%xmm5"
+                 "\n\t punpckhbw %%xmm7, %%xmm6"
+                 "\n\t pmullw %%xmm5, %%xmm2"
+                 "\n\t pmullw %%xmm6, %%xmm3"
+                 "\n\t paddw %%xmm3, %%xmm2"
+                 "\n\t movdqa %%xmm0, %%xmm1"
+                 "\n\t punpcklqdq %%xmm2, %%xmm0"
+                 "\n\t punpckhqdq %%xmm2, %%xmm1"
+                 "\n\t paddw %%xmm1, %%xmm0"
+                 "\n\t pcmpeqw %%xmm6, %%xmm6"
+                 "\n\t psrlw $15, %%xmm6"
+                 "\n\t movdqa %%xmm6, %%xmm5"
+                 "\n\t psllw $2, %%xmm5"
+                 "\n\t por %%xmm6, %%xmm5"
+                 "\n\t psubusw %%xmm5, %%xmm0"
+                 "\n\t psrlw $8, %%xmm0"
+                 "\n\t packuswb %%xmm0, %%xmm0"
+                 "\n\t pcmpeqd %%xmm6, %%xmm6"
+                 "\n\t p" ZOOM_ALPHA_SHIFT "d $24, %%xmm6"
+                 "\n\t movq (%[d]), %%xmm1"
+                 "\n\t pand %%xmm6, %%xmm1"
+                 "\n\t pandn %%xmm0, %%xmm6"
+                 "\n\t por %%xmm1, %%xmm6"
+                 "\n\t movq %%xmm6, (%[d])"
+                 :: [a] "r" (rows->src + lanes.pos[j]), [b] "r" (rows->src + lanes.pos[j + 1]),
+                    [w] "r" (pitch), [c] "r" (&lanes.coef[j]), [d] "r" (rows->dest + i + j)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+        }
+    }
+
+    zoom_rows_c (rows, i, end);
+}
+
+static void zoom_rows_avx2 (ZoomRows *rows, int start, int end)
+{
+    ZoomLanes lanes;
+    ZoomParams params;
+    int i, j, n;
+
+    zoom_params_init (&params, rows);
+
+    for (i = start; i + 8 <= end; i += n) {
+        n = end - i < ZOOM_SIMD_BATCH ? (end - i) & ~7 : ZOOM_SIMD_BATCH;
+
+        for (j = 0; j < n; j += 8) {
+            __asm __volatile
+                ("\n\t vmovdqu (%[s]), %%ymm0"
+                 "\n\t vmovdqu 32(%[s]), %%ymm1"
+                 "\n\t vmovdqu (%[d]), %%ymm2"
+                 "\n\t vmovdqu 32(%[d]), %%ymm3"
+                 "\n\t vmovdqu (%[p]), %%ymm6"
+                 "\n\t vpsubd %%ymm0, %%ymm2, %%ymm2"
+                 "\n\t vpsubd %%ymm1, %%ymm3, %%ymm3"
+                 "\n\t vpmulld %%ymm6, %%ymm2, %%ymm2"
+                 "\n\t vpmulld %%ymm6, %%ymm3, %%ymm3"
+                 "\n\t vpsrad $16, %%ymm2, %%ymm2"
+                 "\n\t vpsrad $16, %%ymm3, %%ymm3"
+                 "\n\t vpaddd %%ymm2, %%ymm0, %%ymm0"
+                 "\n\t vpaddd %%ymm3, %%ymm1, %%ymm1"
+                 "\n\t vshufps $0x88, %%ymm1, %%ymm0, %%ymm2"
+                 "\n\t vshufps $0xdd, %%ymm1, %%ymm0, %%ymm3"
+                 "\n\t vpermq $0xd8, %%ymm2, %%ymm2"
+                 "\n\t vpermq $0xd8, %%ymm3, %%ymm3"
+                 "\n\t vmovdqu 96(%[p]), %%ymm6"
+                 "\n\t vpxor %%ymm6, %%ymm2, %%ymm4"
+                 "\n\t vpxor %%ymm6, %%ymm3, %%ymm5"
+                 "\n\t vmovdqu 32(%[p]), %%ymm6"
+                 "\n\t vpcmpgtd %%ymm4, %%ymm6, %%ymm4"
+                 "\n\t vmovdqu 64(%[p]), %%ymm6"
+                 "\n\t vpcmpgtd %%ymm5, %%ymm6, %%ymm5"
+                 "\n\t vpand %%ymm5, %%ymm4, %%ymm4"
+                 "\n\t vmovdqu 160(%[p]), %%ymm6"
+                 "\n\t vpand %%ymm6, %%ymm2, %%ymm0"
+                 "\n\t vpand %%ymm6, %%ymm3, %%ymm1"
+                 "\n\t vpslld $4, %%ymm0, %%ymm0"
+                 "\n\t vpor %%ymm1, %%ymm0, %%ymm0"
+                 "\n\t vpcmpeqd %%ymm5, %%ymm5, %%ymm5"
+                 "\n\t vpgatherdd %%ymm5, (%[t],%%ymm0,4), %%ymm1"
+                 "\n\t vpand %%ymm4, %%ymm1, %%ymm1"
+                 "\n\t vmovdqu 128(%[p]), %%ymm6"
+                 "\n\t vpsrad $4, %%ymm2, %%ymm2"
+                 "\n\t vpsrad $4, %%ymm3, %%ymm3"
+                 "\n\t vpmulld %%ymm6, %%ymm3, %%ymm3"
+                 "\n\t vpaddd %%ymm3, %%ymm2, %%ymm2"
+                 "\n\t vpand %%ymm4, %%ymm2, %%ymm2"
+                 "\n\t vmovdqu %%ymm2, (%[l])"
+                 "\n\t vmovdqu %%ymm1, %c[oc](%[l])"
+                 :: [s] "r" (rows->brutS + (i + j) * 2), [d] "r" (rows->brutD + (i + j) * 2),
+                    [p] "r" (&params), [t] "r" (&rows->precalCoef[0][0]), [l] "r" (&lanes.pos[j]),
+                    [oc] "i" (ZOOM_SIMD_BATCH * 4)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6");
+        }
+
+        for (j = 0; j < n; j += 4) {
+            __asm __volatile
+                ("\n\t vmovdqu (%[l]), %%xmm0"
+                 "\n\t vmovd %[w], %%xmm1"
+                 "\n\t vpbroadcastd %%xmm1, %%xmm1"
+                 "\n\t vpaddd %%xmm0, %%xmm1, %%xmm1"
+                 "\n\t vpcmpeqd %%ymm2, %%ymm2, %%ymm2"
+                 "\n\t vpgatherdq %%ymm2, (%[s],%%xmm0,4), %%ymm3"
+                 "\n\t vpcmpeqd %%ymm2, %%ymm2, %%ymm2"
+                 "\n\t vpgatherdq %%ymm2, (%[s],%%xmm1,4), %%ymm4"
+                 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+                 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm5"
+                 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+                 "\n\t vpunpcklbw %%ymm7, %%ymm4, %%ymm6"
+                 "\n\t vpunpckhbw %%ymm7, %%ymm4, %%ymm4"
+                 "\n\t vmovdqu %c[oc](%[l]), %%xmm0"
+                 "\n\t vpermq $0x50, %%ymm0, %%ymm0"
+                 "\n\t vpunpcklbw %%ymm0, %%ymm0, %%ymm0"
+                 "\n\t vpunpckhwd %%ymm0, %%ymm0, %%ymm1"
+                 "\n\t vpunpcklwd %%ymm0, %%ymm0, %%ymm0"
+                 "\n\t vpunpcklbw %%ymm7, %%ymm0, %%ymm2"
+                 "\n\t vpunpckhbw %%ymm7, %%ymm0, %%ymm0"
+                 "\n\t vpmullw %%ymm2, %%ymm5, %%ymm5"
+                 "\n\t vpmullw %%ymm0, %%ymm6, %%ymm6"
+                 "\n\t vpaddw %%ymm6, %%ymm5, %%ymm5"
+                 "\n\t vpunpcklbw %%ymm7, %%ymm1, %%ymm2"
+                 "\n\t vpunpckhbw %%ymm7, %%ymm1, %%ymm1"
+                 "\n\t vpmullw %%ymm2, %%ymm3, %%ymm3"
+                 "\n\t vpmullw %%ymm1, %%ymm4, %%ymm4"
+                 "\n\t vpaddw %%ymm4, %%ymm3, %%ymm3"
+                 "\n\t vpunpcklqdq %%ymm3, %%ymm5, %%ymm0"
+                 "\n\t vpunpckhqdq %%ymm3, %%ymm5, %%ymm1"
+                 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+                 "\n\t vpcmpeqw %%ymm1, %%ymm1, %%ymm1"
+                 "\n\t vpsrlw $15, %%ymm1, %%ymm1"
+                 "\n\t vpsllw $2, %%ymm1, %%ymm2"
+                 "\n\t vpor %%ymm1, %%ymm2, %%ymm2"
+                 "\n\t vpsubusw %%ymm2, %%ymm0, %%ymm0"
+                 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+                 "\n\t vpackuswb %%ymm0, %%ymm0, %%ymm0"
+                 "\n\t vpermq $0x08, %%ymm0, %%ymm0"
+                 "\n\t vpcmpeqd %%xmm1, %%xmm1, %%xmm1"
+                 "\n\t vp" ZOOM_ALPHA_SHIFT "d $24, %%xmm1, %%xmm1"
+                 "\n\t vmovdqu (%[d]), %%xmm2"
+                 "\n\t vpand %%xmm1, %%xmm2, %%xmm2"
+                 "\n\t vpandn %%xmm0, %%xmm1, %%xmm1"
+                 "\n\t vpor %%xmm2, %%xmm1, %%xmm1"
+                 "\n\t vmovdqu %%xmm1, (%[d])"
+                 :: [s] "r" (rows->src), [l] "r" (&lanes.pos[j]), [w] "r" (rows->prevX),
+                    [d] "r" (rows->dest + i + j), [oc] "i" (ZOOM_SIMD_BATCH * 4)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+        }
+    }
+
+    __asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+    zoom_rows_c (rows, i, end);
+}
+
+void zoom_vectors_sse2 (ZoomVectors *v, int start, int end)
+{
+    ZoomVectorParams params;
+    int i, x;
+
+    for (i = 0; i < 4; i++) {
+        params.Y[i] = v->Y;
+        params.addX[i] = v->addX;
+        params.speed[i] = v->speed;
+        params.sub[i] = v->sub;
+        params.div[i] = v->div;
+        params.mul[i] = v->mul;
+        params.scale[i] = v->scale;
+        params.low[i] = -2.01f;
+        params.high[i] = 2.01f;
+        params.min[i] = v->min;
+        params.inv_ratio[i] = v->inv_ratio;
+        params.abs[i] = 0x7fffffff;
+        params.middleX[i] = v->middleX;
+        params.middleY[i] = v->middleY;
+    }
+
+    /* the groups of 4 columns start at multiples of 4 */
+    for (x = start; (x & 3) != 0 && x < end; x++)
+        zoom_vectors_c (v, x, x + 1);
+
+    for (; x + 4 <= end; x += 4) {
+        __asm __volatile
+            ("\n\t movups (%[c]), %%xmm0"
+             "\n\t movaps %%xmm0, %%xmm1"
+             "\n\t mulps %%xmm1, %%xmm1"
+             "\n\t movups (%[p]), %%xmm2"
+             "\n\t movaps %%xmm2, %%xmm3"
+             "\n\t mulps %%xmm3, %%xmm3"
+             "\n\t addps %%xmm3, %%xmm1"
+             "\n\t movups 48(%[p]), %%xmm3"
+             "\n\t subps %%xmm3, %%xmm1"
+             "\n\t movups 64(%[p]), %%xmm3"
+             "\n\t divps %%xmm3, %%xmm1"
+             "\n\t movups 80(%[p]), %%xmm3"
+             "\n\t mulps %%xmm3, %%xmm1"
+             "\n\t movups 32(%[p]), %%xmm3"
+             "\n\t addps %%xmm1, %%xmm3"
+             "\n\t movups (%[w]), %%xmm1"
+             "\n\t addps %%xmm1, %%xmm3"
+             "\n\t movups 96(%[p]), %%xmm1"
+             "\n\t mulps %%xmm1, %%xmm3"
+             "\n\t movups 112(%[p]), %%xmm1"
+             "\n\t maxps %%xmm1, %%xmm3"
+             "\n\t movups 128(%[p]), %%xmm1"
+             "\n\t minps %%xmm1, %%xmm3"
+             "\n\t movaps %%xmm3, %%xmm4"
+             "\n\t mulps %%xmm0, %%xmm4"
+             "\n\t movups 16(%[w]), %%xmm1"
+             "\n\t addps %%xmm1, %%xmm4"
+             "\n\t movups 16(%[p]), %%xmm1"
+             "\n\t addps %%xmm1, %%xmm4"
+             "\n\t movaps %%xmm3, %%xmm5"
+             "\n\t mulps %%xmm2, %%xmm5"
+             "\n\t movups 32(%[w]), %%xmm1"
+             "\n\t addps %%xmm1, %%xmm5"
+             "\n\t movups 16(%[c]), %%xmm1"
+             "\n\t addps %%xmm1, %%xmm5"
+             "\n\t movups 144(%[p]), %%xmm6"
+             "\n\t movups 176(%[p]), %%xmm7"
+             "\n\t movaps %%xmm4, %%xmm1"
+             "\n\t andps %%xmm7, %%xmm1"
+             "\n\t cmpltps %%xmm6, %%xmm1"
+             "\n\t xorps %%xmm3, %%xmm3"
+             "\n\t movaps %%xmm4, %%xmm7"
+             "\n\t cmpltps %%xmm3, %%xmm7"
+             "\n\t subps %%xmm6, %%xmm3"
+             "\n\t andps %%xmm7, %%xmm3"
+             "\n\t andnps %%xmm6, %%xmm7"
+             "\n\t orps %%xmm3, %%xmm7"
+             "\n\t andps %%xmm1, %%xmm7"
+             "\n\t andnps %%xmm4, %%xmm1"
+             "\n\t orps %%xmm7, %%xmm1"
+             "\n\t movups 176(%[p]), %%xmm7"
+             "\n\t movaps %%xmm5, %%xmm4"
+             "\n\t andps %%xmm7, %%xmm4"
+             "\n\t cmpltps %%xmm6, %%xmm4"
+             "\n\t xorps %%xmm3, %%xmm3"
+             "\n\t movaps %%xmm5, %%xmm7"
+             "\n\t cmpltps %%xmm3, %%xmm7"
+             "\n\t subps %%xmm6, %%xmm3"
+             "\n\t andps %%xmm7, %%xmm3"
+             "\n\t andnps %%xmm6, %%xmm7"
+             "\n\t orps %%xmm3, %%xmm7"
+             "\n\t andps %%xmm4, %%xmm7"
+             "\n\t andnps %%xmm5, %%xmm4"
+             "\n\t orps %%xmm7, %%xmm4"
+             "\n\t movups 160(%[p]), %%xmm3"
+             "\n\t subps %%xmm1, %%xmm0"
+             "\n\t subps %%xmm4, %%xmm2"
+             "\n\t mulps %%xmm3, %%xmm0"
+             "\n\t mulps %%xmm3, %%xmm2"
+             "\n\t cvttps2dq %%xmm0, %%xmm0"
+             "\n\t cvttps2dq %%xmm2, %%xmm2"
+             "\n\t movdqu 192(%[p]), %%xmm5"
+             "\n\t paddd %%xmm5, %%xmm0"
+             "\n\t movdqu 208(%[p]), %%xmm5"
+             "\n\t paddd %%xmm5, %%xmm2"
+             "\n\t movdqa %%xmm0, %%xmm1"
+             "\n\t punpckldq %%xmm2, %%xmm0"
+             "\n\t punpckhdq %%xmm2, %%xmm1"
+             "\n\t movdqu %%xmm0, (%[b])"
+             "\n\t movdqu %%xmm1, 16(%[b])"
+             :: [c] "r" (v->columns + x * 2), [w] "r" (v->pixels + x * 3),
+                [p] "r" (&params), [b] "r" (v->brut + x * 2)
+             : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+    }
+
+    zoom_vectors_c (v, x, end);
+}
+
+void zoom_filter_sse2 (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    zoom_filter_rows (sizeX, sizeY, src, dest, brutS, brutD, buffratio, precalCoef, zoom_rows_sse2);
+}
+
+void zoom_filter_avx2 (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    zoom_filter_rows (sizeX, sizeY, src, dest, brutS, brutD, buffratio, precalCoef, zoom_rows_avx2);
+}
+
+#elif defined(GOOM_NEON)
+
+/* byte indices that spread the coefficients of a pixel over its two source pixels of a row */
+static const uint8_t zoom_coefs_top[8] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+static const uint8_t zoom_coefs_bottom[8] = { 2, 2, 2, 2, 3, 3, 3, 3 };
+
+static inline uint16x4_t zoom_blend_neon (const Pixel *top, const Pixel *bottom, int32_t coef,
+                                          uint8x8_t itop, uint8x8_t ibottom)
+{
+    uint8x8_t c = vreinterpret_u8_s32 (vdup_n_s32 (coef));
+    uint16x8_t sum;
+    uint16x4_t res;
+
+    sum = vmull_u8 (vld1_u8 ((const uint8_t *) top), vtbl1_u8 (c, itop));
+    sum = vmlal_u8 (sum, vld1_u8 ((const uint8_t *) bottom), vtbl1_u8 (c, ibottom));
+
+    res = vadd_u16 (vget_low_u16 (sum), vget_high_u16 (sum));
+    res = vqsub_u16 (res, vdup_n_u16 (5));
+
+    return vshr_n_u16 (res, 8);
+}
+
+static void zoom_rows_neon (ZoomRows *rows, int start, int end)
+{
+    ZoomLanes lanes;
+    int *coefs = &rows->precalCoef[0][0];
+    int pitch = rows->prevX;
+    int32x4_t ratio = vdupq_n_s32 (rows->buffratio);
+    int32x4_t width = vdupq_n_s32 (rows->prevX);
+    int32x4_t fifteen = vdupq_n_s32 (15);
+    uint32x4_t ax = vdupq_n_u32 (((uint32_t) rows->prevX - 1) << 4);
+    uint32x4_t ay = vdupq_n_u32 (((uint32_t) rows->prevY - 1) << 4);
+    uint8x8_t itop = vld1_u8 (zoom_coefs_top);
+    uint8x8_t ibottom = vld1_u8 (zoom_coefs_bottom);
+    Pixel alpha;
+    uint8x8_t amask;
+    int i, j, n;
+
+    alpha.val = 0;
+    alpha.channels.a = 0xff;
+    amask = vreinterpret_u8_u32 (vdup_n_u32 (alpha.val));
+
+    for (i = start; i + 4 <= end; i += n) {
+        n = end - i < ZOOM_SIMD_BATCH ? (end - i) & ~3 : ZOOM_SIMD_BATCH;
+
+        for (j = 0; j < n; j += 4) {
+            int32x4x2_t s = vld2q_s32 (rows->brutS + (i + j) * 2);
+            int32x4x2_t d = vld2q_s32 (rows->brutD + (i + j) * 2);
+            int32x4_t px, py;
+            uint32x4_t in;
+
+            px = vaddq_s32 (s.val[0], vshrq_n_s32 (vmulq_s32 (vsubq_s32 (d.val[0], s.val[0]), ratio), 16));
+            py = vaddq_s32 (s.val[1], vshrq_n_s32 (vmulq_s32 (vsubq_s32 (d.val[1], s.val[1]), ratio), 16));
+
+            in = vandq_u32 (vcltq_u32 (vreinterpretq_u32_s32 (px), ax),
+                            vcltq_u32 (vreinterpretq_u32_s32 (py), ay));
+
+            vst1q_s32 (&lanes.pos[j], vandq_s32 (vreinterpretq_s32_u32 (in),
+                       vmlaq_s32 (vshrq_n_s32 (px, 4), vshrq_n_s32 (py, 4), width)));
+            vst1q_s32 (&lanes.coef[j], vorrq_s32 (vshlq_n_s32 (vandq_s32 (px, fifteen), 4),
+                                                  vandq_s32 (py, fifteen)));
+            vst1q_u32 ((uint32_t *) &lanes.mask[j], in);
+        }
+
+        for (j = 0; j < n; j++)
+            lanes.coef[j] = coefs[lanes.coef[j]] & lanes.mask[j];
+
+        for (j = 0; j < n; j += 2) {
+            const Pixel *a = rows->src + lanes.pos[j];
+            const Pixel *b = rows->src + lanes.pos[j + 1];
+            uint8_t *dest = (uint8_t *) (rows->dest + i + j);
+            uint8x8_t res;
+
+            res = vmovn_u16 (vcombine_u16 (zoom_blend_neon (a, a + pitch, lanes.coef[j], itop, ibottom),
+                                           zoom_blend_neon (b, b + pitch, lanes.coef[j + 1], itop, ibottom)));
+
+            vst1_u8 (dest, vbsl_u8 (amask, vld1_u8 (dest), res));
+        }
+    }
+
+    zoom_rows_c (rows, i, end);
+}
+
+static inline float32x4_t zoom_div_neon (float32x4_t a, float32x4_t b)
+{
+#if defined(__aarch64__)
+    return vdivq_f32 (a, b);
+#else
+    /* the reciprocal estimates are not exact, divide lane by lane */
+    float ta[4], tb[4];
+    int i;
+
+    vst1q_f32 (ta, a);
+    vst1q_f32 (tb, b);
+
+    for (i = 0; i < 4; i++)
+        ta[i] /= tb[i];
+
+    return vld1q_f32 (ta);
+#endif
+}
+
+/* avoids null displacements, like zoom_vectors_c */
+static inline float32x4_t zoom_min_neon (float32x4_t d, float32x4_t min)
+{
+    uint32x4_t small = vcltq_f32 (vabsq_f32 (d), min);
+    uint32x4_t neg = vcltq_f32 (d, vdupq_n_f32 (0.0f));
+
+    return vbslq_f32 (small, vbslq_f32 (neg, vnegq_f32 (min), min), d);
+}
+
+void zoom_vectors_neon (ZoomVectors *v, int start, int end)
+{
+    float32x4_t Y = vdupq_n_f32 (v->Y);
+    float32x4_t YY = vmulq_f32 (Y, Y);
+    float32x4_t addX = vdupq_n_f32 (v->addX);
+    float32x4_t speed = vdupq_n_f32 (v->speed);
+    float32x4_t sub = vdupq_n_f32 (v->sub);
+    float32x4_t div = vdupq_n_f32 (v->div);
+    float32x4_t mul = vdupq_n_f32 (v->mul);
+    float32x4_t scale = vdupq_n_f32 (v->scale);
+    float32x4_t low = vdupq_n_f32 (-2.01f);
+    float32x4_t high = vdupq_n_f32 (2.01f);
+    float32x4_t min = vdupq_n_f32 (v->min);
+    float32x4_t inv_ratio = vdupq_n_f32 (v->inv_ratio);
+    int32x4_t middleX = vdupq_n_s32 (v->middleX);
+    int32x4_t middleY = vdupq_n_s32 (v->middleY);
+    int x;
+
+    /* the groups of 4 columns start at multiples of 4 */
+    for (x = start; (x & 3) != 0 && x < end; x++)
+        zoom_vectors_c (v, x, x + 1);
+
+    for (; x + 4 <= end; x += 4) {
+        const float *c = v->columns + x * 2;
+        const float *w = v->pixels + x * 3;
+        float32x4_t X = vld1q_f32 (c);
+        float32x4_t coef, vx, vy;
+        int32x4x2_t brut;
+
+        coef = zoom_div_neon (vsubq_f32 (vaddq_f32 (vmulq_f32 (X, X), YY), sub), div);
+        coef = vaddq_f32 (speed, vmulq_f32 (coef, mul));
+        coef = vmulq_f32 (vaddq_f32 (coef, vld1q_f32 (w)), scale);
+        coef = vminq_f32 (vmaxq_f32 (coef, low), high);
+
+        vx = vaddq_f32 (vaddq_f32 (vmulq_f32 (coef, X), vld1q_f32 (w + 4)), addX);
+        vy = vaddq_f32 (vaddq_f32 (vmulq_f32 (coef, Y), vld1q_f32 (w + 8)), vld1q_f32 (c + 4));
+
+        vx = zoom_min_neon (vx, min);
+        vy = zoom_min_neon (vy, min);
+
+        brut.val[0] = vaddq_s32 (vcvtq_s32_f32 (vmulq_f32 (vsubq_f32 (X, vx), inv_ratio)), middleX);
+        brut.val[1] = vaddq_s32 (vcvtq_s32_f32 (vmulq_f32 (vsubq_f32 (Y, vy), inv_ratio)), middleY);
+
+        vst2q_s32 (v->brut + x * 2, brut);
+    }
+
+    zoom_vectors_c (v, x, end);
+}
+
+void zoom_filter_neon (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    zoom_filter_rows (sizeX, sizeY, src, dest, brutS, brutD, buffratio, precalCoef, zoom_rows_neon);
+}
+
+#endif
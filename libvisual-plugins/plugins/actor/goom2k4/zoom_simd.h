@@ -0,0 +1,18 @@
+#ifndef _ZOOM_SIMD_H
+#define _ZOOM_SIMD_H
+
+#include "goom_graphic.h"
+#include "goom_typedefs.h"
+
+/* SSE2 and AVX2 versions, safe on x86 and x86-64, bit exact with zoom_filter_c */
+void zoom_filter_sse2 (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+void zoom_filter_avx2 (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+
+/* NEON version, for arm and arm64 with GOOM_NEON, bit exact with zoom_filter_c */
+void zoom_filter_neon (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+
+/* SSE2 and NEON zoom vectors, they do the float operations of zoom_vectors_c in the same order */
+void zoom_vectors_sse2 (ZoomVectors *v, int start, int end);
+void zoom_vectors_neon (ZoomVectors *v, int start, int end);
+
+#endif
@@ -0,0 +1,246 @@
+/* zoom_test.c
+ * Golden frame test of the zoom filters.
+ *
+ * Runs goom over recorded audio, a raw file of signed 16 bits interleaved stereo
+ * samples, or over a generated sweep when no file or - is given. Every zoom of every
+ * frame is done by zoom_filter_c, the golden frame, and by each accelerated zoom
+ * the cpu has, from the same source and transform buffers. The same goes for the
+ * rows of zoom vectors, against zoom_vectors_c. The accelerated versions must be
+ * bit exact. Goom makes its vectors interlaced when there are no VisJobs workers
+ * and in bands on the workers otherwise, a number of workers can be asked for to
+ * test either way.
+ *
+ * usage: zoom_test [audio.raw|- [frames [width height [workers]]]]
+ */
+
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "goom.h"
+#include "goom_fx.h"
+#include "zoom_simd.h"
+
+typedef void (*ZoomFilterFunc) (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+
+typedef struct {
+    const char *name;
+    ZoomFilterFunc func;
+    ZoomVectorsFunc vectors;
+    int enabled;
+    int failures;
+    int vector_failures;
+} ZoomTestImpl;
+
+static ZoomTestImpl impls[] = {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+    { "sse2", zoom_filter_sse2, zoom_vectors_sse2, 0, 0, 0 },
+    { "avx2", zoom_filter_avx2, NULL, 0, 0, 0 },
+#elif defined(GOOM_NEON)
+    { "neon", zoom_filter_neon, zoom_vectors_neon, 0, 0, 0 },
+#endif
+    { NULL, NULL, NULL, 0, 0, 0 }
+};
+
+static int zooms = 0;
+static int vector_rows = 0;
+static Pixel *source, *golden;
+
+/* the rows of zoom vectors are made on the VisJobs workers */
+static VisMutex *vector_mutex;
+
+static void zoom_test_filter (int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    size_t size = sizeX * sizeY * sizeof (Pixel);
+    ZoomTestImpl *impl;
+
+    /* the zooms clear the corners of src, and keep the alpha of dest */
+    memcpy (source, src, size);
+    memcpy (golden, dest, size);
+
+    zoom_filter_c (sizeX, sizeY, src, golden, brutS, brutD, buffratio, precalCoef);
+
+    for (impl = impls; impl->name != NULL; impl++) {
+        if (!impl->enabled)
+            continue;
+
+        memcpy (src, source, size);
+
+        impl->func (sizeX, sizeY, src, dest, brutS, brutD, buffratio, precalCoef);
+
+        if (memcmp (dest, golden, size) != 0) {
+            if (impl->failures++ == 0)
+                fprintf (stderr, "zoom_test: %s differs from c at zoom %d, buffratio %d\n",
+                         impl->name, zooms, buffratio);
+
+            memcpy (dest, golden, size);
+        }
+    }
+
+    zooms++;
+}
+
+static void zoom_test_vectors (ZoomVectors *v, int start, int end)
+{
+    size_t size = (end - start) * 2 * sizeof (int);
+    int *brut = v->brut;
+    int *golden_brut = malloc (end * 2 * sizeof (int));
+    int *test_brut = malloc (end * 2 * sizeof (int));
+    ZoomTestImpl *impl;
+    int failed;
+
+    v->brut = golden_brut;
+    zoom_vectors_c (v, start, end);
+
+    for (impl = impls; impl->name != NULL; impl++) {
+        if (!impl->enabled || impl->vectors == NULL)
+            continue;
+
+        v->brut = test_brut;
+        impl->vectors (v, start, end);
+
+        failed = memcmp (test_brut + start * 2, golden_brut + start * 2, size) != 0;
+
+        visual_mutex_lock (vector_mutex);
+
+        if (failed && impl->vector_failures++ == 0)
+            fprintf (stderr, "zoom_test: %s vectors differ from c at row %d\n",
+                     impl->name, vector_rows);
+
+        visual_mutex_unlock (vector_mutex);
+    }
+
+    memcpy (brut + start * 2, golden_brut + start * 2, size);
+    v->brut = brut;
+
+    visual_mutex_lock (vector_mutex);
+    vector_rows++;
+    visual_mutex_unlock (vector_mutex);
+
+    free (test_brut);
+    free (golden_brut);
+}
+
+/* a sweep with beats, for when there is no recorded audio */
+static void zoom_test_generate (gint16 data[2][512], int frame)
+{
+    int i;
+
+    for (i = 0; i < 512; i++) {
+        float t = (float) (frame * 512 + i) / 44100.0f;
+        float beat = (frame % 20) < 3 ? 1.0f : 0.2f;
+        float v = beat * sin (2.0f * M_PI * (110.0f + 20.0f * (frame % 50)) * t);
+
+        data[0][i] = (gint16) (v * 30000.0f);
+        data[1][i] = (gint16) (v * 30000.0f * cos (t));
+    }
+}
+
+static int zoom_test_read (FILE *audio, gint16 data[2][512])
+{
+    gint16 samples[1024];
+    int i;
+
+    if (fread (samples, sizeof (gint16), 1024, audio) != 1024)
+        return 0;
+
+    for (i = 0; i < 512; i++) {
+        data[0][i] = samples[i * 2];
+        data[1][i] = samples[i * 2 + 1];
+    }
+
+    return 1;
+}
+
+int main (int argc, char **argv)
+{
+    PluginInfo *goomInfo;
+    FILE *audio = NULL;
+    gint16 data[2][512];
+    int frames = 1000;
+    int width = 320, height = 240;
+    int frame;
+    int failed = 0;
+    ZoomTestImpl *impl;
+
+    visual_init (&argc, &argv);
+
+    if (argc > 1 && strcmp (argv[1], "-") != 0 && (audio = fopen (argv[1], "rb")) == NULL) {
+        fprintf (stderr, "zoom_test: can't open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 2)
+        frames = atoi (argv[2]);
+
+    if (argc > 4) {
+        width = atoi (argv[3]);
+        height = atoi (argv[4]);
+    }
+
+    /* before goom_init, which picks the interlacing by the workers */
+    if (argc > 5 && visual_jobs_set_worker_count (atoi (argv[5])) != VISUAL_OK) {
+        fprintf (stderr, "zoom_test: can't use %s workers\n", argv[5]);
+        return EXIT_FAILURE;
+    }
+
+    for (impl = impls; impl->name != NULL; impl++) {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+        if (impl->func == zoom_filter_sse2)
+            impl->enabled = visual_cpu_get_sse2 ();
+        else if (impl->func == zoom_filter_avx2)
+            impl->enabled = visual_cpu_get_avx2 ();
+#elif defined(GOOM_NEON)
+        impl->enabled = visual_cpu_get_neon ();
+#endif
+    }
+
+    source = malloc (width * height * sizeof (Pixel));
+    golden = malloc (width * height * sizeof (Pixel));
+    vector_mutex = visual_mutex_new ();
+
+    goomInfo = goom_init (width, height);
+    goomInfo->methods.zoom_filter = zoom_test_filter;
+    goomInfo->methods.zoom_vectors = zoom_test_vectors;
+
+    for (frame = 0; frame < frames; frame++) {
+        if (audio != NULL) {
+            if (!zoom_test_read (audio, data))
+                break;
+        } else {
+            zoom_test_generate (data, frame);
+        }
+
+        goom_update (goomInfo, data, 0, 0, NULL, NULL);
+    }
+
+    for (impl = impls; impl->name != NULL; impl++) {
+        if (!impl->enabled) {
+            printf ("zoom_test: %s skipped\n", impl->name);
+            continue;
+        }
+
+        printf ("zoom_test: %s %d of %d zooms differ\n", impl->name, impl->failures, zooms);
+
+        if (impl->vectors != NULL)
+            printf ("zoom_test: %s %d of %d rows of vectors differ\n", impl->name,
+                    impl->vector_failures, vector_rows);
+
+        if (impl->failures > 0 || impl->vector_failures > 0)
+            failed = 1;
+    }
+
+    goom_close (goomInfo);
+
+    visual_mutex_free (vector_mutex);
+    free (golden);
+    free (source);
+
+    if (audio != NULL)
+        fclose (audio);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
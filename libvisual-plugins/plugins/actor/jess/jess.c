@@ -304,8 +304,10 @@ static VisPalette *act_jess_palette (VisPluginData *plugin)
 static int act_jess_render (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 {
 	JessPrivate *priv;
+	VisAudioAnalysis *analysis;
 	VisBuffer fbuf[2];
-	float freq[2][256];
+	float freqbuf[2][256];
+	float *freq[2];
 	short freqdata[2][256];
 	int i;
 
@@ -321,14 +323,30 @@ static int act_jess_render (VisPluginData *plugin, VisVideo *video, VisAudio *au
 		return -1;
 	}
 
-	visual_audio_get_sample (audio, &priv->pcm_data1, VISUAL_AUDIO_CHANNEL_LEFT);
-	visual_audio_get_sample (audio, &priv->pcm_data2, VISUAL_AUDIO_CHANNEL_RIGHT);
+	analysis = visual_audio_get_analysis (audio);
 
-	visual_buffer_set_data_pair (&fbuf[0], freq[0], sizeof (freq[0]));
-	visual_buffer_set_data_pair (&fbuf[1], freq[1], sizeof (freq[1]));
+	if (analysis != NULL) {
+		/* The frame has been analyzed already, just pick up the results */
+		visual_mem_copy (priv->pcm_data[0], visual_audio_analysis_get_pcm (analysis,
+					VISUAL_AUDIO_ANALYSIS_CHANNEL_LEFT, 512), sizeof (priv->pcm_data[0]));
+		visual_mem_copy (priv->pcm_data[1], visual_audio_analysis_get_pcm (analysis,
+					VISUAL_AUDIO_ANALYSIS_CHANNEL_RIGHT, 512), sizeof (priv->pcm_data[1]));
 
-	visual_audio_get_spectrum_for_sample (&fbuf[0], &priv->pcm_data1, FALSE);
-	visual_audio_get_spectrum_for_sample (&fbuf[1], &priv->pcm_data2, FALSE);
+		freq[0] = visual_audio_analysis_get_spectrum (analysis, VISUAL_AUDIO_ANALYSIS_CHANNEL_LEFT, 256, FALSE);
+		freq[1] = visual_audio_analysis_get_spectrum (analysis, VISUAL_AUDIO_ANALYSIS_CHANNEL_RIGHT, 256, FALSE);
+	} else {
+		visual_audio_get_sample (audio, &priv->pcm_data1, VISUAL_AUDIO_CHANNEL_LEFT);
+		visual_audio_get_sample (audio, &priv->pcm_data2, VISUAL_AUDIO_CHANNEL_RIGHT);
+
+		visual_buffer_set_data_pair (&fbuf[0], freqbuf[0], sizeof (freqbuf[0]));
+		visual_buffer_set_data_pair (&fbuf[1], freqbuf[1], sizeof (freqbuf[1]));
+
+		visual_audio_get_spectrum_for_sample (&fbuf[0], &priv->pcm_data1, FALSE);
+		visual_audio_get_spectrum_for_sample (&fbuf[1], &priv->pcm_data2, FALSE);
+
+		freq[0] = freqbuf[0];
+		freq[1] = freqbuf[1];
+	}
 
 	for (i = 0;i < 256; i++) {
 		freqdata[0][i] = freq[0][i] * 32768;
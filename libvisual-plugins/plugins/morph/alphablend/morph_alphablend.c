@@ -31,8 +31,6 @@
 
 const VisPluginInfo *get_plugin_info (int *count);
 
-static inline void alpha_blend_buffer (uint8_t *dest, uint8_t *src1, uint8_t *src2, int size, int depth, float alpha);
-
 static int lv_morph_alpha_init (VisPluginData *plugin);
 static int lv_morph_alpha_cleanup (VisPluginData *plugin);
 static int lv_morph_alpha_apply (VisPluginData *plugin, float rate, VisAudio *audio, VisVideo *dest, VisVideo *src1, VisVideo *src2);
@@ -88,33 +86,8 @@ static int lv_morph_alpha_apply (VisPluginData *plugin, float rate, VisAudio *au
 	visual_return_val_if_fail (src1 != NULL, -1);
 	visual_return_val_if_fail (src2 != NULL, -1);
 
-	alpha_blend_buffer (visual_video_get_pixels (dest),
-			visual_video_get_pixels (src1),
-			visual_video_get_pixels (src2),
-			visual_video_get_size (dest), dest->depth, rate);
+	/* The destination may be of another depth, it gets converted in the same pass */
+	visual_video_alpha_blend (dest, src1, src2, rate * 255);
 
 	return 0;
 }
-
-static inline void alpha_blend_buffer (uint8_t *dest, uint8_t *src1, uint8_t *src2, int size, int depth, float alpha)
-{
-	uint8_t a = alpha * (1/255.0);
-
-	switch (depth) {
-		case VISUAL_VIDEO_DEPTH_8BIT:
-			visual_alpha_blend_8 (dest, src1, src2, size, a);
-			break;
-
-		case VISUAL_VIDEO_DEPTH_16BIT:
-			visual_alpha_blend_16 (dest, src1, src2, size, a);
-			break;
-
-		case VISUAL_VIDEO_DEPTH_24BIT:
-			visual_alpha_blend_24 (dest, src1, src2, size, a);
-			break;
-
-		case VISUAL_VIDEO_DEPTH_32BIT:
-			visual_alpha_blend_32 (dest, src1, src2, size, a);
-			break;
-	}
-}
@@ -19,7 +19,7 @@ LOCAL_LDLIBS    := -lm -ldl -llog
 #LOCAL_LDLIBS += -L$(call host-path, $(LOCAL_PATH))/$(TARGET_ARCH_ABI) -landprof
 #LOCAL_CFLAGS += -pg -DVISUAL_HAVE_PROFILING -fno-omit-frame-pointer -fno-function-sections
 
-PRIV := private/lv_video_convert.c  private/lv_video_fill.c  private/lv_video_scale.c
+PRIV := private/lv_audio_convert.c  private/lv_video_composite.c  private/lv_video_convert.c  private/lv_video_fill.c  private/lv_video_scale.c  private/lv_video_threads.c  private/lv_mem_pool.c  private/lv_palette_lookup.c
 
 LOCAL_SRC_FILES := $(PRIV) $(addprefix /, $(notdir $(wildcard $(LOCAL_PATH)/*.c) $(wildcard $(LOCAL_PATH)/*.cpp)))
 LOCAL_CFLAGS    += $(ARCH_CFLAGS)
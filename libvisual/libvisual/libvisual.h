@@ -62,10 +62,12 @@
 #include <libvisual/lv_ringbuffer.h>
 #include <libvisual/lv_rectangle.h>
 #include <libvisual/lv_thread.h>
+#include <libvisual/lv_jobs.h>
 #include <libvisual/lv_gl.h>
 #include <libvisual/lv_math.h>
 #include <libvisual/lv_os.h>
 #include <libvisual/lv_alpha_blend.h>
+#include <libvisual/lv_atomic.h>
 #include <libvisual/lv_plugin_registry.h>
 #include <libvisual/lv_util.h>
 
@@ -424,8 +424,10 @@ static int negotiate_video_with_unsupported_depth (VisActor *actor, int rundepth
 	visual_log (VISUAL_LOG_INFO, _("rundepth: %d transpitch %d"), rundepth, actor->transform->pitch);
 	visual_video_allocate_buffer (actor->transform);
 
-	if (actor->video->depth == VISUAL_VIDEO_DEPTH_8BIT)
+	if (actor->video->depth == VISUAL_VIDEO_DEPTH_8BIT) {
 		actor->ditherpal = visual_palette_new (256);
+		visual_palette_fill_color_cube (actor->ditherpal);
+	}
 
 	return VISUAL_OK;
 }
@@ -520,6 +522,7 @@ int visual_actor_run (VisActor *actor, VisAudio *audio)
 	VisVideo *video;
 	VisVideo *transform;
 	VisVideo *fitting;
+	VisMemTag oldtag;
 
 	/* We don't check for video, because we don't always need a video */
 	/*
@@ -561,6 +564,8 @@ int visual_actor_run (VisActor *actor, VisAudio *audio)
 	 * Also internal vars can be initialized when params have been set in init on the param
 	 * events in the event loop.
 	 */
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_ACTOR);
+
 	visual_plugin_events_pump (actor->plugin);
 
 	visual_video_set_palette (video, visual_actor_get_palette (actor));
@@ -588,5 +593,7 @@ int visual_actor_run (VisActor *actor, VisAudio *audio)
 		}
 	}
 
+	visual_mem_set_tag (oldtag);
+
 	return VISUAL_OK;
 }
@@ -3,6 +3,19 @@
 #include "lv_common.h"
 #include "lv_cpu.h"
 
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * The blends are src1 + alpha * (src2 - src1) / 255, with the division truncating
+ * towards zero. The vector kernels split the difference in its sign and magnitude
+ * and divide the magnitude as (x + 1 + (x >> 8)) >> 8, which is exact up to 65534,
+ * so their results are bit identical to the C ones. They work on whole vectors and
+ * hand the end of the buffer to the C kernel. The MMX kernels divide by 256 instead
+ * and are only picked without SSE2.
+ */
+
 #pragma pack(1)
 
 typedef struct {
@@ -23,6 +36,17 @@ static void alpha_blend_32_c (uint8_t *dest, uint8_t *src1, uint8_t *src2, visua
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 static void alpha_blend_8_mmx  (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
 static void alpha_blend_32_mmx (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+
+static void alpha_blend_bytes_sse2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+static void alpha_blend_16_sse2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+
+static void alpha_blend_bytes_avx2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+static void alpha_blend_16_avx2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+#endif
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void alpha_blend_bytes_neon (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
+static void alpha_blend_16_neon (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha);
 #endif
 
 VisAlphaBlendFunc visual_alpha_blend_8	= alpha_blend_8_c;
@@ -32,10 +56,46 @@ VisAlphaBlendFunc visual_alpha_blend_32 = alpha_blend_32_c;
 
 void visual_alpha_blend_initialize (void)
 {
+	/* Arranged from slow to fast, so the slower version gets overloaded
+	 * every time */
+
+	visual_alpha_blend_8  = alpha_blend_8_c;
+	visual_alpha_blend_16 = alpha_blend_16_c;
+	visual_alpha_blend_24 = alpha_blend_24_c;
+	visual_alpha_blend_32 = alpha_blend_32_c;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
 	if (visual_cpu_get_mmx () > 0) {
 		visual_alpha_blend_8  = alpha_blend_8_mmx;
 		visual_alpha_blend_32 = alpha_blend_32_mmx;
 	}
+
+	/* Every byte blends alike in 8, 24 and 32 bits buffers */
+	if (visual_cpu_get_sse2 () > 0) {
+		visual_alpha_blend_8  = alpha_blend_bytes_sse2;
+		visual_alpha_blend_16 = alpha_blend_16_sse2;
+		visual_alpha_blend_24 = alpha_blend_bytes_sse2;
+		visual_alpha_blend_32 = alpha_blend_bytes_sse2;
+	}
+
+	if (visual_cpu_get_avx2 () > 0) {
+		visual_alpha_blend_8  = alpha_blend_bytes_avx2;
+		visual_alpha_blend_16 = alpha_blend_16_avx2;
+		visual_alpha_blend_24 = alpha_blend_bytes_avx2;
+		visual_alpha_blend_32 = alpha_blend_bytes_avx2;
+	}
+
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+	if (visual_cpu_get_neon () > 0) {
+		visual_alpha_blend_8  = alpha_blend_bytes_neon;
+		visual_alpha_blend_16 = alpha_blend_16_neon;
+		visual_alpha_blend_24 = alpha_blend_bytes_neon;
+		visual_alpha_blend_32 = alpha_blend_bytes_neon;
+	}
+
+#endif
 }
 
 static void alpha_blend_8_c (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
@@ -80,6 +140,12 @@ static void alpha_blend_32_c (uint8_t *dest, uint8_t *src1, uint8_t *src2, visua
 
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
+/* The blue and green fields of 16 bits pixels, red is what's left after shifting */
+static const uint16_t alpha_blend_rgb16_masks[2][8] = {
+	{ 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f },
+	{ 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f }
+};
+
 static void alpha_blend_8_mmx (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
 {
 	visual_size_t i;
@@ -153,4 +219,348 @@ static void alpha_blend_32_mmx (uint8_t *dest, uint8_t *src1, uint8_t *src2, vis
 		("\n\t emms");
 }
 
+
+/* Sixteen bytes, every word goes through the sign and magnitude steps */
+static void alpha_blend_bytes_sse2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16_t weights[8];
+	visual_size_t i;
+
+	for (i = 0; i < 8; i++)
+		weights[i] = alpha;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[a]), %%xmm5"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s1]), %%xmm0"
+			 "\n\t movdqu (%[s2]), %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm2, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpckhbw %%xmm7, %%xmm1"
+			 "\n\t punpcklbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t psubw %%xmm0, %%xmm2"		/* src2 - src1 */
+			 "\n\t psubw %%xmm1, %%xmm3"
+			 "\n\t movdqa %%xmm2, %%xmm4"
+			 "\n\t psraw $15, %%xmm4"		/* sign */
+			 "\n\t pxor %%xmm4, %%xmm2"
+			 "\n\t psubw %%xmm4, %%xmm2"		/* magnitude */
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t movdqa %%xmm2, %%xmm6"
+			 "\n\t psrlw $8, %%xmm6"
+			 "\n\t paddw %%xmm6, %%xmm2"
+			 "\n\t pcmpeqw %%xmm6, %%xmm6"
+			 "\n\t psubw %%xmm6, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"		/* / 255 */
+			 "\n\t pxor %%xmm4, %%xmm2"
+			 "\n\t psubw %%xmm4, %%xmm2"		/* sign back */
+			 "\n\t paddw %%xmm2, %%xmm0"
+			 "\n\t movdqa %%xmm3, %%xmm4"
+			 "\n\t psraw $15, %%xmm4"
+			 "\n\t pxor %%xmm4, %%xmm3"
+			 "\n\t psubw %%xmm4, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm3"
+			 "\n\t movdqa %%xmm3, %%xmm6"
+			 "\n\t psrlw $8, %%xmm6"
+			 "\n\t paddw %%xmm6, %%xmm3"
+			 "\n\t pcmpeqw %%xmm6, %%xmm6"
+			 "\n\t psubw %%xmm6, %%xmm3"
+			 "\n\t psrlw $8, %%xmm3"
+			 "\n\t pxor %%xmm4, %%xmm3"
+			 "\n\t psubw %%xmm4, %%xmm3"
+			 "\n\t paddw %%xmm3, %%xmm1"
+			 "\n\t packuswb %%xmm1, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [s1] "r" (src1 + i), [s2] "r" (src2 + i), [a] "r" (weights)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	alpha_blend_8_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
+/* Eight pixels, the 5, 6 and 5 bits fields are blended in words of their own */
+static void alpha_blend_16_sse2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16_t weights[8];
+	visual_size_t i;
+
+	for (i = 0; i < 8; i++)
+		weights[i] = alpha;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[a]), %%xmm6"
+			 "\n\t movdqu (%[s1]), %%xmm0"
+			 "\n\t movdqu (%[s2]), %%xmm1"
+			 "\n\t movdqu (%[m]), %%xmm7"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm7, %%xmm4"
+			 "\n\t psubw %%xmm2, %%xmm4"
+			 "\n\t movdqa %%xmm4, %%xmm5"
+			 "\n\t psraw $15, %%xmm5"
+			 "\n\t pxor %%xmm5, %%xmm4"
+			 "\n\t psubw %%xmm5, %%xmm4"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t movdqa %%xmm4, %%xmm7"
+			 "\n\t psrlw $8, %%xmm7"
+			 "\n\t paddw %%xmm7, %%xmm4"
+			 "\n\t pcmpeqw %%xmm7, %%xmm7"
+			 "\n\t psubw %%xmm7, %%xmm4"
+			 "\n\t psrlw $8, %%xmm4"
+			 "\n\t pxor %%xmm5, %%xmm4"
+			 "\n\t psubw %%xmm5, %%xmm4"
+			 "\n\t paddw %%xmm4, %%xmm2"		/* blue */
+			 "\n\t movdqu 16(%[m]), %%xmm7"
+			 "\n\t movdqa %%xmm0, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t psrlw $5, %%xmm3"
+			 "\n\t psrlw $5, %%xmm4"
+			 "\n\t pand %%xmm7, %%xmm3"
+			 "\n\t pand %%xmm7, %%xmm4"
+			 "\n\t psubw %%xmm3, %%xmm4"
+			 "\n\t movdqa %%xmm4, %%xmm5"
+			 "\n\t psraw $15, %%xmm5"
+			 "\n\t pxor %%xmm5, %%xmm4"
+			 "\n\t psubw %%xmm5, %%xmm4"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t movdqa %%xmm4, %%xmm7"
+			 "\n\t psrlw $8, %%xmm7"
+			 "\n\t paddw %%xmm7, %%xmm4"
+			 "\n\t pcmpeqw %%xmm7, %%xmm7"
+			 "\n\t psubw %%xmm7, %%xmm4"
+			 "\n\t psrlw $8, %%xmm4"
+			 "\n\t pxor %%xmm5, %%xmm4"
+			 "\n\t psubw %%xmm5, %%xmm4"
+			 "\n\t paddw %%xmm4, %%xmm3"
+			 "\n\t psllw $5, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm2"		/* green */
+			 "\n\t psrlw $11, %%xmm0"
+			 "\n\t psrlw $11, %%xmm1"
+			 "\n\t psubw %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm1, %%xmm5"
+			 "\n\t psraw $15, %%xmm5"
+			 "\n\t pxor %%xmm5, %%xmm1"
+			 "\n\t psubw %%xmm5, %%xmm1"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t movdqa %%xmm1, %%xmm7"
+			 "\n\t psrlw $8, %%xmm7"
+			 "\n\t paddw %%xmm7, %%xmm1"
+			 "\n\t pcmpeqw %%xmm7, %%xmm7"
+			 "\n\t psubw %%xmm7, %%xmm1"
+			 "\n\t psrlw $8, %%xmm1"
+			 "\n\t pxor %%xmm5, %%xmm1"
+			 "\n\t psubw %%xmm5, %%xmm1"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t psllw $11, %%xmm0"
+			 "\n\t por %%xmm0, %%xmm2"		/* red */
+			 "\n\t movdqu %%xmm2, (%[d])"
+			 :: [d] "r" (dest + i), [s1] "r" (src1 + i), [s2] "r" (src2 + i), [a] "r" (weights),
+			    [m] "r" (alpha_blend_rgb16_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	alpha_blend_16_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
+/* The AVX2 kernels are the SSE2 ones on both 128 bits lanes, the unpacks and packs
+ * stay within the lanes so the bytes keep their order */
+
+static void alpha_blend_bytes_avx2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16_t weight = alpha;
+	visual_size_t i;
+
+	for (i = 0; i + 32 <= size; i += 32) {
+		__asm __volatile
+			("\n\t vpbroadcastw (%[a]), %%ymm5"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vpcmpeqw %%ymm6, %%ymm6, %%ymm6"
+			 "\n\t vmovdqu (%[s1]), %%ymm1"
+			 "\n\t vmovdqu (%[s2]), %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm1, %%ymm0"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpsubw %%ymm0, %%ymm2, %%ymm2"
+			 "\n\t vpsubw %%ymm1, %%ymm3, %%ymm3"
+			 "\n\t vpsraw $15, %%ymm2, %%ymm4"
+			 "\n\t vpxor %%ymm4, %%ymm2, %%ymm2"
+			 "\n\t vpsubw %%ymm4, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm7"
+			 "\n\t vpaddw %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpsubw %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpxor %%ymm4, %%ymm2, %%ymm2"
+			 "\n\t vpsubw %%ymm4, %%ymm2, %%ymm2"
+			 "\n\t vpaddw %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vpsraw $15, %%ymm3, %%ymm4"
+			 "\n\t vpxor %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpsubw %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm3, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm3, %%ymm7"
+			 "\n\t vpaddw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpsubw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm3, %%ymm3"
+			 "\n\t vpxor %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpsubw %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm1, %%ymm1"
+			 "\n\t vpackuswb %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s1] "r" (src1 + i), [s2] "r" (src2 + i), [a] "r" (&weight)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	alpha_blend_8_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
+static void alpha_blend_16_avx2 (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16_t weight = alpha;
+	visual_size_t i;
+
+	for (i = 0; i + 32 <= size; i += 32) {
+		__asm __volatile
+			("\n\t vpbroadcastw (%[a]), %%ymm6"
+			 "\n\t vmovdqu (%[s1]), %%ymm0"
+			 "\n\t vmovdqu (%[s2]), %%ymm1"
+			 "\n\t vbroadcasti128 (%[m]), %%ymm7"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm1, %%ymm4"
+			 "\n\t vpcmpeqw %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vpsubw %%ymm2, %%ymm4, %%ymm4"
+			 "\n\t vpsraw $15, %%ymm4, %%ymm5"
+			 "\n\t vpxor %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpmullw %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm7, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm4"
+			 "\n\t vpxor %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpaddw %%ymm4, %%ymm2, %%ymm2"	/* blue */
+			 "\n\t vbroadcasti128 16(%[m]), %%ymm5"
+			 "\n\t vpsrlw $5, %%ymm0, %%ymm3"
+			 "\n\t vpsrlw $5, %%ymm1, %%ymm4"
+			 "\n\t vpand %%ymm5, %%ymm3, %%ymm3"
+			 "\n\t vpand %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm3, %%ymm4, %%ymm4"
+			 "\n\t vpsraw $15, %%ymm4, %%ymm5"
+			 "\n\t vpxor %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpmullw %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm1"
+			 "\n\t vpaddw %%ymm1, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm7, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm4"
+			 "\n\t vpxor %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm5, %%ymm4, %%ymm4"
+			 "\n\t vpaddw %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpsllw $5, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm3, %%ymm2, %%ymm2"	/* green */
+			 "\n\t vmovdqu (%[s2]), %%ymm1"
+			 "\n\t vpsrlw $11, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $11, %%ymm1, %%ymm1"
+			 "\n\t vpsubw %%ymm0, %%ymm1, %%ymm1"
+			 "\n\t vpsraw $15, %%ymm1, %%ymm5"
+			 "\n\t vpxor %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpsubw %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpsrlw $8, %%ymm1, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm1, %%ymm1"
+			 "\n\t vpsubw %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpsrlw $8, %%ymm1, %%ymm1"
+			 "\n\t vpxor %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpsubw %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpsllw $11, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm0, %%ymm2, %%ymm2"	/* red */
+			 "\n\t vmovdqu %%ymm2, (%[d])"
+			 :: [d] "r" (dest + i), [s1] "r" (src1 + i), [s2] "r" (src2 + i), [a] "r" (&weight),
+			    [m] "r" (alpha_blend_rgb16_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	alpha_blend_16_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+/* alpha * diff / 255 truncated towards zero, for differences within 8 bits */
+static inline int16x8_t alpha_blend_div255_neon (int16x8_t diff, uint16x8_t alpha)
+{
+	uint16x8_t prod = vmulq_u16 (vreinterpretq_u16_s16 (vabsq_s16 (diff)), alpha);
+	int16x8_t q;
+
+	prod = vaddq_u16 (vsraq_n_u16 (prod, prod, 8), vdupq_n_u16 (1));
+	q = vreinterpretq_s16_u16 (vshrq_n_u16 (prod, 8));
+
+	return vbslq_s16 (vcltq_s16 (diff, vdupq_n_s16 (0)), vnegq_s16 (q), q);
+}
+
+static inline uint8x8_t alpha_blend_bytes8_neon (uint8x8_t a, uint8x8_t b, uint16x8_t alpha)
+{
+	int16x8_t diff = vreinterpretq_s16_u16 (vsubl_u8 (b, a));
+
+	return vmovn_u16 (vreinterpretq_u16_s16 (vaddq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (a)),
+					alpha_blend_div255_neon (diff, alpha))));
+}
+
+static inline uint16x8_t alpha_blend_field_neon (uint16x8_t a, uint16x8_t b, uint16x8_t alpha)
+{
+	int16x8_t diff = vsubq_s16 (vreinterpretq_s16_u16 (b), vreinterpretq_s16_u16 (a));
+
+	return vreinterpretq_u16_s16 (vaddq_s16 (vreinterpretq_s16_u16 (a), alpha_blend_div255_neon (diff, alpha)));
+}
+
+static void alpha_blend_bytes_neon (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16x8_t weights = vdupq_n_u16 (alpha);
+	uint8x16_t a, b;
+	visual_size_t i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		a = vld1q_u8 (src1 + i);
+		b = vld1q_u8 (src2 + i);
+
+		vst1q_u8 (dest + i, vcombine_u8 (alpha_blend_bytes8_neon (vget_low_u8 (a), vget_low_u8 (b), weights),
+					alpha_blend_bytes8_neon (vget_high_u8 (a), vget_high_u8 (b), weights)));
+	}
+
+	alpha_blend_8_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
+static void alpha_blend_16_neon (uint8_t *dest, uint8_t *src1, uint8_t *src2, visual_size_t size, uint8_t alpha)
+{
+	uint16x8_t weights = vdupq_n_u16 (alpha);
+	uint16x8_t m5 = vdupq_n_u16 (0x1f);
+	uint16x8_t m6 = vdupq_n_u16 (0x3f);
+	uint16x8_t a, b, c0, c1, c2;
+	visual_size_t i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		a = vld1q_u16 ((const uint16_t *) (src1 + i));
+		b = vld1q_u16 ((const uint16_t *) (src2 + i));
+
+		c0 = alpha_blend_field_neon (vandq_u16 (a, m5), vandq_u16 (b, m5), weights);
+		c1 = alpha_blend_field_neon (vandq_u16 (vshrq_n_u16 (a, 5), m6), vandq_u16 (vshrq_n_u16 (b, 5), m6), weights);
+		c2 = alpha_blend_field_neon (vshrq_n_u16 (a, 11), vshrq_n_u16 (b, 11), weights);
+
+		vst1q_u16 ((uint16_t *) (dest + i), vorrq_u16 (c0, vorrq_u16 (vshlq_n_u16 (c1, 5), vshlq_n_u16 (c2, 11))));
+	}
+
+	alpha_blend_16_c (dest + i, src1 + i, src2 + i, size - i, alpha);
+}
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
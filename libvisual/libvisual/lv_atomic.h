@@ -0,0 +1,197 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * Authors: Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _LV_ATOMIC_H
+#define _LV_ATOMIC_H
+
+#include <libvisual/lvconfig.h>
+#include <libvisual/lv_defines.h>
+
+VISUAL_BEGIN_DECLS
+
+/**
+ * @defgroup VisAtomic VisAtomic
+ * @{
+ */
+
+/*
+ * The __atomic builtins are used where the compiler has them (gcc 4.7 and up, clang),
+ * older compilers like the ones that come with the Android NDK fall back to the
+ * __sync builtins, which are full barriers.
+ */
+#if defined(__ATOMIC_ACQUIRE)
+#  define VISUAL_ATOMIC_BUILTINS 1
+#endif
+
+/**
+ * Function to read an integer with acquire semantics, memory accesses after the
+ * read can not be reordered before it.
+ *
+ * @param atomic Pointer to the integer.
+ *
+ * @return The value of the integer.
+ */
+static inline int visual_atomic_int_get (volatile int *atomic)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	return __atomic_load_n (atomic, __ATOMIC_ACQUIRE);
+#else
+	int value = *atomic;
+
+	__sync_synchronize ();
+
+	return value;
+#endif
+}
+
+/**
+ * Function to write an integer with release semantics, memory accesses before the
+ * write can not be reordered after it.
+ *
+ * @param atomic Pointer to the integer.
+ * @param value The new value.
+ */
+static inline void visual_atomic_int_set (volatile int *atomic, int value)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	__atomic_store_n (atomic, value, __ATOMIC_RELEASE);
+#else
+	__sync_synchronize ();
+
+	*atomic = value;
+#endif
+}
+
+/**
+ * Function to atomically add to an integer.
+ *
+ * @param atomic Pointer to the integer.
+ * @param value The value that is added, can be negative.
+ *
+ * @return The new value of the integer.
+ */
+static inline int visual_atomic_int_add (volatile int *atomic, int value)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	return __atomic_add_fetch (atomic, value, __ATOMIC_ACQ_REL);
+#else
+	return __sync_add_and_fetch (atomic, value);
+#endif
+}
+
+/**
+ * Function to atomically replace an integer when it still has the expected value.
+ *
+ * @param atomic Pointer to the integer.
+ * @param oldval The expected value.
+ * @param newval The new value.
+ *
+ * @return TRUE when the integer was replaced, FALSE otherwise.
+ */
+static inline int visual_atomic_int_compare_and_exchange (volatile int *atomic, int oldval, int newval)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	return __atomic_compare_exchange_n (atomic, &oldval, newval, FALSE,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+	return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#endif
+}
+
+/**
+ * Function to read a pointer with acquire semantics.
+ *
+ * @see visual_atomic_int_get
+ *
+ * @param atomic Pointer to the pointer.
+ *
+ * @return The value of the pointer.
+ */
+static inline void *visual_atomic_pointer_get (void * volatile *atomic)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	return __atomic_load_n (atomic, __ATOMIC_ACQUIRE);
+#else
+	void *value = *atomic;
+
+	__sync_synchronize ();
+
+	return value;
+#endif
+}
+
+/**
+ * Function to write a pointer with release semantics.
+ *
+ * @see visual_atomic_int_set
+ *
+ * @param atomic Pointer to the pointer.
+ * @param value The new value.
+ */
+static inline void visual_atomic_pointer_set (void * volatile *atomic, void *value)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	__atomic_store_n (atomic, value, __ATOMIC_RELEASE);
+#else
+	__sync_synchronize ();
+
+	*atomic = value;
+#endif
+}
+
+/**
+ * Function to atomically replace a pointer when it still has the expected value.
+ *
+ * @param atomic Pointer to the pointer.
+ * @param oldval The expected value.
+ * @param newval The new value.
+ *
+ * @return TRUE when the pointer was replaced, FALSE otherwise.
+ */
+static inline int visual_atomic_pointer_compare_and_exchange (void * volatile *atomic, void *oldval, void *newval)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	return __atomic_compare_exchange_n (atomic, &oldval, newval, FALSE,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#else
+	return __sync_bool_compare_and_swap (atomic, oldval, newval);
+#endif
+}
+
+/**
+ * Function that acts as a full memory barrier, no memory access is reordered across it.
+ */
+static inline void visual_atomic_barrier (void)
+{
+#ifdef VISUAL_ATOMIC_BUILTINS
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+#else
+	__sync_synchronize ();
+#endif
+}
+
+/**
+ * @}
+ */
+
+VISUAL_END_DECLS
+
+#endif /* _LV_ATOMIC_H */
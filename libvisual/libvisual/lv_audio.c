@@ -23,36 +23,69 @@
 
 #include "config.h"
 #include "lv_audio.h"
+#include "lv_atomic.h"
 #include "lv_common.h"
 #include "lv_fourier.h"
 #include "lv_math.h"
 #include "lv_util.h"
+#include "lv_cpu.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/* The analysis of a VisAudio, with the scratch space of its transforms kept along
+ * so that the analysis doesn't need it on the stack of the thread that runs it.
+ * The spectra are only computed when asked for, spectra_done has a bit per
+ * spectrum of a channel that is up to date for the current frame. */
+typedef struct _AudioAnalysisPrivate AudioAnalysisPrivate;
+
+struct _AudioAnalysisPrivate {
+	VisAudioAnalysis	 analysis;
+
+	unsigned int		 spectra_done[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST];
+
+	float			 scratch[VISUAL_AUDIO_ANALYSIS_SAMPLES * 2];
+};
+
+/* The bits of spectra_done, the log scaled spectra follow the linear ones */
+#define AUDIO_ANALYSIS_SPECTRUM_SIZES	3
 
 static int audio_dtor (VisObject *object);
 static int audio_samplepool_dtor (VisObject *object);
 static int audio_samplepool_channel_dtor (VisObject *object);
 static int audio_sample_dtor (VisObject *object);
 
+static void audio_analysis_update (VisAudio *audio, VisAudioAnalysis *analysis);
+static float *audio_analysis_spectrum (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel,
+		int index, int log_scaled);
+
+static void *audio_scratch_alloc (visual_size_t nbytes, int *heap);
+static void audio_scratch_free (void *ptr, int heap);
+static void audio_scratch_buffer_init (VisBuffer *buffer, visual_size_t nbytes);
+
 #if 0
 static int audio_band_total (VisAudio *audio, int begin, int end);
 static int audio_band_energy (VisAudio *audio, int band, int length);
 #endif
 
-/* Format transform functions */
-static int transform_format_buffer_from_float (VisBuffer *dest, VisBuffer *src, int size, int sign);
-static int transform_format_buffer_to_float (VisBuffer *dest, VisBuffer *src, int size, int sign);
-static int transform_format_buffer (VisBuffer *dest, VisBuffer *src, int dsize, int ssize, int dsigned, int ssigned);
-
-/* Ringbuffer data provider functions */
-static VisBuffer *sample_data_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry);
-static void sample_destroy_func (VisRingBufferEntry *entry);
-static int sample_size_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry);
+/* Sample ring functions */
+static void sample_convert_to_float (float *dest, const uint8_t *src, int samples, int stride,
+		VisAudioSampleFormatType format);
+static void sample_deinterleave_to_float (float *left, float *right, const uint8_t *src, int frames,
+		VisAudioSampleFormatType format);
+static void samplepool_write_stereo (VisAudioSamplePoolChannel *left, VisAudioSamplePoolChannel *right,
+		const uint8_t *src, int frames, VisAudioSampleFormatType format);
+static VisAudioSamplePoolChannel *samplepool_get_channel_or_add (VisAudioSamplePool *samplepool,
+		const char *channelid);
+static void samplepool_channel_claim (VisAudioSamplePoolChannel *channel, unsigned int claim);
 
 /*  functions */
 static int input_interleaved_stereo (VisAudioSamplePool *samplepool, VisBuffer *buffer,
@@ -67,7 +100,11 @@ static int audio_dtor (VisObject *object)
 	if (audio->samplepool != NULL)
 		visual_object_unref (VISUAL_OBJECT (audio->samplepool));
 
+	if (audio->analysis != NULL)
+		visual_mem_free (audio->analysis);
+
 	audio->samplepool = NULL;
+	audio->analysis = NULL;
 
 	return VISUAL_OK;
 }
@@ -89,7 +126,7 @@ static int audio_samplepool_channel_dtor (VisObject *object)
 	VisAudioSamplePoolChannel *channel = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL (object);
 
 	if (channel->samples != NULL)
-		visual_object_unref (VISUAL_OBJECT (channel->samples));
+		visual_mem_free (channel->samples);
 
 	if (channel->channelid != NULL)
 		visual_mem_free (channel->channelid);
@@ -116,6 +153,123 @@ static int audio_sample_dtor (VisObject *object)
 	return VISUAL_OK;
 }
 
+static void audio_analysis_update (VisAudio *audio, VisAudioAnalysis *analysis)
+{
+	static const char *channelids[] = {
+		VISUAL_AUDIO_CHANNEL_LEFT,
+		VISUAL_AUDIO_CHANNEL_RIGHT
+	};
+
+	AudioAnalysisPrivate *priv = (AudioAnalysisPrivate *) analysis;
+	VisAudioSamplePoolChannel *channel;
+	float *pcm;
+	float energy;
+	int ch, i;
+
+	/* Extract the pcm data once, ordered from old to new */
+	for (ch = 0; ch < 2; ch++) {
+		channel = visual_audio_samplepool_get_channel (audio->samplepool, channelids[ch]);
+
+		if (channel == NULL) {
+			visual_mem_set (analysis->pcm[ch], 0, sizeof (analysis->pcm[ch]));
+
+			continue;
+		}
+
+		visual_audio_samplepool_channel_get_data (channel, analysis->pcm[ch], VISUAL_AUDIO_ANALYSIS_SAMPLES);
+	}
+
+	for (i = 0; i < VISUAL_AUDIO_ANALYSIS_SAMPLES; i++)
+		analysis->pcm[VISUAL_AUDIO_ANALYSIS_CHANNEL_MIX][i] =
+			(analysis->pcm[VISUAL_AUDIO_ANALYSIS_CHANNEL_LEFT][i] +
+			 analysis->pcm[VISUAL_AUDIO_ANALYSIS_CHANNEL_RIGHT][i]) * 0.5f;
+
+	for (ch = 0; ch < VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST; ch++) {
+		pcm = analysis->pcm[ch];
+
+		energy = 0;
+		for (i = VISUAL_AUDIO_ANALYSIS_SAMPLES - 512; i < VISUAL_AUDIO_ANALYSIS_SAMPLES; i++)
+			energy += pcm[i] * pcm[i];
+
+		analysis->energy[ch] = sqrtf (energy / 512);
+
+		/* The spectra of the previous frame are stale, they are redone on request */
+		priv->spectra_done[ch] = 0;
+	}
+
+	analysis->frame++;
+}
+
+/* Returns the spectrum with 256 << index bands of a channel, transforms the pcm data
+ * the first time it is asked for in a frame */
+static float *audio_analysis_spectrum (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel,
+		int index, int log_scaled)
+{
+	AudioAnalysisPrivate *priv = (AudioAnalysisPrivate *) analysis;
+	float *spectra[] = { analysis->spectrum_256[channel], analysis->spectrum_512[channel],
+		analysis->spectrum_1024[channel] };
+	float *log_spectra[] = { analysis->log_spectrum_256[channel], analysis->log_spectrum_512[channel],
+		analysis->log_spectrum_1024[channel] };
+	unsigned int linear_bit = 1 << index;
+	unsigned int log_bit = 1 << (index + AUDIO_ANALYSIS_SPECTRUM_SIZES);
+	VisDFTPlan *plan;
+	int bands = 256 << index;
+
+	/* Every spectrum covers the latest bands * 2 samples */
+	if ((priv->spectra_done[channel] & linear_bit) == 0) {
+		plan = visual_dft_plan_get (bands * 2);
+		visual_return_val_if_fail (plan != NULL, NULL);
+		visual_return_val_if_fail (visual_dft_plan_get_scratch_size (plan) <=
+				VISUAL_AUDIO_ANALYSIS_SAMPLES * 2, NULL);
+
+		visual_dft_plan_perform (plan, spectra[index], bands,
+				analysis->pcm[channel] + VISUAL_AUDIO_ANALYSIS_SAMPLES - bands * 2, bands * 2,
+				priv->scratch);
+
+		priv->spectra_done[channel] |= linear_bit;
+	}
+
+	if (log_scaled == FALSE)
+		return spectra[index];
+
+	if ((priv->spectra_done[channel] & log_bit) == 0) {
+		visual_dft_log_scale_standard (log_spectra[index], spectra[index], bands);
+
+		priv->spectra_done[channel] |= log_bit;
+	}
+
+	return log_spectra[index];
+}
+
+/* Scratch memory comes from the frame arena while a frame runs, from the heap otherwise */
+static void *audio_scratch_alloc (visual_size_t nbytes, int *heap)
+{
+	void *ptr;
+
+	ptr = visual_mem_frame_malloc (nbytes);
+	*heap = ptr == NULL;
+
+	return ptr != NULL ? ptr : visual_mem_malloc (nbytes);
+}
+
+static void audio_scratch_free (void *ptr, int heap)
+{
+	if (heap == TRUE)
+		visual_mem_free (ptr);
+}
+
+static void audio_scratch_buffer_init (VisBuffer *buffer, visual_size_t nbytes)
+{
+	void *data;
+
+	data = visual_mem_frame_malloc (nbytes);
+
+	if (data != NULL)
+		visual_buffer_init (buffer, data, nbytes, NULL);
+	else
+		visual_buffer_init_allocate (buffer, nbytes, visual_buffer_destroyer_free);
+}
+
 #if 0
 
 static int audio_band_total (VisAudio *audio, int begin, int end)
@@ -176,14 +330,14 @@ int visual_audio_init (VisAudio *audio)
 
 	/* Reset the VisAudio data */
 	audio->samplepool = visual_audio_samplepool_new ();
+	audio->analysis = NULL;
 
 	return VISUAL_OK;
 }
 
 int visual_audio_analyze (VisAudio *audio)
 {
-	short pcm[3][1024];
-
+	VisMemTag oldtag;
 #if 0
 	float temp_out[256];
 	float temp_audio[2][512];
@@ -201,51 +355,22 @@ int visual_audio_analyze (VisAudio *audio)
 		audio->pcm[2][i] = (audio->plugpcm[0][i] + audio->plugpcm[1][i]) >> 1;
 	}
 #endif
-	/* -------------------------------- audio pool testing */
-	{
-/*		VisBuffer *buffer = visual_buffer_new_allocate (sizeof (int16_t) * 512, visual_buffer_destroyer_free);
-		VisTime timestamp;
-		VisAudioSample *sample;
-
-		visual_mem_copy (visual_buffer_get_data (buffer), audio->plugpcm[2], sizeof (int16_t) * 512);
-
-		visual_time_get (&timestamp);
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_AUDIO);
 
-		sample = visual_audio_sample_new (buffer, &timestamp,
-				VISUAL_AUDIO_SAMPLE_RATE_44100,
-				VISUAL_AUDIO_SAMPLE_FORMAT_S8);
+	visual_audio_samplepool_flush_old (audio->samplepool);
 
-		visual_audio_samplepool_add (audio->samplepool, sample, "front");
-*/
-		VisAudioSamplePoolChannel *channel;
-		VisBuffer buffer;
-
-		visual_audio_samplepool_flush_old (audio->samplepool);
-
-		channel = visual_audio_samplepool_get_channel (audio->samplepool, VISUAL_AUDIO_CHANNEL_LEFT);
-
-		if (channel != 0) {
-			visual_buffer_init (&buffer, pcm[0], 1024, NULL);
-
-//			printf ("--channel debug: %s: %d\n", channel->channelid, visual_ringbuffer_get_size (channel->samples));
-			visual_ringbuffer_get_data (channel->samples, &buffer, 1024);
-
-			visual_object_unref (VISUAL_OBJECT (&buffer));
-		}
+	/* The pcm data of this frame is taken once, here, the spectra when an actor asks */
+	if (audio->analysis == NULL)
+		audio->analysis = &visual_mem_new0 (AudioAnalysisPrivate, 1)->analysis;
 
-		channel = visual_audio_samplepool_get_channel (audio->samplepool, VISUAL_AUDIO_CHANNEL_RIGHT);
+	audio_analysis_update (audio, audio->analysis);
 
-		if (channel != 0) {
-			visual_buffer_init (&buffer, pcm[1], 1024, NULL);
-
-//			printf ("--channel debug: %s: %d\n", channel->channelid, visual_ringbuffer_get_size (channel->samples));
-			visual_ringbuffer_get_data (channel->samples, &buffer, 1024);
-
-			visual_object_unref (VISUAL_OBJECT (&buffer));
-		}
+	/* Keep the legacy energy level in the 0 - 100 range */
+	audio->energy = audio->analysis->energy[VISUAL_AUDIO_ANALYSIS_CHANNEL_MIX] * 100;
+	if (audio->energy > 100)
+		audio->energy = 100;
 
-	}
-	/* /-------------------------------- audio pool testing */
+	visual_mem_set_tag (oldtag);
 
 //	for (i = 0; i < 512; i++) {
 //		audio->pcm[2][i] = (audio->pcm[0][i] + audio->pcm[1][i]) >> 1;
@@ -319,6 +444,42 @@ int visual_audio_analyze (VisAudio *audio)
 	return VISUAL_OK;
 }
 
+VisAudioAnalysis *visual_audio_get_analysis (VisAudio *audio)
+{
+	visual_return_val_if_fail (audio != NULL, NULL);
+
+	return audio->analysis;
+}
+
+float *visual_audio_analysis_get_pcm (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel, int samples)
+{
+	visual_return_val_if_fail (analysis != NULL, NULL);
+	visual_return_val_if_fail (channel >= 0 && channel < VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST, NULL);
+	visual_return_val_if_fail (samples >= 0 && samples <= VISUAL_AUDIO_ANALYSIS_SAMPLES, NULL);
+
+	return analysis->pcm[channel] + VISUAL_AUDIO_ANALYSIS_SAMPLES - samples;
+}
+
+float *visual_audio_analysis_get_spectrum (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel, int size, int log_scaled)
+{
+	visual_return_val_if_fail (analysis != NULL, NULL);
+	visual_return_val_if_fail (channel >= 0 && channel < VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST, NULL);
+
+	switch (size) {
+		case 256:
+			return audio_analysis_spectrum (analysis, channel, 0, log_scaled);
+
+		case 512:
+			return audio_analysis_spectrum (analysis, channel, 1, log_scaled);
+
+		case 1024:
+			return audio_analysis_spectrum (analysis, channel, 2, log_scaled);
+
+		default:
+			return NULL;
+	}
+}
+
 int visual_audio_get_sample (VisAudio *audio, VisBuffer *buffer, const char *channelid)
 {
 	VisAudioSamplePoolChannel *channel;
@@ -335,7 +496,8 @@ int visual_audio_get_sample (VisAudio *audio, VisBuffer *buffer, const char *cha
 		return -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL;
 	}
 
-	visual_ringbuffer_get_data_from_end (channel->samples, buffer, visual_buffer_get_size (buffer));
+	visual_audio_samplepool_channel_get_data (channel, visual_buffer_get_data (buffer),
+			visual_buffer_get_size (buffer) / sizeof (float));
 
 	return VISUAL_OK;
 }
@@ -347,15 +509,16 @@ int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, in
 	VisBuffer temp;
 	char **chanids;
 	va_list ap;
+	int heap;
 	int i;
 	int first = TRUE;
 
 	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	visual_buffer_init_allocate (&temp, visual_buffer_get_size (buffer), visual_buffer_destroyer_free);
+	audio_scratch_buffer_init (&temp, visual_buffer_get_size (buffer));
 
-	chanids = visual_mem_malloc (channels * sizeof (char *));
+	chanids = audio_scratch_alloc (channels * sizeof (char *), &heap);
 
 	va_start (ap, channels);
 
@@ -384,7 +547,7 @@ int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, in
 
 	visual_object_unref (VISUAL_OBJECT (&temp));
 
-	visual_mem_free (chanids);
+	audio_scratch_free (chanids, heap);
 
 	return VISUAL_OK;
 }
@@ -395,16 +558,17 @@ int visual_audio_get_sample_mixed (VisAudio *audio, VisBuffer *buffer, int divid
 	char **chanids;
 	double *chanmuls;
 	va_list ap;
+	int heapids, heapmuls;
 	int i;
 	int first = TRUE;
 
 	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	visual_buffer_init_allocate (&temp, visual_buffer_get_size (buffer), visual_buffer_destroyer_free);
+	audio_scratch_buffer_init (&temp, visual_buffer_get_size (buffer));
 
-	chanids = visual_mem_malloc (channels * sizeof (char *));
-	chanmuls = visual_mem_malloc (channels * sizeof (double));
+	chanids = audio_scratch_alloc (channels * sizeof (char *), &heapids);
+	chanmuls = audio_scratch_alloc (channels * sizeof (double), &heapmuls);
 
 	va_start (ap, channels);
 
@@ -434,8 +598,8 @@ int visual_audio_get_sample_mixed (VisAudio *audio, VisBuffer *buffer, int divid
 
 	visual_object_unref (VISUAL_OBJECT (&temp));
 
-	visual_mem_free (chanids);
-	visual_mem_free (chanmuls);
+	audio_scratch_free (chanids, heapids);
+	audio_scratch_free (chanmuls, heapmuls);
 
 	return VISUAL_OK;
 }
@@ -517,7 +681,8 @@ int visual_audio_get_spectrum (VisAudio *audio, VisBuffer *buffer, int samplelen
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	visual_buffer_init_allocate (&sample, samplelen, visual_buffer_destroyer_free);
+	/* Within a frame the samples come from the frame arena, so they don't hit the allocator */
+	audio_scratch_buffer_init (&sample, samplelen);
 
 	if (visual_audio_get_sample (audio, &sample, channelid) == VISUAL_OK)
 		visual_audio_get_spectrum_for_sample (buffer, &sample, normalised);
@@ -551,22 +716,33 @@ int visual_audio_get_spectrum_multiplied (VisAudio *audio, VisBuffer *buffer, in
 
 int visual_audio_get_spectrum_for_sample (VisBuffer *buffer, VisBuffer *sample, int normalised)
 {
-	VisDFT dft;
+	float *scratch;
+	VisDFTPlan *plan;
+	int heap;
+	unsigned int samples_in;
+	unsigned int samples_out;
 
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 	visual_return_val_if_fail (sample != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	visual_dft_init (&dft, visual_buffer_get_size (buffer) / sizeof (float),
-			visual_buffer_get_size (sample) / sizeof (float));
+	samples_in = visual_buffer_get_size (sample) / sizeof (float);
+	samples_out = visual_buffer_get_size (buffer) / sizeof (float);
+
+	/* The plan is shared and looked up by table index, the scratch space is ours */
+	plan = visual_dft_plan_get (samples_in);
+	visual_return_val_if_fail (plan != NULL, -VISUAL_ERROR_FOURIER_NULL);
+
+	scratch = audio_scratch_alloc (sizeof (float) * visual_dft_plan_get_scratch_size (plan), &heap);
 
 	/* Fourier analyze the pcm data */
-	visual_dft_perform (&dft, visual_buffer_get_data (buffer), visual_buffer_get_data (sample));
+	visual_dft_plan_perform (plan, visual_buffer_get_data (buffer), samples_out,
+			visual_buffer_get_data (sample), samples_in, scratch);
+
+	audio_scratch_free (scratch, heap);
 
 	if (normalised == TRUE)
 		visual_audio_normalise_spectrum (buffer);
 
-	visual_object_unref (VISUAL_OBJECT (&dft));
-
 	return VISUAL_OK;
 }
 
@@ -627,6 +803,13 @@ int visual_audio_samplepool_init (VisAudioSamplePool *samplepool)
 	/* Reset the VisAudioSamplePool structure */
 	samplepool->channels = visual_list_new (visual_object_collection_destroyer);
 
+	/* Stereo input is the common case, having the channels in place means that the input
+	 * thread does not need to touch the channel list while the render thread walks it */
+	visual_audio_samplepool_add_channel (samplepool,
+			visual_audio_samplepool_channel_new (VISUAL_AUDIO_CHANNEL_LEFT));
+	visual_audio_samplepool_add_channel (samplepool,
+			visual_audio_samplepool_channel_new (VISUAL_AUDIO_CHANNEL_RIGHT));
+
 	return VISUAL_OK;
 }
 
@@ -638,14 +821,7 @@ int visual_audio_samplepool_add (VisAudioSamplePool *samplepool, VisAudioSample
 	visual_return_val_if_fail (sample != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_NULL);
 
-	channel = visual_audio_samplepool_get_channel (samplepool, channelid);
-
-	/* Channel not there yet, make it */
-	if (channel == NULL) {
-		channel = visual_audio_samplepool_channel_new (channelid);
-
-		visual_audio_samplepool_add_channel (samplepool, channel);
-	}
+	channel = samplepool_get_channel_or_add (samplepool, channelid);
 
 	visual_audio_samplepool_channel_add (channel, sample);
 
@@ -697,12 +873,18 @@ int visual_audio_samplepool_input (VisAudioSamplePool *samplepool, VisBuffer *bu
 		VisAudioSampleFormatType format,
 		VisAudioSampleChannelType channeltype)
 {
+	VisMemTag oldtag;
+
 	visual_return_val_if_fail (samplepool != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_AUDIO);
+
 	if (channeltype == VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO)
 		input_interleaved_stereo (samplepool, buffer, format, rate);
 
+	visual_mem_set_tag (oldtag);
+
 	return VISUAL_OK;
 }
 
@@ -711,24 +893,18 @@ int visual_audio_samplepool_input_channel (VisAudioSamplePool *samplepool, VisBu
 		VisAudioSampleFormatType format,
 		const char *channelid)
 {
-	VisAudioSample *sample;
-	VisBuffer *pcmbuf;
-	VisTime timestamp;
+	VisAudioSamplePoolChannel *channel;
 
 	visual_return_val_if_fail (samplepool != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
+	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (format > VISUAL_AUDIO_SAMPLE_FORMAT_NONE &&
+			format < VISUAL_AUDIO_SAMPLE_FORMAT_LAST, -VISUAL_ERROR_NULL);
 
-	pcmbuf = visual_buffer_new ();
-	visual_buffer_clone (pcmbuf, buffer);
-
-	visual_time_get (&timestamp);
-
-	visual_buffer_set_destroyer (pcmbuf, visual_buffer_destroyer_free);
-
-	sample = visual_audio_sample_new (pcmbuf, &timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, channelid);
+	channel = samplepool_get_channel_or_add (samplepool, channelid);
 
-	return VISUAL_OK;
+	return visual_audio_samplepool_channel_write (channel, visual_buffer_get_data (buffer),
+			visual_buffer_get_size (buffer) / visual_audio_sample_format_get_size (format), 1, format);
 }
 
 VisAudioSamplePoolChannel *visual_audio_samplepool_channel_new (const char *channelid)
@@ -756,8 +932,13 @@ int visual_audio_samplepool_channel_init (VisAudioSamplePoolChannel *channel, co
 	visual_object_set_allocated (VISUAL_OBJECT (channel), FALSE);
 
 	/* Reset the VisAudioSamplePoolChannel data */
-	channel->samples = visual_ringbuffer_new ();
+	channel->samples = visual_mem_new0 (float, VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES);
+	channel->samples_head = 0;
+	channel->samples_claim = 0;
+	channel->samples_tail = 0;
+	channel->samples_seen = 0;
 
+	visual_time_get (&channel->samples_seen_time);
 	visual_time_set (&channel->samples_timeout, 1, 0); /* FIXME not safe against time screws */
 	channel->channelid = visual_strdup (channelid);
 	channel->factor = 1.0;
@@ -770,43 +951,147 @@ int visual_audio_samplepool_channel_add (VisAudioSamplePoolChannel *channel, Vis
 	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
 	visual_return_val_if_fail (sample != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 
-	visual_ringbuffer_add_function (channel->samples,
-			sample_data_func,
-			sample_destroy_func,
-			sample_size_func, sample);
+	/* The samples are copied into the ring, the channel takes over the reference
+	 * like it did when it kept the VisAudioSample itself */
+	visual_audio_samplepool_channel_write (channel, visual_buffer_get_data (sample->buffer),
+			visual_buffer_get_size (sample->buffer) / visual_audio_sample_format_get_size (sample->format),
+			1, sample->format);
+
+	visual_object_unref (VISUAL_OBJECT (sample));
 
 	return VISUAL_OK;
 }
 
 int visual_audio_samplepool_channel_flush_old (VisAudioSamplePoolChannel *channel)
 {
-	VisList *list;
-	VisListEntry *le = NULL;
-	VisRingBufferEntry *rentry;
-	VisAudioSample *sample;
+	VisTime curtime;
+	VisTime diff;
+	int head;
 
 	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
 
-	list = visual_ringbuffer_get_list (channel->samples);
+	head = visual_atomic_int_get (&channel->samples_head);
 
-	while ((rentry = visual_list_next (list, &le)) != NULL) {
-		VisTime diff;
-		VisTime curtime;
+	visual_time_get (&curtime);
 
-		sample = visual_ringbuffer_entry_get_functiondata (rentry);
+	/* Everything in the ring expires together once the input went quiet */
+	if (head != channel->samples_seen) {
+		channel->samples_seen = head;
+		visual_time_copy (&channel->samples_seen_time, &curtime);
 
-		visual_time_get (&curtime);
+		return VISUAL_OK;
+	}
 
-		visual_time_difference (&diff, &sample->timestamp, &curtime);
+	visual_time_difference (&diff, &channel->samples_seen_time, &curtime);
 
-		if (visual_time_past (&diff, &channel->samples_timeout) == TRUE) {
-			visual_list_destroy (list, &le);
+	if (visual_time_past (&diff, &channel->samples_timeout) == TRUE)
+		channel->samples_tail = head;
 
-			if (le == NULL)
-				break;
-		}
+	return VISUAL_OK;
+}
+
+int visual_audio_samplepool_channel_write (VisAudioSamplePoolChannel *channel, const void *data,
+		int samples, int stride, VisAudioSampleFormatType format)
+{
+	const uint8_t *src = data;
+	unsigned int head;
+	unsigned int offset;
+	int size;
+	int span;
+
+	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
+	visual_return_val_if_fail (data != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (format > VISUAL_AUDIO_SAMPLE_FORMAT_NONE &&
+			format < VISUAL_AUDIO_SAMPLE_FORMAT_LAST, -VISUAL_ERROR_NULL);
+
+	if (samples <= 0)
+		return VISUAL_OK;
+
+	size = visual_audio_sample_format_get_size (format);
+
+	/* Only the writer changes the head, so it can be read without a barrier here */
+	head = channel->samples_head;
+
+	/* Samples that would be overwritten within this write are skipped right away */
+	if (samples > VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES) {
+		src += (samples - VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES) * stride * size;
+		head += samples - VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES;
+		samples = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES;
+	}
+
+	samplepool_channel_claim (channel, head + samples);
+
+	/* At most two spans, up to the end of the ring and from the start */
+	offset = head & (VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - 1);
+	span = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - offset;
+
+	if (span > samples)
+		span = samples;
+
+	sample_convert_to_float (channel->samples + offset, src, span, stride, format);
+
+	if (span < samples)
+		sample_convert_to_float (channel->samples, src + span * stride * size, samples - span, stride, format);
+
+	/* Publish the samples, the reader never sees the head before the data */
+	visual_atomic_int_set (&channel->samples_head, head + samples);
+
+	return VISUAL_OK;
+}
+
+int visual_audio_samplepool_channel_get_data (VisAudioSamplePoolChannel *channel, float *data, int samples)
+{
+	unsigned int head;
+	unsigned int claim;
+	unsigned int offset;
+	unsigned int available;
+	int tries;
+	int count;
+	int valid;
+	int span;
+
+	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
+	visual_return_val_if_fail (data != NULL, -VISUAL_ERROR_NULL);
+
+	for (tries = 0; tries < 4; tries++) {
+		head = visual_atomic_int_get (&channel->samples_head);
+
+		available = head - (unsigned int) channel->samples_tail;
+		if (available > VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES)
+			available = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES;
+
+		count = samples < (int) available ? samples : (int) available;
+
+		offset = (head - count) & (VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - 1);
+		span = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - offset;
+
+		if (span > count)
+			span = count;
+
+		visual_mem_copy (data + samples - count, channel->samples + offset, span * sizeof (float));
+		visual_mem_copy (data + samples - count + span, channel->samples, (count - span) * sizeof (float));
+
+		/* Every sample the copy saw of a write was claimed before it was written, so
+		 * the claim read after the copy covers all writes that reached the copy. Those
+		 * overwrote the samples before claim - VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES. */
+		visual_atomic_barrier ();
+
+		claim = visual_atomic_int_get (&channel->samples_claim);
+
+		valid = claim - head >= VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES ? 0 :
+			VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - (int) (claim - head);
+
+		if (valid >= count)
+			break;
 	}
 
+	/* The writer kept lapping the copy, the oldest samples it overwrote are dropped */
+	if (valid < count)
+		count = valid;
+
+	if (count < samples)
+		visual_mem_set (data, 0, (samples - count) * sizeof (float));
+
 	return VISUAL_OK;
 }
 
@@ -854,12 +1139,13 @@ int visual_audio_sample_buffer_mix_many (VisBuffer *dest, int divide, int channe
 	VisBuffer **buffers;
 	double *chanmuls;
 	va_list ap;
+	int heapbuffers, heapmuls;
 	int i;
 
 	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	buffers = visual_mem_malloc (channels * sizeof (VisBuffer *));
-	chanmuls = visual_mem_malloc (channels * sizeof (double));
+	buffers = audio_scratch_alloc (channels * sizeof (VisBuffer *), &heapbuffers);
+	chanmuls = audio_scratch_alloc (channels * sizeof (double), &heapmuls);
 
 	va_start (ap, channels);
 
@@ -879,8 +1165,8 @@ int visual_audio_sample_buffer_mix_many (VisBuffer *dest, int divide, int channe
 
 	va_end (ap);
 
-	visual_mem_free (buffers);
-	visual_mem_free (chanmuls);
+	audio_scratch_free (buffers, heapbuffers);
+	audio_scratch_free (chanmuls, heapmuls);
 
 	return VISUAL_OK;
 }
@@ -935,6 +1221,9 @@ int visual_audio_sample_has_internal (VisAudioSample *sample)
 
 int visual_audio_sample_transform_format (VisAudioSample *dest, VisAudioSample *src, VisAudioSampleFormatType format)
 {
+	int entries;
+	int sentries;
+
 	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 	visual_return_val_if_fail (src != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 
@@ -948,32 +1237,14 @@ int visual_audio_sample_transform_format (VisAudioSample *dest, VisAudioSample *
 
 	dest->format = format;
 
-	if (dest->format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT) {
+	entries = visual_buffer_get_size (dest->buffer) / visual_audio_sample_format_get_size (dest->format);
+	sentries = visual_buffer_get_size (src->buffer) / visual_audio_sample_format_get_size (src->format);
 
-		transform_format_buffer_from_float (dest->buffer, src->buffer,
-				visual_audio_sample_format_get_size (src->format),
-				visual_audio_sample_format_is_signed (src->format));
+	if (sentries < entries)
+		entries = sentries;
 
-	} else if (src->format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT) {
-
-		transform_format_buffer_to_float (dest->buffer, src->buffer,
-				visual_audio_sample_format_get_size (dest->format),
-				visual_audio_sample_format_is_signed (dest->format));
-
-	} else if (dest->format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT && src->format ==
-			VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT) {
-
-				visual_buffer_put (dest->buffer, src->buffer, 0);
-	} else {
-
-		transform_format_buffer (dest->buffer, src->buffer,
-				visual_audio_sample_format_get_size (dest->format),
-				visual_audio_sample_format_get_size (src->format),
-				visual_audio_sample_format_is_signed (dest->format),
-				visual_audio_sample_format_is_signed (src->format));
-	}
-
-	return VISUAL_OK;
+	return visual_audio_sample_convert (visual_buffer_get_data (dest->buffer), dest->format,
+			visual_buffer_get_data (src->buffer), src->format, entries);
 }
 
 int visual_audio_sample_transform_rate (VisAudioSample *dest, VisAudioSample *src, VisAudioSampleRateType rate)
@@ -1054,295 +1325,273 @@ int visual_audio_sample_format_is_signed (VisAudioSampleFormatType format)
 	return formatsignedtable[format];
 }
 
-static int byte_max_numeric (int bytes)
+#define SAMPLE_CONVERT_TO_FLOAT(type, expr)								\
+	{												\
+		for (i = 0; i < samples; i++) {								\
+			type sample = *((const type *) src);						\
+			dest[i] = expr;									\
+			src += stride;									\
+		}											\
+	}
+
+static void sample_convert_to_float (float *dest, const uint8_t *src, int samples, int stride,
+		VisAudioSampleFormatType format)
 {
-	int result = 256;
 	int i;
 
-	if (bytes == 0)
-		return 0;
+	/* Packed samples go through the vector conversion */
+	if (stride == 1) {
+		visual_audio_sample_convert (dest, VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT, src, format, samples);
+
+		return;
+	}
+
+	/* From here on stride is in bytes */
+	stride *= visual_audio_sample_format_get_size (format);
 
-	for (i = 1; i < bytes; i++)
-		result *= 256;
-
-	return result;
-}
-
-/* FIXME use lv_math acceleration here! */
-#define FORMAT_BUFFER_FROM_FLOAT(a,b)										\
-	{													\
-		if (sign) {											\
-			a *dbuf = visual_buffer_get_data (src);							\
-			for (i = 0; i < entries; i++) {								\
-				dbuf[i] = sbuf[i] * signedcorr;							\
-			}											\
-		} else {											\
-			b *dbuf = visual_buffer_get_data (src);							\
-			for (i = 0; i < entries; i++) {								\
-				dbuf[i] = (sbuf[i] * signedcorr) + signedcorr;					\
-			}											\
-		}												\
+	switch (format) {
+		case VISUAL_AUDIO_SAMPLE_FORMAT_U8:
+			SAMPLE_CONVERT_TO_FLOAT (uint8_t, (sample - 128) * (1.0f / 128));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_S8:
+			SAMPLE_CONVERT_TO_FLOAT (int8_t, sample * (1.0f / 128));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_U16:
+			SAMPLE_CONVERT_TO_FLOAT (uint16_t, (sample - 32768) * (1.0f / 32768));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_S16:
+			SAMPLE_CONVERT_TO_FLOAT (int16_t, sample * (1.0f / 32768));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_U32:
+			SAMPLE_CONVERT_TO_FLOAT (uint32_t, ((int64_t) sample - 2147483648LL) * (1.0f / 2147483648.0f));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_S32:
+			SAMPLE_CONVERT_TO_FLOAT (int32_t, sample * (1.0f / 2147483648.0f));
+			break;
+
+		case VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT:
+			SAMPLE_CONVERT_TO_FLOAT (float, sample);
+			break;
+
+		default:
+			break;
 	}
+}
 
-static int transform_format_buffer_from_float (VisBuffer *dest, VisBuffer *src, int size, int sign)
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static int sample_deinterleave_s16_sse2 (float *left, float *right, const int16_t *src, int frames)
 {
-	float *sbuf = visual_buffer_get_data (src);
-	int entries = visual_buffer_get_size (dest) / size;
-	int signedcorr = 0;
+	static const float scale[4] = {
+		1.0f / 32768, 1.0f / 32768, 1.0f / 32768, 1.0f / 32768
+	};
 	int i;
 
-	signedcorr += byte_max_numeric (size) / 2;
-
-	if (size == 1)
-		FORMAT_BUFFER_FROM_FLOAT(int8_t, uint8_t)
-	else if (size == 2)
-		FORMAT_BUFFER_FROM_FLOAT(int16_t, uint16_t)
-	else if (size == 4)
-		FORMAT_BUFFER_FROM_FLOAT(int32_t, uint32_t)
+	/* Every dword holds one frame, left in the low word: shift and sign extend both halves */
+	for (i = 0; i + 8 <= frames; i += 8) {
+		__asm __volatile
+			("\n\t movups (%[s]), %%xmm7"
+			 "\n\t movdqu (%[p]), %%xmm0"
+			 "\n\t movdqu 16(%[p]), %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm2, %%xmm3"
+			 "\n\t pslld $16, %%xmm0"
+			 "\n\t pslld $16, %%xmm2"
+			 "\n\t psrad $16, %%xmm0"
+			 "\n\t psrad $16, %%xmm1"
+			 "\n\t psrad $16, %%xmm2"
+			 "\n\t psrad $16, %%xmm3"
+			 "\n\t cvtdq2ps %%xmm0, %%xmm0"
+			 "\n\t cvtdq2ps %%xmm1, %%xmm1"
+			 "\n\t cvtdq2ps %%xmm2, %%xmm2"
+			 "\n\t cvtdq2ps %%xmm3, %%xmm3"
+			 "\n\t mulps %%xmm7, %%xmm0"
+			 "\n\t mulps %%xmm7, %%xmm1"
+			 "\n\t mulps %%xmm7, %%xmm2"
+			 "\n\t mulps %%xmm7, %%xmm3"
+			 "\n\t movups %%xmm0, (%[l])"
+			 "\n\t movups %%xmm2, 16(%[l])"
+			 "\n\t movups %%xmm1, (%[r])"
+			 "\n\t movups %%xmm3, 16(%[r])"
+			 :: [p] "r" (src + i * 2), [l] "r" (left + i), [r] "r" (right + i), [s] "r" (scale)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+	}
 
-	return VISUAL_OK;
+	return i;
 }
 
-#define FORMAT_BUFFER_TO_FLOAT(a,b)										\
-	{													\
-		float multiplier = 1.0 / signedcorr;								\
-		if (sign) {											\
-			a *sbuf = visual_buffer_get_data (src);							\
-			for (i = 0; i < entries; i++) {								\
-				dbuf[i] = sbuf[i] * multiplier;							\
-			}											\
-		} else {											\
-			b *sbuf = visual_buffer_get_data (src);							\
-			for (i = 0; i < entries; i++) {								\
-				dbuf[i] = (sbuf[i] - signedcorr) * multiplier;					\
-			}											\
-		}												\
+static int sample_deinterleave_float_sse (float *left, float *right, const float *src, int frames)
+{
+	int i;
+
+	for (i = 0; i + 4 <= frames; i += 4) {
+		__asm __volatile
+			("\n\t movups (%[p]), %%xmm0"
+			 "\n\t movups 16(%[p]), %%xmm1"
+			 "\n\t movaps %%xmm0, %%xmm2"
+			 "\n\t shufps $0x88, %%xmm1, %%xmm0"
+			 "\n\t shufps $0xdd, %%xmm1, %%xmm2"
+			 "\n\t movups %%xmm0, (%[l])"
+			 "\n\t movups %%xmm2, (%[r])"
+			 :: [p] "r" (src + i * 2), [l] "r" (left + i), [r] "r" (right + i)
+			 : "memory", "xmm0", "xmm1", "xmm2");
 	}
 
-static int transform_format_buffer_to_float (VisBuffer *dest, VisBuffer *src, int size, int sign)
+	return i;
+}
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static int sample_deinterleave_s16_neon (float *left, float *right, const int16_t *src, int frames)
 {
-	float *dbuf = visual_buffer_get_data (dest);
-	int entries = visual_buffer_get_size (dest) /
-		visual_audio_sample_format_get_size (VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT);
-	int signedcorr;
 	int i;
 
-	signedcorr = byte_max_numeric (size) / 2;
+	for (i = 0; i + 8 <= frames; i += 8) {
+		int16x8x2_t lr = vld2q_s16 (src + i * 2);
 
-	if (size == 1)
-		FORMAT_BUFFER_TO_FLOAT(int8_t, uint8_t)
-	else if (size == 2)
-		FORMAT_BUFFER_TO_FLOAT(int16_t, uint16_t)
-	else if (size == 4)
-		FORMAT_BUFFER_TO_FLOAT(int32_t, uint32_t)
+		vst1q_f32 (left + i, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (lr.val[0]))), 1.0f / 32768));
+		vst1q_f32 (left + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (lr.val[0]))), 1.0f / 32768));
+		vst1q_f32 (right + i, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (lr.val[1]))), 1.0f / 32768));
+		vst1q_f32 (right + i + 4, vmulq_n_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (lr.val[1]))), 1.0f / 32768));
+	}
 
-	return VISUAL_OK;
+	return i;
 }
 
-#define FORMAT_BUFFER(a,b,c,d)											\
-		{												\
-			if (signedcorr == 0) {									\
-				visual_buffer_put (dest, src, 0);						\
-			} else {										\
-				if (signedcorr < 0) {								\
-					a *dbuf = visual_buffer_get_data (dest);				\
-					b *sbuf = visual_buffer_get_data (src);					\
-					for (i = 0; i < entries; i++) {						\
-						dbuf[i] = sbuf[i] + signedcorr;					\
-					}									\
-				} else {									\
-					c *dbuf = visual_buffer_get_data (dest);				\
-					d *sbuf = visual_buffer_get_data (src);					\
-					for (i = 0; i < entries; i++) {						\
-						dbuf[i] = sbuf[i] + signedcorr;					\
-					}									\
-				}										\
-			}											\
-		}
+static int sample_deinterleave_float_neon (float *left, float *right, const float *src, int frames)
+{
+	int i;
 
-#define FORMAT_BUFFER_INCREASE(a,b,c,d)										\
-		{												\
-			if (signedcorr < 0) {									\
-				a *dbuf = visual_buffer_get_data (dest);					\
-				b *sbuf = visual_buffer_get_data (src);						\
-				for (i = 0; i < entries; i++) {							\
-					dbuf[i] = (sbuf[i] << shifter) + signedcorr;				\
-				}										\
-			} else {										\
-				c *dbuf = visual_buffer_get_data (dest);					\
-				d *sbuf = visual_buffer_get_data (src);						\
-				for (i = 0; i < entries; i++) {							\
-					dbuf[i] = (sbuf[i] << shifter) + signedcorr;				\
-				}										\
-			}											\
-		}
+	for (i = 0; i + 4 <= frames; i += 4) {
+		float32x4x2_t lr = vld2q_f32 (src + i * 2);
 
-#define FORMAT_BUFFER_DECREASE(a,b,c,d)										\
-		{												\
-			if (signedcorr < 0) {									\
-				a *dbuf = visual_buffer_get_data (dest);					\
-				b *sbuf = visual_buffer_get_data (src);						\
-				for (i = 0; i < entries; i++) {							\
-					dbuf[i] = (sbuf[i] >> shifter) + signedcorr;				\
-				}										\
-			} else {										\
-				c *dbuf = visual_buffer_get_data (dest);					\
-				d *sbuf = visual_buffer_get_data (src);						\
-				for (i = 0; i < entries; i++) {							\
-					dbuf[i] = (sbuf[i] >> shifter) + signedcorr;				\
-				}										\
-			}											\
-		}
+		vst1q_f32 (left + i, lr.val[0]);
+		vst1q_f32 (right + i, lr.val[1]);
+	}
 
-static int transform_format_buffer (VisBuffer *dest, VisBuffer *src, int dsize, int ssize, int dsigned, int ssigned)
+	return i;
+}
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
+
+static void sample_deinterleave_to_float (float *left, float *right, const uint8_t *src, int frames,
+		VisAudioSampleFormatType format)
 {
-	int signedcorr = 0;
-	int entries = visual_buffer_get_size (dest) / dsize;
-	int shifter = 0;
-	int i;
+	int size = visual_audio_sample_format_get_size (format);
+	int done = 0;
+
+	/* The vector kernels do the bulk of the common formats, the tail and the
+	 * other formats go through the scalar conversion */
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+	if (format == VISUAL_AUDIO_SAMPLE_FORMAT_S16 && visual_cpu_get_sse2 ())
+		done = sample_deinterleave_s16_sse2 (left, right, (const int16_t *) src, frames);
+	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT && visual_cpu_get_sse ())
+		done = sample_deinterleave_float_sse (left, right, (const float *) src, frames);
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+	if (format == VISUAL_AUDIO_SAMPLE_FORMAT_S16 && visual_cpu_get_neon ())
+		done = sample_deinterleave_s16_neon (left, right, (const int16_t *) src, frames);
+	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT && visual_cpu_get_neon ())
+		done = sample_deinterleave_float_neon (left, right, (const float *) src, frames);
+#endif
 
-	if (dsigned == TRUE && ssigned == FALSE)
-		signedcorr -= byte_max_numeric (ssize) / 2;
-	else if (dsigned == FALSE && ssigned == TRUE)
-		signedcorr += byte_max_numeric (dsize) / 2;
-
-	if (dsize > ssize)
-		shifter = dsize - ssize;
-	else if (dsize < ssize)
-		shifter = ssize - dsize;
-
-	/* FIXME simd versions of every conversion */
-	if (dsize == 1 && ssize == 1)		/* 8 to 8 */
-		FORMAT_BUFFER(int8_t, uint8_t, uint8_t, int8_t)
-	else if (dsize == 2 && ssize == 1)	/* 8 to 16 */
-		FORMAT_BUFFER_INCREASE(int16_t, int8_t, uint16_t, uint8_t)
-	else if (dsize == 4 && ssize == 1)	/* 8 to 32 */
-		FORMAT_BUFFER_INCREASE(int32_t, int8_t, uint32_t, uint8_t)
-	else if (dsize == 2 && ssize == 2)	/* 16 to 16 */
-		FORMAT_BUFFER(int16_t, uint16_t, uint16_t, int16_t)
-	else if (dsize == 4 && ssize == 2)	/* 32 to 16 */
-		FORMAT_BUFFER_INCREASE(int32_t, int16_t, uint32_t, uint16_t)
-	else if (dsize == 4 && ssize == 4)	/* 32 to 32 */
-		FORMAT_BUFFER(int32_t, uint32_t, uint32_t, int32_t)
-	else if (dsize == 1 && ssize == 2)	/* 16 to 8 */
-		FORMAT_BUFFER_DECREASE(int8_t, int16_t, uint8_t, uint16_t)
-	else if (dsize == 2 && ssize == 4)	/* 32 to 16 */
-		FORMAT_BUFFER_DECREASE(int16_t, int32_t, uint16_t, uint32_t)
-	else if (dsize == 1 && ssize == 4)	/* 32 to 8 */
-		FORMAT_BUFFER_DECREASE(int8_t, int32_t, uint8_t, uint32_t)
+	src += done * 2 * size;
 
-	return VISUAL_OK;
+	sample_convert_to_float (left + done, src, frames - done, 2, format);
+	sample_convert_to_float (right + done, src + size, frames - done, 2, format);
 }
 
-static VisBuffer *sample_data_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry)
+static void samplepool_write_stereo (VisAudioSamplePoolChannel *left, VisAudioSamplePoolChannel *right,
+		const uint8_t *src, int frames, VisAudioSampleFormatType format)
 {
-	VisAudioSample *sample = entry->functiondata;
+	int size = visual_audio_sample_format_get_size (format);
+	unsigned int head;
+	unsigned int offset;
+	int span;
+
+	/* Only when both rings line up can they be filled in one pass, which is always
+	 * the case unless one of them has been written to on its own */
+	if (left->samples_head != right->samples_head) {
+		visual_audio_samplepool_channel_write (left, src, frames, 2, format);
+		visual_audio_samplepool_channel_write (right, src + size, frames, 2, format);
+
+		return;
+	}
 
-	/* We have internal format ready */
-	if (sample->processed != NULL) {
-		visual_object_ref (VISUAL_OBJECT (sample->processed));
+	head = left->samples_head;
 
-		return sample->processed;
+	if (frames > VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES) {
+		src += (frames - VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES) * 2 * size;
+		head += frames - VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES;
+		frames = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES;
 	}
 
-	sample->processed = visual_buffer_new_allocate (
-			(visual_buffer_get_size (sample->buffer) /
-			 visual_audio_sample_format_get_size (sample->format)) * sizeof (float),
-			visual_buffer_destroyer_free);
+	samplepool_channel_claim (left, head + frames);
+	samplepool_channel_claim (right, head + frames);
 
-	transform_format_buffer_to_float (sample->processed, sample->buffer,
-			visual_audio_sample_format_get_size (sample->format),
-			visual_audio_sample_format_is_signed (sample->format));
+	offset = head & (VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - 1);
+	span = VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES - offset;
 
-	visual_object_ref (VISUAL_OBJECT (sample->processed));
+	if (span > frames)
+		span = frames;
 
-	return sample->processed;
+	sample_deinterleave_to_float (left->samples + offset, right->samples + offset, src, span, format);
+
+	if (span < frames)
+		sample_deinterleave_to_float (left->samples, right->samples, src + span * 2 * size,
+				frames - span, format);
+
+	visual_atomic_int_set (&left->samples_head, head + frames);
+	visual_atomic_int_set (&right->samples_head, head + frames);
 }
 
-static void sample_destroy_func (VisRingBufferEntry *entry)
+/* Announces the samples up to claim before they are written, no sample store can be
+ * seen before the claim */
+static void samplepool_channel_claim (VisAudioSamplePoolChannel *channel, unsigned int claim)
 {
-	VisAudioSample *sample = entry->functiondata;
+	visual_atomic_int_set (&channel->samples_claim, claim);
 
-	visual_object_unref (VISUAL_OBJECT (sample));
+	visual_atomic_barrier ();
 }
 
-static int sample_size_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry)
+static VisAudioSamplePoolChannel *samplepool_get_channel_or_add (VisAudioSamplePool *samplepool,
+		const char *channelid)
 {
-	VisAudioSample *sample = entry->functiondata;
+	VisAudioSamplePoolChannel *channel;
 
-	return (visual_buffer_get_size (sample->buffer) /
-		visual_audio_sample_format_get_size (sample->format)) * sizeof (float);
-}
+	channel = visual_audio_samplepool_get_channel (samplepool, channelid);
 
-/*  functions */
-#define STEREO_INTERLEAVED(x)											\
-		{																\
-			/* do we have at least one complete frame? */				\
-			visual_size_t bufsize = visual_buffer_get_size (buffer); 	\
-			visual_return_val_if_fail(bufsize > sizeof(x), -1);		\
-			/* go around troubles with bufsizes <= 1) */				\
-			visual_return_val_if_fail(bufsize > 1, -1);				\
-																		\
-			chan1 = visual_buffer_new_allocate (sizeof (x) * ((visual_buffer_get_size (buffer) / 2)),	\
-				visual_buffer_destroyer_free);							\
-			chan2 = visual_buffer_new_allocate (sizeof (x) * ((visual_buffer_get_size (buffer) / 2)),	\
-					visual_buffer_destroyer_free);						\
-																		\
-			x *pcm = visual_buffer_get_data (buffer);					\
-			x *chan1buf = visual_buffer_get_data (chan1);				\
-			x *chan2buf = visual_buffer_get_data (chan2);				\
-																		\
-			visual_return_val_if_fail (pcm != NULL, -1); 			\
-			visual_return_val_if_fail (chan1buf != NULL, -1); 		\
-			visual_return_val_if_fail (chan2buf != NULL, -1); 		\
-																		\
-			for (i = 0; i < visual_buffer_get_size (buffer); i += 2) 	\
-			{															\
-				chan1buf[i >> 1] = pcm[i];								\
-				chan2buf[i >> 1] = pcm[i + 1];							\
-			}															\
-		}
+	/* Channel not there yet, make it */
+	if (channel == NULL) {
+		channel = visual_audio_samplepool_channel_new (channelid);
+
+		visual_audio_samplepool_add_channel (samplepool, channel);
+	}
+
+	return channel;
+}
 
 static int input_interleaved_stereo (VisAudioSamplePool *samplepool, VisBuffer *buffer,
 		VisAudioSampleFormatType format,
 		VisAudioSampleRateType rate)
 {
-	VisBuffer *chan1 = NULL;
-	VisBuffer *chan2 = NULL;
-	VisAudioSample *sample;
-	VisTime timestamp;
-	int i;
-
-	visual_time_get (&timestamp);
-
-	if (format == VISUAL_AUDIO_SAMPLE_FORMAT_U8)
-		STEREO_INTERLEAVED(uint8_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_S8)
-		STEREO_INTERLEAVED(int8_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_U16)
-		STEREO_INTERLEAVED(uint16_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_S16)
-		STEREO_INTERLEAVED(int16_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_U32)
-		STEREO_INTERLEAVED(uint32_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_S32)
-		STEREO_INTERLEAVED(int32_t)
-	else if (format == VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT)
-		STEREO_INTERLEAVED(float)
-	else
-		return -1;
-
-	visual_return_val_if_fail (chan1 != NULL, -1);
-	visual_return_val_if_fail (chan2 != NULL, -1);
+	const uint8_t *pcm = visual_buffer_get_data (buffer);
+	int frames = visual_buffer_get_size (buffer) / 2;
 
-	visual_buffer_set_destroyer (chan1, visual_buffer_destroyer_free);
-	visual_buffer_set_destroyer (chan2, visual_buffer_destroyer_free);
+	visual_return_val_if_fail (format > VISUAL_AUDIO_SAMPLE_FORMAT_NONE &&
+			format < VISUAL_AUDIO_SAMPLE_FORMAT_LAST, -1);
 
-	sample = visual_audio_sample_new (chan1, &timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, VISUAL_AUDIO_CHANNEL_LEFT);
+	/* do we have at least one complete frame? */
+	visual_return_val_if_fail (frames > 0, -1);
+	visual_return_val_if_fail (pcm != NULL, -1);
 
-	sample = visual_audio_sample_new (chan2, &timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, VISUAL_AUDIO_CHANNEL_RIGHT);
+	/* Deinterleave straight into the channel rings */
+	samplepool_write_stereo (
+			samplepool_get_channel_or_add (samplepool, VISUAL_AUDIO_CHANNEL_LEFT),
+			samplepool_get_channel_or_add (samplepool, VISUAL_AUDIO_CHANNEL_RIGHT),
+			pcm, frames, format);
 
 	return VISUAL_OK;
 }
@@ -1361,7 +1610,7 @@ int visual_audio_get_cheap_audio_data(VisAudio *audio, unsigned char out[2][2][5
     unsigned char visdata[size*2];
     float data[2][2][size];
 
-    visual_buffer_init_allocate(&tmp, sizeof(float) * size, visual_buffer_destroyer_free);
+    audio_scratch_buffer_init(&tmp, sizeof(float) * size);
 
     /* Left audio */
     visual_buffer_set_data_pair(&pcmbuf1, data[0][0], sizeof(float) * size);
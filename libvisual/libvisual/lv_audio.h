@@ -77,11 +77,32 @@ typedef enum {
 	VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO
 } VisAudioSampleChannelType;
 
+/**
+ * Number of samples per channel that are kept in a VisAudioAnalysis.
+ */
+#define VISUAL_AUDIO_ANALYSIS_SAMPLES	2048
+
+/**
+ * Number of samples that a VisAudioSamplePoolChannel keeps, must be a power of two.
+ */
+#define VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES	32768
+
+/**
+ * Channels that are available in a VisAudioAnalysis.
+ */
+typedef enum {
+	VISUAL_AUDIO_ANALYSIS_CHANNEL_LEFT = 0,		/**< The front left channel. */
+	VISUAL_AUDIO_ANALYSIS_CHANNEL_RIGHT,		/**< The front right channel. */
+	VISUAL_AUDIO_ANALYSIS_CHANNEL_MIX,		/**< The average of the left and right channel. */
+	VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST
+} VisAudioAnalysisChannel;
+
 
 typedef struct _VisAudio VisAudio;
 typedef struct _VisAudioSamplePool VisAudioSamplePool;
 typedef struct _VisAudioSamplePoolChannel VisAudioSamplePoolChannel;
 typedef struct _VisAudioSample VisAudioSample;
+typedef struct _VisAudioAnalysis VisAudioAnalysis;
 
 /**
  * The VisAudio structure contains the sample and extra information
@@ -109,6 +130,8 @@ struct _VisAudio {
 //	short int		 bpmenergy[6];			/**< Private member for BPM detection, not implemented right now. */
 	int			 energy;			/**< Audio energy level. */
 	VisBeat			*beat; 				/**< Beat per minute. */
+	VisAudioAnalysis	*analysis;			/**< The analysis of the current frame, see
+								 * visual_audio_get_analysis(). */
 };
 
 struct _VisAudioSamplePool {
@@ -117,11 +140,26 @@ struct _VisAudioSamplePool {
 	VisList		*channels;
 };
 
+/**
+ * The VisAudioSamplePoolChannel keeps the latest samples of one channel, converted to
+ * float, in a contiguous ring of VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_SAMPLES entries.
+ *
+ * One thread may write to the ring (the input) while another reads from it (the render
+ * thread) without locking. The writer never waits, samples that are not read in time
+ * are overwritten. Before it writes, the writer claims the samples up to
+ * samples_claim, so a reader can tell which of the samples it copied were being
+ * overwritten meanwhile.
+ */
 struct _VisAudioSamplePoolChannel {
 	VisObject	 object;
 
-	VisRingBuffer	*samples;
-	VisTime		 samples_timeout;
+	float		*samples;			/**< The sample ring. */
+	volatile int	 samples_head;			/**< Number of samples written, only changed by the writer. */
+	volatile int	 samples_claim;			/**< Number of samples written or being written. */
+	int		 samples_tail;			/**< Samples before this position have expired. */
+	int		 samples_seen;			/**< samples_head at the last visual_audio_samplepool_channel_flush_old(). */
+	VisTime		 samples_seen_time;		/**< The time at which samples_head last moved. */
+	VisTime		 samples_timeout;		/**< Samples expire when no input arrives for this long. */
 
 	char		*channelid;
 
@@ -140,6 +178,36 @@ struct _VisAudioSample {
 	VisBuffer			*processed;
 };
 
+/**
+ * The VisAudioAnalysis structure is a snapshot of everything that is derived from the
+ * audio for one frame, so that all actors that render the frame share the same data
+ * instead of extracting and transforming the samples themselves. The pcm data and the
+ * energy are filled by visual_audio_analyze(). A spectrum is only computed the first
+ * time it is asked for through visual_audio_analysis_get_spectrum() in a frame, the
+ * spectrum members must not be read directly.
+ *
+ * The pcm data is ordered from old to new, spectra are not normalised and the log
+ * spectra are scaled with visual_dft_log_scale_standard().
+ *
+ * @see visual_audio_get_analysis
+ */
+struct _VisAudioAnalysis {
+	unsigned int	 frame;						/**< Incremented on every analysis. */
+
+	float		 pcm[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][VISUAL_AUDIO_ANALYSIS_SAMPLES];
+									/**< The latest samples per channel. */
+
+	float		 spectrum_256[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][256];	/**< Spectrum of the latest 512 samples. */
+	float		 spectrum_512[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][512];	/**< Spectrum of the latest 1024 samples. */
+	float		 spectrum_1024[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][1024];	/**< Spectrum of the latest 2048 samples. */
+
+	float		 log_spectrum_256[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][256];	/**< Log scaled spectrum_256. */
+	float		 log_spectrum_512[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][512];	/**< Log scaled spectrum_512. */
+	float		 log_spectrum_1024[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST][1024];	/**< Log scaled spectrum_1024. */
+
+	float		 energy[VISUAL_AUDIO_ANALYSIS_CHANNEL_LAST];	/**< RMS level of the latest 512 samples. */
+};
+
 /**
  * Creates a new VisAudio structure.
  *
@@ -175,6 +243,42 @@ int visual_audio_init (VisAudio *audio);
  */
 int visual_audio_analyze (VisAudio *audio);
 
+/**
+ * Function to retrieve the analysis snapshot of the current frame. The snapshot is owned
+ * by the VisAudio and is overwritten by the next visual_audio_analyze().
+ *
+ * @param audio Pointer to the VisAudio.
+ *
+ * @return The VisAudioAnalysis, or NULL when the VisAudio has not been analyzed yet.
+ */
+VisAudioAnalysis *visual_audio_get_analysis (VisAudio *audio);
+
+/**
+ * Function to retrieve the latest samples of a channel from a VisAudioAnalysis.
+ *
+ * @param analysis Pointer to the VisAudioAnalysis.
+ * @param channel The channel.
+ * @param samples The number of samples wanted, at most VISUAL_AUDIO_ANALYSIS_SAMPLES.
+ *
+ * @return Pointer to the samples, or NULL on failure.
+ */
+float *visual_audio_analysis_get_pcm (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel, int samples);
+
+/**
+ * Function to retrieve a spectrum of a channel from a VisAudioAnalysis. The spectrum
+ * is computed on the first request of the frame and kept until the next
+ * visual_audio_analyze(), like the rest of the analysis it belongs to the thread that
+ * renders the frame.
+ *
+ * @param analysis Pointer to the VisAudioAnalysis.
+ * @param channel The channel.
+ * @param size The number of bands, 256, 512 or 1024.
+ * @param log_scaled Whether the log scaled spectrum is wanted.
+ *
+ * @return Pointer to the spectrum, or NULL when the size is not available.
+ */
+float *visual_audio_analysis_get_spectrum (VisAudioAnalysis *analysis, VisAudioAnalysisChannel channel, int size, int log_scaled);
+
 int visual_audio_get_sample (VisAudio *audio, VisBuffer *buffer, const char *channelid);
 int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, int channels, ...);
 int visual_audio_get_sample_mixed (VisAudio *audio, VisBuffer *buffer, int divide, int channels, ...);
@@ -209,6 +313,40 @@ int visual_audio_samplepool_channel_init (VisAudioSamplePoolChannel *channel, co
 int visual_audio_samplepool_channel_add (VisAudioSamplePoolChannel *channel, VisAudioSample *sample);
 int visual_audio_samplepool_channel_flush_old (VisAudioSamplePoolChannel *channel);
 
+/**
+ * Function to append samples to a VisAudioSamplePoolChannel. The samples are converted
+ * to float while they are copied into the ring, nothing is allocated.
+ *
+ * Only one thread may write to a channel at a time.
+ *
+ * @param channel Pointer to the VisAudioSamplePoolChannel.
+ * @param data Pointer to the samples.
+ * @param samples The number of samples.
+ * @param stride The distance between two samples in data, in samples. Use 1 for
+ *	mono data, 2 to pick one channel out of interleaved stereo data.
+ * @param format The format of the samples.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL or
+ *	-VISUAL_ERROR_NULL on failure.
+ */
+int visual_audio_samplepool_channel_write (VisAudioSamplePoolChannel *channel, const void *data,
+		int samples, int stride, VisAudioSampleFormatType format);
+
+/**
+ * Function to retrieve the latest samples of a VisAudioSamplePoolChannel, ordered from
+ * old to new. When the channel has fewer samples, the start of data is filled with silence.
+ *
+ * This can be called while another thread writes to the channel.
+ *
+ * @param channel Pointer to the VisAudioSamplePoolChannel.
+ * @param data Pointer to the destination.
+ * @param samples The number of samples wanted.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL or
+ *	-VISUAL_ERROR_NULL on failure.
+ */
+int visual_audio_samplepool_channel_get_data (VisAudioSamplePoolChannel *channel, float *data, int samples);
+
 int visual_audio_sample_buffer_mix (VisBuffer *dest, VisBuffer *src, int divide, float multiplier);
 int visual_audio_sample_buffer_mix_many (VisBuffer *dest, int divide, int channels, ...);
 
@@ -225,6 +363,34 @@ int visual_audio_sample_rate_get_length (VisAudioSampleRateType rate);
 int visual_audio_sample_format_get_size (VisAudioSampleFormatType format);
 int visual_audio_sample_format_is_signed (VisAudioSampleFormatType format);
 
+/**
+ * Converts a run of packed samples from one format into another. Integer formats are
+ * widened by shifting into the most significant bits and narrowed by truncating the
+ * low bits, unsigned formats are centered around half their range. Floats run from
+ * -1.0 to 1.0, values outside that range are clamped when converting to an integer
+ * format.
+ *
+ * The conversion uses the SSE2, AVX2 or NEON kernels picked by
+ * visual_audio_sample_convert_initialize(), their results are identical to the C
+ * version.
+ *
+ * @param dest Pointer to the destination samples.
+ * @param dformat The format of the destination samples.
+ * @param src Pointer to the source samples, should not overlap with dest.
+ * @param sformat The format of the source samples.
+ * @param samples The number of samples to convert.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_audio_sample_convert (void *dest, VisAudioSampleFormatType dformat,
+		const void *src, VisAudioSampleFormatType sformat, int samples);
+
+/**
+ * Picks the fastest sample conversion kernels for the CPU, this is called from
+ * visual_init(). Call it again after changing the enabled CPU features.
+ */
+void visual_audio_sample_convert_initialize (void);
+
 VisBeat *visual_audio_get_beat(VisAudio *audio);
 
 /**
@@ -27,6 +27,14 @@
 #include "lv_list.h"
 #include "gettext.h"
 
+#include <string.h>
+
+enum {
+	BIN_WORKER_IDLE,
+	BIN_WORKER_RUN,
+	BIN_WORKER_QUIT
+};
+
 /* WARNING: Utterly shit ahead, i've screwed up on this and i need to
  * rewrite it. And i can't say i feel like it at the moment so be
  * patient :)  */
@@ -36,12 +44,22 @@ static int bin_dtor (VisObject *object);
 static void fix_depth_with_bin (VisBin *bin, VisVideo *video, int depth);
 static int bin_get_depth_using_preferred (VisBin *bin, int depthflag);
 
+static void *bin_worker_thread (void *data);
+static int bin_worker_start (VisBin *bin);
+static void bin_worker_stop (VisBin *bin);
+
+static int bin_run_frame (VisBin *bin);
+static int bin_can_run_threaded (VisBin *bin);
+static void bin_run_actors_threaded (VisBin *bin);
+
 static int bin_dtor (VisObject *object)
 {
 	VisBin *bin = VISUAL_BIN (object);
 
 	visual_return_val_if_fail (bin != NULL, -1);
 
+	bin_worker_stop (bin);
+
 	if (bin->actor != NULL)
 		visual_object_unref (VISUAL_OBJECT (bin->actor));
 
@@ -92,6 +110,131 @@ static int bin_get_depth_using_preferred (VisBin *bin, int depthflag)
 		return visual_video_depth_get_highest (depthflag);
 }
 
+static void *bin_worker_thread (void *data)
+{
+	VisBin *bin = VISUAL_BIN (data);
+
+	visual_mutex_lock (bin->workermutex);
+
+	for (;;) {
+		while (bin->workerstate == BIN_WORKER_IDLE)
+			visual_cond_wait (bin->workercond, bin->workermutex);
+
+		if (bin->workerstate == BIN_WORKER_QUIT)
+			break;
+
+		/* The main thread doesn't touch the actmorph until we're idle again */
+		visual_mutex_unlock (bin->workermutex);
+
+		visual_actor_run (bin->actmorph, bin->input->audio);
+
+		visual_mutex_lock (bin->workermutex);
+
+		bin->workerstate = BIN_WORKER_IDLE;
+		visual_cond_broadcast (bin->workercond);
+	}
+
+	visual_mutex_unlock (bin->workermutex);
+
+	return NULL;
+}
+
+static int bin_worker_start (VisBin *bin)
+{
+	if (bin->worker != NULL)
+		return TRUE;
+
+	if (visual_thread_is_supported () == FALSE || visual_thread_is_enabled () == FALSE)
+		return FALSE;
+
+	bin->workermutex = visual_mutex_new ();
+	bin->workercond = visual_cond_new ();
+	bin->workerstate = BIN_WORKER_IDLE;
+
+	if (bin->workermutex != NULL && bin->workercond != NULL)
+		bin->worker = visual_thread_create (bin_worker_thread, bin, TRUE);
+
+	if (bin->worker == NULL) {
+		visual_log (VISUAL_LOG_WARNING, _("Could not start the morph worker thread, morphing serially"));
+
+		bin_worker_stop (bin);
+		bin->morphthreaded = FALSE;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void bin_worker_stop (VisBin *bin)
+{
+	if (bin->worker != NULL) {
+		visual_mutex_lock (bin->workermutex);
+
+		bin->workerstate = BIN_WORKER_QUIT;
+		visual_cond_broadcast (bin->workercond);
+
+		visual_mutex_unlock (bin->workermutex);
+
+		visual_thread_join (bin->worker);
+		visual_thread_free (bin->worker);
+	}
+
+	if (bin->workercond != NULL)
+		visual_cond_free (bin->workercond);
+
+	if (bin->workermutex != NULL)
+		visual_mutex_free (bin->workermutex);
+
+	bin->worker = NULL;
+	bin->workercond = NULL;
+	bin->workermutex = NULL;
+}
+
+static int bin_can_run_threaded (VisBin *bin)
+{
+	if (bin->morphthreaded == FALSE || bin->morphing == FALSE)
+		return FALSE;
+
+	/* Only a real morph renders both actors */
+	if (bin->morphstyle != VISUAL_SWITCH_STYLE_MORPH ||
+			bin->actmorph == NULL || bin->actmorph->video == NULL || bin->actor->video == NULL ||
+			bin->actmorph->video->depth == VISUAL_VIDEO_DEPTH_GL ||
+			bin->actor->video->depth == VISUAL_VIDEO_DEPTH_GL)
+		return FALSE;
+
+	/* Two instances of one plugin would share its static state */
+	if (strcmp (bin->actor->plugin->info->plugname, bin->actmorph->plugin->info->plugname) == 0)
+		return FALSE;
+
+	/* The actors may only write into their own buffers */
+	if (bin->actor->video == bin->actmorph->video ||
+			visual_video_get_pixels (bin->actor->video) == visual_video_get_pixels (bin->actmorph->video))
+		return FALSE;
+
+	return bin_worker_start (bin);
+}
+
+static void bin_run_actors_threaded (VisBin *bin)
+{
+	visual_mutex_lock (bin->workermutex);
+
+	bin->workerstate = BIN_WORKER_RUN;
+	visual_cond_broadcast (bin->workercond);
+
+	visual_mutex_unlock (bin->workermutex);
+
+	visual_actor_run (bin->actor, bin->input->audio);
+
+	/* Join before the morph reads both buffers */
+	visual_mutex_lock (bin->workermutex);
+
+	while (bin->workerstate == BIN_WORKER_RUN)
+		visual_cond_wait (bin->workercond, bin->workermutex);
+
+	visual_mutex_unlock (bin->workermutex);
+}
+
 VisBin *visual_bin_new ()
 {
 	VisBin *bin;
@@ -795,8 +938,36 @@ int visual_bin_switch_set_time (VisBin *bin, long sec, long usec)
 	return 0;
 }
 
+int visual_bin_switch_set_threaded (VisBin *bin, int threaded)
+{
+	visual_return_val_if_fail (bin != NULL, -1);
+
+	bin->morphthreaded = threaded;
+
+	if (threaded == FALSE)
+		bin_worker_stop (bin);
+
+	return 0;
+}
+
 int visual_bin_run (VisBin *bin)
 {
+	int ret;
+
+	/* Frame memory lives until the frame is done */
+	visual_mem_frame_begin ();
+
+	ret = bin_run_frame (bin);
+
+	visual_mem_frame_end ();
+
+	return ret;
+}
+
+static int bin_run_frame (VisBin *bin)
+{
+	int actmorphdone;
+
 	visual_return_val_if_fail (bin != NULL, -1);
 	visual_return_val_if_fail (bin->actor != NULL, -1);
 	visual_return_val_if_fail (bin->input != NULL, -1);
@@ -855,7 +1026,14 @@ int visual_bin_run (VisBin *bin)
 	 * requested after the connect, thus we can realize there yet */
 	visual_actor_realize (bin->actor);
 
-	visual_actor_run (bin->actor, bin->input->audio);
+	/* While morphing both actors render into their own video, so the
+	 * actmorph can be done on the worker in the meantime */
+	actmorphdone = bin_can_run_threaded (bin);
+
+	if (actmorphdone == TRUE)
+		bin_run_actors_threaded (bin);
+	else
+		visual_actor_run (bin->actor, bin->input->audio);
 
 	if (bin->morphing == TRUE) {
 		visual_return_val_if_fail (bin->actmorph != NULL, -1);
@@ -866,7 +1044,8 @@ int visual_bin_run (VisBin *bin)
 			bin->actmorph->video->depth != VISUAL_VIDEO_DEPTH_GL &&
 			bin->actor->video->depth != VISUAL_VIDEO_DEPTH_GL) {
 
-			visual_actor_run (bin->actmorph, bin->input->audio);
+			if (actmorphdone == FALSE)
+				visual_actor_run (bin->actmorph, bin->input->audio);
 
 			if (bin->morph == NULL || bin->morph->plugin == NULL) {
 				visual_bin_switch_finalize (bin);
@@ -29,6 +29,7 @@
 #include <libvisual/lv_morph.h>
 #include <libvisual/lv_video.h>
 #include <libvisual/lv_time.h>
+#include <libvisual/lv_thread.h>
 
 /**
  * @defgroup VisBin VisBin
@@ -85,6 +86,12 @@ struct _VisBin {
 	int		 depthfromGL;		/* Set when switching away from openGL */
 	int		 depthforced;		/* Contains forced depth value, for the actmorph so we've got smooth transformations */
 	int		 depthforcedmain;	/* Contains forced depth value, for the main actor */
+
+	int		 morphthreaded;		/* Render the actmorph on a worker thread while morphing */
+	VisThread	*worker;		/* Worker thread, started on the first threaded morph */
+	VisMutex	*workermutex;
+	VisCond		*workercond;
+	int		 workerstate;		/* Idle, running the actmorph or quitting */
 };
 
 /* prototypes */
@@ -126,6 +133,7 @@ int visual_bin_switch_set_automatic (VisBin *bin, int automatic);
 int visual_bin_switch_set_rate (VisBin *bin, float rate);
 int visual_bin_switch_set_mode (VisBin *bin, VisMorphMode mode);
 int visual_bin_switch_set_time (VisBin *bin, long sec, long usec);
+int visual_bin_switch_set_threaded (VisBin *bin, int threaded);
 
 int visual_bin_run (VisBin *bin);
 
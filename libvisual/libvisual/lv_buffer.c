@@ -168,8 +168,12 @@ int visual_buffer_allocate_data (VisBuffer *buffer)
 {
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	if (buffer->datasize > 0)
-		buffer->data = visual_mem_malloc0 (buffer->datasize);
+	/* Aligned for SIMD loads, pixel and sample buffers are allocated here */
+	if (buffer->datasize > 0) {
+		buffer->data = visual_mem_malloc_aligned (buffer->datasize, VISUAL_MEM_ALIGN_SIMD);
+
+		visual_mem_set (buffer->data, 0, buffer->datasize);
+	}
 
 	buffer->allocated = TRUE;
 
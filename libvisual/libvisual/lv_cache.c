@@ -37,7 +37,7 @@ static int cache_dtor (VisObject *object)
 	VisListEntry *le = NULL;
 
 	/* Destroy all entries in cache first */
-	while (visual_list_next (cache->list, &le) != NULL)
+	while ((le = cache->list->head) != NULL)
 		cache_remove_list_entry (cache, &le);
 
 	/* Destroy the rest */
@@ -67,6 +67,9 @@ static int cache_remove_list_entry (VisCache *cache, VisListEntry **le)
 
 	visual_list_destroy (cache->list, le);
 
+	visual_mem_free (centry->key);
+	visual_mem_free (centry);
+
 	return VISUAL_OK;
 }
 
@@ -132,7 +135,7 @@ int visual_cache_clear (VisCache *cache)
 	visual_return_val_if_fail (cache != NULL, -VISUAL_ERROR_CACHE_NULL);
 
 	/* Destroy all entries in cache first */
-	while (visual_list_next (cache->list, &le) != NULL)
+	while ((le = cache->list->head) != NULL)
 		cache_remove_list_entry (cache, &le);
 
 	if (cache->index != NULL)
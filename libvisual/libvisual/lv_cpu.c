@@ -69,6 +69,9 @@ static int __lv_cpu_initialized = FALSE;
 
 static int has_cpuid (void);
 static int cpuid (unsigned int ax, unsigned int *p);
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static int has_os_avx_support (void);
+#endif
 
 #if defined(VISUAL_OS_WIN32)
 LONG CALLBACK win32_sig_handler_sse(EXCEPTION_POINTERS* ep);
@@ -307,14 +310,29 @@ static int has_cpuid (void)
 
 static int cpuid (unsigned int ax, unsigned int *p)
 {
-#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+#if defined(VISUAL_ARCH_X86)
 	__asm __volatile
 		("movl %%ebx, %%esi\n\t"
 		 "cpuid\n\t"
 		 "xchgl %%ebx, %%esi"
 		 : "=a" (p[0]), "=S" (p[1]),
 		 "=c" (p[2]), "=d" (p[3])
-		 : "0" (ax));
+		 : "0" (ax), "2" (0));
+
+	return VISUAL_OK;
+#elif defined(VISUAL_ARCH_X86_64)
+	/* Save the whole of rbx, a 32 bits xchg clears the upper half */
+	uint64_t b;
+
+	__asm __volatile
+		("movq %%rbx, %%rsi\n\t"
+		 "cpuid\n\t"
+		 "xchgq %%rbx, %%rsi"
+		 : "=a" (p[0]), "=S" (b),
+		 "=c" (p[2]), "=d" (p[3])
+		 : "0" (ax), "2" (0));
+
+	p[1] = b;
 
 	return VISUAL_OK;
 #else
@@ -322,6 +340,22 @@ static int cpuid (unsigned int ax, unsigned int *p)
 #endif
 }
 
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+/* The OS has to save the ymm registers on context switches, or avx can't be used */
+static int has_os_avx_support (void)
+{
+	unsigned int a, d;
+
+	/* xgetbv, spelled out for assemblers that don't know it */
+	__asm __volatile
+		(".byte 0x0f, 0x01, 0xd0"
+		 : "=a" (a), "=d" (d)
+		 : "c" (0));
+
+	return (a & 0x6) == 0x6;
+}
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
 void visual_cpu_initialize ()
 {
 	unsigned int regs[4];
@@ -346,7 +380,7 @@ void visual_cpu_initialize ()
 #elif defined(VISUAL_ARCH_POWERPC)
 	__lv_cpu_caps.type = VISUAL_CPU_TYPE_POWERPC;
 #elif defined(VISUAL_ARCH_ARM)
-	__lv_cpu.caps.type = VISUAL_CPU_TYPE_ARM;
+	__lv_cpu_caps.type = VISUAL_CPU_TYPE_ARM;
 #else
 	__lv_cpu_caps.type = VISUAL_CPU_TYPE_OTHER;
 #endif
@@ -369,6 +403,9 @@ void visual_cpu_initialize ()
 
 		__lv_cpu_caps.nrcpu = android_getCpuCount();
 	}
+#elif defined(VISUAL_ARCH_ARM) && (defined(__ARM_NEON__) || defined(__aarch64__))
+	/* Built for a NEON target, so the CPU is required to have it */
+	__lv_cpu_caps.hasNeon = 1;
 #endif /* VISUAL_OS_ANDROID && VISUAL_ARCH_ARM */
 
 	/* Count the number of CPUs in system */
@@ -414,8 +451,19 @@ void visual_cpu_initialize ()
 		__lv_cpu_caps.hasMMX  = (regs2[3] & (1 << 23 )) >> 23; /* 0x0800000 */
 		__lv_cpu_caps.hasSSE  = (regs2[3] & (1 << 25 )) >> 25; /* 0x2000000 */
 		__lv_cpu_caps.hasSSE2 = (regs2[3] & (1 << 26 )) >> 26; /* 0x4000000 */
+		__lv_cpu_caps.hasSSSE3 = (regs2[2] & (1 << 9 )) >> 9; /* 0x0000200 */
+		__lv_cpu_caps.hasSSE41 = (regs2[2] & (1 << 19 )) >> 19; /* 0x0080000 */
 		__lv_cpu_caps.hasMMX2 = __lv_cpu_caps.hasSSE; /* SSE cpus supports mmxext too */
 
+		/* avx needs osxsave (bit 27) and avx (bit 28), avx2 itself is in leaf 7 */
+		if (regs[0] >= 0x00000007 && (regs2[2] & (3 << 27)) == (3 << 27) && has_os_avx_support ()) {
+			unsigned int regs7[4];
+
+			cpuid (0x00000007, regs7);
+
+			__lv_cpu_caps.hasAVX2 = (regs7[1] & (1 << 5 )) >> 5; /* 0x0000020 */
+		}
+
 		cacheline = ((regs2[1] >> 8) & 0xFF) * 8;
 		if (cacheline > 0)
 			__lv_cpu_caps.cacheline = cacheline;
@@ -444,9 +492,12 @@ void visual_cpu_initialize ()
 
 	if (!__lv_cpu_caps.hasSSE)
 		__lv_cpu_caps.hasSSE2 = 0;
-#else
-	__lv_cpu_caps.hasSSE = 0;
-	__lv_cpu_caps.hasSSE2 = 0;
+
+	if (!__lv_cpu_caps.hasSSE2) {
+		__lv_cpu_caps.hasSSSE3 = 0;
+		__lv_cpu_caps.hasSSE41 = 0;
+		__lv_cpu_caps.hasAVX2 = 0;
+	}
 #endif
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
 
@@ -460,6 +511,9 @@ void visual_cpu_initialize ()
 	__lv_cpu_caps.enabledMMX2	= __lv_cpu_caps.hasMMX2;
 	__lv_cpu_caps.enabledSSE	= __lv_cpu_caps.hasSSE;
 	__lv_cpu_caps.enabledSSE2	= __lv_cpu_caps.hasSSE2;
+	__lv_cpu_caps.enabledSSSE3	= __lv_cpu_caps.hasSSSE3;
+	__lv_cpu_caps.enabledSSE41	= __lv_cpu_caps.hasSSE41;
+	__lv_cpu_caps.enabledAVX2	= __lv_cpu_caps.hasAVX2;
 	__lv_cpu_caps.enabled3DNow	= __lv_cpu_caps.has3DNow;
 	__lv_cpu_caps.enabled3DNowExt    = __lv_cpu_caps.has3DNowExt;
 	__lv_cpu_caps.enabledAltiVec     = __lv_cpu_caps.hasAltiVec;
@@ -479,6 +533,9 @@ void visual_cpu_initialize ()
 	visual_log (VISUAL_LOG_DEBUG, "CPU: MMX2 %d", __lv_cpu_caps.hasMMX2);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: SSE %d", __lv_cpu_caps.hasSSE);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: SSE2 %d", __lv_cpu_caps.hasSSE2);
+	visual_log (VISUAL_LOG_DEBUG, "CPU: SSSE3 %d", __lv_cpu_caps.hasSSSE3);
+	visual_log (VISUAL_LOG_DEBUG, "CPU: SSE4.1 %d", __lv_cpu_caps.hasSSE41);
+	visual_log (VISUAL_LOG_DEBUG, "CPU: AVX2 %d", __lv_cpu_caps.hasAVX2);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: 3DNow %d", __lv_cpu_caps.has3DNow);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: 3DNowExt %d", __lv_cpu_caps.has3DNowExt);
 #elif defined(VISUAL_ARCH_POWERPC)
@@ -540,6 +597,30 @@ int visual_cpu_get_sse2 ()
 	return __lv_cpu_caps.enabledSSE2;
 }
 
+int visual_cpu_get_ssse3 ()
+{
+	if (__lv_cpu_initialized == FALSE)
+		visual_log (VISUAL_LOG_ERROR, _("The VisCPU system is not initialized."));
+
+	return __lv_cpu_caps.enabledSSSE3;
+}
+
+int visual_cpu_get_sse41 ()
+{
+	if (__lv_cpu_initialized == FALSE)
+		visual_log (VISUAL_LOG_ERROR, _("The VisCPU system is not initialized."));
+
+	return __lv_cpu_caps.enabledSSE41;
+}
+
+int visual_cpu_get_avx2 ()
+{
+	if (__lv_cpu_initialized == FALSE)
+		visual_log (VISUAL_LOG_ERROR, _("The VisCPU system is not initialized."));
+
+	return __lv_cpu_caps.enabledAVX2;
+}
+
 int visual_cpu_get_3dnow ()
 {
 	if (__lv_cpu_initialized == FALSE)
@@ -595,3 +676,113 @@ int visual_cpu_get_ldrex_strex (void)
 
 	return __lv_cpu_caps.enabledLDREX_STREX;
 }
+
+int visual_cpu_set_mmx (int enabled)
+{
+	if (__lv_cpu_caps.hasMMX == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledMMX = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_mmx2 (int enabled)
+{
+	if (__lv_cpu_caps.hasMMX2 == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledMMX2 = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_sse (int enabled)
+{
+	if (__lv_cpu_caps.hasSSE == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledSSE = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_sse2 (int enabled)
+{
+	if (__lv_cpu_caps.hasSSE2 == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledSSE2 = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_ssse3 (int enabled)
+{
+	if (__lv_cpu_caps.hasSSSE3 == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledSSSE3 = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_sse41 (int enabled)
+{
+	if (__lv_cpu_caps.hasSSE41 == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledSSE41 = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_avx2 (int enabled)
+{
+	if (__lv_cpu_caps.hasAVX2 == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledAVX2 = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_3dnow (int enabled)
+{
+	if (__lv_cpu_caps.has3DNow == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabled3DNow = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_3dnow2 (int enabled)
+{
+	if (__lv_cpu_caps.has3DNowExt == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabled3DNowExt = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_altivec (int enabled)
+{
+	if (__lv_cpu_caps.hasAltiVec == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledAltiVec = enabled;
+
+	return VISUAL_OK;
+}
+
+int visual_cpu_set_neon (int enabled)
+{
+	if (__lv_cpu_caps.hasNeon == FALSE)
+		return -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED;
+
+	__lv_cpu_caps.enabledNeon = enabled;
+
+	return VISUAL_OK;
+}
@@ -68,6 +68,9 @@ struct _VisCPU {
 	int		hasMMX2;		/**< The CPU has the mmx2 feature. */
 	int		hasSSE;			/**< The CPU has the sse feature. */
 	int		hasSSE2;		/**< The CPU has the sse2 feature. */
+	int		hasSSSE3;		/**< The CPU has the ssse3 feature. */
+	int		hasSSE41;		/**< The CPU has the sse4.1 feature. */
+	int		hasAVX2;		/**< The CPU and OS have the avx2 feature. */
 	int		has3DNow;		/**< The CPU has the 3dnow feature. */
 	int		has3DNowExt;		/**< The CPU has the 3dnowext feature. */
 	int		hasAltiVec;     /**< The CPU has the altivec feature. */
@@ -81,6 +84,9 @@ struct _VisCPU {
 	int		enabledMMX2;		/**< The tsc feature is enabled. */
 	int		enabledSSE;		/**< The sse feature is enabled. */
 	int		enabledSSE2;		/**< The sse2 feature is enabled. */
+	int		enabledSSSE3;		/**< The ssse3 feature is enabled. */
+	int		enabledSSE41;		/**< The sse4.1 feature is enabled. */
+	int		enabledAVX2;		/**< The avx2 feature is enabled. */
 	int		enabled3DNow;		/**< The 3dnow feature is enabled. */
 	int		enabled3DNowExt;	/**< The 3dnowext feature is enabled. */
 	int		enabledAltiVec;		/**< The altivec feature is enabled. */
@@ -145,6 +151,27 @@ int visual_cpu_get_sse (void);
  */
 int visual_cpu_get_sse2 (void);
 
+/**
+ * Function to retrieve if the SSSE3 CPU feature is enabled.
+ *
+ * @return Whether SSSE3 is enabled or not.
+ */
+int visual_cpu_get_ssse3 (void);
+
+/**
+ * Function to retrieve if the SSE4.1 CPU feature is enabled.
+ *
+ * @return Whether SSE4.1 is enabled or not.
+ */
+int visual_cpu_get_sse41 (void);
+
+/**
+ * Function to retrieve if the AVX2 CPU feature is enabled.
+ *
+ * @return Whether AVX2 is enabled or not.
+ */
+int visual_cpu_get_avx2 (void);
+
 /**
  * Function to retrieve if the 3dnow CPU feature is enabled.
  *
@@ -194,6 +221,105 @@ int visual_cpu_get_neon (void);
  */
 int visual_cpu_get_ldrex_strex (void);
 
+/**
+ * Function to enable or disable the use of the MMX CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks MMX.
+ */
+int visual_cpu_set_mmx (int enabled);
+
+/**
+ * Function to enable or disable the use of the MMX2 CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks MMX2.
+ */
+int visual_cpu_set_mmx2 (int enabled);
+
+/**
+ * Function to enable or disable the use of the SSE CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks SSE.
+ */
+int visual_cpu_set_sse (int enabled);
+
+/**
+ * Function to enable or disable the use of the SSE2 CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks SSE2.
+ */
+int visual_cpu_set_sse2 (int enabled);
+
+/**
+ * Function to enable or disable the use of the SSSE3 CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks SSSE3.
+ */
+int visual_cpu_set_ssse3 (int enabled);
+
+/**
+ * Function to enable or disable the use of the SSE4.1 CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks SSE4.1.
+ */
+int visual_cpu_set_sse41 (int enabled);
+
+/**
+ * Function to enable or disable the use of the AVX2 CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks AVX2.
+ */
+int visual_cpu_set_avx2 (int enabled);
+
+/**
+ * Function to enable or disable the use of the 3dnow CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks 3dnow.
+ */
+int visual_cpu_set_3dnow (int enabled);
+
+/**
+ * Function to enable or disable the use of the 3dnowext CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks 3dnowext.
+ */
+int visual_cpu_set_3dnow2 (int enabled);
+
+/**
+ * Function to enable or disable the use of the altivec CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks altivec.
+ */
+int visual_cpu_set_altivec (int enabled);
+
+/**
+ * Function to enable or disable the use of the ARM Neon CPU feature.
+ *
+ * @param enabled TRUE to enable, FALSE to disable.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_CPU_FEATURE_NOT_SUPPORTED when the CPU lacks ARM Neon.
+ */
+int visual_cpu_set_neon (int enabled);
+
 VISUAL_END_DECLS
 
 /**
@@ -73,6 +73,7 @@ static const char *__lv_error_human_readable[] = {
 
 	[VISUAL_ERROR_EVENT_NULL] =			N_("VisEvent is NULL"),
 	[VISUAL_ERROR_EVENT_QUEUE_NULL] =		N_("VisEventQueue is NULL"),
+	[VISUAL_ERROR_EVENT_QUEUE_FULL] =		N_("VisEventQueue is full"),
 
 	[VISUAL_ERROR_FOURIER_NULL] =			N_("VisFourier is NULL"),
 	[VISUAL_ERROR_FOURIER_NOT_INITIALIZED]	=	N_("The VisFourier subsystem is not initialized"),
@@ -98,6 +99,7 @@ static const char *__lv_error_human_readable[] = {
 	[VISUAL_ERROR_LIST_ENTRY_INVALID] =		N_("VisListEntry is invalid"),
 
 	[VISUAL_ERROR_MEM_NULL] =			N_("Given memory pointer is NULL"),
+	[VISUAL_ERROR_MEM_IN_USE] =			N_("Memory is already allocated, the allocator can't change"),
 
 	[VISUAL_ERROR_MORPH_NULL] =			N_("VisMorph is NULL"),
 	[VISUAL_ERROR_MORPH_PLUGIN_NULL] =		N_("VisMorph it's plugin is NULL"),
@@ -146,6 +148,10 @@ static const char *__lv_error_human_readable[] = {
 	[VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE] =		N_("VisMutex trylock failed"),
 	[VISUAL_ERROR_MUTEX_UNLOCK_FAILURE] =		N_("VisMutex unlock failed"),
 
+	[VISUAL_ERROR_COND_NULL] =			N_("VisCond is NULL"),
+	[VISUAL_ERROR_COND_WAIT_FAILURE] =		N_("VisCond wait failed"),
+	[VISUAL_ERROR_COND_SIGNAL_FAILURE] =		N_("VisCond signal failed"),
+
 	[VISUAL_ERROR_TRANSFORM_NULL] =			N_("VisTransform is NULL"),
 	[VISUAL_ERROR_TRANSFORM_NEGOTIATE] =		N_("The VisTransform negotiate with the target VisVideo failed"),
 	[VISUAL_ERROR_TRANSFORM_PLUGIN_NULL] =		N_("The VisTransform it's plugin is NULL"),
@@ -94,6 +94,7 @@ enum {
 	/* Error entries for the VisEvent system */
 	VISUAL_ERROR_EVENT_NULL,			/**< The VisEvent is NULL. */
 	VISUAL_ERROR_EVENT_QUEUE_NULL,			/**< The VisEventQueue is NULL. */
+	VISUAL_ERROR_EVENT_QUEUE_FULL,			/**< The VisEventQueue has no room left. */
 
 	/* Error entries for the VisFourier system */
 	VISUAL_ERROR_FOURIER_NULL,			/**< The VisFourier is NULL. */
@@ -127,6 +128,7 @@ enum {
 
 	/* Error entries for the VisMem system */
 	VISUAL_ERROR_MEM_NULL,				/**< The memory pointer given is NULL. */
+	VISUAL_ERROR_MEM_IN_USE,			/**< The allocator can't change after the first allocation. */
 
 	/* Error entries for the VisMorph system */
 	VISUAL_ERROR_MORPH_NULL,			/**< The VisMorph is NULL. */
@@ -183,6 +185,9 @@ enum {
 	VISUAL_ERROR_MUTEX_LOCK_FAILURE,		/**< Failed locking the VisMutex. */
 	VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE,		/**< Failed trylocking the VisMutex. */
 	VISUAL_ERROR_MUTEX_UNLOCK_FAILURE,		/**< Failed unlocking the VisMutex. */
+	VISUAL_ERROR_COND_NULL,				/**< The VisCond is NULL. */
+	VISUAL_ERROR_COND_WAIT_FAILURE,			/**< Failed waiting on the VisCond. */
+	VISUAL_ERROR_COND_SIGNAL_FAILURE,		/**< Failed signalling the VisCond. */
 
 	/* Error entries for the VisTransform system */
 	VISUAL_ERROR_TRANSFORM_NULL,			/**< The VisTransform is NULL. */
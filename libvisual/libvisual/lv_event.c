@@ -24,31 +24,128 @@
 #include "config.h"
 #include "lv_event.h"
 #include "lv_common.h"
+#include "lv_atomic.h"
+#include "lv_thread.h"
 #include "gettext.h"
 
+/*
+ * The queue is a bounded multi producer, single consumer ring. Every slot carries a
+ * sequence number: a slot at position p is free for the producer that claims p when
+ * its sequence is p, and holds a published event for the poller when it is p + 1.
+ * Producers claim positions by moving the tail with a compare and exchange, the
+ * poller owns the head and needs one acquire load per event.
+ */
+
+#define EVENT_QUEUE_MASK	(VISUAL_EVENT_MAXEVENTS - 1)
+
+struct _VisEventQueueSlot {
+	volatile int	 sequence;
+	VisEvent	 event;
+};
+
 static int eventqueue_dtor (VisObject *object);
 
-static int event_list_destroy (void *data);
+static VisEventQueueSlot *eventqueue_get_slots (VisEventQueue *eventqueue);
+static VisEvent *eventqueue_claim (VisEventQueue *eventqueue, int *position);
+static int eventqueue_publish (VisEventQueue *eventqueue, int position);
+static int eventqueue_exchange (volatile int *atomic, int value);
 
 static int eventqueue_dtor (VisObject *object)
 {
 	VisEventQueue *eventqueue = VISUAL_EVENTQUEUE (object);
 
-	visual_collection_destroy (VISUAL_COLLECTION (&eventqueue->events));
+	if (eventqueue->slots != NULL)
+		visual_mem_free (eventqueue->slots);
+
+	eventqueue->slots = NULL;
 
 	return VISUAL_OK;
 }
 
-static int event_list_destroy (void *data)
+/* Queues that were zeroed instead of initialized get their ring on first use */
+static VisEventQueueSlot *eventqueue_get_slots (VisEventQueue *eventqueue)
 {
-	VisEvent *event = VISUAL_EVENT (data);
+	VisEventQueueSlot *slots;
+	int i;
 
-	if (event == NULL)
-		return 0;
+	slots = visual_atomic_pointer_get ((void * volatile *) &eventqueue->slots);
 
-	visual_object_unref (VISUAL_OBJECT (event));
+	if (slots != NULL)
+		return slots;
+
+	slots = visual_mem_malloc0 (sizeof (VisEventQueueSlot) * VISUAL_EVENT_MAXEVENTS);
+
+	for (i = 0; i < VISUAL_EVENT_MAXEVENTS; i++) {
+		slots[i].sequence = eventqueue->head + i;
+
+		visual_event_init (&slots[i].event);
+	}
+
+	if (visual_atomic_pointer_compare_and_exchange ((void * volatile *) &eventqueue->slots, NULL, slots) == FALSE) {
+		visual_mem_free (slots);
+
+		slots = visual_atomic_pointer_get ((void * volatile *) &eventqueue->slots);
+	}
+
+	return slots;
+}
+
+/* Gives a cleared event to fill in, or NULL when the queue is full */
+static VisEvent *eventqueue_claim (VisEventQueue *eventqueue, int *position)
+{
+	VisEventQueueSlot *slots = eventqueue_get_slots (eventqueue);
+	VisEventQueueSlot *slot;
+	int pos;
+	int diff;
+
+	pos = visual_atomic_int_get (&eventqueue->tail);
+
+	for (;;) {
+		slot = &slots[pos & EVENT_QUEUE_MASK];
+
+		/* Positions wrap, compare them as a difference */
+		diff = (int) ((unsigned int) visual_atomic_int_get (&slot->sequence) - (unsigned int) pos);
+
+		if (diff == 0) {
+			if (visual_atomic_int_compare_and_exchange (&eventqueue->tail, pos,
+						(int) ((unsigned int) pos + 1)) == TRUE)
+				break;
+
+			pos = visual_atomic_int_get (&eventqueue->tail);
+		} else if (diff < 0) {
+			/* The poller did not get to this slot yet */
+			return NULL;
+		} else {
+			pos = visual_atomic_int_get (&eventqueue->tail);
+		}
+	}
+
+	visual_object_clean (VISUAL_OBJECT (&slot->event), VisEvent);
 
-	return 0;
+	*position = pos;
+
+	return &slot->event;
+}
+
+static int eventqueue_publish (VisEventQueue *eventqueue, int position)
+{
+	VisEventQueueSlot *slot = &eventqueue->slots[position & EVENT_QUEUE_MASK];
+
+	visual_atomic_int_set (&slot->sequence, (int) ((unsigned int) position + 1));
+	visual_atomic_int_add (&eventqueue->eventcount, 1);
+
+	return VISUAL_OK;
+}
+
+static int eventqueue_exchange (volatile int *atomic, int value)
+{
+	int old;
+
+	do {
+		old = visual_atomic_int_get (atomic);
+	} while (visual_atomic_int_compare_and_exchange (atomic, old, value) == FALSE);
+
+	return old;
 }
 
 
@@ -122,96 +219,104 @@ int visual_event_queue_init (VisEventQueue *eventqueue)
 
 	eventqueue->mousestate = VISUAL_MOUSE_UP;
 
-	visual_collection_set_destroyer (VISUAL_COLLECTION (&eventqueue->events), event_list_destroy);
-
 	visual_event_init (&eventqueue->lastresize);
 
+	eventqueue_get_slots (eventqueue);
+
 	return VISUAL_OK;
 }
 
 int visual_event_queue_poll (VisEventQueue *eventqueue, VisEvent *event)
 {
-	VisEvent *lev;
-	int more_events;
-
-	more_events = visual_event_queue_poll_by_reference (eventqueue, &lev);
-
-	if (more_events != FALSE) {
-		visual_event_copy (event, lev);
-
-		/* FIXME when we start to ref count attributes in events, we need to unref here */
-		visual_object_unref (VISUAL_OBJECT (lev));
-	}
-
-	return more_events;
-}
-
-int visual_event_queue_poll_by_reference (VisEventQueue *eventqueue, VisEvent **event)
-{
-	VisEvent *lev;
-	VisListEntry *listentry = NULL;;
+	VisEventQueueSlot *slot;
+	int head;
 
 	visual_return_val_if_fail (eventqueue != NULL, FALSE);
 	visual_return_val_if_fail (event != NULL, FALSE);
 
 	/* FIXME solve this better */
-	if (eventqueue->resizenew == TRUE) {
+	if (visual_atomic_int_get (&eventqueue->resizenew) == TRUE) {
+		while (visual_atomic_int_compare_and_exchange (&eventqueue->resizelock, FALSE, TRUE) == FALSE)
+			visual_thread_yield ();
+
+		visual_event_copy (event, &eventqueue->lastresize);
 		eventqueue->resizenew = FALSE;
 
-		*event = visual_event_new ();
-		visual_event_copy (*event, &eventqueue->lastresize);
+		visual_atomic_int_set (&eventqueue->resizelock, FALSE);
 
 		return TRUE;
 	}
 
-	if (eventqueue->eventcount <= 0)
+	if (eventqueue->slots == NULL)
+		return FALSE;
+
+	head = eventqueue->head;
+	slot = &eventqueue->slots[head & EVENT_QUEUE_MASK];
+
+	if (visual_atomic_int_get (&slot->sequence) != (int) ((unsigned int) head + 1))
 		return FALSE;
 
-	lev = visual_list_next (&eventqueue->events, &listentry);
+	visual_event_copy (event, &slot->event);
+
+	/* Hand the slot to the producer that claims it one lap later */
+	visual_atomic_int_set (&slot->sequence, (int) ((unsigned int) head + VISUAL_EVENT_MAXEVENTS));
+	visual_atomic_int_add (&eventqueue->eventcount, -1);
+
+	eventqueue->head = (int) ((unsigned int) head + 1);
+
+	return TRUE;
+}
+
+int visual_event_queue_poll_by_reference (VisEventQueue *eventqueue, VisEvent **event)
+{
+	VisEvent lev;
 
-	*event = lev;
+	visual_return_val_if_fail (eventqueue != NULL, FALSE);
+	visual_return_val_if_fail (event != NULL, FALSE);
 
-	visual_list_delete (&eventqueue->events, &listentry);
+	if (visual_event_queue_poll (eventqueue, &lev) == FALSE)
+		return FALSE;
 
-	eventqueue->eventcount--;
+	*event = visual_event_new ();
+	visual_event_copy (*event, &lev);
 
 	return TRUE;
 }
 
 int visual_event_queue_add (VisEventQueue *eventqueue, VisEvent *event)
 {
+	VisEvent *slotevent;
+	int position;
+
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 	visual_return_val_if_fail (event != NULL, -VISUAL_ERROR_EVENT_NULL);
 
 	/* We've got way too much on the queue, not adding events, the important
 	 * event.resize event got data in the event queue structure that makes sure it gets
 	 * looked at */
-	if (eventqueue->eventcount > VISUAL_EVENT_MAXEVENTS) {
-		visual_object_unref (VISUAL_OBJECT (event));
+	slotevent = eventqueue_claim (eventqueue, &position);
 
-		return -1;
-	}
+	if (slotevent != NULL)
+		visual_event_copy (slotevent, event);
 
-	visual_list_add (&eventqueue->events, event);
+	visual_object_unref (VISUAL_OBJECT (event));
 
-	eventqueue->eventcount++;
+	if (slotevent == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
 
-	return VISUAL_OK;
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_keyboard (VisEventQueue *eventqueue, VisKey keysym, int keymod, VisKeyState state)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
-	if (event == NULL) {
-		visual_log (VISUAL_LOG_ERROR,
-				_("Cannot create a new VisEvent structure"));
-
-		return -VISUAL_ERROR_EVENT_NULL;
-	}
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
 
 	/* FIXME name to VISUAL_KEYB_DOWN and KEYB_UP */
 	if (state == VISUAL_KEY_DOWN)
@@ -222,39 +327,43 @@ int visual_event_queue_add_keyboard (VisEventQueue *eventqueue, VisKey keysym, i
 	event->event.keyboard.keysym.sym = keysym;
 	event->event.keyboard.keysym.mod = keymod;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_mousemotion (VisEventQueue *eventqueue, int x, int y)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
 
 	event->type = VISUAL_EVENT_MOUSEMOTION;
 
-	event->event.mousemotion.state = eventqueue->mousestate;
+	event->event.mousemotion.state = visual_atomic_int_get ((volatile int *) &eventqueue->mousestate);
 	event->event.mousemotion.x = x;
 	event->event.mousemotion.y = y;
 
-	event->event.mousemotion.xrel = x - eventqueue->mousex;
-	event->event.mousemotion.yrel = y - eventqueue->mousey;
-
-	eventqueue->mousex = x;
-	eventqueue->mousey = y;
+	/* Relative to the position posted before, whichever thread posted it */
+	event->event.mousemotion.xrel = x - eventqueue_exchange (&eventqueue->mousex, x);
+	event->event.mousemotion.yrel = y - eventqueue_exchange (&eventqueue->mousey, y);
 
-	return visual_event_queue_add (eventqueue, event);;
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_mousebutton (VisEventQueue *eventqueue, int button, VisMouseState state, int x, int y)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
 
 	if (state == VISUAL_MOUSE_DOWN)
 		event->type = VISUAL_EVENT_MOUSEBUTTONDOWN;
@@ -267,9 +376,9 @@ int visual_event_queue_add_mousebutton (VisEventQueue *eventqueue, int button, V
 	event->event.mousebutton.x = x;
 	event->event.mousebutton.y = y;
 
-	eventqueue->mousestate = state;
+	visual_atomic_int_set ((volatile int *) &eventqueue->mousestate, state);
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_resize (VisEventQueue *eventqueue, VisVideo *video, int width, int height)
@@ -278,6 +387,10 @@ int visual_event_queue_add_resize (VisEventQueue *eventqueue, VisVideo *video, i
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
+	/* Resizes never queue up, only the last one matters */
+	while (visual_atomic_int_compare_and_exchange (&eventqueue->resizelock, FALSE, TRUE) == FALSE)
+		visual_thread_yield ();
+
 	event = &eventqueue->lastresize;
 
 	event->type = VISUAL_EVENT_RESIZE;
@@ -289,81 +402,101 @@ int visual_event_queue_add_resize (VisEventQueue *eventqueue, VisVideo *video, i
 
 	eventqueue->resizenew = TRUE;
 
+	visual_atomic_int_set (&eventqueue->resizelock, FALSE);
+
 	return VISUAL_OK;
 }
 
 int visual_event_queue_add_newsong (VisEventQueue *eventqueue, VisSongInfo *songinfo)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 	visual_return_val_if_fail (songinfo != NULL, -VISUAL_ERROR_SONGINFO_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
 
 	event->type = VISUAL_EVENT_NEWSONG;
 
 	/* FIXME refcounting */
 	event->event.newsong.songinfo = songinfo;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_param (VisEventQueue *eventqueue, void *param)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 	visual_return_val_if_fail (param != NULL, -VISUAL_ERROR_PARAM_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
+
 	event->type = VISUAL_EVENT_PARAM;
 
 	/* FIXME ref count the param */
 	event->event.param.param = param;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_quit (VisEventQueue *eventqueue, int pass_zero_please)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
+
 	event->type = VISUAL_EVENT_QUIT;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_visibility (VisEventQueue *eventqueue, int is_visible)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
+
 	event->type = VISUAL_EVENT_VISIBILITY;
 
 	event->event.visibility.is_visible = is_visible;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
 
 int visual_event_queue_add_generic (VisEventQueue *eventqueue, int eid, int param_int, void *param_ptr)
 {
 	VisEvent *event;
+	int position;
 
 	visual_return_val_if_fail (eventqueue != NULL, -VISUAL_ERROR_EVENT_QUEUE_NULL);
 
-	event = visual_event_new ();
+	event = eventqueue_claim (eventqueue, &position);
+	if (event == NULL)
+		return -VISUAL_ERROR_EVENT_QUEUE_FULL;
+
 	event->type = VISUAL_EVENT_GENERIC;
 
 	event->event.generic.event_id = eid;
 	event->event.generic.data_int = param_int;
 	event->event.generic.data_ptr = param_ptr;
 
-	return visual_event_queue_add (eventqueue, event);
+	return eventqueue_publish (eventqueue, position);
 }
-
@@ -26,7 +26,7 @@ VISUAL_BEGIN_DECLS
 #define VISUAL_EVENTQUEUE(obj)				(VISUAL_CHECK_CAST ((obj), VisEventQueue))
 
 /**
- * Number of events allowed in the queue
+ * Number of events allowed in the queue, a power of two.
  */
 #define VISUAL_EVENT_MAXEVENTS	256
 
@@ -78,6 +78,7 @@ typedef struct _VisEventGeneric VisEventGeneric;
 typedef struct _VisEventParam VisEventParam;
 typedef struct _VisEvent VisEvent;
 typedef struct _VisEventQueue VisEventQueue;
+typedef struct _VisEventQueueSlot VisEventQueueSlot;
 
 /**
  * Keyboard event data structure.
@@ -223,19 +224,30 @@ struct _VisEvent {
  * Used to manage events queues and also provides quick access to
  * high piority data from events.
  *
+ * The queue is a bounded ring of preallocated events. Any number of threads can add
+ * events at the same time without allocating, one thread polls them.
+ *
+ * The ring replaced the events VisList, which changed the size and layout of the
+ * structure. VisPluginData embeds a VisEventQueue, so plugins that were built against
+ * the old layout are refused through VISUAL_PLUGIN_API_VERSION.
+ *
  * @see visual_event_queue_new
  */
 struct _VisEventQueue {
 	VisObject	 object;	/**< The VisObject data. */
-	VisList		 events;	/**< List of VisEvents in the queue. */
+	VisEventQueueSlot *slots;	/**< Private, the ring of VISUAL_EVENT_MAXEVENTS events. */
+	int		 head;		/**< Private, the position the poller reads next. */
 	VisEvent	 lastresize;	/**< Last resize event to provide quick access
 					  * to this high piority event. */
 	int		 resizenew;	/**< Flag that is set when there is a new resize event. */
+	int		 resizelock;	/**< Private, guards lastresize. */
 	int		 eventcount;	/**< Contains the number of events in queue. */
 
 	int		 mousex;	/**< Current absolute mouse X value. */
 	int		 mousey;	/**< Current absolute mouse Y value. */
 	VisMouseState	 mousestate;	/**< Current mouse button state. */
+
+	int		 tail;		/**< Private, the position the next added event claims. */
 };
 
 
@@ -271,16 +283,26 @@ int visual_event_queue_init (VisEventQueue *eventqueue);
  */
 int visual_event_queue_poll (VisEventQueue *eventqueue, VisEvent *event);
 
+/**
+ * Polls for new events like visual_event_queue_poll, but gives a newly allocated copy
+ * of the event that has to be unreferenced by the caller.
+ *
+ * @param eventqueue Pointer to a VisEventQueue from which new events should be taken.
+ * @param event Location for the newly allocated VisEvent.
+ *
+ * @return TRUE when events are handled and FALSE when the queue is out of events.
+ */
 int visual_event_queue_poll_by_reference (VisEventQueue *eventqueue, VisEvent **event);
 
 /**
  * Adds an event to the event queue. Add new VisEvents into the VisEventQueue.
+ * The event is copied into the queue and unreferenced, also when the queue is full.
  *
  * @param eventqueue Pointer to the VisEventQueue to which new events are added.
  * @param event Pointer to a VisEvent that needs to be added to the queue.
  *
- * @return VISUAL_OK on success, -VISUAL_ERROR_EVENT_QUEUE_NULL or -VISUAL_ERROR_EVENT_NULL
- *	on failure.
+ * @return VISUAL_OK on success, -VISUAL_ERROR_EVENT_QUEUE_NULL, -VISUAL_ERROR_EVENT_NULL
+ *	or -VISUAL_ERROR_EVENT_QUEUE_FULL on failure.
  */
 int visual_event_queue_add (VisEventQueue *eventqueue, VisEvent *event);
 
@@ -30,31 +30,32 @@
 #include "lv_common.h"
 #include "lv_cache.h"
 #include "lv_math.h"
+#include "lv_bits.h"
+#include "lv_cpu.h"
+#include "lv_thread.h"
+#include "lv_atomic.h"
 #include <stdio.h>
 #include <math.h>
 
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 
 /* Log scale settings */
 #define AMP_LOG_SCALE_THRESHOLD0	0.001f
 #define AMP_LOG_SCALE_DIVISOR		6.908f	/* divisor = -log threshold */
 #define FREQ_LOG_SCALE_BASE		2.0f
 
-#define DFT_CACHE_ENTRY(obj)				(VISUAL_CHECK_CAST ((obj), DFTCacheEntry))
 #define LOG_SCALE_CACHE_ENTRY(obj)			(VISUAL_CHECK_CAST ((obj), LogScaleCacheEntry))
 
-typedef struct _DFTCacheEntry DFTCacheEntry;
-typedef struct _LogScaleCacheEntry LogScaleCacheEntry;
-
-struct _DFTCacheEntry {
-	VisObject	 object;
-
-	int		 spectrum_size;
+/* Power-of-2 plans are kept in a table indexed by log2 (size) */
+#define DFT_PLAN_TABLE_SIZE		32
 
-	float		*bitrevtable;
+/* Smaller power-of-2 sizes are not worth the FFT setup and use brute force */
+#define FFT_MIN_SIZE			16
 
-	float		*sintable;
-	float		*costable;
-};
+typedef struct _LogScaleCacheEntry LogScaleCacheEntry;
 
 struct _LogScaleCacheEntry {
 	VisObject	 object;
@@ -62,63 +63,91 @@ struct _LogScaleCacheEntry {
 	float		*range;
 };
 
+static VisDFTPlan *__lv_dft_plans[DFT_PLAN_TABLE_SIZE];
 static VisCache __lv_dft_cache;
+static VisMutex __lv_dft_cache_mutex;
+static int __lv_dft_cache_locking = FALSE;
 static VisCache __lv_log_scale_cache;
 static int __lv_fourier_initialized = FALSE;
 
 
 static int dft_dtor (VisObject *object);
+static int dft_plan_dtor (VisObject *object);
 
-static void fft_table_bitrev_init (DFTCacheEntry *fcache, VisDFT *fourier);
-static void fft_table_cossin_init (DFTCacheEntry *fcache, VisDFT *fourier);
-static void dft_table_cossin_init (DFTCacheEntry *fcache, VisDFT *fourier);
+static void fft_table_bitrev_init (VisDFTPlan *plan);
+static void fft_table_twiddle_init (VisDFTPlan *plan);
+static void dft_table_cossin_init (VisDFTPlan *plan);
 static void range_table_init (LogScaleCacheEntry *lcache, int size);
 
-static int dft_cache_destroyer (VisObject *object);
-static DFTCacheEntry *dft_cache_get (VisDFT *dft);
-
 static int log_scale_cache_destroyer (VisObject *object);
 static LogScaleCacheEntry *log_scale_cache_get (int size);
 
-static void perform_dft_brute_force (VisDFT *fourier, float *output, float *input);
-static void perform_fft_radix2_dit (VisDFT *fourier, float *output, float *input);
+static void perform_dft_brute_force (VisDFTPlan *plan, float *real, float *imag, float *input, unsigned int samples_in);
+static void perform_fft_real (VisDFTPlan *plan, float *real, float *imag, float *input, unsigned int samples_in);
 
 static int dft_dtor (VisObject *object)
 {
 	VisDFT *dft = VISUAL_DFT (object);
 
-	/* FIXME not all object elements are freed, destroyed, whatever */
-
+	/* The imag part lives in the same block as the real part */
 	if (dft->real != NULL)
 		visual_mem_free (dft->real);
 
-	if (dft->imag != NULL)
-		visual_mem_free (dft->imag);
+	if (dft->plan != NULL)
+		visual_object_unref (VISUAL_OBJECT (dft->plan));
 
 	dft->real = NULL;
 	dft->imag = NULL;
+	dft->plan = NULL;
 
 	return VISUAL_OK;
 }
 
-static void fft_table_bitrev_init (DFTCacheEntry *fcache, VisDFT *fourier)
+static int dft_plan_dtor (VisObject *object)
+{
+	VisDFTPlan *plan = VISUAL_DFT_PLAN (object);
+
+	if (plan->bitrevtable != NULL)
+		visual_mem_free (plan->bitrevtable);
+
+	if (plan->sintable != NULL)
+		visual_mem_free (plan->sintable);
+
+	if (plan->costable != NULL)
+		visual_mem_free (plan->costable);
+
+	if (plan->twiddle_block != NULL)
+		visual_mem_free (plan->twiddle_block);
+
+	plan->bitrevtable = NULL;
+	plan->sintable = NULL;
+	plan->costable = NULL;
+	plan->twiddle_block = NULL;
+	plan->twiddles = NULL;
+
+	return VISUAL_OK;
+}
+
+static void fft_table_bitrev_init (VisDFTPlan *plan)
 {
 	unsigned int i, m, temp;
 	unsigned int j = 0;
+	unsigned int size = plan->spectrum_size >> 1;
 
-	fcache->bitrevtable = visual_mem_malloc0 (sizeof (unsigned int) * fourier->spectrum_size);
+	/* The real input is transformed as a complex sequence of half the size */
+	plan->bitrevtable = visual_mem_malloc0 (sizeof (unsigned int) * size);
 
-	for (i = 0; i < fourier->spectrum_size; i++)
-		fcache->bitrevtable[i] = i;
+	for (i = 0; i < size; i++)
+		plan->bitrevtable[i] = i;
 
-	for (i = 0; i < fourier->spectrum_size; i++) {
+	for (i = 0; i < size; i++) {
 		if (j > i) {
-			temp = fcache->bitrevtable[i];
-			fcache->bitrevtable[i] = fcache->bitrevtable[j];
-			fcache->bitrevtable[j] = temp;
+			temp = plan->bitrevtable[i];
+			plan->bitrevtable[i] = plan->bitrevtable[j];
+			plan->bitrevtable[j] = temp;
 		}
 
-		m = fourier->spectrum_size >> 1;
+		m = size >> 1;
 
 		while (m >= 1 && j >= m) {
 			j -= m;
@@ -129,50 +158,89 @@ static void fft_table_bitrev_init (DFTCacheEntry *fcache, VisDFT *fourier)
 	}
 }
 
-static void fft_table_cossin_init (DFTCacheEntry *fcache, VisDFT *fourier)
+static void fft_table_twiddle_init (VisDFTPlan *plan)
 {
-	unsigned int i, dftsize, tabsize;
-	float theta;
+	unsigned int i, m, q, size, tabsize, offset;
+	double theta;
+	float *tw;
 
-	dftsize = 2;
-	tabsize = 0;
-	while (dftsize <= fourier->spectrum_size) {
-		tabsize++;
+	size = plan->spectrum_size >> 1;
+
+	/* Post processing twiddles that split the half size transform into the real spectrum */
+	tabsize = size / 2 + 1;
+	plan->sintable = visual_mem_malloc0 (sizeof (float) * tabsize);
+	plan->costable = visual_mem_malloc0 (sizeof (float) * tabsize);
 
-		dftsize <<= 1;
+	for (i = 0; i < tabsize; i++) {
+		theta = (-2.0 * VISUAL_MATH_PI * i) / plan->spectrum_size;
+
+		plan->costable[i] = cos (theta);
+		plan->sintable[i] = sin (theta);
 	}
 
-	fcache->sintable = visual_mem_malloc0 (sizeof (float) * tabsize);
-	fcache->costable = visual_mem_malloc0 (sizeof (float) * tabsize);
+	/* Pass twiddles, the first radix-4 pass has none. Every group of four butterflies
+	 * gets its twiddles as consecutive vectors: w1 re, w1 im, w2 re, w2 im, w3 re, w3 im
+	 * for radix-4 passes and w re, w im for the closing radix-2 pass. */
+	tabsize = 0;
+	for (q = 4; q * 4 <= size; q *= 4)
+		tabsize += q * 6;
+
+	if (q < size)
+		tabsize += q * 2;
+
+	/* Over allocate so the table can be aligned for the SIMD butterflies */
+	plan->twiddle_block = visual_mem_malloc0 (sizeof (float) * (tabsize + 4));
+
+	tw = plan->twiddle_block;
+	while (!VISUAL_ALIGNED (tw, 16))
+		tw++;
 
-	dftsize = 2;
-	i = 0;
-	while (dftsize <= fourier->spectrum_size) {
-		theta = (float) (-2.0f * VISUAL_MATH_PI / (float) dftsize);
+	plan->twiddles = tw;
 
-		fcache->costable[i] = (float) cosf (theta);
-		fcache->sintable[i] = (float) sinf (theta);
+	offset = 0;
+	for (q = 4; q * 4 <= size; q *= 4) {
+		for (m = 0; m < q; m++) {
+			float *group = tw + offset + (m >> 2) * 24 + (m & 3);
 
-		i++;
+			theta = (-2.0 * VISUAL_MATH_PI * m) / (q * 4);
 
-		dftsize <<= 1;
+			group[0]  = cos (theta);
+			group[4]  = sin (theta);
+			group[8]  = cos (theta * 2);
+			group[12] = sin (theta * 2);
+			group[16] = cos (theta * 3);
+			group[20] = sin (theta * 3);
+		}
+
+		offset += q * 6;
+	}
+
+	if (q < size) {
+		for (m = 0; m < q; m++) {
+			float *group = tw + offset + (m >> 2) * 8 + (m & 3);
+
+			theta = (-2.0 * VISUAL_MATH_PI * m) / (q * 2);
+
+			group[0] = cos (theta);
+			group[4] = sin (theta);
+		}
 	}
 }
 
-static void dft_table_cossin_init (DFTCacheEntry *fcache, VisDFT *fourier)
+static void dft_table_cossin_init (VisDFTPlan *plan)
 {
 	unsigned int i, tabsize;
 	float theta;
 
-	tabsize = fourier->spectrum_size / 2 + 1;
-	fcache->sintable = visual_mem_malloc0 (sizeof (float) * tabsize);
-	fcache->costable = visual_mem_malloc0 (sizeof (float) * tabsize);
+	tabsize = plan->spectrum_size / 2 + 1;
+	plan->sintable = visual_mem_malloc0 (sizeof (float) * tabsize);
+	plan->costable = visual_mem_malloc0 (sizeof (float) * tabsize);
 
 	for (i = 0; i < tabsize; i++) {
-		theta = (-2.0f * VISUAL_MATH_PI * i) / fourier->spectrum_size;
+		theta = (-2.0f * VISUAL_MATH_PI * i) / plan->spectrum_size;
 
-		fcache->costable[i] = cosf (theta);
-		fcache->sintable[i] = sinf (theta);
+		plan->costable[i] = cosf (theta);
+		plan->sintable[i] = sinf (theta);
 	}
 }
 
@@ -197,54 +265,6 @@ static void range_table_init (LogScaleCacheEntry *lcache, int size)
 	/* cache->range[0] is 0.0 */
 }
 
-static int dft_cache_destroyer (VisObject *object)
-{
-	DFTCacheEntry *fcache = DFT_CACHE_ENTRY (object);
-
-	if (fcache->bitrevtable != NULL)
-		visual_mem_free (fcache->bitrevtable);
-
-	if (fcache->sintable != NULL)
-		visual_mem_free (fcache->sintable);
-
-	if (fcache->costable != NULL)
-		visual_mem_free (fcache->costable);
-
-	fcache->bitrevtable = NULL;
-	fcache->sintable = NULL;
-	fcache->costable = NULL;
-
-	return VISUAL_OK;
-}
-
-static DFTCacheEntry *dft_cache_get (VisDFT *fourier)
-{
-	DFTCacheEntry *fcache;
-	char key[16];
-
-	visual_return_val_if_fail (__lv_fourier_initialized == TRUE, NULL);
-
-	snprintf (key, 16, "%d", fourier->spectrum_size);
-	fcache = visual_cache_get (&__lv_dft_cache, key);
-
-	if (fcache == NULL) {
-		fcache = visual_mem_new0 (DFTCacheEntry, 1);
-
-		visual_object_initialize (VISUAL_OBJECT (fcache), TRUE, dft_cache_destroyer);
-
-		if (fourier->brute_force) {
-			dft_table_cossin_init (fcache, fourier);
-		} else {
-			fft_table_bitrev_init (fcache, fourier);
-			fft_table_cossin_init (fcache, fourier);
-		}
-
-		visual_cache_put (&__lv_dft_cache, key, fcache);
-	}
-
-	return fcache;
-}
-
 static int log_scale_cache_destroyer (VisObject *object)
 {
 	LogScaleCacheEntry *lcache = LOG_SCALE_CACHE_ENTRY (object);
@@ -282,9 +302,15 @@ static LogScaleCacheEntry *log_scale_cache_get (int size)
 
 int visual_fourier_initialize ()
 {
+	visual_mem_set (__lv_dft_plans, 0, sizeof (__lv_dft_plans));
+
 	visual_cache_init (&__lv_dft_cache, visual_object_collection_destroyer, 50, NULL, TRUE);
 	visual_cache_init (&__lv_log_scale_cache, visual_object_collection_destroyer, 50, NULL, TRUE);
 
+	/* Plans are looked up from the actors, which can run on different threads */
+	__lv_dft_cache_locking = visual_thread_is_supported () == TRUE &&
+		visual_mutex_init (&__lv_dft_cache_mutex) == VISUAL_OK;
+
 	__lv_fourier_initialized = TRUE;
 
 	return VISUAL_OK;
@@ -297,9 +323,18 @@ int visual_fourier_is_initialized ()
 
 int visual_fourier_deinitialize ()
 {
+	int i;
+
 	if (__lv_fourier_initialized == FALSE)
 		return -VISUAL_ERROR_FOURIER_NOT_INITIALIZED;
 
+	for (i = 0; i < DFT_PLAN_TABLE_SIZE; i++) {
+		if (__lv_dft_plans[i] != NULL)
+			visual_object_unref (VISUAL_OBJECT (__lv_dft_plans[i]));
+
+		__lv_dft_plans[i] = NULL;
+	}
+
 	visual_object_unref (VISUAL_OBJECT (&__lv_dft_cache));
 	visual_object_unref (VISUAL_OBJECT (&__lv_log_scale_cache));
 
@@ -308,13 +343,153 @@ int visual_fourier_deinitialize ()
 	return VISUAL_OK;
 }
 
+VisDFTPlan *visual_dft_plan_new (unsigned int spectrum_size)
+{
+	VisDFTPlan *plan;
+
+	visual_return_val_if_fail (spectrum_size > 0, NULL);
+
+	plan = visual_mem_new0 (VisDFTPlan, 1);
+
+	visual_dft_plan_init (plan, spectrum_size);
+
+	/* Do the VisObject initialization */
+	visual_object_set_allocated (VISUAL_OBJECT (plan), TRUE);
+	visual_object_ref (VISUAL_OBJECT (plan));
+
+	return plan;
+}
+
+int visual_dft_plan_init (VisDFTPlan *plan, unsigned int spectrum_size)
+{
+	visual_return_val_if_fail (plan != NULL, -VISUAL_ERROR_FOURIER_NULL);
+	visual_return_val_if_fail (spectrum_size > 0, -VISUAL_ERROR_FOURIER_NULL);
+
+	/* Do the VisObject initialization */
+	visual_object_clear (VISUAL_OBJECT (plan));
+	visual_object_set_dtor (VISUAL_OBJECT (plan), dft_plan_dtor);
+	visual_object_set_allocated (VISUAL_OBJECT (plan), FALSE);
+
+	/* Set the VisDFTPlan data */
+	plan->spectrum_size = spectrum_size;
+	plan->brute_force = !visual_math_is_power_of_2 (spectrum_size) || spectrum_size < FFT_MIN_SIZE;
+	plan->bitrevtable = NULL;
+	plan->twiddle_block = NULL;
+	plan->twiddles = NULL;
+
+	if (plan->brute_force) {
+		dft_table_cossin_init (plan);
+	} else {
+		fft_table_bitrev_init (plan);
+		fft_table_twiddle_init (plan);
+	}
+
+	return VISUAL_OK;
+}
+
+VisDFTPlan *visual_dft_plan_get (unsigned int spectrum_size)
+{
+	VisDFTPlan *plan;
+	char key[16];
+	int index;
+
+	visual_return_val_if_fail (__lv_fourier_initialized == TRUE, NULL);
+	visual_return_val_if_fail (spectrum_size > 0, NULL);
+
+	/* Power-of-2 sizes, the only ones used per frame, skip the hashed cache */
+	if (visual_math_is_power_of_2 (spectrum_size)) {
+		index = 0;
+		while ((1U << index) < spectrum_size)
+			index++;
+
+		plan = visual_atomic_pointer_get ((void * volatile *) &__lv_dft_plans[index]);
+
+		if (plan != NULL)
+			return plan;
+
+		/* Whoever installs the plan first wins, a racing thread drops its copy */
+		plan = visual_dft_plan_new (spectrum_size);
+
+		if (visual_atomic_pointer_compare_and_exchange ((void * volatile *) &__lv_dft_plans[index],
+					NULL, plan) == FALSE) {
+			visual_object_unref (VISUAL_OBJECT (plan));
+
+			plan = visual_atomic_pointer_get ((void * volatile *) &__lv_dft_plans[index]);
+		}
+
+		return plan;
+	}
+
+	snprintf (key, 16, "%d", spectrum_size);
+
+	if (__lv_dft_cache_locking == TRUE)
+		visual_mutex_lock (&__lv_dft_cache_mutex);
+
+	plan = visual_cache_get (&__lv_dft_cache, key);
+
+	if (plan == NULL) {
+		plan = visual_dft_plan_new (spectrum_size);
+
+		visual_cache_put (&__lv_dft_cache, key, plan);
+	}
+
+	if (__lv_dft_cache_locking == TRUE)
+		visual_mutex_unlock (&__lv_dft_cache_mutex);
+
+	return plan;
+}
+
+int visual_dft_plan_get_scratch_size (VisDFTPlan *plan)
+{
+	visual_return_val_if_fail (plan != NULL, -VISUAL_ERROR_FOURIER_NULL);
+
+	/* Real and imaginary parts */
+	return plan->spectrum_size * 2;
+}
+
+int visual_dft_plan_perform (VisDFTPlan *plan, float *output, unsigned int samples_out,
+		float *input, unsigned int samples_in, float *scratch)
+{
+	float *real;
+	float *imag;
+	unsigned int bins;
+
+	visual_return_val_if_fail (plan != NULL, -VISUAL_ERROR_FOURIER_NULL);
+	visual_return_val_if_fail (output != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (input != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (scratch != NULL, -VISUAL_ERROR_NULL);
+
+	real = scratch;
+	imag = scratch + plan->spectrum_size;
+
+	if (samples_in > plan->spectrum_size)
+		samples_in = plan->spectrum_size;
+
+	if (plan->brute_force)
+		perform_dft_brute_force (plan, real, imag, input, samples_in);
+	else
+		perform_fft_real (plan, real, imag, input, samples_in);
+
+	bins = plan->spectrum_size / 2;
+	if (bins > samples_out)
+		bins = samples_out;
+
+	visual_math_vectorized_complex_to_norm_scale (output, real, imag, bins,
+			1.0 / plan->spectrum_size);
+
+	if (samples_out > bins)
+		visual_mem_set (output + bins, 0, sizeof (float) * (samples_out - bins));
+
+	return VISUAL_OK;
+}
+
 VisDFT *visual_dft_new (unsigned int samples_out, unsigned int samples_in)
 {
 	VisDFT *dft;
 
 	dft = visual_mem_new0 (VisDFT, 1);
 
-	visual_dft_init (dft, samples_in, samples_out);
+	visual_dft_init (dft, samples_out, samples_in);
 
 	/* Do the VisObject initialization */
 	visual_object_set_allocated (VISUAL_OBJECT (dft), TRUE);
@@ -335,103 +510,464 @@ int visual_dft_init (VisDFT *dft, unsigned int samples_out, unsigned int samples
 	/* Set the VisDFT data */
 	dft->samples_in = samples_in;
 	dft->spectrum_size = samples_in;
-	dft->brute_force = !visual_math_is_power_of_2 (dft->spectrum_size);
 
-	/* Initialize the VisDFT */
-	dft_cache_get (dft);
+	/* Resolve the plan once, so visual_dft_perform() does no lookups */
+	dft->plan = visual_dft_plan_get (dft->spectrum_size);
+	visual_return_val_if_fail (dft->plan != NULL, -VISUAL_ERROR_FOURIER_NOT_INITIALIZED);
+
+	visual_object_ref (VISUAL_OBJECT (dft->plan));
+
+	dft->brute_force = dft->plan->brute_force;
 
-	dft->real = visual_mem_malloc0 (sizeof (float) * dft->spectrum_size);
-	dft->imag = visual_mem_malloc0 (sizeof (float) * dft->spectrum_size);
+	dft->real = visual_mem_malloc0 (sizeof (float) * visual_dft_plan_get_scratch_size (dft->plan));
+	dft->imag = dft->real + dft->spectrum_size;
 
 	return VISUAL_OK;
 }
 
-static void perform_dft_brute_force (VisDFT *dft, float *output, float *input)
+static void perform_dft_brute_force (VisDFTPlan *plan, float *real, float *imag, float *input, unsigned int samples_in)
 {
-	DFTCacheEntry *fcache;
 	unsigned int i, j;
 	float xr, xi, wr, wi, wtemp;
 
-	fcache = dft_cache_get (dft);
-	visual_object_ref (VISUAL_OBJECT (fcache));
-
-	for (i = 0; i < dft->spectrum_size / 2 + 1; i++) {
+	for (i = 0; i < plan->spectrum_size / 2 + 1; i++) {
 		xr = 0.0f;
 		xi = 0.0f;
 
 		wr = 1.0f;
 		wi = 0.0f;
 
-		for (j = 0; j < dft->spectrum_size; j++) {
+		/* Samples past samples_in are zero padding and add nothing */
+		for (j = 0; j < samples_in; j++) {
 			xr += input[j] * wr;
 			xi += input[j] * wi;
 
 			wtemp = wr;
-			wr = wr    * fcache->costable[i] - wi * fcache->sintable[i];
-			wi = wtemp * fcache->sintable[i] + wi * fcache->costable[i];
+			wr = wr    * plan->costable[i] - wi * plan->sintable[i];
+			wi = wtemp * plan->sintable[i] + wi * plan->costable[i];
 		}
 
-		dft->real[i] = xr;
-		dft->imag[i] = xi;
+		real[i] = xr;
+		imag[i] = xi;
 	}
-
-	visual_object_unref (VISUAL_OBJECT (fcache));
 }
 
-static void perform_fft_radix2_dit (VisDFT *dft, float *output, float *input)
+static void fft_load_bitrev (VisDFTPlan *plan, float *real, float *imag, float *input, unsigned int samples_in)
 {
-	DFTCacheEntry *fcache;
-	unsigned int j, m, i, dftsize, hdftsize, t;
-	float wr, wi, wpi, wpr, wtemp, tempr, tempi;
+	unsigned int i, idx;
+	unsigned int size = plan->spectrum_size >> 1;
 
-	fcache = dft_cache_get (dft);
-	visual_object_ref (VISUAL_OBJECT (fcache));
+	/* Even samples become the real part and odd samples the imaginary part */
+	if (samples_in >= plan->spectrum_size) {
+		for (i = 0; i < size; i++) {
+			idx = plan->bitrevtable[i] << 1;
 
-	for (i = 0; i < dft->spectrum_size; i++) {
-		unsigned int idx = fcache->bitrevtable[i];
+			real[i] = input[idx];
+			imag[i] = input[idx + 1];
+		}
 
-		if (idx < dft->samples_in)
-			dft->real[i] = input[idx];
-		else
-			dft->real[i] = 0;
+		return;
 	}
 
-	visual_mem_set (dft->imag, 0, sizeof (float) * dft->spectrum_size);
+	for (i = 0; i < size; i++) {
+		idx = plan->bitrevtable[i] << 1;
 
-	dftsize = 2;
-	t = 0;
-	while (dftsize <= dft->spectrum_size) {
-		wpr = fcache->costable[t];
-		wpi = fcache->sintable[t];
+		real[i] = idx < samples_in ? input[idx] : 0.0f;
+		imag[i] = idx + 1 < samples_in ? input[idx + 1] : 0.0f;
+	}
+}
 
-		wr = 1.0f;
-		wi = 0.0f;
+static void fft_radix4_first_pass (float *real, float *imag, unsigned int size)
+{
+	unsigned int i;
+	float y0r, y0i, y1r, y1i, u2r, u2i, u3r, u3i;
+
+	/* All twiddles are 1 in the first pass */
+	for (i = 0; i < size; i += 4) {
+		y0r = real[i] + real[i + 1];
+		y0i = imag[i] + imag[i + 1];
+		y1r = real[i] - real[i + 1];
+		y1i = imag[i] - imag[i + 1];
+		u2r = real[i + 2] + real[i + 3];
+		u2i = imag[i + 2] + imag[i + 3];
+		u3r = real[i + 2] - real[i + 3];
+		u3i = imag[i + 2] - imag[i + 3];
+
+		real[i]     = y0r + u2r;
+		imag[i]     = y0i + u2i;
+		real[i + 1] = y1r + u3i;
+		imag[i + 1] = y1i - u3r;
+		real[i + 2] = y0r - u2r;
+		imag[i + 2] = y0i - u2i;
+		real[i + 3] = y1r - u3i;
+		imag[i + 3] = y1i + u3r;
+	}
+}
+
+static void fft_radix4_pass_c (float *real, float *imag, unsigned int size, unsigned int q, const float *tw)
+{
+	unsigned int b, m;
+	unsigned int p0, p1, p2, p3;
+	float w1r, w1i, w2r, w2i, w3r, w3i;
+	float t1r, t1i, ar, ai, br, bi;
+	float y0r, y0i, y1r, y1i, u2r, u2i, u3r, u3i;
+
+	for (b = 0; b < size; b += q * 4) {
+		for (m = 0; m < q; m++) {
+			const float *group = tw + (m >> 2) * 24 + (m & 3);
+
+			w1r = group[0];
+			w1i = group[4];
+			w2r = group[8];
+			w2i = group[12];
+			w3r = group[16];
+			w3i = group[20];
+
+			p0 = b + m;
+			p1 = p0 + q;
+			p2 = p1 + q;
+			p3 = p2 + q;
+
+			t1r = real[p1] * w2r - imag[p1] * w2i;
+			t1i = imag[p1] * w2r + real[p1] * w2i;
+			ar  = real[p2] * w1r - imag[p2] * w1i;
+			ai  = imag[p2] * w1r + real[p2] * w1i;
+			br  = real[p3] * w3r - imag[p3] * w3i;
+			bi  = imag[p3] * w3r + real[p3] * w3i;
+
+			y0r = real[p0] + t1r;
+			y0i = imag[p0] + t1i;
+			y1r = real[p0] - t1r;
+			y1i = imag[p0] - t1i;
+			u2r = ar + br;
+			u2i = ai + bi;
+			u3r = ar - br;
+			u3i = ai - bi;
+
+			real[p0] = y0r + u2r;
+			imag[p0] = y0i + u2i;
+			real[p1] = y1r + u3i;
+			imag[p1] = y1i - u3r;
+			real[p2] = y0r - u2r;
+			imag[p2] = y0i - u2i;
+			real[p3] = y1r - u3i;
+			imag[p3] = y1i + u3r;
+		}
+	}
+}
 
-		hdftsize = dftsize >> 1;
+static void fft_radix2_last_pass_c (float *real, float *imag, unsigned int size, const float *tw)
+{
+	unsigned int m, h;
+	float wr, wi, tr, ti;
+
+	h = size >> 1;
 
-		for (m = 0; m < hdftsize; m += 1) {
-			for (i = m; i < dft->spectrum_size; i+=dftsize) {
-				j = i + hdftsize;
+	for (m = 0; m < h; m++) {
+		const float *group = tw + (m >> 2) * 8 + (m & 3);
 
-				tempr = wr * dft->real[j] - wi * dft->imag[j];
-				tempi = wr * dft->imag[j] + wi * dft->real[j];
+		wr = group[0];
+		wi = group[4];
 
-				dft->real[j] = dft->real[i] - tempr;
-				dft->imag[j] = dft->imag[i] - tempi;
+		tr = real[m + h] * wr - imag[m + h] * wi;
+		ti = imag[m + h] * wr + real[m + h] * wi;
 
-				dft->real[i] += tempr;
-				dft->imag[i] += tempi;
-			}
+		real[m + h] = real[m] - tr;
+		imag[m + h] = imag[m] - ti;
+		real[m] += tr;
+		imag[m] += ti;
+	}
+}
 
-			wr = (wtemp = wr) * wpr - wi * wpi;
-			wi = wi * wpr + wtemp * wpi;
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static void fft_radix4_pass_sse (float *real, float *imag, unsigned int size, unsigned int q, const float *tw)
+{
+	visual_size_t qb = q * sizeof (float);
+	visual_size_t qb3 = qb * 3;
+	unsigned int b, m;
+
+	/* Four butterflies at once, the twiddle table is 16 byte aligned. Register use
+	 * is limited to xmm0-7 so this also works on 32 bits x86. */
+	for (b = 0; b < size; b += q * 4) {
+		for (m = 0; m < q; m += 4) {
+			float *r = real + b + m;
+			float *i = imag + b + m;
+			const float *w = tw + (m >> 2) * 24;
+
+			__asm __volatile
+				("\n\t movups (%[r],%[q],1), %%xmm0"	/* x1 */
+				 "\n\t movups (%[i],%[q],1), %%xmm1"
+				 "\n\t movaps 32(%[w]), %%xmm2"		/* w2 */
+				 "\n\t movaps 48(%[w]), %%xmm3"
+				 "\n\t movaps %%xmm0, %%xmm4"
+				 "\n\t mulps %%xmm2, %%xmm4"
+				 "\n\t movaps %%xmm1, %%xmm5"
+				 "\n\t mulps %%xmm3, %%xmm5"
+				 "\n\t subps %%xmm5, %%xmm4"		/* t1r */
+				 "\n\t mulps %%xmm2, %%xmm1"
+				 "\n\t mulps %%xmm3, %%xmm0"
+				 "\n\t addps %%xmm0, %%xmm1"		/* t1i */
+				 "\n\t movups (%[r]), %%xmm0"		/* x0 */
+				 "\n\t movups (%[i]), %%xmm2"
+				 "\n\t movaps %%xmm0, %%xmm3"
+				 "\n\t addps %%xmm4, %%xmm0"		/* y0r */
+				 "\n\t subps %%xmm4, %%xmm3"		/* y1r */
+				 "\n\t movaps %%xmm2, %%xmm5"
+				 "\n\t addps %%xmm1, %%xmm2"		/* y0i */
+				 "\n\t subps %%xmm1, %%xmm5"		/* y1i */
+				 "\n\t movups (%[r],%[q],2), %%xmm1"	/* x2 * w1 */
+				 "\n\t movups (%[i],%[q],2), %%xmm4"
+				 "\n\t movaps %%xmm1, %%xmm6"
+				 "\n\t movaps %%xmm4, %%xmm7"
+				 "\n\t mulps (%[w]), %%xmm1"
+				 "\n\t mulps 16(%[w]), %%xmm4"
+				 "\n\t subps %%xmm4, %%xmm1"		/* ar */
+				 "\n\t mulps 16(%[w]), %%xmm6"
+				 "\n\t mulps (%[w]), %%xmm7"
+				 "\n\t addps %%xmm7, %%xmm6"		/* ai */
+				 "\n\t movups (%[r],%[q3],1), %%xmm4"	/* x3 * w3, real part */
+				 "\n\t mulps 64(%[w]), %%xmm4"
+				 "\n\t movups (%[i],%[q3],1), %%xmm7"
+				 "\n\t mulps 80(%[w]), %%xmm7"
+				 "\n\t subps %%xmm7, %%xmm4"		/* br */
+				 "\n\t movaps %%xmm1, %%xmm7"
+				 "\n\t addps %%xmm4, %%xmm1"		/* u2r */
+				 "\n\t subps %%xmm4, %%xmm7"		/* u3r */
+				 "\n\t movaps %%xmm0, %%xmm4"
+				 "\n\t addps %%xmm1, %%xmm0"
+				 "\n\t subps %%xmm1, %%xmm4"
+				 "\n\t movups %%xmm0, (%[r])"		/* out0r */
+				 "\n\t movups %%xmm4, (%[r],%[q],2)"	/* out2r */
+				 "\n\t movups (%[r],%[q3],1), %%xmm0"	/* x3 * w3, imaginary part */
+				 "\n\t mulps 80(%[w]), %%xmm0"
+				 "\n\t movups (%[i],%[q3],1), %%xmm1"
+				 "\n\t mulps 64(%[w]), %%xmm1"
+				 "\n\t addps %%xmm1, %%xmm0"		/* bi */
+				 "\n\t movaps %%xmm5, %%xmm1"
+				 "\n\t subps %%xmm7, %%xmm5"
+				 "\n\t addps %%xmm7, %%xmm1"
+				 "\n\t movups %%xmm5, (%[i],%[q],1)"	/* out1i */
+				 "\n\t movups %%xmm1, (%[i],%[q3],1)"	/* out3i */
+				 "\n\t movaps %%xmm6, %%xmm1"
+				 "\n\t addps %%xmm0, %%xmm6"		/* u2i */
+				 "\n\t subps %%xmm0, %%xmm1"		/* u3i */
+				 "\n\t movaps %%xmm2, %%xmm4"
+				 "\n\t addps %%xmm6, %%xmm2"
+				 "\n\t subps %%xmm6, %%xmm4"
+				 "\n\t movups %%xmm2, (%[i])"		/* out0i */
+				 "\n\t movups %%xmm4, (%[i],%[q],2)"	/* out2i */
+				 "\n\t movaps %%xmm3, %%xmm5"
+				 "\n\t addps %%xmm1, %%xmm3"
+				 "\n\t subps %%xmm1, %%xmm5"
+				 "\n\t movups %%xmm3, (%[r],%[q],1)"	/* out1r */
+				 "\n\t movups %%xmm5, (%[r],%[q3],1)"	/* out3r */
+				 :: [r] "r" (r), [i] "r" (i), [q] "r" (qb), [q3] "r" (qb3), [w] "r" (w)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 		}
+	}
+}
+
+static void fft_radix2_last_pass_sse (float *real, float *imag, unsigned int size, const float *tw)
+{
+	visual_size_t hb = (size >> 1) * sizeof (float);
+	unsigned int m;
+
+	for (m = 0; m < size >> 1; m += 4) {
+		float *r = real + m;
+		float *i = imag + m;
+		const float *w = tw + (m >> 2) * 8;
+
+		__asm __volatile
+			("\n\t movups (%[r],%[h],1), %%xmm0"
+			 "\n\t movups (%[i],%[h],1), %%xmm1"
+			 "\n\t movaps (%[w]), %%xmm2"
+			 "\n\t movaps 16(%[w]), %%xmm3"
+			 "\n\t movaps %%xmm0, %%xmm4"
+			 "\n\t mulps %%xmm2, %%xmm4"
+			 "\n\t movaps %%xmm1, %%xmm5"
+			 "\n\t mulps %%xmm3, %%xmm5"
+			 "\n\t subps %%xmm5, %%xmm4"		/* tr */
+			 "\n\t mulps %%xmm2, %%xmm1"
+			 "\n\t mulps %%xmm3, %%xmm0"
+			 "\n\t addps %%xmm0, %%xmm1"		/* ti */
+			 "\n\t movups (%[r]), %%xmm0"
+			 "\n\t movaps %%xmm0, %%xmm2"
+			 "\n\t addps %%xmm4, %%xmm0"
+			 "\n\t subps %%xmm4, %%xmm2"
+			 "\n\t movups %%xmm0, (%[r])"
+			 "\n\t movups %%xmm2, (%[r],%[h],1)"
+			 "\n\t movups (%[i]), %%xmm0"
+			 "\n\t movaps %%xmm0, %%xmm3"
+			 "\n\t addps %%xmm1, %%xmm0"
+			 "\n\t subps %%xmm1, %%xmm3"
+			 "\n\t movups %%xmm0, (%[i])"
+			 "\n\t movups %%xmm3, (%[i],%[h],1)"
+			 :: [r] "r" (r), [i] "r" (i), [h] "r" (hb), [w] "r" (w)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5");
+	}
+}
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void fft_radix4_pass_neon (float *real, float *imag, unsigned int size, unsigned int q, const float *tw)
+{
+	unsigned int b, m;
+
+	for (b = 0; b < size; b += q * 4) {
+		for (m = 0; m < q; m += 4) {
+			float *r = real + b + m;
+			float *i = imag + b + m;
+			const float *w = tw + (m >> 2) * 24;
+			float32x4_t w1r = vld1q_f32 (w);
+			float32x4_t w1i = vld1q_f32 (w + 4);
+			float32x4_t w2r = vld1q_f32 (w + 8);
+			float32x4_t w2i = vld1q_f32 (w + 12);
+			float32x4_t w3r = vld1q_f32 (w + 16);
+			float32x4_t w3i = vld1q_f32 (w + 20);
+			float32x4_t x0r = vld1q_f32 (r);
+			float32x4_t x0i = vld1q_f32 (i);
+			float32x4_t x1r = vld1q_f32 (r + q);
+			float32x4_t x1i = vld1q_f32 (i + q);
+			float32x4_t x2r = vld1q_f32 (r + q * 2);
+			float32x4_t x2i = vld1q_f32 (i + q * 2);
+			float32x4_t x3r = vld1q_f32 (r + q * 3);
+			float32x4_t x3i = vld1q_f32 (i + q * 3);
+			float32x4_t t1r, t1i, ar, ai, br, bi;
+			float32x4_t y0r, y0i, y1r, y1i, u2r, u2i, u3r, u3i;
+
+			t1r = vmlsq_f32 (vmulq_f32 (x1r, w2r), x1i, w2i);
+			t1i = vmlaq_f32 (vmulq_f32 (x1i, w2r), x1r, w2i);
+			ar  = vmlsq_f32 (vmulq_f32 (x2r, w1r), x2i, w1i);
+			ai  = vmlaq_f32 (vmulq_f32 (x2i, w1r), x2r, w1i);
+			br  = vmlsq_f32 (vmulq_f32 (x3r, w3r), x3i, w3i);
+			bi  = vmlaq_f32 (vmulq_f32 (x3i, w3r), x3r, w3i);
+
+			y0r = vaddq_f32 (x0r, t1r);
+			y0i = vaddq_f32 (x0i, t1i);
+			y1r = vsubq_f32 (x0r, t1r);
+			y1i = vsubq_f32 (x0i, t1i);
+			u2r = vaddq_f32 (ar, br);
+			u2i = vaddq_f32 (ai, bi);
+			u3r = vsubq_f32 (ar, br);
+			u3i = vsubq_f32 (ai, bi);
+
+			vst1q_f32 (r,         vaddq_f32 (y0r, u2r));
+			vst1q_f32 (i,         vaddq_f32 (y0i, u2i));
+			vst1q_f32 (r + q,     vaddq_f32 (y1r, u3i));
+			vst1q_f32 (i + q,     vsubq_f32 (y1i, u3r));
+			vst1q_f32 (r + q * 2, vsubq_f32 (y0r, u2r));
+			vst1q_f32 (i + q * 2, vsubq_f32 (y0i, u2i));
+			vst1q_f32 (r + q * 3, vsubq_f32 (y1r, u3i));
+			vst1q_f32 (i + q * 3, vaddq_f32 (y1i, u3r));
+		}
+	}
+}
+
+static void fft_radix2_last_pass_neon (float *real, float *imag, unsigned int size, const float *tw)
+{
+	unsigned int m, h;
+
+	h = size >> 1;
+
+	for (m = 0; m < h; m += 4) {
+		const float *w = tw + (m >> 2) * 8;
+		float32x4_t wr = vld1q_f32 (w);
+		float32x4_t wi = vld1q_f32 (w + 4);
+		float32x4_t x0r = vld1q_f32 (real + m);
+		float32x4_t x0i = vld1q_f32 (imag + m);
+		float32x4_t x1r = vld1q_f32 (real + m + h);
+		float32x4_t x1i = vld1q_f32 (imag + m + h);
+		float32x4_t tr, ti;
+
+		tr = vmlsq_f32 (vmulq_f32 (x1r, wr), x1i, wi);
+		ti = vmlaq_f32 (vmulq_f32 (x1i, wr), x1r, wi);
+
+		vst1q_f32 (real + m,     vaddq_f32 (x0r, tr));
+		vst1q_f32 (imag + m,     vaddq_f32 (x0i, ti));
+		vst1q_f32 (real + m + h, vsubq_f32 (x0r, tr));
+		vst1q_f32 (imag + m + h, vsubq_f32 (x0i, ti));
+	}
+}
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
 
-		dftsize <<= 1;
-		t++;
+static void fft_real_post_process (VisDFTPlan *plan, float *real, float *imag)
+{
+	unsigned int k, size;
+	float a, b, c, d;
+	float evr, evi, odr, odi, pr, pi;
+
+	size = plan->spectrum_size >> 1;
+
+	/* The half size transform holds the even samples' spectrum E and odd samples' spectrum
+	 * O as Z = E + iO, both are recovered from Z[k] and Z[size - k] and combined using
+	 * X[k] = E[k] + W^k O[k] and X[size - k] = conj (E[k] - W^k O[k]). */
+	a = real[0];
+	b = imag[0];
+	real[0] = a + b;
+	imag[0] = 0.0f;
+
+	for (k = 1; k <= size / 2; k++) {
+		a = real[k];
+		b = imag[k];
+		c = real[size - k];
+		d = imag[size - k];
+
+		evr = (a + c) * 0.5f;
+		evi = (b - d) * 0.5f;
+		odr = (b + d) * 0.5f;
+		odi = (c - a) * 0.5f;
+
+		pr = plan->costable[k] * odr - plan->sintable[k] * odi;
+		pi = plan->costable[k] * odi + plan->sintable[k] * odr;
+
+		real[k] = evr + pr;
+		imag[k] = evi + pi;
+		real[size - k] = evr - pr;
+		imag[size - k] = pi - evi;
 	}
+}
+
+static void perform_fft_real (VisDFTPlan *plan, float *real, float *imag, float *input, unsigned int samples_in)
+{
+	unsigned int q, size;
+	const float *tw;
+
+	size = plan->spectrum_size >> 1;
+
+	fft_load_bitrev (plan, real, imag, input, samples_in);
+	fft_radix4_first_pass (real, imag, size);
 
-	visual_object_unref (VISUAL_OBJECT (fcache));
+	tw = plan->twiddles;
+
+	for (q = 4; q * 4 <= size; q *= 4) {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+		if (visual_cpu_get_sse ())
+			fft_radix4_pass_sse (real, imag, size, q, tw);
+		else
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+		if (visual_cpu_get_neon ())
+			fft_radix4_pass_neon (real, imag, size, q, tw);
+		else
+#endif
+			fft_radix4_pass_c (real, imag, size, q, tw);
+
+		tw += q * 6;
+	}
+
+	if (q < size) {
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+		if (visual_cpu_get_sse ())
+			fft_radix2_last_pass_sse (real, imag, size, tw);
+		else
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+		if (visual_cpu_get_neon ())
+			fft_radix2_last_pass_neon (real, imag, size, tw);
+		else
+#endif
+			fft_radix2_last_pass_c (real, imag, size, tw);
+	}
+
+	fft_real_post_process (plan, real, imag);
 }
 
 int visual_dft_perform (VisDFT *dft, float *output, float *input)
@@ -440,16 +976,8 @@ int visual_dft_perform (VisDFT *dft, float *output, float *input)
 	visual_return_val_if_fail (output != NULL, -VISUAL_ERROR_NULL);
 	visual_return_val_if_fail (input != NULL, -VISUAL_ERROR_NULL);
 
-	if (dft->brute_force)
-		perform_dft_brute_force (dft, output, input);
-	else
-		perform_fft_radix2_dit (dft, output, input);
-
-	visual_math_vectorized_complex_to_norm_scale (output, dft->real, dft->imag,
-			dft->spectrum_size / 2,
-			1.0 / dft->spectrum_size);
-
-	return VISUAL_OK;
+	return visual_dft_plan_perform (dft->plan, output, dft->spectrum_size / 2,
+			input, dft->samples_in, dft->real);
 }
 
 int visual_dft_log_scale (float *output, float *input, int size)
@@ -35,8 +35,29 @@ VISUAL_BEGIN_DECLS
  */
 
 #define VISUAL_DFT(obj)					(VISUAL_CHECK_CAST ((obj), VisDFT))
+#define VISUAL_DFT_PLAN(obj)				(VISUAL_CHECK_CAST ((obj), VisDFTPlan))
 
 typedef struct _VisDFT VisDFT;
+typedef struct _VisDFTPlan VisDFTPlan;
+
+/**
+ * Private structure that contains the precomputed tables for one transform size.
+ *
+ * A plan is never modified after it has been created, so one plan can be shared
+ * by any number of users as long as each of them provides its own scratch space.
+ *
+ * @see visual_dft_plan_get
+ */
+struct _VisDFTPlan {
+	VisObject	 object;			/**< The VisObject data. */
+	unsigned int	 spectrum_size;			/**< The size of the transform. */
+	int		 brute_force;			/**< Private data that is used by the fourier engine. */
+	unsigned int	*bitrevtable;			/**< Private data that is used by the fourier engine. */
+	float		*sintable;			/**< Private data that is used by the fourier engine. */
+	float		*costable;			/**< Private data that is used by the fourier engine. */
+	float		*twiddles;			/**< Private data that is used by the fourier engine. */
+	float		*twiddle_block;			/**< Private data that is used by the fourier engine. */
+};
 
 /**
  * Private structure to embed Fourier Transform states in.
@@ -48,6 +69,7 @@ struct _VisDFT {
 	float		*real;				/**< Private data that is used by the fourier engine. */
 	float		*imag;				/**< Private data that is used by the fourier engine. */
 	int		 brute_force;			/**< Private data that is used by the fourier engine. */
+	VisDFTPlan	*plan;				/**< The plan that is resolved once on initialization. */
 };
 
 /**
@@ -85,6 +107,65 @@ int visual_dft_init (VisDFT *fourier, unsigned int samples_out, unsigned int sam
  */
 int visual_dft_perform (VisDFT *fourier, float *output, float *input);
 
+/**
+ * Function to create a new VisDFTPlan for a transform of the given size.
+ *
+ * Most users want visual_dft_plan_get() instead, which hands out plans that are
+ * shared and owned by the fourier subsystem.
+ *
+ * @param spectrum_size The size of the transform.
+ *
+ * @return A newly created VisDFTPlan, or NULL on failure.
+ */
+VisDFTPlan *visual_dft_plan_new (unsigned int spectrum_size);
+
+int visual_dft_plan_init (VisDFTPlan *plan, unsigned int spectrum_size);
+
+/**
+ * Function to retrieve the shared VisDFTPlan for a transform size. The plan is
+ * created on first use and stays alive until visual_fourier_deinitialize(), no
+ * reference is added for the caller.
+ *
+ * Looking up power-of-2 sizes is a plain table index, so this is cheap enough
+ * to call on every frame.
+ *
+ * @param spectrum_size The size of the transform.
+ *
+ * @return The shared VisDFTPlan, or NULL on failure.
+ */
+VisDFTPlan *visual_dft_plan_get (unsigned int spectrum_size);
+
+/**
+ * Function to retrieve the number of floats of scratch space that
+ * visual_dft_plan_perform() needs for this plan.
+ *
+ * @param plan Pointer to the VisDFTPlan.
+ *
+ * @return The scratch size in floats, -VISUAL_ERROR_FOURIER_NULL on failure.
+ */
+int visual_dft_plan_get_scratch_size (VisDFTPlan *plan);
+
+/**
+ * Function to perform a Fourier Transform using a plan and caller owned scratch space.
+ * This does not allocate memory and does not touch the plan, it can be called from
+ * several threads at once on the same plan.
+ *
+ * \note Input shorter than the plan size is padded with zeroes. At most
+ * spectrum_size / 2 output samples are produced, any remaining output samples
+ * are set to zero.
+ *
+ * @param plan Pointer to the VisDFTPlan.
+ * @param output Array of output samples.
+ * @param samples_out The number of output samples.
+ * @param input Array of input samples with values in [-1.0, 1.0].
+ * @param samples_in The number of input samples.
+ * @param scratch Scratch space of at least visual_dft_plan_get_scratch_size() floats.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_FOURIER_NULL or -VISUAL_ERROR_NULL on failure.
+ */
+int visual_dft_plan_perform (VisDFTPlan *plan, float *output, unsigned int samples_out,
+		float *input, unsigned int samples_in, float *scratch);
+
 /**
  * Function to scale an ampltitude spectrum logarithmically.
  *
@@ -24,29 +24,33 @@
 #include "config.h"
 #include "lv_hashmap.h"
 #include "lv_common.h"
-#include "lv_util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* The table doubles beyond this load, in percent */
+#define HASHMAP_MAX_LOAD		80
+
+/* Old table slots moved per put or remove while a resize is in progress */
+#define HASHMAP_MIGRATE_STEPS		8
+
+/* Key storage is only compacted when it is at least this large */
+#define HASHMAP_KEYS_COMPACT_MIN	4096
+
 #define HASHMAP_ITERCONTEXT(obj)                           (VISUAL_CHECK_CAST ((obj), HashmapIterContext))
 
 
 typedef struct _HashmapIterContext HashmapIterContext;
 
+/* The iterator walks the table followed by the old table, index is in that range */
 struct _HashmapIterContext {
 	VisObject	*object;
 
 	int		 index;
-	int		 retrieved;
-	int		 first;
-
-	VisListEntry	*le;
 };
 
 
 static int hashmap_destroy (VisCollection *collection);
-static int hashmap_chain_destroy (VisHashmap *hashmap, VisList *list);
 static int hashmap_size (VisCollection *collection);
 static VisCollectionIter *hashmap_iter (VisCollection *collection);
 
@@ -54,63 +58,60 @@ static void hashmap_iter_assign (VisCollectionIter *iter, VisCollection *collect
 static int hashmap_iter_has_more (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext);
 static void hashmap_iter_next (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext);
 static void *hashmap_iter_get_data (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext);
+static VisHashmapEntry *hashmap_iter_entry (VisHashmap *hashmap, int index);
+static int hashmap_iter_seek (VisHashmap *hashmap, int index);
 
-static int integer_hash (uint32_t key);
-static int string_hash (char *key);
-static int get_hash (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype);
+static uint32_t integer_hash (uint32_t key);
+static uint32_t string_hash (const char *key);
+static uint32_t get_hash (void *key, VisHashmapKeyType keytype);
 
-static int create_table (VisHashmap *hashmap);
+static int table_find (VisHashmap *hashmap, VisHashmapEntry *table, int tablesize,
+		uint32_t hash, VisHashmapKeyType keytype, uint32_t integer, const char *string);
+static VisHashmapEntry *table_find_integer (VisHashmapEntry *table, int tablesize, uint32_t hash, uint32_t integer);
+static void table_insert (VisHashmapEntry *table, int tablesize, VisHashmapEntry *entry);
+static void table_remove (VisHashmapEntry *table, int tablesize, int index);
+
+static VisHashmapEntry *hashmap_find (VisHashmap *hashmap, uint32_t hash, VisHashmapKeyType keytype,
+		uint32_t integer, const char *string, int *old, int *index);
+static void hashmap_resize (VisHashmap *hashmap, int tablesize);
+static void hashmap_migrate (VisHashmap *hashmap, int steps);
+
+static int keys_add (VisHashmap *hashmap, const char *key);
+static void keys_release (VisHashmap *hashmap, VisHashmapEntry *entry);
+static void keys_compact (VisHashmap *hashmap);
 
 
 static int hashmap_destroy (VisCollection *collection)
 {
+	VisCollectionDestroyerFunc destroyer;
 	VisHashmap *hashmap = VISUAL_HASHMAP (collection);
+	VisHashmapEntry *entry;
 	int i;
 
-	for (i = 0; i < hashmap->size; i++)
-		hashmap_chain_destroy (hashmap, &hashmap->table[i].list);
+	destroyer = visual_collection_get_destroyer (collection);
 
-	if (hashmap->table != NULL)
-		visual_mem_free (hashmap->table);
-
-	hashmap->table = NULL;
-
-	return VISUAL_OK;
-}
+	if (destroyer != NULL) {
+		for (i = 0; (i = hashmap_iter_seek (hashmap, i)) >= 0; i++) {
+			entry = hashmap_iter_entry (hashmap, i);
 
-/* We can't use collection dtor because we need to chain up (HashChainElem -> DataElem) */
-static int hashmap_chain_destroy (VisHashmap *hashmap, VisList *list)
-{
-	VisCollectionDestroyerFunc destroyer;
-	VisHashmapChainEntry *mentry;
-	VisListEntry *le = NULL;
-
-	destroyer = visual_collection_get_destroyer (VISUAL_COLLECTION (hashmap));
-
-	if (destroyer == NULL) {
-		while ((mentry = visual_list_next (list, &le)) != NULL)
-			visual_list_destroy (list, &le);
-	} else {
-		while ((mentry = visual_list_next (list, &le)) != NULL) {
-			destroyer (mentry->data);
-			visual_list_destroy (list, &le);
+			destroyer (entry->data);
 		}
 	}
-	return VISUAL_OK;
-}
 
-static int hashmap_list_entry_destroyer (void *data)
-{
-	VisHashmapChainEntry *mentry = VISUAL_HASHMAPCHAINENTRY (data);
+	if (hashmap->table != NULL)
+		visual_mem_free (hashmap->table);
 
-	if (mentry == NULL)
-		return -1;
+	if (hashmap->oldtable != NULL)
+		visual_mem_free (hashmap->oldtable);
 
-	if (mentry->keytype == VISUAL_HASHMAP_KEY_TYPE_STRING) {
-		visual_mem_free (mentry->key.string);
-	}
+	if (hashmap->keys != NULL)
+		visual_mem_free (hashmap->keys);
+
+	hashmap->table = NULL;
+	hashmap->oldtable = NULL;
+	hashmap->keys = NULL;
 
-	return visual_mem_free (mentry);
+	return VISUAL_OK;
 }
 
 static int hashmap_size (VisCollection *collection)
@@ -129,10 +130,7 @@ static VisCollectionIter *hashmap_iter (VisCollection *collection)
 
 	/* Do the VisObject initialization */
 	visual_object_initialize (VISUAL_OBJECT (context), TRUE, NULL);
-	context->index = 0;
-	context->le = NULL;
-	context->retrieved = FALSE;
-	context->first = TRUE;
+	context->index = hashmap_iter_seek (VISUAL_HASHMAP (collection), 0);
 
 	iter = visual_collection_iter_new (hashmap_iter_assign, hashmap_iter_next, hashmap_iter_has_more,
 			hashmap_iter_get_data, collection, VISUAL_OBJECT (context));
@@ -142,145 +140,347 @@ static VisCollectionIter *hashmap_iter (VisCollection *collection)
 
 static void hashmap_iter_assign (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext, int index)
 {
+	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
 	VisHashmap *hashmap = VISUAL_HASHMAP (collection);
 	int i;
 
-	if (index >= hashmap->tablesize)
-		return;
+	context->index = hashmap_iter_seek (hashmap, 0);
 
-	for (i = 0; i < index; i++) {
-		hashmap_iter_next (iter, collection, itercontext);
-	}
+	for (i = 0; i < index && context->index >= 0; i++)
+		context->index = hashmap_iter_seek (hashmap, context->index + 1);
 }
 
 static int hashmap_iter_has_more (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext)
 {
-	VisHashmap *hashmap = VISUAL_HASHMAP (collection);
 	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
 
-	if (context->index >= hashmap->tablesize)
-		return FALSE;
+	return context->index >= 0;
+}
+
+static void hashmap_iter_next (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext)
+{
+	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
+
+	if (context->index < 0)
+		return;
+
+	context->index = hashmap_iter_seek (VISUAL_HASHMAP (collection), context->index + 1);
+}
 
-	/* First entry */
-	if (context->first) {
-		context->first = FALSE;
+static void *hashmap_iter_get_data (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext)
+{
+	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
+
+	if (context->index < 0)
+		return NULL;
+
+	return hashmap_iter_entry (VISUAL_HASHMAP (collection), context->index)->data;
+}
+
+static VisHashmapEntry *hashmap_iter_entry (VisHashmap *hashmap, int index)
+{
+	if (index < hashmap->tablesize)
+		return &hashmap->table[index];
+
+	return &hashmap->oldtable[index - hashmap->tablesize];
+}
+
+/* Gives the first used entry at or after index, -1 when there is none */
+static int hashmap_iter_seek (VisHashmap *hashmap, int index)
+{
+	int end = hashmap->table != NULL ? hashmap->tablesize : 0;
 
-		for (; context->index < hashmap->tablesize; context->index++) {
-			if (visual_collection_size (VISUAL_COLLECTION (&hashmap->table[context->index].list)) > 0) {
-				context->le = hashmap->table[context->index].list.head;
-				context->retrieved = FALSE;
+	if (hashmap->oldtable != NULL)
+		end += hashmap->oldtablesize;
 
-				return TRUE;
+	for (; index < end; index++) {
+		if (hashmap_iter_entry (hashmap, index)->hash != 0)
+			return index;
+	}
+
+	return -1;
+}
+
+
+/* Fibonacci hashing, the high bits are folded down because the table is indexed by the low bits */
+static uint32_t integer_hash (uint32_t key)
+{
+	key *= 0x9e3779b1U;
+	key ^= key >> 16;
+
+	/* 0 marks an empty entry */
+	return key != 0 ? key : 1;
+}
+
+/* X31 HASH found in g_str_hash, mixed because the table is indexed by the low bits */
+static uint32_t string_hash (const char *key)
+{
+	const char *p;
+	uint32_t hash = 0;
+
+	for (p = key; *p != '\0'; p++)
+		hash = (hash << 5) - hash  + *p;
+
+	return integer_hash (hash);
+}
+
+static uint32_t get_hash (void *key, VisHashmapKeyType keytype)
+{
+	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
+		return integer_hash (*((uint32_t *) key));
+
+	return string_hash ((char *) key);
+}
+
+/*
+ * Robin Hood probing keeps every entry at most as far from its home slot as the
+ * entries before it, so a search stops at the first entry that is closer to home
+ * than the searched key would be.
+ */
+static inline int table_find (VisHashmap *hashmap, VisHashmapEntry *table, int tablesize,
+		uint32_t hash, VisHashmapKeyType keytype, uint32_t integer, const char *string)
+{
+	VisHashmapEntry *entry;
+	uint32_t mask = tablesize - 1;
+	uint32_t index = hash & mask;
+	uint32_t dist = 0;
+
+	for (;;) {
+		entry = &table[index];
+
+		if (entry->hash == 0 || ((index - (entry->hash & mask)) & mask) < dist)
+			return -1;
+
+		if (entry->hash == hash && entry->keytype == keytype) {
+			if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER) {
+				if (entry->key.integer == integer)
+					return index;
+			} else if (strcmp (hashmap->keys + entry->key.string, string) == 0) {
+				return index;
 			}
 		}
+
+		index = (index + 1) & mask;
+		dist++;
 	}
+}
+
+/* Same search for integer keys, without the key type dispatch */
+static inline VisHashmapEntry *table_find_integer (VisHashmapEntry *table, int tablesize, uint32_t hash, uint32_t integer)
+{
+	VisHashmapEntry *entry;
+	uint32_t mask = tablesize - 1;
+	uint32_t index = hash & mask;
+	uint32_t dist = 0;
 
-	/* Check for next chain entry */
-	if (context->le != NULL && context->le->next != NULL) {
-		context->le = context->le->next;
+	for (;;) {
+		entry = &table[index];
 
-		return TRUE;
+		if (entry->hash == hash && entry->key.integer == integer &&
+				entry->keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
+			return entry;
+
+		if (entry->hash == 0 || ((index - (entry->hash & mask)) & mask) < dist)
+			return NULL;
+
+		index = (index + 1) & mask;
+		dist++;
 	}
+}
+
+/* The key must not be in the table yet */
+static void table_insert (VisHashmapEntry *table, int tablesize, VisHashmapEntry *entry)
+{
+	VisHashmapEntry current = *entry;
+	VisHashmapEntry swap;
+	uint32_t mask = tablesize - 1;
+	uint32_t index = current.hash & mask;
+	uint32_t dist = 0;
+	uint32_t entrydist;
+
+	for (;;) {
+		if (table[index].hash == 0) {
+			table[index] = current;
+
+			return;
+		}
+
+		/* Take the place of entries that are closer to home, and move those on */
+		entrydist = (index - (table[index].hash & mask)) & mask;
 
-	/* No next in chain, next array entry */
-	context->index++;
-	for (; context->index < hashmap->tablesize; context->index++) {
-		if (visual_collection_size (VISUAL_COLLECTION (&hashmap->table[context->index].list)) > 0) {
-			context->le = hashmap->table[context->index].list.head;
-			context->retrieved = FALSE;
+		if (entrydist < dist) {
+			swap = table[index];
+			table[index] = current;
+			current = swap;
 
-			return TRUE;
+			dist = entrydist;
 		}
+
+		index = (index + 1) & mask;
+		dist++;
+	}
+}
+
+/* Shifts the entries that follow back instead of leaving a tombstone */
+static void table_remove (VisHashmapEntry *table, int tablesize, int index)
+{
+	uint32_t mask = tablesize - 1;
+	uint32_t next = (index + 1) & mask;
+
+	while (table[next].hash != 0 && (table[next].hash & mask) != next) {
+		table[index] = table[next];
+
+		index = next;
+		next = (next + 1) & mask;
 	}
 
-	return FALSE;
+	table[index].hash = 0;
 }
 
-static void hashmap_iter_next (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext)
+static VisHashmapEntry *hashmap_find (VisHashmap *hashmap, uint32_t hash, VisHashmapKeyType keytype,
+		uint32_t integer, const char *string, int *old, int *index)
 {
-	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
+	int i;
 
-	if (context->retrieved == FALSE) {
-		if (context->first == TRUE) {
-			hashmap_iter_has_more (iter, collection, itercontext);
+	if (hashmap->table == NULL)
+		return NULL;
 
-			context->first = FALSE;
-		}
+	i = table_find (hashmap, hashmap->table, hashmap->tablesize, hash, keytype, integer, string);
 
-		context->retrieved = TRUE;
+	if (i >= 0) {
+		*old = FALSE;
+		*index = i;
 
-		return;
+		return &hashmap->table[i];
 	}
 
-	hashmap_iter_has_more (iter, collection, itercontext);
-	context->retrieved = TRUE;
+	if (hashmap->oldtable == NULL)
+		return NULL;
+
+	i = table_find (hashmap, hashmap->oldtable, hashmap->oldtablesize, hash, keytype, integer, string);
+
+	if (i >= 0) {
+		*old = TRUE;
+		*index = i;
+
+		return &hashmap->oldtable[i];
+	}
 
-	return;
+	return NULL;
 }
 
-static void *hashmap_iter_get_data (VisCollectionIter *iter, VisCollection *collection, VisObject *itercontext)
+/* Starts moving to a new table, a resize that is still in progress is finished first */
+static void hashmap_resize (VisHashmap *hashmap, int tablesize)
 {
-	HashmapIterContext *context = HASHMAP_ITERCONTEXT (itercontext);
-	VisHashmapChainEntry *mentry;
+	if (hashmap->oldtable != NULL)
+		hashmap_migrate (hashmap, -1);
 
-	mentry = context->le->data;
+	hashmap->oldtable = hashmap->table;
+	hashmap->oldtablesize = hashmap->tablesize;
+	hashmap->oldsize = hashmap->size;
+	hashmap->migrated = 0;
 
-	return mentry->data;
-}
+	hashmap->table = visual_mem_new0 (VisHashmapEntry, tablesize);
+	hashmap->tablesize = tablesize;
 
+	if (hashmap->oldtable == NULL || hashmap->oldsize == 0)
+		hashmap_migrate (hashmap, -1);
+}
 
-/* Thomas Wang's 32 bit Mix Function: http://www.concentric.net/~Ttwang/tech/inthash.htm */
-static int integer_hash (uint32_t key)
+/*
+ * Entries are taken out of the old table in index order. Removing shifts the rest
+ * of a cluster back, so the old table stays a valid table for lookups and every
+ * slot before the migrated index stays empty. A negative number of steps moves
+ * everything.
+ */
+static void hashmap_migrate (VisHashmap *hashmap, int steps)
 {
-	key += ~(key << 15);
-	key ^=  (key >> 10);
-	key +=  (key << 3);
-	key ^=  (key >> 6);
-	key += ~(key << 11);
-	key ^=  (key >> 16);
+	VisHashmapEntry *entry;
+
+	while (hashmap->oldtable != NULL && hashmap->oldsize > 0 &&
+			hashmap->migrated < hashmap->oldtablesize && steps-- != 0) {
+		entry = &hashmap->oldtable[hashmap->migrated];
+
+		if (entry->hash == 0) {
+			hashmap->migrated++;
+
+			continue;
+		}
+
+		table_insert (hashmap->table, hashmap->tablesize, entry);
+		table_remove (hashmap->oldtable, hashmap->oldtablesize, hashmap->migrated);
+
+		hashmap->oldsize--;
+	}
+
+	if (hashmap->oldtable != NULL && hashmap->oldsize == 0) {
+		visual_mem_free (hashmap->oldtable);
 
-	return key;
+		hashmap->oldtable = NULL;
+		hashmap->oldtablesize = 0;
+		hashmap->migrated = 0;
+	}
 }
 
-/* X31 HASH found in g_str_hash */
-static int string_hash (char *key)
+/* String keys are copied into one growing block, entries refer to them by offset */
+static int keys_add (VisHashmap *hashmap, const char *key)
 {
-	char *p;
-	int hash = 0;
+	int len = strlen (key) + 1;
+	int offset;
 
-	for (p = key; *p != '\0'; p++)
-		hash = (hash << 5) - hash  + *p;
+	if (hashmap->keysdead > hashmap->keyslen / 2 && hashmap->keyslen >= HASHMAP_KEYS_COMPACT_MIN)
+		keys_compact (hashmap);
+
+	if (hashmap->keyslen + len > hashmap->keyssize) {
+		while (hashmap->keyslen + len > hashmap->keyssize)
+			hashmap->keyssize = hashmap->keyssize > 0 ? hashmap->keyssize * 2 : 256;
+
+		hashmap->keys = visual_mem_realloc (hashmap->keys, hashmap->keyssize);
+	}
+
+	offset = hashmap->keyslen;
 
-	return hash;
+	visual_mem_copy (hashmap->keys + offset, key, len);
+	hashmap->keyslen += len;
+
+	return offset;
 }
 
-static int get_hash (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype)
+static void keys_release (VisHashmap *hashmap, VisHashmapEntry *entry)
 {
-	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
-		return (integer_hash (*((uint32_t *) key)) % hashmap->tablesize);
-	else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
-		return string_hash ((char *) key) % hashmap->tablesize;
-
-	return 0;
+	if (entry->keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
+		hashmap->keysdead += strlen (hashmap->keys + entry->key.string) + 1;
 }
 
-static int create_table (VisHashmap *hashmap)
+static void keys_compact (VisHashmap *hashmap)
 {
+	VisHashmapEntry *entry;
+	char *keys;
+	int keyslen = 0;
+	int len;
 	int i;
 
-	hashmap->table = visual_mem_new0 (VisHashmapEntry, hashmap->tablesize);
+	keys = visual_mem_malloc (hashmap->keyssize);
+
+	for (i = 0; (i = hashmap_iter_seek (hashmap, i)) >= 0; i++) {
+		entry = hashmap_iter_entry (hashmap, i);
+
+		if (entry->keytype != VISUAL_HASHMAP_KEY_TYPE_STRING)
+			continue;
 
-	/* Initialize first entry */
-	visual_list_init (&hashmap->table[0].list, hashmap_list_entry_destroyer);
+		len = strlen (hashmap->keys + entry->key.string) + 1;
 
-	/* Copy the entries to increase speed */
-	for (i = 1; i < hashmap->tablesize; i *= 2) {
-		int n = (i + i) > hashmap->tablesize ? hashmap->tablesize - i : i;
+		visual_mem_copy (keys + keyslen, hashmap->keys + entry->key.string, len);
+		entry->key.string = keyslen;
 
-		visual_mem_copy (&hashmap->table[i], &hashmap->table[0], sizeof (VisHashmapEntry) * n);
+		keyslen += len;
 	}
 
-	return VISUAL_OK;
+	visual_mem_free (hashmap->keys);
+
+	hashmap->keys = keys;
+	hashmap->keyslen = keyslen;
+	hashmap->keysdead = 0;
 }
 
 VisHashmap *visual_hashmap_new (VisCollectionDestroyerFunc destroyer)
@@ -318,67 +518,77 @@ int visual_hashmap_init (VisHashmap *hashmap, VisCollectionDestroyerFunc destroy
 	hashmap->size = 0;
 	hashmap->table = NULL;
 
+	hashmap->oldtable = NULL;
+	hashmap->oldtablesize = 0;
+	hashmap->oldsize = 0;
+	hashmap->migrated = 0;
+
+	hashmap->keys = NULL;
+	hashmap->keyslen = 0;
+	hashmap->keyssize = 0;
+	hashmap->keysdead = 0;
+
 	return VISUAL_OK;
 }
 
-int visual_hashmap_put (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype, void *data)
+static int hashmap_put (VisHashmap *hashmap, uint32_t hash, VisHashmapKeyType keytype,
+		uint32_t integer, const char *string, void *data)
 {
-	VisHashmapChainEntry *mentry;
-	VisListEntry *le = NULL;
-	VisList *chain;
-	int hash;
-
-	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+	VisHashmapEntry *entry;
+	VisHashmapEntry newentry;
+	int old, index;
 
 	/* Create initial hashtable */
 	if (hashmap->table == NULL)
-		create_table (hashmap);
+		hashmap->table = visual_mem_new0 (VisHashmapEntry, hashmap->tablesize);
 
-	hash = get_hash (hashmap, key, keytype);
+	entry = hashmap_find (hashmap, hash, keytype, integer, string, &old, &index);
 
-	chain = &hashmap->table[hash].list;
+	if (entry != NULL) {
+		entry->data = data;
 
-	/* Iterate list to check if the key is already in the chain */
-	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER) {
-		while ((mentry = visual_list_next (chain, &le)) != NULL) {
-			if (mentry->keytype == keytype) {
-
-				if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER &&
-						mentry->key.integer != *((uint32_t *) key))
-					continue;
-				else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING &&
-						strcmp (mentry->key.string, (char *) key) != 0)
-					continue;
-
-				mentry->data = data;
-
-				return VISUAL_OK;
-			}
-		}
+		return VISUAL_OK;
 	}
 
-	/* Key not in chain, append at end */
-	mentry = visual_mem_new0 (VisHashmapChainEntry, 1);
+	if ((hashmap->size - hashmap->oldsize + 1) * 100 > hashmap->tablesize * HASHMAP_MAX_LOAD)
+		hashmap_resize (hashmap, hashmap->tablesize * 2);
+	else
+		hashmap_migrate (hashmap, HASHMAP_MIGRATE_STEPS);
 
-	mentry->keytype = keytype;
+	newentry.hash = hash;
+	newentry.keytype = keytype;
+	newentry.data = data;
 
 	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
-		mentry->key.integer = *((uint32_t *) key);
-	else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
-		mentry->key.string = visual_strdup ((char *) key);
+		newentry.key.integer = integer;
+	else
+		newentry.key.string = keys_add (hashmap, string);
 
-	mentry->data = data;
-
-	visual_list_add (chain, mentry);
+	table_insert (hashmap->table, hashmap->tablesize, &newentry);
 
 	hashmap->size++;
 
 	return VISUAL_OK;
 }
 
+int visual_hashmap_put (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype, void *data)
+{
+	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+	visual_return_val_if_fail (key != NULL, -VISUAL_ERROR_NULL);
+
+	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
+		return hashmap_put (hashmap, get_hash (key, keytype), keytype, *((uint32_t *) key), NULL, data);
+	else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
+		return hashmap_put (hashmap, get_hash (key, keytype), keytype, 0, key, data);
+
+	return -VISUAL_ERROR_HASHMAP_INVALID_KEY_TYPE;
+}
+
 int visual_hashmap_put_integer (VisHashmap *hashmap, uint32_t key, void *data)
 {
-	return visual_hashmap_put (hashmap, &key, VISUAL_HASHMAP_KEY_TYPE_INTEGER, data);
+	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+
+	return hashmap_put (hashmap, integer_hash (key), VISUAL_HASHMAP_KEY_TYPE_INTEGER, key, NULL, data);
 }
 
 int visual_hashmap_put_string (VisHashmap *hashmap, char *key, void *data)
@@ -386,55 +596,60 @@ int visual_hashmap_put_string (VisHashmap *hashmap, char *key, void *data)
 	return visual_hashmap_put (hashmap, key, VISUAL_HASHMAP_KEY_TYPE_STRING, data);
 }
 
-int visual_hashmap_remove (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype, int destroy)
+static int hashmap_remove (VisHashmap *hashmap, uint32_t hash, VisHashmapKeyType keytype,
+		uint32_t integer, const char *string, int destroy)
 {
 	VisCollectionDestroyerFunc destroyer;
-	VisHashmapChainEntry *mentry;
-	VisListEntry *le = NULL;
-	VisList *chain;
-	int hash;
+	VisHashmapEntry *entry;
+	int old, index;
 
-	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+	entry = hashmap_find (hashmap, hash, keytype, integer, string, &old, &index);
 
-	if (hashmap->table == NULL)
+	if (entry == NULL)
 		return -VISUAL_ERROR_HASHMAP_NOT_IN_MAP;
 
-	hash = get_hash (hashmap, key, keytype);
+	if (destroy != FALSE) {
+		destroyer = visual_collection_get_destroyer (VISUAL_COLLECTION (hashmap));
 
-	chain = &hashmap->table[hash].list;
+		if (destroyer != NULL)
+			destroyer (entry->data);
+	}
 
-	/* Iterate list to check if the key is in the chain */
-	while ((mentry = visual_list_next (chain, &le)) != NULL) {
-		if (mentry->keytype == keytype) {
+	keys_release (hashmap, entry);
 
-			if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER &&
-					mentry->key.integer != *((uint32_t *) key))
-				continue;
-			else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING &&
-					strcmp (mentry->key.string, (char *) key) != 0)
-				continue;
+	if (old == TRUE) {
+		table_remove (hashmap->oldtable, hashmap->oldtablesize, index);
 
-			if (destroy != FALSE) {
-				destroyer = visual_collection_get_destroyer (VISUAL_COLLECTION (hashmap));
+		hashmap->oldsize--;
+	} else {
+		table_remove (hashmap->table, hashmap->tablesize, index);
+	}
 
-				destroyer (mentry->data);
-				visual_list_destroy (chain, &le);
-			} else {
-				visual_list_destroy (chain, &le);
-			}
+	hashmap->size--;
 
-			hashmap->size--;
+	hashmap_migrate (hashmap, HASHMAP_MIGRATE_STEPS);
 
-			return VISUAL_OK;
-		}
-	}
+	return VISUAL_OK;
+}
+
+int visual_hashmap_remove (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype, int destroy)
+{
+	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+	visual_return_val_if_fail (key != NULL, -VISUAL_ERROR_NULL);
 
-	return -VISUAL_ERROR_HASHMAP_NOT_IN_MAP;
+	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
+		return hashmap_remove (hashmap, get_hash (key, keytype), keytype, *((uint32_t *) key), NULL, destroy);
+	else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
+		return hashmap_remove (hashmap, get_hash (key, keytype), keytype, 0, key, destroy);
+
+	return -VISUAL_ERROR_HASHMAP_INVALID_KEY_TYPE;
 }
 
 int visual_hashmap_remove_integer (VisHashmap *hashmap, uint32_t key, int destroy)
 {
-	return visual_hashmap_remove (hashmap, &key, VISUAL_HASHMAP_KEY_TYPE_INTEGER, destroy);
+	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
+
+	return hashmap_remove (hashmap, integer_hash (key), VISUAL_HASHMAP_KEY_TYPE_INTEGER, key, NULL, destroy);
 }
 
 int visual_hashmap_remove_string (VisHashmap *hashmap, char *key, int destroy)
@@ -444,41 +659,39 @@ int visual_hashmap_remove_string (VisHashmap *hashmap, char *key, int destroy)
 
 void *visual_hashmap_get (VisHashmap *hashmap, void *key, VisHashmapKeyType keytype)
 {
-	VisHashmapChainEntry *mentry;
-	VisListEntry *le = NULL;
-	VisList *chain;
-	int hash;
+	VisHashmapEntry *entry = NULL;
+	int old, index;
 
 	visual_return_val_if_fail (hashmap != NULL, NULL);
+	visual_return_val_if_fail (key != NULL, NULL);
 
-	/* Create initial hashtable */
-	if (hashmap->table == NULL)
-		return NULL;
+	if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER)
+		entry = hashmap_find (hashmap, get_hash (key, keytype), keytype, *((uint32_t *) key), NULL, &old, &index);
+	else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING)
+		entry = hashmap_find (hashmap, get_hash (key, keytype), keytype, 0, key, &old, &index);
 
-	hash = get_hash (hashmap, key, keytype);
+	return entry != NULL ? entry->data : NULL;
+}
 
-	chain = &hashmap->table[hash].list;
+/* Integer keys skip the key type dispatch and never touch the key storage */
+void *visual_hashmap_get_integer (VisHashmap *hashmap, uint32_t key)
+{
+	VisHashmapEntry *entry;
+	uint32_t hash;
 
-	/* Iterate list to check if the key is already in the chain */
-	while ((mentry = visual_list_next (chain, &le)) != NULL) {
-		if (mentry->keytype == keytype) {
-			if (keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER &&
-					mentry->key.integer != *((uint32_t *) key))
-				continue;
-			else if (keytype == VISUAL_HASHMAP_KEY_TYPE_STRING &&
-					strcmp (mentry->key.string, (char *) key) != 0)
-				continue;
+	visual_return_val_if_fail (hashmap != NULL, NULL);
 
-			return mentry->data;
-		}
-	}
+	if (hashmap->table == NULL)
+		return NULL;
 
-	return NULL;
-}
+	hash = integer_hash (key);
 
-void *visual_hashmap_get_integer (VisHashmap *hashmap, uint32_t key)
-{
-	return visual_hashmap_get (hashmap, &key, VISUAL_HASHMAP_KEY_TYPE_INTEGER);
+	entry = table_find_integer (hashmap->table, hashmap->tablesize, hash, key);
+
+	if (entry == NULL && hashmap->oldtable != NULL)
+		entry = table_find_integer (hashmap->oldtable, hashmap->oldtablesize, hash, key);
+
+	return entry != NULL ? entry->data : NULL;
 }
 
 void *visual_hashmap_get_string (VisHashmap *hashmap, char *key)
@@ -488,44 +701,24 @@ void *visual_hashmap_get_string (VisHashmap *hashmap, char *key)
 
 int visual_hashmap_set_table_size (VisHashmap *hashmap, int tablesize)
 {
-	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
-
-	/* Table was not empty, rehash */
-	if (hashmap->table != NULL) {
-		VisHashmap tempmap;
+	int size = VISUAL_HASHMAP_START_SIZE;
 
-		visual_hashmap_init (&tempmap, NULL);
-
-		tempmap.table = hashmap->table;
-		tempmap.tablesize = hashmap->tablesize;
-		tempmap.size = hashmap->size;
-
-		VisCollectionIter *iter = visual_collection_get_iter (VISUAL_COLLECTION (hashmap));
-
-		hashmap->tablesize = tablesize;
-		create_table (hashmap);
-
-		/* Rehash all entries */
-		while (visual_collection_iter_has_more (iter) == TRUE) {
-			VisHashmapChainEntry *mentry = visual_collection_iter_get_data (iter);
+	visual_return_val_if_fail (hashmap != NULL, -VISUAL_ERROR_HASHMAP_NULL);
 
-			if (mentry->keytype == VISUAL_HASHMAP_KEY_TYPE_INTEGER) {
-				visual_hashmap_put_integer (hashmap, mentry->key.integer, mentry->data);
+	/* Round up to a power of two that keeps the current entries below the load limit */
+	while (size < tablesize || size * HASHMAP_MAX_LOAD < hashmap->size * 100)
+		size *= 2;
 
-			} else if (mentry->keytype == VISUAL_HASHMAP_KEY_TYPE_STRING) {
-				visual_hashmap_put_string (hashmap, mentry->key.string, mentry->data);
+	if (hashmap->table == NULL) {
+		hashmap->tablesize = size;
 
-			}
-		}
-
-		/* Free old table */
-		visual_object_unref (VISUAL_OBJECT (&tempmap));
-
-	} else {
-		hashmap->tablesize = tablesize;
-		create_table (hashmap);
+		return VISUAL_OK;
 	}
 
+	/* Table was not empty, rehash all at once */
+	hashmap_resize (hashmap, size);
+	hashmap_migrate (hashmap, -1);
+
 	return VISUAL_OK;
 }
 
@@ -535,5 +728,3 @@ int visual_hashmap_get_table_size (VisHashmap *hashmap)
 
 	return hashmap->tablesize;
 }
-
-
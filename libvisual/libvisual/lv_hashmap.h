@@ -36,15 +36,18 @@
 
 VISUAL_BEGIN_DECLS
 
-#define VISUAL_HASHMAP_START_SIZE	1024
+/**
+ * Number of slots a new VisHashmap starts with, the table doubles as entries are put.
+ * Before the maps were open addressed this was 1024, the number of fixed chains.
+ * Code that needs the room up front calls visual_hashmap_set_table_size().
+ */
+#define VISUAL_HASHMAP_START_SIZE	16
 
 #define VISUAL_HASHMAP(obj)				(VISUAL_CHECK_CAST ((obj), VisHashmap))
 #define VISUAL_HASHMAPENTRY(obj)			(VISUAL_CHECK_CAST ((obj), VisHashmapEntry))
-#define VISUAL_HASHMAPCHAINENTRY(obj)			(VISUAL_CHECK_CAST ((obj), VisHashmapChainEntry))
 
 typedef struct _VisHashmap VisHashmap;
 typedef struct _VisHashmapEntry VisHashmapEntry;
-typedef struct _VisHashmapChainEntry VisHashmapChainEntry;
 
 typedef enum {
 	VISUAL_HASHMAP_KEY_TYPE_NONE		= 0,
@@ -54,34 +57,42 @@ typedef enum {
 
 /**
  * Using the VisHashmap structure you can store a collection of data within a hashmap.
+ *
+ * The VisHashmap is an open addressing table using Robin Hood probing. It doubles when
+ * it gets 80% full, the entries are moved to the new table a few at a time by
+ * the calls that change the map, lookups check both tables meanwhile.
  */
 struct _VisHashmap {
 	VisCollection		 collection;	/**< The VisCollection data. */
 
-	int			 tablesize;	/**< Size of the table array. */
+	int			 tablesize;	/**< Size of the table array, always a power of two. */
 	int			 size;		/**< Number of entries stored in the VisHashmap. */
 
 	VisHashmapEntry		*table;		/**< The VisHashmap array. */
+
+	VisHashmapEntry		*oldtable;	/**< Private, the table that is being moved out of. */
+	int			 oldtablesize;	/**< Private, size of the old table. */
+	int			 oldsize;	/**< Private, number of entries left in the old table. */
+	int			 migrated;	/**< Private, index up to which the old table is empty. */
+
+	char			*keys;		/**< Private, copies of the string keys. */
+	int			 keyslen;	/**< Private, bytes in use in the key storage. */
+	int			 keyssize;	/**< Private, size of the key storage. */
+	int			 keysdead;	/**< Private, bytes of removed keys in the key storage. */
 };
 
 /**
  * Private VisHashmap array entry.
  */
 struct _VisHashmapEntry {
-	VisList			 list;
-};
-
-/**
- * Private VisHashmap chain entry.
- */
-struct _VisHashmapChainEntry {
+	uint32_t		 hash;		/**< The hash of the key, 0 for an empty entry. */
 	VisHashmapKeyType	 keytype;
 
 	void			*data;
 
 	union {
 		uint32_t	 integer;
-		char		*string;
+		int		 string;	/**< Offset of the key in the key storage. */
 	} key;
 };
 
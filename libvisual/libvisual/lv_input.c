@@ -166,6 +166,7 @@ int visual_input_set_callback (VisInput *input, VisInputUploadCallbackFunc callb
 int visual_input_run (VisInput *input)
 {
 	VisInputPlugin *inplugin;
+	VisMemTag oldtag;
 
 	visual_return_val_if_fail (input != NULL, -VISUAL_ERROR_INPUT_NULL);
 
@@ -178,9 +179,14 @@ int visual_input_run (VisInput *input)
 			return -VISUAL_ERROR_INPUT_PLUGIN_NULL;
 		}
 
+		oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_INPUT);
 		inplugin->upload (input->plugin, input->audio);
-	} else
+	} else {
+		oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_INPUT);
 		input->callback (input, input->audio, visual_object_get_private (VISUAL_OBJECT (input)));
+	}
+
+	visual_mem_set_tag (oldtag);
 
 	visual_audio_analyze (input->audio);
 
@@ -0,0 +1,503 @@
+#include "config.h"
+#include "lv_jobs.h"
+#include "lv_common.h"
+#include "lv_thread.h"
+#include "lv_atomic.h"
+#include "lv_cpu.h"
+#include "gettext.h"
+
+/*
+ * Every worker owns a deque of jobs. The owner pushes and pops at the tail, so it
+ * keeps working on the most recently split, cache warm, part of a range. Idle
+ * threads steal from the head, where the largest halves are. Threads that are not
+ * workers share deque 0. The deques are short lived and guarded by a mutex each,
+ * idle threads sleep on a single condition.
+ */
+
+#define DEQUE_INITIAL_SIZE	64
+
+/* Sub ranges per thread when parallel_for picks the grain itself */
+#define RANGES_PER_THREAD	4
+
+#if defined(__GNUC__)
+#define JOBS_THREAD_LOCAL	__thread
+#elif defined(_MSC_VER)
+#define JOBS_THREAD_LOCAL	__declspec(thread)
+#endif
+
+typedef struct {
+	VisJobFunc	 func;
+	VisJobRangeFunc	 rangefunc;
+	void		*priv;
+	int		 start;
+	int		 end;
+	int		 grain;
+	VisJobGroup	*group;
+} Job;
+
+typedef struct {
+	VisMutex	 mutex;
+	Job		*jobs;
+	int		 size;		/* Always a power of two */
+	int		 head;
+	int		 tail;
+} JobDeque;
+
+typedef struct {
+	JobDeque	 deques[VISUAL_JOBS_WORKERS_MAX + 1];
+	VisThread	*workers[VISUAL_JOBS_WORKERS_MAX];
+	volatile int	 nworkers;	/* Read by the workers while more are started */
+
+	VisMutex	 sleepmutex;
+	VisCond		 wake;
+	volatile int	 queued;
+	volatile int	 sleepers;
+	volatile int	 quit;
+} JobPool;
+
+static JobPool __lv_jobs_pool;
+static int __lv_jobs_initialized = FALSE;
+
+#ifdef JOBS_THREAD_LOCAL
+static JOBS_THREAD_LOCAL JobDeque *__lv_jobs_deque = NULL;
+#endif
+
+static int deque_push (JobDeque *deque, Job *job);
+static int deque_pop (JobDeque *deque, Job *job);
+static int deque_steal (JobDeque *deque, Job *job);
+
+static JobDeque *pool_get_deque (JobPool *pool);
+static void pool_push (JobPool *pool, JobDeque *self, Job *job);
+static int pool_take (JobPool *pool, JobDeque *self, Job *job);
+static void pool_run (JobPool *pool, JobDeque *self, Job *job);
+static void pool_wake (JobPool *pool, int all);
+static void *pool_worker (void *data);
+static int pool_start_workers (JobPool *pool, int nworkers);
+static void pool_stop_workers (JobPool *pool);
+static int jobs_are_parallel (void);
+
+static int deque_push (JobDeque *deque, Job *job)
+{
+	Job *jobs;
+	int i;
+
+	visual_mutex_lock (&deque->mutex);
+
+	if (deque->tail - deque->head == deque->size) {
+		jobs = visual_mem_malloc (deque->size * 2 * sizeof (Job));
+
+		for (i = deque->head; i < deque->tail; i++)
+			jobs[i - deque->head] = deque->jobs[i & (deque->size - 1)];
+
+		visual_mem_free (deque->jobs);
+
+		deque->jobs = jobs;
+		deque->tail -= deque->head;
+		deque->head = 0;
+		deque->size *= 2;
+	}
+
+	deque->jobs[deque->tail++ & (deque->size - 1)] = *job;
+
+	visual_mutex_unlock (&deque->mutex);
+
+	return VISUAL_OK;
+}
+
+static int deque_pop (JobDeque *deque, Job *job)
+{
+	int found = FALSE;
+
+	visual_mutex_lock (&deque->mutex);
+
+	if (deque->tail > deque->head) {
+		*job = deque->jobs[--deque->tail & (deque->size - 1)];
+
+		if (deque->tail == deque->head)
+			deque->head = deque->tail = 0;
+
+		found = TRUE;
+	}
+
+	visual_mutex_unlock (&deque->mutex);
+
+	return found;
+}
+
+static int deque_steal (JobDeque *deque, Job *job)
+{
+	int found = FALSE;
+
+	visual_mutex_lock (&deque->mutex);
+
+	if (deque->tail > deque->head) {
+		*job = deque->jobs[deque->head++ & (deque->size - 1)];
+
+		if (deque->tail == deque->head)
+			deque->head = deque->tail = 0;
+
+		found = TRUE;
+	}
+
+	visual_mutex_unlock (&deque->mutex);
+
+	return found;
+}
+
+static JobDeque *pool_get_deque (JobPool *pool)
+{
+#ifdef JOBS_THREAD_LOCAL
+	if (__lv_jobs_deque != NULL)
+		return __lv_jobs_deque;
+#endif
+
+	return &pool->deques[0];
+}
+
+static void pool_wake (JobPool *pool, int all)
+{
+	/* Pairs with the barrier a sleeper puts between announcing itself and its last check */
+	visual_atomic_barrier ();
+
+	if (visual_atomic_int_get (&pool->sleepers) == 0)
+		return;
+
+	visual_mutex_lock (&pool->sleepmutex);
+
+	if (all == TRUE)
+		visual_cond_broadcast (&pool->wake);
+	else
+		visual_cond_signal (&pool->wake);
+
+	visual_mutex_unlock (&pool->sleepmutex);
+}
+
+static void pool_push (JobPool *pool, JobDeque *self, Job *job)
+{
+	deque_push (self, job);
+
+	visual_atomic_int_add (&pool->queued, 1);
+
+	pool_wake (pool, FALSE);
+}
+
+static int pool_take (JobPool *pool, JobDeque *self, Job *job)
+{
+	int ndeques = visual_atomic_int_get (&pool->nworkers) + 1;
+	int first = self - pool->deques;
+	int i;
+
+	if (visual_atomic_int_get (&pool->queued) <= 0)
+		return FALSE;
+
+	if (deque_pop (self, job) == FALSE) {
+		for (i = 1; i < ndeques; i++) {
+			if (deque_steal (&pool->deques[(first + i) % ndeques], job) == TRUE)
+				break;
+		}
+
+		if (i == ndeques)
+			return FALSE;
+	}
+
+	visual_atomic_int_add (&pool->queued, -1);
+
+	return TRUE;
+}
+
+static void pool_run (JobPool *pool, JobDeque *self, Job *job)
+{
+	VisJobGroup *group = job->group;
+	Job split;
+
+	if (job->rangefunc != NULL) {
+		/* Hand out the upper halves, thieves take the largest one first */
+		while (job->end - job->start > job->grain) {
+			split = *job;
+			split.start = job->start + (job->end - job->start) / 2;
+			job->end = split.start;
+
+			visual_atomic_int_add (&group->pending, 1);
+
+			pool_push (pool, self, &split);
+		}
+
+		job->rangefunc (job->priv, job->start, job->end);
+	} else {
+		job->func (job->priv);
+	}
+
+	if (visual_atomic_int_add (&group->pending, -1) == 0)
+		pool_wake (pool, TRUE);
+}
+
+static void *pool_worker (void *data)
+{
+	JobDeque *self = data;
+	JobPool *pool = &__lv_jobs_pool;
+	Job job;
+
+#ifdef JOBS_THREAD_LOCAL
+	__lv_jobs_deque = self;
+#endif
+
+	while (visual_atomic_int_get (&pool->quit) == FALSE) {
+		if (pool_take (pool, self, &job) == TRUE) {
+			pool_run (pool, self, &job);
+
+			continue;
+		}
+
+		visual_mutex_lock (&pool->sleepmutex);
+
+		visual_atomic_int_add (&pool->sleepers, 1);
+		visual_atomic_barrier ();
+
+		while (visual_atomic_int_get (&pool->queued) <= 0 && pool->quit == FALSE)
+			visual_cond_wait (&pool->wake, &pool->sleepmutex);
+
+		visual_atomic_int_add (&pool->sleepers, -1);
+
+		visual_mutex_unlock (&pool->sleepmutex);
+	}
+
+	return NULL;
+}
+
+static int pool_start_workers (JobPool *pool, int nworkers)
+{
+	if (nworkers > VISUAL_JOBS_WORKERS_MAX)
+		nworkers = VISUAL_JOBS_WORKERS_MAX;
+
+	while (pool->nworkers < nworkers) {
+		pool->workers[pool->nworkers] = visual_thread_create (pool_worker,
+				&pool->deques[pool->nworkers + 1], TRUE);
+
+		if (pool->workers[pool->nworkers] == NULL) {
+			visual_log (VISUAL_LOG_WARNING, _("Could not start job worker %d"), pool->nworkers);
+
+			return -VISUAL_ERROR_GENERAL;
+		}
+
+		visual_atomic_int_add (&pool->nworkers, 1);
+	}
+
+	return VISUAL_OK;
+}
+
+static void pool_stop_workers (JobPool *pool)
+{
+	int i;
+
+	visual_mutex_lock (&pool->sleepmutex);
+
+	visual_atomic_int_set (&pool->quit, TRUE);
+	visual_cond_broadcast (&pool->wake);
+
+	visual_mutex_unlock (&pool->sleepmutex);
+
+	for (i = 0; i < pool->nworkers; i++) {
+		visual_thread_join (pool->workers[i]);
+		visual_thread_free (pool->workers[i]);
+
+		pool->workers[i] = NULL;
+	}
+
+	/* Whatever is left was never started, the groups it belongs to are gone with it */
+	for (i = 0; i <= VISUAL_JOBS_WORKERS_MAX; i++)
+		pool->deques[i].head = pool->deques[i].tail = 0;
+
+	pool->nworkers = 0;
+	pool->queued = 0;
+	pool->quit = FALSE;
+}
+
+static int jobs_are_parallel ()
+{
+	return __lv_jobs_initialized == TRUE && __lv_jobs_pool.nworkers > 0 &&
+		visual_thread_is_enabled () == TRUE;
+}
+
+int visual_jobs_initialize ()
+{
+	JobPool *pool = &__lv_jobs_pool;
+	int i;
+
+	if (__lv_jobs_initialized == TRUE)
+		return VISUAL_OK;
+
+	visual_mem_set (pool, 0, sizeof (JobPool));
+
+	for (i = 0; i <= VISUAL_JOBS_WORKERS_MAX; i++) {
+		visual_mutex_init (&pool->deques[i].mutex);
+
+		pool->deques[i].size = DEQUE_INITIAL_SIZE;
+		pool->deques[i].jobs = visual_mem_malloc (DEQUE_INITIAL_SIZE * sizeof (Job));
+	}
+
+	visual_mutex_init (&pool->sleepmutex);
+	visual_cond_init (&pool->wake);
+
+	__lv_jobs_initialized = TRUE;
+
+	return visual_jobs_set_worker_count (-1);
+}
+
+int visual_jobs_is_initialized ()
+{
+	return __lv_jobs_initialized;
+}
+
+int visual_jobs_deinitialize ()
+{
+	JobPool *pool = &__lv_jobs_pool;
+	int i;
+
+	if (__lv_jobs_initialized == FALSE)
+		return -VISUAL_ERROR_GENERAL;
+
+	pool_stop_workers (pool);
+
+	for (i = 0; i <= VISUAL_JOBS_WORKERS_MAX; i++)
+		visual_mem_free (pool->deques[i].jobs);
+
+	__lv_jobs_initialized = FALSE;
+
+	return VISUAL_OK;
+}
+
+int visual_jobs_set_worker_count (int workers)
+{
+	JobPool *pool = &__lv_jobs_pool;
+	VisCPU *cpu;
+
+	visual_return_val_if_fail (__lv_jobs_initialized == TRUE, -VISUAL_ERROR_GENERAL);
+
+	if (workers < 0) {
+		cpu = visual_cpu_get_caps ();
+
+		workers = cpu != NULL ? cpu->nrcpu - 1 : 0;
+	}
+
+	pool_stop_workers (pool);
+
+	if (workers == 0 || visual_thread_is_supported () == FALSE)
+		return VISUAL_OK;
+
+	return pool_start_workers (pool, workers);
+}
+
+int visual_jobs_get_worker_count ()
+{
+	if (jobs_are_parallel () == FALSE)
+		return 0;
+
+	return __lv_jobs_pool.nworkers;
+}
+
+int visual_job_group_init (VisJobGroup *group)
+{
+	visual_return_val_if_fail (group != NULL, -VISUAL_ERROR_NULL);
+
+	group->pending = 0;
+
+	return VISUAL_OK;
+}
+
+int visual_job_group_run (VisJobGroup *group, VisJobFunc func, void *priv)
+{
+	JobPool *pool = &__lv_jobs_pool;
+	Job job;
+
+	visual_return_val_if_fail (group != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (func != NULL, -VISUAL_ERROR_NULL);
+
+	if (jobs_are_parallel () == FALSE) {
+		func (priv);
+
+		return VISUAL_OK;
+	}
+
+	job.func = func;
+	job.rangefunc = NULL;
+	job.priv = priv;
+	job.group = group;
+
+	visual_atomic_int_add (&group->pending, 1);
+
+	pool_push (pool, pool_get_deque (pool), &job);
+
+	return VISUAL_OK;
+}
+
+int visual_job_group_wait (VisJobGroup *group)
+{
+	JobPool *pool = &__lv_jobs_pool;
+	JobDeque *self;
+	Job job;
+
+	visual_return_val_if_fail (group != NULL, -VISUAL_ERROR_NULL);
+
+	if (visual_atomic_int_get (&group->pending) == 0)
+		return VISUAL_OK;
+
+	self = pool_get_deque (pool);
+
+	while (visual_atomic_int_get (&group->pending) > 0) {
+		if (pool_take (pool, self, &job) == TRUE) {
+			pool_run (pool, self, &job);
+
+			continue;
+		}
+
+		visual_mutex_lock (&pool->sleepmutex);
+
+		visual_atomic_int_add (&pool->sleepers, 1);
+		visual_atomic_barrier ();
+
+		while (visual_atomic_int_get (&group->pending) > 0 &&
+				visual_atomic_int_get (&pool->queued) <= 0)
+			visual_cond_wait (&pool->wake, &pool->sleepmutex);
+
+		visual_atomic_int_add (&pool->sleepers, -1);
+
+		visual_mutex_unlock (&pool->sleepmutex);
+	}
+
+	return VISUAL_OK;
+}
+
+int visual_jobs_parallel_for (int start, int end, int grain, VisJobRangeFunc func, void *priv)
+{
+	JobPool *pool = &__lv_jobs_pool;
+	VisJobGroup group;
+	Job job;
+
+	visual_return_val_if_fail (func != NULL, -VISUAL_ERROR_NULL);
+
+	if (end <= start)
+		return VISUAL_OK;
+
+	if (jobs_are_parallel () == FALSE) {
+		func (priv, start, end);
+
+		return VISUAL_OK;
+	}
+
+	if (grain <= 0)
+		grain = (end - start) / ((pool->nworkers + 1) * RANGES_PER_THREAD);
+
+	job.func = NULL;
+	job.rangefunc = func;
+	job.priv = priv;
+	job.start = start;
+	job.end = end;
+	job.grain = grain > 1 ? grain : 1;
+	job.group = &group;
+
+	group.pending = 1;
+
+	pool_run (pool, pool_get_deque (pool), &job);
+
+	return visual_job_group_wait (&group);
+}
@@ -0,0 +1,140 @@
+#ifndef _LV_JOBS_H
+#define _LV_JOBS_H
+
+#include <libvisual/lvconfig.h>
+#include <libvisual/lv_defines.h>
+
+/**
+ * @defgroup VisJobs VisJobs
+ * @{
+ */
+
+VISUAL_BEGIN_DECLS
+
+/* Upper bound on the number of worker threads */
+#define VISUAL_JOBS_WORKERS_MAX		32
+
+typedef struct _VisJobGroup VisJobGroup;
+
+/**
+ * The function defination for a job that is run through a VisJobGroup.
+ *
+ * @arg priv Pointer to the private data given with visual_job_group_run.
+ */
+typedef void (*VisJobFunc)(void *priv);
+
+/**
+ * The function defination for the body of visual_jobs_parallel_for, it is called
+ * with a half open sub range [start, end).
+ *
+ * @arg priv Pointer to the private data given with visual_jobs_parallel_for.
+ * @arg start First index of the sub range.
+ * @arg end One past the last index of the sub range.
+ */
+typedef void (*VisJobRangeFunc)(void *priv, int start, int end);
+
+/**
+ * A VisJobGroup tracks a set of jobs that are forked with visual_job_group_run
+ * and joined with visual_job_group_wait. Groups are small and are normally kept
+ * on the stack of the function that forks the jobs.
+ */
+struct _VisJobGroup {
+	volatile int	pending;	/**< Private, the number of jobs that did not finish yet. */
+};
+
+/**
+ * Initializes the VisJobs subsystem. The worker pool is sized to one thread less
+ * than the number of CPUs, the thread that waits on a job takes part in the work.
+ * This function is called from within visual_init().
+ *
+ * @return VISUAL_OK on succes.
+ */
+int visual_jobs_initialize (void);
+
+/**
+ * Request if VisJobs is initialized or not.
+ *
+ * @return TRUE if initialized, FALSE if not initialized.
+ */
+int visual_jobs_is_initialized (void);
+
+/**
+ * Stops the worker threads, jobs that were never started are dropped.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_GENERAL when not initialized.
+ */
+int visual_jobs_deinitialize (void);
+
+/**
+ * Changes the number of worker threads. This may only be called while no jobs
+ * are in flight.
+ *
+ * @param workers The number of worker threads, 0 to run every job on the thread that
+ *	submits it, -1 for the default of one less than the number of CPUs.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_GENERAL on failure.
+ */
+int visual_jobs_set_worker_count (int workers);
+
+/**
+ * Gives the number of worker threads.
+ *
+ * @return The number of worker threads, 0 when jobs run serially.
+ */
+int visual_jobs_get_worker_count (void);
+
+/**
+ * Initializes a VisJobGroup, this must be done before jobs are run through it.
+ *
+ * @param group Pointer to the VisJobGroup that is initialized.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_job_group_init (VisJobGroup *group);
+
+/**
+ * Forks a job. The job is queued for the workers, without workers it runs before
+ * this function returns. Jobs can fork and wait on groups of their own.
+ *
+ * @param group Pointer to the VisJobGroup the job belongs to.
+ * @param func The function that is run.
+ * @param priv Private data that is passed to the function.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_job_group_run (VisJobGroup *group, VisJobFunc func, void *priv);
+
+/**
+ * Joins all jobs in a group. The waiting thread runs queued jobs, from this or any
+ * other group, until every job in the group has finished.
+ *
+ * @param group Pointer to the VisJobGroup that is waited on.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_job_group_wait (VisJobGroup *group);
+
+/**
+ * Runs a function over the range [start, end) split in sub ranges, and returns when
+ * the whole range is done. Ranges are split in halves and idle workers steal the
+ * larger halves, so uneven work balances out. For per pixel work the range is
+ * normally a range of rows.
+ *
+ * @param start The start of the range.
+ * @param end One past the end of the range.
+ * @param grain The largest sub range that is not split further, 0 picks one from
+ *	the range and the number of workers.
+ * @param func The function that is called for every sub range.
+ * @param priv Private data that is passed to the function.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_jobs_parallel_for (int start, int end, int grain, VisJobRangeFunc func, void *priv);
+
+VISUAL_END_DECLS
+
+/**
+ * @}
+ */
+
+#endif /* _LV_JOBS_H */
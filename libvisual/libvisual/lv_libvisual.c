@@ -26,6 +26,7 @@
 #include "lv_common.h"
 
 #include "lv_alpha_blend.h"
+#include "lv_audio.h"
 #include "lv_fourier.h"
 #include "lv_plugin_registry.h"
 #include "lv_log.h"
@@ -33,6 +34,9 @@
 #include "lv_thread.h"
 #include "lv_cpu.h"
 #include "lv_util.h"
+#include "lv_jobs.h"
+#include "private/lv_mem_pool.h"
+#include "private/lv_video_scale.h"
 
 #include "gettext.h"
 
@@ -144,12 +148,30 @@ int visual_init (int *argc, char ***argv)
 	/* Initialize CPU-accelerated graphics functions */
 	visual_alpha_blend_initialize ();
 
+	/* Initialize CPU-accelerated audio sample conversion */
+	visual_audio_sample_convert_initialize ();
+
+	/* Initialize CPU-accelerated video depth conversion */
+	visual_video_convert_initialize ();
+
+	/* Initialize CPU-accelerated video scaling */
+	visual_video_scale_initialize ();
+
+	/* Initialize CPU-accelerated video compositing */
+	visual_video_composite_initialize ();
+
 	/* Initialize Thread system */
 	visual_thread_initialize ();
 
+	/* Initialize the job workers, VisVideo and plugins share them */
+	visual_jobs_initialize ();
+
 	/* Initialize FFT system */
 	visual_fourier_initialize ();
 
+	/* Initialize the cache of scaling filters */
+	visual_video_scale_cache_initialize ();
+
 	/* Initialize the plugin registry */
 	visual_plugin_registry_initialize ();
 
@@ -179,12 +201,19 @@ int visual_quit ()
 	if (visual_fourier_is_initialized () == TRUE)
 		visual_fourier_deinitialize ();
 
+	visual_video_scale_cache_deinitialize ();
+
+	if (visual_jobs_is_initialized () == TRUE)
+		visual_jobs_deinitialize ();
+
 	visual_plugin_registry_deinitialize ();
 
 	ret = visual_object_unref (VISUAL_OBJECT (__lv_paramcontainer));
 	if (ret < 0)
 		visual_log (VISUAL_LOG_WARNING, _("Global param container: destroy failed: %s"), visual_error_to_string (ret));
 
+	visual_mem_pool_deinitialize ();
+
 	__lv_initialized = FALSE;
 	return VISUAL_OK;
 }
@@ -308,6 +308,7 @@ int visual_list_chain_at_begin (VisList *list, VisListEntry *le)
 		next = list->head;
 
 		le->next = next;
+		next->prev = le;
 		list->head = le;
 
 		le->prev = NULL;
@@ -84,13 +84,10 @@ int visual_math_vectorized_multiplier_floats_const_float (float *dest, float *sr
 			n--;
 		}
 
-		__asm __volatile
-			("\n\t movups (%0), %%xmm7"
-			 :: "r" (packed_multiplier) : "memory");
-
 		while (n > 16) {
 			__asm __volatile
 				("\n\t prefetchnta 256(%0)"
+				 "\n\t movups (%2), %%xmm7"
 				 "\n\t movups (%0), %%xmm0"
 				 "\n\t movups 16(%0), %%xmm1"
 				 "\n\t movups 32(%0), %%xmm2"
@@ -103,7 +100,8 @@ int visual_math_vectorized_multiplier_floats_const_float (float *dest, float *sr
 				 "\n\t movntps %%xmm1, 16(%1)"
 				 "\n\t movntps %%xmm2, 32(%1)"
 				 "\n\t movntps %%xmm3, 48(%1)"
-				 :: "r" (s), "r" (d) : "memory");
+				 :: "r" (s), "r" (d), "r" (packed_multiplier)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 16;
 			s += 16;
@@ -195,14 +193,10 @@ int visual_math_vectorized_add_floats_const_float (float *dest, float *src, visu
 			n--;
 		}
 
-		__asm __volatile
-			("\n\t movups (%0), %%xmm7"
-			 :: "r" (packed_adder) : "memory");
-
-
 		while (n > 16) {
 			__asm __volatile
 				("\n\t prefetchnta 256(%0)"
+				 "\n\t movups (%2), %%xmm7"
 				 "\n\t movups (%0), %%xmm0"
 				 "\n\t movups 16(%0), %%xmm1"
 				 "\n\t movups 32(%0), %%xmm2"
@@ -215,7 +209,8 @@ int visual_math_vectorized_add_floats_const_float (float *dest, float *src, visu
 				 "\n\t movntps %%xmm1, 16(%1)"
 				 "\n\t movntps %%xmm2, 32(%1)"
 				 "\n\t movntps %%xmm3, 48(%1)"
-				 :: "r" (s), "r" (d) : "memory");
+				 :: "r" (s), "r" (d), "r" (packed_adder)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 16;
 			s += 16;
@@ -306,14 +301,10 @@ int visual_math_vectorized_substract_floats_const_float (float *dest, float *src
 			n--;
 		}
 
-		__asm __volatile
-			("\n\t movups (%0), %%xmm7"
-			 :: "r" (packed_substracter) : "memory");
-
-
 		while (n > 16) {
 			__asm __volatile
 				("\n\t prefetchnta 256(%0)"
+				 "\n\t movups (%2), %%xmm7"
 				 "\n\t movups (%0), %%xmm0"
 				 "\n\t movups 16(%0), %%xmm1"
 				 "\n\t movups 32(%0), %%xmm2"
@@ -326,7 +317,8 @@ int visual_math_vectorized_substract_floats_const_float (float *dest, float *src
 				 "\n\t movntps %%xmm1, 16(%1)"
 				 "\n\t movntps %%xmm2, 32(%1)"
 				 "\n\t movntps %%xmm3, 48(%1)"
-				 :: "r" (s), "r" (d) : "memory");
+				 :: "r" (s), "r" (d), "r" (packed_substracter)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 16;
 			s += 16;
@@ -434,7 +426,8 @@ int visual_math_vectorized_multiplier_floats_floats (float *dest, float *src1, f
 				 "\n\t movntps %%xmm1, 16(%2)"
 				 "\n\t movntps %%xmm2, 32(%2)"
 				 "\n\t movntps %%xmm3, 48(%2)"
-				 :: "r" (s1), "r" (s2), "r" (d) : "memory");
+				 :: "r" (s1), "r" (s2), "r" (d)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 16;
 			s1 += 16;
@@ -811,6 +804,8 @@ int visual_math_vectorized_sqrt_floats (float *dest, float *src, visual_size_t n
 			*d = sqrtf (*s);
 
 			d++;
+			s++;
+
 			n--;
 		}
 
@@ -829,7 +824,8 @@ int visual_math_vectorized_sqrt_floats (float *dest, float *src, visual_size_t n
 				 "\n\t movntps %%xmm5, 16(%1)"
 				 "\n\t movntps %%xmm6, 32(%1)"
 				 "\n\t movntps %%xmm7, 48(%1)"
-				 :: "r" (s), "r" (d) : "memory");
+				 :: "r" (s), "r" (d)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 16;
 			s += 16;
@@ -892,7 +888,8 @@ int visual_math_vectorized_complex_to_norm (float *dest, float *real, float *ima
 				 "\n\t sqrtps %%xmm3, %%xmm2"
 				 "\n\t movntps %%xmm0, (%2)"
 				 "\n\t movntps %%xmm2, 16(%2)"
-				 :: "r" (r), "r" (i), "r" (d) : "memory");
+				 :: "r" (r), "r" (i), "r" (d)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 8;
 			i += 8;
@@ -945,14 +942,11 @@ int visual_math_vectorized_complex_to_norm_scale (float *dest, float *real, floa
 			n--;
 		}
 
-		__asm __volatile
-			("\n\t movups (%0), %%xmm7"
-			 :: "r" (packed_scaler) : "memory");
-
 		while (n > 8) {
 			__asm __volatile
 				("\n\t prefetchnta 256(%0)"
 				 "\n\t prefetchnta 256(%1)"
+				 "\n\t movups (%3), %%xmm7"
 				 "\n\t movups (%0), %%xmm0"
 				 "\n\t movups 16(%0), %%xmm2"
 				 "\n\t movups (%1), %%xmm1"
@@ -969,7 +963,8 @@ int visual_math_vectorized_complex_to_norm_scale (float *dest, float *real, floa
 				 "\n\t mulps %%xmm7, %%xmm2"
 				 "\n\t movntps %%xmm0, (%2)"
 				 "\n\t movntps %%xmm2, 16(%2)"
-				 :: "r" (r), "r" (i), "r" (d) : "memory");
+				 :: "r" (r), "r" (i), "r" (d), "r" (packed_scaler)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 
 			d += 8;
 			i += 8;
@@ -21,18 +21,109 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include "config.h"
 #include "lv_mem.h"
 #include "lv_common.h"
 #include "lv_cpu.h"
+#include "lv_atomic.h"
+#include "lv_thread.h"
+#include "private/lv_mem_pool.h"
 #include <string.h>
 #include <stdlib.h>
 #include <gettext.h>
 
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * With the C library malloc and without statistics every call goes straight to
+ * malloc, so memory may be mixed with the C library. Otherwise every block starts
+ * with a MemHeader that remembers the size for the allocator and the statistics.
+ * Which of the two is used is fixed by the first allocation.
+ */
+
+#define MEM_HEADER_SIZE		16
+#define MEM_HEADER_MAGIC	0x4c564d48
+
+typedef struct {
+	visual_size_t	 size;		/* Bytes taken from the allocator, header included */
+	uint16_t	 tag;
+	uint16_t	 offset;	/* From the start of the block to the memory handed out */
+	uint32_t	 magic;
+} MemHeader;
+
+typedef struct {
+	volatile int	 lock;
+	VisMemStats	 stats;
+	uint64_t	 frameallocs;	/* Of the frame that runs now */
+	uint64_t	 framebytes;
+} MemTagStats;
+
+#if defined(__GNUC__)
+#define MEM_THREAD_LOCAL	__thread
+#elif defined(_MSC_VER)
+#define MEM_THREAD_LOCAL	__declspec(thread)
+#else
+#define MEM_THREAD_LOCAL
+#endif
+
+static const char *__lv_mem_tag_names[] = {
+	[VISUAL_MEM_TAG_GENERAL]	= "general",
+	[VISUAL_MEM_TAG_VIDEO]		= "video",
+	[VISUAL_MEM_TAG_AUDIO]		= "audio",
+	[VISUAL_MEM_TAG_PLUGIN]		= "plugin",
+	[VISUAL_MEM_TAG_INPUT]		= "input",
+	[VISUAL_MEM_TAG_ACTOR]		= "actor",
+	[VISUAL_MEM_TAG_MORPH]		= "morph"
+};
+
+static const VisMemAllocator __lv_mem_slab_allocator = {
+	visual_mem_pool_slab_alloc,
+	visual_mem_pool_slab_free,
+	NULL
+};
+
+/* Without posix_memalign, aligned blocks are over-allocated and offset, which takes
+ * the header to find the block again when they are freed */
+#ifdef HAVE_POSIX_MEMALIGN
+#define MEM_HEADERS_REQUIRED	FALSE
+#else
+#define MEM_HEADERS_REQUIRED	TRUE
+#endif
+
+static const VisMemAllocator *__lv_mem_allocator = NULL;
+static int __lv_mem_headers = MEM_HEADERS_REQUIRED;
+static int __lv_mem_stats_enabled = FALSE;
+static int __lv_mem_in_use = FALSE;
+
+static MemTagStats __lv_mem_stats[VISUAL_MEM_TAG_LAST];
+static MEM_THREAD_LOCAL int __lv_mem_tag = VISUAL_MEM_TAG_GENERAL;
+
+static void *mem_alloc (visual_size_t nbytes, int alignment);
+static void mem_stats_lock (MemTagStats *tagstats);
+static void mem_stats_unlock (MemTagStats *tagstats);
+static void mem_stats_add (int tag, visual_size_t nbytes);
+static void mem_stats_remove (int tag, visual_size_t nbytes);
+
+
+/*
+ * The C library memcpy and memset are tuned for the machine and win over anything
+ * here at every size, with or without streaming stores. Sets of 16 and 32 bits
+ * values have no C library counterpart and are vectorized from MEM_SIMD_MIN bytes
+ * on, below that the call overhead dominates.
+ *
+ * Streaming stores were measured with mem_bench up to 64MB. The C library already
+ * streams large copies and sets, and streaming 16 and 32 bits sets did not beat the
+ * regular vector stores at any size.
+ */
+#define MEM_SIMD_MIN		256
 
 /* Standard C fallbacks */
-static void *mem_copy_c (void *dest, const void *src, visual_size_t n);
-static void *mem_set8_c (void *dest, int c, visual_size_t n);
+static void *mem_copy_libc (void *dest, const void *src, visual_size_t n);
+static void *mem_set8_libc (void *dest, int c, visual_size_t n);
 static void *mem_set16_c (void *dest, int c, visual_size_t n);
 static void *mem_set32_c (void *dest, int c, visual_size_t n);
 
@@ -40,25 +131,27 @@ static void *mem_set32_c (void *dest, int c, visual_size_t n);
 
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
-static void *mem_copy_3dnow (void *dest, const void *src, visual_size_t n);
-static void *mem_copy_mmx (void *dest, const void *src, visual_size_t n);
-static void *mem_copy_mmx2 (void *dest, const void *src, visual_size_t n);
+static void *mem_set16_sse2 (void *dest, int c, visual_size_t n);
+static void *mem_set32_sse2 (void *dest, int c, visual_size_t n);
+
+static void *mem_set16_avx2 (void *dest, int c, visual_size_t n);
+static void *mem_set32_avx2 (void *dest, int c, visual_size_t n);
 
-static void *mem_set8_mmx (void *dest, int c, visual_size_t n);
-static void *mem_set8_mmx2 (void *dest, int c, visual_size_t n);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
 
-static void *mem_set16_mmx (void *dest, int c, visual_size_t n);
-static void *mem_set16_mmx2 (void *dest, int c, visual_size_t n);
+/* ARM SIMD optimized versions */
 
-static void *mem_set32_mmx (void *dest, int c, visual_size_t n);
-static void *mem_set32_mmx2 (void *dest, int c, visual_size_t n);
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
 
-#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+static void *mem_set16_neon (void *dest, int c, visual_size_t n);
+static void *mem_set32_neon (void *dest, int c, visual_size_t n);
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
 
 /* Optimal performance functions set by visual_mem_initialize(). */
 
-VisMemCopyFunc visual_mem_copy = mem_copy_c;
-VisMemSet8Func visual_mem_set = mem_set8_c;
+VisMemCopyFunc visual_mem_copy = mem_copy_libc;
+VisMemSet8Func visual_mem_set = mem_set8_libc;
 VisMemSet16Func visual_mem_set16 = mem_set16_c;
 VisMemSet32Func visual_mem_set32 = mem_set32_c;
 
@@ -67,439 +160,356 @@ int visual_mem_initialize ()
 	/* Arranged from slow to fast, so the slower version gets overloaded
 	 * every time */
 
-	visual_mem_copy = mem_copy_c;
-	visual_mem_set = mem_set8_c;
+	visual_mem_copy = mem_copy_libc;
+	visual_mem_set = mem_set8_libc;
 	visual_mem_set16 = mem_set16_c;
 	visual_mem_set32 = mem_set32_c;
 
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
-	if (visual_cpu_get_mmx () > 0) {
-		visual_mem_copy = mem_copy_mmx;
-		visual_mem_set = mem_set8_mmx;
-		visual_mem_set16 = mem_set16_mmx;
-		visual_mem_set32 = mem_set32_mmx;
+	if (visual_cpu_get_sse2 () > 0) {
+		visual_mem_set16 = mem_set16_sse2;
+		visual_mem_set32 = mem_set32_sse2;
 	}
 
-	/* The k6-II and k6-III don't have mmx2, but of course can use the prefetch
-	 * facility that 3dnow provides. */
-	if (visual_cpu_get_3dnow () > 0) {
-		visual_mem_copy = mem_copy_3dnow;
+	if (visual_cpu_get_avx2 () > 0) {
+		visual_mem_set16 = mem_set16_avx2;
+		visual_mem_set32 = mem_set32_avx2;
 	}
 
-	if (visual_cpu_get_mmx2 () > 0) {
-		visual_mem_copy = mem_copy_mmx2;
-		visual_mem_set = mem_set8_mmx2;
-		visual_mem_set16 = mem_set16_mmx2;
-		visual_mem_set32 = mem_set32_mmx2;
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+	if (visual_cpu_get_neon () > 0) {
+		visual_mem_set16 = mem_set16_neon;
+		visual_mem_set32 = mem_set32_neon;
 	}
 
-#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+#endif
 
 	return VISUAL_OK;
 }
 
-void *visual_mem_malloc (visual_size_t nbytes)
+static void mem_stats_lock (MemTagStats *tagstats)
 {
-	void *buf;
+	while (visual_atomic_int_compare_and_exchange (&tagstats->lock, FALSE, TRUE) == FALSE)
+		visual_thread_yield ();
+}
 
-	visual_return_val_if_fail (nbytes > 0, NULL);
+static void mem_stats_unlock (MemTagStats *tagstats)
+{
+	visual_atomic_int_set (&tagstats->lock, FALSE);
+}
 
-	buf = malloc (nbytes);
+static void mem_stats_add (int tag, visual_size_t nbytes)
+{
+	MemTagStats *tagstats = &__lv_mem_stats[tag];
 
-	if (buf == NULL) {
-		visual_log (VISUAL_LOG_ERROR, _("Cannot get %" VISUAL_SIZE_T_FORMAT " bytes of memory"), nbytes);
+	mem_stats_lock (tagstats);
 
-		return NULL;
-	}
+	tagstats->stats.allocs++;
+	tagstats->stats.bytes += nbytes;
 
-	return buf;
+	if (tagstats->stats.bytes > tagstats->stats.peak)
+		tagstats->stats.peak = tagstats->stats.bytes;
+
+	tagstats->frameallocs++;
+	tagstats->framebytes += nbytes;
+
+	mem_stats_unlock (tagstats);
 }
 
-void *visual_mem_malloc0 (visual_size_t nbytes)
+static void mem_stats_remove (int tag, visual_size_t nbytes)
 {
-	void *buf;
+	MemTagStats *tagstats = &__lv_mem_stats[tag];
 
-	visual_return_val_if_fail (nbytes > 0, NULL);
+	mem_stats_lock (tagstats);
 
-	buf = visual_mem_malloc (nbytes);
-
-	visual_mem_set (buf, 0, nbytes);
+	tagstats->stats.frees++;
+	tagstats->stats.bytes -= nbytes;
 
-	return buf;
+	mem_stats_unlock (tagstats);
 }
 
-void *visual_mem_realloc (void *ptr, visual_size_t nbytes)
+static void *mem_alloc (visual_size_t nbytes, int alignment)
 {
-	return realloc (ptr, nbytes);
-}
+	MemHeader *header;
+	uint8_t *block;
+	uint8_t *ptr;
+	visual_size_t size;
 
-int visual_mem_free (void *ptr)
-{
-	/* FIXME remove eventually, we keep it for now for explicit debug */
-	visual_return_val_if_fail (ptr != NULL, -VISUAL_ERROR_MEM_NULL);
+	if (__lv_mem_in_use == FALSE)
+		__lv_mem_in_use = TRUE;
 
-	free (ptr);
+	if (__lv_mem_headers == FALSE) {
+		if (alignment <= MEM_HEADER_SIZE)
+			return malloc (nbytes);
 
-	return VISUAL_OK;
-}
+#ifdef HAVE_POSIX_MEMALIGN
+		if (posix_memalign ((void **) &ptr, alignment, nbytes) != 0)
+			return NULL;
 
+		return ptr;
+#endif
+	}
 
-static void *mem_copy_c (void *dest, const void *src, visual_size_t n)
-{
-	uint32_t *d = dest;
-	const uint32_t *s = src;
-	uint8_t *dc = dest;
-	const uint8_t *sc = src;
+	/* The allocator aligns to 16 bytes, larger alignments need some slack */
+	size = nbytes + MEM_HEADER_SIZE;
 
-	while (n >= 4) {
-		*d++ = *s++;
-		n -= 4;
-	}
+	if (alignment > MEM_HEADER_SIZE)
+		size += alignment - MEM_HEADER_SIZE;
 
-	dc = (uint8_t *) d;
-	sc = (const uint8_t *) s;
+	if (__lv_mem_allocator != NULL)
+		block = __lv_mem_allocator->alloc (size, __lv_mem_allocator->priv);
+	else
+		block = malloc (size);
 
-	while (n--)
-		*dc++ = *sc++;
+	if (block == NULL)
+		return NULL;
 
-	return dest;
+	ptr = block + MEM_HEADER_SIZE;
+
+	if (alignment > MEM_HEADER_SIZE)
+		ptr = (uint8_t *) (((uintptr_t) ptr + alignment - 1) & ~((uintptr_t) alignment - 1));
+
+	header = (MemHeader *) (ptr - MEM_HEADER_SIZE);
+	header->size = size;
+	header->tag = __lv_mem_tag;
+	header->offset = ptr - block;
+	header->magic = MEM_HEADER_MAGIC;
+
+	if (__lv_mem_stats_enabled == TRUE)
+		mem_stats_add (header->tag, size);
+
+	return ptr;
 }
 
-/* Memset functions, 1 byte memset */
-static void *mem_set8_c (void *dest, int c, visual_size_t n)
+void *visual_mem_malloc (visual_size_t nbytes)
 {
-	uint32_t *d = dest;
-	uint8_t *dc = dest;
-	uint32_t setflag32 =
-		(c & 0xff) |
-		((c << 8) & 0xff00) |
-		((c << 16) & 0xff0000) |
-		((c << 24) & 0xff000000);
-	uint8_t setflag8 = c & 0xff;
+	void *buf;
 
-	while (n >= 4) {
-		*d++ = setflag32;
-		n -= 4;
-	}
+	visual_return_val_if_fail (nbytes > 0, NULL);
 
-	dc = (uint8_t *) d;
+	buf = mem_alloc (nbytes, 0);
 
-	while (n--)
-		*dc++ = setflag8;
+	if (buf == NULL) {
+		visual_log (VISUAL_LOG_ERROR, _("Cannot get %" VISUAL_SIZE_T_FORMAT " bytes of memory"), nbytes);
 
-	return dest;
+		return NULL;
+	}
+
+	return buf;
 }
 
-/* Memset functions, 2 byte memset */
-static void *mem_set16_c (void *dest, int c, visual_size_t n)
+void *visual_mem_malloc0 (visual_size_t nbytes)
 {
-	uint32_t *d = dest;
-	uint16_t *dc = dest;
-	uint32_t setflag32 =
-		(c & 0xffff) |
-		((c << 16) & 0xffff0000);
-	uint16_t setflag16 = c & 0xffff;
+	void *buf;
 
-	while (n >= 2) {
-		*d++ = setflag32;
-		n -= 2;
-	}
+	visual_return_val_if_fail (nbytes > 0, NULL);
 
-	dc = (uint16_t *) d;
+	buf = visual_mem_malloc (nbytes);
 
-	while (n--)
-		*dc++ = setflag16;
+	visual_mem_set (buf, 0, nbytes);
 
-	return dest;
+	return buf;
 }
 
-/* Memset functions, 4 byte memset */
-static void *mem_set32_c (void *dest, int c, visual_size_t n)
+void *visual_mem_malloc_aligned (visual_size_t nbytes, int alignment)
 {
-	uint32_t *d = dest;
-	uint32_t setflag32 = c;
+	void *buf;
 
-	while (n--)
-		*d++ = setflag32;
+	visual_return_val_if_fail (nbytes > 0, NULL);
+	visual_return_val_if_fail (alignment > 0 && alignment <= 4096, NULL);
+	visual_return_val_if_fail ((alignment & (alignment - 1)) == 0, NULL);
 
-	return dest;
-}
+	buf = mem_alloc (nbytes, alignment);
 
+	if (buf == NULL) {
+		visual_log (VISUAL_LOG_ERROR, _("Cannot get %" VISUAL_SIZE_T_FORMAT " bytes of memory"), nbytes);
 
-#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+		return NULL;
+	}
+
+	return buf;
+}
 
-static void *mem_copy_mmx (void *dest, const void *src, visual_size_t n)
+void *visual_mem_realloc (void *ptr, visual_size_t nbytes)
 {
-	uint32_t *d = dest;
-	const uint32_t *s = src;
-	uint8_t *dc = dest;
-	const uint8_t *sc = src;
+	MemHeader *header;
+	visual_size_t oldbytes;
+	void *buf;
 
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t movq (%0), %%mm0"
-			 "\n\t movq 8(%0), %%mm1"
-			 "\n\t movq 16(%0), %%mm2"
-			 "\n\t movq 24(%0), %%mm3"
-			 "\n\t movq 32(%0), %%mm4"
-			 "\n\t movq 40(%0), %%mm5"
-			 "\n\t movq 48(%0), %%mm6"
-			 "\n\t movq 56(%0), %%mm7"
-			 "\n\t movq %%mm0, (%1)"
-			 "\n\t movq %%mm1, 8(%1)"
-			 "\n\t movq %%mm2, 16(%1)"
-			 "\n\t movq %%mm3, 24(%1)"
-			 "\n\t movq %%mm4, 32(%1)"
-			 "\n\t movq %%mm5, 40(%1)"
-			 "\n\t movq %%mm6, 48(%1)"
-			 "\n\t movq %%mm7, 56(%1)"
-			 :: "r" (s), "r" (d) : "memory");
+	if (__lv_mem_headers == FALSE)
+		return realloc (ptr, nbytes);
 
-		d += 16;
-		s += 16;
+	if (ptr == NULL)
+		return mem_alloc (nbytes, 0);
 
-		n -= 64;
-	}
+	buf = mem_alloc (nbytes, 0);
+
+	if (buf == NULL)
+		return NULL;
 
-	__asm __volatile
-		("\n\t emms");
+	header = (MemHeader *) ((uint8_t *) ptr - MEM_HEADER_SIZE);
 
-	while (n >= 4) {
-		*d++ = *s++;
-		n -= 4;
-	}
+	/* Possibly a bit more than was asked for, but all within the old block */
+	oldbytes = header->size - header->offset;
 
-	dc = (uint8_t *) d;
-	sc = (const uint8_t *) s;
+	visual_mem_copy (buf, ptr, oldbytes < nbytes ? oldbytes : nbytes);
 
-	while (n--)
-		*dc++ = *sc++;
+	visual_mem_free (ptr);
 
-	return dest;
+	return buf;
 }
 
-static void *mem_copy_mmx2 (void *dest, const void *src, visual_size_t n)
+int visual_mem_free (void *ptr)
 {
-	uint32_t *d = dest;
-	const uint32_t *s = src;
-	uint8_t *dc = dest;
-	const uint8_t *sc = src;
+	MemHeader *header;
+	uint8_t *block;
+	visual_size_t size;
 
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t prefetchnta 256(%0)"
-			 "\n\t prefetchnta 320(%0)"
-			 "\n\t movq (%0), %%mm0"
-			 "\n\t movq 8(%0), %%mm1"
-			 "\n\t movq 16(%0), %%mm2"
-			 "\n\t movq 24(%0), %%mm3"
-			 "\n\t movq 32(%0), %%mm4"
-			 "\n\t movq 40(%0), %%mm5"
-			 "\n\t movq 48(%0), %%mm6"
-			 "\n\t movq 56(%0), %%mm7"
-			 "\n\t movntq %%mm0, (%1)"
-			 "\n\t movntq %%mm1, 8(%1)"
-			 "\n\t movntq %%mm2, 16(%1)"
-			 "\n\t movntq %%mm3, 24(%1)"
-			 "\n\t movntq %%mm4, 32(%1)"
-			 "\n\t movntq %%mm5, 40(%1)"
-			 "\n\t movntq %%mm6, 48(%1)"
-			 "\n\t movntq %%mm7, 56(%1)"
-			 :: "r" (s), "r" (d) : "memory");
+	/* FIXME remove eventually, we keep it for now for explicit debug */
+	visual_return_val_if_fail (ptr != NULL, -VISUAL_ERROR_MEM_NULL);
 
-		d += 16;
-		s += 16;
+	if (__lv_mem_headers == FALSE) {
+		free (ptr);
 
-		n -= 64;
+		return VISUAL_OK;
 	}
 
-	__asm __volatile
-		("\n\t emms");
+	header = (MemHeader *) ((uint8_t *) ptr - MEM_HEADER_SIZE);
+
+	if (header->magic != MEM_HEADER_MAGIC) {
+		visual_log (VISUAL_LOG_CRITICAL, _("Freeing memory that was not allocated with visual_mem_malloc"));
 
-	while (n >= 4) {
-		*d++ = *s++;
-		n -= 4;
+		return -VISUAL_ERROR_MEM_NULL;
 	}
 
-	dc = (uint8_t *) d;
-	sc = (const uint8_t *) s;
+	block = (uint8_t *) ptr - header->offset;
+	size = header->size;
 
-	while (n--)
-		*dc++ = *sc++;
+	if (__lv_mem_stats_enabled == TRUE)
+		mem_stats_remove (header->tag, size);
 
-	return dest;
+	header->magic = 0;
+
+	if (__lv_mem_allocator != NULL)
+		__lv_mem_allocator->free (block, size, __lv_mem_allocator->priv);
+	else
+		free (block);
+
+	return VISUAL_OK;
 }
 
-static void *mem_copy_3dnow (void *dest, const void *src, visual_size_t n)
+int visual_mem_set_allocator (const VisMemAllocator *allocator)
 {
-	uint32_t *d = dest;
-	const uint32_t *s = src;
-	uint8_t *dc = dest;
-	const uint8_t *sc = src;
-
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t prefetch 256(%0)"
-			 "\n\t prefetch 320(%0)"
-			 "\n\t movq (%0), %%mm0"
-			 "\n\t movq 8(%0), %%mm1"
-			 "\n\t movq 16(%0), %%mm2"
-			 "\n\t movq 24(%0), %%mm3"
-			 "\n\t movq 32(%0), %%mm4"
-			 "\n\t movq 40(%0), %%mm5"
-			 "\n\t movq 48(%0), %%mm6"
-			 "\n\t movq 56(%0), %%mm7"
-			 "\n\t movq %%mm0, (%1)"
-			 "\n\t movq %%mm1, 8(%1)"
-			 "\n\t movq %%mm2, 16(%1)"
-			 "\n\t movq %%mm3, 24(%1)"
-			 "\n\t movq %%mm4, 32(%1)"
-			 "\n\t movq %%mm5, 40(%1)"
-			 "\n\t movq %%mm6, 48(%1)"
-			 "\n\t movq %%mm7, 56(%1)"
-			 :: "r" (s), "r" (d) : "memory");
+	visual_return_val_if_fail (__lv_mem_in_use == FALSE, -VISUAL_ERROR_MEM_IN_USE);
 
-		d += 16;
-		s += 16;
+	__lv_mem_allocator = allocator;
+	__lv_mem_headers = MEM_HEADERS_REQUIRED || __lv_mem_allocator != NULL || __lv_mem_stats_enabled == TRUE;
 
-		n -= 64;
-	}
+	return VISUAL_OK;
+}
 
-	__asm __volatile
-		("\n\t emms");
+const VisMemAllocator *visual_mem_get_slab_allocator ()
+{
+	return &__lv_mem_slab_allocator;
+}
 
-	while (n >= 4) {
-		*d++ = *s++;
-		n -= 4;
-	}
+int visual_mem_set_stats_enabled (int enabled)
+{
+	visual_return_val_if_fail (__lv_mem_in_use == FALSE, -VISUAL_ERROR_MEM_IN_USE);
 
-	dc = (uint8_t *) d;
-	sc = (const uint8_t *) s;
+	__lv_mem_stats_enabled = enabled;
+	__lv_mem_headers = MEM_HEADERS_REQUIRED || __lv_mem_allocator != NULL || __lv_mem_stats_enabled == TRUE;
 
-	while (n--)
-		*dc++ = *sc++;
+	return VISUAL_OK;
+}
 
-	return dest;
+int visual_mem_get_stats_enabled ()
+{
+	return __lv_mem_stats_enabled;
 }
 
-static void *mem_set8_mmx (void *dest, int c, visual_size_t n)
+int visual_mem_get_stats (VisMemTag tag, VisMemStats *stats)
 {
-	uint32_t *d = dest;
-	uint8_t *dc = dest;
-	uint32_t setflag32 =
-		(c & 0xff) |
-		((c << 8) & 0xff00) |
-		((c << 16) & 0xff0000) |
-		((c << 24) & 0xff000000);
-	uint8_t setflag8 = c & 0xff;
-
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
+	MemTagStats *tagstats;
 
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t movq %%mm0, (%0)"
-			 "\n\t movq %%mm1, 8(%0)"
-			 "\n\t movq %%mm2, 16(%0)"
-			 "\n\t movq %%mm3, 24(%0)"
-			 "\n\t movq %%mm4, 32(%0)"
-			 "\n\t movq %%mm5, 40(%0)"
-			 "\n\t movq %%mm6, 48(%0)"
-			 "\n\t movq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
+	visual_return_val_if_fail (tag >= 0 && tag < VISUAL_MEM_TAG_LAST, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (stats != NULL, -VISUAL_ERROR_NULL);
 
-		d += 16;
+	tagstats = &__lv_mem_stats[tag];
 
-		n -= 64;
-	}
+	mem_stats_lock (tagstats);
+	*stats = tagstats->stats;
+	mem_stats_unlock (tagstats);
 
-	__asm __volatile
-		("\n\t emms");
+	return VISUAL_OK;
+}
 
-	while (n >= 4) {
-		*d++ = setflag32;
-		n -= 4;
-	}
+const char *visual_mem_tag_to_string (VisMemTag tag)
+{
+	visual_return_val_if_fail (tag >= 0 && tag < VISUAL_MEM_TAG_LAST, NULL);
 
-	dc = (uint8_t *) d;
+	return __lv_mem_tag_names[tag];
+}
 
-	while (n--)
-		*dc++ = setflag8;
+VisMemTag visual_mem_set_tag (VisMemTag tag)
+{
+	VisMemTag old = __lv_mem_tag;
 
-	return dest;
+	__lv_mem_tag = tag;
+
+	return old;
 }
 
-static void *mem_set8_mmx2 (void *dest, int c, visual_size_t n)
+void visual_mem_frame_begin ()
 {
-	uint32_t *d = dest;
-	uint8_t *dc = dest;
-	uint32_t setflag32 =
-		(c & 0xff) |
-		((c << 8) & 0xff00) |
-		((c << 16) & 0xff0000) |
-		((c << 24) & 0xff000000);
-	uint8_t setflag8 = c & 0xff;
-
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
+	visual_mem_pool_frame_begin ();
+}
 
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t movntq %%mm0, (%0)"
-			 "\n\t movntq %%mm1, 8(%0)"
-			 "\n\t movntq %%mm2, 16(%0)"
-			 "\n\t movntq %%mm3, 24(%0)"
-			 "\n\t movntq %%mm4, 32(%0)"
-			 "\n\t movntq %%mm5, 40(%0)"
-			 "\n\t movntq %%mm6, 48(%0)"
-			 "\n\t movntq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
+void visual_mem_frame_end ()
+{
+	MemTagStats *tagstats;
+	int i;
 
-		d += 16;
+	if (visual_mem_pool_frame_end () == FALSE || __lv_mem_stats_enabled == FALSE)
+		return;
 
-		n -= 64;
-	}
+	for (i = 0; i < VISUAL_MEM_TAG_LAST; i++) {
+		tagstats = &__lv_mem_stats[i];
 
-	__asm __volatile
-		("\n\t emms");
+		mem_stats_lock (tagstats);
 
-	while (n >= 4) {
-		*d++ = setflag32;
-		n -= 4;
+		tagstats->stats.frameallocs = tagstats->frameallocs;
+		tagstats->stats.framebytes = tagstats->framebytes;
+		tagstats->frameallocs = 0;
+		tagstats->framebytes = 0;
+
+		mem_stats_unlock (tagstats);
 	}
+}
 
-	dc = (uint8_t *) d;
+void *visual_mem_frame_malloc (visual_size_t nbytes)
+{
+	visual_return_val_if_fail (nbytes > 0, NULL);
 
-	while (n--)
-		*dc++ = setflag8;
+	return visual_mem_pool_frame_malloc (nbytes);
+}
 
-	return dest;
+
+static void *mem_copy_libc (void *dest, const void *src, visual_size_t n)
+{
+	return memcpy (dest, src, n);
 }
 
-static void *mem_set16_mmx (void *dest, int c, visual_size_t n)
+/* Memset functions, 1 byte memset */
+static void *mem_set8_libc (void *dest, int c, visual_size_t n)
+{
+	return memset (dest, c, n);
+}
+
+/* Memset functions, 2 byte memset */
+static void *mem_set16_c (void *dest, int c, visual_size_t n)
 {
 	uint32_t *d = dest;
 	uint16_t *dc = dest;
@@ -508,40 +518,6 @@ static void *mem_set16_mmx (void *dest, int c, visual_size_t n)
 		((c << 16) & 0xffff0000);
 	uint16_t setflag16 = c & 0xffff;
 
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
-
-	while (n >= 64) {
-		__asm __volatile
-			("\n\t movq %%mm0, (%0)"
-			 "\n\t movq %%mm1, 8(%0)"
-			 "\n\t movq %%mm2, 16(%0)"
-			 "\n\t movq %%mm3, 24(%0)"
-			 "\n\t movq %%mm4, 32(%0)"
-			 "\n\t movq %%mm5, 40(%0)"
-			 "\n\t movq %%mm6, 48(%0)"
-			 "\n\t movq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
-
-		d += 16;
-
-		n -= 32;
-	}
-
-	__asm __volatile
-		("\n\t emms");
-
 	while (n >= 2) {
 		*d++ = setflag32;
 		n -= 2;
@@ -555,150 +531,185 @@ static void *mem_set16_mmx (void *dest, int c, visual_size_t n)
 	return dest;
 }
 
-static void *mem_set16_mmx2 (void *dest, int c, visual_size_t n)
+/* Memset functions, 4 byte memset */
+static void *mem_set32_c (void *dest, int c, visual_size_t n)
 {
 	uint32_t *d = dest;
-	uint16_t *dc = dest;
-	uint32_t setflag32 =
-		(c & 0xffff) |
-		((c << 16) & 0xffff0000);
-	uint16_t setflag16 = c & 0xffff;
+	uint32_t setflag32 = c;
 
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
-
-	while (n >= 32) {
-		__asm __volatile
-			("\n\t movntq %%mm0, (%0)"
-			 "\n\t movntq %%mm1, 8(%0)"
-			 "\n\t movntq %%mm2, 16(%0)"
-			 "\n\t movntq %%mm3, 24(%0)"
-			 "\n\t movntq %%mm4, 32(%0)"
-			 "\n\t movntq %%mm5, 40(%0)"
-			 "\n\t movntq %%mm6, 48(%0)"
-			 "\n\t movntq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
+	while (n--)
+		*d++ = setflag32;
 
-		d += 16;
+	return dest;
+}
+
+/*
+ * The vector versions set n bytes with a 32 bits pattern, n is at least MEM_SIMD_MIN.
+ * The tail is done with one store that overlaps what is already set, which keeps
+ * the pattern in phase as n is a multiple of the size of the values.
+ */
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
-		n -= 32;
+static void mem_set_sse2 (uint8_t *d, uint32_t pattern, visual_size_t n)
+{
+	uint8_t *end = d + n;
+
+	while (n >= 64) {
+		__asm __volatile
+			("\n\t movd %[p], %%xmm0"
+			 "\n\t pshufd $0, %%xmm0, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm0, 16(%[d])"
+			 "\n\t movdqu %%xmm0, 32(%[d])"
+			 "\n\t movdqu %%xmm0, 48(%[d])"
+			 :: [d] "r" (d), [p] "r" (pattern)
+			 : "memory", "xmm0");
+
+		d += 64;
+		n -= 64;
 	}
 
-	__asm __volatile
-		("\n\t emms");
+	while (n > 0) {
+		if (n < 16)
+			d = end - 16;
 
-	while (n >= 2) {
-		*d++ = setflag32;
-		n -= 2;
+		__asm __volatile
+			("\n\t movd %[p], %%xmm0"
+			 "\n\t pshufd $0, %%xmm0, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (d), [p] "r" (pattern)
+			 : "memory", "xmm0");
+
+		d += 16;
+		n = n < 16 ? 0 : n - 16;
 	}
+}
 
-	dc = (uint16_t *) d;
+static void *mem_set16_sse2 (void *dest, int c, visual_size_t n)
+{
+	if (n * 2 < MEM_SIMD_MIN)
+		return mem_set16_c (dest, c, n);
 
-	while (n--)
-		*dc++ = setflag16;
+	mem_set_sse2 (dest, (c & 0xffff) * 0x00010001, n * 2);
 
 	return dest;
 }
 
-static void *mem_set32_mmx (void *dest, int c, visual_size_t n)
+static void *mem_set32_sse2 (void *dest, int c, visual_size_t n)
 {
-	uint32_t *d = dest;
-	uint32_t setflag32 = c;
+	if (n * 4 < MEM_SIMD_MIN)
+		return mem_set32_c (dest, c, n);
 
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
+	mem_set_sse2 (dest, c, n * 4);
 
-	while (n >= 64) {
+	return dest;
+}
+
+static void mem_set_avx2 (uint8_t *d, uint32_t pattern, visual_size_t n)
+{
+	uint8_t *end = d + n;
+
+	while (n >= 128) {
 		__asm __volatile
-			("\n\t movq %%mm0, (%0)"
-			 "\n\t movq %%mm1, 8(%0)"
-			 "\n\t movq %%mm2, 16(%0)"
-			 "\n\t movq %%mm3, 24(%0)"
-			 "\n\t movq %%mm4, 32(%0)"
-			 "\n\t movq %%mm5, 40(%0)"
-			 "\n\t movq %%mm6, 48(%0)"
-			 "\n\t movq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
+			("\n\t vbroadcastss (%[p]), %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 "\n\t vmovdqu %%ymm0, 32(%[d])"
+			 "\n\t vmovdqu %%ymm0, 64(%[d])"
+			 "\n\t vmovdqu %%ymm0, 96(%[d])"
+			 :: [d] "r" (d), [p] "r" (&pattern)
+			 : "memory", "xmm0");
+
+		d += 128;
+		n -= 128;
+	}
 
-		d += 16;
+	while (n > 0) {
+		if (n < 32)
+			d = end - 32;
 
-		n -= 16;
+		__asm __volatile
+			("\n\t vbroadcastss (%[p]), %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (d), [p] "r" (&pattern)
+			 : "memory", "xmm0");
+
+		d += 32;
+		n = n < 32 ? 0 : n - 32;
 	}
 
-	__asm __volatile
-		("\n\t emms");
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+}
 
-	while (n--)
-		*d++ = setflag32;
+static void *mem_set16_avx2 (void *dest, int c, visual_size_t n)
+{
+	if (n * 2 < MEM_SIMD_MIN)
+		return mem_set16_c (dest, c, n);
+
+	mem_set_avx2 (dest, (c & 0xffff) * 0x00010001, n * 2);
 
 	return dest;
 }
 
-static void *mem_set32_mmx2 (void *dest, int c, visual_size_t n)
+static void *mem_set32_avx2 (void *dest, int c, visual_size_t n)
 {
-	uint32_t *d = dest;
-	uint32_t setflag32 = c;
+	if (n * 4 < MEM_SIMD_MIN)
+		return mem_set32_c (dest, c, n);
+
+	mem_set_avx2 (dest, c, n * 4);
+
+	return dest;
+}
+
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
 
-	__asm __volatile
-		("\n\t movd (%0), %%mm0"
-		 "\n\t movd (%0), %%mm1"
-		 "\n\t psllq $32, %%mm1"
-		 "\n\t por %%mm1, %%mm0"
-		 "\n\t movq %%mm0, %%mm2"
-		 "\n\t movq %%mm0, %%mm1"
-		 "\n\t movq %%mm2, %%mm3"
-		 "\n\t movq %%mm1, %%mm4"
-		 "\n\t movq %%mm0, %%mm5"
-		 "\n\t movq %%mm2, %%mm6"
-		 "\n\t movq %%mm1, %%mm7"
-		 :: "r" (&setflag32) : "memory");
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+static void mem_set_neon (uint8_t *d, uint32_t pattern, visual_size_t n)
+{
+	uint8x16_t v = vreinterpretq_u8_u32 (vdupq_n_u32 (pattern));
+	uint8_t *end = d + n;
 
 	while (n >= 64) {
-		__asm __volatile
-			("\n\t movntq %%mm0, (%0)"
-			 "\n\t movntq %%mm1, 8(%0)"
-			 "\n\t movntq %%mm2, 16(%0)"
-			 "\n\t movntq %%mm3, 24(%0)"
-			 "\n\t movntq %%mm4, 32(%0)"
-			 "\n\t movntq %%mm5, 40(%0)"
-			 "\n\t movntq %%mm6, 48(%0)"
-			 "\n\t movntq %%mm7, 56(%0)"
-			 :: "r" (d) : "memory");
+		vst1q_u8 (d, v);
+		vst1q_u8 (d + 16, v);
+		vst1q_u8 (d + 32, v);
+		vst1q_u8 (d + 48, v);
 
-		d += 16;
+		d += 64;
+		n -= 64;
+	}
+
+	while (n > 0) {
+		if (n < 16)
+			d = end - 16;
+
+		vst1q_u8 (d, v);
 
-		n -= 16;
+		d += 16;
+		n = n < 16 ? 0 : n - 16;
 	}
+}
 
-	__asm __volatile
-		("\n\t emms");
+static void *mem_set16_neon (void *dest, int c, visual_size_t n)
+{
+	if (n * 2 < MEM_SIMD_MIN)
+		return mem_set16_c (dest, c, n);
 
-	while (n--)
-		*d++ = setflag32;
+	mem_set_neon (dest, (c & 0xffff) * 0x00010001, n * 2);
 
 	return dest;
 }
 
-#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+static void *mem_set32_neon (void *dest, int c, visual_size_t n)
+{
+	if (n * 4 < MEM_SIMD_MIN)
+		return mem_set32_c (dest, c, n);
+
+	mem_set_neon (dest, c, n * 4);
+
+	return dest;
+}
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
@@ -26,6 +26,7 @@
 
 #include <libvisual/lvconfig.h>
 #include <libvisual/lv_defines.h>
+#include <libvisual/lv_types.h>
 
 /**
  * @defgroup VisMem VisMem
@@ -34,6 +35,71 @@
 
 VISUAL_BEGIN_DECLS
 
+/**
+ * Alignment that visual_mem_malloc_aligned uses for pixel and sample buffers, wide
+ * enough for the widest SIMD loads and stores.
+ */
+#define VISUAL_MEM_ALIGN_SIMD	32
+
+/**
+ * Enumerate of the subsystems that memory statistics are kept for.
+ */
+typedef enum {
+	VISUAL_MEM_TAG_GENERAL = 0,	/**< Anything that is not attributed to a subsystem. */
+	VISUAL_MEM_TAG_VIDEO,		/**< VisVideo pixel buffers. */
+	VISUAL_MEM_TAG_AUDIO,		/**< Audio samples and analysis. */
+	VISUAL_MEM_TAG_PLUGIN,		/**< Plugin loading and initialization. */
+	VISUAL_MEM_TAG_INPUT,		/**< Everything allocated while an input plugin runs. */
+	VISUAL_MEM_TAG_ACTOR,		/**< Everything allocated while an actor plugin runs. */
+	VISUAL_MEM_TAG_MORPH,		/**< Everything allocated while a morph plugin runs. */
+	VISUAL_MEM_TAG_LAST
+} VisMemTag;
+
+typedef struct _VisMemStats VisMemStats;
+typedef struct _VisMemAllocator VisMemAllocator;
+
+/**
+ * The allocation function of a VisMemAllocator needs this signature.
+ *
+ * @arg nbytes The number of bytes requested.
+ * @arg priv The private data of the VisMemAllocator.
+ *
+ * @return Pointer to the memory, aligned to at least 16 bytes, or NULL on failure.
+ */
+typedef void *(*VisMemAllocFunc)(visual_size_t nbytes, void *priv);
+
+/**
+ * The free function of a VisMemAllocator needs this signature.
+ *
+ * @arg ptr Pointer to memory that was given by the VisMemAllocFunc.
+ * @arg nbytes The number of bytes that was requested for it.
+ * @arg priv The private data of the VisMemAllocator.
+ */
+typedef void (*VisMemFreeFunc)(void *ptr, visual_size_t nbytes, void *priv);
+
+/**
+ * A VisMemAllocator is the backend behind visual_mem_malloc and visual_mem_free.
+ *
+ * @see visual_mem_set_allocator
+ */
+struct _VisMemAllocator {
+	VisMemAllocFunc	 alloc;		/**< Allocates memory. */
+	VisMemFreeFunc	 free;		/**< Frees memory given by alloc. */
+	void		*priv;		/**< Private data passed to both functions. */
+};
+
+/**
+ * Memory statistics of a subsystem, see visual_mem_get_stats.
+ */
+struct _VisMemStats {
+	uint64_t	 allocs;	/**< Number of allocations. */
+	uint64_t	 frees;		/**< Number of frees. */
+	uint64_t	 bytes;		/**< Bytes in use right now. */
+	uint64_t	 peak;		/**< The largest number of bytes that were in use at once. */
+	uint64_t	 frameallocs;	/**< Allocations made during the last frame. */
+	uint64_t	 framebytes;	/**< Bytes allocated during the last frame. */
+};
+
 /**
  * The visual_mem_copy function needs this signature.
  *
@@ -134,6 +200,106 @@ void *visual_mem_realloc (void *ptr, visual_size_t nbytes) VIS_ATTR_MALLOC;
  */
 int visual_mem_free (void *ptr);
 
+/**
+ * Allocates @a nbytes of uninitialized memory aligned to @a alignment bytes. The memory
+ * is freed with visual_mem_free. Reallocating it loses the alignment.
+ *
+ * @param nbytes N bytes of mem requested to be allocated.
+ * @param alignment The alignment, a power of two up to 4096, normally VISUAL_MEM_ALIGN_SIMD.
+ *
+ * @return On success, a pointer to a new allocated memory block, on failure NULL.
+ */
+void *visual_mem_malloc_aligned (visual_size_t nbytes, int alignment) VIS_ATTR_MALLOC;
+
+/**
+ * Replaces the allocator behind visual_mem_malloc and visual_mem_free. This is only
+ * possible before the first allocation, so before visual_init().
+ *
+ * @param allocator Pointer to the VisMemAllocator, which must stay valid, NULL for the
+ *	C library malloc.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_MEM_IN_USE when memory was allocated already.
+ */
+int visual_mem_set_allocator (const VisMemAllocator *allocator);
+
+/**
+ * Gives the built in slab allocator. Small allocations are served from size classes
+ * that are carved out of larger slabs and cached per thread, larger ones from malloc.
+ * Memory in the slabs is kept for reuse and not given back to the system.
+ *
+ * @return Pointer to the slab VisMemAllocator.
+ */
+const VisMemAllocator *visual_mem_get_slab_allocator (void);
+
+/**
+ * Enables or disables the memory statistics. Like the allocator this can only be
+ * changed before the first allocation, keeping statistics costs some speed.
+ *
+ * @param enabled TRUE to keep statistics, FALSE to not keep them.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_MEM_IN_USE when memory was allocated already.
+ */
+int visual_mem_set_stats_enabled (int enabled);
+
+/**
+ * Request if memory statistics are kept.
+ *
+ * @return TRUE if statistics are kept, FALSE if not.
+ */
+int visual_mem_get_stats_enabled (void);
+
+/**
+ * Gives the memory statistics of a subsystem.
+ *
+ * @param tag The subsystem.
+ * @param stats Pointer to a VisMemStats that is filled in.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_NULL on failure.
+ */
+int visual_mem_get_stats (VisMemTag tag, VisMemStats *stats);
+
+/**
+ * Gives the name of a subsystem, for reporting statistics.
+ *
+ * @param tag The subsystem.
+ *
+ * @return The name, or NULL for an invalid tag.
+ */
+const char *visual_mem_tag_to_string (VisMemTag tag);
+
+/**
+ * Sets the subsystem that the allocations of the calling thread are counted for.
+ *
+ * @param tag The subsystem.
+ *
+ * @return The tag that was set before, to restore it with.
+ */
+VisMemTag visual_mem_set_tag (VisMemTag tag);
+
+/**
+ * Starts a frame on the calling thread. Frames nest, the outermost frame ends the
+ * lifetime of frame memory and closes the statistics of the frame. visual_bin_run()
+ * runs every frame between a visual_mem_frame_begin and visual_mem_frame_end.
+ */
+void visual_mem_frame_begin (void);
+
+/**
+ * Ends a frame on the calling thread, see visual_mem_frame_begin.
+ */
+void visual_mem_frame_end (void);
+
+/**
+ * Allocates @a nbytes from the frame arena of the calling thread. The memory is aligned
+ * to 16 bytes and stays valid until the outermost frame ends, it is not freed by the
+ * caller. Once the arena has grown to the needs of a frame it serves later frames
+ * without allocating.
+ *
+ * @param nbytes N bytes of mem requested to be allocated.
+ *
+ * @return Pointer to the memory, or NULL when no frame is running on the calling thread.
+ */
+void *visual_mem_frame_malloc (visual_size_t nbytes);
+
 /* Optimal performance functions set by visual_mem_initialize(). */
 extern VisMemCopyFunc visual_mem_copy;
 extern VisMemSet8Func visual_mem_set;
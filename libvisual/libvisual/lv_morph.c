@@ -286,6 +286,7 @@ int visual_morph_run (VisMorph *morph, VisAudio *audio, VisVideo *src1, VisVideo
 {
 	VisMorphPlugin *morphplugin;
 	VisTime elapsed;
+	VisMemTag oldtag;
 	double usec_elapsed, usec_morph;
 
 	visual_return_val_if_fail (morph != NULL, -VISUAL_ERROR_MORPH_NULL);
@@ -306,6 +307,8 @@ int visual_morph_run (VisMorph *morph, VisAudio *audio, VisVideo *src1, VisVideo
 	if (visual_timer_is_active (&morph->timer) == FALSE)
 		visual_timer_start (&morph->timer);
 
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_MORPH);
+
 	if (morphplugin->palette != NULL)
 		morphplugin->palette (morph->plugin, morph->rate, audio, &morph->morphpal, src1, src2);
 	else {
@@ -315,6 +318,8 @@ int visual_morph_run (VisMorph *morph, VisAudio *audio, VisVideo *src1, VisVideo
 
 	morphplugin->apply (morph->plugin, morph->rate, audio, morph->dest, src1, src2);
 
+	visual_mem_set_tag (oldtag);
+
 	morph->dest->pal = visual_morph_get_palette (morph);
 
 	/* On automatic morphing increase the rate. */
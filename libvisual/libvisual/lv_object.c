@@ -24,6 +24,7 @@
 #include "config.h"
 #include "lv_object.h"
 #include "lv_common.h"
+#include "lv_atomic.h"
 
 int visual_object_collection_destroyer (void *data)
 {
@@ -122,7 +123,7 @@ int visual_object_ref (VisObject *object)
 {
 	visual_return_val_if_fail (object != NULL, -VISUAL_ERROR_OBJECT_NULL);
 
-	object->refcount++;
+	visual_atomic_int_add (&object->refcount, 1);
 
 	return VISUAL_OK;
 }
@@ -131,10 +132,8 @@ int visual_object_unref (VisObject *object)
 {
 	visual_return_val_if_fail (object != NULL, -VISUAL_ERROR_OBJECT_NULL);
 
-	object->refcount--;
-
 	/* No reference left, start dtoring of this VisObject */
-	if (object->refcount <= 0) {
+	if (visual_atomic_int_add (&object->refcount, -1) <= 0) {
 		object->refcount = 0;
 
 		return visual_object_destroy (object);
@@ -167,7 +167,8 @@ int visual_object_set_allocated (VisObject *object, int allocated);
 int visual_object_set_refcount (VisObject *object, int refcount);
 
 /**
- * Increases the reference counter for a VisObject.
+ * Increases the reference counter for a VisObject. The counter is updated atomically, references
+ * can be taken and dropped from any thread.
  *
  * @param object Pointer to a VisObject in which the reference count is increased.
  *
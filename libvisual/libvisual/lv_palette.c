@@ -24,6 +24,8 @@
 #include "config.h"
 #include "lv_palette.h"
 #include "lv_common.h"
+#include "private/lv_palette_lookup.h"
+#include <limits.h>
 
 static int palette_dtor (VisObject *object);
 
@@ -36,6 +38,8 @@ static int palette_dtor (VisObject *object)
 
 	pal->colors = NULL;
 
+	visual_palette_lookup_free (pal);
+
 	return VISUAL_OK;
 }
 
@@ -68,6 +72,7 @@ int visual_palette_init (VisPalette *pal)
 	/* Reset the VisPalette data */
 	pal->ncolors = 0;
 	pal->colors = NULL;
+	pal->lookup = NULL;
 
 	return VISUAL_OK;
 }
@@ -176,3 +181,55 @@ int visual_palette_find_color (VisPalette *pal, VisColor *color)
 	return -1;
 }
 
+int visual_palette_find_nearest_color (VisPalette *pal, VisColor *color)
+{
+	int dr, dg, db;
+	int dist, bestdist = INT_MAX;
+	int best = -1;
+	int i;
+
+	visual_return_val_if_fail (pal != NULL, -1);
+	visual_return_val_if_fail (color != NULL, -1);
+
+	for (i = 0; i < pal->ncolors; i++) {
+		dr = pal->colors[i].r - color->r;
+		dg = pal->colors[i].g - color->g;
+		db = pal->colors[i].b - color->b;
+
+		dist = dr * dr + dg * dg + db * db;
+
+		if (dist < bestdist) {
+			bestdist = dist;
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+int visual_palette_fill_color_cube (VisPalette *pal)
+{
+	int r, g, b;
+	int i = 0;
+
+	visual_return_val_if_fail (pal != NULL, -VISUAL_ERROR_PALETTE_NULL);
+
+	for (r = 0; r < 6 && i < pal->ncolors; r++) {
+		for (g = 0; g < 7 && i < pal->ncolors; g++) {
+			for (b = 0; b < 6 && i < pal->ncolors; b++) {
+				pal->colors[i].r = r * 255 / 5;
+				pal->colors[i].g = g * 255 / 6;
+				pal->colors[i].b = b * 255 / 5;
+				i++;
+			}
+		}
+	}
+
+	/* Grays between the ones the cube has */
+	for (r = 0; i < pal->ncolors; i++, r++) {
+		pal->colors[i].r = pal->colors[i].g = pal->colors[i].b =
+			((r % 4) * 2 + 1) * 255 / 8;
+	}
+
+	return VISUAL_OK;
+}
@@ -38,6 +38,7 @@ VISUAL_BEGIN_DECLS
 #define VISUAL_PALETTE(obj)				(VISUAL_CHECK_CAST ((obj), VisPalette))
 
 typedef struct _VisPalette VisPalette;
+typedef struct _VisPaletteLookup VisPaletteLookup;
 
 /**
  * Data type to describe the palette for an 8 bits screen depth.
@@ -51,6 +52,8 @@ struct _VisPalette {
 	VisObject	 object;	/**< The VisObject data. */
 	int			 ncolors;	/**< Number of color entries in palette. */
 	VisColor	*colors;	/**< Pointer to the colors. */
+	VisPaletteLookup *lookup;	/**< Private color lookup table for the conversions to 8 bits,
+					  * rebuilt when the colors change. */
 };
 
 /**
@@ -131,8 +134,38 @@ int visual_palette_blend (VisPalette *dest, VisPalette *src1, VisPalette *src2,
  */
 VisColor *visual_palette_color_cycle (VisPalette *pal, float rate);
 
+/**
+ * Looks for an exact match of a color in a VisPalette.
+ *
+ * @param pal Pointer to the VisPalette that is searched.
+ * @param color Pointer to the VisColor that is searched for.
+ *
+ * @return The index of the first matching color, -1 when there is none.
+ */
 int visual_palette_find_color (VisPalette *pal, VisColor *color);
 
+/**
+ * Looks for the color in a VisPalette that is nearest to a color, by euclidean distance in RGB.
+ *
+ * @param pal Pointer to the VisPalette that is searched.
+ * @param color Pointer to the VisColor that is searched for.
+ *
+ * @return The index of the nearest color, the lowest one when several are as near, or -1
+ *	for an empty VisPalette.
+ */
+int visual_palette_find_nearest_color (VisPalette *pal, VisColor *color);
+
+/**
+ * Fills a VisPalette with evenly spread colors, for showing truecolor video on an 8 bits
+ * display. The first 252 entries are a cube of 6 red, 7 green and 6 blue levels, the
+ * entries after that are grays.
+ *
+ * @param pal Pointer to the VisPalette that is filled.
+ *
+ * @return VISUAL_OK on succes, -VISUAL_ERROR_PALETTE_NULL on failure.
+ */
+int visual_palette_fill_color_cube (VisPalette *pal);
+
 VISUAL_END_DECLS
 
 /**
@@ -107,6 +107,8 @@ static int plugin_dtor (VisObject *object)
 
 	visual_collection_destroy (VISUAL_COLLECTION (&plugin->environment));
 
+	visual_object_destroy (VISUAL_OBJECT (&plugin->eventqueue));
+
 	plugin->ref = NULL;
 	plugin->params = NULL;
 
@@ -257,6 +259,8 @@ VisPluginData *visual_plugin_new ()
 
 	plugin->params = visual_param_container_new ();
 
+	visual_event_queue_init (&plugin->eventqueue);
+
 	return plugin;
 }
 
@@ -499,6 +503,7 @@ VisPluginData *visual_plugin_load (VisPluginRef *ref)
 	VisTime time_;
 	VisPluginInfo *pluginfo;
 	VisPluginGetInfoFunc get_plugin_info;
+	VisMemTag oldtag;
 #if defined(VISUAL_OS_WIN32)
 	HMODULE handle;
 #else /* !VISUAL_OS_WIN32 */
@@ -566,6 +571,8 @@ VisPluginData *visual_plugin_load (VisPluginRef *ref)
 		return NULL;
 	}
 
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_PLUGIN);
+
 	plugin = visual_plugin_new ();
 	plugin->ref = ref;
 	plugin->info = &pluginfo[ref->index];
@@ -580,23 +587,30 @@ VisPluginData *visual_plugin_load (VisPluginRef *ref)
 	visual_time_get (&time_);
 	visual_random_context_set_seed (&plugin->random, time_.usec);
 
+	visual_mem_set_tag (oldtag);
+
 	return plugin;
 }
 
 int visual_plugin_realize (VisPluginData *plugin)
 {
 	VisParamContainer *paramcontainer;
+	VisMemTag oldtag;
 
 	visual_return_val_if_fail (plugin != NULL, -VISUAL_ERROR_PLUGIN_NULL);
 
 	if (plugin->realized == TRUE)
 		return -VISUAL_ERROR_PLUGIN_ALREADY_REALIZED;
 
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_PLUGIN);
+
 	paramcontainer = visual_plugin_get_params (plugin);
 	visual_param_container_set_eventqueue (paramcontainer, &plugin->eventqueue);
 	plugin->info->init (plugin);
 	plugin->realized = TRUE;
 
+	visual_mem_set_tag (oldtag);
+
 	return VISUAL_OK;
 }
 
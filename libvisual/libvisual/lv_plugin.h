@@ -50,7 +50,7 @@ VISUAL_BEGIN_DECLS
 /**
  * Indicates at which version the plugin API is.
  */
-#define VISUAL_PLUGIN_API_VERSION	3004
+#define VISUAL_PLUGIN_API_VERSION	3005
 
 /**
  * Defination that should be used in plugins to set the plugin type for a NULL plugin.
@@ -53,6 +53,13 @@ typedef int (*MutexFuncLock)(VisMutex *mutex);
 typedef int (*MutexFuncTrylock)(VisMutex *mutex);
 typedef int (*MutexFuncUnlock)(VisMutex *mutex);
 
+typedef VisCond *(*CondFuncNew)(void);
+typedef int (*CondFuncFree)(VisCond *cond);
+typedef int (*CondFuncInit)(VisCond *cond);
+typedef int (*CondFuncWait)(VisCond *cond, VisMutex *mutex);
+typedef int (*CondFuncSignal)(VisCond *cond);
+typedef int (*CondFuncBroadcast)(VisCond *cond);
+
 struct _ThreadFuncs {
 	ThreadFuncCreate	thread_create;
 	ThreadFuncFree		thread_free;
@@ -66,6 +73,13 @@ struct _ThreadFuncs {
 	MutexFuncLock		mutex_lock;
 	MutexFuncTrylock	mutex_trylock;
 	MutexFuncUnlock		mutex_unlock;
+
+	CondFuncNew		cond_new;
+	CondFuncFree		cond_free;
+	CondFuncInit		cond_init;
+	CondFuncWait		cond_wait;
+	CondFuncSignal		cond_signal;
+	CondFuncBroadcast	cond_broadcast;
 };
 
 /* Internal variables */
@@ -88,6 +102,13 @@ static int mutex_init_posix (VisMutex *mutex);
 static int mutex_lock_posix (VisMutex *mutex);
 static int mutex_trylock_posix (VisMutex *mutex);
 static int mutex_unlock_posix (VisMutex *mutex);
+
+static VisCond *cond_new_posix (void);
+static int cond_free_posix (VisCond *cond);
+static int cond_init_posix (VisCond *cond);
+static int cond_wait_posix (VisCond *cond, VisMutex *mutex);
+static int cond_signal_posix (VisCond *cond);
+static int cond_broadcast_posix (VisCond *cond);
 #endif
 
 /* Windows32 implementation */
@@ -104,6 +125,13 @@ static int mutex_init_win32 (VisMutex *mutex);
 static int mutex_lock_win32 (VisMutex *mutex);
 static int mutex_trylock_win32 (VisMutex *mutex);
 static int mutex_unlock_win32 (VisMutex *mutex);
+
+static VisCond *cond_new_win32 (void);
+static int cond_free_win32 (VisCond *cond);
+static int cond_init_win32 (VisCond *cond);
+static int cond_wait_win32 (VisCond *cond, VisMutex *mutex);
+static int cond_signal_win32 (VisCond *cond);
+static int cond_broadcast_win32 (VisCond *cond);
 #endif
 
 /* GThread implementation */
@@ -120,12 +148,17 @@ static int mutex_init_gthread (VisMutex *mutex);
 static int mutex_lock_gthread (VisMutex *mutex);
 static int mutex_trylock_gthread (VisMutex *mutex);
 static int mutex_unlock_gthread (VisMutex *mutex);
+
+static VisCond *cond_new_gthread (void);
+static int cond_free_gthread (VisCond *cond);
+static int cond_init_gthread (VisCond *cond);
+static int cond_wait_gthread (VisCond *cond, VisMutex *mutex);
+static int cond_signal_gthread (VisCond *cond);
+static int cond_broadcast_gthread (VisCond *cond);
 #endif
 
 int visual_thread_initialize ()
 {
-	__lv_thread_initialized = TRUE;
-
 #ifdef VISUAL_HAVE_THREADS
 
 #ifdef VISUAL_THREAD_MODEL_POSIX
@@ -144,6 +177,15 @@ int visual_thread_initialize ()
 	__lv_thread_funcs.mutex_trylock = mutex_trylock_posix;
 	__lv_thread_funcs.mutex_unlock = mutex_unlock_posix;
 
+	__lv_thread_funcs.cond_new = cond_new_posix;
+	__lv_thread_funcs.cond_free = cond_free_posix;
+	__lv_thread_funcs.cond_init = cond_init_posix;
+	__lv_thread_funcs.cond_wait = cond_wait_posix;
+	__lv_thread_funcs.cond_signal = cond_signal_posix;
+	__lv_thread_funcs.cond_broadcast = cond_broadcast_posix;
+
+	__lv_thread_initialized = TRUE;
+
 	return TRUE;
 #elif defined(VISUAL_THREAD_MODEL_WIN32) /* !VISUAL_THREAD_MODEL_POSIX */
 	__lv_thread_supported = TRUE;
@@ -161,6 +203,15 @@ int visual_thread_initialize ()
 	__lv_thread_funcs.mutex_trylock = mutex_trylock_win32;
 	__lv_thread_funcs.mutex_unlock = mutex_unlock_win32;
 
+	__lv_thread_funcs.cond_new = cond_new_win32;
+	__lv_thread_funcs.cond_free = cond_free_win32;
+	__lv_thread_funcs.cond_init = cond_init_win32;
+	__lv_thread_funcs.cond_wait = cond_wait_win32;
+	__lv_thread_funcs.cond_signal = cond_signal_win32;
+	__lv_thread_funcs.cond_broadcast = cond_broadcast_win32;
+
+	__lv_thread_initialized = TRUE;
+
 	return TRUE;
 #elif defined(VISUAL_THREAD_MODEL_GTHREAD2) /* !VISUAL_THREAD_MODEL_WIN32 */
 	__lv_thread_supported = TRUE;
@@ -178,11 +229,24 @@ int visual_thread_initialize ()
 	__lv_thread_funcs.mutex_trylock = mutex_trylock_gthread;
 	__lv_thread_funcs.mutex_unlock = mutex_unlock_gthread;
 
+	__lv_thread_funcs.cond_new = cond_new_gthread;
+	__lv_thread_funcs.cond_free = cond_free_gthread;
+	__lv_thread_funcs.cond_init = cond_init_gthread;
+	__lv_thread_funcs.cond_wait = cond_wait_gthread;
+	__lv_thread_funcs.cond_signal = cond_signal_gthread;
+	__lv_thread_funcs.cond_broadcast = cond_broadcast_gthread;
+
+	__lv_thread_initialized = TRUE;
+
 	return TRUE;
 #else /* !VISUAL_THREAD_MODEL_GTHREAD2 */
+	__lv_thread_initialized = TRUE;
+
 	return FALSE;
 #endif
 #else
+	__lv_thread_initialized = TRUE;
+
 	return FALSE;
 #endif /* VISUAL_HAVE_THREADS */
 
@@ -324,6 +388,73 @@ int visual_mutex_unlock (VisMutex *mutex)
 	return __lv_thread_funcs.mutex_unlock (mutex);
 }
 
+VisCond *visual_cond_new ()
+{
+	visual_return_val_if_fail (visual_thread_is_initialized () != FALSE, NULL);
+	visual_return_val_if_fail (visual_thread_is_supported () != FALSE, NULL);
+	visual_return_val_if_fail (visual_thread_is_enabled () != FALSE, NULL);
+
+	return __lv_thread_funcs.cond_new ();
+}
+
+int visual_cond_free (VisCond *cond)
+{
+	visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+	if (visual_thread_is_supported () == FALSE) {
+		visual_log (VISUAL_LOG_WARNING, _("Tried freeing cond memory while threading is not supported, simply freeing mem"));
+
+		return visual_mem_free (cond);
+	}
+
+	return __lv_thread_funcs.cond_free (cond);
+}
+
+int visual_cond_init (VisCond *cond)
+{
+	visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+	visual_return_val_if_fail (visual_thread_is_initialized () != FALSE, -VISUAL_ERROR_THREAD_NOT_INITIALIZED);
+	visual_return_val_if_fail (visual_thread_is_supported () != FALSE, -VISUAL_ERROR_THREAD_NOT_SUPPORTED);
+	visual_return_val_if_fail (visual_thread_is_enabled () != FALSE, -VISUAL_ERROR_THREAD_NOT_ENABLED);
+
+	return __lv_thread_funcs.cond_init (cond);
+}
+
+int visual_cond_wait (VisCond *cond, VisMutex *mutex)
+{
+	visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+	visual_return_val_if_fail (mutex != NULL, -VISUAL_ERROR_MUTEX_NULL);
+
+	visual_return_val_if_fail (visual_thread_is_initialized () != FALSE, -VISUAL_ERROR_THREAD_NOT_INITIALIZED);
+	visual_return_val_if_fail (visual_thread_is_supported () != FALSE, -VISUAL_ERROR_THREAD_NOT_SUPPORTED);
+	visual_return_val_if_fail (visual_thread_is_enabled () != FALSE, -VISUAL_ERROR_THREAD_NOT_ENABLED);
+
+	return __lv_thread_funcs.cond_wait (cond, mutex);
+}
+
+int visual_cond_signal (VisCond *cond)
+{
+	visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+	visual_return_val_if_fail (visual_thread_is_initialized () != FALSE, -VISUAL_ERROR_THREAD_NOT_INITIALIZED);
+	visual_return_val_if_fail (visual_thread_is_supported () != FALSE, -VISUAL_ERROR_THREAD_NOT_SUPPORTED);
+	visual_return_val_if_fail (visual_thread_is_enabled () != FALSE, -VISUAL_ERROR_THREAD_NOT_ENABLED);
+
+	return __lv_thread_funcs.cond_signal (cond);
+}
+
+int visual_cond_broadcast (VisCond *cond)
+{
+	visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+	visual_return_val_if_fail (visual_thread_is_initialized () != FALSE, -VISUAL_ERROR_THREAD_NOT_INITIALIZED);
+	visual_return_val_if_fail (visual_thread_is_supported () != FALSE, -VISUAL_ERROR_THREAD_NOT_SUPPORTED);
+	visual_return_val_if_fail (visual_thread_is_enabled () != FALSE, -VISUAL_ERROR_THREAD_NOT_ENABLED);
+
+	return __lv_thread_funcs.cond_broadcast (cond);
+}
+
 
 /* Native implementations */
 
@@ -370,7 +501,7 @@ static void *thread_join_posix (VisThread *thread)
 {
 	void *result = NULL;
 
-	if (pthread_join (thread->thread, &result) < 0) {
+	if (pthread_join (thread->thread, &result) != 0) {
 		visual_log (VISUAL_LOG_ERROR, _("Error while joining thread"));
 
 		return NULL;
@@ -403,6 +534,8 @@ static VisMutex *mutex_new_posix ()
 
 static int mutex_free_posix (VisMutex *mutex)
 {
+	pthread_mutex_destroy (&mutex->mutex);
+
 	return visual_mem_free (mutex);
 }
 
@@ -417,7 +550,7 @@ static int mutex_init_posix (VisMutex *mutex)
 
 static int mutex_lock_posix (VisMutex *mutex)
 {
-	if (pthread_mutex_lock (&mutex->mutex) < 0)
+	if (pthread_mutex_lock (&mutex->mutex) != 0)
 		return -VISUAL_ERROR_MUTEX_LOCK_FAILURE;
 
 	return VISUAL_OK;
@@ -425,7 +558,7 @@ static int mutex_lock_posix (VisMutex *mutex)
 
 static int mutex_trylock_posix (VisMutex *mutex)
 {
-	if (pthread_mutex_trylock (&mutex->mutex) < 0)
+	if (pthread_mutex_trylock (&mutex->mutex) != 0)
 		return -VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE;
 
 	return VISUAL_OK;
@@ -433,12 +566,64 @@ static int mutex_trylock_posix (VisMutex *mutex)
 
 static int mutex_unlock_posix (VisMutex *mutex)
 {
-	if (pthread_mutex_unlock (&mutex->mutex) < 0)
+	if (pthread_mutex_unlock (&mutex->mutex) != 0)
 		return -VISUAL_ERROR_MUTEX_UNLOCK_FAILURE;
 
 	return VISUAL_OK;
 }
 
+
+static VisCond *cond_new_posix ()
+{
+	VisCond *cond;
+
+	cond = visual_mem_new0 (VisCond, 1);
+
+	pthread_cond_init (&cond->cond, NULL);
+
+	return cond;
+}
+
+static int cond_free_posix (VisCond *cond)
+{
+	pthread_cond_destroy (&cond->cond);
+
+	return visual_mem_free (cond);
+}
+
+static int cond_init_posix (VisCond *cond)
+{
+	visual_mem_set (cond, 0, sizeof (VisCond));
+
+	pthread_cond_init (&cond->cond, NULL);
+
+	return VISUAL_OK;
+}
+
+static int cond_wait_posix (VisCond *cond, VisMutex *mutex)
+{
+	if (pthread_cond_wait (&cond->cond, &mutex->mutex) != 0)
+		return -VISUAL_ERROR_COND_WAIT_FAILURE;
+
+	return VISUAL_OK;
+}
+
+static int cond_signal_posix (VisCond *cond)
+{
+	if (pthread_cond_signal (&cond->cond) != 0)
+		return -VISUAL_ERROR_COND_SIGNAL_FAILURE;
+
+	return VISUAL_OK;
+}
+
+static int cond_broadcast_posix (VisCond *cond)
+{
+	if (pthread_cond_broadcast (&cond->cond) != 0)
+		return -VISUAL_ERROR_COND_SIGNAL_FAILURE;
+
+	return VISUAL_OK;
+}
+
 #endif // VISUAL_THREAD_MODEL_POSIX
 
 /* Windows32 implementation */
@@ -450,9 +635,9 @@ static VisThread *thread_create_win32 (VisThreadFunc func, void *data, int joina
 
 	thread = visual_mem_new0 (VisThread, 1);
 
-	thread->thread = CreateThread (NULL, 0, func, (PVOID) data, 0, &thread->threadId);
+	thread->thread = CreateThread (NULL, 0, (LPTHREAD_START_ROUTINE) func, (PVOID) data, 0, &thread->threadId);
 
-	if (thread == NULL) {
+	if (thread->thread == NULL) {
 		visual_log (VISUAL_LOG_ERROR, "Error while creating thread");
 
 		visual_mem_free (thread);
@@ -474,6 +659,8 @@ static VisThread *thread_create_win32 (VisThreadFunc func, void *data, int joina
 
 static int thread_free_win32 (VisThread *thread)
 {
+	CloseHandle (thread->thread);
+
 	return visual_mem_free (thread);
 }
 
@@ -497,41 +684,110 @@ static void *thread_join_win32 (VisThread *thread)
 
 static void thread_exit_win32 (void *retval)
 {
+	ExitThread ((DWORD) (uintptr_t) retval);
 }
 
 static void thread_yield_win32 ()
 {
+	SwitchToThread ();
 }
 
 
 static VisMutex *mutex_new_win32 ()
 {
-    return 0;
+	VisMutex *mutex;
+
+	mutex = visual_mem_new0 (VisMutex, 1);
+
+	InitializeCriticalSection (&mutex->mutex);
+
+	return mutex;
 }
 
 static int mutex_free_win32 (VisMutex *mutex)
 {
-    return 0;
+	DeleteCriticalSection (&mutex->mutex);
+
+	return visual_mem_free (mutex);
 }
 
 static int mutex_init_win32 (VisMutex *mutex)
 {
-    return 0;
+	visual_mem_set (mutex, 0, sizeof (VisMutex));
+
+	InitializeCriticalSection (&mutex->mutex);
+
+	return VISUAL_OK;
 }
 
 static int mutex_lock_win32 (VisMutex *mutex)
 {
-    return 0;
+	EnterCriticalSection (&mutex->mutex);
+
+	return VISUAL_OK;
 }
 
 static int mutex_trylock_win32 (VisMutex *mutex)
 {
-    return 0;
+	if (TryEnterCriticalSection (&mutex->mutex) == 0)
+		return -VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE;
+
+	return VISUAL_OK;
 }
 
 static int mutex_unlock_win32 (VisMutex *mutex)
 {
-    return 0;
+	LeaveCriticalSection (&mutex->mutex);
+
+	return VISUAL_OK;
+}
+
+
+static VisCond *cond_new_win32 ()
+{
+	VisCond *cond;
+
+	cond = visual_mem_new0 (VisCond, 1);
+
+	InitializeConditionVariable (&cond->cond);
+
+	return cond;
+}
+
+static int cond_free_win32 (VisCond *cond)
+{
+	return visual_mem_free (cond);
+}
+
+static int cond_init_win32 (VisCond *cond)
+{
+	visual_mem_set (cond, 0, sizeof (VisCond));
+
+	InitializeConditionVariable (&cond->cond);
+
+	return VISUAL_OK;
+}
+
+static int cond_wait_win32 (VisCond *cond, VisMutex *mutex)
+{
+	if (SleepConditionVariableCS (&cond->cond, &mutex->mutex, INFINITE) == 0)
+		return -VISUAL_ERROR_COND_WAIT_FAILURE;
+
+	return VISUAL_OK;
+}
+
+static int cond_signal_win32 (VisCond *cond)
+{
+	WakeConditionVariable (&cond->cond);
+
+	return VISUAL_OK;
+}
+
+static int cond_broadcast_win32 (VisCond *cond)
+{
+	WakeAllConditionVariable (&cond->cond);
+
+	return VISUAL_OK;
 }
 
 #endif /* VISUAL_THREAD_MODEL_WIN32 */
@@ -628,10 +884,15 @@ static int mutex_lock_gthread (VisMutex *mutex)
 
 static int mutex_trylock_gthread (VisMutex *mutex)
 {
+	gboolean locked;
+
 	if (mutex->static_mutex_used == TRUE)
-		g_static_mutex_trylock (&mutex->static_mutex);
+		locked = g_static_mutex_trylock (&mutex->static_mutex);
 	else
-		g_mutex_trylock (mutex->mutex);
+		locked = g_mutex_trylock (mutex->mutex);
+
+	if (locked == FALSE)
+		return -VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE;
 
 	return VISUAL_OK;
 }
@@ -646,4 +907,56 @@ static int mutex_unlock_gthread (VisMutex *mutex)
 	return VISUAL_OK;
 }
 
+
+static VisCond *cond_new_gthread ()
+{
+	VisCond *cond;
+
+	cond = visual_mem_new0 (VisCond, 1);
+
+	cond->cond = g_cond_new ();
+
+	return cond;
+}
+
+static int cond_free_gthread (VisCond *cond)
+{
+	visual_return_val_if_fail (cond->cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+	g_cond_free (cond->cond);
+
+	return visual_mem_free (cond);
+}
+
+static int cond_init_gthread (VisCond *cond)
+{
+	cond->cond = g_cond_new ();
+
+	return VISUAL_OK;
+}
+
+static int cond_wait_gthread (VisCond *cond, VisMutex *mutex)
+{
+	if (mutex->static_mutex_used == TRUE)
+		g_cond_wait (cond->cond, g_static_mutex_get_mutex (&mutex->static_mutex));
+	else
+		g_cond_wait (cond->cond, mutex->mutex);
+
+	return VISUAL_OK;
+}
+
+static int cond_signal_gthread (VisCond *cond)
+{
+	g_cond_signal (cond->cond);
+
+	return VISUAL_OK;
+}
+
+static int cond_broadcast_gthread (VisCond *cond)
+{
+	g_cond_broadcast (cond->cond);
+
+	return VISUAL_OK;
+}
+
 #endif // VISUAL_THREAD_MODEL_GTHREAD2
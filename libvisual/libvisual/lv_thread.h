@@ -27,6 +27,7 @@ VISUAL_BEGIN_DECLS
 
 typedef struct _VisThread VisThread;
 typedef struct _VisMutex VisMutex;
+typedef struct _VisCond VisCond;
 
 /**
  * The function defination for a function that forms the base of a new VisThread when
@@ -51,7 +52,7 @@ struct _VisThread {
 #elif defined(VISUAL_THREAD_MODEL_WIN32) /* !VISUAL_THREAD_MODEL_POSIX */
 	HANDLE thread;
 	DWORD threadId;
-#elif defined(VISUAL_THREAD_MODEL_GTHREAD) /* !VISUAL_THREAD_MODEL_WIN32 */
+#elif defined(VISUAL_THREAD_MODEL_GTHREAD2) /* !VISUAL_THREAD_MODEL_WIN32 */
 	GThread *thread;
 #endif
 #endif /* VISUAL_HAVE_THREADS */
@@ -66,8 +67,8 @@ struct _VisMutex {
 #ifdef VISUAL_THREAD_MODEL_POSIX
 	pthread_mutex_t mutex;		/**< Private used for the pthreads implementation. */
 #elif defined(VISUAL_THREAD_MODEL_WIN32) /* !VISUAL_THREAD_MODEL_POSIX */
-
-#elif defined(VISUAL_THREAD_MODEL_GTHREAD) /* !VISUAL_THREAD_MODEL_WIN32 */
+	CRITICAL_SECTION mutex;
+#elif defined(VISUAL_THREAD_MODEL_GTHREAD2) /* !VISUAL_THREAD_MODEL_WIN32 */
 	GMutex *mutex;
 
 	GStaticMutex static_mutex;
@@ -76,6 +77,22 @@ struct _VisMutex {
 #endif /* VISUAL_HAVE_THREADS */
 };
 
+/**
+ * The VisCond data structure and the VisCond subsystem is a wrapper system for native
+ * condition variables, a VisCond is always used together with a VisMutex.
+ */
+struct _VisCond {
+#ifdef VISUAL_HAVE_THREADS
+#ifdef VISUAL_THREAD_MODEL_POSIX
+	pthread_cond_t cond;		/**< Private used for the pthreads implementation. */
+#elif defined(VISUAL_THREAD_MODEL_WIN32) /* !VISUAL_THREAD_MODEL_POSIX */
+	CONDITION_VARIABLE cond;
+#elif defined(VISUAL_THREAD_MODEL_GTHREAD2) /* !VISUAL_THREAD_MODEL_WIN32 */
+	GCond *cond;
+#endif
+#endif /* VISUAL_HAVE_THREADS */
+};
+
 
 /**
  * Initializes the VisThread subsystem. This function needs to be
@@ -237,6 +254,72 @@ int visual_mutex_trylock (VisMutex *mutex);
  */
 int visual_mutex_unlock (VisMutex *mutex);
 
+/**
+ * Creates a new VisCond that is used to let threads wait until
+ * another thread signals them.
+ *
+ * @return A newly allocated VisCond or NULL on failure.
+ */
+VisCond *visual_cond_new (void);
+
+/**
+ * Frees a VisCond that was allocated using visual_cond_new(). No
+ * threads may be waiting on it anymore.
+ *
+ * @param cond Pointer to the VisCond that needs to be freed.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL on failure.
+ */
+int visual_cond_free (VisCond *cond);
+
+/**
+ * A VisCond that has not been allocated using visual_cond_new ()
+ * can be initialized using this function.
+ *
+ * @param cond Pointer to the VisCond which needs to be initialized.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL, -VISUAL_ERROR_THREAD_NOT_INITIALIZED,
+ *	-VISUAL_ERROR_THREAD_NOT_SUPPORTED or -VISUAL_ERROR_THREAD_NOT_ENABLED on failure.
+ */
+int visual_cond_init (VisCond *cond);
+
+/**
+ * Atomically unlocks the VisMutex and blocks until the VisCond is
+ * signalled, the VisMutex is locked again before returning. Wakeups
+ * can be spurious, so the caller should wait in a loop that checks
+ * the condition it is waiting for.
+ *
+ * @param cond Pointer to the VisCond to wait on.
+ * @param mutex Pointer to the VisMutex that is locked by the calling thread.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL, -VISUAL_ERROR_MUTEX_NULL,
+ *	-VISUAL_ERROR_COND_WAIT_FAILURE, -VISUAL_ERROR_THREAD_NOT_INITIALIZED,
+ *	-VISUAL_ERROR_THREAD_NOT_SUPPORTED or -VISUAL_ERROR_THREAD_NOT_ENABLED on failure.
+ */
+int visual_cond_wait (VisCond *cond, VisMutex *mutex);
+
+/**
+ * Wakes up one thread that waits on the VisCond.
+ *
+ * @param cond Pointer to the VisCond that is signalled.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL, -VISUAL_ERROR_COND_SIGNAL_FAILURE,
+ *	-VISUAL_ERROR_THREAD_NOT_INITIALIZED, -VISUAL_ERROR_THREAD_NOT_SUPPORTED or
+ *	-VISUAL_ERROR_THREAD_NOT_ENABLED on failure.
+ */
+int visual_cond_signal (VisCond *cond);
+
+/**
+ * Wakes up all threads that wait on the VisCond.
+ *
+ * @param cond Pointer to the VisCond that is signalled.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL, -VISUAL_ERROR_COND_SIGNAL_FAILURE,
+ *	-VISUAL_ERROR_THREAD_NOT_INITIALIZED, -VISUAL_ERROR_THREAD_NOT_SUPPORTED or
+ *	-VISUAL_ERROR_THREAD_NOT_ENABLED on failure.
+ */
+int visual_cond_broadcast (VisCond *cond);
+
 VISUAL_END_DECLS
 
 /**
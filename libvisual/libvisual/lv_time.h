@@ -309,13 +309,13 @@ int visual_timer_has_passed_by_values (VisTimer *timer, long sec, long usec);
 static inline void visual_timer_tsc_get (uint32_t *lo, uint32_t *hi)
 {
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+	/* cpuid serializes, it overwrites all four registers */
 	__asm __volatile
 		("\n\t cpuid"
 		 "\n\t rdtsc"
-		 "\n\t movl %%edx, %0"
-		 "\n\t movl %%eax, %1"
-		 : "=r" (*hi), "=r" (*lo)
-		 :: "memory");
+		 : "=a" (*lo), "=d" (*hi)
+		 : "a" (0)
+		 : "ebx", "ecx", "memory");
 #endif
 }
 
@@ -30,22 +30,52 @@
 #include "lv_color.h"
 #include "lv_common.h"
 #include "lv_cpu.h"
+#include "private/lv_palette_lookup.h"
+#include "private/lv_video_composite.h"
 #include "private/lv_video_convert.h"
 #include "private/lv_video_fill.h"
 #include "private/lv_video_scale.h"
+#include "private/lv_video_threads.h"
 #include "gettext.h"
 
-#pragma pack(1)
+
+typedef void (*VideoConvertFunc)(VisVideo *dest, VisVideo *src);
+typedef void (*VideoLookupFunc)(VisVideo *dest, VisVideo *src, const uint8_t *table);
+typedef void (*VideoScaleFunc)(VisVideo *dest, VisVideo *src, int y0, int y1);
+typedef void (*VideoFillFunc)(VisVideo *video, VisColor *color);
+
+/* Called per band, src is NULL for operations on a single VisVideo */
+typedef void (*VideoBandFunc)(VisVideo *dest, VisVideo *src, void *priv);
+
+typedef struct {
+	VisVideo	 dregions[VISUAL_VIDEO_THREADS_MAX];
+	VisVideo	 sregions[VISUAL_VIDEO_THREADS_MAX];
+	int		 hassrc;
+	VideoBandFunc	 func;
+	void		*priv;
+} VideoRegionBands;
+
+typedef struct {
+	VisVideo	*dest;
+	VisVideo	*src;
+	VideoScaleFunc	 scale;
+	VisVideoScaleFilter *hfilter;
+	VisVideoScaleFilter *vfilter;
+	int		 bands;
+} VideoScaleBands;
+
+typedef struct {
+	VideoFillFunc	 fill;
+	VisColor	*color;
+} VideoFillBand;
 
 typedef struct {
-#ifdef VISUAL_LITTLE_ENDIAN
-	uint16_t b:5, g:6, r:5;
-#else
-	uint16_t r:5, g:6, b:5;
-#endif
-} rgb16_t;
+	VideoLookupFunc	 convert;
+	const uint8_t	*table;
+} VideoLookupBand;
 
-#pragma pack()
+/* Number of threads for large operations, 0 means one per CPU */
+static int __lv_video_thread_count = 0;
 
 /* The VisVideo dtor function */
 static int video_dtor (VisObject *object);
@@ -56,6 +86,7 @@ static void precompute_row_table (VisVideo *video);
 /* Blit overlay functions */
 static int blit_overlay_noalpha (VisVideo *dest, VisVideo *src);
 static int blit_overlay_alphasrc (VisVideo *dest, VisVideo *src);
+static int blit_overlay_premultiplied (VisVideo *dest, VisVideo *src);
 static int blit_overlay_colorkey (VisVideo *dest, VisVideo *src);
 static int blit_overlay_surfacealpha (VisVideo *dest, VisVideo *src);
 static int blit_overlay_surfacealphacolorkey (VisVideo *dest, VisVideo *src);
@@ -69,6 +100,22 @@ static int rotate_270 (VisVideo *dest, VisVideo *src);
 static int mirror_x (VisVideo *dest, VisVideo *src);
 static int mirror_y (VisVideo *dest, VisVideo *src);
 
+/* Band splitting */
+static void video_region_band (void *priv, int band);
+static void video_run_region_bands (VisVideo *dest, VisVideo *src, VideoBandFunc func, void *priv);
+static void video_scale_band (void *priv, int band);
+static int video_convert (VisVideo *dest, VisVideo *src, VideoConvertFunc convert);
+static int video_convert_lookup (VisVideo *dest, VisVideo *src, VideoLookupFunc convert, const uint8_t *table);
+static void video_alpha_blend_rows (VisVideo *dest, VisVideo *src1, VisVideo *src2, VisAlphaBlendFunc blend,
+		uint8_t alpha);
+static void band_convert (VisVideo *dest, VisVideo *src, void *priv);
+static void band_convert_lookup (VisVideo *dest, VisVideo *src, void *priv);
+static void band_composite (VisVideo *dest, VisVideo *src, void *priv);
+static void band_fill_color (VisVideo *dest, VisVideo *src, void *priv);
+static void band_fill_alpha (VisVideo *dest, VisVideo *src, void *priv);
+static void fill_alpha (VisVideo *video, uint8_t density);
+static void scale_bilinear_color32_mmx (VisVideo *dest, VisVideo *src, int y0, int y1);
+
 static int video_dtor (VisObject *object)
 {
 	VisVideo *video = VISUAL_VIDEO (object);
@@ -177,6 +224,8 @@ int visual_video_free_buffer (VisVideo *video)
 
 int visual_video_allocate_buffer (VisVideo *video)
 {
+	VisMemTag oldtag;
+
 	visual_return_val_if_fail (video != NULL, -VISUAL_ERROR_VIDEO_NULL);
 	visual_return_val_if_fail (video->buffer != NULL, -VISUAL_ERROR_VIDEO_BUFFER_NULL);
 
@@ -197,6 +246,8 @@ int visual_video_allocate_buffer (VisVideo *video)
 		return VISUAL_OK;
 	}
 
+	oldtag = visual_mem_set_tag (VISUAL_MEM_TAG_VIDEO);
+
 	visual_buffer_set_destroyer (video->buffer, visual_buffer_destroyer_free);
 	visual_buffer_set_size (video->buffer, visual_video_get_size (video));
 	visual_buffer_allocate_data (video->buffer);
@@ -204,6 +255,8 @@ int visual_video_allocate_buffer (VisVideo *video)
 	video->pixel_rows = visual_mem_new0 (void *, video->height);
 	precompute_row_table (video);
 
+	visual_mem_set_tag (oldtag);
+
 	return VISUAL_OK;
 }
 
@@ -719,11 +772,19 @@ VisVideoCustomCompositeFunc visual_video_composite_get_function (VisVideo *dest,
 		if (alpha == FALSE || src->depth != VISUAL_VIDEO_DEPTH_32BIT)
 			return blit_overlay_noalpha;
 
-		if (visual_cpu_get_mmx () != 0)
+		/* The MMX blitter rounds differently, it's only used without SSE2 */
+		if (visual_cpu_get_mmx () != 0 && visual_cpu_get_sse2 () == 0)
 			return _lv_blit_overlay_alphasrc_mmx;
 		else
 			return blit_overlay_alphasrc;
 
+	} else if (src->compositetype == VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED) {
+
+		if (alpha == FALSE || src->depth != VISUAL_VIDEO_DEPTH_32BIT)
+			return blit_overlay_noalpha;
+
+		return blit_overlay_premultiplied;
+
 	} else if (src->compositetype == VISUAL_VIDEO_COMPOSITE_TYPE_COLORKEY) {
 
 		return blit_overlay_colorkey;
@@ -911,8 +972,14 @@ int visual_video_blit_overlay_custom (VisVideo *dest, VisVideo *src, int x, int
 	if ((ret = visual_video_region_sub_with_boundary (&sregion, &drect, &tempregion, &redestrect)) != VISUAL_OK)
 		goto out;
 
-	/* Call blitter */
-	compfunc (&dregion, &sregion);
+	/* Call blitter, custom functions may keep state so those stay on this thread */
+	if (compfunc == blit_overlay_noalpha || compfunc == blit_overlay_alphasrc ||
+			compfunc == _lv_blit_overlay_alphasrc_mmx || compfunc == blit_overlay_premultiplied ||
+			compfunc == blit_overlay_colorkey || compfunc == blit_overlay_surfacealpha ||
+			compfunc == blit_overlay_surfacealphacolorkey)
+		video_run_region_bands (&dregion, &sregion, band_composite, &compfunc);
+	else
+		compfunc (&dregion, &sregion);
 
 out:
 	/* If we had a transform buffer, it's time to get rid of it */
@@ -952,273 +1019,35 @@ static int blit_overlay_noalpha (VisVideo *dest, VisVideo *src)
 
 static int blit_overlay_alphasrc (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf = visual_video_get_pixels (src);
-	uint8_t alpha;
-
-	for (y = 0; y < src->height; y++) {
-		for (x = 0; x < src->width; x++) {
-			alpha = *(srcbuf + 3);
+	visual_video_composite_alphasrc (dest, src);
 
-			*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-			*(destbuf + 1) = ((alpha * (*(srcbuf + 1) - *(destbuf + 1)) >> 8) + *(destbuf + 1));
-			*(destbuf + 2) = ((alpha * (*(srcbuf + 2) - *(destbuf + 2)) >> 8) + *(destbuf + 2));
-
-			destbuf += dest->bpp;
-			srcbuf += src->bpp;
-		}
+	return VISUAL_OK;
+}
 
-		destbuf += dest->pitch - (dest->width * dest->bpp);
-		srcbuf += src->pitch - (src->width * src->bpp);
-	}
+static int blit_overlay_premultiplied (VisVideo *dest, VisVideo *src)
+{
+	visual_video_composite_premultiplied (dest, src);
 
 	return VISUAL_OK;
 }
 
 static int blit_overlay_colorkey (VisVideo *dest, VisVideo *src)
 {
-	unsigned int i;
-	unsigned int pixel_count = dest->width * dest->height;
-
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-		uint8_t *destbuf = visual_video_get_pixels (dest);
-		uint8_t *srcbuf = visual_video_get_pixels (src);
-		VisPalette *pal = src->pal;
-
-		if (pal == NULL) {
-			blit_overlay_noalpha (dest, src);
-
-			return VISUAL_OK;
-		}
-
-		int index = visual_palette_find_color (pal, &src->colorkey);
-
-		for (i = 0; i < pixel_count; i++) {
-			if (*srcbuf != index)
-				*destbuf = *srcbuf;
-
-			destbuf++;
-			srcbuf++;
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-		uint16_t *destbuf = visual_video_get_pixels (dest);
-		uint16_t *srcbuf = visual_video_get_pixels (src);
-		uint16_t color = visual_color_to_uint16 (&src->colorkey);
-
-		for (i = 0; i < pixel_count; i++) {
-			if (color != *srcbuf)
-				*destbuf = *srcbuf;
-
-			destbuf++;
-			srcbuf++;
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-		uint8_t *destbuf = visual_video_get_pixels (dest);
-		uint8_t *srcbuf = visual_video_get_pixels (src);
-		uint8_t r = src->colorkey.r;
-		uint8_t g = src->colorkey.g;
-		uint8_t b = src->colorkey.b;
-
-		for (i = 0; i < pixel_count; i++) {
-			if (b != srcbuf[0] && g != srcbuf[1] && r != srcbuf[2]) {
-				destbuf[0] = srcbuf[0];
-				destbuf[1] = srcbuf[1];
-				destbuf[2] = srcbuf[2];
-			}
-
-			destbuf += 3;
-			srcbuf  += 3;
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-		uint32_t *destbuf = visual_video_get_pixels (dest);
-		uint32_t *srcbuf = visual_video_get_pixels (src);
-		uint32_t color = visual_color_to_uint32 (&src->colorkey);
-
-		for (i = 0; i < pixel_count; i++) {
-			if (color != *srcbuf)
-				*destbuf = *srcbuf;
-
-			destbuf++;
-			srcbuf++;
-		}
-	}
+	visual_video_composite_colorkey (dest, src);
 
 	return VISUAL_OK;
 }
 
 static int blit_overlay_surfacealpha (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf = visual_video_get_pixels (src);
-	uint8_t alpha = src->density;
-
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-
-		for (y = 0; y < src->height; y++) {
-			rgb16_t *destr = (rgb16_t *) destbuf;
-			rgb16_t *srcr  = (rgb16_t *) srcbuf;
-
-			for (x = 0; x < src->width; x++) {
-				destr->r = ((alpha * (srcr->r - destr->r) >> 8) + destr->r);
-				destr->g = ((alpha * (srcr->g - destr->g) >> 8) + destr->g);
-				destr->b = ((alpha * (srcr->b - destr->b) >> 8) + destr->b);
-
-				destr++;
-				srcr++;
-			}
-
-			destbuf += dest->pitch;
-			srcbuf += src->pitch;
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-				*(destbuf + 1) = ((alpha * (*(srcbuf + 1) - *(destbuf + 1)) >> 8) + *(destbuf + 1));
-				*(destbuf + 2) = ((alpha * (*(srcbuf + 2) - *(destbuf + 2)) >> 8) + *(destbuf + 2));
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-				*(destbuf + 1) = ((alpha * (*(srcbuf + 1) - *(destbuf + 1)) >> 8) + *(destbuf + 1));
-				*(destbuf + 2) = ((alpha * (*(srcbuf + 2) - *(destbuf + 2)) >> 8) + *(destbuf + 2));
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-	}
+	visual_video_composite_surface (dest, src);
 
 	return VISUAL_OK;
 }
 
 static int blit_overlay_surfacealphacolorkey (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf = visual_video_get_pixels (src);
-	uint8_t alpha = src->density;
-
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-		VisPalette *pal = src->pal;
-
-		if (pal == NULL) {
-			blit_overlay_noalpha (dest, src);
-
-			return VISUAL_OK;
-		}
-
-		int index = visual_palette_find_color (pal, &src->colorkey);
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (*srcbuf != index)
-					*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-		uint16_t color = visual_color_to_uint16 (&src->colorkey);
-
-		for (y = 0; y < src->height; y++) {
-			rgb16_t *destr = (rgb16_t *) destbuf;
-			rgb16_t *srcr  = (rgb16_t *) srcbuf;
-
-			for (x = 0; x < src->width; x++) {
-				if (color != *((uint16_t *) srcr)) {
-					destr->r = ((alpha * (srcr->r - destr->r) >> 8) + destr->r);
-					destr->g = ((alpha * (srcr->g - destr->g) >> 8) + destr->g);
-					destr->b = ((alpha * (srcr->b - destr->b) >> 8) + destr->b);
-				}
-
-				destr++;
-				srcr++;
-			}
-
-			destbuf += dest->pitch;
-			srcbuf += src->pitch;
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-		uint8_t r = src->colorkey.r;
-		uint8_t g = src->colorkey.g;
-		uint8_t b = src->colorkey.b;
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (b != *srcbuf && g != *(srcbuf + 1) && r != *(srcbuf + 2)) {
-					*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-					*(destbuf + 1) = ((alpha * (*(srcbuf + 1) - *(destbuf + 1)) >> 8) + *(destbuf + 1));
-					*(destbuf + 2) = ((alpha * (*(srcbuf + 2) - *(destbuf + 2)) >> 8) + *(destbuf + 2));
-				}
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-		uint32_t color = visual_color_to_uint32 (&src->colorkey);
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (color == *((uint32_t *) destbuf)) {
-					*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
-					*(destbuf + 1) = ((alpha * (*(srcbuf + 1) - *(destbuf + 1)) >> 8) + *(destbuf + 1));
-					*(destbuf + 2) = ((alpha * (*(srcbuf + 2) - *(destbuf + 2)) >> 8) + *(destbuf + 2));
-				}
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
-	}
+	visual_video_composite_surfacecolorkey (dest, src);
 
 	return VISUAL_OK;
 }
@@ -1255,23 +1084,31 @@ int visual_video_fill_alpha_color (VisVideo *video, VisColor *color, uint8_t den
 
 int visual_video_fill_alpha (VisVideo *video, uint8_t density)
 {
-	int x, y;
-	uint8_t *vidbuf;
-
 	visual_return_val_if_fail (video != NULL, -VISUAL_ERROR_VIDEO_NULL);
 	visual_return_val_if_fail (video->depth == VISUAL_VIDEO_DEPTH_32BIT, -VISUAL_ERROR_VIDEO_INVALID_DEPTH);
 
+	video_run_region_bands (video, NULL, band_fill_alpha, &density);
+
+	return VISUAL_OK;
+}
+
+static void fill_alpha (VisVideo *video, uint8_t density)
+{
+	int x, y;
+	uint8_t *vidbuf;
+
 	vidbuf = (uint8_t *) visual_video_get_pixels (video) + 3;
 
 	/* FIXME byte order sensitive */
 	for (y = 0; y < video->height; y++) {
-		for (x = 0; x < video->width; x++)
-			*(vidbuf += video->bpp) = density;
+		for (x = 0; x < video->width; x++) {
+			*vidbuf = density;
+
+			vidbuf += video->bpp;
+		}
 
 		vidbuf += video->pitch - (video->width * video->bpp);
 	}
-
-	return VISUAL_OK;
 }
 
 int visual_video_fill_alpha_rectangle (VisVideo *video, uint8_t density, VisRectangle *rect)
@@ -1301,6 +1138,7 @@ out:
 int visual_video_fill_color (VisVideo *video, VisColor *rcolor)
 {
 	VisColor color;
+	VideoFillBand fillband;
 
 	visual_return_val_if_fail (video != NULL, -VISUAL_ERROR_VIDEO_NULL);
 
@@ -1311,25 +1149,31 @@ int visual_video_fill_color (VisVideo *video, VisColor *rcolor)
 
 	switch (video->depth) {
 		case VISUAL_VIDEO_DEPTH_8BIT:
-			visual_video_fill_color_index8 (video, &color);
-			return VISUAL_OK;
+			fillband.fill = visual_video_fill_color_index8;
+			break;
 
 		case VISUAL_VIDEO_DEPTH_16BIT:
-			visual_video_fill_color_rgb16 (video, &color);
-			return VISUAL_OK;
+			fillband.fill = visual_video_fill_color_rgb16;
+			break;
 
 		case VISUAL_VIDEO_DEPTH_24BIT:
-			visual_video_fill_color_rgb24 (video, &color);
-			return VISUAL_OK;
+			fillband.fill = visual_video_fill_color_rgb24;
+			break;
 
 		case VISUAL_VIDEO_DEPTH_32BIT:
-			visual_video_fill_color_argb32 (video, &color);
-			return VISUAL_OK;
+			fillband.fill = visual_video_fill_color_argb32;
+			break;
 
 
 		default:
 			return -VISUAL_ERROR_VIDEO_INVALID_DEPTH;
 	}
+
+	fillband.color = &color;
+
+	video_run_region_bands (video, NULL, band_fill_color, &fillband);
+
+	return VISUAL_OK;
 }
 
 int visual_video_fill_color_rectangle (VisVideo *video, VisColor *color, VisRectangle *rect)
@@ -1626,6 +1470,8 @@ static int mirror_y (VisVideo *dest, VisVideo *src)
 
 int visual_video_depth_transform (VisVideo *dest, VisVideo *src)
 {
+	const uint8_t *lookup = NULL;
+
 	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_VIDEO_NULL);
 	visual_return_val_if_fail (src != NULL,  -VISUAL_ERROR_VIDEO_NULL);
 
@@ -1633,83 +1479,144 @@ int visual_video_depth_transform (VisVideo *dest, VisVideo *src)
 	if (dest->depth == src->depth)
 		return visual_video_blit_overlay (dest, src, 0, 0, FALSE);
 
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT || src->depth == VISUAL_VIDEO_DEPTH_8BIT) {
+	if (src->depth == VISUAL_VIDEO_DEPTH_8BIT) {
 		visual_return_val_if_fail (src->pal != NULL, -VISUAL_ERROR_PALETTE_NULL);
 		visual_return_val_if_fail (src->pal->ncolors == 256, -VISUAL_ERROR_PALETTE_SIZE);
 	}
 
+	/* Conversions to 8 bits map onto the destination palette, its lookup table is
+	 * brought up to date here and handed to the bands, which only read it */
+	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
+		visual_return_val_if_fail (dest->pal != NULL, -VISUAL_ERROR_PALETTE_NULL);
+
+		lookup = visual_palette_lookup_get (dest->pal);
+		visual_return_val_if_fail (lookup != NULL, -VISUAL_ERROR_PALETTE_SIZE);
+	}
+
 	if (src->depth == VISUAL_VIDEO_DEPTH_8BIT) {
 
 	    if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-			visual_video_index8_to_rgb16 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_index8_to_rgb16);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-			visual_video_index8_to_rgb24 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_index8_to_rgb24);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-			visual_video_index8_to_argb32 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_index8_to_argb32);
 		}
 
 	} else if (src->depth == VISUAL_VIDEO_DEPTH_16BIT) {
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-			visual_video_rgb16_to_index8 (dest, src);
-			return VISUAL_OK;
+			return video_convert_lookup (dest, src, visual_video_rgb16_to_index8, lookup);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-			visual_video_rgb16_to_rgb24 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_rgb16_to_rgb24);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-			visual_video_rgb16_to_argb32 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_rgb16_to_argb32);
 		}
 
 	} else if (src->depth == VISUAL_VIDEO_DEPTH_24BIT) {
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-			visual_video_rgb24_to_index8 (dest, src);
-			return VISUAL_OK;
+			return video_convert_lookup (dest, src, visual_video_rgb24_to_index8, lookup);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-			visual_video_rgb24_to_rgb16 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_rgb24_to_rgb16);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-			visual_video_rgb24_to_argb32 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_rgb24_to_argb32);
 		}
 
 	} else if (src->depth == VISUAL_VIDEO_DEPTH_32BIT) {
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-			visual_video_argb32_to_index8 (dest, src);
-			return VISUAL_OK;
+			return video_convert_lookup (dest, src, visual_video_argb32_to_index8, lookup);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-			visual_video_argb32_to_rgb16 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_argb32_to_rgb16);
 		}
 
 		if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-			visual_video_argb32_to_rgb24 (dest, src);
-			return VISUAL_OK;
+			return video_convert (dest, src, visual_video_argb32_to_rgb24);
 		}
 	}
 
 	return -VISUAL_ERROR_VIDEO_NOT_TRANSFORMED;
 }
 
+int visual_video_alpha_blend (VisVideo *dest, VisVideo *src1, VisVideo *src2, uint8_t alpha)
+{
+	VisAlphaBlendFunc blend;
+	VisVideo *temp;
+	int ret;
+
+	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_VIDEO_NULL);
+	visual_return_val_if_fail (src1 != NULL, -VISUAL_ERROR_VIDEO_NULL);
+	visual_return_val_if_fail (src2 != NULL, -VISUAL_ERROR_VIDEO_NULL);
+	visual_return_val_if_fail (visual_video_compare_ignore_pitch (src1, src2) == TRUE,
+			-VISUAL_ERROR_VIDEO_NOT_INDENTICAL);
+
+	switch (src1->depth) {
+		case VISUAL_VIDEO_DEPTH_8BIT:
+			blend = visual_alpha_blend_8;
+			break;
+
+		case VISUAL_VIDEO_DEPTH_16BIT:
+			blend = visual_alpha_blend_16;
+			break;
+
+		case VISUAL_VIDEO_DEPTH_24BIT:
+			blend = visual_alpha_blend_24;
+			break;
+
+		case VISUAL_VIDEO_DEPTH_32BIT:
+			blend = visual_alpha_blend_32;
+			break;
+
+		default:
+			return -VISUAL_ERROR_VIDEO_INVALID_DEPTH;
+	}
+
+	if (dest->depth == src1->depth) {
+		video_alpha_blend_rows (dest, src1, src2, blend, alpha);
+
+		return VISUAL_OK;
+	}
+
+	visual_return_val_if_fail (dest->depth != VISUAL_VIDEO_DEPTH_GL, -VISUAL_ERROR_VIDEO_INVALID_DEPTH);
+
+	if (dest->depth != VISUAL_VIDEO_DEPTH_8BIT && src1->depth != VISUAL_VIDEO_DEPTH_8BIT) {
+		visual_video_convert_blend (dest, src1, src2, blend, alpha);
+
+		return VISUAL_OK;
+	}
+
+	/* The palette conversions go through a blended copy */
+	temp = visual_video_new ();
+
+	visual_video_set_depth (temp, src1->depth);
+	visual_video_set_dimension (temp, src1->width, src1->height);
+	visual_video_set_palette (temp, src1->pal);
+	visual_video_allocate_buffer (temp);
+
+	video_alpha_blend_rows (temp, src1, src2, blend, alpha);
+
+	ret = visual_video_depth_transform (dest, temp);
+
+	visual_object_unref (VISUAL_OBJECT (temp));
+
+	return ret;
+}
+
 int visual_video_zoom_double (VisVideo *dest, VisVideo *src)
 {
 	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_VIDEO_NULL);
@@ -1742,11 +1649,16 @@ int visual_video_zoom_double (VisVideo *dest, VisVideo *src)
 static inline int is_valid_scale_method (VisVideoScaleMethod scale_method)
 {
     return scale_method == VISUAL_VIDEO_SCALE_NEAREST
-	    || scale_method == VISUAL_VIDEO_SCALE_BILINEAR;
+	    || scale_method == VISUAL_VIDEO_SCALE_BILINEAR
+	    || scale_method == VISUAL_VIDEO_SCALE_BICUBIC
+	    || scale_method == VISUAL_VIDEO_SCALE_LANCZOS;
 }
 
 int visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod method)
 {
+	VideoScaleBands job;
+	VideoScaleFunc scale;
+
 	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_VIDEO_NULL);
 	visual_return_val_if_fail (src != NULL, -VISUAL_ERROR_VIDEO_NULL);
 	visual_return_val_if_fail (dest->depth == src->depth, -VISUAL_ERROR_VIDEO_INVALID_DEPTH);
@@ -1762,49 +1674,62 @@ int visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod metho
 
 	switch (dest->depth) {
 		case VISUAL_VIDEO_DEPTH_8BIT:
-			if (method == VISUAL_VIDEO_SCALE_NEAREST)
-				visual_video_scale_nearest_color8 (dest, src);
-			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
-				visual_video_scale_bilinear_color8 (dest, src);
-
+		case VISUAL_VIDEO_DEPTH_16BIT:
+		case VISUAL_VIDEO_DEPTH_24BIT:
+		case VISUAL_VIDEO_DEPTH_32BIT:
 			break;
 
-		case VISUAL_VIDEO_DEPTH_16BIT:
-			if (method == VISUAL_VIDEO_SCALE_NEAREST)
-				visual_video_scale_nearest_color16 (dest, src);
-			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
-				visual_video_scale_bilinear_color16 (dest, src);
+		default:
+			visual_log (VISUAL_LOG_ERROR, _("Invalid depth passed to the scaler"));
+
+			return -VISUAL_ERROR_VIDEO_INVALID_DEPTH;
 
 			break;
+	}
 
-		case VISUAL_VIDEO_DEPTH_24BIT:
-			if (method == VISUAL_VIDEO_SCALE_NEAREST)
-				visual_video_scale_nearest_color24 (dest, src);
-			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
-				visual_video_scale_bilinear_color24 (dest, src);
+	job.hfilter = NULL;
+	job.vfilter = NULL;
+
+	switch (method) {
+		case VISUAL_VIDEO_SCALE_NEAREST:
+			scale = visual_video_scale_nearest;
 
 			break;
 
-		case VISUAL_VIDEO_DEPTH_32BIT:
-			if (method == VISUAL_VIDEO_SCALE_NEAREST)
-				visual_video_scale_nearest_color32 (dest, src);
-			else if (method == VISUAL_VIDEO_SCALE_BILINEAR) {
-				if (visual_cpu_get_mmx ())
-					_lv_scale_bilinear_32_mmx (dest, src);
-				else
-					visual_video_scale_bilinear_color32 (dest, src);
-			}
+		case VISUAL_VIDEO_SCALE_BILINEAR:
+			/* The MMX version rounds the fractions to 4 bits, only for the oldest CPUs */
+			if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT && visual_cpu_get_mmx () > 0 &&
+					visual_cpu_get_sse2 () == 0)
+				scale = scale_bilinear_color32_mmx;
+			else
+				scale = visual_video_scale_bilinear;
 
 			break;
 
 		default:
-			visual_log (VISUAL_LOG_ERROR, _("Invalid depth passed to the scaler"));
+			/* The filters are built once per size and shared by the bands */
+			scale = NULL;
 
-			return -VISUAL_ERROR_VIDEO_INVALID_DEPTH;
+			job.hfilter = visual_video_scale_filter_get (method, src->width, dest->width);
+			job.vfilter = visual_video_scale_filter_get (method, src->height, dest->height);
 
 			break;
 	}
 
+	/* The scalers take a row range, so the bands share the source */
+	job.dest = dest;
+	job.src = src;
+	job.scale = scale;
+	job.bands = visual_video_threads_get_bands (dest->width, dest->height);
+
+	visual_video_threads_run (job.bands, video_scale_band, &job);
+
+	if (job.hfilter != NULL)
+		visual_object_unref (VISUAL_OBJECT (job.hfilter));
+
+	if (job.vfilter != NULL)
+		visual_object_unref (VISUAL_OBJECT (job.vfilter));
+
 	return VISUAL_OK;
 }
 
@@ -1862,3 +1787,176 @@ VisVideo *visual_video_scale_depth_new (VisVideo *src, int width, int height, Vi
 
 	return video;
 }
+
+int visual_video_set_thread_count (int threads)
+{
+	visual_return_val_if_fail (threads >= 0, -VISUAL_ERROR_GENERAL);
+
+	__lv_video_thread_count = threads;
+
+	return VISUAL_OK;
+}
+
+int visual_video_get_thread_count ()
+{
+	if (__lv_video_thread_count == 0)
+		return visual_cpu_get_caps ()->nrcpu;
+
+	return __lv_video_thread_count;
+}
+
+static void video_region_band (void *priv, int band)
+{
+	VideoRegionBands *job = priv;
+
+	job->func (&job->dregions[band], job->hassrc == TRUE ? &job->sregions[band] : NULL, job->priv);
+}
+
+static void video_run_region_bands (VisVideo *dest, VisVideo *src, VideoBandFunc func, void *priv)
+{
+	VideoRegionBands job;
+	int height;
+	int bands;
+	int band;
+	int y0, y1;
+
+	height = dest->height;
+
+	if (src != NULL && src->height < height)
+		height = src->height;
+
+	bands = visual_video_threads_get_bands (dest->width, height);
+
+	if (bands <= 1) {
+		func (dest, src, priv);
+
+		return;
+	}
+
+	/* The regions are set up here, the workers only touch pixels */
+	for (band = 0; band < bands; band++) {
+		y0 = height * band / bands;
+		y1 = height * (band + 1) / bands;
+
+		visual_video_init (&job.dregions[band]);
+		visual_video_region_sub_by_values (&job.dregions[band], dest, 0, y0, dest->width, y1 - y0);
+
+		if (src != NULL) {
+			visual_video_init (&job.sregions[band]);
+			visual_video_region_sub_by_values (&job.sregions[band], src, 0, y0, src->width, y1 - y0);
+		}
+	}
+
+	job.hassrc = src != NULL;
+	job.func = func;
+	job.priv = priv;
+
+	visual_video_threads_run (bands, video_region_band, &job);
+
+	for (band = 0; band < bands; band++) {
+		visual_object_unref (VISUAL_OBJECT (&job.dregions[band]));
+
+		if (src != NULL)
+			visual_object_unref (VISUAL_OBJECT (&job.sregions[band]));
+	}
+}
+
+static void video_scale_band (void *priv, int band)
+{
+	VideoScaleBands *job = priv;
+	int y0 = job->dest->height * band / job->bands;
+	int y1 = job->dest->height * (band + 1) / job->bands;
+
+	if (job->scale != NULL)
+		job->scale (job->dest, job->src, y0, y1);
+	else
+		visual_video_scale_filtered (job->dest, job->src, job->hfilter, job->vfilter, y0, y1);
+}
+
+static void video_alpha_blend_rows (VisVideo *dest, VisVideo *src1, VisVideo *src2, VisAlphaBlendFunc blend,
+		uint8_t alpha)
+{
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	uint8_t *sbuf1 = visual_video_get_pixels (src1);
+	uint8_t *sbuf2 = visual_video_get_pixels (src2);
+	int w, h, y;
+
+	visual_video_convert_get_smallest (dest, src1, &w, &h);
+
+	/* Unpadded buffers blend as one run */
+	if (dest->width == w && dest->height == h && dest->pitch == w * dest->bpp &&
+			src1->pitch == w * src1->bpp && src2->pitch == w * src2->bpp) {
+		blend (dbuf, sbuf1, sbuf2, h * dest->pitch, alpha);
+
+		return;
+	}
+
+	for (y = 0; y < h; y++) {
+		blend (dbuf, sbuf1, sbuf2, w * dest->bpp, alpha);
+
+		dbuf += dest->pitch;
+		sbuf1 += src1->pitch;
+		sbuf2 += src2->pitch;
+	}
+}
+
+static int video_convert (VisVideo *dest, VisVideo *src, VideoConvertFunc convert)
+{
+	video_run_region_bands (dest, src, band_convert, &convert);
+
+	return VISUAL_OK;
+}
+
+static int video_convert_lookup (VisVideo *dest, VisVideo *src, VideoLookupFunc convert, const uint8_t *table)
+{
+	VideoLookupBand lookupband;
+
+	/* Without a table there is nothing to map onto */
+	if (table == NULL)
+		return -VISUAL_ERROR_PALETTE_SIZE;
+
+	lookupband.convert = convert;
+	lookupband.table = table;
+
+	video_run_region_bands (dest, src, band_convert_lookup, &lookupband);
+
+	return VISUAL_OK;
+}
+
+static void band_convert (VisVideo *dest, VisVideo *src, void *priv)
+{
+	VideoConvertFunc *convert = priv;
+
+	(*convert) (dest, src);
+}
+
+static void band_convert_lookup (VisVideo *dest, VisVideo *src, void *priv)
+{
+	VideoLookupBand *lookupband = priv;
+
+	lookupband->convert (dest, src, lookupband->table);
+}
+
+static void band_composite (VisVideo *dest, VisVideo *src, void *priv)
+{
+	VisVideoCustomCompositeFunc *compfunc = priv;
+
+	(*compfunc) (dest, src);
+}
+
+static void band_fill_color (VisVideo *dest, VisVideo *src, void *priv)
+{
+	VideoFillBand *fillband = priv;
+
+	fillband->fill (dest, fillband->color);
+}
+
+static void band_fill_alpha (VisVideo *dest, VisVideo *src, void *priv)
+{
+	fill_alpha (dest, *(uint8_t *) priv);
+}
+
+static void scale_bilinear_color32_mmx (VisVideo *dest, VisVideo *src, int y0, int y1)
+{
+	_lv_scale_bilinear_32_mmx_rows (dest, src, y0, y1);
+}
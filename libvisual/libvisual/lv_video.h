@@ -94,7 +94,9 @@ typedef enum {
  */
 typedef enum {
 	VISUAL_VIDEO_SCALE_NEAREST  = 0,    /**< Nearest neighbour. */
-	VISUAL_VIDEO_SCALE_BILINEAR = 1	    /**< Bilinearly interpolated. */
+	VISUAL_VIDEO_SCALE_BILINEAR = 1,    /**< Bilinearly interpolated. */
+	VISUAL_VIDEO_SCALE_BICUBIC  = 2,    /**< Separable Catmull-Rom bicubic filter. */
+	VISUAL_VIDEO_SCALE_LANCZOS  = 3     /**< Separable three lobed Lanczos filter, sharpest. */
 } VisVideoScaleMethod;
 
 /**
@@ -106,7 +108,8 @@ typedef enum {
 	VISUAL_VIDEO_COMPOSITE_TYPE_COLORKEY,   /**< Colorkey alpha. */
 	VISUAL_VIDEO_COMPOSITE_TYPE_SURFACE,    /**< One alpha channel for the complete surface. */
 	VISUAL_VIDEO_COMPOSITE_TYPE_SURFACECOLORKEY, /**< Use surface alpha on colorkey. */
-	VISUAL_VIDEO_COMPOSITE_TYPE_CUSTOM      /**< Custom composite function (looks up on the source VisVideo. */
+	VISUAL_VIDEO_COMPOSITE_TYPE_CUSTOM,     /**< Custom composite function (looks up on the source VisVideo. */
+	VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED /**< Source alpha channel, with the colors already weighted by it. */
 } VisVideoCompositeType;
 
 
@@ -630,6 +633,11 @@ VisVideo *visual_video_mirror_new (VisVideo *src, VisVideoMirrorOrient orient);
  * stored within the VisVideos. The dimension should be equal however the pitch
  * value of the destination may be set.
  *
+ * An 8 bits destination gets the nearest colors from its own palette, which is
+ * left as it is. The lookup is done at 16 bits, 24 and 32 bits sources are
+ * quantized to 5-6-5 first. See visual_palette_fill_color_cube() for a palette
+ * that suits truecolor sources.
+ *
  * @param dest Pointer to the destination VisVideo to which the source VisVideo is transformed.
  * @param src Pointer to the source VisVideo.
  *
@@ -638,6 +646,42 @@ VisVideo *visual_video_mirror_new (VisVideo *src, VisVideoMirrorOrient orient);
  */
 int visual_video_depth_transform (VisVideo *viddest, VisVideo *vidsrc);
 
+/**
+ * Alpha blends two VisVideos into a third, the way the alphablend morph does. The
+ * sources need the same depth and dimension, the destination may be of another depth
+ * and then gets the blend depth transformed in the same pass.
+ *
+ * @param dest Pointer to the destination VisVideo.
+ * @param src1 Pointer to the VisVideo shown at an alpha of 0.
+ * @param src2 Pointer to the VisVideo shown at an alpha of 255.
+ * @param alpha The weight of src2, from 0 to 255.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_VIDEO_NULL, -VISUAL_ERROR_VIDEO_NOT_INDENTICAL,
+ *	-VISUAL_ERROR_VIDEO_INVALID_DEPTH or error values returned by visual_video_depth_transform on failure.
+ */
+int visual_video_alpha_blend (VisVideo *dest, VisVideo *src1, VisVideo *src2, uint8_t alpha);
+
+/**
+ * Picks the fastest depth conversion and pixel byte flip kernels for the CPU, this
+ * is called from visual_init(). Call it again after changing the enabled CPU features.
+ * The kernels give identical results whichever are picked.
+ */
+void visual_video_convert_initialize (void);
+
+/**
+ * Picks the fastest scaler row kernels for the CPU, this is called from visual_init().
+ * Call it again after changing the enabled CPU features. The kernels give identical
+ * results whichever are picked.
+ */
+void visual_video_scale_initialize (void);
+
+/**
+ * Picks the fastest compositor row kernels for the CPU, this is called from visual_init().
+ * Call it again after changing the enabled CPU features. The kernels give identical
+ * results whichever are picked.
+ */
+void visual_video_composite_initialize (void);
+
 VisVideo *visual_video_zoom_new (VisVideo *src, VisVideoScaleMethod scale_method, float zoom_factor);
 
 /**
@@ -706,10 +750,32 @@ int visual_video_scale_depth (VisVideo *dest, VisVideo *src, VisVideoScaleMethod
 VisVideo *visual_video_scale_depth_new (VisVideo *src, int width, int height, VisVideoDepth depth,
 		VisVideoScaleMethod scale_method);
 
+/**
+ * Sets the number of threads, the calling thread included, over which large
+ * scale, depth transform, blit and fill operations are split in horizontal
+ * bands. Surfaces that are too small to benefit are always handled on the
+ * calling thread.
+ *
+ * @param threads The number of threads, 1 disables threading and 0 uses one thread per CPU.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_GENERAL on failure.
+ */
+int visual_video_set_thread_count (int threads);
+
+/**
+ * Gives the number of threads VisVideo operations are split over.
+ *
+ * @see visual_video_set_thread_count
+ *
+ * @return The number of threads, the calling thread included.
+ */
+int visual_video_get_thread_count (void);
+
 /* Optimized versions of performance sensitive routines */
 /* mmx from lv_video_simd.c */ /* FIXME can we do this nicer ? */
 int _lv_blit_overlay_alphasrc_mmx (VisVideo *dest, VisVideo *src);
 int _lv_scale_bilinear_32_mmx (VisVideo *dest, VisVideo *src);
+int _lv_scale_bilinear_32_mmx_rows (VisVideo *dest, VisVideo *src, int y0, int y1);
 
 VISUAL_END_DECLS
 
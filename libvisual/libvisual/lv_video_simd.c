@@ -35,7 +35,8 @@ int _lv_blit_overlay_alphasrc_mmx (VisVideo *dest, VisVideo *src)
 	for (i = 0; i < src->height; i++) {
 		for (j = 0; j < src->width; j++) {
 			__asm __volatile
-				("\n\t movd %[spix], %%mm0"
+				("\n\t pxor %%mm6, %%mm6"
+				 "\n\t movd %[spix], %%mm0"
 				 "\n\t movd %[dpix], %%mm1"
 				 "\n\t movq %%mm0, %%mm2"
 				 "\n\t movq %%mm0, %%mm3"
@@ -67,6 +68,8 @@ int _lv_blit_overlay_alphasrc_mmx (VisVideo *dest, VisVideo *src)
 		srcbuf += src->pitch - (src->width * src->bpp);
 	}
 
+	__asm __volatile ("\n\t emms");
+
 	return VISUAL_OK;
 #else /* !VISUAL_ARCH_X86 */
 	return VISUAL_ERROR_CPU_INVALID_CODE;
@@ -74,19 +77,24 @@ int _lv_blit_overlay_alphasrc_mmx (VisVideo *dest, VisVideo *src)
 }
 
 int _lv_scale_bilinear_32_mmx (VisVideo *dest, VisVideo *src)
+{
+	return _lv_scale_bilinear_32_mmx_rows (dest, src, 0, dest->height);
+}
+
+int _lv_scale_bilinear_32_mmx_rows (VisVideo *dest, VisVideo *src, int y0, int y1)
 {
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 	uint32_t y;
 	uint32_t u, v, du, dv; /* fixed point 16.16 */
 	uint32_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
 
-	dest_pixel = visual_video_get_pixels (dest);
+	dest_pixel = (uint32_t *) ((uint8_t *) visual_video_get_pixels (dest) + y0 * dest->pitch);
 
 	du = ((src->width - 1)  << 16) / dest->width;
 	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+	v = y0 * dv;
 
-	for (y = dest->height; y--; v += dv) {
+	for (y = y0; y < (uint32_t) y1; y++, v += dv) {
 		uint32_t x;
 		uint32_t fracU, fracV;     /* fixed point 28.4 [0,1[    */
 
@@ -0,0 +1,930 @@
+#include "config.h"
+#include "lv_audio.h"
+#include "lv_common.h"
+#include "lv_cpu.h"
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every conversion goes through a pivot format: signed 32 bits integers, aligned to
+ * the most significant bit. Integer formats are widened by shifting left and narrowed
+ * by an arithmetic shift right, the unsigned formats flip the sign bit on top of
+ * that. Floats map [-1.0, 1.0) onto the full 32 bits range, they are clamped and
+ * truncated on the way in, NaN becomes -1.0.
+ *
+ * That leaves one kernel per format and direction instead of one per pair, and the
+ * vector kernels give bit identical results to the C ones below.
+ */
+
+#define CONVERT_CHUNK		512
+
+#define PIVOT_FLOAT_SCALE	2147483648.0f
+#define PIVOT_FLOAT_MIN		-2147483648.0f
+#define PIVOT_FLOAT_MAX		2147483520.0f	/* Largest float below 2^31 */
+
+typedef void (*ToPivotFunc)(int32_t *dest, const void *src, int n);
+typedef void (*FromPivotFunc)(void *dest, const int32_t *src, int n);
+
+static void to_pivot_u8_c (int32_t *dest, const void *src, int n);
+static void to_pivot_s8_c (int32_t *dest, const void *src, int n);
+static void to_pivot_u16_c (int32_t *dest, const void *src, int n);
+static void to_pivot_s16_c (int32_t *dest, const void *src, int n);
+static void to_pivot_u32_c (int32_t *dest, const void *src, int n);
+static void to_pivot_s32_c (int32_t *dest, const void *src, int n);
+static void to_pivot_float_c (int32_t *dest, const void *src, int n);
+
+static void from_pivot_u8_c (void *dest, const int32_t *src, int n);
+static void from_pivot_s8_c (void *dest, const int32_t *src, int n);
+static void from_pivot_u16_c (void *dest, const int32_t *src, int n);
+static void from_pivot_s16_c (void *dest, const int32_t *src, int n);
+static void from_pivot_u32_c (void *dest, const int32_t *src, int n);
+static void from_pivot_s32_c (void *dest, const int32_t *src, int n);
+static void from_pivot_float_c (void *dest, const int32_t *src, int n);
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static void to_pivot_u8_sse2 (int32_t *dest, const void *src, int n);
+static void to_pivot_s8_sse2 (int32_t *dest, const void *src, int n);
+static void to_pivot_u16_sse2 (int32_t *dest, const void *src, int n);
+static void to_pivot_s16_sse2 (int32_t *dest, const void *src, int n);
+static void to_pivot_u32_sse2 (int32_t *dest, const void *src, int n);
+static void to_pivot_float_sse2 (int32_t *dest, const void *src, int n);
+
+static void from_pivot_u8_sse2 (void *dest, const int32_t *src, int n);
+static void from_pivot_s8_sse2 (void *dest, const int32_t *src, int n);
+static void from_pivot_u16_sse2 (void *dest, const int32_t *src, int n);
+static void from_pivot_s16_sse2 (void *dest, const int32_t *src, int n);
+static void from_pivot_u32_sse2 (void *dest, const int32_t *src, int n);
+static void from_pivot_float_sse2 (void *dest, const int32_t *src, int n);
+
+static void to_pivot_u8_avx2 (int32_t *dest, const void *src, int n);
+static void to_pivot_s8_avx2 (int32_t *dest, const void *src, int n);
+static void to_pivot_u16_avx2 (int32_t *dest, const void *src, int n);
+static void to_pivot_s16_avx2 (int32_t *dest, const void *src, int n);
+static void to_pivot_u32_avx2 (int32_t *dest, const void *src, int n);
+static void to_pivot_float_avx2 (int32_t *dest, const void *src, int n);
+
+static void from_pivot_u16_avx2 (void *dest, const int32_t *src, int n);
+static void from_pivot_s16_avx2 (void *dest, const int32_t *src, int n);
+static void from_pivot_u32_avx2 (void *dest, const int32_t *src, int n);
+static void from_pivot_float_avx2 (void *dest, const int32_t *src, int n);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void to_pivot_u8_neon (int32_t *dest, const void *src, int n);
+static void to_pivot_s8_neon (int32_t *dest, const void *src, int n);
+static void to_pivot_u16_neon (int32_t *dest, const void *src, int n);
+static void to_pivot_s16_neon (int32_t *dest, const void *src, int n);
+static void to_pivot_u32_neon (int32_t *dest, const void *src, int n);
+static void to_pivot_float_neon (int32_t *dest, const void *src, int n);
+
+static void from_pivot_u8_neon (void *dest, const int32_t *src, int n);
+static void from_pivot_s8_neon (void *dest, const int32_t *src, int n);
+static void from_pivot_u16_neon (void *dest, const int32_t *src, int n);
+static void from_pivot_s16_neon (void *dest, const int32_t *src, int n);
+static void from_pivot_u32_neon (void *dest, const int32_t *src, int n);
+static void from_pivot_float_neon (void *dest, const int32_t *src, int n);
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
+
+/* Optimal kernels set by visual_audio_sample_convert_initialize(). */
+
+static ToPivotFunc to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_LAST] = {
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= to_pivot_u8_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= to_pivot_s8_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= to_pivot_u16_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= to_pivot_s16_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= to_pivot_u32_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S32]	= to_pivot_s32_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= to_pivot_float_c
+};
+
+static FromPivotFunc from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_LAST] = {
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= from_pivot_u8_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= from_pivot_s8_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= from_pivot_u16_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= from_pivot_s16_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= from_pivot_u32_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S32]	= from_pivot_s32_c,
+	[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= from_pivot_float_c
+};
+
+void visual_audio_sample_convert_initialize (void)
+{
+	/* Arranged from slow to fast, so the slower version gets overloaded
+	 * every time */
+
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= to_pivot_u8_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= to_pivot_s8_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= to_pivot_u16_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= to_pivot_s16_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= to_pivot_u32_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S32]	= to_pivot_s32_c;
+	to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= to_pivot_float_c;
+
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]	= from_pivot_u8_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]	= from_pivot_s8_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= from_pivot_u16_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= from_pivot_s16_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= from_pivot_u32_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S32]	= from_pivot_s32_c;
+	from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= from_pivot_float_c;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+	if (visual_cpu_get_sse2 () > 0) {
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= to_pivot_u8_sse2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= to_pivot_s8_sse2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= to_pivot_u16_sse2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= to_pivot_s16_sse2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= to_pivot_u32_sse2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= to_pivot_float_sse2;
+
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]	= from_pivot_u8_sse2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]	= from_pivot_s8_sse2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= from_pivot_u16_sse2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= from_pivot_s16_sse2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= from_pivot_u32_sse2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= from_pivot_float_sse2;
+	}
+
+	/* Narrowing to 8 bits stays with sse2, the lane crossing packs make it no faster */
+	if (visual_cpu_get_avx2 () > 0) {
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= to_pivot_u8_avx2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= to_pivot_s8_avx2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= to_pivot_u16_avx2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= to_pivot_s16_avx2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= to_pivot_u32_avx2;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= to_pivot_float_avx2;
+
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= from_pivot_u16_avx2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= from_pivot_s16_avx2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= from_pivot_u32_avx2;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= from_pivot_float_avx2;
+	}
+
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+	if (visual_cpu_get_neon () > 0) {
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= to_pivot_u8_neon;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= to_pivot_s8_neon;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= to_pivot_u16_neon;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= to_pivot_s16_neon;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= to_pivot_u32_neon;
+		to_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= to_pivot_float_neon;
+
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U8]	= from_pivot_u8_neon;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S8]	= from_pivot_s8_neon;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= from_pivot_u16_neon;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= from_pivot_s16_neon;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= from_pivot_u32_neon;
+		from_pivot[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= from_pivot_float_neon;
+	}
+
+#endif
+}
+
+int visual_audio_sample_convert (void *dest, VisAudioSampleFormatType dformat,
+		const void *src, VisAudioSampleFormatType sformat, int samples)
+{
+	int32_t pivot[CONVERT_CHUNK];
+	const uint8_t *s = src;
+	uint8_t *d = dest;
+	int ssize, dsize;
+	int n;
+
+	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (src != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (dformat > VISUAL_AUDIO_SAMPLE_FORMAT_NONE &&
+			dformat < VISUAL_AUDIO_SAMPLE_FORMAT_LAST, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (sformat > VISUAL_AUDIO_SAMPLE_FORMAT_NONE &&
+			sformat < VISUAL_AUDIO_SAMPLE_FORMAT_LAST, -VISUAL_ERROR_NULL);
+
+	ssize = visual_audio_sample_format_get_size (sformat);
+	dsize = visual_audio_sample_format_get_size (dformat);
+
+	if (samples <= 0)
+		return VISUAL_OK;
+
+	if (sformat == dformat) {
+		visual_mem_copy (dest, src, samples * ssize);
+
+		return VISUAL_OK;
+	}
+
+	/* One side already is the pivot format */
+	if (sformat == VISUAL_AUDIO_SAMPLE_FORMAT_S32) {
+		from_pivot[dformat] (dest, src, samples);
+
+		return VISUAL_OK;
+	}
+
+	if (dformat == VISUAL_AUDIO_SAMPLE_FORMAT_S32) {
+		to_pivot[sformat] (dest, src, samples);
+
+		return VISUAL_OK;
+	}
+
+	/* Chunked so the pivot stays in the cache */
+	while (samples > 0) {
+		n = samples > CONVERT_CHUNK ? CONVERT_CHUNK : samples;
+
+		to_pivot[sformat] (pivot, s, n);
+		from_pivot[dformat] (d, pivot, n);
+
+		s += n * ssize;
+		d += n * dsize;
+		samples -= n;
+	}
+
+	return VISUAL_OK;
+}
+
+/* C kernels, these define the results */
+
+#define TO_PIVOT_C(name, type, expr)						\
+	static void to_pivot_##name##_c (int32_t *dest, const void *src, int n)	\
+	{									\
+		const type *s = src;						\
+		int i;								\
+										\
+		for (i = 0; i < n; i++)						\
+			dest[i] = expr;						\
+	}
+
+#define FROM_PIVOT_C(name, type, expr)						\
+	static void from_pivot_##name##_c (void *dest, const int32_t *src, int n) \
+	{									\
+		type *d = dest;							\
+		int i;								\
+										\
+		for (i = 0; i < n; i++)						\
+			d[i] = expr;						\
+	}
+
+static inline int32_t pivot_from_float (float sample)
+{
+	float v = sample * PIVOT_FLOAT_SCALE;
+
+	if (!(v >= PIVOT_FLOAT_MIN))
+		v = PIVOT_FLOAT_MIN;
+	else if (v > PIVOT_FLOAT_MAX)
+		v = PIVOT_FLOAT_MAX;
+
+	return (int32_t) v;
+}
+
+TO_PIVOT_C (u8, uint8_t, (int32_t) ((uint32_t) (s[i] ^ 0x80) << 24))
+TO_PIVOT_C (s8, int8_t, (int32_t) ((uint32_t) (uint8_t) s[i] << 24))
+TO_PIVOT_C (u16, uint16_t, (int32_t) ((uint32_t) (s[i] ^ 0x8000) << 16))
+TO_PIVOT_C (s16, int16_t, (int32_t) ((uint32_t) (uint16_t) s[i] << 16))
+TO_PIVOT_C (u32, uint32_t, (int32_t) (s[i] ^ 0x80000000))
+TO_PIVOT_C (s32, int32_t, s[i])
+TO_PIVOT_C (float, float, pivot_from_float (s[i]))
+
+FROM_PIVOT_C (u8, uint8_t, ((uint32_t) src[i] >> 24) ^ 0x80)
+FROM_PIVOT_C (s8, int8_t, src[i] >> 24)
+FROM_PIVOT_C (u16, uint16_t, ((uint32_t) src[i] >> 16) ^ 0x8000)
+FROM_PIVOT_C (s16, int16_t, src[i] >> 16)
+FROM_PIVOT_C (u32, uint32_t, (uint32_t) src[i] ^ 0x80000000)
+FROM_PIVOT_C (s32, int32_t, src[i])
+FROM_PIVOT_C (float, float, src[i] * (1.0f / PIVOT_FLOAT_SCALE))
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+/* Sign flip masks for the unsigned formats, wide enough for a ymm register */
+static const uint32_t mask_none[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+static const uint32_t mask_8[8] = {
+	0x80808080, 0x80808080, 0x80808080, 0x80808080,
+	0x80808080, 0x80808080, 0x80808080, 0x80808080
+};
+static const uint32_t mask_16[8] = {
+	0x80008000, 0x80008000, 0x80008000, 0x80008000,
+	0x80008000, 0x80008000, 0x80008000, 0x80008000
+};
+static const uint32_t mask_32[8] = {
+	0x80000000, 0x80000000, 0x80000000, 0x80000000,
+	0x80000000, 0x80000000, 0x80000000, 0x80000000
+};
+
+/* Scale, lower and upper clamp for the float to pivot conversion */
+static const float float_to_pivot[24] = {
+	PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE,
+	PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE, PIVOT_FLOAT_SCALE,
+	PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN,
+	PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN, PIVOT_FLOAT_MIN,
+	PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX,
+	PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX, PIVOT_FLOAT_MAX
+};
+
+static const float pivot_to_float[8] = {
+	1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE,
+	1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE, 1.0f / PIVOT_FLOAT_SCALE
+};
+
+/* Bytes are interleaved with zeroes twice, which leaves them in the top byte */
+static int to_pivot_8_sse2 (int32_t *dest, const uint8_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t pxor %%xmm6, %%xmm0"
+			 "\n\t movdqa %%xmm7, %%xmm1"
+			 "\n\t punpcklbw %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm7, %%xmm3"
+			 "\n\t punpcklwd %%xmm1, %%xmm3"
+			 "\n\t movdqa %%xmm7, %%xmm4"
+			 "\n\t punpckhwd %%xmm1, %%xmm4"
+			 "\n\t movdqu %%xmm3, (%[d])"
+			 "\n\t movdqu %%xmm4, 16(%[d])"
+			 "\n\t movdqa %%xmm7, %%xmm3"
+			 "\n\t punpcklwd %%xmm2, %%xmm3"
+			 "\n\t movdqa %%xmm7, %%xmm4"
+			 "\n\t punpckhwd %%xmm2, %%xmm4"
+			 "\n\t movdqu %%xmm3, 32(%[d])"
+			 "\n\t movdqu %%xmm4, 48(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm6", "xmm7");
+	}
+
+	return i;
+}
+
+static int to_pivot_16_sse2 (int32_t *dest, const uint16_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t pxor %%xmm6, %%xmm0"
+			 "\n\t movdqa %%xmm7, %%xmm1"
+			 "\n\t punpcklwd %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm7, %%xmm2"
+			 "\n\t punpckhwd %%xmm0, %%xmm2"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 "\n\t movdqu %%xmm2, 16(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm6", "xmm7");
+	}
+
+	return i;
+}
+
+static int flip_32_sse2 (uint32_t *dest, const uint32_t *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm1"
+			 "\n\t pxor %%xmm6, %%xmm0"
+			 "\n\t pxor %%xmm6, %%xmm1"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask_32)
+			 : "memory", "xmm0", "xmm1", "xmm6");
+	}
+
+	return i;
+}
+
+static void to_pivot_u8_sse2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_sse2 (dest, src, n, mask_8);
+
+	to_pivot_u8_c (dest + i, (const uint8_t *) src + i, n - i);
+}
+
+static void to_pivot_s8_sse2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_sse2 (dest, src, n, mask_none);
+
+	to_pivot_s8_c (dest + i, (const int8_t *) src + i, n - i);
+}
+
+static void to_pivot_u16_sse2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_sse2 (dest, src, n, mask_16);
+
+	to_pivot_u16_c (dest + i, (const uint16_t *) src + i, n - i);
+}
+
+static void to_pivot_s16_sse2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_sse2 (dest, src, n, mask_none);
+
+	to_pivot_s16_c (dest + i, (const int16_t *) src + i, n - i);
+}
+
+static void to_pivot_u32_sse2 (int32_t *dest, const void *src, int n)
+{
+	int i = flip_32_sse2 ((uint32_t *) dest, src, n);
+
+	to_pivot_u32_c (dest + i, (const uint32_t *) src + i, n - i);
+}
+
+static void to_pivot_float_sse2 (int32_t *dest, const void *src, int n)
+{
+	const float *s = src;
+	int i;
+
+	/* maxps returns the clamp value when the sample is NaN, like the C version */
+	for (i = 0; i + 4 <= n; i += 4) {
+		__asm __volatile
+			("\n\t movups (%[c]), %%xmm5"
+			 "\n\t movups 32(%[c]), %%xmm6"
+			 "\n\t movups 64(%[c]), %%xmm7"
+			 "\n\t movups (%[s]), %%xmm0"
+			 "\n\t mulps %%xmm5, %%xmm0"
+			 "\n\t maxps %%xmm6, %%xmm0"
+			 "\n\t minps %%xmm7, %%xmm0"
+			 "\n\t cvttps2dq %%xmm0, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (s + i), [c] "r" (float_to_pivot)
+			 : "memory", "xmm0", "xmm5", "xmm6", "xmm7");
+	}
+
+	to_pivot_float_c (dest + i, s + i, n - i);
+}
+
+static int from_pivot_8_sse2 (uint8_t *dest, const int32_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm1"
+			 "\n\t movdqu 32(%[s]), %%xmm2"
+			 "\n\t movdqu 48(%[s]), %%xmm3"
+			 "\n\t psrad $24, %%xmm0"
+			 "\n\t psrad $24, %%xmm1"
+			 "\n\t psrad $24, %%xmm2"
+			 "\n\t psrad $24, %%xmm3"
+			 "\n\t packssdw %%xmm1, %%xmm0"
+			 "\n\t packssdw %%xmm3, %%xmm2"
+			 "\n\t packsswb %%xmm2, %%xmm0"
+			 "\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t pxor %%xmm6, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6");
+	}
+
+	return i;
+}
+
+static int from_pivot_16_sse2 (uint16_t *dest, const int32_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm1"
+			 "\n\t psrad $16, %%xmm0"
+			 "\n\t psrad $16, %%xmm1"
+			 "\n\t packssdw %%xmm1, %%xmm0"
+			 "\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t pxor %%xmm6, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm6");
+	}
+
+	return i;
+}
+
+static void from_pivot_u8_sse2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_8_sse2 (dest, src, n, mask_8);
+
+	from_pivot_u8_c ((uint8_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_s8_sse2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_8_sse2 (dest, src, n, mask_none);
+
+	from_pivot_s8_c ((int8_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_u16_sse2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_sse2 (dest, src, n, mask_16);
+
+	from_pivot_u16_c ((uint16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_s16_sse2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_sse2 (dest, src, n, mask_none);
+
+	from_pivot_s16_c ((int16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_u32_sse2 (void *dest, const int32_t *src, int n)
+{
+	int i = flip_32_sse2 (dest, (const uint32_t *) src, n);
+
+	from_pivot_u32_c ((uint32_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_float_sse2 (void *dest, const int32_t *src, int n)
+{
+	float *d = dest;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__asm __volatile
+			("\n\t movups (%[c]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t cvtdq2ps %%xmm0, %%xmm0"
+			 "\n\t mulps %%xmm7, %%xmm0"
+			 "\n\t movups %%xmm0, (%[d])"
+			 :: [d] "r" (d + i), [s] "r" (src + i), [c] "r" (pivot_to_float)
+			 : "memory", "xmm0", "xmm7");
+	}
+
+	from_pivot_float_c (d + i, src + i, n - i);
+}
+
+/* The avx2 kernels sign extend straight from memory, vzeroupper is issued once the
+ * loop is done so the sse code that follows does not pay for the transition */
+static int to_pivot_8_avx2 (int32_t *dest, const uint8_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vmovdqu (%[m]), %%xmm6"
+			 "\n\t vpxor (%[s]), %%xmm6, %%xmm0"
+			 "\n\t vpmovsxbd %%xmm0, %%ymm1"
+			 "\n\t vpsrldq $8, %%xmm0, %%xmm0"
+			 "\n\t vpmovsxbd %%xmm0, %%ymm2"
+			 "\n\t vpslld $24, %%ymm1, %%ymm1"
+			 "\n\t vpslld $24, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu %%ymm1, (%[d])"
+			 "\n\t vmovdqu %%ymm2, 32(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm6");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	return i;
+}
+
+static int to_pivot_16_avx2 (int32_t *dest, const uint16_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vmovdqu (%[m]), %%xmm6"
+			 "\n\t vpxor (%[s]), %%xmm6, %%xmm0"
+			 "\n\t vpxor 16(%[s]), %%xmm6, %%xmm1"
+			 "\n\t vpmovsxwd %%xmm0, %%ymm0"
+			 "\n\t vpmovsxwd %%xmm1, %%ymm1"
+			 "\n\t vpslld $16, %%ymm0, %%ymm0"
+			 "\n\t vpslld $16, %%ymm1, %%ymm1"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 "\n\t vmovdqu %%ymm1, 32(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1", "xmm6");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	return i;
+}
+
+static int flip_32_avx2 (uint32_t *dest, const uint32_t *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vmovdqu (%[m]), %%ymm6"
+			 "\n\t vpxor (%[s]), %%ymm6, %%ymm0"
+			 "\n\t vpxor 32(%[s]), %%ymm6, %%ymm1"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 "\n\t vmovdqu %%ymm1, 32(%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask_32)
+			 : "memory", "xmm0", "xmm1", "xmm6");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	return i;
+}
+
+static void to_pivot_u8_avx2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_avx2 (dest, src, n, mask_8);
+
+	to_pivot_u8_c (dest + i, (const uint8_t *) src + i, n - i);
+}
+
+static void to_pivot_s8_avx2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_avx2 (dest, src, n, mask_none);
+
+	to_pivot_s8_c (dest + i, (const int8_t *) src + i, n - i);
+}
+
+static void to_pivot_u16_avx2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_avx2 (dest, src, n, mask_16);
+
+	to_pivot_u16_c (dest + i, (const uint16_t *) src + i, n - i);
+}
+
+static void to_pivot_s16_avx2 (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_avx2 (dest, src, n, mask_none);
+
+	to_pivot_s16_c (dest + i, (const int16_t *) src + i, n - i);
+}
+
+static void to_pivot_u32_avx2 (int32_t *dest, const void *src, int n)
+{
+	int i = flip_32_avx2 ((uint32_t *) dest, src, n);
+
+	to_pivot_u32_c (dest + i, (const uint32_t *) src + i, n - i);
+}
+
+static void to_pivot_float_avx2 (int32_t *dest, const void *src, int n)
+{
+	const float *s = src;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t vmovups (%[c]), %%ymm5"
+			 "\n\t vmovups 32(%[c]), %%ymm6"
+			 "\n\t vmovups 64(%[c]), %%ymm7"
+			 "\n\t vmulps (%[s]), %%ymm5, %%ymm0"
+			 "\n\t vmaxps %%ymm6, %%ymm0, %%ymm0"
+			 "\n\t vminps %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vcvttps2dq %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (s + i), [c] "r" (float_to_pivot)
+			 : "memory", "xmm0", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	to_pivot_float_c (dest + i, s + i, n - i);
+}
+
+/* vpackssdw packs within the 128 bits lanes, vpermq puts the quadwords back in order */
+static int from_pivot_16_avx2 (uint16_t *dest, const int32_t *src, int n, const uint32_t *mask)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu 32(%[s]), %%ymm1"
+			 "\n\t vpsrad $16, %%ymm0, %%ymm0"
+			 "\n\t vpsrad $16, %%ymm1, %%ymm1"
+			 "\n\t vpackssdw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpermq $0xd8, %%ymm0, %%ymm0"
+			 "\n\t vpxor (%[m]), %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [m] "r" (mask)
+			 : "memory", "xmm0", "xmm1");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	return i;
+}
+
+static void from_pivot_u16_avx2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_avx2 (dest, src, n, mask_16);
+
+	from_pivot_u16_c ((uint16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_s16_avx2 (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_avx2 (dest, src, n, mask_none);
+
+	from_pivot_s16_c ((int16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_u32_avx2 (void *dest, const int32_t *src, int n)
+{
+	int i = flip_32_avx2 (dest, (const uint32_t *) src, n);
+
+	from_pivot_u32_c ((uint32_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_float_avx2 (void *dest, const int32_t *src, int n)
+{
+	float *d = dest;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t vmovups (%[c]), %%ymm7"
+			 "\n\t vcvtdq2ps (%[s]), %%ymm0"
+			 "\n\t vmulps %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vmovups %%ymm0, (%[d])"
+			 :: [d] "r" (d + i), [s] "r" (src + i), [c] "r" (pivot_to_float)
+			 : "memory", "xmm0", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	from_pivot_float_c (d + i, src + i, n - i);
+}
+
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+static int to_pivot_8_neon (int32_t *dest, const uint8_t *src, int n, uint8_t mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int8x8_t v = vreinterpret_s8_u8 (veor_u8 (vld1_u8 (src + i), vdup_n_u8 (mask)));
+		int16x8_t w = vshll_n_s8 (v, 8);
+
+		vst1q_s32 (dest + i, vshll_n_s16 (vget_low_s16 (w), 16));
+		vst1q_s32 (dest + i + 4, vshll_n_s16 (vget_high_s16 (w), 16));
+	}
+
+	return i;
+}
+
+static int to_pivot_16_neon (int32_t *dest, const uint16_t *src, int n, uint16_t mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int16x8_t v = vreinterpretq_s16_u16 (veorq_u16 (vld1q_u16 (src + i), vdupq_n_u16 (mask)));
+
+		vst1q_s32 (dest + i, vshll_n_s16 (vget_low_s16 (v), 16));
+		vst1q_s32 (dest + i + 4, vshll_n_s16 (vget_high_s16 (v), 16));
+	}
+
+	return i;
+}
+
+static int flip_32_neon (uint32_t *dest, const uint32_t *src, int n)
+{
+	uint32x4_t mask = vdupq_n_u32 (0x80000000);
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		vst1q_u32 (dest + i, veorq_u32 (vld1q_u32 (src + i), mask));
+
+	return i;
+}
+
+static void to_pivot_u8_neon (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_neon (dest, src, n, 0x80);
+
+	to_pivot_u8_c (dest + i, (const uint8_t *) src + i, n - i);
+}
+
+static void to_pivot_s8_neon (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_8_neon (dest, src, n, 0);
+
+	to_pivot_s8_c (dest + i, (const int8_t *) src + i, n - i);
+}
+
+static void to_pivot_u16_neon (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_neon (dest, src, n, 0x8000);
+
+	to_pivot_u16_c (dest + i, (const uint16_t *) src + i, n - i);
+}
+
+static void to_pivot_s16_neon (int32_t *dest, const void *src, int n)
+{
+	int i = to_pivot_16_neon (dest, src, n, 0);
+
+	to_pivot_s16_c (dest + i, (const int16_t *) src + i, n - i);
+}
+
+static void to_pivot_u32_neon (int32_t *dest, const void *src, int n)
+{
+	int i = flip_32_neon ((uint32_t *) dest, src, n);
+
+	to_pivot_u32_c (dest + i, (const uint32_t *) src + i, n - i);
+}
+
+static void to_pivot_float_neon (int32_t *dest, const void *src, int n)
+{
+	float32x4_t lo = vdupq_n_f32 (PIVOT_FLOAT_MIN);
+	float32x4_t hi = vdupq_n_f32 (PIVOT_FLOAT_MAX);
+	const float *s = src;
+	int i;
+
+	/* vmaxq passes NaN through, the compare and select turns it into the clamp value */
+	for (i = 0; i + 4 <= n; i += 4) {
+		float32x4_t v = vmulq_n_f32 (vld1q_f32 (s + i), PIVOT_FLOAT_SCALE);
+
+		v = vbslq_f32 (vcgeq_f32 (v, lo), v, lo);
+		v = vminq_f32 (v, hi);
+
+		vst1q_s32 (dest + i, vcvtq_s32_f32 (v));
+	}
+
+	to_pivot_float_c (dest + i, s + i, n - i);
+}
+
+static int from_pivot_8_neon (uint8_t *dest, const int32_t *src, int n, uint8_t mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int16x8_t w = vcombine_s16 (vshrn_n_s32 (vld1q_s32 (src + i), 16),
+				vshrn_n_s32 (vld1q_s32 (src + i + 4), 16));
+
+		vst1_u8 (dest + i, veor_u8 (vreinterpret_u8_s8 (vshrn_n_s16 (w, 8)), vdup_n_u8 (mask)));
+	}
+
+	return i;
+}
+
+static int from_pivot_16_neon (uint16_t *dest, const int32_t *src, int n, uint16_t mask)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int16x8_t w = vcombine_s16 (vshrn_n_s32 (vld1q_s32 (src + i), 16),
+				vshrn_n_s32 (vld1q_s32 (src + i + 4), 16));
+
+		vst1q_u16 (dest + i, veorq_u16 (vreinterpretq_u16_s16 (w), vdupq_n_u16 (mask)));
+	}
+
+	return i;
+}
+
+static void from_pivot_u8_neon (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_8_neon (dest, src, n, 0x80);
+
+	from_pivot_u8_c ((uint8_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_s8_neon (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_8_neon (dest, src, n, 0);
+
+	from_pivot_s8_c ((int8_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_u16_neon (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_neon (dest, src, n, 0x8000);
+
+	from_pivot_u16_c ((uint16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_s16_neon (void *dest, const int32_t *src, int n)
+{
+	int i = from_pivot_16_neon (dest, src, n, 0);
+
+	from_pivot_s16_c ((int16_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_u32_neon (void *dest, const int32_t *src, int n)
+{
+	int i = flip_32_neon (dest, (const uint32_t *) src, n);
+
+	from_pivot_u32_c ((uint32_t *) dest + i, src + i, n - i);
+}
+
+static void from_pivot_float_neon (void *dest, const int32_t *src, int n)
+{
+	float *d = dest;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+		vst1q_f32 (d + i, vmulq_n_f32 (vcvtq_f32_s32 (vld1q_s32 (src + i)), 1.0f / PIVOT_FLOAT_SCALE));
+
+	from_pivot_float_c (d + i, src + i, n - i);
+}
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
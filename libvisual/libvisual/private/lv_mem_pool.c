@@ -0,0 +1,444 @@
+#include "config.h"
+#include "lv_mem_pool.h"
+#include "lv_common.h"
+#include "lv_atomic.h"
+#include "lv_thread.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef VISUAL_THREAD_MODEL_POSIX
+#include <pthread.h>
+#endif
+
+/*
+ * The slab allocator has a pool per size class. Every thread keeps a short freelist
+ * per pool, allocating and freeing from it takes no locks. When a freelist runs empty
+ * or grows too long, a batch of blocks moves from or to the shared list of the pool,
+ * which is guarded by a spin lock. Threads flush their freelists when they exit.
+ * Blocks are carved out of slabs that come straight from malloc and are never freed.
+ * Without thread local storage every block goes through the shared list.
+ *
+ * Every thread also has a frame arena, a chunk that is handed out by bumping an
+ * offset. Requests that don't fit get a chunk of their own, at the end of the frame
+ * those are freed and the main chunk grows to fit them all next time.
+ */
+
+/* Blocks a thread keeps per pool, and the number moved at once */
+#define POOL_CACHE_MAX		64
+#define POOL_CACHE_BATCH	32
+
+/* Slabs are carved in blocks of one size class, the first bytes link the slabs */
+#define POOL_SLAB_SIZE		(64 * 1024)
+#define POOL_SLAB_HEADER	16
+#define POOL_SLAB_MAX_BLOCK	2048
+
+/* Frame arena chunks start this large, and are rounded to this */
+#define ARENA_CHUNK_MIN		(16 * 1024)
+#define ARENA_ALIGN		16
+
+#if defined(__GNUC__)
+#define POOL_THREAD_LOCAL	__thread
+#elif defined(_MSC_VER)
+#define POOL_THREAD_LOCAL	__declspec(thread)
+#endif
+
+typedef struct {
+	void		*head;
+	int		 count;
+} MemPoolCache;
+
+typedef struct {
+	visual_size_t	 size;
+	volatile int	 lock;
+	void		*head;
+	int		 count;
+	void		*slabs;
+} MemPool;
+
+typedef struct {
+	int		 depth;
+	uint8_t		*chunk;
+	visual_size_t	 size;
+	visual_size_t	 used;
+	void		*overflow;
+	visual_size_t	 overflowbytes;
+} MemArena;
+
+static MemPool __lv_mem_pools[VISUAL_MEM_POOL_LAST] = {
+	/* Multiples of 16, so blocks keep the alignment of the slab */
+	[VISUAL_MEM_POOL_SLAB + 0]		= { 32 },
+	[VISUAL_MEM_POOL_SLAB + 1]		= { 48 },
+	[VISUAL_MEM_POOL_SLAB + 2]		= { 64 },
+	[VISUAL_MEM_POOL_SLAB + 3]		= { 96 },
+	[VISUAL_MEM_POOL_SLAB + 4]		= { 128 },
+	[VISUAL_MEM_POOL_SLAB + 5]		= { 192 },
+	[VISUAL_MEM_POOL_SLAB + 6]		= { 256 },
+	[VISUAL_MEM_POOL_SLAB + 7]		= { 384 },
+	[VISUAL_MEM_POOL_SLAB + 8]		= { 512 },
+	[VISUAL_MEM_POOL_SLAB + 9]		= { 768 },
+	[VISUAL_MEM_POOL_SLAB + 10]		= { 1024 },
+	[VISUAL_MEM_POOL_SLAB + 11]		= { POOL_SLAB_MAX_BLOCK }
+};
+
+#ifdef POOL_THREAD_LOCAL
+static POOL_THREAD_LOCAL MemPoolCache __lv_mem_pool_caches[VISUAL_MEM_POOL_LAST];
+static POOL_THREAD_LOCAL int __lv_mem_pool_registered = FALSE;
+static POOL_THREAD_LOCAL MemArena __lv_mem_pool_arena;
+
+#ifdef VISUAL_THREAD_MODEL_POSIX
+static pthread_once_t __lv_mem_pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t __lv_mem_pool_key;
+#endif
+#endif
+
+static void pool_lock (MemPool *pool);
+static void pool_unlock (MemPool *pool);
+
+static void pool_carve_slab (MemPool *pool);
+static int pool_slab_class (visual_size_t nbytes);
+
+#ifdef POOL_THREAD_LOCAL
+static void pool_refill (MemPool *pool, MemPoolCache *cache);
+static void pool_release (MemPool *pool, MemPoolCache *cache, int count);
+static void pool_free (VisMemPoolType pool, void *ptr);
+static void pool_register_thread (void);
+static void pool_arena_release (MemArena *arena);
+
+#ifdef VISUAL_THREAD_MODEL_POSIX
+static void pool_thread_exit (void *data);
+static void pool_key_create (void);
+#endif
+#endif
+
+static void pool_lock (MemPool *pool)
+{
+	while (visual_atomic_int_compare_and_exchange (&pool->lock, FALSE, TRUE) == FALSE)
+		visual_thread_yield ();
+}
+
+static void pool_unlock (MemPool *pool)
+{
+	visual_atomic_int_set (&pool->lock, FALSE);
+}
+
+/* Called with the pool locked */
+static void pool_carve_slab (MemPool *pool)
+{
+	uint8_t *slab;
+	void *block;
+	int i;
+
+	slab = malloc (POOL_SLAB_SIZE);
+
+	if (slab == NULL)
+		return;
+
+	*(void **) slab = pool->slabs;
+	pool->slabs = slab;
+
+	for (i = (POOL_SLAB_SIZE - POOL_SLAB_HEADER) / pool->size - 1; i >= 0; i--) {
+		block = slab + POOL_SLAB_HEADER + i * pool->size;
+
+		*(void **) block = pool->head;
+		pool->head = block;
+		pool->count++;
+	}
+}
+
+static int pool_slab_class (visual_size_t nbytes)
+{
+	int i;
+
+	for (i = VISUAL_MEM_POOL_SLAB; i < VISUAL_MEM_POOL_LAST; i++) {
+		if (nbytes <= __lv_mem_pools[i].size)
+			return i;
+	}
+
+	return VISUAL_MEM_POOL_NONE;
+}
+
+#ifdef POOL_THREAD_LOCAL
+static void pool_refill (MemPool *pool, MemPoolCache *cache)
+{
+	void *block;
+
+	if (__lv_mem_pool_registered == FALSE)
+		pool_register_thread ();
+
+	pool_lock (pool);
+
+	if (pool->head == NULL)
+		pool_carve_slab (pool);
+
+	while (pool->head != NULL && cache->count < POOL_CACHE_BATCH) {
+		block = pool->head;
+		pool->head = *(void **) block;
+		pool->count--;
+
+		*(void **) block = cache->head;
+		cache->head = block;
+		cache->count++;
+	}
+
+	pool_unlock (pool);
+}
+
+static void pool_release (MemPool *pool, MemPoolCache *cache, int count)
+{
+	void *block;
+
+	pool_lock (pool);
+
+	while (count-- > 0 && cache->head != NULL) {
+		block = cache->head;
+		cache->head = *(void **) block;
+		cache->count--;
+
+		*(void **) block = pool->head;
+		pool->head = block;
+		pool->count++;
+	}
+
+	pool_unlock (pool);
+}
+
+static void pool_free (VisMemPoolType pool, void *ptr)
+{
+	MemPoolCache *cache = &__lv_mem_pool_caches[pool];
+
+	if (__lv_mem_pool_registered == FALSE)
+		pool_register_thread ();
+
+	*(void **) ptr = cache->head;
+	cache->head = ptr;
+	cache->count++;
+
+	if (cache->count > POOL_CACHE_MAX)
+		pool_release (&__lv_mem_pools[pool], cache, POOL_CACHE_BATCH);
+}
+
+static void pool_register_thread ()
+{
+	__lv_mem_pool_registered = TRUE;
+
+#ifdef VISUAL_THREAD_MODEL_POSIX
+	/* The key only exists to get a call when the thread exits */
+	pthread_once (&__lv_mem_pool_once, pool_key_create);
+	pthread_setspecific (__lv_mem_pool_key, &__lv_mem_pool_registered);
+#endif
+}
+
+static void pool_arena_release (MemArena *arena)
+{
+	void *chunk;
+
+	while (arena->overflow != NULL) {
+		chunk = arena->overflow;
+		arena->overflow = *(void **) chunk;
+
+		visual_mem_free (chunk);
+	}
+
+	arena->overflowbytes = 0;
+}
+
+#ifdef VISUAL_THREAD_MODEL_POSIX
+static void pool_thread_exit (void *data)
+{
+	MemArena *arena = &__lv_mem_pool_arena;
+
+	/* The arena goes first, its chunks may end up in the freelists */
+	pool_arena_release (arena);
+
+	if (arena->chunk != NULL)
+		visual_mem_free (arena->chunk);
+
+	arena->chunk = NULL;
+	arena->size = 0;
+
+	visual_mem_pool_flush_thread ();
+}
+
+static void pool_key_create ()
+{
+	pthread_key_create (&__lv_mem_pool_key, pool_thread_exit);
+}
+#endif
+#endif /* POOL_THREAD_LOCAL */
+
+void *visual_mem_pool_slab_alloc (visual_size_t nbytes, void *priv)
+{
+#ifdef POOL_THREAD_LOCAL
+	MemPoolCache *cache;
+#else
+	MemPool *pool;
+#endif
+	void *block = NULL;
+	int class;
+
+	class = pool_slab_class (nbytes);
+
+	if (class == VISUAL_MEM_POOL_NONE)
+		return malloc (nbytes);
+
+#ifdef POOL_THREAD_LOCAL
+	cache = &__lv_mem_pool_caches[class];
+
+	if (cache->head == NULL)
+		pool_refill (&__lv_mem_pools[class], cache);
+
+	if (cache->head != NULL) {
+		block = cache->head;
+		cache->head = *(void **) block;
+		cache->count--;
+	}
+#else
+	pool = &__lv_mem_pools[class];
+
+	pool_lock (pool);
+
+	if (pool->head == NULL)
+		pool_carve_slab (pool);
+
+	if (pool->head != NULL) {
+		block = pool->head;
+		pool->head = *(void **) block;
+		pool->count--;
+	}
+
+	pool_unlock (pool);
+#endif
+
+	return block;
+}
+
+void visual_mem_pool_slab_free (void *ptr, visual_size_t nbytes, void *priv)
+{
+#ifndef POOL_THREAD_LOCAL
+	MemPool *pool;
+#endif
+	int class;
+
+	class = pool_slab_class (nbytes);
+
+	if (class == VISUAL_MEM_POOL_NONE) {
+		free (ptr);
+
+		return;
+	}
+
+#ifdef POOL_THREAD_LOCAL
+	pool_free (class, ptr);
+#else
+	pool = &__lv_mem_pools[class];
+
+	pool_lock (pool);
+
+	*(void **) ptr = pool->head;
+	pool->head = ptr;
+	pool->count++;
+
+	pool_unlock (pool);
+#endif
+}
+
+void visual_mem_pool_frame_begin ()
+{
+#ifdef POOL_THREAD_LOCAL
+	__lv_mem_pool_arena.depth++;
+#endif
+}
+
+int visual_mem_pool_frame_end ()
+{
+#ifdef POOL_THREAD_LOCAL
+	MemArena *arena = &__lv_mem_pool_arena;
+	visual_size_t needed;
+
+	if (arena->depth == 0 || --arena->depth > 0)
+		return FALSE;
+
+	if (__lv_mem_pool_registered == FALSE)
+		pool_register_thread ();
+
+	needed = arena->used + arena->overflowbytes;
+
+	pool_arena_release (arena);
+
+	/* Grow the chunk so the next frame fits in one */
+	if (needed > arena->size) {
+		if (arena->chunk != NULL)
+			visual_mem_free (arena->chunk);
+
+		arena->size = (needed + ARENA_CHUNK_MIN - 1) & ~((visual_size_t) ARENA_CHUNK_MIN - 1);
+		arena->chunk = visual_mem_malloc_aligned (arena->size, ARENA_ALIGN);
+	}
+
+	arena->used = 0;
+#endif
+
+	return TRUE;
+}
+
+void *visual_mem_pool_frame_malloc (visual_size_t nbytes)
+{
+#ifdef POOL_THREAD_LOCAL
+	MemArena *arena = &__lv_mem_pool_arena;
+	uint8_t *chunk;
+
+	if (arena->depth == 0)
+		return NULL;
+
+	nbytes = (nbytes + ARENA_ALIGN - 1) & ~((visual_size_t) ARENA_ALIGN - 1);
+
+	if (arena->chunk == NULL) {
+		arena->size = ARENA_CHUNK_MIN;
+		arena->chunk = visual_mem_malloc_aligned (arena->size, ARENA_ALIGN);
+	}
+
+	if (arena->size - arena->used >= nbytes) {
+		chunk = arena->chunk + arena->used;
+		arena->used += nbytes;
+
+		return chunk;
+	}
+
+	/* Doesn't fit, gets a chunk of its own until the frame ends */
+	chunk = visual_mem_malloc_aligned (ARENA_ALIGN + nbytes, ARENA_ALIGN);
+
+	*(void **) chunk = arena->overflow;
+	arena->overflow = chunk;
+	arena->overflowbytes += nbytes;
+
+	return chunk + ARENA_ALIGN;
+#else
+	return NULL;
+#endif
+}
+
+void visual_mem_pool_flush_thread ()
+{
+#ifdef POOL_THREAD_LOCAL
+	int i;
+
+	for (i = VISUAL_MEM_POOL_NONE + 1; i < VISUAL_MEM_POOL_LAST; i++) {
+		if (__lv_mem_pool_caches[i].head != NULL)
+			pool_release (&__lv_mem_pools[i], &__lv_mem_pool_caches[i], __lv_mem_pool_caches[i].count);
+	}
+#endif
+}
+
+void visual_mem_pool_deinitialize ()
+{
+#ifdef POOL_THREAD_LOCAL
+	if (__lv_mem_pool_arena.depth == 0 && __lv_mem_pool_arena.chunk != NULL) {
+		visual_mem_free (__lv_mem_pool_arena.chunk);
+
+		__lv_mem_pool_arena.chunk = NULL;
+		__lv_mem_pool_arena.size = 0;
+	}
+#endif
+
+	visual_mem_pool_flush_thread ();
+}
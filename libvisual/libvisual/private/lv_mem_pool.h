@@ -0,0 +1,29 @@
+#ifndef _LV_MEM_POOL_H
+#define _LV_MEM_POOL_H
+
+#include "lv_mem.h"
+
+/* The size classes of the slab allocator */
+typedef enum {
+	VISUAL_MEM_POOL_NONE = 0,
+	VISUAL_MEM_POOL_SLAB,		/* First of the size classes */
+	VISUAL_MEM_POOL_LAST = VISUAL_MEM_POOL_SLAB + 12
+} VisMemPoolType;
+
+/* Hands the blocks cached by the calling thread back to the shared pools */
+void visual_mem_pool_flush_thread (void);
+
+/* Releases the frame arena of the calling thread and its cached blocks, slabs stay as
+ * their blocks may still be in use */
+void visual_mem_pool_deinitialize (void);
+
+/* The slab allocator, a VisMemAllocator on top of the size class pools */
+void *visual_mem_pool_slab_alloc (visual_size_t nbytes, void *priv);
+void visual_mem_pool_slab_free (void *ptr, visual_size_t nbytes, void *priv);
+
+/* The frame arena of the calling thread, visual_mem_pool_frame_end returns TRUE for the outermost frame */
+void visual_mem_pool_frame_begin (void);
+int visual_mem_pool_frame_end (void);
+void *visual_mem_pool_frame_malloc (visual_size_t nbytes);
+
+#endif /* _LV_MEM_POOL_H */
@@ -0,0 +1,170 @@
+#include "lv_palette_lookup.h"
+#include "lv_common.h"
+
+#include <limits.h>
+
+/*
+ * Every entry of the table holds the palette color nearest to the center of its 16 bits
+ * cell, by euclidean distance in RGB, ties go to the lowest index.
+ *
+ * The table is filled in boxes of 4x8x4 cells. For every box only the colors that can
+ * be the nearest to some cell in it are tried: the ones that are no further from the box
+ * than the furthest corner of the box is from the color that has the nearest furthest
+ * corner. That leaves a handful of candidates per box instead of the whole palette.
+ */
+
+#define BOX_R_CELLS	4
+#define BOX_G_CELLS	8
+#define BOX_B_CELLS	4
+
+/* Cell centers in 8 bits channel values */
+#define CELL_R(r)	(((r) << 3) + 4)
+#define CELL_G(g)	(((g) << 2) + 2)
+#define CELL_B(b)	(((b) << 3) + 4)
+
+static int lookup_changed (VisPaletteLookup *lookup, VisPalette *pal, int ncolors);
+static void lookup_build (VisPaletteLookup *lookup);
+static void lookup_build_box (VisPaletteLookup *lookup, int r0, int g0, int b0);
+
+static inline int axis_min_dist (int p, int min, int max)
+{
+	if (p < min)
+		return (min - p) * (min - p);
+
+	if (p > max)
+		return (p - max) * (p - max);
+
+	return 0;
+}
+
+static inline int axis_max_dist (int p, int min, int max)
+{
+	int dmin = (p - min) * (p - min);
+	int dmax = (p - max) * (p - max);
+
+	return dmin > dmax ? dmin : dmax;
+}
+
+const uint8_t *visual_palette_lookup_get (VisPalette *pal)
+{
+	int ncolors;
+
+	visual_return_val_if_fail (pal != NULL, NULL);
+
+	ncolors = pal->ncolors > VISUAL_PALETTE_LOOKUP_COLORS ? VISUAL_PALETTE_LOOKUP_COLORS : pal->ncolors;
+
+	if (ncolors <= 0 || pal->colors == NULL)
+		return NULL;
+
+	/* A new lookup has no colors, which always counts as changed */
+	if (pal->lookup == NULL)
+		pal->lookup = visual_mem_new0 (VisPaletteLookup, 1);
+
+	if (lookup_changed (pal->lookup, pal, ncolors) == TRUE)
+		lookup_build (pal->lookup);
+
+	return pal->lookup->table;
+}
+
+void visual_palette_lookup_free (VisPalette *pal)
+{
+	visual_return_if_fail (pal != NULL);
+
+	if (pal->lookup != NULL)
+		visual_mem_free (pal->lookup);
+
+	pal->lookup = NULL;
+}
+
+/* Compares the palette to the colors the table was built for, and takes them over */
+static int lookup_changed (VisPaletteLookup *lookup, VisPalette *pal, int ncolors)
+{
+	uint32_t color;
+	int changed = lookup->ncolors != ncolors;
+	int i;
+
+	for (i = 0; i < ncolors; i++) {
+		color = pal->colors[i].r << 16 | pal->colors[i].g << 8 | pal->colors[i].b;
+
+		if (lookup->colors[i] != color) {
+			/* Nothing is written while the table is current */
+			lookup->colors[i] = color;
+			changed = TRUE;
+		}
+	}
+
+	lookup->ncolors = ncolors;
+
+	return changed;
+}
+
+static void lookup_build (VisPaletteLookup *lookup)
+{
+	int r, g, b;
+
+	for (r = 0; r < 32; r += BOX_R_CELLS) {
+		for (g = 0; g < 64; g += BOX_G_CELLS) {
+			for (b = 0; b < 32; b += BOX_B_CELLS)
+				lookup_build_box (lookup, r, g, b);
+		}
+	}
+}
+
+static void lookup_build_box (VisPaletteLookup *lookup, int r0, int g0, int b0)
+{
+	uint8_t candidates[VISUAL_PALETTE_LOOKUP_COLORS];
+	int mindists[VISUAL_PALETTE_LOOKUP_COLORS];
+	int rmin = CELL_R (r0), rmax = CELL_R (r0 + BOX_R_CELLS - 1);
+	int gmin = CELL_G (g0), gmax = CELL_G (g0 + BOX_G_CELLS - 1);
+	int bmin = CELL_B (b0), bmax = CELL_B (b0 + BOX_B_CELLS - 1);
+	int minmax = INT_MAX;
+	int ncandidates = 0;
+	int pr, pg, pb;
+	int dist, best, bestdist;
+	int r, g, b;
+	int i;
+
+	for (i = 0; i < lookup->ncolors; i++) {
+		pr = lookup->colors[i] >> 16;
+		pg = (lookup->colors[i] >> 8) & 0xff;
+		pb = lookup->colors[i] & 0xff;
+
+		mindists[i] = axis_min_dist (pr, rmin, rmax) + axis_min_dist (pg, gmin, gmax) +
+			axis_min_dist (pb, bmin, bmax);
+
+		dist = axis_max_dist (pr, rmin, rmax) + axis_max_dist (pg, gmin, gmax) +
+			axis_max_dist (pb, bmin, bmax);
+
+		if (dist < minmax)
+			minmax = dist;
+	}
+
+	for (i = 0; i < lookup->ncolors; i++) {
+		if (mindists[i] <= minmax)
+			candidates[ncandidates++] = i;
+	}
+
+	for (r = r0; r < r0 + BOX_R_CELLS; r++) {
+		for (g = g0; g < g0 + BOX_G_CELLS; g++) {
+			for (b = b0; b < b0 + BOX_B_CELLS; b++) {
+				best = candidates[0];
+				bestdist = INT_MAX;
+
+				for (i = 0; i < ncandidates; i++) {
+					pr = (int) (lookup->colors[candidates[i]] >> 16) - CELL_R (r);
+					pg = (int) ((lookup->colors[candidates[i]] >> 8) & 0xff) - CELL_G (g);
+					pb = (int) (lookup->colors[candidates[i]] & 0xff) - CELL_B (b);
+
+					dist = pr * pr + pg * pg + pb * pb;
+
+					if (dist < bestdist) {
+						bestdist = dist;
+						best = candidates[i];
+					}
+				}
+
+				lookup->table[r << 11 | g << 5 | b] = best;
+			}
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef _LV_PALETTE_LOOKUP_H
+#define _LV_PALETTE_LOOKUP_H
+
+#include "lv_palette.h"
+
+/* The table is indexed by 16 bits pixels, r:5 g:6 b:5 from the most significant bit */
+#define VISUAL_PALETTE_LOOKUP_SIZE	65536
+
+/* Only the first 256 colors of a palette are looked up, the indices have 8 bits */
+#define VISUAL_PALETTE_LOOKUP_COLORS	256
+
+struct _VisPaletteLookup {
+	int		 ncolors;
+	uint32_t	 colors[VISUAL_PALETTE_LOOKUP_COLORS];	/* The colors the table was built for, as 0xrrggbb */
+	uint8_t		 table[VISUAL_PALETTE_LOOKUP_SIZE];
+};
+
+/* Returns the table for the current colors, rebuilding it when they changed since the
+ * last call. Only reads when nothing changed, so the bands of a conversion can share it
+ * once the caller refreshed it. NULL for a palette without colors. */
+const uint8_t *visual_palette_lookup_get (VisPalette *pal);
+
+void visual_palette_lookup_free (VisPalette *pal);
+
+#endif /* _LV_PALETTE_LOOKUP_H */
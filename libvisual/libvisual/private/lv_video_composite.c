@@ -0,0 +1,1520 @@
+#include "config.h"
+#include "lv_video_composite.h"
+#include "lv_common.h"
+#include "lv_cpu.h"
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * The compositors are split in row kernels per composite type and depth, driven
+ * over the rows by composite_run(). The blends are d + (a * (s - d) >> 8), which the
+ * kernels work out as (s * a + d * (256 - a)) >> 8 so every product fits in 16 bits
+ * without a sign. The surface weights come per channel, the alpha channel of 32 bits
+ * pixels gets a weight of 0 and keeps the destination alpha. 16 bits pixels are
+ * blended per 5, 6 and 5 bits field.
+ *
+ * A colorkeyed source pixel leaves the destination pixel alone. The vector kernels
+ * give bit identical results to the C ones, they work on whole vectors and hand the
+ * end of the row to the C kernel.
+ */
+
+typedef enum {
+	COMPOSITE_ALPHASRC,
+	COMPOSITE_PREMULTIPLIED,
+	COMPOSITE_COLORKEY,
+	COMPOSITE_SURFACE,
+	COMPOSITE_SURFACECOLORKEY,
+	COMPOSITE_LAST
+} CompositeType;
+
+typedef struct {
+	uint32_t	 keys[8];	/* The colorkey repeated, as the source pixels hold it */
+	uint16_t	 weights[2][8];	/* Surface alpha and 256 minus it, per channel of 8 bytes */
+} CompositeParams;
+
+/* Composites width pixels of src over dest */
+typedef void (*CompositeRowFunc)(uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+
+static void composite_run (VisVideo *dest, VisVideo *src, CompositeType type, const CompositeParams *params);
+static void composite_copy (VisVideo *dest, VisVideo *src);
+static int composite_build_params (CompositeParams *params, VisVideo *src);
+
+static void alphasrc32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void premultiplied32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface_bytes_c (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params);
+static void surface8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static void alphasrc32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void premultiplied32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface_bytes_sse2 (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params);
+static void surface8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface24_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+
+static void alphasrc32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void premultiplied32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface_bytes_avx2 (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params);
+static void surface8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface24_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void alphasrc32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void premultiplied32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void colorkey32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface_bytes_neon (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params);
+static void surface8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface24_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surface32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+static void surfacecolorkey32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params);
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
+
+/* Optimal kernels set by visual_video_composite_initialize(), indexed by bytes per pixel. */
+
+static CompositeRowFunc composite_rows[COMPOSITE_LAST][5] = {
+	[COMPOSITE_ALPHASRC]		= { [4] = alphasrc32_c },
+	[COMPOSITE_PREMULTIPLIED]	= { [4] = premultiplied32_c },
+	[COMPOSITE_COLORKEY]		= { NULL, colorkey8_c, colorkey16_c, colorkey24_c, colorkey32_c },
+	[COMPOSITE_SURFACE]		= { NULL, surface8_c, surface16_c, surface24_c, surface32_c },
+	[COMPOSITE_SURFACECOLORKEY]	= { NULL, surfacecolorkey8_c, surfacecolorkey16_c, surfacecolorkey24_c,
+						surfacecolorkey32_c }
+};
+
+void visual_video_composite_initialize (void)
+{
+	/* Arranged from slow to fast, so the slower version gets overloaded
+	 * every time */
+
+	composite_rows[COMPOSITE_ALPHASRC][4]		= alphasrc32_c;
+	composite_rows[COMPOSITE_PREMULTIPLIED][4]	= premultiplied32_c;
+	composite_rows[COMPOSITE_COLORKEY][1]		= colorkey8_c;
+	composite_rows[COMPOSITE_COLORKEY][2]		= colorkey16_c;
+	composite_rows[COMPOSITE_COLORKEY][3]		= colorkey24_c;
+	composite_rows[COMPOSITE_COLORKEY][4]		= colorkey32_c;
+	composite_rows[COMPOSITE_SURFACE][1]		= surface8_c;
+	composite_rows[COMPOSITE_SURFACE][2]		= surface16_c;
+	composite_rows[COMPOSITE_SURFACE][3]		= surface24_c;
+	composite_rows[COMPOSITE_SURFACE][4]		= surface32_c;
+	composite_rows[COMPOSITE_SURFACECOLORKEY][1]	= surfacecolorkey8_c;
+	composite_rows[COMPOSITE_SURFACECOLORKEY][2]	= surfacecolorkey16_c;
+	composite_rows[COMPOSITE_SURFACECOLORKEY][3]	= surfacecolorkey24_c;
+	composite_rows[COMPOSITE_SURFACECOLORKEY][4]	= surfacecolorkey32_c;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+	/* The colorkeys of 24 bits pixels don't line up with the vectors, they stay scalar */
+	if (visual_cpu_get_sse2 () > 0) {
+		composite_rows[COMPOSITE_ALPHASRC][4]		= alphasrc32_sse2;
+		composite_rows[COMPOSITE_PREMULTIPLIED][4]	= premultiplied32_sse2;
+		composite_rows[COMPOSITE_COLORKEY][1]		= colorkey8_sse2;
+		composite_rows[COMPOSITE_COLORKEY][2]		= colorkey16_sse2;
+		composite_rows[COMPOSITE_COLORKEY][4]		= colorkey32_sse2;
+		composite_rows[COMPOSITE_SURFACE][1]		= surface8_sse2;
+		composite_rows[COMPOSITE_SURFACE][2]		= surface16_sse2;
+		composite_rows[COMPOSITE_SURFACE][3]		= surface24_sse2;
+		composite_rows[COMPOSITE_SURFACE][4]		= surface32_sse2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][1]	= surfacecolorkey8_sse2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][2]	= surfacecolorkey16_sse2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][4]	= surfacecolorkey32_sse2;
+	}
+
+	if (visual_cpu_get_avx2 () > 0) {
+		composite_rows[COMPOSITE_ALPHASRC][4]		= alphasrc32_avx2;
+		composite_rows[COMPOSITE_PREMULTIPLIED][4]	= premultiplied32_avx2;
+		composite_rows[COMPOSITE_COLORKEY][1]		= colorkey8_avx2;
+		composite_rows[COMPOSITE_COLORKEY][2]		= colorkey16_avx2;
+		composite_rows[COMPOSITE_COLORKEY][4]		= colorkey32_avx2;
+		composite_rows[COMPOSITE_SURFACE][1]		= surface8_avx2;
+		composite_rows[COMPOSITE_SURFACE][2]		= surface16_avx2;
+		composite_rows[COMPOSITE_SURFACE][3]		= surface24_avx2;
+		composite_rows[COMPOSITE_SURFACE][4]		= surface32_avx2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][1]	= surfacecolorkey8_avx2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][2]	= surfacecolorkey16_avx2;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][4]	= surfacecolorkey32_avx2;
+	}
+
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+	if (visual_cpu_get_neon () > 0) {
+		composite_rows[COMPOSITE_ALPHASRC][4]		= alphasrc32_neon;
+		composite_rows[COMPOSITE_PREMULTIPLIED][4]	= premultiplied32_neon;
+		composite_rows[COMPOSITE_COLORKEY][1]		= colorkey8_neon;
+		composite_rows[COMPOSITE_COLORKEY][2]		= colorkey16_neon;
+		composite_rows[COMPOSITE_COLORKEY][4]		= colorkey32_neon;
+		composite_rows[COMPOSITE_SURFACE][1]		= surface8_neon;
+		composite_rows[COMPOSITE_SURFACE][2]		= surface16_neon;
+		composite_rows[COMPOSITE_SURFACE][3]		= surface24_neon;
+		composite_rows[COMPOSITE_SURFACE][4]		= surface32_neon;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][1]	= surfacecolorkey8_neon;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][2]	= surfacecolorkey16_neon;
+		composite_rows[COMPOSITE_SURFACECOLORKEY][4]	= surfacecolorkey32_neon;
+	}
+
+#endif
+}
+
+void visual_video_composite_alphasrc (VisVideo *dest, VisVideo *src)
+{
+	composite_run (dest, src, COMPOSITE_ALPHASRC, NULL);
+}
+
+void visual_video_composite_premultiplied (VisVideo *dest, VisVideo *src)
+{
+	composite_run (dest, src, COMPOSITE_PREMULTIPLIED, NULL);
+}
+
+void visual_video_composite_colorkey (VisVideo *dest, VisVideo *src)
+{
+	CompositeParams params;
+
+	/* Without a key every pixel gets copied */
+	if (composite_build_params (&params, src) == FALSE)
+		composite_copy (dest, src);
+	else
+		composite_run (dest, src, COMPOSITE_COLORKEY, &params);
+}
+
+void visual_video_composite_surface (VisVideo *dest, VisVideo *src)
+{
+	CompositeParams params;
+
+	composite_build_params (&params, src);
+	composite_run (dest, src, COMPOSITE_SURFACE, &params);
+}
+
+void visual_video_composite_surfacecolorkey (VisVideo *dest, VisVideo *src)
+{
+	CompositeParams params;
+
+	/* An 8 bits source without a palette can't hold a key nor be blended */
+	if (src->depth == VISUAL_VIDEO_DEPTH_8BIT && src->pal == NULL)
+		composite_copy (dest, src);
+	else if (composite_build_params (&params, src) == FALSE)
+		composite_run (dest, src, COMPOSITE_SURFACE, &params);
+	else
+		composite_run (dest, src, COMPOSITE_SURFACECOLORKEY, &params);
+}
+
+static void composite_copy (VisVideo *dest, VisVideo *src)
+{
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	const uint8_t *sbuf = visual_video_get_pixels (src);
+	int y;
+
+	for (y = 0; y < src->height; y++) {
+		visual_mem_copy (dbuf, sbuf, src->width * src->bpp);
+
+		dbuf += dest->pitch;
+		sbuf += src->pitch;
+	}
+}
+
+static void composite_run (VisVideo *dest, VisVideo *src, CompositeType type, const CompositeParams *params)
+{
+	CompositeRowFunc func = composite_rows[type][dest->bpp];
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	const uint8_t *sbuf = visual_video_get_pixels (src);
+	int y;
+
+	for (y = 0; y < src->height; y++) {
+		func (dbuf, sbuf, src->width, params);
+
+		dbuf += dest->pitch;
+		sbuf += src->pitch;
+	}
+}
+
+/* Returns FALSE when the colorkey isn't in the palette of an 8 bits source */
+static int composite_build_params (CompositeParams *params, VisVideo *src)
+{
+	uint32_t key = 0;
+	int alpha = src->density;
+	int keyed = TRUE;
+	int index;
+	int i;
+
+	switch (src->depth) {
+		case VISUAL_VIDEO_DEPTH_8BIT:
+			index = src->pal != NULL ? visual_palette_find_color (src->pal, &src->colorkey) : -1;
+
+			keyed = index >= 0;
+			key = (index & 0xff) * 0x01010101;
+
+			break;
+
+		case VISUAL_VIDEO_DEPTH_16BIT:
+			key = visual_color_to_uint16 (&src->colorkey) * 0x00010001;
+
+			break;
+
+		case VISUAL_VIDEO_DEPTH_24BIT:
+			key = src->colorkey.b | src->colorkey.g << 8 | src->colorkey.r << 16;
+
+			break;
+
+		case VISUAL_VIDEO_DEPTH_32BIT:
+			key = visual_color_to_uint32 (&src->colorkey);
+
+			break;
+
+		default:
+			break;
+	}
+
+	for (i = 0; i < 8; i++) {
+		params->keys[i] = key;
+
+		/* The alpha channel of 32 bits pixels stays */
+		if (src->depth == VISUAL_VIDEO_DEPTH_32BIT && (i & 3) == 3) {
+			params->weights[0][i] = 0;
+			params->weights[1][i] = 0x100;
+		} else {
+			params->weights[0][i] = alpha;
+			params->weights[1][i] = 0x100 - alpha;
+		}
+	}
+
+	return keyed;
+}
+
+static inline int blend_rgb16 (int s, int d, int alpha, int inv)
+{
+	int c0, c1, c2;
+
+	c0 = ((s & 0x1f) * alpha + (d & 0x1f) * inv) >> 8;
+	c1 = (((s >> 5) & 0x3f) * alpha + ((d >> 5) & 0x3f) * inv) >> 8;
+	c2 = ((s >> 11) * alpha + (d >> 11) * inv) >> 8;
+
+	return c0 | c1 << 5 | c2 << 11;
+}
+
+static void alphasrc32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int alpha, inv;
+	int i;
+
+	for (i = 0; i < width; i++) {
+		alpha = src[3];
+		inv = 0x100 - alpha;
+
+		dest[0] = (src[0] * alpha + dest[0] * inv) >> 8;
+		dest[1] = (src[1] * alpha + dest[1] * inv) >> 8;
+		dest[2] = (src[2] * alpha + dest[2] * inv) >> 8;
+
+		dest += 4;
+		src += 4;
+	}
+}
+
+/* The source is already weighted by its alpha, the alpha channels blend too */
+static void premultiplied32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int inv, c;
+	int i, k;
+
+	for (i = 0; i < width; i++) {
+		inv = 0x100 - src[3];
+
+		for (k = 0; k < 4; k++) {
+			c = src[k] + ((dest[k] * inv) >> 8);
+
+			dest[k] = c > 255 ? 255 : c;
+		}
+
+		dest += 4;
+		src += 4;
+	}
+}
+
+static void colorkey8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint8_t key = params->keys[0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (src[i] != key)
+			dest[i] = src[i];
+	}
+}
+
+static void colorkey16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	uint16_t key = params->keys[0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (sbuf[i] != key)
+			dbuf[i] = sbuf[i];
+	}
+}
+
+static void colorkey24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint32_t key = params->keys[0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if ((uint32_t) (src[0] | src[1] << 8 | src[2] << 16) != key) {
+			dest[0] = src[0];
+			dest[1] = src[1];
+			dest[2] = src[2];
+		}
+
+		dest += 3;
+		src += 3;
+	}
+}
+
+static void colorkey32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint32_t *dbuf = (uint32_t *) dest;
+	const uint32_t *sbuf = (const uint32_t *) src;
+	uint32_t key = params->keys[0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (sbuf[i] != key)
+			dbuf[i] = sbuf[i];
+	}
+}
+
+/* Blends n bytes, the weights repeat every 8 bytes */
+static void surface_bytes_c (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		dest[i] = (src[i] * params->weights[0][i & 7] + dest[i] * params->weights[1][i & 7]) >> 8;
+}
+
+static void surface8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_c (dest, src, width, params);
+}
+
+static void surface16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	int i;
+
+	for (i = 0; i < width; i++)
+		dbuf[i] = blend_rgb16 (sbuf[i], dbuf[i], params->weights[0][0], params->weights[1][0]);
+}
+
+static void surface24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_c (dest, src, width * 3, params);
+}
+
+static void surface32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_c (dest, src, width * 4, params);
+}
+
+static void surfacecolorkey8_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint8_t key = params->keys[0];
+	int alpha = params->weights[0][0];
+	int inv = params->weights[1][0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (src[i] != key)
+			dest[i] = (src[i] * alpha + dest[i] * inv) >> 8;
+	}
+}
+
+static void surfacecolorkey16_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	uint16_t key = params->keys[0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (sbuf[i] != key)
+			dbuf[i] = blend_rgb16 (sbuf[i], dbuf[i], params->weights[0][0], params->weights[1][0]);
+	}
+}
+
+static void surfacecolorkey24_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint32_t key = params->keys[0];
+	int alpha = params->weights[0][0];
+	int inv = params->weights[1][0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if ((uint32_t) (src[0] | src[1] << 8 | src[2] << 16) != key) {
+			dest[0] = (src[0] * alpha + dest[0] * inv) >> 8;
+			dest[1] = (src[1] * alpha + dest[1] * inv) >> 8;
+			dest[2] = (src[2] * alpha + dest[2] * inv) >> 8;
+		}
+
+		dest += 3;
+		src += 3;
+	}
+}
+
+static void surfacecolorkey32_c (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint32_t key = params->keys[0];
+	int alpha = params->weights[0][0];
+	int inv = params->weights[1][0];
+	int i;
+
+	for (i = 0; i < width; i++) {
+		if (*((const uint32_t *) src) != key) {
+			dest[0] = (src[0] * alpha + dest[0] * inv) >> 8;
+			dest[1] = (src[1] * alpha + dest[1] * inv) >> 8;
+			dest[2] = (src[2] * alpha + dest[2] * inv) >> 8;
+		}
+
+		dest += 4;
+		src += 4;
+	}
+}
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+static const uint16_t composite_one[16] = {
+	0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100,
+	0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100, 0x100
+};
+
+/* Drops the alpha of the source alpha, so the destination alpha stays */
+static const uint16_t composite_color_mask[16] = {
+	0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0,
+	0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0
+};
+
+/* The 5 and 6 bits fields of 16 bits pixels */
+static const uint16_t composite_field_masks[2][16] = {
+	{ 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f },
+	{ 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f }
+};
+
+/* Four pixels, the alpha of every pixel is spread over its words by the word shuffles */
+static void alphasrc32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm6"
+			 "\n\t movdqu (%[c]), %%xmm5"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t punpckhbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t pshuflw $0xff, %%xmm0, %%xmm4"
+			 "\n\t pshufhw $0xff, %%xmm4, %%xmm4"
+			 "\n\t pand %%xmm6, %%xmm4"
+			 "\n\t movdqa %%xmm5, %%xmm7"
+			 "\n\t psubw %%xmm4, %%xmm7"
+			 "\n\t pmullw %%xmm4, %%xmm0"
+			 "\n\t pmullw %%xmm7, %%xmm1"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t pshuflw $0xff, %%xmm2, %%xmm4"
+			 "\n\t pshufhw $0xff, %%xmm4, %%xmm4"
+			 "\n\t pand %%xmm6, %%xmm4"
+			 "\n\t movdqa %%xmm5, %%xmm7"
+			 "\n\t psubw %%xmm4, %%xmm7"
+			 "\n\t pmullw %%xmm4, %%xmm2"
+			 "\n\t pmullw %%xmm7, %%xmm3"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t packuswb %%xmm2, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [m] "r" (composite_color_mask),
+			    [c] "r" (composite_one)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	alphasrc32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void premultiplied32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__asm __volatile
+			("\n\t movdqu (%[c]), %%xmm5"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t punpcklbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t punpckhbw %%xmm7, %%xmm4"
+			 "\n\t pshuflw $0xff, %%xmm2, %%xmm2"
+			 "\n\t pshufhw $0xff, %%xmm2, %%xmm2"
+			 "\n\t pshuflw $0xff, %%xmm3, %%xmm3"
+			 "\n\t pshufhw $0xff, %%xmm3, %%xmm3"
+			 "\n\t movdqa %%xmm5, %%xmm6"
+			 "\n\t psubw %%xmm2, %%xmm6"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t movdqa %%xmm5, %%xmm6"
+			 "\n\t psubw %%xmm3, %%xmm6"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t psrlw $8, %%xmm1"
+			 "\n\t psrlw $8, %%xmm4"
+			 "\n\t packuswb %%xmm4, %%xmm1"
+			 "\n\t paddusb %%xmm0, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [c] "r" (composite_one)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	premultiplied32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+/* The keyed source pixels pick the destination ones */
+static void colorkey8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[k]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t pcmpeqb %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm2, %%xmm1"
+			 "\n\t pandn %%xmm0, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	colorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void colorkey16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[k]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t pcmpeqw %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm2, %%xmm1"
+			 "\n\t pandn %%xmm0, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	colorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void colorkey32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__asm __volatile
+			("\n\t movdqu (%[k]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t pcmpeqd %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm2, %%xmm1"
+			 "\n\t pandn %%xmm0, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	colorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void surface_bytes_sse2 (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[w]), %%xmm5"
+			 "\n\t movdqu 16(%[w]), %%xmm6"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t punpckhbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm0"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t pmullw %%xmm6, %%xmm3"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t packuswb %%xmm2, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [w] "r" (params->weights)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+	}
+
+	surface_bytes_c (dest + i, src + i, n - i, params);
+}
+
+static void surface8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_sse2 (dest, src, width, params);
+}
+
+/* The fields are blended in words of their own and shifted back in place */
+static void surface16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[w]), %%xmm5"
+			 "\n\t movdqu 16(%[w]), %%xmm6"
+			 "\n\t movdqu (%[m]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm7, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t pmullw %%xmm6, %%xmm3"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t psrlw $11, %%xmm3"
+			 "\n\t psrlw $11, %%xmm4"
+			 "\n\t pmullw %%xmm5, %%xmm3"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t paddw %%xmm4, %%xmm3"
+			 "\n\t psrlw $8, %%xmm3"
+			 "\n\t psllw $11, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm2"
+			 "\n\t movdqu 32(%[m]), %%xmm7"
+			 "\n\t psrlw $5, %%xmm0"
+			 "\n\t psrlw $5, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm0"
+			 "\n\t pand %%xmm7, %%xmm1"
+			 "\n\t pmullw %%xmm5, %%xmm0"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psllw $5, %%xmm0"
+			 "\n\t por %%xmm0, %%xmm2"
+			 "\n\t movdqu %%xmm2, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [w] "r" (params->weights),
+			    [m] "r" (composite_field_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	surface16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surface24_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_sse2 (dest, src, width * 3, params);
+}
+
+static void surface32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_sse2 (dest, src, width * 4, params);
+}
+
+/* surface_bytes_sse2(), then the keyed source pixels pick the destination ones */
+static void surfacecolorkey8_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[w]), %%xmm5"
+			 "\n\t movdqu 16(%[w]), %%xmm6"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t punpckhbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm0"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t pmullw %%xmm6, %%xmm3"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t packuswb %%xmm2, %%xmm0"
+			 "\n\t movdqu (%[k]), %%xmm4"
+			 "\n\t movdqu (%[s]), %%xmm2"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t pcmpeqb %%xmm4, %%xmm2"
+			 "\n\t pand %%xmm2, %%xmm1"
+			 "\n\t pandn %%xmm0, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [w] "r" (params->weights), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	surfacecolorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void surfacecolorkey16_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[w]), %%xmm5"
+			 "\n\t movdqu 16(%[w]), %%xmm6"
+			 "\n\t movdqu (%[m]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t pand %%xmm7, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t pmullw %%xmm6, %%xmm3"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t psrlw $11, %%xmm3"
+			 "\n\t psrlw $11, %%xmm4"
+			 "\n\t pmullw %%xmm5, %%xmm3"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t paddw %%xmm4, %%xmm3"
+			 "\n\t psrlw $8, %%xmm3"
+			 "\n\t psllw $11, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm2"
+			 "\n\t movdqu 32(%[m]), %%xmm7"
+			 "\n\t psrlw $5, %%xmm0"
+			 "\n\t psrlw $5, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm0"
+			 "\n\t pand %%xmm7, %%xmm1"
+			 "\n\t pmullw %%xmm5, %%xmm0"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psllw $5, %%xmm0"
+			 "\n\t por %%xmm0, %%xmm2"
+			 "\n\t movdqu (%[k]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm3"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t pcmpeqw %%xmm7, %%xmm3"
+			 "\n\t pand %%xmm3, %%xmm1"
+			 "\n\t pandn %%xmm2, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [w] "r" (params->weights),
+			    [m] "r" (composite_field_masks), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	surfacecolorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surfacecolorkey32_sse2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__asm __volatile
+			("\n\t movdqu (%[w]), %%xmm5"
+			 "\n\t movdqu 16(%[w]), %%xmm6"
+			 "\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t punpckhbw %%xmm7, %%xmm2"
+			 "\n\t punpckhbw %%xmm7, %%xmm3"
+			 "\n\t pmullw %%xmm5, %%xmm0"
+			 "\n\t pmullw %%xmm6, %%xmm1"
+			 "\n\t pmullw %%xmm5, %%xmm2"
+			 "\n\t pmullw %%xmm6, %%xmm3"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t packuswb %%xmm2, %%xmm0"
+			 "\n\t movdqu (%[k]), %%xmm4"
+			 "\n\t movdqu (%[s]), %%xmm2"
+			 "\n\t movdqu (%[d]), %%xmm1"
+			 "\n\t pcmpeqd %%xmm4, %%xmm2"
+			 "\n\t pand %%xmm2, %%xmm1"
+			 "\n\t pandn %%xmm0, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm1, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [w] "r" (params->weights), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	surfacecolorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+/* The AVX2 kernels are the SSE2 ones on both 128 bits lanes, the unpacks and packs
+ * stay within the lanes so the pixels keep their order */
+
+static void alphasrc32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vmovdqu (%[m]), %%ymm6"
+			 "\n\t vmovdqu (%[c]), %%ymm5"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm2"
+			 "\n\t vmovdqu (%[d]), %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm2, %%ymm0"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm1"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpshuflw $0xff, %%ymm0, %%ymm4"
+			 "\n\t vpshufhw $0xff, %%ymm4, %%ymm4"
+			 "\n\t vpand %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm4, %%ymm5, %%ymm7"
+			 "\n\t vpmullw %%ymm4, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpshuflw $0xff, %%ymm2, %%ymm4"
+			 "\n\t vpshufhw $0xff, %%ymm4, %%ymm4"
+			 "\n\t vpand %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpsubw %%ymm4, %%ymm5, %%ymm7"
+			 "\n\t vpmullw %%ymm4, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpackuswb %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [m] "r" (composite_color_mask),
+			    [c] "r" (composite_one)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	alphasrc32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void premultiplied32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vmovdqu (%[c]), %%ymm5"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm4"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm0, %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm4, %%ymm1"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm4, %%ymm4"
+			 "\n\t vpshuflw $0xff, %%ymm2, %%ymm2"
+			 "\n\t vpshufhw $0xff, %%ymm2, %%ymm2"
+			 "\n\t vpshuflw $0xff, %%ymm3, %%ymm3"
+			 "\n\t vpshufhw $0xff, %%ymm3, %%ymm3"
+			 "\n\t vpsubw %%ymm2, %%ymm5, %%ymm2"
+			 "\n\t vpsubw %%ymm3, %%ymm5, %%ymm3"
+			 "\n\t vpmullw %%ymm2, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm3, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm1, %%ymm1"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm4"
+			 "\n\t vpackuswb %%ymm4, %%ymm1, %%ymm1"
+			 "\n\t vpaddusb %%ymm0, %%ymm1, %%ymm1"
+			 "\n\t vmovdqu %%ymm1, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [c] "r" (composite_one)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	premultiplied32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void colorkey8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 32 <= width; i += 32) {
+		__asm __volatile
+			("\n\t vmovdqu (%[k]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm1"
+			 "\n\t vpcmpeqb %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpblendvb %%ymm2, %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	colorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void colorkey16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vmovdqu (%[k]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm1"
+			 "\n\t vpcmpeqw %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpblendvb %%ymm2, %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	colorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void colorkey32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vmovdqu (%[k]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm1"
+			 "\n\t vpcmpeqd %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpblendvb %%ymm2, %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	colorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void surface_bytes_avx2 (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[w]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[w]), %%ymm6"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm2"
+			 "\n\t vmovdqu (%[d]), %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm2, %%ymm0"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm1"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpackuswb %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [w] "r" (params->weights)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	surface_bytes_c (dest + i, src + i, n - i, params);
+}
+
+static void surface8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_avx2 (dest, src, width, params);
+}
+
+static void surface16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[w]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[w]), %%ymm6"
+			 "\n\t vmovdqu (%[m]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm1"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm1, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $11, %%ymm0, %%ymm3"
+			 "\n\t vpsrlw $11, %%ymm1, %%ymm4"
+			 "\n\t vpmullw %%ymm5, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpaddw %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm3, %%ymm3"
+			 "\n\t vpsllw $11, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu 32(%[m]), %%ymm7"
+			 "\n\t vpsrlw $5, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $5, %%ymm1, %%ymm1"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vpand %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm5, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsllw $5, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm0, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu %%ymm2, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [w] "r" (params->weights),
+			    [m] "r" (composite_field_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	surface16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surface24_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_avx2 (dest, src, width * 3, params);
+}
+
+static void surface32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_avx2 (dest, src, width * 4, params);
+}
+
+static void surfacecolorkey8_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 32 <= width; i += 32) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[w]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[w]), %%ymm6"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm2"
+			 "\n\t vmovdqu (%[d]), %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm2, %%ymm0"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm1"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpackuswb %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu (%[k]), %%ymm4"
+			 "\n\t vpcmpeqb (%[s]), %%ymm4, %%ymm2"
+			 "\n\t vpblendvb %%ymm2, (%[d]), %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [s] "r" (src + i), [w] "r" (params->weights), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	surfacecolorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void surfacecolorkey16_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[w]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[w]), %%ymm6"
+			 "\n\t vmovdqu (%[m]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu (%[d]), %%ymm1"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm1, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $11, %%ymm0, %%ymm3"
+			 "\n\t vpsrlw $11, %%ymm1, %%ymm4"
+			 "\n\t vpmullw %%ymm5, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpaddw %%ymm4, %%ymm3, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm3, %%ymm3"
+			 "\n\t vpsllw $11, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu 32(%[m]), %%ymm7"
+			 "\n\t vpsrlw $5, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $5, %%ymm1, %%ymm1"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vpand %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm5, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsllw $5, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm0, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu (%[k]), %%ymm7"
+			 "\n\t vpcmpeqw (%[s]), %%ymm7, %%ymm3"
+			 "\n\t vpblendvb %%ymm3, (%[d]), %%ymm2, %%ymm2"
+			 "\n\t vmovdqu %%ymm2, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [w] "r" (params->weights),
+			    [m] "r" (composite_field_masks), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	surfacecolorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surfacecolorkey32_avx2 (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[w]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[w]), %%ymm6"
+			 "\n\t vpxor %%ymm7, %%ymm7, %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm2"
+			 "\n\t vmovdqu (%[d]), %%ymm3"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm2, %%ymm0"
+			 "\n\t vpunpcklbw %%ymm7, %%ymm3, %%ymm1"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpunpckhbw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpmullw %%ymm5, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm6, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm5, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm6, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpackuswb %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu (%[k]), %%ymm4"
+			 "\n\t vpcmpeqd (%[s]), %%ymm4, %%ymm2"
+			 "\n\t vpblendvb %%ymm2, (%[d]), %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [w] "r" (params->weights), [k] "r" (params->keys)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	surfacecolorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+static inline uint8x8_t blend_neon (uint8x8_t s, uint8x8_t d, uint16x8_t alpha, uint16x8_t inv)
+{
+	return vshrn_n_u16 (vmlaq_u16 (vmulq_u16 (vmovl_u8 (s), alpha), vmovl_u8 (d), inv), 8);
+}
+
+static inline uint16x8_t blend_field_neon (uint16x8_t s, uint16x8_t d, uint16x8_t alpha, uint16x8_t inv)
+{
+	return vshrq_n_u16 (vmlaq_u16 (vmulq_u16 (s, alpha), d, inv), 8);
+}
+
+static inline uint16x8_t blend_rgb16_neon (uint16x8_t s, uint16x8_t d, uint16x8_t alpha, uint16x8_t inv)
+{
+	uint16x8_t m5 = vdupq_n_u16 (0x1f);
+	uint16x8_t m6 = vdupq_n_u16 (0x3f);
+	uint16x8_t c0, c1, c2;
+
+	c0 = blend_field_neon (vandq_u16 (s, m5), vandq_u16 (d, m5), alpha, inv);
+	c1 = blend_field_neon (vandq_u16 (vshrq_n_u16 (s, 5), m6), vandq_u16 (vshrq_n_u16 (d, 5), m6), alpha, inv);
+	c2 = blend_field_neon (vshrq_n_u16 (s, 11), vshrq_n_u16 (d, 11), alpha, inv);
+
+	return vorrq_u16 (c0, vorrq_u16 (vshlq_n_u16 (c1, 5), vshlq_n_u16 (c2, 11)));
+}
+
+/* Eight pixels split in their channels, the alpha channel is left as it is */
+static void alphasrc32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint8x8x4_t s, d;
+	uint16x8_t alpha, inv;
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld4_u8 (src + i * 4);
+		d = vld4_u8 (dest + i * 4);
+
+		alpha = vmovl_u8 (s.val[3]);
+		inv = vsubq_u16 (vdupq_n_u16 (0x100), alpha);
+
+		d.val[0] = blend_neon (s.val[0], d.val[0], alpha, inv);
+		d.val[1] = blend_neon (s.val[1], d.val[1], alpha, inv);
+		d.val[2] = blend_neon (s.val[2], d.val[2], alpha, inv);
+
+		vst4_u8 (dest + i * 4, d);
+	}
+
+	alphasrc32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void premultiplied32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint8x8x4_t s, d;
+	uint16x8_t inv;
+	int i, k;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld4_u8 (src + i * 4);
+		d = vld4_u8 (dest + i * 4);
+
+		inv = vsubq_u16 (vdupq_n_u16 (0x100), vmovl_u8 (s.val[3]));
+
+		for (k = 0; k < 4; k++)
+			d.val[k] = vqadd_u8 (s.val[k], vshrn_n_u16 (vmulq_u16 (vmovl_u8 (d.val[k]), inv), 8));
+
+		vst4_u8 (dest + i * 4, d);
+	}
+
+	premultiplied32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void colorkey8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint8x16_t key = vdupq_n_u8 (params->keys[0]);
+	uint8x16_t s;
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		s = vld1q_u8 (src + i);
+
+		vst1q_u8 (dest + i, vbslq_u8 (vceqq_u8 (s, key), vld1q_u8 (dest + i), s));
+	}
+
+	colorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void colorkey16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	uint16x8_t key = vdupq_n_u16 (params->keys[0]);
+	uint16x8_t s;
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld1q_u16 (sbuf + i);
+
+		vst1q_u16 (dbuf + i, vbslq_u16 (vceqq_u16 (s, key), vld1q_u16 (dbuf + i), s));
+	}
+
+	colorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void colorkey32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint32_t *dbuf = (uint32_t *) dest;
+	const uint32_t *sbuf = (const uint32_t *) src;
+	uint32x4_t key = vdupq_n_u32 (params->keys[0]);
+	uint32x4_t s;
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		s = vld1q_u32 (sbuf + i);
+
+		vst1q_u32 (dbuf + i, vbslq_u32 (vceqq_u32 (s, key), vld1q_u32 (dbuf + i), s));
+	}
+
+	colorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+static void surface_bytes_neon (uint8_t *dest, const uint8_t *src, int n, const CompositeParams *params)
+{
+	uint16x8_t alpha = vld1q_u16 (params->weights[0]);
+	uint16x8_t inv = vld1q_u16 (params->weights[1]);
+	uint8x16_t s, d;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		s = vld1q_u8 (src + i);
+		d = vld1q_u8 (dest + i);
+
+		vst1q_u8 (dest + i, vcombine_u8 (blend_neon (vget_low_u8 (s), vget_low_u8 (d), alpha, inv),
+					blend_neon (vget_high_u8 (s), vget_high_u8 (d), alpha, inv)));
+	}
+
+	surface_bytes_c (dest + i, src + i, n - i, params);
+}
+
+static void surface8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_neon (dest, src, width, params);
+}
+
+static void surface16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	uint16x8_t alpha = vdupq_n_u16 (params->weights[0][0]);
+	uint16x8_t inv = vdupq_n_u16 (params->weights[1][0]);
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8)
+		vst1q_u16 (dbuf + i, blend_rgb16_neon (vld1q_u16 (sbuf + i), vld1q_u16 (dbuf + i), alpha, inv));
+
+	surface16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surface24_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_neon (dest, src, width * 3, params);
+}
+
+static void surface32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	surface_bytes_neon (dest, src, width * 4, params);
+}
+
+static void surfacecolorkey8_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16x8_t alpha = vld1q_u16 (params->weights[0]);
+	uint16x8_t inv = vld1q_u16 (params->weights[1]);
+	uint8x16_t key = vdupq_n_u8 (params->keys[0]);
+	uint8x16_t s, d, blend;
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		s = vld1q_u8 (src + i);
+		d = vld1q_u8 (dest + i);
+
+		blend = vcombine_u8 (blend_neon (vget_low_u8 (s), vget_low_u8 (d), alpha, inv),
+				blend_neon (vget_high_u8 (s), vget_high_u8 (d), alpha, inv));
+
+		vst1q_u8 (dest + i, vbslq_u8 (vceqq_u8 (s, key), d, blend));
+	}
+
+	surfacecolorkey8_c (dest + i, src + i, width - i, params);
+}
+
+static void surfacecolorkey16_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	uint16x8_t alpha = vdupq_n_u16 (params->weights[0][0]);
+	uint16x8_t inv = vdupq_n_u16 (params->weights[1][0]);
+	uint16x8_t key = vdupq_n_u16 (params->keys[0]);
+	uint16x8_t s, d;
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld1q_u16 (sbuf + i);
+		d = vld1q_u16 (dbuf + i);
+
+		vst1q_u16 (dbuf + i, vbslq_u16 (vceqq_u16 (s, key), d, blend_rgb16_neon (s, d, alpha, inv)));
+	}
+
+	surfacecolorkey16_c (dest + i * 2, src + i * 2, width - i, params);
+}
+
+static void surfacecolorkey32_neon (uint8_t *dest, const uint8_t *src, int width, const CompositeParams *params)
+{
+	uint16x8_t alpha = vld1q_u16 (params->weights[0]);
+	uint16x8_t inv = vld1q_u16 (params->weights[1]);
+	uint32x4_t key = vdupq_n_u32 (params->keys[0]);
+	uint8x16_t s, d, blend;
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		s = vld1q_u8 (src + i * 4);
+		d = vld1q_u8 (dest + i * 4);
+
+		blend = vcombine_u8 (blend_neon (vget_low_u8 (s), vget_low_u8 (d), alpha, inv),
+				blend_neon (vget_high_u8 (s), vget_high_u8 (d), alpha, inv));
+
+		vst1q_u8 (dest + i * 4, vbslq_u8 (vreinterpretq_u8_u32 (vceqq_u32 (vreinterpretq_u32_u8 (s), key)),
+					d, blend));
+	}
+
+	surfacecolorkey32_c (dest + i * 4, src + i * 4, width - i, params);
+}
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
@@ -0,0 +1,14 @@
+#ifndef _LV_VIDEO_COMPOSITE_H
+#define _LV_VIDEO_COMPOSITE_H
+
+#include "lv_video.h"
+
+/* The compositors blend src over dest, both of the same depth and size, with the
+ * colorkey and surface alpha of src */
+void visual_video_composite_alphasrc (VisVideo *dest, VisVideo *src);
+void visual_video_composite_premultiplied (VisVideo *dest, VisVideo *src);
+void visual_video_composite_colorkey (VisVideo *dest, VisVideo *src);
+void visual_video_composite_surface (VisVideo *dest, VisVideo *src);
+void visual_video_composite_surfacecolorkey (VisVideo *dest, VisVideo *src);
+
+#endif /* _LV_VIDEO_COMPOSITE_H */
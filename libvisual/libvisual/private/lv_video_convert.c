@@ -1,17 +1,184 @@
+#include "config.h"
 #include "lv_video_convert.h"
 #include "lv_common.h"
+#include "lv_cpu.h"
 
-#pragma pack(1)
-
-typedef struct {
-#ifdef VISUAL_LITTLE_ENDIAN
-	uint16_t b:5, g:6, r:5;
-#else
-	uint16_t r:5, g:6, b:5;
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
 #endif
-} rgb16_t;
 
-#pragma pack()
+/*
+ * The depth conversions and byte flips are split in row kernels, driven over the
+ * rows by convert_run(). Every kernel takes its pixels packed, the pitches are only
+ * seen by the driver. The 8 bits sources go through a 256 entries table built from
+ * the palette, in the destination format. The 8 bits destinations are narrowed to 16
+ * bits first, by the same kernels, which then index the lookup table of the palette.
+ * The fused blends go through a run buffer at the source depth, which stays in the
+ * cache between the blend and the conversion.
+ *
+ * 16 bits pixels are r:5 g:6 b:5 from the most significant bit. Narrowing drops the
+ * low bits of every channel, widening shifts them back up without filling in the low
+ * bits. The vector kernels give bit identical results to the C ones, they work on
+ * whole vectors and hand the end of the row to the C kernel.
+ */
+
+/* Pixels narrowed at once on the way to 8 bits */
+#define CONVERT_LOOKUP_RUN	512
+
+/* Pixels blended at once before being converted */
+#define CONVERT_BLEND_RUN	512
+
+typedef enum {
+	CONVERT_INDEX8_TO_RGB16,
+	CONVERT_INDEX8_TO_RGB24,
+	CONVERT_INDEX8_TO_ARGB32,
+	CONVERT_RGB16_TO_RGB24,
+	CONVERT_RGB16_TO_ARGB32,
+	CONVERT_RGB24_TO_RGB16,
+	CONVERT_RGB24_TO_ARGB32,
+	CONVERT_ARGB32_TO_RGB16,
+	CONVERT_ARGB32_TO_RGB24,
+	CONVERT_FLIP16,
+	CONVERT_FLIP24,
+	CONVERT_FLIP32,
+	CONVERT_LAST
+} ConvertType;
+
+/* Converts width pixels, colors is the palette table for the 8 bits sources */
+typedef void (*ConvertRowFunc)(uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+
+static void convert_run (VisVideo *dest, VisVideo *src, ConvertType type, const uint32_t *colors);
+static void convert_run_lookup (VisVideo *dest, VisVideo *src, ConvertType type, const uint8_t *table);
+static void convert_build_colors (uint32_t *colors, VisPalette *pal, int depth);
+
+static void index8_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void index8_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void index8_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb16_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb16_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static void rgb16_to_argb32_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb16_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip16_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+
+static void rgb16_to_rgb24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_rgb16_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_argb32_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip32_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+
+static void index8_to_rgb16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void index8_to_rgb24_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void index8_to_argb32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb16_to_argb32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void rgb16_to_rgb24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb16_to_argb32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_rgb16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void rgb24_to_argb32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void argb32_to_rgb24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+static void flip32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors);
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
+
+/* Optimal kernels set by visual_video_convert_initialize(). */
+
+static ConvertRowFunc convert_rows[CONVERT_LAST] = {
+	[CONVERT_INDEX8_TO_RGB16]	= index8_to_rgb16_c,
+	[CONVERT_INDEX8_TO_RGB24]	= index8_to_rgb24_c,
+	[CONVERT_INDEX8_TO_ARGB32]	= index8_to_argb32_c,
+	[CONVERT_RGB16_TO_RGB24]	= rgb16_to_rgb24_c,
+	[CONVERT_RGB16_TO_ARGB32]	= rgb16_to_argb32_c,
+	[CONVERT_RGB24_TO_RGB16]	= rgb24_to_rgb16_c,
+	[CONVERT_RGB24_TO_ARGB32]	= rgb24_to_argb32_c,
+	[CONVERT_ARGB32_TO_RGB16]	= argb32_to_rgb16_c,
+	[CONVERT_ARGB32_TO_RGB24]	= argb32_to_rgb24_c,
+	[CONVERT_FLIP16]		= flip16_c,
+	[CONVERT_FLIP24]		= flip24_c,
+	[CONVERT_FLIP32]		= flip32_c
+};
+
+void visual_video_convert_initialize (void)
+{
+	/* Arranged from slow to fast, so the slower version gets overloaded
+	 * every time */
+
+	convert_rows[CONVERT_INDEX8_TO_RGB16]	= index8_to_rgb16_c;
+	convert_rows[CONVERT_INDEX8_TO_RGB24]	= index8_to_rgb24_c;
+	convert_rows[CONVERT_INDEX8_TO_ARGB32]	= index8_to_argb32_c;
+	convert_rows[CONVERT_RGB16_TO_RGB24]	= rgb16_to_rgb24_c;
+	convert_rows[CONVERT_RGB16_TO_ARGB32]	= rgb16_to_argb32_c;
+	convert_rows[CONVERT_RGB24_TO_RGB16]	= rgb24_to_rgb16_c;
+	convert_rows[CONVERT_RGB24_TO_ARGB32]	= rgb24_to_argb32_c;
+	convert_rows[CONVERT_ARGB32_TO_RGB16]	= argb32_to_rgb16_c;
+	convert_rows[CONVERT_ARGB32_TO_RGB24]	= argb32_to_rgb24_c;
+	convert_rows[CONVERT_FLIP16]		= flip16_c;
+	convert_rows[CONVERT_FLIP24]		= flip24_c;
+	convert_rows[CONVERT_FLIP32]		= flip32_c;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+	if (visual_cpu_get_sse2 () > 0) {
+		convert_rows[CONVERT_RGB16_TO_ARGB32]	= rgb16_to_argb32_sse2;
+		convert_rows[CONVERT_ARGB32_TO_RGB16]	= argb32_to_rgb16_sse2;
+		convert_rows[CONVERT_FLIP16]		= flip16_sse2;
+	}
+
+	/* Everything that touches 24 bits pixels needs the byte shuffles */
+	if (visual_cpu_get_ssse3 () > 0) {
+		convert_rows[CONVERT_RGB16_TO_RGB24]	= rgb16_to_rgb24_ssse3;
+		convert_rows[CONVERT_RGB24_TO_RGB16]	= rgb24_to_rgb16_ssse3;
+		convert_rows[CONVERT_RGB24_TO_ARGB32]	= rgb24_to_argb32_ssse3;
+		convert_rows[CONVERT_ARGB32_TO_RGB24]	= argb32_to_rgb24_ssse3;
+		convert_rows[CONVERT_FLIP24]		= flip24_ssse3;
+		convert_rows[CONVERT_FLIP32]		= flip32_ssse3;
+	}
+
+	/* The palette lookups are gathers, the 24 bits ones stay with ssse3 as the
+	 * shuffles don't cross the 128 bits lanes */
+	if (visual_cpu_get_avx2 () > 0) {
+		convert_rows[CONVERT_INDEX8_TO_RGB16]	= index8_to_rgb16_avx2;
+		convert_rows[CONVERT_INDEX8_TO_RGB24]	= index8_to_rgb24_avx2;
+		convert_rows[CONVERT_INDEX8_TO_ARGB32]	= index8_to_argb32_avx2;
+		convert_rows[CONVERT_RGB16_TO_ARGB32]	= rgb16_to_argb32_avx2;
+		convert_rows[CONVERT_ARGB32_TO_RGB16]	= argb32_to_rgb16_avx2;
+		convert_rows[CONVERT_FLIP16]		= flip16_avx2;
+		convert_rows[CONVERT_FLIP32]		= flip32_avx2;
+	}
+
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON) && defined(VISUAL_LITTLE_ENDIAN)
+
+	/* The 8 bits sources stay scalar, there is no gather to look up the palette */
+	if (visual_cpu_get_neon () > 0) {
+		convert_rows[CONVERT_RGB16_TO_RGB24]	= rgb16_to_rgb24_neon;
+		convert_rows[CONVERT_RGB16_TO_ARGB32]	= rgb16_to_argb32_neon;
+		convert_rows[CONVERT_RGB24_TO_RGB16]	= rgb24_to_rgb16_neon;
+		convert_rows[CONVERT_RGB24_TO_ARGB32]	= rgb24_to_argb32_neon;
+		convert_rows[CONVERT_ARGB32_TO_RGB16]	= argb32_to_rgb16_neon;
+		convert_rows[CONVERT_ARGB32_TO_RGB24]	= argb32_to_rgb24_neon;
+		convert_rows[CONVERT_FLIP16]		= flip16_neon;
+		convert_rows[CONVERT_FLIP24]		= flip24_neon;
+		convert_rows[CONVERT_FLIP32]		= flip32_neon;
+	}
+
+#endif
+}
 
 void visual_video_convert_get_smallest (VisVideo *dest, VisVideo *src, int *width, int *height)
 {
@@ -19,534 +186,1123 @@ void visual_video_convert_get_smallest (VisVideo *dest, VisVideo *src, int *widt
 	*height = dest->height > src->height ? src->height : dest->height;
 }
 
-void visual_video_index8_to_rgb16 (VisVideo *dest, VisVideo *src)
+static void convert_run (VisVideo *dest, VisVideo *src, ConvertType type, const uint32_t *colors)
 {
-	int x, y, i;
-	int w;
-	int h;
-
-	int ddiff;
-	int sdiff;
+	ConvertRowFunc func = convert_rows[type];
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	const uint8_t *sbuf = visual_video_get_pixels (src);
+	int w, h, y;
 
-	rgb16_t* dbuf = visual_video_get_pixels (dest);
-	uint8_t* sbuf = visual_video_get_pixels (src);
+	visual_video_convert_get_smallest (dest, src, &w, &h);
 
-	rgb16_t colors[256];
+	for (y = 0; y < h; y++) {
+		func (dbuf, sbuf, w, colors);
 
-	for(i = 0; i < 256; i++) {
-		colors[i].r = src->pal->colors[i].r >> 3;
-		colors[i].g = src->pal->colors[i].g >> 2;
-		colors[i].b = src->pal->colors[i].b >> 3;
+		dbuf += dest->pitch;
+		sbuf += src->pitch;
 	}
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+void visual_video_convert_blend (VisVideo *dest, VisVideo *src1, VisVideo *src2, VisAlphaBlendFunc blend, uint8_t alpha)
+{
+	/* Indexed by the bytes per pixel of the source and the destination */
+	static const ConvertType types[5][5] = {
+		[2] = { [3] = CONVERT_RGB16_TO_RGB24,	[4] = CONVERT_RGB16_TO_ARGB32 },
+		[3] = { [2] = CONVERT_RGB24_TO_RGB16,	[4] = CONVERT_RGB24_TO_ARGB32 },
+		[4] = { [2] = CONVERT_ARGB32_TO_RGB16,	[3] = CONVERT_ARGB32_TO_RGB24 }
+	};
+	ConvertRowFunc func = convert_rows[types[src1->bpp][dest->bpp]];
+	uint32_t row[CONVERT_BLEND_RUN];
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	uint8_t *sbuf1 = visual_video_get_pixels (src1);
+	uint8_t *sbuf2 = visual_video_get_pixels (src2);
+	int bpp = src1->bpp;
+	int w, h, x, y, n;
 
-	ddiff = (dest->pitch / dest->bpp) - w;
-	sdiff = src->pitch - (w * src->bpp);
+	visual_video_convert_get_smallest (dest, src1, &w, &h);
 
 	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-			*(dbuf++) = colors[*(sbuf++)];
+		for (x = 0; x < w; x += n) {
+			n = w - x > CONVERT_BLEND_RUN ? CONVERT_BLEND_RUN : w - x;
+
+			blend ((uint8_t *) row, sbuf1 + x * bpp, sbuf2 + x * bpp, n * bpp, alpha);
+			func (dbuf + x * dest->bpp, (const uint8_t *) row, n, NULL);
 		}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+		dbuf += dest->pitch;
+		sbuf1 += src1->pitch;
+		sbuf2 += src2->pitch;
 	}
 }
 
-void visual_video_index8_to_rgb24 (VisVideo *dest, VisVideo *src)
+/* Runs of the row are narrowed to 16 bits with the kernel for type, CONVERT_LAST for
+ * 16 bits sources, the 16 bits pixels index the lookup table of the destination palette */
+static void convert_run_lookup (VisVideo *dest, VisVideo *src, ConvertType type, const uint8_t *table)
 {
-	int x, y;
-	int w;
-	int h;
-
-	int ddiff;
-	int sdiff;
-
+	ConvertRowFunc func = type != CONVERT_LAST ? convert_rows[type] : NULL;
+	uint16_t row[CONVERT_LOOKUP_RUN];
+	const uint16_t *pixels;
 	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	const uint8_t *sbuf = visual_video_get_pixels (src);
+	int w, h, x, y;
+	int i, n;
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	if (table == NULL)
+		return;
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+	visual_video_convert_get_smallest (dest, src, &w, &h);
 
 	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
+		for (x = 0; x < w; x += n) {
+			n = w - x > CONVERT_LOOKUP_RUN ? CONVERT_LOOKUP_RUN : w - x;
+
+			if (func != NULL) {
+				func ((uint8_t *) row, sbuf + x * src->bpp, n, NULL);
+				pixels = row;
+			} else {
+				pixels = (const uint16_t *) sbuf + x;
+			}
+
+			for (i = 0; i < n; i++)
+				dbuf[x + i] = table[pixels[i]];
+		}
+
+		dbuf += dest->pitch;
+		sbuf += src->pitch;
+	}
+}
+
+/* The table entries are the destination pixels, 24 bits ones in the first three bytes */
+static void convert_build_colors (uint32_t *colors, VisPalette *pal, int depth)
+{
+	VisColor *c;
+	uint8_t *p;
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		c = &pal->colors[i];
+
+		switch (depth) {
+			case 16:
+				colors[i] = (c->r >> 3) << 11 | (c->g >> 2) << 5 | c->b >> 3;
+				break;
+
+			case 24:
+				colors[i] = 0;
+				p = (uint8_t *) &colors[i];
 #ifdef VISUAL_LITTLE_ENDIAN
-			*(dbuf++) = src->pal->colors[*(sbuf)].b;
-			*(dbuf++) = src->pal->colors[*(sbuf)].g;
-			*(dbuf++) = src->pal->colors[*(sbuf)].r;
+				p[0] = c->b;
+				p[1] = c->g;
+				p[2] = c->r;
 #else
-			*(dbuf++) = src->pal->colors[*(sbuf)].r;
-			*(dbuf++) = src->pal->colors[*(sbuf)].g;
-			*(dbuf++) = src->pal->colors[*(sbuf)].b;
+				p[0] = c->r;
+				p[1] = c->g;
+				p[2] = c->b;
 #endif /* VISUAL_LITTLE_ENDIAN */
-			sbuf++;
-		}
+				break;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+			default:
+				colors[i] = 255 << 24 | c->r << 16 | c->g << 8 | c->b;
+				break;
+		}
 	}
 }
 
-void visual_video_index8_to_argb32 (VisVideo *dest, VisVideo *src)
+void visual_video_index8_to_rgb16 (VisVideo *dest, VisVideo *src)
 {
-	int x, y, i;
-	int w;
-	int h;
+	uint32_t colors[256];
 
-	uint32_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	convert_build_colors (colors, src->pal, 16);
+	convert_run (dest, src, CONVERT_INDEX8_TO_RGB16, colors);
+}
 
-	int ddiff;
-	int sdiff;
+void visual_video_index8_to_rgb24 (VisVideo *dest, VisVideo *src)
+{
+	uint32_t colors[256];
 
+	convert_build_colors (colors, src->pal, 24);
+	convert_run (dest, src, CONVERT_INDEX8_TO_RGB24, colors);
+}
+
+void visual_video_index8_to_argb32 (VisVideo *dest, VisVideo *src)
+{
 	uint32_t colors[256];
 
-	for (i = 0; i < 256; ++i) {
-		colors[i] =
-			255 << 24 |
-			src->pal->colors[i].r << 16 |
-			src->pal->colors[i].g << 8 |
-			src->pal->colors[i].b;
-	}
+	convert_build_colors (colors, src->pal, 32);
+	convert_run (dest, src, CONVERT_INDEX8_TO_ARGB32, colors);
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+void visual_video_rgb16_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table)
+{
+	convert_run_lookup (dest, src, CONVERT_LAST, table);
+}
 
-	ddiff = (dest->pitch / dest->bpp) - w;
-	sdiff = src->pitch - (w * src->bpp);
+void visual_video_rgb16_to_rgb24 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_RGB16_TO_RGB24, NULL);
+}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-			*(dbuf++) = colors[*(sbuf++)];
-		}
+void visual_video_rgb16_to_argb32 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_RGB16_TO_ARGB32, NULL);
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table)
+{
+	convert_run_lookup (dest, src, CONVERT_RGB24_TO_RGB16, table);
 }
 
-void visual_video_rgb16_to_index8 (VisVideo *dest, VisVideo *src)
+void visual_video_rgb24_to_rgb16 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
+	convert_run (dest, src, CONVERT_RGB24_TO_RGB16, NULL);
+}
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	rgb16_t *sbuf = visual_video_get_pixels (src);
+void visual_video_rgb24_to_argb32 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_RGB24_TO_ARGB32, NULL);
+}
 
-	int ddiff;
-	int sdiff;
+void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table)
+{
+	convert_run_lookup (dest, src, CONVERT_ARGB32_TO_RGB16, table);
+}
 
-	uint8_t r, g, b, col;
+void visual_video_argb32_to_rgb16 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_ARGB32_TO_RGB16, NULL);
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+void visual_video_argb32_to_rgb24 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_ARGB32_TO_RGB24, NULL);
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch  / src->bpp) - w;
+void visual_video_flip_pixel_bytes_color16 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_FLIP16, NULL);
+}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-			r = sbuf->r << 3;
-			g = sbuf->g << 2;
-			b = sbuf->b << 3;
-			sbuf++;
+void visual_video_flip_pixel_bytes_color24 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_FLIP24, NULL);
+}
 
-			col = (r + g + b) / 3;
+void visual_video_flip_pixel_bytes_color32 (VisVideo *dest, VisVideo *src)
+{
+	convert_run (dest, src, CONVERT_FLIP32, NULL);
+}
 
-			dest->pal->colors[col].r = r;
-			dest->pal->colors[col].g = g;
-			dest->pal->colors[col].b = b;
+/* C kernels */
 
-			*(dbuf++) = col;
-		}
+static void index8_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint16_t *d = (uint16_t *) dest;
+	int x;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+	for (x = 0; x < width; x++)
+		d[x] = colors[src[x]];
+}
+
+static void index8_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	const uint8_t *c;
+	int x;
+
+	for (x = 0; x < width; x++) {
+		c = (const uint8_t *) &colors[src[x]];
+
+		*(dest++) = c[0];
+		*(dest++) = c[1];
+		*(dest++) = c[2];
 	}
 }
 
-void visual_video_rgb16_to_rgb24 (VisVideo *dest, VisVideo *src)
+static void index8_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	uint32_t *d = (uint32_t *) dest;
+	int x;
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	rgb16_t *sbuf = visual_video_get_pixels (src);
+	for (x = 0; x < width; x++)
+		d[x] = colors[src[x]];
+}
 
-	int ddiff;
-	int sdiff;
+static void rgb16_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	const uint16_t *s = (const uint16_t *) src;
+	int x;
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	for (x = 0; x < width; x++) {
+#ifdef VISUAL_LITTLE_ENDIAN
+		*(dest++) = (s[x] & 0x1f) << 3;
+		*(dest++) = ((s[x] >> 5) & 0x3f) << 2;
+		*(dest++) = (s[x] >> 11) << 3;
+#else
+		*(dest++) = (s[x] >> 11) << 3;
+		*(dest++) = ((s[x] >> 5) & 0x3f) << 2;
+		*(dest++) = (s[x] & 0x1f) << 3;
+#endif /* VISUAL_LITTLE_ENDIAN */
+	}
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch  / src->bpp) - w;
+static void rgb16_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	const uint16_t *s = (const uint16_t *) src;
+	int x;
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
+	for (x = 0; x < width; x++) {
 #ifdef VISUAL_LITTLE_ENDIAN
-			*(dbuf++) = sbuf->b << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->r << 3;
+		*(dest++) = (s[x] & 0x1f) << 3;
+		*(dest++) = ((s[x] >> 5) & 0x3f) << 2;
+		*(dest++) = (s[x] >> 11) << 3;
+		*(dest++) = 255;
 #else
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->b << 3;
+		*(dest++) = 255;
+		*(dest++) = (s[x] >> 11) << 3;
+		*(dest++) = ((s[x] >> 5) & 0x3f) << 2;
+		*(dest++) = (s[x] & 0x1f) << 3;
 #endif /* VISUAL_LITTLE_ENDIAN */
-			sbuf++;
-		}
+	}
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+static void rgb24_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint16_t *d = (uint16_t *) dest;
+	int x;
+
+	for (x = 0; x < width; x++) {
+#ifdef VISUAL_LITTLE_ENDIAN
+		d[x] = (src[2] >> 3) << 11 | (src[1] >> 2) << 5 | src[0] >> 3;
+#else
+		d[x] = (src[0] >> 3) << 11 | (src[1] >> 2) << 5 | src[2] >> 3;
+#endif /* VISUAL_LITTLE_ENDIAN */
+
+		src += 3;
 	}
 }
 
-void visual_video_rgb16_to_argb32 (VisVideo *dest, VisVideo *src)
+static void rgb24_to_argb32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	int x;
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	rgb16_t *sbuf = visual_video_get_pixels (src);
+	for (x = 0; x < width; x++) {
+#ifdef VISUAL_LITTLE_ENDIAN
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		*(dest++) = 255;
+#else
+		*(dest++) = 255;
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+#endif /* VISUAL_LITTLE_ENDIAN */
+	}
+}
 
-	int ddiff;
-	int sdiff;
+static void argb32_to_rgb16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint16_t *d = (uint16_t *) dest;
+	int x;
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	for (x = 0; x < width; x++) {
+#ifdef VISUAL_LITTLE_ENDIAN
+		d[x] = (src[2] >> 3) << 11 | (src[1] >> 2) << 5 | src[0] >> 3;
+#else
+		d[x] = (src[1] >> 3) << 11 | (src[2] >> 2) << 5 | src[3] >> 3;
+#endif /* VISUAL_LITTLE_ENDIAN */
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch  / src->bpp) - w;
+		src += 4;
+	}
+}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
+static void argb32_to_rgb24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int x;
+
+	for (x = 0; x < width; x++) {
 #ifdef VISUAL_LITTLE_ENDIAN
-			*(dbuf++) = sbuf->b << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = 255;
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		src++;
 #else
-			*(dbuf++) = 255;
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->b << 3;
+		src++;
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
+		*(dest++) = *(src++);
 #endif /* VISUAL_LITTLE_ENDIAN */
+	}
+}
 
-			sbuf++;
-		}
+/* The flips read a whole pixel before writing it, dest and src may be the same */
+
+static void flip16_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	const uint16_t *s = (const uint16_t *) src;
+	uint16_t *d = (uint16_t *) dest;
+	uint16_t p;
+	int x;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+	for (x = 0; x < width; x++) {
+		p = s[x];
+
+		d[x] = (p << 11) | (p & 0x07e0) | (p >> 11);
 	}
 }
 
-void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src)
+static void flip24_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
-	uint8_t r, g, b, col;
+	uint8_t c;
+	int x;
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	for (x = 0; x < width; x++) {
+		c = src[0];
 
-	int ddiff;
-	int sdiff;
+		dest[0] = src[2];
+		dest[1] = src[1];
+		dest[2] = c;
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+		dest += 3;
+		src += 3;
+	}
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+static void flip32_c (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint8_t c0, c1;
+	int x;
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			b = *(sbuf++);
-			g = *(sbuf++);
-			r = *(sbuf++);
-#else
-			r = *(sbuf++);
-			g = *(sbuf++);
-			b = *(sbuf++);
-#endif /* VISUAL_LITTLE_ENDIAN */
+	for (x = 0; x < width; x++) {
+		c0 = src[0];
+		c1 = src[1];
+
+		dest[0] = src[3];
+		dest[1] = src[2];
+		dest[2] = c1;
+		dest[3] = c0;
 
-			col = (b + g + r) / 3;
+		dest += 4;
+		src += 4;
+	}
+}
 
-			dest->pal->colors[col].r = r;
-			dest->pal->colors[col].g = g;
-			dest->pal->colors[col].b = b;
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
-			*(dbuf++) = col;
-		}
+/* Widening 16 bits: b << 3, g << 2 | r << 8 in word pairs, then the alpha byte */
+static const uint16_t rgb16_widen_masks[3][8] = {
+	{ 0x00f8, 0x00f8, 0x00f8, 0x00f8, 0x00f8, 0x00f8, 0x00f8, 0x00f8 },
+	{ 0xfc00, 0xfc00, 0xfc00, 0xfc00, 0xfc00, 0xfc00, 0xfc00, 0xfc00 },
+	{ 0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00, 0xff00 }
+};
+
+/* Narrowing to 16 bits, the r, g and b fields out of every 32 bits pixel */
+static const uint32_t rgb16_narrow_masks[3][4] = {
+	{ 0xf800, 0xf800, 0xf800, 0xf800 },
+	{ 0x07e0, 0x07e0, 0x07e0, 0x07e0 },
+	{ 0x001f, 0x001f, 0x001f, 0x001f }
+};
+
+static const uint16_t rgb16_flip_mask[8] = {
+	0x07e0, 0x07e0, 0x07e0, 0x07e0, 0x07e0, 0x07e0, 0x07e0, 0x07e0
+};
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+/* pshufb tables, 0x80 clears the byte */
+static const uint8_t shuffle_rgb24_to_argb32[2][16] = {
+	{ 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80 },
+	{ 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff, 0, 0, 0, 0xff }
+};
+
+static const uint8_t shuffle_argb32_to_rgb24[16] = {
+	0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0x80, 0x80, 0x80, 0x80
+};
+
+static const uint8_t shuffle_flip24[16] = {
+	2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 0x80, 0x80, 0x80, 0x80
+};
+
+static const uint8_t shuffle_flip32[16] = {
+	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/* Packs the three 24 bits pixels of the low 32 bits lanes together */
+static const uint32_t permute_rgb24[8] = { 0, 1, 2, 4, 5, 6, 3, 7 };
+
+static void rgb16_to_argb32_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm5"
+			 "\n\t movdqu 16(%[m]), %%xmm6"
+			 "\n\t movdqu 32(%[m]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t psllw $3, %%xmm0"
+			 "\n\t psllw $5, %%xmm1"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm0"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm5, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm0"
+			 "\n\t por %%xmm7, %%xmm2"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t punpcklwd %%xmm2, %%xmm0"
+			 "\n\t punpckhwd %%xmm2, %%xmm1"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 2), [m] "r" (rgb16_widen_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm5", "xmm6", "xmm7");
 	}
+
+	rgb16_to_argb32_c (dest + i * 4, src + i * 2, width - i, colors);
 }
 
-void visual_video_rgb24_to_rgb16 (VisVideo *dest, VisVideo *src)
+/* The 16 bits values are sign extended so the signed saturating pack keeps them */
+static void argb32_to_rgb16_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm5"
+			 "\n\t movdqu 16(%[m]), %%xmm6"
+			 "\n\t movdqu 32(%[m]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm3"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t psrld $8, %%xmm0"
+			 "\n\t psrld $5, %%xmm1"
+			 "\n\t psrld $3, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm0"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm0"
+			 "\n\t por %%xmm2, %%xmm0"
+			 "\n\t pslld $16, %%xmm0"
+			 "\n\t psrad $16, %%xmm0"
+			 "\n\t movdqa %%xmm3, %%xmm1"
+			 "\n\t movdqa %%xmm3, %%xmm2"
+			 "\n\t psrld $8, %%xmm3"
+			 "\n\t psrld $5, %%xmm1"
+			 "\n\t psrld $3, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm3"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm3"
+			 "\n\t por %%xmm2, %%xmm3"
+			 "\n\t pslld $16, %%xmm3"
+			 "\n\t psrad $16, %%xmm3"
+			 "\n\t packssdw %%xmm3, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 4), [m] "r" (rgb16_narrow_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+	}
 
-	rgb16_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	argb32_to_rgb16_c (dest + i * 2, src + i * 4, width - i, colors);
+}
 
-	int ddiff;
-	int sdiff;
+static void flip16_sse2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t psllw $11, %%xmm0"
+			 "\n\t psrlw $11, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm0"
+			 "\n\t por %%xmm2, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [m] "r" (rgb16_flip_mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	flip16_c (dest + i * 2, src + i * 2, width - i, colors);
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch / src->bpp) - w;
+/* Widened to 32 bits like rgb16_to_argb32_sse2(), then packed to 24 exact bytes */
+static void rgb16_to_rgb24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm5"
+			 "\n\t movdqu 16(%[m]), %%xmm6"
+			 "\n\t movdqu (%[p]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t psllw $3, %%xmm0"
+			 "\n\t psllw $5, %%xmm1"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm0"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm5, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm0"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t punpcklwd %%xmm2, %%xmm0"
+			 "\n\t punpckhwd %%xmm2, %%xmm1"
+			 "\n\t pshufb %%xmm7, %%xmm0"
+			 "\n\t pshufb %%xmm7, %%xmm1"
+			 "\n\t movdqa %%xmm1, %%xmm2"
+			 "\n\t pslldq $12, %%xmm2"
+			 "\n\t por %%xmm2, %%xmm0"
+			 "\n\t psrldq $4, %%xmm1"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movq %%xmm1, 16(%[d])"
+			 :: [d] "r" (dest + i * 3), [s] "r" (src + i * 2), [m] "r" (rgb16_widen_masks),
+			    [p] "r" (shuffle_argb32_to_rgb24)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm5", "xmm6", "xmm7");
+	}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			dbuf->b = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->r = *(sbuf++) >> 3;
-#else
-			dbuf->r = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->b = *(sbuf++) >> 3;
-#endif
-			dbuf++;
-		}
+	rgb16_to_rgb24_c (dest + i * 3, src + i * 2, width - i, colors);
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+/* Every load takes four pixels out of 16 bytes, the last one reads 4 bytes past the
+ * pixels it converts, which have to be in the row */
+static void rgb24_to_rgb16_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 10 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[m]), %%xmm5"
+			 "\n\t movdqu 16(%[m]), %%xmm6"
+			 "\n\t movdqu 32(%[m]), %%xmm7"
+			 "\n\t movdqu (%[p]), %%xmm4"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 12(%[s]), %%xmm3"
+			 "\n\t pshufb %%xmm4, %%xmm0"
+			 "\n\t pshufb %%xmm4, %%xmm3"
+			 "\n\t movdqa %%xmm0, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t psrld $8, %%xmm0"
+			 "\n\t psrld $5, %%xmm1"
+			 "\n\t psrld $3, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm0"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm0"
+			 "\n\t por %%xmm2, %%xmm0"
+			 "\n\t pslld $16, %%xmm0"
+			 "\n\t psrad $16, %%xmm0"
+			 "\n\t movdqa %%xmm3, %%xmm1"
+			 "\n\t movdqa %%xmm3, %%xmm2"
+			 "\n\t psrld $8, %%xmm3"
+			 "\n\t psrld $5, %%xmm1"
+			 "\n\t psrld $3, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm3"
+			 "\n\t pand %%xmm6, %%xmm1"
+			 "\n\t pand %%xmm7, %%xmm2"
+			 "\n\t por %%xmm1, %%xmm3"
+			 "\n\t por %%xmm2, %%xmm3"
+			 "\n\t pslld $16, %%xmm3"
+			 "\n\t psrad $16, %%xmm3"
+			 "\n\t packssdw %%xmm3, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 3), [m] "r" (rgb16_narrow_masks),
+			    [p] "r" (shuffle_rgb24_to_argb32)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
 	}
+
+	rgb24_to_rgb16_c (dest + i * 2, src + i * 3, width - i, colors);
 }
 
-void visual_video_rgb24_to_argb32 (VisVideo *dest, VisVideo *src)
+static void rgb24_to_argb32_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	int i;
+
+	for (i = 0; i + 18 <= width; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[p]), %%xmm6"
+			 "\n\t movdqu 16(%[p]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 12(%[s]), %%xmm1"
+			 "\n\t movdqu 24(%[s]), %%xmm2"
+			 "\n\t movdqu 36(%[s]), %%xmm3"
+			 "\n\t pshufb %%xmm6, %%xmm0"
+			 "\n\t pshufb %%xmm6, %%xmm1"
+			 "\n\t pshufb %%xmm6, %%xmm2"
+			 "\n\t pshufb %%xmm6, %%xmm3"
+			 "\n\t por %%xmm7, %%xmm0"
+			 "\n\t por %%xmm7, %%xmm1"
+			 "\n\t por %%xmm7, %%xmm2"
+			 "\n\t por %%xmm7, %%xmm3"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 "\n\t movdqu %%xmm2, 32(%[d])"
+			 "\n\t movdqu %%xmm3, 48(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 3), [p] "r" (shuffle_rgb24_to_argb32)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm6", "xmm7");
+	}
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	rgb24_to_argb32_c (dest + i * 4, src + i * 3, width - i, colors);
+}
 
-	int ddiff;
-	int sdiff;
+/* Four times twelve bytes are shifted together into three vectors */
+static void argb32_to_rgb24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[p]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm1"
+			 "\n\t movdqu 32(%[s]), %%xmm2"
+			 "\n\t movdqu 48(%[s]), %%xmm3"
+			 "\n\t pshufb %%xmm7, %%xmm0"
+			 "\n\t pshufb %%xmm7, %%xmm1"
+			 "\n\t pshufb %%xmm7, %%xmm2"
+			 "\n\t pshufb %%xmm7, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t pslldq $12, %%xmm4"
+			 "\n\t por %%xmm4, %%xmm0"
+			 "\n\t psrldq $4, %%xmm1"
+			 "\n\t movdqa %%xmm2, %%xmm4"
+			 "\n\t pslldq $8, %%xmm4"
+			 "\n\t por %%xmm4, %%xmm1"
+			 "\n\t psrldq $8, %%xmm2"
+			 "\n\t pslldq $4, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm2"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 "\n\t movdqu %%xmm2, 32(%[d])"
+			 :: [d] "r" (dest + i * 3), [s] "r" (src + i * 4), [p] "r" (shuffle_argb32_to_rgb24)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm7");
+	}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	argb32_to_rgb24_c (dest + i * 3, src + i * 4, width - i, colors);
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+/* Loads like rgb24_to_argb32_ssse3() and stores like argb32_to_rgb24_ssse3(), all
+ * loads go before the stores for the in place flips */
+static void flip24_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 18 <= width; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[p]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 12(%[s]), %%xmm1"
+			 "\n\t movdqu 24(%[s]), %%xmm2"
+			 "\n\t movdqu 36(%[s]), %%xmm3"
+			 "\n\t pshufb %%xmm7, %%xmm0"
+			 "\n\t pshufb %%xmm7, %%xmm1"
+			 "\n\t pshufb %%xmm7, %%xmm2"
+			 "\n\t pshufb %%xmm7, %%xmm3"
+			 "\n\t movdqa %%xmm1, %%xmm4"
+			 "\n\t pslldq $12, %%xmm4"
+			 "\n\t por %%xmm4, %%xmm0"
+			 "\n\t psrldq $4, %%xmm1"
+			 "\n\t movdqa %%xmm2, %%xmm4"
+			 "\n\t pslldq $8, %%xmm4"
+			 "\n\t por %%xmm4, %%xmm1"
+			 "\n\t psrldq $8, %%xmm2"
+			 "\n\t pslldq $4, %%xmm3"
+			 "\n\t por %%xmm3, %%xmm2"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 "\n\t movdqu %%xmm2, 32(%[d])"
+			 :: [d] "r" (dest + i * 3), [s] "r" (src + i * 3), [p] "r" (shuffle_flip24)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm7");
+	}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = 255;
-#else
-			*(dbuf++) = 255;
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-#endif /* VISUAL_LITTLE_ENDIAN */
-		}
+	flip24_c (dest + i * 3, src + i * 3, width - i, colors);
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+static void flip32_ssse3 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[p]), %%xmm7"
+			 "\n\t movdqu (%[s]), %%xmm0"
+			 "\n\t movdqu 16(%[s]), %%xmm1"
+			 "\n\t pshufb %%xmm7, %%xmm0"
+			 "\n\t pshufb %%xmm7, %%xmm1"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 "\n\t movdqu %%xmm1, 16(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [p] "r" (shuffle_flip32)
+			 : "memory", "xmm0", "xmm1", "xmm7");
 	}
+
+	flip32_c (dest + i * 4, src + i * 4, width - i, colors);
 }
 
-void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src)
+/* The table entries are 16 bits values, the unsigned pack keeps them as they are */
+static void index8_to_rgb16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vpmovzxbd (%[s]), %%ymm1"
+			 "\n\t vpmovzxbd 8(%[s]), %%ymm2"
+			 "\n\t vpcmpeqd %%ymm3, %%ymm3, %%ymm3"
+			 "\n\t vpgatherdd %%ymm3, (%[c], %%ymm1, 4), %%ymm0"
+			 "\n\t vpcmpeqd %%ymm3, %%ymm3, %%ymm3"
+			 "\n\t vpgatherdd %%ymm3, (%[c], %%ymm2, 4), %%ymm4"
+			 "\n\t vpackusdw %%ymm4, %%ymm0, %%ymm0"
+			 "\n\t vpermq $0xd8, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i), [c] "r" (colors)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4");
+	}
 
-	uint8_t r, g, b, col;
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	index8_to_rgb16_c (dest + i * 2, src + i, width - i, colors);
+}
 
-	int ddiff;
-	int sdiff;
+static void index8_to_rgb24_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[p]), %%ymm6"
+			 "\n\t vmovdqu (%[q]), %%ymm7"
+			 "\n\t vpmovzxbd (%[s]), %%ymm1"
+			 "\n\t vpcmpeqd %%ymm3, %%ymm3, %%ymm3"
+			 "\n\t vpgatherdd %%ymm3, (%[c], %%ymm1, 4), %%ymm0"
+			 "\n\t vpshufb %%ymm6, %%ymm0, %%ymm0"
+			 "\n\t vpermd %%ymm0, %%ymm7, %%ymm0"
+			 "\n\t vextracti128 $1, %%ymm0, %%xmm1"
+			 "\n\t vmovdqu %%xmm0, (%[d])"
+			 "\n\t vmovq %%xmm1, 16(%[d])"
+			 :: [d] "r" (dest + i * 3), [s] "r" (src + i), [c] "r" (colors),
+			    [p] "r" (shuffle_argb32_to_rgb24), [q] "r" (permute_rgb24)
+			 : "memory", "xmm0", "xmm1", "xmm3", "xmm6", "xmm7");
+	}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+	index8_to_rgb24_c (dest + i * 3, src + i, width - i, colors);
+}
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			b = *(sbuf++);
-			g = *(sbuf++);
-			r = *(sbuf++);
-			sbuf++;
-#else
-			sbuf++;
-			r = *(sbuf++);
-			g = *(sbuf++);
-			b = *(sbuf++);
-#endif /* VISUAL_LITTLE_ENDIAN */
+static void index8_to_argb32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vpmovzxbd (%[s]), %%ymm1"
+			 "\n\t vpmovzxbd 8(%[s]), %%ymm2"
+			 "\n\t vpcmpeqd %%ymm3, %%ymm3, %%ymm3"
+			 "\n\t vpgatherdd %%ymm3, (%[c], %%ymm1, 4), %%ymm0"
+			 "\n\t vpcmpeqd %%ymm3, %%ymm3, %%ymm3"
+			 "\n\t vpgatherdd %%ymm3, (%[c], %%ymm2, 4), %%ymm4"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 "\n\t vmovdqu %%ymm4, 32(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i), [c] "r" (colors)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4");
+	}
 
-			col = (r + g + b) / 3;
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-			dest->pal->colors[col].r = r;
-			dest->pal->colors[col].g = g;
-			dest->pal->colors[col].b = b;
+	index8_to_argb32_c (dest + i * 4, src + i, width - i, colors);
+}
 
-			*(dbuf++) = col;
-		}
+/* The word interleaves stay in their 128 bits lanes, vperm2i128 puts the halves in order */
+static void rgb16_to_argb32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[m]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[m]), %%ymm6"
+			 "\n\t vbroadcasti128 32(%[m]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vpsllw $3, %%ymm0, %%ymm1"
+			 "\n\t vpsllw $5, %%ymm0, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm3"
+			 "\n\t vpand %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpand %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpand %%ymm5, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm2, %%ymm1, %%ymm1"
+			 "\n\t vpor %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpunpcklwd %%ymm3, %%ymm1, %%ymm0"
+			 "\n\t vpunpckhwd %%ymm3, %%ymm1, %%ymm2"
+			 "\n\t vperm2i128 $0x20, %%ymm2, %%ymm0, %%ymm1"
+			 "\n\t vperm2i128 $0x31, %%ymm2, %%ymm0, %%ymm3"
+			 "\n\t vmovdqu %%ymm1, (%[d])"
+			 "\n\t vmovdqu %%ymm3, 32(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 2), [m] "r" (rgb16_widen_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	rgb16_to_argb32_c (dest + i * 4, src + i * 2, width - i, colors);
+}
+
+static void argb32_to_rgb16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[m]), %%ymm5"
+			 "\n\t vbroadcasti128 16(%[m]), %%ymm6"
+			 "\n\t vbroadcasti128 32(%[m]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu 32(%[s]), %%ymm3"
+			 "\n\t vpsrld $8, %%ymm0, %%ymm1"
+			 "\n\t vpsrld $5, %%ymm0, %%ymm2"
+			 "\n\t vpsrld $3, %%ymm0, %%ymm0"
+			 "\n\t vpand %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpand %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vpsrld $8, %%ymm3, %%ymm1"
+			 "\n\t vpsrld $5, %%ymm3, %%ymm2"
+			 "\n\t vpsrld $3, %%ymm3, %%ymm3"
+			 "\n\t vpand %%ymm5, %%ymm1, %%ymm1"
+			 "\n\t vpand %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm1, %%ymm3, %%ymm3"
+			 "\n\t vpor %%ymm2, %%ymm3, %%ymm3"
+			 "\n\t vpackusdw %%ymm3, %%ymm0, %%ymm0"
+			 "\n\t vpermq $0xd8, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 4), [m] "r" (rgb16_narrow_masks)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	argb32_to_rgb16_c (dest + i * 2, src + i * 4, width - i, colors);
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+static void flip16_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[m]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vpsllw $11, %%ymm0, %%ymm1"
+			 "\n\t vpsrlw $11, %%ymm0, %%ymm2"
+			 "\n\t vpand %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpor %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 2), [s] "r" (src + i * 2), [m] "r" (rgb16_flip_mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
 	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	flip16_c (dest + i * 2, src + i * 2, width - i, colors);
 }
 
-void visual_video_argb32_to_rgb16 (VisVideo *dest, VisVideo *src)
+static void flip32_avx2 (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	int x, y;
-	int w;
-	int h;
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[p]), %%ymm7"
+			 "\n\t vmovdqu (%[s]), %%ymm0"
+			 "\n\t vmovdqu 32(%[s]), %%ymm1"
+			 "\n\t vpshufb %%ymm7, %%ymm0, %%ymm0"
+			 "\n\t vpshufb %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 "\n\t vmovdqu %%ymm1, 32(%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src + i * 4), [p] "r" (shuffle_flip32)
+			 : "memory", "xmm0", "xmm1", "xmm7");
+	}
 
-	rgb16_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-	int ddiff;
-	int sdiff;
+	flip32_c (dest + i * 4, src + i * 4, width - i, colors);
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
 
-	ddiff = (dest->pitch / dest->bpp) - w;
-	sdiff = src->pitch - (w * src->bpp);
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			dbuf->b = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->r = *(sbuf++) >> 3;
-			sbuf++;
-#else
-			sbuf++;
-			dbuf->r = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->b = *(sbuf++) >> 3;
-#endif /* VISUAL_LITTLE_ENDIAN */
+/* The structure loads and stores split the pixels in one register per channel */
 
-			dbuf++;
-		}
+static inline uint8x8x3_t rgb16_widen_neon (uint16x8_t p)
+{
+	uint8x8x3_t c;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+	c.val[0] = vmovn_u16 (vshlq_n_u16 (p, 3));
+	c.val[1] = vand_u8 (vshrn_n_u16 (p, 3), vdup_n_u8 (0xfc));
+	c.val[2] = vand_u8 (vshrn_n_u16 (p, 8), vdup_n_u8 (0xf8));
+
+	return c;
 }
 
-void visual_video_argb32_to_rgb24 (VisVideo *dest, VisVideo *src)
+/* Every channel goes to the top of its lane, the shift right inserts keep the high bits */
+static inline uint16x8_t rgb16_narrow_neon (uint8x8_t b, uint8x8_t g, uint8x8_t r)
 {
-	int x, y;
-	int w;
-	int h;
+	uint16x8_t p = vshll_n_u8 (r, 8);
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	p = vsriq_n_u16 (p, vshll_n_u8 (g, 8), 5);
+	p = vsriq_n_u16 (p, vshll_n_u8 (b, 8), 11);
 
-	int ddiff;
-	int sdiff;
+	return p;
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+static void rgb16_to_rgb24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+	for (i = 0; i + 8 <= width; i += 8)
+		vst3_u8 (dest + i * 3, rgb16_widen_neon (vld1q_u16 ((const uint16_t *) (src + i * 2))));
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#ifdef VISUAL_LITTLE_ENDIAN
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			sbuf++;
-#else
-			sbuf++;
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-#endif /* VISUAL_LITTLE_ENDIAN */
-		}
+	rgb16_to_rgb24_c (dest + i * 3, src + i * 2, width - i, colors);
+}
+
+static void rgb16_to_argb32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint8x8x3_t c;
+	uint8x8x4_t d;
+	int i;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+	d.val[3] = vdup_n_u8 (255);
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		c = rgb16_widen_neon (vld1q_u16 ((const uint16_t *) (src + i * 2)));
+
+		d.val[0] = c.val[0];
+		d.val[1] = c.val[1];
+		d.val[2] = c.val[2];
+
+		vst4_u8 (dest + i * 4, d);
 	}
+
+	rgb16_to_argb32_c (dest + i * 4, src + i * 2, width - i, colors);
 }
 
-void visual_video_flip_pixel_bytes_color16 (VisVideo *dest, VisVideo *src)
+static void rgb24_to_rgb16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	rgb16_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = (dest->pitch - (dest->width * dest->bpp)) >> 1;
+	uint8x8x3_t s;
+	int i;
 
-	destbuf = (rgb16_t *) visual_video_get_pixels (dest);
-	srcbuf  = (rgb16_t *) visual_video_get_pixels (src);
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld3_u8 (src + i * 3);
 
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			destbuf->b = srcbuf->r;
-			destbuf->g = srcbuf->g;
-			destbuf->r = srcbuf->b;
-			destbuf++;
-			srcbuf++;
-		}
+		vst1q_u16 ((uint16_t *) (dest + i * 2), rgb16_narrow_neon (s.val[0], s.val[1], s.val[2]));
+	}
+
+	rgb24_to_rgb16_c (dest + i * 2, src + i * 3, width - i, colors);
+}
+
+static void rgb24_to_argb32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint8x16x3_t s;
+	uint8x16x4_t d;
+	int i;
+
+	d.val[3] = vdupq_n_u8 (255);
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		s = vld3q_u8 (src + i * 3);
 
-		destbuf += pitchdiff;
+		d.val[0] = s.val[0];
+		d.val[1] = s.val[1];
+		d.val[2] = s.val[2];
+
+		vst4q_u8 (dest + i * 4, d);
 	}
+
+	rgb24_to_argb32_c (dest + i * 4, src + i * 3, width - i, colors);
 }
 
-void visual_video_flip_pixel_bytes_color24 (VisVideo *dest, VisVideo *src)
+static void argb32_to_rgb16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	uint8_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = dest->pitch - (dest->width * dest->bpp);
+	uint8x8x4_t s;
+	int i;
 
-	destbuf = visual_video_get_pixels (dest);
-	srcbuf = visual_video_get_pixels (src);
+	for (i = 0; i + 8 <= width; i += 8) {
+		s = vld4_u8 (src + i * 4);
 
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			*(destbuf + 2) = *(srcbuf);
-			*(destbuf + 1) = *(srcbuf + 1);
-			*(destbuf) = *(srcbuf + 2);
+		vst1q_u16 ((uint16_t *) (dest + i * 2), rgb16_narrow_neon (s.val[0], s.val[1], s.val[2]));
+	}
 
-			destbuf += dest->bpp;
-			srcbuf += src->bpp;
-		}
+	argb32_to_rgb16_c (dest + i * 2, src + i * 4, width - i, colors);
+}
+
+static void argb32_to_rgb24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint8x16x4_t s;
+	uint8x16x3_t d;
+	int i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		s = vld4q_u8 (src + i * 4);
 
-		destbuf += pitchdiff;
+		d.val[0] = s.val[0];
+		d.val[1] = s.val[1];
+		d.val[2] = s.val[2];
+
+		vst3q_u8 (dest + i * 3, d);
 	}
+
+	argb32_to_rgb24_c (dest + i * 3, src + i * 4, width - i, colors);
 }
 
-void visual_video_flip_pixel_bytes_color32 (VisVideo *dest, VisVideo *src)
+static void flip16_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
 {
-	uint8_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = dest->pitch - (dest->width * dest->bpp);
+	uint16x8_t p;
+	int i;
 
-	destbuf = visual_video_get_pixels (dest);
-	srcbuf = visual_video_get_pixels (src);
+	for (i = 0; i + 8 <= width; i += 8) {
+		p = vld1q_u16 ((const uint16_t *) (src + i * 2));
 
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			destbuf[0] = srcbuf[3];
-			destbuf[1] = srcbuf[2];
-			destbuf[2] = srcbuf[1];
-			destbuf[3] = srcbuf[0];
+		p = vorrq_u16 (vorrq_u16 (vshlq_n_u16 (p, 11), vshrq_n_u16 (p, 11)),
+				vandq_u16 (p, vdupq_n_u16 (0x07e0)));
 
-			destbuf += dest->bpp;
-			srcbuf += src->bpp;
-		}
+		vst1q_u16 ((uint16_t *) (dest + i * 2), p);
+	}
+
+	flip16_c (dest + i * 2, src + i * 2, width - i, colors);
+}
+
+static void flip24_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	uint8x16x3_t s;
+	uint8x16_t c;
+	int i;
 
-		destbuf += pitchdiff;
+	for (i = 0; i + 16 <= width; i += 16) {
+		s = vld3q_u8 (src + i * 3);
+
+		c = s.val[0];
+		s.val[0] = s.val[2];
+		s.val[2] = c;
+
+		vst3q_u8 (dest + i * 3, s);
 	}
+
+	flip24_c (dest + i * 3, src + i * 3, width - i, colors);
 }
+
+static void flip32_neon (uint8_t *dest, const uint8_t *src, int width, const uint32_t *colors)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4)
+		vst1q_u8 (dest + i * 4, vrev32q_u8 (vld1q_u8 (src + i * 4)));
+
+	flip32_c (dest + i * 4, src + i * 4, width - i, colors);
+}
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
@@ -2,6 +2,7 @@
 #define _LV_VIDEO_CONVERT_H
 
 #include "lv_video.h"
+#include "lv_alpha_blend.h"
 
 void visual_video_convert_get_smallest (VisVideo *dest, VisVideo *src, int *width, int *height);
 
@@ -9,15 +10,17 @@ void visual_video_index8_to_rgb16  (VisVideo *dest, VisVideo *src);
 void visual_video_index8_to_rgb24  (VisVideo *dest, VisVideo *src);
 void visual_video_index8_to_argb32 (VisVideo *dest, VisVideo *src);
 
-void visual_video_rgb16_to_index8 (VisVideo *dest, VisVideo *src);
+/* table is the lookup table of the destination palette, taken once before the
+ * conversion is split in bands */
+void visual_video_rgb16_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table);
 void visual_video_rgb16_to_rgb24  (VisVideo *dest, VisVideo *src);
 void visual_video_rgb16_to_argb32 (VisVideo *dest, VisVideo *src);
 
-void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src);
+void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table);
 void visual_video_rgb24_to_rgb16  (VisVideo *dest, VisVideo *src);
 void visual_video_rgb24_to_argb32 (VisVideo *dest, VisVideo *src);
 
-void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src);
+void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src, const uint8_t *table);
 void visual_video_argb32_to_rgb16  (VisVideo *dest, VisVideo *src);
 void visual_video_argb32_to_rgb24  (VisVideo *dest, VisVideo *src);
 
@@ -25,4 +28,8 @@ void visual_video_flip_pixel_bytes_color16 (VisVideo *dest, VisVideo *src);
 void visual_video_flip_pixel_bytes_color24 (VisVideo *dest, VisVideo *src);
 void visual_video_flip_pixel_bytes_color32 (VisVideo *dest, VisVideo *src);
 
+/* Blends src1 and src2 with blend and converts the result into dest in one pass,
+ * the sources are of one depth and neither depth is 8 bits */
+void visual_video_convert_blend (VisVideo *dest, VisVideo *src1, VisVideo *src2, VisAlphaBlendFunc blend, uint8_t alpha);
+
 #endif /* _LV_VIDEO_CONVERT_H */
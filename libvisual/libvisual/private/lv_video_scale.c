@@ -1,22 +1,399 @@
+#include "config.h"
 #include "lv_video_scale.h"
 #include "lv_common.h"
+#include "lv_cache.h"
+#include "lv_cpu.h"
+#include "lv_math.h"
+#include "lv_thread.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * The scalers work a row at a time through row kernels, picked by
+ * visual_video_scale_initialize(). The kernels work on channels without caring for
+ * their order, 16 bits pixels are split in their 5, 6 and 5 bits fields.
+ *
+ * Nearest looks every column up in a table of source pixels, and copies the row above
+ * when the source row repeats.
+ *
+ * Bilinear interpolates the source rows along x into 16 bits channels that keep the 8
+ * bits fraction, and blends the two rows around every destination row. These are the
+ * products of the four corner weights, summed in another order, so nothing changes
+ * from the per pixel version. The interpolated rows are kept while they are needed.
+ *
+ * Bicubic and lanczos filter the source rows along x into 16 bits channels with 6
+ * fraction bits, in a ring of as many rows as the filter has taps, and then along y.
+ * The taps are 14 bits fixed point, built per source and destination size and kept in
+ * a cache.
+ *
+ * The vector kernels give bit identical results to the C ones.
+ */
+
+#define SCALE_FILTER_BITS	14
+#define SCALE_FILTER_MAX_TAPS	64
+
+/* Fraction bits dropped after filtering along x, and the rest after filtering along y */
+#define SCALE_HFILTER_SHIFT	8
+#define SCALE_VFILTER_SHIFT	(SCALE_FILTER_BITS * 2 - SCALE_HFILTER_SHIFT)
+
+#define SCALE_FILTER_CACHE_SIZE	16
+
+#define VISUAL_VIDEO_SCALE_FILTER(obj)	(VISUAL_CHECK_CAST ((obj), VisVideoScaleFilter))
+
+#define RGB16_C0(p)	((p) & 0x1f)
+#define RGB16_C1(p)	(((p) >> 5) & 0x3f)
+#define RGB16_C2(p)	((p) >> 11)
+
+struct _VisVideoScaleFilter {
+	VisObject	 object;
+
+	int		 taps;		/* Always even */
+	int		*starts;	/* First source pixel of every destination pixel */
+	int16_t		*weights;	/* Taps per destination pixel */
+};
+
+/* Copies width pixels, offsets holds the source pixel of every column */
+typedef void (*ScaleNearestRowFunc)(uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+
+/* Interpolates width pixels along x, weights holds four times the weight of the pixel
+ * at the offset and four times the one of the next pixel, for every column */
+typedef void (*ScaleInterpRowFunc)(uint16_t *dest, const uint8_t *src, const int32_t *offsets,
+		const uint16_t *weights, int width);
+
+/* Blends n channels of two interpolated rows, frac is the weight of the lower one */
+typedef void (*ScaleBlendRowFunc)(uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac);
+
+/* Filters a source row along x to width pixels, acc has room for a 32 bits sum per channel */
+typedef void (*ScaleFilterRowFunc)(int16_t *dest, const uint8_t *src, int srcwidth,
+		const VisVideoScaleFilter *filter, int width, int32_t *acc);
+
+/* Filters n channels of taps filtered rows along y */
+typedef void (*ScaleFilterColumnFunc)(uint8_t *dest, const int16_t **rows, const int16_t *weights,
+		int taps, int n, int32_t *acc);
+
+static int scale_filter_dtor (VisObject *object);
+static VisVideoScaleFilter *scale_filter_new (VisVideoScaleMethod method, int srcsize, int destsize);
+static double filter_bicubic (double x);
+static double filter_lanczos (double x);
+
+static void scale_pack16 (uint8_t *dest, const uint8_t *channels, int width);
+
+static void nearest_row8_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+static void nearest_row16_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+static void nearest_row24_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+static void nearest_row32_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+
+static void interp_row8_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void interp_row16_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void interp_row24_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void interp_row32_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+
+static void blend_row_c (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac);
+
+static void filter_row8_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc);
+static void filter_row16_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc);
+static void filter_row24_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc);
+static void filter_row32_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc);
+
+static void filter_column_c (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc);
+static void filter_column_lanes_c (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int i, int n);
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+static void interp_row32_sse2 (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void blend_row_sse2 (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac);
+static void filter_column_sse2 (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc);
+
+static void filter_row32_ssse3 (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc);
+
+static void nearest_row32_avx2 (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width);
+static void interp_row32_avx2 (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void blend_row_avx2 (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac);
+static void filter_column_avx2 (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc);
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+static void interp_row32_neon (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width);
+static void blend_row_neon (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac);
+static void filter_column_neon (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc);
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
+
+/* Optimal kernels set by visual_video_scale_initialize(), indexed by bytes per pixel. */
+
+static ScaleNearestRowFunc scale_nearest_rows[5] = {
+	[1] = nearest_row8_c,
+	[2] = nearest_row16_c,
+	[3] = nearest_row24_c,
+	[4] = nearest_row32_c
+};
+
+static ScaleInterpRowFunc scale_interp_rows[5] = {
+	[1] = interp_row8_c,
+	[2] = interp_row16_c,
+	[3] = interp_row24_c,
+	[4] = interp_row32_c
+};
+
+static ScaleFilterRowFunc scale_filter_rows[5] = {
+	[1] = filter_row8_c,
+	[2] = filter_row16_c,
+	[3] = filter_row24_c,
+	[4] = filter_row32_c
+};
+
+static ScaleBlendRowFunc scale_blend_row = blend_row_c;
+static ScaleFilterColumnFunc scale_filter_column = filter_column_c;
+
+static VisCache __lv_scale_filter_cache;
+static VisMutex __lv_scale_filter_mutex;
+static int __lv_scale_filter_locking = FALSE;
+static int __lv_scale_filter_cached = FALSE;
+
+void visual_video_scale_initialize (void)
+{
+	/* Arranged from slow to fast, so the slower version gets overloaded
+	 * every time */
+
+	scale_nearest_rows[1]	= nearest_row8_c;
+	scale_nearest_rows[2]	= nearest_row16_c;
+	scale_nearest_rows[3]	= nearest_row24_c;
+	scale_nearest_rows[4]	= nearest_row32_c;
+	scale_interp_rows[1]	= interp_row8_c;
+	scale_interp_rows[2]	= interp_row16_c;
+	scale_interp_rows[3]	= interp_row24_c;
+	scale_interp_rows[4]	= interp_row32_c;
+	scale_filter_rows[1]	= filter_row8_c;
+	scale_filter_rows[2]	= filter_row16_c;
+	scale_filter_rows[3]	= filter_row24_c;
+	scale_filter_rows[4]	= filter_row32_c;
+	scale_blend_row		= blend_row_c;
+	scale_filter_column	= filter_column_c;
+
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+
+	/* The blends and the filtering along y work on whole rows of channels, whatever
+	 * the depth, the steps along x only pay off with whole pixels in a vector */
+	if (visual_cpu_get_sse2 () > 0) {
+		scale_interp_rows[4]	= interp_row32_sse2;
+		scale_blend_row		= blend_row_sse2;
+		scale_filter_column	= filter_column_sse2;
+	}
+
+	/* The byte shuffle pairs the channels of neighbouring pixels for pmaddwd */
+	if (visual_cpu_get_ssse3 () > 0)
+		scale_filter_rows[4]	= filter_row32_ssse3;
+
+	if (visual_cpu_get_avx2 () > 0) {
+		scale_nearest_rows[4]	= nearest_row32_avx2;
+		scale_interp_rows[4]	= interp_row32_avx2;
+		scale_blend_row		= blend_row_avx2;
+		scale_filter_column	= filter_column_avx2;
+	}
+
+#elif defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+	/* Nearest stays scalar, there is no gather */
+	if (visual_cpu_get_neon () > 0) {
+		scale_interp_rows[4]	= interp_row32_neon;
+		scale_blend_row		= blend_row_neon;
+		scale_filter_column	= filter_column_neon;
+	}
+
+#endif
+}
+
+void visual_video_scale_cache_initialize ()
+{
+	if (__lv_scale_filter_cached == TRUE)
+		return;
+
+	visual_cache_init (&__lv_scale_filter_cache, visual_object_collection_destroyer,
+			SCALE_FILTER_CACHE_SIZE, NULL, TRUE);
+
+	/* Actors scale from their own threads */
+	__lv_scale_filter_locking = visual_thread_is_supported () == TRUE &&
+		visual_mutex_init (&__lv_scale_filter_mutex) == VISUAL_OK;
+
+	__lv_scale_filter_cached = TRUE;
+}
+
+void visual_video_scale_cache_deinitialize ()
+{
+	if (__lv_scale_filter_cached == FALSE)
+		return;
+
+	visual_object_unref (VISUAL_OBJECT (&__lv_scale_filter_cache));
+
+	__lv_scale_filter_cached = FALSE;
+}
+
+VisVideoScaleFilter *visual_video_scale_filter_get (VisVideoScaleMethod method, int srcsize, int destsize)
+{
+	VisVideoScaleFilter *filter;
+	char key[48];
+
+	visual_return_val_if_fail (srcsize > 0 && destsize > 0, NULL);
+
+	if (__lv_scale_filter_cached == FALSE)
+		return scale_filter_new (method, srcsize, destsize);
+
+	snprintf (key, sizeof (key), "%d_%d_%d", method, srcsize, destsize);
+
+	if (__lv_scale_filter_locking == TRUE)
+		visual_mutex_lock (&__lv_scale_filter_mutex);
+
+	filter = visual_cache_get (&__lv_scale_filter_cache, key);
+
+	if (filter == NULL) {
+		filter = scale_filter_new (method, srcsize, destsize);
+
+		visual_cache_put (&__lv_scale_filter_cache, key, filter);
+	}
+
+	/* Keeps the filter alive when it drops out of the cache halfway a scale */
+	visual_object_ref (VISUAL_OBJECT (filter));
+
+	if (__lv_scale_filter_locking == TRUE)
+		visual_mutex_unlock (&__lv_scale_filter_mutex);
+
+	return filter;
+}
+
+static int scale_filter_dtor (VisObject *object)
+{
+	VisVideoScaleFilter *filter = VISUAL_VIDEO_SCALE_FILTER (object);
+
+	if (filter->starts != NULL)
+		visual_mem_free (filter->starts);
+
+	if (filter->weights != NULL)
+		visual_mem_free (filter->weights);
+
+	filter->starts = NULL;
+	filter->weights = NULL;
+
+	return VISUAL_OK;
+}
+
+static VisVideoScaleFilter *scale_filter_new (VisVideoScaleMethod method, int srcsize, int destsize)
+{
+	VisVideoScaleFilter *filter;
+	double (*kernel)(double);
+	double weights[SCALE_FILTER_MAX_TAPS];
+	double scale, stretch, support;
+	double center, weight, sum;
+	int16_t *taps;
+	int first, start, pos;
+	int total, largest;
+	int x, k;
+
+	filter = visual_mem_new0 (VisVideoScaleFilter, 1);
+
+	visual_object_initialize (VISUAL_OBJECT (filter), TRUE, scale_filter_dtor);
+
+	if (method == VISUAL_VIDEO_SCALE_LANCZOS) {
+		kernel = filter_lanczos;
+		support = 3.0;
+	} else {
+		kernel = filter_bicubic;
+		support = 2.0;
+	}
+
+	/* Shrinking stretches the kernel over all the source pixels that fold into one */
+	scale = (double) srcsize / destsize;
+	stretch = scale > 1.0 ? scale : 1.0;
+
+	filter->taps = 2 * (int) ceil (support * stretch);
+
+	if (filter->taps > SCALE_FILTER_MAX_TAPS) {
+		filter->taps = SCALE_FILTER_MAX_TAPS;
+		stretch = SCALE_FILTER_MAX_TAPS / (2.0 * support);
+	}
+
+	filter->starts = visual_mem_malloc (destsize * sizeof (int));
+	filter->weights = visual_mem_malloc (destsize * filter->taps * sizeof (int16_t));
+
+	for (x = 0; x < destsize; x++) {
+		center = (x + 0.5) * scale - 0.5;
+		first = (int) floor (center) - filter->taps / 2 + 1;
+
+		/* The taps stay inside the source, the ones past the edges fold onto the edge
+		 * pixels. Sources narrower than the filter leave the last taps without weight */
+		start = first > srcsize - filter->taps ? srcsize - filter->taps : first;
+
+		if (start < 0)
+			start = 0;
+
+		sum = 0.0;
+
+		for (k = 0; k < filter->taps; k++)
+			weights[k] = 0.0;
+
+		for (k = 0; k < filter->taps; k++) {
+			pos = first + k;
+			weight = kernel ((pos - center) / stretch);
+
+			if (pos < 0)
+				pos = 0;
+			else if (pos >= srcsize)
+				pos = srcsize - 1;
+
+			weights[pos - start] += weight;
+			sum += weight;
+		}
 
-#pragma pack(1)
+		taps = filter->weights + x * filter->taps;
+		total = 0;
+		largest = 0;
 
-/* NOTE: Although the following struct members are named 'r', 'g' and
-   'b', the scale functions are very much pixel format agnostic. They
-   only assume the number of components. */
+		for (k = 0; k < filter->taps; k++) {
+			taps[k] = (int) floor (weights[k] / sum * (1 << SCALE_FILTER_BITS) + 0.5);
+			total += taps[k];
 
-typedef struct {
-	uint16_t r:5, g:6, b:5;
-} color16_t;
+			if (taps[k] > taps[largest])
+				largest = k;
+		}
+
+		/* The rounding error goes to the center tap, so flat areas stay flat */
+		taps[largest] += (1 << SCALE_FILTER_BITS) - total;
+
+		filter->starts[x] = start;
+	}
+
+	return filter;
+}
+
+/* Catmull-Rom, the cubic that goes through the pixels */
+static double filter_bicubic (double x)
+{
+	x = fabs (x);
 
-typedef struct {
-	uint8_t r, g, b;
-} color24_t;
+	if (x < 1.0)
+		return (1.5 * x - 2.5) * x * x + 1.0;
 
-#pragma pack()
+	if (x < 2.0)
+		return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
 
+	return 0.0;
+}
+
+/* Three lobes */
+static double filter_lanczos (double x)
+{
+	x = fabs (x);
+
+	if (x < 1e-9)
+		return 1.0;
+
+	if (x >= 3.0)
+		return 0.0;
+
+	return 3.0 * sin (VISUAL_MATH_PI * x) * sin (VISUAL_MATH_PI * x / 3.0) / (VISUAL_MATH_PI * VISUAL_MATH_PI * x * x);
+}
 
 void visual_video_zoom_color8 (VisVideo *dest, VisVideo *src)
 {
@@ -82,397 +459,890 @@ void visual_video_zoom_color32 (VisVideo *dest, VisVideo *src)
 	}
 }
 
-void visual_video_scale_nearest_color8 (VisVideo *dest, VisVideo *src)
+void visual_video_scale_nearest (VisVideo *dest, VisVideo *src, int y0, int y1)
 {
-	int x, y;
+	ScaleNearestRowFunc func = scale_nearest_rows[dest->bpp];
+	int32_t *offsets;
 	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint8_t *dest_pixel, *src_pixel_row;
+	uint8_t *dbuf;
+	int row, prev = -1;
+	int x, y;
+
+	offsets = visual_mem_malloc_aligned (dest->width * sizeof (int32_t), VISUAL_MEM_ALIGN_SIMD);
 
 	du = (src->width << 16) / dest->width;
 	dv = (src->height << 16) / dest->height;
-	v = 0;
 
-	dest_pixel = visual_video_get_pixels (dest);
+	for (x = 0, u = 0; x < dest->width; x++, u += du)
+		offsets[x] = u >> 16;
 
-	for (y = 0; y < dest->height; y++, v += dv) {
-		src_pixel_row = (uint8_t *) src->pixel_rows[v >> 16];
+	dbuf = (uint8_t *) visual_video_get_pixels (dest) + y0 * dest->pitch;
 
-		if (v >> 16 >= src->height)
-			v -= 0x10000;
+	for (y = y0, v = y0 * dv; y < y1; y++, v += dv) {
+		row = v >> 16;
 
-		u = 0;
-		for (x = 0; x < dest->width; x++, u += du)
-			*dest_pixel++ = src_pixel_row[u >> 16];
+		/* Upscaled rows repeat, copying the row above beats the lookups */
+		if (row == prev)
+			visual_mem_copy (dbuf, dbuf - dest->pitch, dest->width * dest->bpp);
+		else
+			func (dbuf, src->pixel_rows[row], offsets, dest->width);
 
-		dest_pixel += dest->pitch - dest->width;
+		prev = row;
+		dbuf += dest->pitch;
 	}
+
+	visual_mem_free (offsets);
 }
 
-void visual_video_scale_nearest_color16 (VisVideo *dest, VisVideo *src)
+void visual_video_scale_bilinear (VisVideo *dest, VisVideo *src, int y0, int y1)
 {
-	int x, y;
+	ScaleInterpRowFunc interp = scale_interp_rows[dest->bpp];
+	int channels = dest->bpp == 2 ? 3 : dest->bpp;
+	int n = dest->width * channels;
+	int32_t *offsets;
+	uint16_t *weights;
+	uint16_t *rows[2];
+	int tags[2] = { -1, -1 };
+	const uint16_t *upper, *lower;
+	uint8_t *packed = NULL;
+	uint8_t *dbuf;
 	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint16_t *dest_pixel, *src_pixel_row;
+	int frac, row, slot;
+	int x, y, i;
 
-	du = (src->width << 16) / dest->width;
-	dv = (src->height << 16) / dest->height;
-	v = 0;
+	/* There is no second pixel to interpolate with */
+	if (src->width < 2 || src->height < 2) {
+		visual_video_scale_nearest (dest, src, y0, y1);
 
-	dest_pixel = visual_video_get_pixels (dest);
+		return;
+	}
 
-	for (y = 0; y < dest->height; y++, v += dv) {
-		src_pixel_row = (uint16_t *) src->pixel_rows[v >> 16];
+	offsets = visual_mem_malloc_aligned (dest->width * sizeof (int32_t), VISUAL_MEM_ALIGN_SIMD);
+	weights = visual_mem_malloc_aligned (dest->width * 8 * sizeof (uint16_t), VISUAL_MEM_ALIGN_SIMD);
+	rows[0] = visual_mem_malloc_aligned (n * sizeof (uint16_t), VISUAL_MEM_ALIGN_SIMD);
+	rows[1] = visual_mem_malloc_aligned (n * sizeof (uint16_t), VISUAL_MEM_ALIGN_SIMD);
 
-		if (v >> 16 >= src->height)
-			v -= 0x10000;
+	if (dest->bpp == 2)
+		packed = visual_mem_malloc_aligned (n, VISUAL_MEM_ALIGN_SIMD);
 
-		u = 0;
-		for (x = 0; x < dest->width; x++, u += du)
-			*dest_pixel++ = src_pixel_row[u >> 16];
+	du = ((src->width - 1)  << 16) / dest->width;
+	dv = ((src->height - 1) << 16) / dest->height;
 
-		dest_pixel += (dest->pitch / dest->bpp) - dest->width;
+	/* The fractions go from fixed point 16.16 to 24.8, notice 0x100 = 1.0 */
+	for (x = 0, u = 0; x < dest->width; x++, u += du) {
+		frac = (u & 0xffff) >> 8;
+		offsets[x] = u >> 16;
+
+		for (i = 0; i < 4; i++) {
+			weights[x * 8 + i] = 0x100 - frac;
+			weights[x * 8 + 4 + i] = frac;
+		}
 	}
+
+	dbuf = (uint8_t *) visual_video_get_pixels (dest) + y0 * dest->pitch;
+
+	for (y = y0, v = y0 * dv; y < y1; y++, v += dv) {
+		row = v >> 16;
+		frac = (v & 0xffff) >> 8;
+
+		/* A missing row goes in the slot that doesn't hold the other one */
+		for (i = 0; i < 2; i++) {
+			if (tags[0] == row + i || tags[1] == row + i)
+				continue;
+
+			slot = tags[0] == row || tags[0] == row + 1 ? 1 : 0;
+
+			interp (rows[slot], src->pixel_rows[row + i], offsets, weights, dest->width);
+			tags[slot] = row + i;
+		}
+
+		upper = rows[tags[0] == row ? 0 : 1];
+		lower = rows[tags[0] == row ? 1 : 0];
+
+		if (packed != NULL) {
+			scale_blend_row (packed, upper, lower, n, frac);
+			scale_pack16 (dbuf, packed, dest->width);
+		} else {
+			scale_blend_row (dbuf, upper, lower, n, frac);
+		}
+
+		dbuf += dest->pitch;
+	}
+
+	visual_mem_free (offsets);
+	visual_mem_free (weights);
+	visual_mem_free (rows[0]);
+	visual_mem_free (rows[1]);
+
+	if (packed != NULL)
+		visual_mem_free (packed);
 }
 
-/* FIXME this version is of course butt ugly */
-/* IF color24_t is allowed use it here as well */
-void visual_video_scale_nearest_color24 (VisVideo *dest, VisVideo *src)
+void visual_video_scale_filtered (VisVideo *dest, VisVideo *src, VisVideoScaleFilter *hfilter,
+		VisVideoScaleFilter *vfilter, int y0, int y1)
 {
-	int x, y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	color24_t *dest_pixel, *src_pixel_row;
+	ScaleFilterRowFunc filter = scale_filter_rows[dest->bpp];
+	int channels = dest->bpp == 2 ? 3 : dest->bpp;
+	int n = dest->width * channels;
+	int stride = (n + 15) & ~15;
+	int taps = vfilter->taps;
+	int tags[SCALE_FILTER_MAX_TAPS];
+	const int16_t *rows[SCALE_FILTER_MAX_TAPS];
+	int16_t *ring;
+	int32_t *acc;
+	uint8_t *packed = NULL;
+	uint8_t *dbuf;
+	int row, slot;
+	int y, k;
+
+	ring = visual_mem_malloc_aligned (taps * stride * sizeof (int16_t), VISUAL_MEM_ALIGN_SIMD);
+	acc = visual_mem_malloc_aligned (stride * sizeof (int32_t), VISUAL_MEM_ALIGN_SIMD);
+
+	if (dest->bpp == 2)
+		packed = visual_mem_malloc_aligned (n, VISUAL_MEM_ALIGN_SIMD);
+
+	for (k = 0; k < taps; k++)
+		tags[k] = -1;
+
+	dbuf = (uint8_t *) visual_video_get_pixels (dest) + y0 * dest->pitch;
+
+	for (y = y0; y < y1; y++) {
+		/* Every source row is filtered once while it stays in the ring */
+		for (k = 0; k < taps; k++) {
+			row = vfilter->starts[y] + k;
+
+			/* Sources lower than the filter have taps past their last row, without weight */
+			if (row >= src->height)
+				row = src->height - 1;
+
+			slot = row % taps;
+
+			if (tags[slot] != row) {
+				filter (ring + slot * stride, src->pixel_rows[row], src->width, hfilter, dest->width, acc);
+				tags[slot] = row;
+			}
+
+			rows[k] = ring + slot * stride;
+		}
 
-	du = (src->width << 16) / dest->width;
-	dv = (src->height << 16) / dest->height;
-	v = 0;
+		if (packed != NULL) {
+			scale_filter_column (packed, rows, vfilter->weights + y * taps, taps, n, acc);
+			scale_pack16 (dbuf, packed, dest->width);
+		} else {
+			scale_filter_column (dbuf, rows, vfilter->weights + y * taps, taps, n, acc);
+		}
 
-	dest_pixel = visual_video_get_pixels (dest);
+		dbuf += dest->pitch;
+	}
 
-	for (y = 0; y < dest->height; y++, v += dv) {
-		src_pixel_row = (color24_t *) src->pixel_rows[v >> 16];
+	visual_mem_free (ring);
+	visual_mem_free (acc);
 
-		if (v >> 16 >= src->height)
-			v -= 0x10000;
+	if (packed != NULL)
+		visual_mem_free (packed);
+}
 
-		u = 0;
-		for (x = 0; x < dest->width; x++, u += du)
-			*dest_pixel++ = src_pixel_row[u >> 16];
+/* The filters overshoot, the fields are clamped */
+static void scale_pack16 (uint8_t *dest, const uint8_t *channels, int width)
+{
+	uint16_t *pixels = (uint16_t *) dest;
+	int c0, c1, c2;
+	int i;
 
-		dest_pixel += (dest->pitch / dest->bpp) - dest->width;
+	for (i = 0; i < width; i++) {
+		c0 = channels[i * 3] > 0x1f ? 0x1f : channels[i * 3];
+		c1 = channels[i * 3 + 1] > 0x3f ? 0x3f : channels[i * 3 + 1];
+		c2 = channels[i * 3 + 2] > 0x1f ? 0x1f : channels[i * 3 + 2];
+
+		pixels[i] = c0 | c1 << 5 | c2 << 11;
 	}
 }
 
-void visual_video_scale_nearest_color32 (VisVideo *dest, VisVideo *src)
+static void nearest_row8_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width)
 {
-	int x, y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint32_t *dest_pixel, *src_pixel_row;
+	int i;
 
-	du = (src->width << 16) / dest->width;
-	dv = (src->height << 16) / dest->height;
-	v = 0;
+	for (i = 0; i < width; i++)
+		dest[i] = src[offsets[i]];
+}
 
-	dest_pixel = visual_video_get_pixels (dest);
+static void nearest_row16_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width)
+{
+	uint16_t *dbuf = (uint16_t *) dest;
+	const uint16_t *sbuf = (const uint16_t *) src;
+	int i;
 
-	for (y = 0; y < dest->height; y++, v += dv) {
-		src_pixel_row = (uint32_t *) src->pixel_rows[v >> 16];
+	for (i = 0; i < width; i++)
+		dbuf[i] = sbuf[offsets[i]];
+}
 
-		if (v >> 16 >= src->height)
-			v -= 0x10000;
+static void nearest_row24_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width)
+{
+	const uint8_t *s;
+	int i;
 
-		u = 0;
-		for (x = 0; x < dest->width; x++, u += du)
-			*dest_pixel++ = src_pixel_row[u >> 16];
+	for (i = 0; i < width; i++) {
+		s = src + offsets[i] * 3;
 
-		dest_pixel += (dest->pitch / dest->bpp) - dest->width;
+		dest[i * 3] = s[0];
+		dest[i * 3 + 1] = s[1];
+		dest[i * 3 + 2] = s[2];
 	}
 }
 
-void visual_video_scale_bilinear_color8 (VisVideo *dest, VisVideo *src)
+static void nearest_row32_c (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint8_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
+	uint32_t *dbuf = (uint32_t *) dest;
+	const uint32_t *sbuf = (const uint32_t *) src;
+	int i;
 
-	dest_pixel = visual_video_get_pixels (dest);
+	for (i = 0; i < width; i++)
+		dbuf[i] = sbuf[offsets[i]];
+}
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+static void interp_row8_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	const uint8_t *s;
+	int i;
+
+	for (i = 0; i < width; i++) {
+		s = src + offsets[i];
+
+		dest[i] = s[0] * weights[i * 8] + s[1] * weights[i * 8 + 4];
+	}
+}
+
+static void interp_row16_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	const uint16_t *pixels = (const uint16_t *) src;
+	int a, b, w0, w1;
+	int i;
+
+	for (i = 0; i < width; i++) {
+		a = pixels[offsets[i]];
+		b = pixels[offsets[i] + 1];
+		w0 = weights[i * 8];
+		w1 = weights[i * 8 + 4];
+
+		dest[i * 3] = RGB16_C0 (a) * w0 + RGB16_C0 (b) * w1;
+		dest[i * 3 + 1] = RGB16_C1 (a) * w0 + RGB16_C1 (b) * w1;
+		dest[i * 3 + 2] = RGB16_C2 (a) * w0 + RGB16_C2 (b) * w1;
+	}
+}
+
+static void interp_row24_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	const uint8_t *s;
+	int w0, w1;
+	int i, c;
+
+	for (i = 0; i < width; i++) {
+		s = src + offsets[i] * 3;
+		w0 = weights[i * 8];
+		w1 = weights[i * 8 + 4];
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+		for (c = 0; c < 3; c++)
+			dest[i * 3 + c] = s[c] * w0 + s[c + 3] * w1;
+	}
+}
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+static void interp_row32_c (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	const uint8_t *s;
+	int w0, w1;
+	int i, c;
 
-		src_pixel_rowu = (uint8_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (uint8_t *) src->pixel_rows[(v >> 16) + 1];
+	for (i = 0; i < width; i++) {
+		s = src + offsets[i] * 4;
+		w0 = weights[i * 8];
+		w1 = weights[i * 8 + 4];
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
+		for (c = 0; c < 4; c++)
+			dest[i * 4 + c] = s[c] * w0 + s[c + 4] * w1;
+	}
+}
 
-		for (x = dest->width - 1; x--; u += du) {
-			uint8_t cul, cll, cur, clr;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b0; /* fixed point 16.16 [0,255[ */
+static void blend_row_c (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac)
+{
+	int i;
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+	for (i = 0; i < n; i++)
+		dest[i] = (upper[i] * (0x100 - frac) + lower[i] * frac) >> 16;
+}
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+static inline void filter_row_channels_c (int16_t *dest, const uint8_t *src, int srcwidth,
+		const VisVideoScaleFilter *filter, int width, int channels)
+{
+	const int16_t *weights = filter->weights;
+	int sum, pos;
+	int x, c, k;
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+	for (x = 0; x < width; x++) {
+		for (c = 0; c < channels; c++) {
+			sum = 1 << (SCALE_HFILTER_SHIFT - 1);
 
-			b0 = ul * cul;
-			b0 += ll * cll;
-			b0 += ur * cur;
-			b0 += lr * clr;
+			for (k = 0; k < filter->taps; k++) {
+				pos = filter->starts[x] + k;
 
-			*dest_pixel++ = b0 >> 16;
+				/* Sources narrower than the filter have taps past their end, without weight */
+				if (pos >= srcwidth)
+					pos = srcwidth - 1;
+
+				sum += weights[k] * src[pos * channels + c];
+			}
+
+			*dest++ = sum >> SCALE_HFILTER_SHIFT;
 		}
 
-		dest_pixel += dest->pitch - (dest->width - 1);
+		weights += filter->taps;
+	}
+}
+
+static void filter_row8_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc)
+{
+	filter_row_channels_c (dest, src, srcwidth, filter, width, 1);
+}
 
+static void filter_row16_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc)
+{
+	const uint16_t *pixels = (const uint16_t *) src;
+	const int16_t *weights = filter->weights;
+	int sum0, sum1, sum2;
+	int pos, p;
+	int x, k;
+
+	for (x = 0; x < width; x++) {
+		sum0 = sum1 = sum2 = 1 << (SCALE_HFILTER_SHIFT - 1);
+
+		for (k = 0; k < filter->taps; k++) {
+			pos = filter->starts[x] + k;
+
+			if (pos >= srcwidth)
+				pos = srcwidth - 1;
+
+			p = pixels[pos];
+
+			sum0 += weights[k] * RGB16_C0 (p);
+			sum1 += weights[k] * RGB16_C1 (p);
+			sum2 += weights[k] * RGB16_C2 (p);
+		}
+
+		*dest++ = sum0 >> SCALE_HFILTER_SHIFT;
+		*dest++ = sum1 >> SCALE_HFILTER_SHIFT;
+		*dest++ = sum2 >> SCALE_HFILTER_SHIFT;
+
+		weights += filter->taps;
 	}
 }
 
-void visual_video_scale_bilinear_color16 (VisVideo *dest, VisVideo *src)
+static void filter_row24_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	color16_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
-	dest_pixel = visual_video_get_pixels (dest);
+	filter_row_channels_c (dest, src, srcwidth, filter, width, 3);
+}
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+static void filter_row32_c (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc)
+{
+	filter_row_channels_c (dest, src, srcwidth, filter, width, 4);
+}
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+static void filter_column_c (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc)
+{
+	filter_column_lanes_c (dest, rows, weights, taps, 0, n);
+}
+
+/* Channels i to n, the vector kernels end with this */
+static void filter_column_lanes_c (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int i, int n)
+{
+	int sum;
+	int k;
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+	for (; i < n; i++) {
+		sum = 1 << (SCALE_VFILTER_SHIFT - 1);
 
-		src_pixel_rowu = (color16_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (color16_t *) src->pixel_rows[(v >> 16) + 1];
+		for (k = 0; k < taps; k++)
+			sum += weights[k] * rows[k][i];
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0.0;
+		sum >>= SCALE_VFILTER_SHIFT;
+
+		dest[i] = sum < 0 ? 0 : sum > 255 ? 255 : sum;
+	}
+}
 
-		for (x = dest->width - 1; x--; u += du) {
-			color16_t cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[	  */
-			uint32_t b2, b1, b0;	 /* fixed point 16.16 [0,255[ */
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+static const uint16_t blend_low_mask[8] = {
+	0x00ff, 0x00ff, 0x00ff, 0x00ff, 0x00ff, 0x00ff, 0x00ff, 0x00ff
+};
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+/* Rounding before the shifts of the filters along x and along y */
+static const int32_t filter_round[2][4] = {
+	{ 1 << (SCALE_HFILTER_SHIFT - 1), 1 << (SCALE_HFILTER_SHIFT - 1),
+	  1 << (SCALE_HFILTER_SHIFT - 1), 1 << (SCALE_HFILTER_SHIFT - 1) },
+	{ 1 << (SCALE_VFILTER_SHIFT - 1), 1 << (SCALE_VFILTER_SHIFT - 1),
+	  1 << (SCALE_VFILTER_SHIFT - 1), 1 << (SCALE_VFILTER_SHIFT - 1) }
+};
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+/* pshufb table, the channels of two pixels next to each other in word pairs */
+static const uint8_t shuffle_filter32[16] = {
+	0, 0x80, 4, 0x80, 1, 0x80, 5, 0x80, 2, 0x80, 6, 0x80, 3, 0x80, 7, 0x80
+};
 
-			b0 = ul * cul.r;
-			b1 = ul * cul.g;
-			b2 = ul * cul.b;
+/* Every pixel comes with the next one, widened and multiplied by the weights of both,
+ * the two halves of every product make the channels */
+static void interp_row32_sse2 (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i + 2 <= width; i += 2) {
+		__asm __volatile
+			("\n\t pxor %%xmm7, %%xmm7"
+			 "\n\t movq (%[s0]), %%xmm0"
+			 "\n\t movq (%[s1]), %%xmm1"
+			 "\n\t movdqu (%[w]), %%xmm2"
+			 "\n\t movdqu 16(%[w]), %%xmm3"
+			 "\n\t punpcklbw %%xmm7, %%xmm0"
+			 "\n\t punpcklbw %%xmm7, %%xmm1"
+			 "\n\t pmullw %%xmm2, %%xmm0"
+			 "\n\t pmullw %%xmm3, %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t punpcklqdq %%xmm1, %%xmm0"
+			 "\n\t punpckhqdq %%xmm1, %%xmm2"
+			 "\n\t paddw %%xmm2, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s0] "r" (src + offsets[i] * 4), [s1] "r" (src + offsets[i + 1] * 4),
+			    [w] "r" (weights + i * 8)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+	}
 
-			b0 += ll * cll.r;
-			b1 += ll * cll.g;
-			b2 += ll * cll.b;
+	interp_row32_c (dest + i * 4, src, offsets + i, weights + i * 8, width - i);
+}
 
-			b0 += ur * cur.r;
-			b1 += ur * cur.g;
-			b2 += ur * cur.b;
+/* The channels are split in their high and low bytes, so every product fits in 16 bits:
+ * (upper * (256 - frac) + lower * frac) >> 16 is (high + (low >> 8)) >> 8 */
+static void blend_row_sse2 (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac)
+{
+	uint16_t factors[2][8];
+	int i;
 
-			b0 += lr * clr.r;
-			b1 += lr * clr.g;
-			b2 += lr * clr.b;
+	for (i = 0; i < 8; i++) {
+		factors[0][i] = 0x100 - frac;
+		factors[1][i] = frac;
+	}
 
-			b.r = b0 >> 16;
-			b.g = b1 >> 16;
-			b.b = b2 >> 16;
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t movdqu (%[f]), %%xmm6"
+			 "\n\t movdqu 16(%[f]), %%xmm7"
+			 "\n\t movdqu (%[m]), %%xmm5"
+			 "\n\t movdqu (%[u]), %%xmm0"
+			 "\n\t movdqu (%[l]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t psrlw $8, %%xmm1"
+			 "\n\t pand %%xmm5, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm3"
+			 "\n\t pmullw %%xmm6, %%xmm0"
+			 "\n\t pmullw %%xmm7, %%xmm1"
+			 "\n\t pmullw %%xmm6, %%xmm2"
+			 "\n\t pmullw %%xmm7, %%xmm3"
+			 "\n\t paddw %%xmm1, %%xmm0"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t paddw %%xmm2, %%xmm0"
+			 "\n\t psrlw $8, %%xmm0"
+			 "\n\t movdqu 16(%[u]), %%xmm4"
+			 "\n\t movdqu 16(%[l]), %%xmm1"
+			 "\n\t movdqa %%xmm4, %%xmm2"
+			 "\n\t movdqa %%xmm1, %%xmm3"
+			 "\n\t psrlw $8, %%xmm4"
+			 "\n\t psrlw $8, %%xmm1"
+			 "\n\t pand %%xmm5, %%xmm2"
+			 "\n\t pand %%xmm5, %%xmm3"
+			 "\n\t pmullw %%xmm6, %%xmm4"
+			 "\n\t pmullw %%xmm7, %%xmm1"
+			 "\n\t pmullw %%xmm6, %%xmm2"
+			 "\n\t pmullw %%xmm7, %%xmm3"
+			 "\n\t paddw %%xmm1, %%xmm4"
+			 "\n\t paddw %%xmm3, %%xmm2"
+			 "\n\t psrlw $8, %%xmm2"
+			 "\n\t paddw %%xmm2, %%xmm4"
+			 "\n\t psrlw $8, %%xmm4"
+			 "\n\t packuswb %%xmm4, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [u] "r" (upper + i), [l] "r" (lower + i),
+			    [f] "r" (factors), [m] "r" (blend_low_mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
 
-			*dest_pixel++ = b;
+	blend_row_c (dest + i, upper + i, lower + i, n - i, frac);
+}
+
+/* The rows go in pairs through pmaddwd, summed in acc, the last pass rounds and packs */
+static void filter_column_sse2 (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc)
+{
+	int i, k;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t movd (%[w]), %%xmm7"
+			 "\n\t pshufd $0, %%xmm7, %%xmm7"
+			 "\n\t movdqu (%[r0]), %%xmm0"
+			 "\n\t movdqu (%[r1]), %%xmm1"
+			 "\n\t movdqa %%xmm0, %%xmm2"
+			 "\n\t punpcklwd %%xmm1, %%xmm0"
+			 "\n\t punpckhwd %%xmm1, %%xmm2"
+			 "\n\t pmaddwd %%xmm7, %%xmm0"
+			 "\n\t pmaddwd %%xmm7, %%xmm2"
+			 "\n\t movdqu %%xmm0, (%[a])"
+			 "\n\t movdqu %%xmm2, 16(%[a])"
+			 :: [a] "r" (acc + i), [r0] "r" (rows[0] + i), [r1] "r" (rows[1] + i), [w] "r" (weights)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm7");
+	}
+
+	for (k = 2; k < taps; k += 2) {
+		for (i = 0; i + 8 <= n; i += 8) {
+			__asm __volatile
+				("\n\t movd (%[w]), %%xmm7"
+				 "\n\t pshufd $0, %%xmm7, %%xmm7"
+				 "\n\t movdqu (%[r0]), %%xmm0"
+				 "\n\t movdqu (%[r1]), %%xmm1"
+				 "\n\t movdqa %%xmm0, %%xmm2"
+				 "\n\t punpcklwd %%xmm1, %%xmm0"
+				 "\n\t punpckhwd %%xmm1, %%xmm2"
+				 "\n\t pmaddwd %%xmm7, %%xmm0"
+				 "\n\t pmaddwd %%xmm7, %%xmm2"
+				 "\n\t movdqu (%[a]), %%xmm3"
+				 "\n\t movdqu 16(%[a]), %%xmm4"
+				 "\n\t paddd %%xmm3, %%xmm0"
+				 "\n\t paddd %%xmm4, %%xmm2"
+				 "\n\t movdqu %%xmm0, (%[a])"
+				 "\n\t movdqu %%xmm2, 16(%[a])"
+				 :: [a] "r" (acc + i), [r0] "r" (rows[k] + i), [r1] "r" (rows[k + 1] + i), [w] "r" (weights + k)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm7");
 		}
+	}
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+	for (i = 0; i + 8 <= n; i += 8) {
+		__asm __volatile
+			("\n\t movdqu (%[c]), %%xmm7"
+			 "\n\t movdqu (%[a]), %%xmm0"
+			 "\n\t movdqu 16(%[a]), %%xmm1"
+			 "\n\t paddd %%xmm7, %%xmm0"
+			 "\n\t paddd %%xmm7, %%xmm1"
+			 "\n\t psrad %[shift], %%xmm0"
+			 "\n\t psrad %[shift], %%xmm1"
+			 "\n\t packssdw %%xmm1, %%xmm0"
+			 "\n\t packuswb %%xmm0, %%xmm0"
+			 "\n\t movq %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [a] "r" (acc + i), [c] "r" (filter_round[1]),
+			    [shift] "i" (SCALE_VFILTER_SHIFT)
+			 : "memory", "xmm0", "xmm1", "xmm7");
 	}
+
+	filter_column_lanes_c (dest, rows, weights, taps, i, n);
 }
 
-void visual_video_scale_bilinear_color24 (VisVideo *dest, VisVideo *src)
+/* Every destination pixel takes the source pixels in pairs, one pmaddwd per pair of
+ * taps gives the four channels, summed in acc */
+static void filter_row32_ssse3 (int16_t *dest, const uint8_t *src, int srcwidth, const VisVideoScaleFilter *filter, int width, int32_t *acc)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	color24_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
-	dest_pixel = visual_video_get_pixels (dest);
+	const int16_t *weights;
+	int x, k, c;
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+	/* The pairs are read whole, past the end of rows narrower than the filter */
+	if (srcwidth < filter->taps) {
+		filter_row32_c (dest, src, srcwidth, filter, width, acc);
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+		return;
+	}
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+	for (x = 0, weights = filter->weights; x < width; x++, weights += filter->taps) {
+		__asm __volatile
+			("\n\t movdqu (%[p]), %%xmm6"
+			 "\n\t movq (%[s]), %%xmm0"
+			 "\n\t movd (%[w]), %%xmm1"
+			 "\n\t pshufb %%xmm6, %%xmm0"
+			 "\n\t pshufd $0, %%xmm1, %%xmm1"
+			 "\n\t pmaddwd %%xmm1, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[a])"
+			 :: [a] "r" (acc + x * 4), [s] "r" (src + filter->starts[x] * 4), [w] "r" (weights),
+			    [p] "r" (shuffle_filter32)
+			 : "memory", "xmm0", "xmm1", "xmm6");
+	}
 
-		src_pixel_rowu = (color24_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (color24_t *) src->pixel_rows[(v >> 16) + 1];
+	for (k = 2; k < filter->taps; k += 2) {
+		for (x = 0, weights = filter->weights + k; x < width; x++, weights += filter->taps) {
+			__asm __volatile
+				("\n\t movdqu (%[p]), %%xmm6"
+				 "\n\t movq (%[s]), %%xmm0"
+				 "\n\t movd (%[w]), %%xmm1"
+				 "\n\t movdqu (%[a]), %%xmm2"
+				 "\n\t pshufb %%xmm6, %%xmm0"
+				 "\n\t pshufd $0, %%xmm1, %%xmm1"
+				 "\n\t pmaddwd %%xmm1, %%xmm0"
+				 "\n\t paddd %%xmm2, %%xmm0"
+				 "\n\t movdqu %%xmm0, (%[a])"
+				 :: [a] "r" (acc + x * 4), [s] "r" (src + (filter->starts[x] + k) * 4), [w] "r" (weights),
+				    [p] "r" (shuffle_filter32)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm6");
+		}
+	}
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
+	for (x = 0; x + 2 <= width; x += 2) {
+		__asm __volatile
+			("\n\t movdqu (%[c]), %%xmm7"
+			 "\n\t movdqu (%[a]), %%xmm0"
+			 "\n\t movdqu 16(%[a]), %%xmm1"
+			 "\n\t paddd %%xmm7, %%xmm0"
+			 "\n\t paddd %%xmm7, %%xmm1"
+			 "\n\t psrad %[shift], %%xmm0"
+			 "\n\t psrad %[shift], %%xmm1"
+			 "\n\t packssdw %%xmm1, %%xmm0"
+			 "\n\t movdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + x * 4), [a] "r" (acc + x * 4), [c] "r" (filter_round[0]),
+			    [shift] "i" (SCALE_HFILTER_SHIFT)
+			 : "memory", "xmm0", "xmm1", "xmm7");
+	}
 
-		for (x = dest->width - 1; x--; u += du) {
-			color24_t cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b2, b1, b0;	 /* fixed point 16.16 [0,255[ */
+	for (; x < width; x++) {
+		for (c = 0; c < 4; c++)
+			dest[x * 4 + c] = (acc[x * 4 + c] + (1 << (SCALE_HFILTER_SHIFT - 1))) >> SCALE_HFILTER_SHIFT;
+	}
+}
+
+static void nearest_row32_avx2 (uint8_t *dest, const uint8_t *src, const int32_t *offsets, int width)
+{
+	int i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		__asm __volatile
+			("\n\t vmovdqu (%[o]), %%ymm1"
+			 "\n\t vpcmpeqd %%ymm2, %%ymm2, %%ymm2"
+			 "\n\t vpgatherdd %%ymm2, (%[s], %%ymm1, 4), %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s] "r" (src), [o] "r" (offsets + i)
+			 : "memory", "xmm0", "xmm1", "xmm2");
+	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	nearest_row32_c (dest + i * 4, src, offsets + i, width - i);
+}
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+/* Like interp_row32_sse2(), the pixel pairs widen across the lanes with vpmovzxbw and
+ * the halves come out lane interleaved, vpermq puts them in order */
+static void interp_row32_avx2 (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__asm __volatile
+			("\n\t vmovq (%[s0]), %%xmm0"
+			 "\n\t vmovhps (%[s1]), %%xmm0, %%xmm0"
+			 "\n\t vmovq (%[s2]), %%xmm1"
+			 "\n\t vmovhps (%[s3]), %%xmm1, %%xmm1"
+			 "\n\t vpmovzxbw %%xmm0, %%ymm0"
+			 "\n\t vpmovzxbw %%xmm1, %%ymm1"
+			 "\n\t vpmullw (%[w]), %%ymm0, %%ymm0"
+			 "\n\t vpmullw 32(%[w]), %%ymm1, %%ymm1"
+			 "\n\t vpunpcklqdq %%ymm1, %%ymm0, %%ymm2"
+			 "\n\t vpunpckhqdq %%ymm1, %%ymm0, %%ymm3"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpermq $0xd8, %%ymm2, %%ymm2"
+			 "\n\t vmovdqu %%ymm2, (%[d])"
+			 :: [d] "r" (dest + i * 4), [s0] "r" (src + offsets[i] * 4), [s1] "r" (src + offsets[i + 1] * 4),
+			    [s2] "r" (src + offsets[i + 2] * 4), [s3] "r" (src + offsets[i + 3] * 4), [w] "r" (weights + i * 8)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+	}
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+	interp_row32_c (dest + i * 4, src, offsets + i, weights + i * 8, width - i);
+}
 
-			b0 = ul * cul.r;
-			b1 = ul * cul.g;
-			b2 = ul * cul.b;
+/* blend_row_sse2() on 32 channels, the in lane pack is put in order by vpermq */
+static void blend_row_avx2 (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac)
+{
+	uint16_t factors[2][16];
+	int i;
 
-			b0 += ll * cll.r;
-			b1 += ll * cll.g;
-			b2 += ll * cll.b;
+	for (i = 0; i < 16; i++) {
+		factors[0][i] = 0x100 - frac;
+		factors[1][i] = frac;
+	}
+
+	for (i = 0; i + 32 <= n; i += 32) {
+		__asm __volatile
+			("\n\t vmovdqu (%[f]), %%ymm6"
+			 "\n\t vmovdqu 32(%[f]), %%ymm7"
+			 "\n\t vbroadcasti128 (%[m]), %%ymm5"
+			 "\n\t vmovdqu (%[u]), %%ymm0"
+			 "\n\t vmovdqu (%[l]), %%ymm1"
+			 "\n\t vpand %%ymm5, %%ymm0, %%ymm2"
+			 "\n\t vpand %%ymm5, %%ymm1, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm6, %%ymm0, %%ymm0"
+			 "\n\t vpmullw %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpaddw %%ymm2, %%ymm0, %%ymm0"
+			 "\n\t vpsrlw $8, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu 32(%[u]), %%ymm4"
+			 "\n\t vmovdqu 32(%[l]), %%ymm1"
+			 "\n\t vpand %%ymm5, %%ymm4, %%ymm2"
+			 "\n\t vpand %%ymm5, %%ymm1, %%ymm3"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm6, %%ymm4, %%ymm4"
+			 "\n\t vpmullw %%ymm7, %%ymm1, %%ymm1"
+			 "\n\t vpmullw %%ymm6, %%ymm2, %%ymm2"
+			 "\n\t vpmullw %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vpaddw %%ymm1, %%ymm4, %%ymm4"
+			 "\n\t vpaddw %%ymm3, %%ymm2, %%ymm2"
+			 "\n\t vpsrlw $8, %%ymm2, %%ymm2"
+			 "\n\t vpaddw %%ymm2, %%ymm4, %%ymm4"
+			 "\n\t vpsrlw $8, %%ymm4, %%ymm4"
+			 "\n\t vpackuswb %%ymm4, %%ymm0, %%ymm0"
+			 "\n\t vpermq $0xd8, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%ymm0, (%[d])"
+			 :: [d] "r" (dest + i), [u] "r" (upper + i), [l] "r" (lower + i),
+			    [f] "r" (factors), [m] "r" (blend_low_mask)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+	}
 
-			b0 += ur * cur.r;
-			b1 += ur * cur.g;
-			b2 += ur * cur.b;
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
 
-			b0 += lr * clr.r;
-			b1 += lr * clr.g;
-			b2 += lr * clr.b;
+	blend_row_c (dest + i, upper + i, lower + i, n - i, frac);
+}
 
-			b.r = b0 >> 16;
-			b.g = b1 >> 16;
-			b.b = b2 >> 16;
+/* filter_column_sse2() on 16 channels, acc is kept in the lane order of the word
+ * interleaves, which the in lane packs undo */
+static void filter_column_avx2 (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc)
+{
+	int i, k;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vpbroadcastd (%[w]), %%ymm7"
+			 "\n\t vmovdqu (%[r0]), %%ymm0"
+			 "\n\t vmovdqu (%[r1]), %%ymm1"
+			 "\n\t vpunpcklwd %%ymm1, %%ymm0, %%ymm2"
+			 "\n\t vpunpckhwd %%ymm1, %%ymm0, %%ymm3"
+			 "\n\t vpmaddwd %%ymm7, %%ymm2, %%ymm2"
+			 "\n\t vpmaddwd %%ymm7, %%ymm3, %%ymm3"
+			 "\n\t vmovdqu %%ymm2, (%[a])"
+			 "\n\t vmovdqu %%ymm3, 32(%[a])"
+			 :: [a] "r" (acc + i), [r0] "r" (rows[0] + i), [r1] "r" (rows[1] + i), [w] "r" (weights)
+			 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
+	}
 
-			*dest_pixel++ = b;
+	for (k = 2; k < taps; k += 2) {
+		for (i = 0; i + 16 <= n; i += 16) {
+			__asm __volatile
+				("\n\t vpbroadcastd (%[w]), %%ymm7"
+				 "\n\t vmovdqu (%[r0]), %%ymm0"
+				 "\n\t vmovdqu (%[r1]), %%ymm1"
+				 "\n\t vpunpcklwd %%ymm1, %%ymm0, %%ymm2"
+				 "\n\t vpunpckhwd %%ymm1, %%ymm0, %%ymm3"
+				 "\n\t vpmaddwd %%ymm7, %%ymm2, %%ymm2"
+				 "\n\t vpmaddwd %%ymm7, %%ymm3, %%ymm3"
+				 "\n\t vpaddd (%[a]), %%ymm2, %%ymm2"
+				 "\n\t vpaddd 32(%[a]), %%ymm3, %%ymm3"
+				 "\n\t vmovdqu %%ymm2, (%[a])"
+				 "\n\t vmovdqu %%ymm3, 32(%[a])"
+				 :: [a] "r" (acc + i), [r0] "r" (rows[k] + i), [r1] "r" (rows[k + 1] + i), [w] "r" (weights + k)
+				 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm7");
 		}
+	}
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+	for (i = 0; i + 16 <= n; i += 16) {
+		__asm __volatile
+			("\n\t vbroadcasti128 (%[c]), %%ymm7"
+			 "\n\t vpaddd (%[a]), %%ymm7, %%ymm0"
+			 "\n\t vpaddd 32(%[a]), %%ymm7, %%ymm1"
+			 "\n\t vpsrad %[shift], %%ymm0, %%ymm0"
+			 "\n\t vpsrad %[shift], %%ymm1, %%ymm1"
+			 "\n\t vpackssdw %%ymm1, %%ymm0, %%ymm0"
+			 "\n\t vpackuswb %%ymm0, %%ymm0, %%ymm0"
+			 "\n\t vpermq $0x08, %%ymm0, %%ymm0"
+			 "\n\t vmovdqu %%xmm0, (%[d])"
+			 :: [d] "r" (dest + i), [a] "r" (acc + i), [c] "r" (filter_round[1]),
+			    [shift] "i" (SCALE_VFILTER_SHIFT)
+			 : "memory", "xmm0", "xmm1", "xmm7");
 	}
+
+	__asm __volatile ("\n\t vzeroupper" ::: "memory");
+
+	filter_column_lanes_c (dest, rows, weights, taps, i, n);
 }
 
-void visual_video_scale_bilinear_color32 (VisVideo *dest, VisVideo *src)
+#endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_ARCH_ARM) && defined(HAVE_NEON)
+
+static void interp_row32_neon (uint16_t *dest, const uint8_t *src, const int32_t *offsets, const uint16_t *weights, int width)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint32_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
+	uint16x8_t p;
+	int i;
 
-	dest_pixel = visual_video_get_pixels (dest);
+	for (i = 0; i < width; i++) {
+		p = vmulq_u16 (vmovl_u8 (vld1_u8 (src + offsets[i] * 4)), vld1q_u16 (weights + i * 8));
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
-
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
-
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
-
-		src_pixel_rowu = (uint32_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (uint32_t *) src->pixel_rows[(v >> 16) + 1];
-
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
-
-		for (x = dest->width - 1; x--; u += du) {
-			union {
-				uint8_t  c8[4];
-				uint32_t c32;
-			} cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b3, b2, b1, b0; /* fixed point 16.16 [0,255[ */
-
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
-
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
-
-			cul.c32 = src_pixel_rowu[u >> 16];
-			cll.c32 = src_pixel_rowl[u >> 16];
-			cur.c32 = src_pixel_rowu[(u >> 16) + 1];
-			clr.c32 = src_pixel_rowl[(u >> 16) + 1];
-
-			b0 = ul * cul.c8[0];
-			b1 = ul * cul.c8[1];
-			b2 = ul * cul.c8[2];
-			b3 = ul * cul.c8[3];
-
-			b0 += ll * cll.c8[0];
-			b1 += ll * cll.c8[1];
-			b2 += ll * cll.c8[2];
-			b3 += ll * cll.c8[3];
-
-			b0 += ur * cur.c8[0];
-			b1 += ur * cur.c8[1];
-			b2 += ur * cur.c8[2];
-			b3 += ur * cur.c8[3];
-
-			b0 += lr * clr.c8[0];
-			b1 += lr * clr.c8[1];
-			b2 += lr * clr.c8[2];
-			b3 += lr * clr.c8[3];
-
-			b.c8[0] = b0 >> 16;
-			b.c8[1] = b1 >> 16;
-			b.c8[2] = b2 >> 16;
-			b.c8[3] = b3 >> 16;
-
-			*dest_pixel++ = b.c32;
-		}
+		vst1_u16 (dest + i * 4, vadd_u16 (vget_low_u16 (p), vget_high_u16 (p)));
+	}
+}
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+/* Split in high and low bytes like blend_row_sse2() */
+static void blend_row_neon (uint8_t *dest, const uint16_t *upper, const uint16_t *lower, int n, int frac)
+{
+	uint16x8_t w0 = vdupq_n_u16 (0x100 - frac);
+	uint16x8_t w1 = vdupq_n_u16 (frac);
+	uint16x8_t mask = vdupq_n_u16 (0xff);
+	uint16x8_t u, l, high, low;
+	int i;
 
+	for (i = 0; i + 8 <= n; i += 8) {
+		u = vld1q_u16 (upper + i);
+		l = vld1q_u16 (lower + i);
+
+		high = vmlaq_u16 (vmulq_u16 (vshrq_n_u16 (u, 8), w0), vshrq_n_u16 (l, 8), w1);
+		low = vmlaq_u16 (vmulq_u16 (vandq_u16 (u, mask), w0), vandq_u16 (l, mask), w1);
+
+		vst1_u8 (dest + i, vshrn_n_u16 (vsraq_n_u16 (high, low, 8), 8));
+	}
+
+	blend_row_c (dest + i, upper + i, lower + i, n - i, frac);
+}
+
+/* The sums stay in registers over all the taps */
+static void filter_column_neon (uint8_t *dest, const int16_t **rows, const int16_t *weights, int taps, int n, int32_t *acc)
+{
+	int32x4_t low, high;
+	int16x8_t r;
+	int i, k;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		low = vdupq_n_s32 (1 << (SCALE_VFILTER_SHIFT - 1));
+		high = low;
+
+		for (k = 0; k < taps; k++) {
+			r = vld1q_s16 (rows[k] + i);
+
+			low = vmlal_n_s16 (low, vget_low_s16 (r), weights[k]);
+			high = vmlal_n_s16 (high, vget_high_s16 (r), weights[k]);
+		}
+
+		vst1_u8 (dest + i, vqmovun_s16 (vcombine_s16 (
+					vqmovn_s32 (vshrq_n_s32 (low, SCALE_VFILTER_SHIFT)),
+					vqmovn_s32 (vshrq_n_s32 (high, SCALE_VFILTER_SHIFT)))));
 	}
+
+	filter_column_lanes_c (dest, rows, weights, taps, i, n);
 }
+
+#endif /* VISUAL_ARCH_ARM && HAVE_NEON */
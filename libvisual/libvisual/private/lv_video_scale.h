@@ -3,19 +3,24 @@
 
 #include "lv_video.h"
 
+/* Integer taps of a separable filter along one axis, shared between the bands */
+typedef struct _VisVideoScaleFilter VisVideoScaleFilter;
+
 void visual_video_zoom_color8  (VisVideo *dest, VisVideo *src);
 void visual_video_zoom_color16 (VisVideo *dest, VisVideo *src);
 void visual_video_zoom_color24 (VisVideo *dest, VisVideo *src);
 void visual_video_zoom_color32 (VisVideo *dest, VisVideo *src);
 
-void visual_video_scale_nearest_color8  (VisVideo *dest, VisVideo *src);
-void visual_video_scale_nearest_color16 (VisVideo *dest, VisVideo *src);
-void visual_video_scale_nearest_color24 (VisVideo *dest, VisVideo *src);
-void visual_video_scale_nearest_color32 (VisVideo *dest, VisVideo *src);
+/* The scalers fill the destination rows y0 to y1, of any depth but GL */
+void visual_video_scale_nearest  (VisVideo *dest, VisVideo *src, int y0, int y1);
+void visual_video_scale_bilinear (VisVideo *dest, VisVideo *src, int y0, int y1);
+void visual_video_scale_filtered (VisVideo *dest, VisVideo *src, VisVideoScaleFilter *hfilter,
+		VisVideoScaleFilter *vfilter, int y0, int y1);
+
+/* Returns a reference to the filter for scaling srcsize pixels to destsize, from the cache */
+VisVideoScaleFilter *visual_video_scale_filter_get (VisVideoScaleMethod method, int srcsize, int destsize);
 
-void visual_video_scale_bilinear_color8  (VisVideo *dest, VisVideo *src);
-void visual_video_scale_bilinear_color16 (VisVideo *dest, VisVideo *src);
-void visual_video_scale_bilinear_color24 (VisVideo *dest, VisVideo *src);
-void visual_video_scale_bilinear_color32 (VisVideo *dest, VisVideo *src);
+void visual_video_scale_cache_initialize (void);
+void visual_video_scale_cache_deinitialize (void);
 
 #endif /* _LV_VIDEO_SCALE_H */
@@ -0,0 +1,64 @@
+#include "lv_video_threads.h"
+#include "lv_common.h"
+#include "lv_jobs.h"
+#include "lv_cpu.h"
+
+/* Bands below this many pixels cost more to hand out than they save */
+#define BAND_MIN_PIXELS		(64 * 1024)
+
+/* The bands run as a parallel_for over the band numbers, one band per sub range */
+typedef struct {
+	VisVideoBandFunc	 func;
+	void			*priv;
+} VideoBandRange;
+
+static void video_band_range (void *priv, int start, int end)
+{
+	VideoBandRange *range = priv;
+	int band;
+
+	for (band = start; band < end; band++)
+		range->func (range->priv, band);
+}
+
+int visual_video_threads_get_bands (int width, int height)
+{
+	int threads;
+	int bands;
+
+	if (visual_jobs_get_worker_count () == 0)
+		return 1;
+
+	threads = visual_video_get_thread_count ();
+
+	if (threads > VISUAL_VIDEO_THREADS_MAX)
+		threads = VISUAL_VIDEO_THREADS_MAX;
+
+	bands = (width * height) / BAND_MIN_PIXELS;
+
+	if (bands > height)
+		bands = height;
+
+	if (bands > threads)
+		bands = threads;
+
+	return bands < 1 ? 1 : bands;
+}
+
+void visual_video_threads_run (int bands, VisVideoBandFunc func, void *priv)
+{
+	VideoBandRange range;
+	int band;
+
+	if (bands <= 1) {
+		for (band = 0; band < bands; band++)
+			func (priv, band);
+
+		return;
+	}
+
+	range.func = func;
+	range.priv = priv;
+
+	visual_jobs_parallel_for (0, bands, 1, video_band_range, &range);
+}
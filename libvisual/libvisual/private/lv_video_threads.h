@@ -0,0 +1,15 @@
+#ifndef _LV_VIDEO_THREADS_H
+#define _LV_VIDEO_THREADS_H
+
+#include "lv_video.h"
+
+/* Upper bound on the number of bands, and threads, an operation is split in */
+#define VISUAL_VIDEO_THREADS_MAX	16
+
+/* Operations are split in horizontal bands, numbered from 0 */
+typedef void (*VisVideoBandFunc)(void *priv, int band);
+
+int visual_video_threads_get_bands (int width, int height);
+void visual_video_threads_run (int bands, VisVideoBandFunc func, void *priv);
+
+#endif /* _LV_VIDEO_THREADS_H */
@@ -3,48 +3,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define FORCED_DEPTH	TRUE
-#define DEPTH		VISUAL_VIDEO_DEPTH_32BIT
-#define TIMES		500
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+
+typedef struct {
+	VisActor	*actor;
+	VisAudio	*audio;
+} ActorBench;
+
+static void actor_bench_run (void *priv)
+{
+	ActorBench *ab = priv;
+
+	visual_actor_run (ab->actor, ab->audio);
+}
 
 int main (int argc, char **argv)
 {
-	VisActor *actor;
-	VisAudio audio;
+	BenchHarness bench;
+	ActorBench ab;
 	VisVideo *dest;
-	int i;
+	const char *actors[BENCH_HARNESS_MAX_SWEEP];
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int nactors, ndepths, nsizes;
+	char params[256];
+	int a, d, s;
 
 	visual_init (&argc, &argv);
 
-	if (argc < 2)
-		actor = visual_actor_new ("oinksie");
-	else
-		actor = visual_actor_new (argv[1]);
+	if (bench_harness_init (&bench, "actor_throughput_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, "[actor] [depth]");
+
+		return EXIT_FAILURE;
+	}
+
+	/* The old positional arguments still pick the actor and depth */
+	if (argc > 1 && bench.plugins == NULL)
+		bench.plugins = argv[1];
+
+	if (argc > 2 && bench.depths == NULL)
+		bench.depths = argv[2];
+
+	nactors = bench_harness_get_plugins (&bench, actors, "oinksie", visual_actor_get_next_by_name_nogl);
+	ndepths = bench_harness_get_depths (&bench, depths, "32");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "640x400");
+
+	ab.audio = visual_audio_new ();
+	visual_audio_analyze (ab.audio);
+
+	for (a = 0; a < nactors; a++) {
+		ab.actor = visual_actor_new (actors[a]);
+
+		if (ab.actor == NULL) {
+			fprintf (stderr, "Can't load actor '%s'\n", actors[a]);
+
+			continue;
+		}
+
+		visual_actor_realize (ab.actor);
+
+		for (d = 0; d < ndepths; d++) {
+			for (s = 0; s < nsizes; s++) {
+				dest = visual_video_new ();
 
-	visual_actor_realize (actor);
+				visual_video_set_depth (dest, depths[d]);
+				visual_video_set_dimension (dest, widths[s], heights[s]);
+				visual_video_allocate_buffer (dest);
 
-	dest = visual_video_new ();
+				visual_actor_set_video (ab.actor, dest);
+				visual_actor_video_negotiate (ab.actor, 0, FALSE, FALSE);
 
-#ifdef FORCED_DEPTH
-	visual_video_set_depth (dest, DEPTH);
-#else
-	visual_video_set_depth (dest, VISUAL_PLUGIN_ACTOR (visual_actor_get_plugin (actor)->info->plugin)->depth);
-#endif
+				snprintf (params, sizeof (params), "actor=%s depth=%d size=%dx%d",
+						actors[a], visual_video_depth_value_from_enum (depths[d]),
+						widths[s], heights[s]);
 
-	if (argc > 2)
-		visual_video_set_depth (dest, visual_video_depth_enum_from_value (atoi (argv[2])));
+				bench_harness_run (&bench, params, actor_bench_run, &ab, NULL);
 
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+				visual_actor_set_video (ab.actor, NULL);
+				visual_object_unref (VISUAL_OBJECT (dest));
+			}
+		}
 
-	visual_actor_set_video (actor, dest);
-	visual_actor_video_negotiate (actor, 0, FALSE, FALSE);
+		visual_object_unref (VISUAL_OBJECT (ab.actor));
+	}
 
-	for (i = 0; i < TIMES; i++)
-		visual_actor_run (actor, &audio);
+	visual_object_unref (VISUAL_OBJECT (ab.audio));
 
-	printf ("Actor throughput bench %d times depthBPP %d actor: %s\n", TIMES, dest->bpp,
-			(visual_plugin_get_info (visual_actor_get_plugin (actor)))->plugname);
+	bench_harness_finish (&bench);
 
 	return EXIT_SUCCESS;
 }
@@ -2,29 +2,297 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define TIMES	500
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+#define ALPHA		77
+
+/*
+ * Times the source alpha overlay and the morph blends of every depth, the blend
+ * kernels are checked against the C ones first. The fused blends into another depth
+ * are checked against a blend followed by a depth transform and timed against it.
+ */
+
+/* Every level enables the features of the ones before it */
+typedef enum {
+	BLEND_IMPL_C,
+	BLEND_IMPL_SSE2,
+	BLEND_IMPL_AVX2,
+	BLEND_IMPL_NEON,
+	BLEND_IMPL_LAST
+} BlendImpl;
+
+typedef struct {
+	VisVideo	*dest;
+	VisVideo	*src;
+	VisVideo	*src2;
+	VisVideo	*temp;
+	int		 alpha;
+} BlendBench;
+
+static const char *impl_names[] = {
+	[BLEND_IMPL_C]		= "c",
+	[BLEND_IMPL_SSE2]	= "sse2",
+	[BLEND_IMPL_AVX2]	= "avx2",
+	[BLEND_IMPL_NEON]	= "neon"
+};
+
+static const VisVideoDepth check_depths[] = {
+	VISUAL_VIDEO_DEPTH_8BIT, VISUAL_VIDEO_DEPTH_16BIT, VISUAL_VIDEO_DEPTH_24BIT, VISUAL_VIDEO_DEPTH_32BIT
+};
+
+/* Below, at and past every vector width, for the tails */
+static const int check_widths[] = { 1, 3, 7, 8, 17, 33, 67, 131 };
+
+static const int check_alphas[] = { 0, 1, 77, 128, 254, 255 };
+
+static int set_impl (int impl)
+{
+	visual_cpu_set_mmx (FALSE);
+	visual_cpu_set_sse2 (FALSE);
+	visual_cpu_set_avx2 (FALSE);
+	visual_cpu_set_neon (FALSE);
+
+	switch (impl) {
+		case BLEND_IMPL_AVX2:
+			if (visual_cpu_set_avx2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			/* Fall through */
+		case BLEND_IMPL_SSE2:
+			if (visual_cpu_set_sse2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		case BLEND_IMPL_NEON:
+			if (visual_cpu_set_neon (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		default:
+			break;
+	}
+
+	visual_alpha_blend_initialize ();
+
+	return TRUE;
+}
+
+static void restore_impl ()
+{
+	visual_cpu_set_mmx (TRUE);
+	visual_cpu_set_sse2 (TRUE);
+	visual_cpu_set_avx2 (TRUE);
+	visual_cpu_set_neon (TRUE);
+
+	visual_alpha_blend_initialize ();
+}
+
+static void blend_bench_run (void *priv)
+{
+	BlendBench *bb = priv;
+
+	visual_video_blit_overlay (bb->dest, bb->src, 0, 0, TRUE);
+}
+
+static void morph_bench_run (void *priv)
+{
+	BlendBench *bb = priv;
+
+	visual_video_alpha_blend (bb->dest, bb->src, bb->src2, bb->alpha);
+}
+
+/* What the fused blend saves, a pass over a blended copy */
+static void morph_bench_run_two_pass (void *priv)
+{
+	BlendBench *bb = priv;
+
+	visual_video_alpha_blend (bb->temp, bb->src, bb->src2, bb->alpha);
+	visual_video_depth_transform (bb->dest, bb->temp);
+}
+
+static int check_blend (BlendImpl impl, VisVideoDepth depth, int width, int alpha)
+{
+	BlendBench bb;
+	int same;
+
+	bb.src = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.src2 = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.dest = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.alpha = alpha;
+
+	same = bench_harness_check_impl (&bb.dest, morph_bench_run, &bb, set_impl, impl);
+
+	if (same == FALSE) {
+		fprintf (stderr, "Alphablend bench %s: depth=%d width=%d alpha=%d differs from c\n",
+				impl_names[impl], visual_video_depth_value_from_enum (depth), width, alpha);
+	}
+
+	visual_object_unref (VISUAL_OBJECT (bb.dest));
+	visual_object_unref (VISUAL_OBJECT (bb.src2));
+	visual_object_unref (VISUAL_OBJECT (bb.src));
+
+	return same;
+}
+
+/* The fused blend against a blend followed by a depth transform */
+static int check_fused (VisVideoDepth depth, VisVideoDepth destdepth, int width)
+{
+	BlendBench bb;
+	int same;
+
+	bb.src = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.src2 = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.temp = bench_harness_video (depth, width, 5, 0);
+	bb.dest = bench_harness_video (destdepth, width, 5, BENCH_HARNESS_CHECK_PADDING);
+	bb.alpha = ALPHA;
+
+	same = bench_harness_check (&bb.dest, morph_bench_run_two_pass, morph_bench_run, &bb);
+
+	if (same == FALSE) {
+		fprintf (stderr, "Alphablend bench fused: depth=%d dest=%d width=%d differs from two passes\n",
+				visual_video_depth_value_from_enum (depth), visual_video_depth_value_from_enum (destdepth),
+				width);
+	}
+
+	visual_object_unref (VISUAL_OBJECT (bb.dest));
+	visual_object_unref (VISUAL_OBJECT (bb.temp));
+	visual_object_unref (VISUAL_OBJECT (bb.src2));
+	visual_object_unref (VISUAL_OBJECT (bb.src));
+
+	return same;
+}
+
+static int check_impl (BlendImpl impl)
+{
+	int d, w, a;
+
+	for (d = 0; d < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d++) {
+		for (w = 0; w < (int) (sizeof (check_widths) / sizeof (check_widths[0])); w++) {
+			for (a = 0; a < (int) (sizeof (check_alphas) / sizeof (check_alphas[0])); a++) {
+				if (check_blend (impl, check_depths[d], check_widths[w], check_alphas[a]) == FALSE)
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* Every pair of truecolor depths, 8 bits goes through a blended copy anyway */
+static int check_fused_all ()
+{
+	int d1, d2, w;
+
+	for (d1 = 1; d1 < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d1++) {
+		for (d2 = 1; d2 < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d2++) {
+			if (d1 == d2)
+				continue;
+
+			for (w = 0; w < (int) (sizeof (check_widths) / sizeof (check_widths[0])); w++) {
+				if (check_fused (check_depths[d1], check_depths[d2], check_widths[w]) == FALSE)
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
 
 int main (int argc, char **argv)
 {
-	VisVideo *dest, *src;
-	int i;
+	BenchHarness bench;
+	BlendBench bb;
+	BlendImpl impl;
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	VisVideoDepth destdepth;
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int ndepths, nsizes;
+	char params[256];
+	int d, s;
 
 	visual_init (&argc, &argv);
 
-	dest = visual_video_new ();
-	visual_video_set_depth (dest, VISUAL_VIDEO_DEPTH_32BIT);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+	if (bench_harness_init (&bench, "alphablend_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	for (impl = BLEND_IMPL_SSE2; impl < BLEND_IMPL_LAST; impl++) {
+		if (set_impl (impl) == TRUE && check_impl (impl) == FALSE)
+			return EXIT_FAILURE;
+	}
+
+	restore_impl ();
+
+	if (check_fused_all () == FALSE)
+		return EXIT_FAILURE;
+
+	ndepths = bench_harness_get_depths (&bench, depths, "8,16,24,32");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "640x400");
+
+	for (d = 0; d < ndepths; d++) {
+		for (s = 0; s < nsizes; s++) {
+			bb.dest = bench_harness_video (depths[d], widths[s], heights[s], 0);
+			bb.src = bench_harness_video (depths[d], widths[s], heights[s], 0);
+			bb.src2 = bench_harness_video (depths[d], widths[s], heights[s], 0);
+			bb.temp = NULL;
+			bb.alpha = ALPHA;
+
+			bench_harness_set_throughput (&bench, widths[s] * heights[s], "Pixels");
+
+			/* Source alpha only means something to 32 bits pixels */
+			if (depths[d] == VISUAL_VIDEO_DEPTH_32BIT) {
+				snprintf (params, sizeof (params), "blend=overlay depth=%d size=%dx%d",
+						visual_video_depth_value_from_enum (depths[d]), widths[s], heights[s]);
+
+				bench_harness_run (&bench, params, blend_bench_run, &bb, NULL);
+			}
+
+			snprintf (params, sizeof (params), "blend=morph depth=%d size=%dx%d",
+					visual_video_depth_value_from_enum (depths[d]), widths[s], heights[s]);
+
+			bench_harness_run_impls (&bench, params, impl_names, BLEND_IMPL_LAST, set_impl,
+					morph_bench_run, &bb);
+
+			restore_impl ();
+
+			/* Into a 32 bits display, or a 16 bits one from 32 bits sources */
+			destdepth = depths[d] == VISUAL_VIDEO_DEPTH_32BIT ? VISUAL_VIDEO_DEPTH_16BIT : VISUAL_VIDEO_DEPTH_32BIT;
+
+			if (depths[d] != VISUAL_VIDEO_DEPTH_8BIT) {
+				visual_object_unref (VISUAL_OBJECT (bb.dest));
+
+				bb.dest = bench_harness_video (destdepth, widths[s], heights[s], 0);
+				bb.temp = bench_harness_video (depths[d], widths[s], heights[s], 0);
+
+				snprintf (params, sizeof (params), "blend=fused depth=%d dest=%d size=%dx%d",
+						visual_video_depth_value_from_enum (depths[d]),
+						visual_video_depth_value_from_enum (destdepth), widths[s], heights[s]);
+
+				bench_harness_run (&bench, params, morph_bench_run, &bb, NULL);
+
+				snprintf (params, sizeof (params), "blend=two-pass depth=%d dest=%d size=%dx%d",
+						visual_video_depth_value_from_enum (depths[d]),
+						visual_video_depth_value_from_enum (destdepth), widths[s], heights[s]);
+
+				bench_harness_run (&bench, params, morph_bench_run_two_pass, &bb, NULL);
 
-	src = visual_video_new ();
-	visual_video_clone (src, dest);
-	visual_video_allocate_buffer (src);
+				visual_object_unref (VISUAL_OBJECT (bb.temp));
+			}
 
-	for (i = 0; i < TIMES; i++)
-		visual_video_blit_overlay (dest, src, 0, 0, TRUE);
+			visual_object_unref (VISUAL_OBJECT (bb.src2));
+			visual_object_unref (VISUAL_OBJECT (bb.src));
+			visual_object_unref (VISUAL_OBJECT (bb.dest));
+		}
+	}
 
-	printf ("Blit overlay %d times\n", TIMES);
+	bench_harness_finish (&bench);
 
 	return EXIT_SUCCESS;
 }
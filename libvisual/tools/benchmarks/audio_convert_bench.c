@@ -0,0 +1,131 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	100
+#define BENCH_SIZE	4096
+#define MAX_SIZE	4099
+
+static const char *format_names[] = {
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U8]		= "u8",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S8]		= "s8",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U16]	= "u16",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S16]	= "s16",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_U32]	= "u32",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_S32]	= "s32",
+	[VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT]	= "float"
+};
+
+/* Odd sizes to cover the scalar tails of the vector kernels */
+static const int sizes[] = { 1, 7, 15, 33, 257, MAX_SIZE };
+
+static uint8_t source[MAX_SIZE * 4];
+static uint8_t output[MAX_SIZE * 4];
+static uint8_t reference[MAX_SIZE * 4];
+
+typedef struct {
+	VisAudioSampleFormatType	dformat;
+	VisAudioSampleFormatType	sformat;
+} ConvertBench;
+
+static void fill_source (VisAudioSampleFormatType format)
+{
+	float *fsource = (float *) source;
+	int i;
+
+	for (i = 0; i < MAX_SIZE * 4; i++)
+		source[i] = rand ();
+
+	if (format != VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT)
+		return;
+
+	/* Mostly in range, with clipping and the odd special value */
+	for (i = 0; i < MAX_SIZE; i++)
+		fsource[i] = (rand () / (float) RAND_MAX - 0.5f) * 2.4f;
+
+	fsource[3] = 1.0f;
+	fsource[4] = -1.0f;
+	fsource[5] = 0.99999994f;
+	fsource[6] = NAN;
+	fsource[20] = INFINITY;
+	fsource[21] = -INFINITY;
+	fsource[22] = 1e30f;
+	fsource[23] = -0.0f;
+}
+
+static void set_simd (int enabled)
+{
+	visual_cpu_set_sse2 (enabled);
+	visual_cpu_set_avx2 (enabled);
+	visual_cpu_set_neon (enabled);
+
+	visual_audio_sample_convert_initialize ();
+}
+
+static void convert_bench_run (void *priv)
+{
+	ConvertBench *cb = priv;
+
+	visual_audio_sample_convert (output, cb->dformat, source, cb->sformat, BENCH_SIZE);
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	ConvertBench cb;
+	char params[64];
+	int dsize, simd;
+	int i;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "audio_convert_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	for (cb.sformat = VISUAL_AUDIO_SAMPLE_FORMAT_U8; cb.sformat < VISUAL_AUDIO_SAMPLE_FORMAT_LAST; cb.sformat++) {
+		fill_source (cb.sformat);
+
+		for (cb.dformat = VISUAL_AUDIO_SAMPLE_FORMAT_U8; cb.dformat < VISUAL_AUDIO_SAMPLE_FORMAT_LAST; cb.dformat++) {
+			dsize = visual_audio_sample_format_get_size (cb.dformat);
+
+			/* The vector kernels have to match the C ones bit for bit */
+			for (i = 0; i < (int) (sizeof (sizes) / sizeof (sizes[0])); i++) {
+				set_simd (FALSE);
+				visual_audio_sample_convert (reference, cb.dformat, source, cb.sformat, sizes[i]);
+
+				set_simd (TRUE);
+				visual_audio_sample_convert (output, cb.dformat, source, cb.sformat, sizes[i]);
+
+				if (memcmp (output, reference, sizes[i] * dsize) != 0) {
+					fprintf (stderr, "Audio convert bench %s to %s, %d samples: simd result differs\n",
+							format_names[cb.sformat], format_names[cb.dformat], sizes[i]);
+
+					return EXIT_FAILURE;
+				}
+			}
+
+			for (simd = TRUE; simd >= FALSE; simd--) {
+				set_simd (simd);
+
+				snprintf (params, sizeof (params), "from=%s to=%s samples=%d simd=%d",
+						format_names[cb.sformat], format_names[cb.dformat], BENCH_SIZE, simd);
+
+				bench_harness_run (&bench, params, convert_bench_run, &cb, NULL);
+			}
+
+			set_simd (TRUE);
+		}
+	}
+
+	bench_harness_finish (&bench);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,552 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "bench_harness.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#define DEFAULT_WARMUP		5
+#define DEFAULT_REPETITIONS	50
+
+static double time_get_usecs (void);
+static uint64_t cycles_get (void);
+static int compare_double (const void *a, const void *b);
+static int compare_uint64 (const void *a, const void *b);
+static void print_params_json (FILE *file, const char *params);
+static int check_run (VisVideo **dest, BenchFunc reference, BenchFunc func, void *priv,
+		BenchImplFunc set_impl, int impl);
+static int split_list (char *list, char **items);
+
+static const char *output_names[] = {
+	[BENCH_OUTPUT_TEXT]	= "text",
+	[BENCH_OUTPUT_JSON]	= "json",
+	[BENCH_OUTPUT_CSV]	= "csv"
+};
+
+/* Monotonic where the system has it, wall clock otherwise */
+static double time_get_usecs (void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+#else
+	VisTime now;
+
+	visual_time_get (&now);
+
+	return now.tv_sec * 1000000.0 + now.tv_usec;
+#endif
+}
+
+static uint64_t cycles_get (void)
+{
+#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
+	if (visual_cpu_get_tsc () > 0)
+		return visual_timer_tsc_get_returned ();
+#endif
+
+	return 0;
+}
+
+static int compare_double (const void *a, const void *b)
+{
+	double da = *((const double *) a);
+	double db = *((const double *) b);
+
+	return da < db ? -1 : da > db;
+}
+
+static int compare_uint64 (const void *a, const void *b)
+{
+	uint64_t ua = *((const uint64_t *) a);
+	uint64_t ub = *((const uint64_t *) b);
+
+	return ua < ub ? -1 : ua > ub;
+}
+
+int bench_harness_init (BenchHarness *bench, const char *name, int iterations, int *argc, char ***argv)
+{
+	static struct option loptions[] = {
+		{"help",	no_argument,		0, 'h'},
+		{"warmup",	required_argument,	0, 'w'},
+		{"repetitions",	required_argument,	0, 'r'},
+		{"iterations",	required_argument,	0, 'n'},
+		{"format",	required_argument,	0, 'f'},
+		{"output",	required_argument,	0, 'o'},
+		{"depths",	required_argument,	0, 'd'},
+		{"sizes",	required_argument,	0, 's'},
+		{"plugins",	required_argument,	0, 'p'},
+		{0,		0,			0,  0 }
+	};
+	int argument;
+	int i;
+
+	visual_return_val_if_fail (bench != NULL, -VISUAL_ERROR_NULL);
+
+	memset (bench, 0, sizeof (BenchHarness));
+
+	bench->name = name;
+	bench->warmup = DEFAULT_WARMUP;
+	bench->repetitions = DEFAULT_REPETITIONS;
+	bench->iterations = iterations > 0 ? iterations : 1;
+	bench->output = BENCH_OUTPUT_TEXT;
+	bench->file = stdout;
+
+	while ((argument = getopt_long (*argc, *argv, "hw:r:n:f:o:d:s:p:", loptions, NULL)) >= 0) {
+		switch (argument) {
+			case 'w':
+				bench->warmup = atoi (optarg);
+				break;
+
+			case 'r':
+				bench->repetitions = atoi (optarg);
+				break;
+
+			case 'n':
+				bench->iterations = atoi (optarg);
+				break;
+
+			case 'f':
+				for (i = 0; i < (int) (sizeof (output_names) / sizeof (output_names[0])); i++) {
+					if (strcmp (optarg, output_names[i]) == 0)
+						break;
+				}
+
+				if (i == (int) (sizeof (output_names) / sizeof (output_names[0]))) {
+					fprintf (stderr, "Unknown output format '%s'\n", optarg);
+
+					return -VISUAL_ERROR_GENERAL;
+				}
+
+				bench->output = i;
+				break;
+
+			case 'o':
+				bench->file = fopen (optarg, "w");
+
+				if (bench->file == NULL) {
+					fprintf (stderr, "Can't open '%s' for writing\n", optarg);
+
+					return -VISUAL_ERROR_GENERAL;
+				}
+				break;
+
+			case 'd':
+				bench->depths = optarg;
+				break;
+
+			case 's':
+				bench->sizes = optarg;
+				break;
+
+			case 'p':
+				bench->plugins = optarg;
+				break;
+
+			case 'h':
+			default:
+				return -VISUAL_ERROR_GENERAL;
+		}
+	}
+
+	if (bench->repetitions < 1 || bench->iterations < 1 || bench->warmup < 0) {
+		fprintf (stderr, "Repetitions and iterations should be at least 1\n");
+
+		return -VISUAL_ERROR_GENERAL;
+	}
+
+	/* Leave the positional arguments for the bench itself */
+	for (i = optind; i < *argc; i++)
+		(*argv)[i - optind + 1] = (*argv)[i];
+
+	*argc -= optind - 1;
+
+	if (bench->output == BENCH_OUTPUT_JSON)
+		fprintf (bench->file, "{\n  \"bench\": \"%s\",\n  \"results\": [", bench->name);
+	else if (bench->output == BENCH_OUTPUT_CSV)
+		fprintf (bench->file, "bench,params,warmup,repetitions,iterations,min_us,median_us,p99_us,mean_us,median_cycles,throughput\n");
+
+	return VISUAL_OK;
+}
+
+void bench_harness_usage (BenchHarness *bench, const char *args)
+{
+	fprintf (stderr,
+			"Usage: %s [options]%s%s\n"
+			"  -w, --warmup N        Untimed repetitions before measuring (%d)\n"
+			"  -r, --repetitions N   Timed repetitions (%d)\n"
+			"  -n, --iterations N    Iterations per repetition\n"
+			"  -f, --format FORMAT   Output as text, json or csv\n"
+			"  -o, --output FILE     Write the results to FILE\n"
+			"  -d, --depths LIST     Comma separated depths, e.g. 8,16,24,32\n"
+			"  -s, --sizes LIST      Comma separated resolutions, e.g. 320x200,640x400\n"
+			"  -p, --plugins LIST    Comma separated plugin names, or all\n",
+			bench->name, args != NULL ? " " : "", args != NULL ? args : "",
+			DEFAULT_WARMUP, DEFAULT_REPETITIONS);
+}
+
+int bench_harness_run (BenchHarness *bench, const char *params, BenchFunc func, void *priv, BenchResult *result)
+{
+	BenchResult res;
+	double *times;
+	uint64_t *cycles;
+	double start;
+	uint64_t cstart;
+	int i, j;
+
+	visual_return_val_if_fail (bench != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (func != NULL, -VISUAL_ERROR_NULL);
+
+	if (params == NULL)
+		params = "";
+
+	times = visual_mem_malloc0 (bench->repetitions * sizeof (double));
+	cycles = visual_mem_malloc0 (bench->repetitions * sizeof (uint64_t));
+
+	for (i = 0; i < bench->warmup; i++) {
+		for (j = 0; j < bench->iterations; j++)
+			func (priv);
+	}
+
+	for (i = 0; i < bench->repetitions; i++) {
+		start = time_get_usecs ();
+		cstart = cycles_get ();
+
+		for (j = 0; j < bench->iterations; j++)
+			func (priv);
+
+		cycles[i] = (cycles_get () - cstart) / bench->iterations;
+		times[i] = (time_get_usecs () - start) / bench->iterations;
+	}
+
+	res.mean = 0;
+	for (i = 0; i < bench->repetitions; i++)
+		res.mean += times[i];
+
+	res.mean /= bench->repetitions;
+
+	qsort (times, bench->repetitions, sizeof (double), compare_double);
+	qsort (cycles, bench->repetitions, sizeof (uint64_t), compare_uint64);
+
+	/* Nearest rank percentiles */
+	res.min = times[0];
+	res.median = times[(bench->repetitions - 1) / 2];
+	res.p99 = times[(bench->repetitions * 99 + 99) / 100 - 1];
+	res.cycles = cycles[(bench->repetitions - 1) / 2];
+	res.throughput = bench->units > 0 && res.median > 0 ? bench->units / res.median : 0;
+
+	visual_mem_free (times);
+	visual_mem_free (cycles);
+
+	switch (bench->output) {
+		case BENCH_OUTPUT_TEXT:
+			fprintf (bench->file, "%s [%s]: min %.2f us, median %.2f us, p99 %.2f us",
+					bench->name, params, res.min, res.median, res.p99);
+
+			if (res.cycles > 0)
+				fprintf (bench->file, ", %llu cycles", (unsigned long long) res.cycles);
+
+			if (res.throughput > 0)
+				fprintf (bench->file, ", %.1f M%s/s", res.throughput, bench->unit_name);
+
+			fprintf (bench->file, " (%d x %d)\n", bench->repetitions, bench->iterations);
+			break;
+
+		case BENCH_OUTPUT_JSON:
+			fprintf (bench->file, "%s\n    {\"params\": ", bench->records > 0 ? "," : "");
+			print_params_json (bench->file, params);
+			fprintf (bench->file, ", \"warmup\": %d, \"repetitions\": %d, \"iterations\": %d, "
+					"\"min_us\": %.3f, \"median_us\": %.3f, \"p99_us\": %.3f, \"mean_us\": %.3f, "
+					"\"median_cycles\": %llu",
+					bench->warmup, bench->repetitions, bench->iterations,
+					res.min, res.median, res.p99, res.mean, (unsigned long long) res.cycles);
+
+			if (res.throughput > 0)
+				fprintf (bench->file, ", \"throughput\": %.3f, \"throughput_unit\": \"M%s/s\"",
+						res.throughput, bench->unit_name);
+
+			fprintf (bench->file, "}");
+			break;
+
+		case BENCH_OUTPUT_CSV:
+			fprintf (bench->file, "%s,\"%s\",%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%llu,",
+					bench->name, params, bench->warmup, bench->repetitions, bench->iterations,
+					res.min, res.median, res.p99, res.mean, (unsigned long long) res.cycles);
+
+			if (res.throughput > 0)
+				fprintf (bench->file, "%.3f", res.throughput);
+
+			fprintf (bench->file, "\n");
+			break;
+	}
+
+	fflush (bench->file);
+
+	bench->records++;
+
+	if (result != NULL)
+		*result = res;
+
+	return VISUAL_OK;
+}
+
+int bench_harness_finish (BenchHarness *bench)
+{
+	visual_return_val_if_fail (bench != NULL, -VISUAL_ERROR_NULL);
+
+	if (bench->output == BENCH_OUTPUT_JSON)
+		fprintf (bench->file, "\n  ]\n}\n");
+
+	if (bench->file != stdout)
+		fclose (bench->file);
+
+	bench->file = NULL;
+
+	return VISUAL_OK;
+}
+
+/* Units are counted per iteration, the rate comes out in millions per second */
+void bench_harness_set_throughput (BenchHarness *bench, double units, const char *unit_name)
+{
+	visual_return_if_fail (bench != NULL);
+
+	bench->units = units;
+	bench->unit_name = unit_name != NULL ? unit_name : "units";
+}
+
+/* Appends impl=name to the params of every impl the CPU has, impl 0 included */
+int bench_harness_run_impls (BenchHarness *bench, const char *params, const char **impl_names, int nimpls,
+		BenchImplFunc set_impl, BenchFunc func, void *priv)
+{
+	char implparams[512];
+	int impl;
+
+	visual_return_val_if_fail (bench != NULL, -VISUAL_ERROR_NULL);
+	visual_return_val_if_fail (set_impl != NULL, -VISUAL_ERROR_NULL);
+
+	for (impl = 0; impl < nimpls; impl++) {
+		if (set_impl (impl) == FALSE)
+			continue;
+
+		snprintf (implparams, sizeof (implparams), "%s impl=%s", params != NULL ? params : "",
+				impl_names[impl]);
+
+		bench_harness_run (bench, implparams, func, priv, NULL);
+	}
+
+	return VISUAL_OK;
+}
+
+/* Random pixels, padding included, a palette is left to the caller */
+VisVideo *bench_harness_video (VisVideoDepth depth, int width, int height, int padding)
+{
+	VisVideo *video = visual_video_new ();
+	uint8_t *pixels;
+	int i;
+
+	visual_video_set_depth (video, depth);
+	visual_video_set_dimension (video, width, height);
+	visual_video_set_pitch (video, width * video->bpp + padding);
+	visual_video_allocate_buffer (video);
+
+	pixels = visual_video_get_pixels (video);
+
+	for (i = 0; i < visual_video_get_size (video); i++)
+		pixels[i] = rand ();
+
+	return video;
+}
+
+/* The reference goes into *dest, func into a twin of it with the same pixels and palette */
+static int check_run (VisVideo **dest, BenchFunc reference, BenchFunc func, void *priv,
+		BenchImplFunc set_impl, int impl)
+{
+	VisVideo *expected = *dest;
+	VisVideo *output = visual_video_new ();
+	int same;
+
+	visual_video_set_depth (output, expected->depth);
+	visual_video_set_dimension (output, expected->width, expected->height);
+	visual_video_set_pitch (output, expected->pitch);
+	visual_video_allocate_buffer (output);
+
+	visual_mem_copy (visual_video_get_pixels (output), visual_video_get_pixels (expected),
+			visual_video_get_size (expected));
+
+	if (expected->pal != NULL) {
+		visual_video_set_palette (output, visual_palette_new (expected->pal->ncolors));
+		visual_palette_copy (output->pal, expected->pal);
+	}
+
+	if (set_impl != NULL)
+		set_impl (0);
+
+	reference (priv);
+
+	if (set_impl != NULL)
+		set_impl (impl);
+
+	*dest = output;
+	func (priv);
+	*dest = expected;
+
+	same = memcmp (visual_video_get_pixels (output), visual_video_get_pixels (expected),
+			visual_video_get_size (expected)) == 0;
+
+	if (output->pal != NULL)
+		visual_object_unref (VISUAL_OBJECT (output->pal));
+
+	visual_object_unref (VISUAL_OBJECT (output));
+
+	return same;
+}
+
+/*
+ * Runs reference and then func with the destination pointer in priv pointing at two
+ * copies of *dest, TRUE when both leave the same bytes. Make *dest with
+ * bench_harness_video() and BENCH_HARNESS_CHECK_PADDING to catch writes past the rows.
+ */
+int bench_harness_check (VisVideo **dest, BenchFunc reference, BenchFunc func, void *priv)
+{
+	visual_return_val_if_fail (dest != NULL && *dest != NULL, FALSE);
+
+	return check_run (dest, reference, func, priv, NULL, 0);
+}
+
+/* Runs func under impl 0 and under impl, see bench_harness_check() */
+int bench_harness_check_impl (VisVideo **dest, BenchFunc func, void *priv, BenchImplFunc set_impl, int impl)
+{
+	visual_return_val_if_fail (dest != NULL && *dest != NULL, FALSE);
+	visual_return_val_if_fail (set_impl != NULL, FALSE);
+
+	return check_run (dest, func, func, priv, set_impl, impl);
+}
+
+/* Params are space separated key=value pairs, they become a JSON object of strings */
+static void print_params_json (FILE *file, const char *params)
+{
+	const char *p = params;
+	int first = TRUE;
+	int len;
+
+	fprintf (file, "{");
+
+	while (*p != '\0') {
+		const char *eq;
+
+		while (*p == ' ')
+			p++;
+
+		if (*p == '\0')
+			break;
+
+		len = strcspn (p, " ");
+		eq = memchr (p, '=', len);
+
+		if (eq != NULL)
+			fprintf (file, "%s\"%.*s\": \"%.*s\"", first ? "" : ", ",
+					(int) (eq - p), p, (int) (len - (eq - p) - 1), eq + 1);
+		else
+			fprintf (file, "%s\"%.*s\": \"\"", first ? "" : ", ", len, p);
+
+		first = FALSE;
+		p += len;
+	}
+
+	fprintf (file, "}");
+}
+
+static int split_list (char *list, char **items)
+{
+	char *save = NULL;
+	char *item;
+	int count = 0;
+
+	for (item = strtok_r (list, ",", &save); item != NULL && count < BENCH_HARNESS_MAX_SWEEP;
+			item = strtok_r (NULL, ",", &save))
+		items[count++] = item;
+
+	return count;
+}
+
+int bench_harness_get_depths (BenchHarness *bench, VisVideoDepth *depths, const char *defaults)
+{
+	char *items[BENCH_HARNESS_MAX_SWEEP];
+	char *list;
+	int count = 0;
+	int n, i;
+
+	list = visual_strdup (bench->depths != NULL ? bench->depths : defaults);
+	n = split_list (list, items);
+
+	for (i = 0; i < n; i++) {
+		VisVideoDepth depth = visual_video_depth_enum_from_value (atoi (items[i]));
+
+		if (visual_video_depth_is_sane (depth) && depth != VISUAL_VIDEO_DEPTH_NONE)
+			depths[count++] = depth;
+		else
+			fprintf (stderr, "Skipping unknown depth '%s'\n", items[i]);
+	}
+
+	visual_mem_free (list);
+
+	return count;
+}
+
+int bench_harness_get_sizes (BenchHarness *bench, int *widths, int *heights, const char *defaults)
+{
+	char *items[BENCH_HARNESS_MAX_SWEEP];
+	char *list;
+	int count = 0;
+	int n, i;
+
+	list = visual_strdup (bench->sizes != NULL ? bench->sizes : defaults);
+	n = split_list (list, items);
+
+	for (i = 0; i < n; i++) {
+		if (sscanf (items[i], "%dx%d", &widths[count], &heights[count]) == 2 &&
+				widths[count] > 0 && heights[count] > 0)
+			count++;
+		else
+			fprintf (stderr, "Skipping malformed size '%s'\n", items[i]);
+	}
+
+	visual_mem_free (list);
+
+	return count;
+}
+
+/* "all" walks the registry with the next function, the names stay valid for the
+ * lifetime of the program */
+int bench_harness_get_plugins (BenchHarness *bench, const char **names, const char *defaults,
+		const char *(*next) (const char *name))
+{
+	char *items[BENCH_HARNESS_MAX_SWEEP];
+	const char *name = NULL;
+	char *list;
+	int count = 0;
+	int n, i;
+
+	list = visual_strdup (bench->plugins != NULL ? bench->plugins : defaults);
+
+	if (strcmp (list, "all") == 0 && next != NULL) {
+		while ((name = next (name)) != NULL && count < BENCH_HARNESS_MAX_SWEEP)
+			names[count++] = name;
+
+		visual_mem_free (list);
+
+		return count;
+	}
+
+	n = split_list (list, items);
+
+	for (i = 0; i < n; i++)
+		names[count++] = items[i];
+
+	return count;
+}
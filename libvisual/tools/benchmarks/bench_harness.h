@@ -0,0 +1,90 @@
+#ifndef _BENCH_HARNESS_H
+#define _BENCH_HARNESS_H
+
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+
+/*
+ * Shared timing harness for the benchmarks. Every case runs a number of untimed
+ * warmup repetitions followed by the timed ones, a repetition calls the case function
+ * a fixed number of iterations. The per iteration times are reported as min, median
+ * and 99th percentile, as text, JSON or CSV. Cases that move a known amount of
+ * data per iteration can also report a throughput, see bench_harness_set_throughput().
+ *
+ * The common options are parsed and removed from argv by bench_harness_init(),
+ * see bench_harness_usage() for the list.
+ *
+ * The video benches check their accelerated kernels before timing them: the same
+ * random inputs go through the plain C kernels and through every other impl, into
+ * destinations with padded rows, and the results have to match byte for byte,
+ * padding included, see bench_harness_check_impl().
+ */
+
+#define BENCH_HARNESS_MAX_SWEEP		32
+
+/* Rows are padded by this many bytes in the checks, a multiple of every pixel size */
+#define BENCH_HARNESS_CHECK_PADDING	12
+
+typedef enum {
+	BENCH_OUTPUT_TEXT,
+	BENCH_OUTPUT_JSON,
+	BENCH_OUTPUT_CSV
+} BenchOutput;
+
+typedef void (*BenchFunc)(void *priv);
+
+/*
+ * Selects the kernels of an impl level, FALSE when the CPU lacks them. Level 0 is the
+ * plain C reference, the MMX kernels stay off at every level since they round
+ * differently from it.
+ */
+typedef int (*BenchImplFunc)(int impl);
+
+typedef struct {
+	const char	*name;
+	int		 warmup;
+	int		 repetitions;
+	int		 iterations;
+	BenchOutput	 output;
+	FILE		*file;
+	int		 records;
+
+	/* Units handled per iteration for the next runs, 0 to leave out the throughput */
+	double		 units;
+	const char	*unit_name;
+
+	/* Sweep lists as given on the command line, NULL for the bench defaults */
+	const char	*depths;
+	const char	*sizes;
+	const char	*plugins;
+} BenchHarness;
+
+typedef struct {
+	double		 min;		/* Microseconds per iteration */
+	double		 median;
+	double		 p99;
+	double		 mean;
+	uint64_t	 cycles;	/* Median TSC cycles per iteration, 0 without a TSC */
+	double		 throughput;	/* Millions of units per second at the median, 0 when not set */
+} BenchResult;
+
+int bench_harness_init (BenchHarness *bench, const char *name, int iterations, int *argc, char ***argv);
+void bench_harness_usage (BenchHarness *bench, const char *args);
+int bench_harness_run (BenchHarness *bench, const char *params, BenchFunc func, void *priv, BenchResult *result);
+int bench_harness_finish (BenchHarness *bench);
+
+void bench_harness_set_throughput (BenchHarness *bench, double units, const char *unit_name);
+int bench_harness_run_impls (BenchHarness *bench, const char *params, const char **impl_names, int nimpls,
+		BenchImplFunc set_impl, BenchFunc func, void *priv);
+
+VisVideo *bench_harness_video (VisVideoDepth depth, int width, int height, int padding);
+int bench_harness_check (VisVideo **dest, BenchFunc reference, BenchFunc func, void *priv);
+int bench_harness_check_impl (VisVideo **dest, BenchFunc func, void *priv, BenchImplFunc set_impl, int impl);
+
+int bench_harness_get_depths (BenchHarness *bench, VisVideoDepth *depths, const char *defaults);
+int bench_harness_get_sizes (BenchHarness *bench, int *widths, int *heights, const char *defaults);
+int bench_harness_get_plugins (BenchHarness *bench, const char **names, const char *defaults,
+		const char *(*next) (const char *name));
+
+#endif /* _BENCH_HARNESS_H */
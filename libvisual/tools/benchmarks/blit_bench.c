@@ -1,374 +1,431 @@
-#include <unistd.h>
-#include <stdlib.h>
-
-#include <SDL/SDL.h>
-
 #include <libvisual/libvisual.h>
 
-
-SDL_Surface *screen;
-SDL_Color colors[256];
-unsigned char *scrbuf;
-int bpp;
-
-VisActor *actor;
-VisVideo *actvid;
-VisVideo *video;
-VisVideo *video32;
-VisVideo *sdlvid;
-VisVideo *scalevid;
-VisPalette *pal;
-VisInput *input;
-
-void sdl_fullscreen_toggle ();
-void sdl_fullscreen_xy (int *x, int *y);
-int sdl_fullscreen_set (int mode);
-void sdl_size_request (int width, int height);
-void sdl_init (int width, int height);
-void sdl_create (int width, int height);
-void sdl_draw_buf ();
-
-/* Fullscreen stuff */
-void sdl_fullscreen_toggle ()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+#define IMAGE_WIDTH	320
+#define IMAGE_HEIGHT	240
+#define ALPHA		128
+
+/*
+ * Composites a frame the way the old interactive SDL version did: the image is
+ * converted to 32 bits, gets a constant alpha and is scaled, then the actor output
+ * and the scaled image are blitted onto the screen buffer. Without an actor the
+ * screen is blitted from a cleared frame.
+ *
+ * The compositors are checked against their C kernels first and then timed on
+ * their own, a full frame overlay per run.
+ */
+
+/* Every level enables the features of the ones before it */
+typedef enum {
+	COMPOSITE_IMPL_C,
+	COMPOSITE_IMPL_SSE2,
+	COMPOSITE_IMPL_AVX2,
+	COMPOSITE_IMPL_NEON,
+	COMPOSITE_IMPL_LAST
+} CompositeImpl;
+
+typedef struct {
+	VisActor		*actor;
+	VisAudio		*audio;
+	VisVideo		*actvid;
+	VisVideo		*image;
+	VisVideo		*video32;
+	VisVideo		*scalevid;
+	VisVideo		*screen;
+	VisVideoScaleMethod	 interpol;
+} BlitBench;
+
+typedef struct {
+	VisVideo		*dest;
+	VisVideo		*src;
+} CompositeBench;
+
+static const char *interpol_names[] = {
+	[VISUAL_VIDEO_SCALE_NEAREST]	= "nearest",
+	[VISUAL_VIDEO_SCALE_BILINEAR]	= "bilinear"
+};
+
+static const char *impl_names[] = {
+	[COMPOSITE_IMPL_C]	= "c",
+	[COMPOSITE_IMPL_SSE2]	= "sse2",
+	[COMPOSITE_IMPL_AVX2]	= "avx2",
+	[COMPOSITE_IMPL_NEON]	= "neon"
+};
+
+static const VisVideoCompositeType composite_types[] = {
+	VISUAL_VIDEO_COMPOSITE_TYPE_SRC,
+	VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED,
+	VISUAL_VIDEO_COMPOSITE_TYPE_COLORKEY,
+	VISUAL_VIDEO_COMPOSITE_TYPE_SURFACE,
+	VISUAL_VIDEO_COMPOSITE_TYPE_SURFACECOLORKEY
+};
+
+static const char *composite_names[] = {
+	[VISUAL_VIDEO_COMPOSITE_TYPE_SRC]		= "alphasrc",
+	[VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED]	= "premultiplied",
+	[VISUAL_VIDEO_COMPOSITE_TYPE_COLORKEY]		= "colorkey",
+	[VISUAL_VIDEO_COMPOSITE_TYPE_SURFACE]		= "surface",
+	[VISUAL_VIDEO_COMPOSITE_TYPE_SURFACECOLORKEY]	= "surfacecolorkey"
+};
+
+static const VisVideoDepth check_depths[] = {
+	VISUAL_VIDEO_DEPTH_8BIT, VISUAL_VIDEO_DEPTH_16BIT, VISUAL_VIDEO_DEPTH_24BIT, VISUAL_VIDEO_DEPTH_32BIT
+};
+
+/* Below, at and past every vector width, for the tails */
+static const int check_widths[] = { 1, 3, 7, 8, 17, 33, 67, 131 };
+
+static int set_impl (int impl)
 {
-	static int fullscreen = 0;
+	visual_cpu_set_mmx (FALSE);
+	visual_cpu_set_sse2 (FALSE);
+	visual_cpu_set_avx2 (FALSE);
+	visual_cpu_set_neon (FALSE);
 
-	fullscreen = 1 - fullscreen;
+	switch (impl) {
+		case COMPOSITE_IMPL_AVX2:
+			if (visual_cpu_set_avx2 (TRUE) != VISUAL_OK)
+				return FALSE;
 
-	sdl_fullscreen_set (fullscreen);
-}
-
-void sdl_fullscreen_xy (int *x, int *y)
-{
-	SDL_Rect **modelist;
-	int i;
-	int width = screen->w;
-	int height = screen->h;
+			/* Fall through */
+		case COMPOSITE_IMPL_SSE2:
+			if (visual_cpu_set_sse2 (TRUE) != VISUAL_OK)
+				return FALSE;
 
-	modelist = SDL_ListModes (NULL, SDL_FULLSCREEN);
+			break;
 
-	if (modelist == NULL) {
-		*x = width;
-		*y = height;
-	}
+		case COMPOSITE_IMPL_NEON:
+			if (visual_cpu_set_neon (TRUE) != VISUAL_OK)
+				return FALSE;
 
-	/* Is the window bigger than the highest available resolution ? */
-	if (modelist[0]->w <= width || modelist[0]->h <= height) {
-		*x = modelist[0]->w;
-		*y = modelist[0]->h;
+			break;
 
-		return;
+		default:
+			break;
 	}
 
-	for(i = 0; modelist[i]; ++i) {
-		if (modelist[i]->w >= width && modelist[i]->h >= height) {
-			*x = modelist[i]->w;
-			*y = modelist[i]->h;
-		}
-	}
+	visual_video_composite_initialize ();
+
+	return TRUE;
 }
 
-int sdl_fullscreen_set (int mode)
+static void restore_impl ()
 {
-	static int oldw;
-	static int oldh;
-	int screen_fullscreen = 0;
-	int tempx;
-	int tempy;
-
-	switch (mode) {
-		case 0:
-			if ((screen->flags & SDL_FULLSCREEN) != 0) {
-				SDL_WM_ToggleFullScreen (screen);
-				SDL_ShowCursor (SDL_ENABLE);
-
-				sdl_size_request (oldw, oldh);
-				screen_fullscreen = 0;
-
-				return 0;
-			}
-			break;
+	visual_cpu_set_mmx (TRUE);
+	visual_cpu_set_sse2 (TRUE);
+	visual_cpu_set_avx2 (TRUE);
+	visual_cpu_set_neon (TRUE);
 
-		case 1:
-			if ((screen->flags & SDL_FULLSCREEN) == 0) {
-				if (screen_fullscreen == 0)
-				{
-					oldw = screen->w;
-					oldh = screen->h;
-				}
-
-				if (screen_fullscreen == 1)
-					SDL_WM_ToggleFullScreen (screen);
-
-				sdl_fullscreen_xy (&tempx, &tempy);
-
-				sdl_size_request (tempx, tempy);
+	visual_video_composite_initialize ();
+}
 
-				if (SDL_WM_ToggleFullScreen (screen)) {
-					SDL_ShowCursor (SDL_DISABLE);
-					screen_fullscreen = 1;
+static void composite_bench_run (void *priv)
+{
+	CompositeBench *cb = priv;
 
-					return 0;
-				} else {
-					sdl_size_request (oldw, oldh);
+	visual_video_blit_overlay (cb->dest, cb->src, 0, 0, TRUE);
+}
 
-					screen_fullscreen = 0;
+/* A random source with a quarter of its pixels keyed and the settings of every type */
+static VisVideo *composite_bench_source (VisVideoCompositeType type, VisVideoDepth depth, int width, int height,
+		int padding, VisPalette *pal)
+{
+	VisVideo *src = bench_harness_video (depth, width, height, padding);
+	VisColor key;
+	uint8_t *pixels;
+	uint32_t key32;
+	uint16_t key16;
+	int x, y;
+
+	visual_color_set (&key, 0x40, 0x80, 0xc0);
+	key.a = 0xff;
+
+	if (depth == VISUAL_VIDEO_DEPTH_8BIT) {
+		visual_video_set_palette (src, pal);
+		visual_color_copy (&key, &pal->colors[37]);
+	}
 
-					return -1;
-				}
+	visual_video_composite_set_type (src, type);
+	visual_video_composite_set_colorkey (src, &key);
+	visual_video_composite_set_surface (src, ALPHA - 27);
+
+	key32 = visual_color_to_uint32 (&key);
+	key16 = visual_color_to_uint16 (&key);
+
+	for (y = 0; y < height; y++) {
+		pixels = (uint8_t *) visual_video_get_pixels (src) + y * src->pitch;
+
+		for (x = 0; x < width; x++) {
+			if ((rand () & 3) != 0)
+				continue;
+
+			if (depth == VISUAL_VIDEO_DEPTH_8BIT) {
+				pixels[x] = visual_palette_find_color (pal, &key);
+			} else if (depth == VISUAL_VIDEO_DEPTH_16BIT) {
+				((uint16_t *) pixels)[x] = key16;
+			} else if (depth == VISUAL_VIDEO_DEPTH_24BIT) {
+				pixels[x * 3] = key.b;
+				pixels[x * 3 + 1] = key.g;
+				pixels[x * 3 + 2] = key.r;
+			} else {
+				((uint32_t *) pixels)[x] = key32;
 			}
-			break;
-
-		default:
-			break;
+		}
 	}
+
+	return src;
 }
 
-/* Sdl stuff */
-void sdl_size_request (int width, int height)
+static int check_composite (CompositeImpl impl, VisVideoCompositeType type, VisVideoDepth depth, int width,
+		VisPalette *pal)
 {
-	SDL_FreeSurface (screen);
+	CompositeBench cb;
+	int same;
 
-	sdl_create (width, height);
+	cb.src = composite_bench_source (type, depth, width, 5, BENCH_HARNESS_CHECK_PADDING, pal);
+	cb.dest = bench_harness_video (depth, width, 5, BENCH_HARNESS_CHECK_PADDING);
 
-	free (scrbuf);
-	scrbuf = malloc (screen->pitch * screen->h);
-	memset (scrbuf, 0, screen->pitch * screen->h);
-}
+	same = bench_harness_check_impl (&cb.dest, composite_bench_run, &cb, set_impl, impl);
 
-void sdl_init (int width, int height)
-{
-	if (SDL_Init (SDL_INIT_VIDEO) < 0)
-	{
-		fprintf (stderr, "Unable to init SDL VIDEO: %s\n", SDL_GetError ());
-		exit (0);
+	if (same == FALSE) {
+		fprintf (stderr, "Blit bench %s: %s depth=%d width=%d differs from c\n",
+				impl_names[impl], composite_names[type], visual_video_depth_value_from_enum (depth),
+				width);
 	}
 
-	sdl_create (width, height);
+	visual_object_unref (VISUAL_OBJECT (cb.dest));
+	visual_object_unref (VISUAL_OBJECT (cb.src));
+
+	return same;
 }
 
-void sdl_create (int width, int height)
+/* Every composite type and depth at every check width, the source alpha ones are 32 bits only */
+static int check_impl (CompositeImpl impl, VisPalette *pal)
 {
-	const SDL_VideoInfo *videoinfo;
-	int videoflags;
+	VisVideoCompositeType type;
+	int c, d, w;
 
-	screen = SDL_SetVideoMode (width, height, bpp * 8, 0);
-}
+	for (c = 0; c < (int) (sizeof (composite_types) / sizeof (composite_types[0])); c++) {
+		type = composite_types[c];
 
-void sdl_draw_buf ()
-{
-	unsigned char *str = (unsigned char *) screen->pixels;
-	int i;
+		for (d = 0; d < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d++) {
+			if ((type == VISUAL_VIDEO_COMPOSITE_TYPE_SRC || type == VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED) &&
+					check_depths[d] != VISUAL_VIDEO_DEPTH_32BIT)
+				continue;
 
-	memcpy (str, scrbuf, screen->pitch * screen->h);
+			for (w = 0; w < (int) (sizeof (check_widths) / sizeof (check_widths[0])); w++) {
+				if (check_composite (impl, type, check_depths[d], check_widths[w], pal) == FALSE)
+					return FALSE;
+			}
+		}
+	}
 
-	memset (scrbuf, 0, screen->pitch * screen->h);
-	SDL_UpdateRect (screen, 0, 0, screen->w, screen->h);
+	return TRUE;
 }
 
-/* Main stuff */
-int main (int argc, char *argv[])
+/* Every composite type and impl over a full frame of the given depth and size */
+static void composite_bench_sweep (BenchHarness *bench, VisVideoDepth depth, int width, int height, VisPalette *pal)
 {
-	int width = 1000, height = 600;
-	int i, j;
-	int freeze = 0;
-	int depthflag = 0;
-	int alpha = 128;
-	int xoff = 0, yoff = -90;
-	int sxsize = 1000;
-	int sysize = 700;
-	int interpol = VISUAL_VIDEO_SCALE_NEAREST;
-        int frames = 0;
-	VisTime start, end;
-
-	bpp = 4;
-	sdl_init (width, height);
-
-	scrbuf = malloc (screen->pitch * screen->h);
-	memset (scrbuf, 0, screen->pitch * screen->h);
-
-	SDL_Event event;
-
-	visual_init (&argc, &argv);
-
-	if (argc > 1)
-		actor = visual_actor_new (argv[1]);
-	else
-		actor = visual_actor_new ("G-Force");
-
-	visual_actor_realize (actor);
-
-	video = visual_video_new ();
+	CompositeBench cb;
+	VisVideoCompositeType type;
+	char params[256];
+	int c;
 
-	if (argc > 2)
-		video = visual_bitmap_load_new_video (argv[2]);
-	else
-		video = visual_bitmap_load_new_video ("alphachantest.bmp");
+	bench_harness_set_throughput (bench, width * height, "Pixels");
 
-	actvid = visual_video_new ();
-	visual_actor_set_video (actor, actvid);
-	visual_video_set_depth (actvid, visual_video_depth_get_highest (visual_actor_get_supported_depth (actor)));
-	visual_video_set_dimension (actvid, width, height);
-	visual_video_allocate_buffer (actvid);
+	for (c = 0; c < (int) (sizeof (composite_types) / sizeof (composite_types[0])); c++) {
+		type = composite_types[c];
 
-	visual_actor_video_negotiate (actor, 0, FALSE, FALSE);
+		if ((type == VISUAL_VIDEO_COMPOSITE_TYPE_SRC || type == VISUAL_VIDEO_COMPOSITE_TYPE_SRC_PREMULTIPLIED) &&
+				depth != VISUAL_VIDEO_DEPTH_32BIT)
+			continue;
 
-	video32 = visual_video_new ();
-	visual_video_set_depth (video32, VISUAL_VIDEO_DEPTH_32BIT);
-	visual_video_set_dimension (video32, video->width, video->height);
-	visual_video_allocate_buffer (video32);
+		cb.dest = bench_harness_video (depth, width, height, 0);
+		cb.src = composite_bench_source (type, depth, width, height, 0, pal);
 
-	scalevid = visual_video_new ();
-	visual_video_set_depth (scalevid, VISUAL_VIDEO_DEPTH_32BIT);
-	visual_video_set_dimension (scalevid, sxsize, sysize);
-	visual_video_allocate_buffer (scalevid);
+		snprintf (params, sizeof (params), "composite=%s depth=%d size=%dx%d",
+				composite_names[type], visual_video_depth_value_from_enum (depth), width, height);
 
-	sdlvid = visual_video_new ();
-	visual_video_set_depth (sdlvid, VISUAL_VIDEO_DEPTH_32BIT);
-	visual_video_set_dimension (sdlvid, screen->w, screen->h);
-	visual_video_set_pitch (sdlvid, screen->pitch);
-	visual_video_set_buffer (sdlvid, scrbuf);
+		bench_harness_run_impls (bench, params, impl_names, COMPOSITE_IMPL_LAST, set_impl,
+				composite_bench_run, &cb);
 
-	input = visual_input_new ("alsa");
-	visual_input_realize (input);
+		visual_object_unref (VISUAL_OBJECT (cb.src));
+		visual_object_unref (VISUAL_OBJECT (cb.dest));
+	}
 
-	SDL_EnableKeyRepeat (SDL_DEFAULT_REPEAT_DELAY, SDL_DEFAULT_REPEAT_INTERVAL);
+	restore_impl ();
+}
 
-	visual_time_get (&start);
+static void blit_bench_run (void *priv)
+{
+	BlitBench *bb = priv;
 
-	while (1) {
-		visual_input_run (input);
-		visual_actor_run (actor, input->audio);
+	if (bb->actor != NULL)
+		visual_actor_run (bb->actor, bb->audio);
 
-		/* place on screen */
-//		visual_video_blit_overlay (sdlvid, video, 0, 0, FALSE);
+	visual_video_depth_transform (bb->video32, bb->image);
+	visual_video_fill_alpha (bb->video32, ALPHA);
+	visual_video_scale (bb->scalevid, bb->video32, bb->interpol);
 
-		if (sxsize < 0)
-			sxsize = 0;
+	visual_video_blit_overlay (bb->screen, bb->actvid, 0, 0, FALSE);
+	visual_video_blit_overlay (bb->screen, bb->scalevid, bb->screen->width / 10, bb->screen->height / 10, TRUE);
+}
 
-		if (sysize < 0)
-			sysize = 0;
+static VisVideo *blit_bench_video (VisVideoDepth depth, int width, int height)
+{
+	VisVideo *video = visual_video_new ();
 
-		if (sxsize != scalevid->width || sysize != scalevid->height) {
-			visual_video_set_dimension (scalevid, sxsize, sysize);
-			visual_video_allocate_buffer (scalevid);
-		}
+	visual_video_set_depth (video, depth);
+	visual_video_set_dimension (video, width, height);
+	visual_video_allocate_buffer (video);
 
-		visual_video_depth_transform (video32, video);
+	return video;
+}
 
+/* A gradient stands in when no bitmap is given */
+static VisVideo *blit_bench_image (const char *filename)
+{
+	VisVideo *video;
+	uint8_t *pixels;
+	int x, y;
 
-//		visual_video_alpha_fill (sdlvid, 0);
+	if (filename != NULL)
+		return visual_bitmap_load_new_video (filename);
 
-		visual_video_alpha_fill (video32, alpha);
-//		visual_video_alpha_color (video32, 0, 0, 0, 255);
+	video = blit_bench_video (VISUAL_VIDEO_DEPTH_24BIT, IMAGE_WIDTH, IMAGE_HEIGHT);
 
-		visual_video_scale (scalevid, video32, interpol);
+	for (y = 0; y < video->height; y++) {
+		pixels = (uint8_t *) visual_video_get_pixels (video) + y * video->pitch;
 
+		for (x = 0; x < video->width; x++) {
+			*pixels++ = x;
+			*pixels++ = y;
+			*pixels++ = x ^ y;
+		}
+	}
 
+	return video;
+}
 
-		visual_video_blit_overlay (sdlvid, actvid, 0, 0, FALSE);
-		visual_video_blit_overlay (sdlvid, scalevid, xoff, yoff, TRUE);
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	BlitBench bb;
+	const char *actors[BENCH_HARNESS_MAX_SWEEP];
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int nactors, ndepths, nsizes;
+	VisPalette *pal;
+	CompositeImpl impl;
+	char params[256];
+	int a, d, s;
 
-		sdl_draw_buf ();
-		frames++;
+	visual_init (&argc, &argv);
 
-		while (SDL_PollEvent (&event)) {
-			switch (event.type) {
-				case SDL_KEYDOWN:
-					switch (event.key.keysym.sym) {
-						case SDLK_F11:
-							SDL_WM_ToggleFullScreen (screen);
-							break;
+	if (bench_harness_init (&bench, "blit_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, "[bitmap]");
 
-						case SDLK_UP:
-							yoff -= 10;
+		return EXIT_FAILURE;
+	}
 
-							break;
+	bb.image = blit_bench_image (argc > 1 ? argv[1] : NULL);
 
-						case SDLK_DOWN:
-							yoff += 10;
+	if (bb.image == NULL) {
+		fprintf (stderr, "Can't load bitmap '%s'\n", argv[1]);
 
-							break;
+		return EXIT_FAILURE;
+	}
 
-						case SDLK_LEFT:
-							xoff -= 10;
+	nactors = bench_harness_get_plugins (&bench, actors, "none", visual_actor_get_next_by_name_nogl);
+	ndepths = bench_harness_get_depths (&bench, depths, "32");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "1000x600");
 
-							break;
+	pal = visual_palette_new (256);
+	visual_palette_fill_color_cube (pal);
 
-						case SDLK_RIGHT:
-							xoff += 10;
+	/* The checks run serially, the bands would hide nothing but the timing */
+	visual_video_set_thread_count (1);
 
-							break;
+	for (impl = COMPOSITE_IMPL_SSE2; impl < COMPOSITE_IMPL_LAST; impl++) {
+		if (set_impl (impl) == TRUE && check_impl (impl, pal) == FALSE)
+			return EXIT_FAILURE;
+	}
 
-						case SDLK_q:
-							sysize -= 10;
+	restore_impl ();
 
-							break;
+	visual_video_set_thread_count (0);
 
-						case SDLK_a:
-							sysize += 10;
+	for (d = 0; d < ndepths; d++) {
+		for (s = 0; s < nsizes; s++)
+			composite_bench_sweep (&bench, depths[d], widths[s], heights[s], pal);
+	}
 
-							break;
+	/* The scenes below are timed per frame */
+	bench_harness_set_throughput (&bench, 0, NULL);
 
-						case SDLK_z:
-							sxsize -= 10;
+	bb.audio = visual_audio_new ();
+	visual_audio_analyze (bb.audio);
 
-							break;
+	bb.video32 = blit_bench_video (VISUAL_VIDEO_DEPTH_32BIT, bb.image->width, bb.image->height);
 
-						case SDLK_x:
-							sxsize += 10;
+	for (a = 0; a < nactors; a++) {
+		bb.actor = NULL;
 
-							break;
+		if (strcmp (actors[a], "none") != 0) {
+			bb.actor = visual_actor_new (actors[a]);
 
-						case SDLK_i:
-							if (interpol == VISUAL_VIDEO_SCALE_NEAREST)
-								interpol = VISUAL_VIDEO_SCALE_BILINEAR;
-							else
-								interpol = VISUAL_VIDEO_SCALE_NEAREST;
+			if (bb.actor == NULL) {
+				fprintf (stderr, "Can't load actor '%s'\n", actors[a]);
 
-							break;
+				continue;
+			}
 
-						case SDLK_o:
-							alpha -= 8;
-							if (alpha < 0)
-								alpha = 0;
+			visual_actor_realize (bb.actor);
+		}
 
-							break;
+		for (s = 0; s < nsizes; s++) {
+			bb.screen = blit_bench_video (VISUAL_VIDEO_DEPTH_32BIT, widths[s], heights[s]);
+			bb.actvid = blit_bench_video (VISUAL_VIDEO_DEPTH_32BIT, widths[s], heights[s]);
+			bb.scalevid = blit_bench_video (VISUAL_VIDEO_DEPTH_32BIT, widths[s] * 4 / 5, heights[s] * 4 / 5);
 
-						case SDLK_p:
-							alpha += 8;
-							if (alpha > 255)
-								alpha = 255;
+			if (bb.actor != NULL) {
+				visual_actor_set_video (bb.actor, bb.actvid);
+				visual_actor_video_negotiate (bb.actor, 0, FALSE, FALSE);
+			}
 
-							break;
+			for (bb.interpol = VISUAL_VIDEO_SCALE_NEAREST; bb.interpol <= VISUAL_VIDEO_SCALE_BILINEAR;
+					bb.interpol++) {
+				snprintf (params, sizeof (params), "actor=%s size=%dx%d image=%dx%d interpol=%s",
+						actors[a], widths[s], heights[s], bb.image->width, bb.image->height,
+						interpol_names[bb.interpol]);
 
-						case SDLK_ESCAPE:
-							goto out;
-							break;
-					}
-					break;
+				bench_harness_run (&bench, params, blit_bench_run, &bb, NULL);
+			}
 
-				case SDL_VIDEORESIZE:
-					sdl_size_request (event.resize.w, event.resize.h);
-					break;
+			if (bb.actor != NULL)
+				visual_actor_set_video (bb.actor, NULL);
 
-				case SDL_QUIT:
-					goto out;
-					break;
-			}
+			visual_object_unref (VISUAL_OBJECT (bb.scalevid));
+			visual_object_unref (VISUAL_OBJECT (bb.actvid));
+			visual_object_unref (VISUAL_OBJECT (bb.screen));
 		}
-	}
-out:
-	visual_time_get (&end);
-
-	VisTime diff;
 
-	visual_time_difference (&diff, &start, &end);
+		if (bb.actor != NULL)
+			visual_object_unref (VISUAL_OBJECT (bb.actor));
+	}
 
+	visual_object_unref (VISUAL_OBJECT (bb.video32));
+	visual_object_unref (VISUAL_OBJECT (bb.image));
+	visual_object_unref (VISUAL_OBJECT (bb.audio));
+	visual_object_unref (VISUAL_OBJECT (pal));
 
-	printf ("Ran: %d:%d, drawn %d frames\n",
-			diff.tv_sec, diff.tv_usec, frames);
+	bench_harness_finish (&bench);
 
-	SDL_Quit ();
+	return EXIT_SUCCESS;
 }
-
@@ -4,44 +4,278 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define TIMES	500
+#include "bench_harness.h"
 
-int main (int argc, char **argv)
+#define ITERATIONS	10
+
+/* Every level enables the features of the ones before it */
+typedef enum {
+	CONVERT_IMPL_C,
+	CONVERT_IMPL_SSE2,
+	CONVERT_IMPL_SSSE3,
+	CONVERT_IMPL_AVX2,
+	CONVERT_IMPL_NEON,
+	CONVERT_IMPL_LAST
+} ConvertImpl;
+
+typedef struct {
+	VisVideo	*dest;
+	VisVideo	*src;
+	int		 flip;
+} DepthBench;
+
+static const char *impl_names[] = {
+	[CONVERT_IMPL_C]	= "c",
+	[CONVERT_IMPL_SSE2]	= "sse2",
+	[CONVERT_IMPL_SSSE3]	= "ssse3",
+	[CONVERT_IMPL_AVX2]	= "avx2",
+	[CONVERT_IMPL_NEON]	= "neon"
+};
+
+static const VisVideoDepth check_depths[] = {
+	VISUAL_VIDEO_DEPTH_8BIT, VISUAL_VIDEO_DEPTH_16BIT, VISUAL_VIDEO_DEPTH_24BIT, VISUAL_VIDEO_DEPTH_32BIT
+};
+
+/* Odd widths to cover the heads and tails of the vector kernels */
+static const int check_widths[] = { 1, 3, 7, 8, 15, 17, 18, 33, 131, 640 };
+
+static int set_impl (int impl)
 {
-	char *d1, *d2;
-	VisVideo *dest, *src;
-	VisVideoDepth depth1, depth2;
+	visual_cpu_set_sse2 (FALSE);
+	visual_cpu_set_ssse3 (FALSE);
+	visual_cpu_set_avx2 (FALSE);
+	visual_cpu_set_neon (FALSE);
+
+	switch (impl) {
+		case CONVERT_IMPL_AVX2:
+			if (visual_cpu_set_avx2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			/* Fall through */
+		case CONVERT_IMPL_SSSE3:
+			if (visual_cpu_set_ssse3 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			/* Fall through */
+		case CONVERT_IMPL_SSE2:
+			if (visual_cpu_set_sse2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		case CONVERT_IMPL_NEON:
+			if (visual_cpu_set_neon (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		default:
+			break;
+	}
+
+	visual_video_convert_initialize ();
+
+	return TRUE;
+}
+
+static void restore_impl ()
+{
+	visual_cpu_set_sse2 (TRUE);
+	visual_cpu_set_ssse3 (TRUE);
+	visual_cpu_set_avx2 (TRUE);
+	visual_cpu_set_neon (TRUE);
+
+	visual_video_convert_initialize ();
+}
+
+static void depth_bench_run (void *priv)
+{
+	DepthBench *db = priv;
+
+	if (db->flip == TRUE)
+		visual_video_flip_pixel_bytes (db->dest, db->src);
+	else
+		visual_video_depth_transform (db->dest, db->src);
+}
+
+/* Random pixels on a random palette */
+static VisVideo *depth_bench_video (VisVideoDepth depth, int width, int height, int padding)
+{
+	VisVideo *video = bench_harness_video (depth, width, height, padding);
 	int i;
 
-	visual_init (&argc, &argv);
+	visual_video_set_palette (video, visual_palette_new (256));
 
-	if (argc > 2) {
-		d1 = argv[1];
-		d2 = argv[2];
-	} else {
-		d1 = visual_strdup("32");
-		d2 = visual_strdup("16");
+	for (i = 0; i < 256; i++) {
+		video->pal->colors[i].r = rand ();
+		video->pal->colors[i].g = rand ();
+		video->pal->colors[i].b = rand ();
 	}
 
-	depth1 = visual_video_depth_enum_from_value(atoi(d1));
-	depth2 = visual_video_depth_enum_from_value(atoi(d2));
+	return video;
+}
+
+static void depth_bench_free (VisVideo *video)
+{
+	visual_object_unref (VISUAL_OBJECT (video->pal));
+	visual_object_unref (VISUAL_OBJECT (video));
+}
+
+static int check_pair (ConvertImpl impl, VisVideoDepth ddepth, VisVideoDepth sdepth, int width)
+{
+	DepthBench db;
+	int same;
+
+	db.src = depth_bench_video (sdepth, width, 3, BENCH_HARNESS_CHECK_PADDING);
+	db.dest = depth_bench_video (ddepth, width, 3, BENCH_HARNESS_CHECK_PADDING);
+	db.flip = ddepth == sdepth;
 
-	dest = visual_video_new ();
-	visual_video_set_depth (dest, depth1);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_set_palette (dest, visual_palette_new (256));
-	visual_video_allocate_buffer (dest);
+	same = bench_harness_check_impl (&db.dest, depth_bench_run, &db, set_impl, impl);
 
-	src = visual_video_new ();
-	visual_video_set_depth (src, depth2);
-	visual_video_set_dimension (src, 640, 400);
-	visual_video_set_palette (src, visual_palette_new (256));
-	visual_video_allocate_buffer (src);
+	if (same == FALSE) {
+		fprintf (stderr, "Depth transform bench %s: dest=%d src=%d width=%d differs from c\n",
+				impl_names[impl], visual_video_depth_value_from_enum (ddepth),
+				visual_video_depth_value_from_enum (sdepth), width);
+	}
+
+	depth_bench_free (db.dest);
+	depth_bench_free (db.src);
+
+	return same;
+}
+
+/* Every pair and flip at every check width */
+static int check_impl (ConvertImpl impl)
+{
+	int d1, d2, w;
+
+	for (d1 = 0; d1 < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d1++) {
+		for (d2 = 0; d2 < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d2++) {
+			if (check_depths[d1] == VISUAL_VIDEO_DEPTH_8BIT && check_depths[d2] == VISUAL_VIDEO_DEPTH_8BIT)
+				continue;
+
+			for (w = 0; w < (int) (sizeof (check_widths) / sizeof (check_widths[0])); w++) {
+				if (check_pair (impl, check_depths[d1], check_depths[d2], check_widths[w]) == FALSE)
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* Every 16 bits source pixel has to map on the palette color nearest to the center of its cell */
+static int check_quantizer ()
+{
+	VisVideo *src = depth_bench_video (VISUAL_VIDEO_DEPTH_16BIT, 256, 256, 0);
+	VisVideo *dest = depth_bench_video (VISUAL_VIDEO_DEPTH_8BIT, 256, 256, 0);
+	uint16_t *pixels = visual_video_get_pixels (src);
+	uint8_t *indices = visual_video_get_pixels (dest);
+	VisColor color;
+	int pass, i;
+	int same = TRUE;
+
+	for (i = 0; i < 65536; i++)
+		pixels[i] = i;
+
+	/* Random colors and then a palette with duplicates, for the ties */
+	for (pass = 0; pass < 2 && same == TRUE; pass++) {
+		if (pass == 1) {
+			for (i = 0; i < 256; i++)
+				visual_color_copy (&dest->pal->colors[i], &dest->pal->colors[(i * 7) & 63]);
+		}
 
-	for (i = 0; i < TIMES; i++)
 		visual_video_depth_transform (dest, src);
 
-	printf ("Depth transformed %d times from %s to %s\n", TIMES, d1, d2);
+		for (i = 0; i < 65536; i++) {
+			color.r = ((i >> 11) << 3) + 4;
+			color.g = (((i >> 5) & 63) << 2) + 2;
+			color.b = ((i & 31) << 3) + 4;
+
+			if (indices[i] != visual_palette_find_nearest_color (dest->pal, &color)) {
+				fprintf (stderr, "Depth transform bench: pixel %04x maps on %d instead of %d\n",
+						i, indices[i], visual_palette_find_nearest_color (dest->pal, &color));
+
+				same = FALSE;
+				break;
+			}
+		}
+	}
+
+	depth_bench_free (dest);
+	depth_bench_free (src);
+
+	return same;
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	DepthBench db;
+	ConvertImpl impl;
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int ndepths, nsizes;
+	char params[256];
+	char pair[64];
+	int d1, d2, s;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "depth_transform_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, "[dest depth] [source depth]");
+
+		return EXIT_FAILURE;
+	}
+
+	if (check_quantizer () == FALSE)
+		return EXIT_FAILURE;
+
+	for (impl = CONVERT_IMPL_SSE2; impl < CONVERT_IMPL_LAST; impl++) {
+		if (set_impl (impl) == TRUE && check_impl (impl) == FALSE)
+			return EXIT_FAILURE;
+	}
+
+	/* The old positional arguments pick a single pair */
+	if (argc > 2 && bench.depths == NULL) {
+		snprintf (pair, sizeof (pair), "%s,%s", argv[1], argv[2]);
+		bench.depths = pair;
+	}
+
+	ndepths = bench_harness_get_depths (&bench, depths, "32,16");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "640x400");
+
+	/* Every ordered pair of depths in the list, equal depths time the byte flips */
+	for (d1 = 0; d1 < ndepths; d1++) {
+		for (d2 = 0; d2 < ndepths; d2++) {
+			db.flip = depths[d1] == depths[d2];
+
+			if (db.flip == TRUE && depths[d1] == VISUAL_VIDEO_DEPTH_8BIT)
+				continue;
+
+			for (s = 0; s < nsizes; s++) {
+				db.dest = depth_bench_video (depths[d1], widths[s], heights[s], 0);
+				db.src = depth_bench_video (depths[d2], widths[s], heights[s], 0);
+
+				bench_harness_set_throughput (&bench, widths[s] * heights[s], "Pixels");
+
+				snprintf (params, sizeof (params), "dest=%d src=%d%s size=%dx%d",
+						visual_video_depth_value_from_enum (depths[d1]),
+						visual_video_depth_value_from_enum (depths[d2]),
+						db.flip == TRUE ? " op=flip" : "", widths[s], heights[s]);
+
+				bench_harness_run_impls (&bench, params, impl_names, CONVERT_IMPL_LAST, set_impl,
+						depth_bench_run, &db);
+
+				depth_bench_free (db.src);
+				depth_bench_free (db.dest);
+			}
+		}
+	}
+
+	restore_impl ();
+
+	bench_harness_finish (&bench);
 
 	return EXIT_SUCCESS;
 }
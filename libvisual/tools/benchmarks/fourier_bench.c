@@ -0,0 +1,103 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	200
+#define MAX_SIZE	2048
+#define MAX_ERROR	1e-5
+
+static float input[MAX_SIZE];
+static float output[MAX_SIZE / 2];
+static float scratch[MAX_SIZE * 2];
+
+typedef struct {
+	VisDFTPlan	*plan;
+	int		 size;
+} FourierBench;
+
+/* Straight DFT in double precision, the reference for the FFT output */
+static double max_error (VisDFTPlan *plan, int size)
+{
+	double error = 0;
+	int i, j;
+
+	visual_dft_plan_perform (plan, output, size / 2, input, size, scratch);
+
+	for (i = 0; i < size / 2; i++) {
+		double re = 0;
+		double im = 0;
+		double mag;
+
+		for (j = 0; j < size; j++) {
+			re += input[j] * cos (-2.0 * VISUAL_MATH_PI * i * j / size);
+			im += input[j] * sin (-2.0 * VISUAL_MATH_PI * i * j / size);
+		}
+
+		mag = sqrt (re * re + im * im) / size;
+
+		if (fabs (mag - output[i]) > error)
+			error = fabs (mag - output[i]);
+	}
+
+	return error;
+}
+
+static void fourier_bench_run (void *priv)
+{
+	FourierBench *fb = priv;
+
+	visual_dft_plan_perform (fb->plan, output, fb->size / 2, input, fb->size, scratch);
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	FourierBench fb;
+	double error;
+	char params[64];
+	int simd, i;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "fourier_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < MAX_SIZE; i++)
+		input[i] = sinf (i * 0.3f) * 0.5f + cosf (i * 1.7f) * 0.25f + (rand () / (float) RAND_MAX - 0.5f) * 0.2f;
+
+	for (fb.size = 512; fb.size <= MAX_SIZE; fb.size *= 2) {
+		fb.plan = visual_dft_plan_get (fb.size);
+
+		/* Same plan with and without the SIMD butterflies */
+		for (simd = TRUE; simd >= FALSE; simd--) {
+			visual_cpu_set_sse (simd);
+			visual_cpu_set_neon (simd);
+
+			error = max_error (fb.plan, fb.size);
+			if (error > MAX_ERROR) {
+				fprintf (stderr, "Fourier bench size %d%s: max error %g exceeds %g\n",
+						fb.size, simd ? "" : " (no simd)", error, MAX_ERROR);
+
+				return EXIT_FAILURE;
+			}
+
+			snprintf (params, sizeof (params), "size=%d simd=%d", fb.size, simd);
+
+			bench_harness_run (&bench, params, fourier_bench_run, &fb, NULL);
+		}
+
+		visual_cpu_set_sse (TRUE);
+		visual_cpu_set_neon (TRUE);
+	}
+
+	bench_harness_finish (&bench);
+
+	return EXIT_SUCCESS;
+}
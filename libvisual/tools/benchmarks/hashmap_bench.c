@@ -0,0 +1,229 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+#define MAX_ENTRIES	16384
+
+/* Layout of the VisHashmap before it moved to open addressing, kept for comparison */
+#define CHAIN_TABLE_SIZE	1024
+
+typedef struct {
+	int		 integer;
+	char		*string;
+	void		*data;
+} ChainEntry;
+
+typedef struct {
+	VisList		 chains[CHAIN_TABLE_SIZE];
+} ChainMap;
+
+typedef enum {
+	MAP_HASHMAP,
+	MAP_CHAINS
+} MapType;
+
+typedef struct {
+	MapType		 type;
+	int		 strings;
+	int		 entries;
+	VisHashmap	*hashmap;
+	ChainMap	*chainmap;
+} HashmapBench;
+
+static const char *map_names[] = {
+	[MAP_HASHMAP]	= "hashmap",
+	[MAP_CHAINS]	= "chains"
+};
+
+static const int entry_counts[] = { 64, 1024, MAX_ENTRIES };
+
+static char keys[MAX_ENTRIES][16];
+
+static uint32_t chain_hash (HashmapBench *hb, int i)
+{
+	uint32_t hash = 0;
+	char *p;
+
+	if (hb->strings == FALSE)
+		return (uint32_t) i * 2654435761U;
+
+	for (p = keys[i]; *p != '\0'; p++)
+		hash = (hash << 5) - hash + *p;
+
+	return hash;
+}
+
+static ChainMap *chain_map_new ()
+{
+	ChainMap *map = visual_mem_new0 (ChainMap, 1);
+	int i;
+
+	for (i = 0; i < CHAIN_TABLE_SIZE; i++)
+		visual_list_init (&map->chains[i], NULL);
+
+	return map;
+}
+
+static void chain_map_free (ChainMap *map)
+{
+	ChainEntry *entry;
+	VisListEntry *le;
+	int i;
+
+	for (i = 0; i < CHAIN_TABLE_SIZE; i++) {
+		le = NULL;
+
+		while ((entry = visual_list_next (&map->chains[i], &le)) != NULL) {
+			if (entry->string != NULL)
+				visual_mem_free (entry->string);
+
+			visual_mem_free (entry);
+			visual_list_delete (&map->chains[i], &le);
+		}
+	}
+
+	visual_mem_free (map);
+}
+
+static void chain_map_put (HashmapBench *hb, int i)
+{
+	ChainEntry *entry = visual_mem_new0 (ChainEntry, 1);
+
+	entry->integer = i;
+	entry->string = hb->strings == TRUE ? visual_strdup (keys[i]) : NULL;
+	entry->data = keys[i];
+
+	visual_list_add (&hb->chainmap->chains[chain_hash (hb, i) % CHAIN_TABLE_SIZE], entry);
+}
+
+static void *chain_map_get (HashmapBench *hb, int i)
+{
+	VisList *chain = &hb->chainmap->chains[chain_hash (hb, i) % CHAIN_TABLE_SIZE];
+	ChainEntry *entry;
+	VisListEntry *le = NULL;
+
+	while ((entry = visual_list_next (chain, &le)) != NULL) {
+		if (hb->strings == TRUE ? strcmp (entry->string, keys[i]) == 0 : entry->integer == i)
+			return entry->data;
+	}
+
+	return NULL;
+}
+
+static void hashmap_bench_fill (HashmapBench *hb)
+{
+	int i;
+
+	if (hb->type == MAP_CHAINS) {
+		hb->chainmap = chain_map_new ();
+
+		for (i = 0; i < hb->entries; i++)
+			chain_map_put (hb, i);
+
+		return;
+	}
+
+	hb->hashmap = visual_hashmap_new (NULL);
+
+	for (i = 0; i < hb->entries; i++) {
+		if (hb->strings == TRUE)
+			visual_hashmap_put_string (hb->hashmap, keys[i], keys[i]);
+		else
+			visual_hashmap_put_integer (hb->hashmap, i, keys[i]);
+	}
+}
+
+static void hashmap_bench_free (HashmapBench *hb)
+{
+	if (hb->type == MAP_CHAINS)
+		chain_map_free (hb->chainmap);
+	else
+		visual_object_unref (VISUAL_OBJECT (hb->hashmap));
+
+	hb->chainmap = NULL;
+	hb->hashmap = NULL;
+}
+
+static void *hashmap_bench_get (HashmapBench *hb, int i)
+{
+	if (hb->type == MAP_CHAINS)
+		return chain_map_get (hb, i);
+
+	if (hb->strings == TRUE)
+		return visual_hashmap_get_string (hb->hashmap, keys[i]);
+
+	return visual_hashmap_get_integer (hb->hashmap, i);
+}
+
+static void insert_bench_run (void *priv)
+{
+	HashmapBench *hb = priv;
+
+	hashmap_bench_fill (hb);
+	hashmap_bench_free (hb);
+}
+
+static void lookup_bench_run (void *priv)
+{
+	HashmapBench *hb = priv;
+	int i;
+
+	for (i = 0; i < hb->entries; i++) {
+		if (hashmap_bench_get (hb, i) != keys[i])
+			fprintf (stderr, "Hashmap bench %s: lookup of %d failed\n", map_names[hb->type], i);
+	}
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	HashmapBench hb;
+	char params[128];
+	int i, n;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "hashmap_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	/* Keys look like the ones the caches use */
+	for (i = 0; i < MAX_ENTRIES; i++)
+		snprintf (keys[i], sizeof (keys[i]), "%d_%d", i * 7, i & 31);
+
+	hb.chainmap = NULL;
+	hb.hashmap = NULL;
+
+	for (hb.strings = FALSE; hb.strings <= TRUE; hb.strings++) {
+		for (n = 0; n < (int) (sizeof (entry_counts) / sizeof (entry_counts[0])); n++) {
+			hb.entries = entry_counts[n];
+
+			for (hb.type = MAP_HASHMAP; hb.type <= MAP_CHAINS; hb.type++) {
+				snprintf (params, sizeof (params), "map=%s keys=%s entries=%d op=insert",
+						map_names[hb.type], hb.strings == TRUE ? "string" : "integer", hb.entries);
+
+				bench_harness_run (&bench, params, insert_bench_run, &hb, NULL);
+
+				hashmap_bench_fill (&hb);
+
+				snprintf (params, sizeof (params), "map=%s keys=%s entries=%d op=lookup",
+						map_names[hb.type], hb.strings == TRUE ? "string" : "integer", hb.entries);
+
+				bench_harness_run (&bench, params, lookup_bench_run, &hb, NULL);
+
+				hashmap_bench_free (&hb);
+			}
+		}
+	}
+
+	bench_harness_finish (&bench);
+
+	return EXIT_SUCCESS;
+}
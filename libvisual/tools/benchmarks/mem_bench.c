@@ -0,0 +1,244 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+
+/* Every iteration moves about this many bytes, in as many calls as the size needs */
+#define BENCH_BYTES	(4 * 1024 * 1024)
+#define MAX_SIZE	(64 * 1024 * 1024)
+
+/* Room for the misaligned checks */
+#define BUFFER_SIZE	(MAX_SIZE + 64)
+
+typedef enum {
+	MEM_OP_COPY,
+	MEM_OP_SET8,
+	MEM_OP_SET16,
+	MEM_OP_SET32,
+	MEM_OP_LAST
+} MemOp;
+
+typedef enum {
+	MEM_IMPL_C,
+	MEM_IMPL_SSE2,
+	MEM_IMPL_AVX2,
+	MEM_IMPL_NEON,
+	MEM_IMPL_LAST
+} MemImpl;
+
+typedef struct {
+	MemOp		 op;
+	visual_size_t	 size;
+	int		 calls;
+} MemBench;
+
+static const char *op_names[] = {
+	[MEM_OP_COPY]	= "copy",
+	[MEM_OP_SET8]	= "set8",
+	[MEM_OP_SET16]	= "set16",
+	[MEM_OP_SET32]	= "set32"
+};
+
+static const char *impl_names[] = {
+	[MEM_IMPL_C]		= "c",
+	[MEM_IMPL_SSE2]		= "sse2",
+	[MEM_IMPL_AVX2]		= "avx2",
+	[MEM_IMPL_NEON]		= "neon"
+};
+
+/* From fits in L1 to far past the last level cache */
+static const visual_size_t sizes[] = {
+	16, 64, 256, 1024, 4096, 16384, 65536, 262144,
+	1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024, 32 * 1024 * 1024, MAX_SIZE
+};
+
+/* Odd sizes to cover the heads and tails of the vector versions */
+static const visual_size_t check_sizes[] = { 1, 3, 17, 255, 256, 4099, 65537, 1024 * 1024 + 13 };
+
+static uint8_t *source;
+static uint8_t *output;
+static uint8_t *reference;
+
+static int set_impl (MemImpl impl)
+{
+	visual_cpu_set_sse2 (FALSE);
+	visual_cpu_set_avx2 (FALSE);
+	visual_cpu_set_neon (FALSE);
+
+	switch (impl) {
+		case MEM_IMPL_SSE2:
+			if (visual_cpu_set_sse2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		case MEM_IMPL_AVX2:
+			if (visual_cpu_set_avx2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		case MEM_IMPL_NEON:
+			if (visual_cpu_set_neon (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		default:
+			break;
+	}
+
+	visual_mem_initialize ();
+
+	return TRUE;
+}
+
+static void restore_impl ()
+{
+	visual_cpu_set_sse2 (TRUE);
+	visual_cpu_set_avx2 (TRUE);
+	visual_cpu_set_neon (TRUE);
+
+	visual_mem_initialize ();
+}
+
+static void mem_op (MemOp op, uint8_t *dest, const uint8_t *src, visual_size_t size)
+{
+	switch (op) {
+		case MEM_OP_COPY:
+			visual_mem_copy (dest, src, size);
+			break;
+
+		case MEM_OP_SET8:
+			visual_mem_set (dest, 0x5a, size);
+			break;
+
+		case MEM_OP_SET16:
+			visual_mem_set16 (dest, 0xa55a, size / 2);
+			break;
+
+		case MEM_OP_SET32:
+			visual_mem_set32 (dest, 0x12345678, size / 4);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Against the C versions, on every alignment of the destination and the source */
+static int check_impl (MemImpl impl)
+{
+	MemOp op;
+	int i, doff, soff;
+	visual_size_t size;
+
+	for (op = MEM_OP_COPY; op < MEM_OP_LAST; op++) {
+		for (i = 0; i < (int) (sizeof (check_sizes) / sizeof (check_sizes[0])); i++) {
+			for (doff = 0; doff < 32; doff += op == MEM_OP_SET32 ? 4 : op == MEM_OP_SET16 ? 2 : 1) {
+				soff = (doff * 7) & 31;
+
+				size = check_sizes[i];
+
+				if (op == MEM_OP_SET16)
+					size &= ~1;
+				else if (op == MEM_OP_SET32)
+					size &= ~3;
+
+				memset (output, 0xee, size + 64);
+				memset (reference, 0xee, size + 64);
+
+				set_impl (MEM_IMPL_C);
+				mem_op (op, reference + doff, source + soff, size);
+
+				set_impl (impl);
+				mem_op (op, output + doff, source + soff, size);
+
+				if (memcmp (output, reference, size + 64) != 0) {
+					fprintf (stderr, "Mem bench %s %s: %lu bytes at offset %d differ\n",
+							impl_names[impl], op_names[op], (unsigned long) size, doff);
+
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void mem_bench_run (void *priv)
+{
+	MemBench *mb = priv;
+	int i;
+
+	for (i = 0; i < mb->calls; i++)
+		mem_op (mb->op, output, source, mb->size);
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	MemBench mb;
+	MemImpl impl;
+	char params[96];
+	int i;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "mem_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	source = visual_mem_malloc_aligned (BUFFER_SIZE, VISUAL_MEM_ALIGN_SIMD);
+	output = visual_mem_malloc_aligned (BUFFER_SIZE, VISUAL_MEM_ALIGN_SIMD);
+	reference = visual_mem_malloc_aligned (BUFFER_SIZE, VISUAL_MEM_ALIGN_SIMD);
+
+	for (i = 0; i < BUFFER_SIZE; i++)
+		source[i] = rand ();
+
+	for (impl = MEM_IMPL_SSE2; impl < MEM_IMPL_LAST; impl++) {
+		if (set_impl (impl) == TRUE && check_impl (impl) == FALSE)
+			return EXIT_FAILURE;
+	}
+
+	for (mb.op = MEM_OP_COPY; mb.op < MEM_OP_LAST; mb.op++) {
+		for (i = 0; i < (int) (sizeof (sizes) / sizeof (sizes[0])); i++) {
+			mb.size = sizes[i];
+			mb.calls = mb.size < BENCH_BYTES ? BENCH_BYTES / mb.size : 1;
+
+			for (impl = MEM_IMPL_C; impl < MEM_IMPL_LAST; impl++) {
+				/* Copy and set8 are the C library memcpy and memset with every impl, they
+				 * give the bandwidth the vector sets are held against */
+				if (impl != MEM_IMPL_C && (mb.op == MEM_OP_COPY || mb.op == MEM_OP_SET8))
+					continue;
+
+				if (set_impl (impl) == FALSE)
+					continue;
+
+				snprintf (params, sizeof (params), "op=%s impl=%s size=%lu calls=%d",
+						op_names[mb.op], mb.op == MEM_OP_COPY || mb.op == MEM_OP_SET8 ? "libc" : impl_names[impl],
+						(unsigned long) mb.size, mb.calls);
+
+				bench_harness_run (&bench, params, mem_bench_run, &mb, NULL);
+			}
+		}
+	}
+
+	restore_impl ();
+
+	visual_mem_free (source);
+	visual_mem_free (output);
+	visual_mem_free (reference);
+
+	bench_harness_finish (&bench);
+
+	return EXIT_SUCCESS;
+}
@@ -3,54 +3,110 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#define DEPTH		VISUAL_VIDEO_DEPTH_32BIT
-#define TIMES		500
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+
+typedef struct {
+	VisMorph	*morph;
+	VisAudio	*audio;
+	VisVideo	*src1;
+	VisVideo	*src2;
+	float		 rate;
+} MorphBench;
+
+static void morph_bench_run (void *priv)
+{
+	MorphBench *mb = priv;
+
+	visual_morph_set_rate (mb->morph, mb->rate);
+	visual_morph_run (mb->morph, mb->audio, mb->src1, mb->src2);
+
+	mb->rate += 0.1;
+
+	if (mb->rate > 1.0)
+		mb->rate = 0.0;
+}
 
 int main (int argc, char **argv)
 {
-	float rate = 0.0;
-	VisMorph *morph;
-	VisAudio audio;
-	VisVideo *dest, *src1, *src2;
-	int i;
+	BenchHarness bench;
+	MorphBench mb;
+	VisVideo *dest;
+	const char *morphs[BENCH_HARNESS_MAX_SWEEP];
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int nmorphs, ndepths, nsizes;
+	char params[256];
+	int m, d, s;
 
 	visual_init (&argc, &argv);
 
-	if (argc < 2)
-		morph = visual_morph_new ("alphablend");
-	else
-		morph = visual_morph_new (argv[1]);
+	if (bench_harness_init (&bench, "morph_throughput_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, "[morph]");
+
+		return EXIT_FAILURE;
+	}
 
-	visual_morph_realize (morph);
+	if (argc > 1 && bench.plugins == NULL)
+		bench.plugins = argv[1];
 
-	dest = visual_video_new ();
+	nmorphs = bench_harness_get_plugins (&bench, morphs, "alphablend", visual_morph_get_next_by_name);
+	ndepths = bench_harness_get_depths (&bench, depths, "32");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "640x400");
 
-	visual_video_set_depth (dest, DEPTH);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+	mb.audio = visual_audio_new ();
+	visual_audio_analyze (mb.audio);
 
-	src1 = visual_video_new ();
-	src2 = visual_video_new ();
+	for (m = 0; m < nmorphs; m++) {
+		mb.morph = visual_morph_new (morphs[m]);
 
-	visual_video_clone (src1, dest);
-	visual_video_clone (src2, dest);
+		if (mb.morph == NULL) {
+			fprintf (stderr, "Can't load morph '%s'\n", morphs[m]);
 
-	visual_video_allocate_buffer (src1);
-	visual_video_allocate_buffer (src2);
+			continue;
+		}
 
-	visual_morph_set_video (morph, dest);
-	for (i = 0; i < TIMES; i++) {
-		visual_morph_set_rate (morph, rate);
-		visual_morph_run (morph, &audio, src1, src2);
+		visual_morph_realize (mb.morph);
 
-		rate += 0.1;
+		for (d = 0; d < ndepths; d++) {
+			for (s = 0; s < nsizes; s++) {
+				dest = visual_video_new ();
 
-		if (rate > 1.0)
-			rate = 0.0;
+				visual_video_set_depth (dest, depths[d]);
+				visual_video_set_dimension (dest, widths[s], heights[s]);
+				visual_video_allocate_buffer (dest);
+
+				mb.src1 = visual_video_new ();
+				mb.src2 = visual_video_new ();
+
+				visual_video_clone (mb.src1, dest);
+				visual_video_clone (mb.src2, dest);
+
+				visual_video_allocate_buffer (mb.src1);
+				visual_video_allocate_buffer (mb.src2);
+
+				visual_morph_set_video (mb.morph, dest);
+				mb.rate = 0.0;
+
+				snprintf (params, sizeof (params), "morph=%s depth=%d size=%dx%d",
+						morphs[m], visual_video_depth_value_from_enum (depths[d]),
+						widths[s], heights[s]);
+
+				bench_harness_run (&bench, params, morph_bench_run, &mb, NULL);
+
+				visual_object_unref (VISUAL_OBJECT (mb.src1));
+				visual_object_unref (VISUAL_OBJECT (mb.src2));
+				visual_object_unref (VISUAL_OBJECT (dest));
+			}
+		}
+
+		visual_object_unref (VISUAL_OBJECT (mb.morph));
 	}
 
-	printf ("Morph throughput bench %d times depthBPP %d morph: %s\n", TIMES, dest->bpp,
-			(visual_plugin_get_info (visual_morph_get_plugin (morph)))->plugname);
+	visual_object_unref (VISUAL_OBJECT (mb.audio));
+
+	bench_harness_finish (&bench);
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,146 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_harness.h"
+
+#define ITERATIONS	10
+
+/* Every thread creates this many objects, destroys them, and repeats */
+#define BATCH		256
+#define ROUNDS		16
+
+typedef enum {
+	OBJECT_MALLOC,
+	OBJECT_BUFFER,
+	OBJECT_EVENT,
+	OBJECT_LIST_ENTRY,
+	OBJECT_LAST
+} ObjectType;
+
+typedef struct {
+	ObjectType	 type;
+	int		 threads;
+} ObjectBench;
+
+static const char *object_names[] = {
+	[OBJECT_MALLOC]		= "malloc",
+	[OBJECT_BUFFER]		= "buffer",
+	[OBJECT_EVENT]		= "event",
+	[OBJECT_LIST_ENTRY]	= "listentry"
+};
+
+/* Single threaded against one thread per CPU, at least two */
+static const int thread_counts[] = { 1, 0 };
+
+static void object_bench_thread (void *priv, int start, int end)
+{
+	ObjectBench *ob = priv;
+	VisObject *objects[BATCH];
+	void *blocks[BATCH];
+	VisList list;
+	VisListEntry *le;
+	int i, j;
+
+	for (; start < end; start++) {
+		for (j = 0; j < ROUNDS; j++) {
+			switch (ob->type) {
+				case OBJECT_MALLOC:
+					/* The allocation alone, without the object around it */
+					for (i = 0; i < BATCH; i++)
+						blocks[i] = visual_mem_malloc0 (sizeof (VisBuffer));
+
+					for (i = 0; i < BATCH; i++)
+						visual_mem_free (blocks[i]);
+
+					break;
+
+				case OBJECT_BUFFER:
+					for (i = 0; i < BATCH; i++)
+						objects[i] = VISUAL_OBJECT (visual_buffer_new ());
+
+					for (i = 0; i < BATCH; i++)
+						visual_object_unref (objects[i]);
+
+					break;
+
+				case OBJECT_EVENT:
+					for (i = 0; i < BATCH; i++)
+						objects[i] = VISUAL_OBJECT (visual_event_new ());
+
+					for (i = 0; i < BATCH; i++)
+						visual_object_unref (objects[i]);
+
+					break;
+
+				case OBJECT_LIST_ENTRY:
+					visual_list_init (&list, NULL);
+
+					for (i = 0; i < BATCH; i++)
+						visual_list_add (&list, &list);
+
+					le = NULL;
+					while (visual_list_next (&list, &le) != NULL)
+						visual_list_delete (&list, &le);
+
+					break;
+
+				default:
+					break;
+			}
+		}
+	}
+}
+
+static void object_bench_run (void *priv)
+{
+	ObjectBench *ob = priv;
+
+	visual_jobs_parallel_for (0, ob->threads, 1, object_bench_thread, ob);
+}
+
+int main (int argc, char **argv)
+{
+	BenchHarness bench;
+	VisCPU *cpu;
+	ObjectBench ob;
+	char params[128];
+	int t;
+
+	visual_init (&argc, &argv);
+
+	if (bench_harness_init (&bench, "object_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	for (t = 0; t < (int) (sizeof (thread_counts) / sizeof (thread_counts[0])); t++) {
+		ob.threads = thread_counts[t];
+
+		if (ob.threads == 0) {
+			cpu = visual_cpu_get_caps ();
+			ob.threads = cpu != NULL ? cpu->nrcpu : 1;
+
+			if (ob.threads < 2)
+				ob.threads = 2;
+		}
+
+		/* The calling thread is one of them */
+		visual_jobs_set_worker_count (ob.threads - 1);
+
+		for (ob.type = OBJECT_MALLOC; ob.type < OBJECT_LAST; ob.type++) {
+			snprintf (params, sizeof (params), "object=%s threads=%d ops=%d",
+					object_names[ob.type], ob.threads, ob.threads * BATCH * ROUNDS);
+
+			bench_harness_run (&bench, params, object_bench_run, &ob, NULL);
+		}
+	}
+
+	visual_jobs_set_worker_count (-1);
+
+	bench_harness_finish (&bench);
+
+	return EXIT_SUCCESS;
+}
@@ -2,33 +2,232 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#define TIMES		500
-#define DEPTH		VISUAL_VIDEO_DEPTH_32BIT
-#define INTERPOL	VISUAL_VIDEO_SCALE_BILINEAR
+#include "bench_harness.h"
+
+/* A full frame per iteration, the slow filters take milliseconds at 1920x1080 */
+#define ITERATIONS	1
+#define SRC_WIDTH	320
+#define SRC_HEIGHT	200
+
+/* Every level enables the features of the ones before it */
+typedef enum {
+	SCALE_IMPL_C,
+	SCALE_IMPL_SSE2,
+	SCALE_IMPL_SSSE3,
+	SCALE_IMPL_AVX2,
+	SCALE_IMPL_NEON,
+	SCALE_IMPL_LAST
+} ScaleImpl;
+
+typedef struct {
+	VisVideo		*dest;
+	VisVideo		*src;
+	VisVideoScaleMethod	 interpol;
+} ScaleBench;
+
+static const char *interpol_names[] = {
+	[VISUAL_VIDEO_SCALE_NEAREST]	= "nearest",
+	[VISUAL_VIDEO_SCALE_BILINEAR]	= "bilinear",
+	[VISUAL_VIDEO_SCALE_BICUBIC]	= "bicubic",
+	[VISUAL_VIDEO_SCALE_LANCZOS]	= "lanczos"
+};
+
+static const char *impl_names[] = {
+	[SCALE_IMPL_C]		= "c",
+	[SCALE_IMPL_SSE2]	= "sse2",
+	[SCALE_IMPL_SSSE3]	= "ssse3",
+	[SCALE_IMPL_AVX2]	= "avx2",
+	[SCALE_IMPL_NEON]	= "neon"
+};
+
+/* Serial against the band threads, 0 being one per CPU */
+static const int thread_counts[] = { 1, 0 };
+
+static const VisVideoDepth check_depths[] = {
+	VISUAL_VIDEO_DEPTH_8BIT, VISUAL_VIDEO_DEPTH_16BIT, VISUAL_VIDEO_DEPTH_24BIT, VISUAL_VIDEO_DEPTH_32BIT
+};
+
+/* Tiny, odd, shrinking and growing sizes, for the edges of the filters and the vector tails.
+ * Every pair is checked per method, depth and impl, so they stay small */
+static const int check_sizes[][2] = {
+	{ 1, 1 }, { 2, 3 }, { 5, 4 }, { 17, 9 }, { 33, 7 }, { 67, 35 }, { 131, 67 }
+};
+
+static int set_impl (int impl)
+{
+	visual_cpu_set_mmx (FALSE);
+	visual_cpu_set_sse2 (FALSE);
+	visual_cpu_set_ssse3 (FALSE);
+	visual_cpu_set_avx2 (FALSE);
+	visual_cpu_set_neon (FALSE);
+
+	switch (impl) {
+		case SCALE_IMPL_AVX2:
+			if (visual_cpu_set_avx2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			/* Fall through */
+		case SCALE_IMPL_SSSE3:
+			if (visual_cpu_set_ssse3 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			/* Fall through */
+		case SCALE_IMPL_SSE2:
+			if (visual_cpu_set_sse2 (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		case SCALE_IMPL_NEON:
+			if (visual_cpu_set_neon (TRUE) != VISUAL_OK)
+				return FALSE;
+
+			break;
+
+		default:
+			break;
+	}
+
+	visual_video_scale_initialize ();
+
+	return TRUE;
+}
+
+static void restore_impl ()
+{
+	visual_cpu_set_mmx (TRUE);
+	visual_cpu_set_sse2 (TRUE);
+	visual_cpu_set_ssse3 (TRUE);
+	visual_cpu_set_avx2 (TRUE);
+	visual_cpu_set_neon (TRUE);
+
+	visual_video_scale_initialize ();
+}
+
+static void scale_bench_run (void *priv)
+{
+	ScaleBench *sb = priv;
+
+	visual_video_scale (sb->dest, sb->src, sb->interpol);
+}
+
+static int check_scale (ScaleImpl impl, VisVideoScaleMethod interpol, VisVideoDepth depth,
+		int dwidth, int dheight, int swidth, int sheight)
+{
+	ScaleBench sb;
+	int same;
+
+	sb.src = bench_harness_video (depth, swidth, sheight, BENCH_HARNESS_CHECK_PADDING);
+	sb.dest = bench_harness_video (depth, dwidth, dheight, BENCH_HARNESS_CHECK_PADDING);
+	sb.interpol = interpol;
+
+	same = bench_harness_check_impl (&sb.dest, scale_bench_run, &sb, set_impl, impl);
+
+	if (same == FALSE) {
+		fprintf (stderr, "Scale bench %s: %s depth=%d size=%dx%d src=%dx%d differs from c\n",
+				impl_names[impl], interpol_names[interpol], visual_video_depth_value_from_enum (depth),
+				dwidth, dheight, swidth, sheight);
+	}
+
+	visual_object_unref (VISUAL_OBJECT (sb.dest));
+	visual_object_unref (VISUAL_OBJECT (sb.src));
+
+	return same;
+}
+
+/* Every method and depth between every pair of check sizes */
+static int check_impl (ScaleImpl impl)
+{
+	VisVideoScaleMethod interpol;
+	int d, s1, s2;
+
+	for (interpol = VISUAL_VIDEO_SCALE_NEAREST; interpol <= VISUAL_VIDEO_SCALE_LANCZOS; interpol++) {
+		for (d = 0; d < (int) (sizeof (check_depths) / sizeof (check_depths[0])); d++) {
+			for (s1 = 0; s1 < (int) (sizeof (check_sizes) / sizeof (check_sizes[0])); s1++) {
+				for (s2 = 0; s2 < (int) (sizeof (check_sizes) / sizeof (check_sizes[0])); s2++) {
+					if (check_scale (impl, interpol, check_depths[d],
+								check_sizes[s1][0], check_sizes[s1][1],
+								check_sizes[s2][0], check_sizes[s2][1]) == FALSE)
+						return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
 
 int main (int argc, char **argv)
 {
-	VisVideo *dest, *src;
-	int i;
+	BenchHarness bench;
+	ScaleBench sb;
+	ScaleImpl impl;
+	VisVideoDepth depths[BENCH_HARNESS_MAX_SWEEP];
+	int widths[BENCH_HARNESS_MAX_SWEEP], heights[BENCH_HARNESS_MAX_SWEEP];
+	int ndepths, nsizes;
+	char params[256];
+	int d, s, t, threads;
 
 	visual_init (&argc, &argv);
 
-	dest = visual_video_new ();
-	visual_video_set_depth (dest, DEPTH);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+	if (bench_harness_init (&bench, "scale_bench", ITERATIONS, &argc, &argv) < 0) {
+		bench_harness_usage (&bench, NULL);
+
+		return EXIT_FAILURE;
+	}
+
+	/* The checks run serially, the bands would hide nothing but the timing */
+	visual_video_set_thread_count (1);
+
+	for (impl = SCALE_IMPL_SSE2; impl < SCALE_IMPL_LAST; impl++) {
+		if (set_impl (impl) == TRUE && check_impl (impl) == FALSE)
+			return EXIT_FAILURE;
+	}
+
+	/* The sizes are the destination, the source stays at 320x200 */
+	ndepths = bench_harness_get_depths (&bench, depths, "32");
+	nsizes = bench_harness_get_sizes (&bench, widths, heights, "640x400,1920x1080");
+
+	for (d = 0; d < ndepths; d++) {
+		for (s = 0; s < nsizes; s++) {
+			sb.dest = bench_harness_video (depths[d], widths[s], heights[s], 0);
+			sb.src = bench_harness_video (depths[d], SRC_WIDTH, SRC_HEIGHT, 0);
+
+			/* Destination pixels, what a fullscreen actor is limited by */
+			bench_harness_set_throughput (&bench, widths[s] * heights[s], "Pixels");
+
+			for (sb.interpol = VISUAL_VIDEO_SCALE_NEAREST; sb.interpol <= VISUAL_VIDEO_SCALE_LANCZOS;
+					sb.interpol++) {
+				threads = 0;
+
+				for (t = 0; t < (int) (sizeof (thread_counts) / sizeof (thread_counts[0])); t++) {
+					visual_video_set_thread_count (thread_counts[t]);
+
+					/* One per CPU is serial again on a single core */
+					if (visual_video_get_thread_count () == threads)
+						continue;
+
+					threads = visual_video_get_thread_count ();
+
+					snprintf (params, sizeof (params), "depth=%d size=%dx%d src=%dx%d interpol=%s threads=%d",
+							visual_video_depth_value_from_enum (depths[d]), widths[s], heights[s],
+							SRC_WIDTH, SRC_HEIGHT, interpol_names[sb.interpol], threads);
+
+					bench_harness_run_impls (&bench, params, impl_names, SCALE_IMPL_LAST, set_impl,
+							scale_bench_run, &sb);
+				}
+			}
 
-	src = visual_video_new ();
-	visual_video_set_depth (src, DEPTH);
-	visual_video_set_dimension (src, 320, 200);
-	visual_video_allocate_buffer (src);
+			visual_object_unref (VISUAL_OBJECT (sb.src));
+			visual_object_unref (VISUAL_OBJECT (sb.dest));
+		}
+	}
 
-	for (i = 0; i < TIMES; i++)
-		visual_video_scale (dest, src, INTERPOL);
+	restore_impl ();
 
-	printf ("Scale bench overlay %d times, depth %d, interpol %d\n", TIMES,
-			DEPTH, INTERPOL);
+	bench_harness_finish (&bench);
 
 	return EXIT_SUCCESS;
 }
@@ -48,6 +48,7 @@ static int  framerate;
 static int  driver;
 static int  have_seed;
 static uint32_t seed;
+static int  mem_stats;
 
 /* list of available driver-creators - register new drivers here */
 typedef struct
@@ -131,6 +132,7 @@ static void _print_help(char *name)
            "\t--actor <actor>\t\t-a <actor>\tUse this actor plugin [%s]\n"
            "\t--morph <morph>\t\t-m <morph>\tUse this morph plugin [%s]\n"
 		   "\t--seed <seed>\t\t-s <seed>\tSet random seed\n"
+           "\t--mem-stats\t\t-M\t\tPrint memory usage per subsystem on exit\n"
            "\t--fps <n>\t\t-f <n>\t\tLimit output to n frames per second (if display driver supports it) [%d]\n\n",
            "http://github.com/StarVisuals/libvisual",
            name,
@@ -159,10 +161,11 @@ static int _parse_args(int argc, char *argv[])
         {"morph",       required_argument, 0, 'm'},
         {"fps",         required_argument, 0, 'f'},
         {"seed",        required_argument, 0, 's'},
+        {"mem-stats",   no_argument,       0, 'M'},
         {0,             0,                 0,  0 }
     };
 
-    while((argument = getopt_long(argc, argv, "hpD:d:i:a:m:f:s:", loptions, &index)) >= 0)
+    while((argument = getopt_long(argc, argv, "hpD:d:i:a:m:f:s:M", loptions, &index)) >= 0)
     {
 
         switch(argument)
@@ -260,6 +263,13 @@ static int _parse_args(int argc, char *argv[])
 				 break;
             }
 
+            /* --mem-stats */
+            case 'M':
+            {
+                /* already enabled by _want_mem_stats() */
+                break;
+            }
+
             /* invalid argument */
             case '?':
             {
@@ -281,6 +291,48 @@ static int _parse_args(int argc, char *argv[])
     return EXIT_SUCCESS;
 }
 
+/** memory statistics have to be enabled before visual_init() allocates anything */
+static int _want_mem_stats(int argc, char *argv[])
+{
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--") == 0)
+            break;
+
+        if(strcmp(argv[i], "-M") == 0 || strcmp(argv[i], "--mem-stats") == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/** print memory usage per subsystem */
+static void _print_mem_stats()
+{
+    VisMemStats stats;
+    int tag;
+
+    fprintf(stderr, "%-10s %10s %10s %12s %12s %12s %12s\n",
+            "subsystem", "allocs", "frees", "bytes", "peak", "frame allocs", "frame bytes");
+
+    for(tag = 0; tag < VISUAL_MEM_TAG_LAST; tag++)
+    {
+        if(visual_mem_get_stats(tag, &stats) != VISUAL_OK)
+            continue;
+
+        fprintf(stderr, "%-10s %10llu %10llu %12llu %12llu %12llu %12llu\n",
+                visual_mem_tag_to_string(tag),
+                (unsigned long long) stats.allocs,
+                (unsigned long long) stats.frees,
+                (unsigned long long) stats.bytes,
+                (unsigned long long) stats.peak,
+                (unsigned long long) stats.frameallocs,
+                (unsigned long long) stats.framebytes);
+    }
+}
+
 static void v_cycleActor (int prev)
 {
     const char *name;
@@ -330,6 +382,10 @@ int main (int argc, char **argv)
          * visual_init() after visual_quit() results in undefined state)
          */
         visual_log_set_verbosity(VISUAL_LOG_DEBUG);
+
+        if((mem_stats = _want_mem_stats(argc, argv)))
+                visual_mem_set_stats_enabled(TRUE);
+
         visual_init (&argc, &argv);
 
         /* parse commandline arguments */
@@ -582,6 +638,9 @@ _m_exit_display:
                 display_close(display);
 
 _m_exit:
+                if(mem_stats)
+                        _print_mem_stats();
+
                 /* cleanup resources allocated by visual_init() */
                 visual_quit ();
 